@@ -213,8 +213,8 @@ fi
 %doc libvuurmuur-%{version}/doc/README libvuurmuur-%{version}/AUTHORS libvuurmuur-%{version}/COPYING
 %config %{_sysconfdir}/vuurmuur/plugins/textdir.conf
 %{_libdir}/libvuurmuur.so
-%{_libdir}/libvuurmuur.so.0
-%{_libdir}/libvuurmuur.so.0.6.0
+%{_libdir}/libvuurmuur.so.7
+%{_libdir}/libvuurmuur.so.7.0.0
 %dir %{_libdir}/vuurmuur
 %dir %{_sysconfdir}/vuurmuur/textdir
 %{_libdir}/vuurmuur/plugins/libtextdir.so
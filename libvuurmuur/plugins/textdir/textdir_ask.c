@@ -23,7 +23,13 @@
 /*
     asking from and telling to the backend (TODO: name)
 
+    The answers come from the object cache, so a file is only read
+    again when it changed. For 'multi' questions we remember where we
+    are in the file, so the next call returns the next value.
+
     returns
+         1 answer found
+         0 not found (or the last of a 'multi' question)
         -1 error
 */
 int
@@ -36,18 +42,15 @@ ask_textdir(const int debuglvl,
             int type,
             int multi)
 {
-    int                     retval = 0;
-    char                    *file_location = NULL;
-    char                    line[MAX_LINE_LENGTH] = "",
-                            variable[64] = "",
-                            value[512] = "";
-    size_t                  i = 0,
-                            line_pos = 0,
-                            val_pos = 0;
-    char                    delt = 'a' - 'A';
-    size_t                  line_length = 0;
-    struct TextdirBackend_  *ptr = NULL;
-    size_t                  len = 0;
+    int                         retval = 0;
+    char                        *file_location = NULL;
+    size_t                      i = 0;
+    char                        delt = 'a' - 'A';
+    struct TextdirBackend_      *ptr = NULL;
+    struct TextdirCacheFile_    *file_ptr = NULL;
+    struct TextdirCacheVar_     *var_ptr = NULL;
+    d_list_node                 *d_node = NULL;
+    size_t                      len = 0;
 
     /* better safe than sorry */
     if(!backend || !name || !question)
@@ -81,126 +84,50 @@ ask_textdir(const int debuglvl,
     if(!(file_location = get_filelocation(debuglvl, backend, name, type)))
         return(-1);
 
-    /* check if we are clean */
-    if(ptr->file != NULL && multi == 0)
+    /*  continue a 'multi' question where we left off. We don't check the
+        file for changes then, it is read again once we are done. */
+    if(multi == 1 && ptr->multi_file != NULL &&
+       strcmp(ptr->multi_file->path, file_location) == 0 &&
+       strcmp(ptr->multi_question, question) == 0)
     {
-        (void)vrprint.warning("Warning", "the last 'multi' call to '%s' probably failed, because the file is still open when it shouldn't.", __FUNC__);
-
-        fclose(ptr->file);
-        ptr->file = NULL;
+        file_ptr = ptr->multi_file;
+        d_node = ptr->multi_node->next;
     }
-
-    /* now open and read the file, but only if it is not already open */
-    if(ptr->file == NULL)
+    else
     {
-        if(!(ptr->file = vuurmuur_fopen(debuglvl, ptr->vuurmuur_config, file_location, "r")))
-        {
-            (void)vrprint.error(-1, "Error", "Unable to open file '%s'.", file_location);
+        ptr->multi_file = NULL;
+        ptr->multi_node = NULL;
 
+        if(!(file_ptr = textdir_cache_get(debuglvl, ptr, file_location)))
+        {
             free(file_location);
             return(-1);
         }
+        d_node = file_ptr->vars.top;
     }
 
-    /* start (or continue) looping trough the file */
-    while (fgets(line, (int)sizeof(line), ptr->file) != NULL)
+    /* look for the variable */
+    for( ; d_node; d_node = d_node->next)
     {
-        line_length = strlen(line);
-        if(line_length < 0)
-        {
-            (void)vrprint.error(-1, "Internal Error", "unable to determine the length of 'line' (in: %s).", __FUNC__);
-
-            free(file_location);
-            fclose(ptr->file);
-            ptr->file = NULL;
-            return(-1);
-        }
-        else if(line_length > MAX_LINE_LENGTH)
-        {
-            (void)vrprint.error(-1, "Error", "line is longer than allowed (line: %d, max: %d) (in: %s).", line_length, MAX_LINE_LENGTH, __FUNC__);
-
-            free(file_location);
-            fclose(ptr->file);
-            ptr->file = NULL;
-            return(-1);
-        }
-
-        /* first check if the line is a comment. */
-        if (line_length == 0 || line[0] == '#' || line[0] == ' ' || line[0] == '\0' ||
-                line[0] == '\n' || line[0] == '\t')
-        {
-            /* continue with the next line, its a comment or an empty line. */
-            continue;
-        }
-
-        /* look for the occurance of the = separator */
-        char *val = strchr(line, '=');
-        if (val == NULL) {
-            /* not a valid line, ignore */
-            continue;
-        }
-
-        /* val - line = var len */
-        size_t var_len = val - line + 1;
-        if (var_len > (sizeof(variable) - 1)) {
-            /* invalid line, ignore */
-            continue;
-        }
-
-        strlcpy(variable, line, var_len);
-
-        if (debuglvl >= LOW)
-            (void)vrprint.debug(__FUNC__, "variable %s", variable);
+        var_ptr = d_node->data;
 
         /* now see if this was what we were looking for */
-        if(strcmp(question, variable) != 0) {
-            /* nope, ignore line */
+        if(strcmp(question, var_ptr->variable) != 0)
             continue;
-        }
-
-        /* skip pass the '=' char */
-        val++;
-
-        size_t val_len = strlen(val);
-
-        /* copy the value into "value" */
-        val_pos = 0; line_pos = 0;
-
-        while(val[line_pos] != '\0' && val[line_pos] != '\n' && line_pos < val_len && val_pos < max_answer)
-        {
-            /* if the first character is a '"' we strip it. */
-            if((val_pos == 0) && (val[line_pos] == '\"'))
-                line_pos++;
-
-            /* otherwise copy the char */
-            else
-            {
-                value[val_pos]=val[line_pos];
-
-                line_pos++;
-                val_pos++;
-            }
-        }
-
-        /* if the last character is a '"' we strip it. */
-        if (val_pos > 0 && value[val_pos - 1] == '\"')
-            value[val_pos - 1] = '\0';
-        else
-            value[val_pos] = '\0';
 
         if(debuglvl >= MEDIUM)
-            (void)vrprint.debug(__FUNC__, "question '%s' matched, value: '%s'", question, value);
+            (void)vrprint.debug(__FUNC__, "question '%s' matched, value: '%s'", question, var_ptr->value);
 
         /* copy back the value to "answer" */
-        len = strlcpy(answer, value, max_answer);
+        len = strlcpy(answer, var_ptr->value, max_answer);
         if(len >= max_answer)
         {
             (void)vrprint.error(-1, "Error", "buffer overrun when reading file '%s', question '%s': len %u, max: %u (in: %s:%d).",
                     file_location, question, len, max_answer, __FUNC__, __LINE__);
 
+            ptr->multi_file = NULL;
+            ptr->multi_node = NULL;
             free(file_location);
-            fclose(ptr->file);
-            ptr->file = NULL;
             return(-1);
         }
 
@@ -208,33 +135,27 @@ ask_textdir(const int debuglvl,
         if(strlen(answer) > 0)
             retval = 1;
 
-        /* break out of the loop so when we call multi again we continue where we were */
         break;
     }
 
-    /* cleanup */
-    if((multi == 1 && retval != 1) || multi == 0)
+    /* remember where we are so the next 'multi' call continues from here */
+    if(multi == 1 && retval == 1)
     {
-        if(debuglvl >= HIGH)
-            (void)vrprint.debug(__FUNC__, "close the file.");
-
-        if(fclose(ptr->file) != 0)
-        {
-            (void)vrprint.error(-1, "Error", "closing file '%s' failed: %s (in: %s).", file_location, strerror(errno), __FUNC__);
-            retval = -1;
-        }
-        ptr->file = NULL;
+        ptr->multi_file = file_ptr;
+        ptr->multi_node = d_node;
+        (void)strlcpy(ptr->multi_question, question, sizeof(ptr->multi_question));
+    }
+    else
+    {
+        ptr->multi_file = NULL;
+        ptr->multi_node = NULL;
     }
 
     /* cleanup filelocation */
     free(file_location);
 
     if(debuglvl >= HIGH)
-    {
-        (void)vrprint.debug(__FUNC__, "at exit: ptr->file: %p (retval: %d).", ptr->file, retval);
         (void)vrprint.debug(__FUNC__, "** end **, retval=%d", retval);
-    }
 
     return(retval);
 }
-
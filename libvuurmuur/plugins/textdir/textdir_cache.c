@@ -0,0 +1,561 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "textdir_plugin.h"
+
+/*
+    The object cache
+
+    Every file is read once into a list of variable/value pairs, in the
+    order of the file. ask_textdir answers all questions from that list.
+    Before an entry is used we stat the file, and re-read it when it has
+    changed on disk. tell, del and rename drop entries themselves.
+*/
+
+/* number of rows in the hash table with the files */
+#define TEXTDIR_CACHE_ROWS  1021
+
+
+static unsigned int
+textdir_cache_hash(const void *data)
+{
+    const struct TextdirCacheFile_ *file_ptr = data;
+
+    return(hash_name(file_ptr->path));
+}
+
+
+static int
+textdir_cache_compare(const void *table_data, const void *search_data)
+{
+    const struct TextdirCacheFile_  *table_ptr = table_data,
+                                    *search_ptr = search_data;
+
+    return(strcmp(table_ptr->path, search_ptr->path) == 0);
+}
+
+
+static void
+textdir_cache_free_file(void *data)
+{
+    struct TextdirCacheFile_ *file_ptr = data;
+
+    if(file_ptr == NULL)
+        return;
+
+    d_list_cleanup(0, &file_ptr->vars);
+    free(file_ptr->path);
+    free(file_ptr);
+}
+
+
+/*  textdir_cache_parse_line
+
+    Gets the variable and value from a line, the same way ask_textdir
+    always did: comments and lines starting with whitespace are skipped,
+    quotes around the value are stripped.
+
+    Returncodes:
+         1: variable found
+         0: line skipped
+*/
+static int
+textdir_cache_parse_line(char *line, char *variable, size_t var_size, char *value, size_t val_size)
+{
+    char    *val = NULL;
+    size_t  var_len = 0,
+            line_pos = 0,
+            val_pos = 0;
+
+    /* first check if the line is a comment. */
+    if(line[0] == '#' || line[0] == ' ' || line[0] == '\0' ||
+       line[0] == '\n' || line[0] == '\t')
+        return(0);
+
+    /* look for the occurance of the = separator */
+    if((val = strchr(line, '=')) == NULL)
+        return(0);
+
+    /* val - line = var len */
+    var_len = val - line + 1;
+    if(var_len > (var_size - 1))
+        return(0);
+
+    strlcpy(variable, line, var_len);
+
+    /* skip pass the '=' char */
+    val++;
+
+    /* strip the leading quotes */
+    while(val[line_pos] == '\"')
+        line_pos++;
+
+    while(val[line_pos] != '\0' && val[line_pos] != '\n' && val_pos < val_size - 1)
+        value[val_pos++] = val[line_pos++];
+
+    /* if the last character is a '"' we strip it. */
+    if(val_pos > 0 && value[val_pos - 1] == '\"')
+        val_pos--;
+
+    value[val_pos] = '\0';
+    return(1);
+}
+
+
+/*  textdir_cache_parse
+
+    Reads the file into a new cache entry.
+
+    Returns the entry or NULL on error.
+*/
+static struct TextdirCacheFile_ *
+textdir_cache_parse(const int debuglvl, struct TextdirBackend_ *ptr, const char *file_location)
+{
+    struct TextdirCacheFile_    *file_ptr = NULL;
+    struct TextdirCacheVar_     *var_ptr = NULL;
+    FILE                        *fp = NULL;
+    char                        line[MAX_LINE_LENGTH] = "",
+                                variable[64] = "",
+                                value[MAX_LINE_LENGTH] = "";
+    size_t                      len = 0;
+
+    if(!(fp = vuurmuur_fopen(debuglvl, ptr->vuurmuur_config, file_location, "r")))
+    {
+        (void)vrprint.error(-1, "Error", "Unable to open file '%s'.", file_location);
+        return(NULL);
+    }
+
+    if(!(file_ptr = malloc(sizeof(struct TextdirCacheFile_))))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        fclose(fp);
+        return(NULL);
+    }
+    memset(file_ptr, 0, sizeof(struct TextdirCacheFile_));
+
+    /* stat after opening: vuurmuur_fopen may have fixed the mode */
+    if(fstat(fileno(fp), &file_ptr->st) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "stat '%s' failed: %s (in: %s:%d).",
+                file_location, strerror(errno), __FUNC__, __LINE__);
+        free(file_ptr);
+        fclose(fp);
+        return(NULL);
+    }
+
+    if(!(file_ptr->path = strdup(file_location)) ||
+       d_list_setup(debuglvl, &file_ptr->vars, free) < 0)
+    {
+        (void)vrprint.error(-1, "Error", "setting up cache entry failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        free(file_ptr->path);
+        free(file_ptr);
+        fclose(fp);
+        return(NULL);
+    }
+
+    while(fgets(line, (int)sizeof(line), fp) != NULL)
+    {
+        if(textdir_cache_parse_line(line, variable, sizeof(variable), value, sizeof(value)) == 0)
+            continue;
+
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "variable %s", variable);
+
+        len = strlen(value);
+        if(!(var_ptr = malloc(sizeof(struct TextdirCacheVar_) + len + 1)))
+        {
+            (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                    strerror(errno), __FUNC__, __LINE__);
+            textdir_cache_free_file(file_ptr);
+            fclose(fp);
+            return(NULL);
+        }
+        strlcpy(var_ptr->variable, variable, sizeof(var_ptr->variable));
+        memcpy(var_ptr->value, value, len + 1);
+
+        if(d_list_append(debuglvl, &file_ptr->vars, var_ptr) == NULL)
+        {
+            (void)vrprint.error(-1, "Internal Error", "d_list_append() failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            free(var_ptr);
+            textdir_cache_free_file(file_ptr);
+            fclose(fp);
+            return(NULL);
+        }
+    }
+
+    if(fclose(fp) != 0)
+    {
+        (void)vrprint.error(-1, "Error", "closing file '%s' failed: %s (in: %s).",
+                file_location, strerror(errno), __FUNC__);
+        textdir_cache_free_file(file_ptr);
+        return(NULL);
+    }
+
+    return(file_ptr);
+}
+
+
+int
+textdir_cache_setup(const int debuglvl, struct TextdirBackend_ *ptr)
+{
+    if(d_list_setup(debuglvl, &ptr->cache_list, textdir_cache_free_file) < 0)
+        return(-1);
+
+    if(hash_setup(debuglvl, &ptr->cache_hash, TEXTDIR_CACHE_ROWS,
+                textdir_cache_hash, textdir_cache_compare) < 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "hash_setup() failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    ptr->multi_file = NULL;
+    ptr->multi_node = NULL;
+    ptr->cache_open = 1;
+    return(0);
+}
+
+
+void
+textdir_cache_cleanup(const int debuglvl, struct TextdirBackend_ *ptr)
+{
+    if(ptr->cache_open == 0)
+        return;
+
+    (void)hash_cleanup(debuglvl, &ptr->cache_hash);
+    (void)d_list_cleanup(debuglvl, &ptr->cache_list);
+
+    ptr->multi_file = NULL;
+    ptr->multi_node = NULL;
+    ptr->cache_open = 0;
+}
+
+
+/*  textdir_cache_invalidate
+
+    Drops the entry for one file, or all entries if file_location is NULL.
+*/
+void
+textdir_cache_invalidate(const int debuglvl, struct TextdirBackend_ *ptr, const char *file_location)
+{
+    struct TextdirCacheFile_    search,
+                                *file_ptr = NULL;
+
+    if(ptr->cache_open == 0)
+        return;
+
+    if(file_location == NULL)
+    {
+        textdir_cache_cleanup(debuglvl, ptr);
+        (void)textdir_cache_setup(debuglvl, ptr);
+        return;
+    }
+
+    search.path = (char *)file_location;
+    if(!(file_ptr = hash_search(debuglvl, &ptr->cache_hash, &search)))
+        return;
+
+    if(ptr->multi_file == file_ptr)
+    {
+        ptr->multi_file = NULL;
+        ptr->multi_node = NULL;
+    }
+
+    (void)hash_remove(debuglvl, &ptr->cache_hash, file_ptr);
+    (void)d_list_remove_node(debuglvl, &ptr->cache_list, file_ptr->node);
+}
+
+
+/* add a freshly parsed entry to the cache. Frees it on error. */
+static struct TextdirCacheFile_ *
+textdir_cache_insert(const int debuglvl, struct TextdirBackend_ *ptr, struct TextdirCacheFile_ *file_ptr)
+{
+    if((file_ptr->node = d_list_append(debuglvl, &ptr->cache_list, file_ptr)) == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "d_list_append() failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        textdir_cache_free_file(file_ptr);
+        return(NULL);
+    }
+
+    if(hash_insert(debuglvl, &ptr->cache_hash, file_ptr) < 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "hash_insert() failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        (void)d_list_remove_bot(debuglvl, &ptr->cache_list);
+        return(NULL);
+    }
+
+    return(file_ptr);
+}
+
+
+/*  textdir_cache_get
+
+    Returns the (up to date) cache entry for the file, parsing it if
+    needed. NULL on error.
+*/
+struct TextdirCacheFile_ *
+textdir_cache_get(const int debuglvl, struct TextdirBackend_ *ptr, const char *file_location)
+{
+    struct TextdirCacheFile_    search,
+                                *file_ptr = NULL;
+    struct stat                 st;
+
+    if(ptr->cache_open == 0 && textdir_cache_setup(debuglvl, ptr) < 0)
+        return(NULL);
+
+    search.path = (char *)file_location;
+    file_ptr = hash_search(debuglvl, &ptr->cache_hash, &search);
+
+    if(stat(file_location, &st) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "Unable to open file '%s': %s.",
+                file_location, strerror(errno));
+
+        if(file_ptr != NULL)
+            textdir_cache_invalidate(debuglvl, ptr, file_location);
+
+        return(NULL);
+    }
+
+    if(file_ptr != NULL)
+    {
+        if(stat_changed(&file_ptr->st, &st) == 0)
+            return(file_ptr);
+
+        if(debuglvl >= MEDIUM)
+            (void)vrprint.debug(__FUNC__, "'%s' changed, reading it again.", file_location);
+
+        textdir_cache_invalidate(debuglvl, ptr, file_location);
+    }
+
+    if(!(file_ptr = textdir_cache_parse(debuglvl, ptr, file_location)))
+        return(NULL);
+
+    return(textdir_cache_insert(debuglvl, ptr, file_ptr));
+}
+
+
+/* one object of bulk_textdir */
+struct TextdirBulkItem_
+{
+    char                        name[MAX_HOST_NET_ZONE];
+    int                         zonetype;
+    char                        *file_location;
+
+    /* read by the prefetch, not in the cache yet */
+    struct TextdirCacheFile_    *parsed;
+    char                        failed;
+};
+
+struct TextdirBulk_
+{
+    struct TextdirBackend_      *ptr;
+    struct TextdirBulkItem_     *items;
+};
+
+
+/*  bulk_textdir_prefetch
+
+    Reads the file of one object if it is not in the cache yet. Runs on
+    several threads at once, so it only looks at the cache, the changes
+    are made by bulk_textdir afterwards.
+*/
+static int
+bulk_textdir_prefetch(const int debuglvl, void *ctx, unsigned int i)
+{
+    struct TextdirBulk_         *bulk = ctx;
+    struct TextdirBulkItem_     *item = &bulk->items[i];
+    struct TextdirCacheFile_    search,
+                                *file_ptr = NULL;
+    struct stat                 st;
+
+    if(item->file_location == NULL)
+        return(0);
+
+    /* let textdir_cache_get report this */
+    if(stat(item->file_location, &st) == -1)
+        return(0);
+
+    search.path = item->file_location;
+    file_ptr = hash_search(debuglvl, &bulk->ptr->cache_hash, &search);
+    if(file_ptr != NULL && stat_changed(&file_ptr->st, &st) == 0)
+        return(0);
+
+    if(!(item->parsed = textdir_cache_parse(debuglvl, bulk->ptr, item->file_location)))
+        item->failed = TRUE;
+
+    return(0);
+}
+
+
+/*  bulk_textdir
+
+    Lists all objects of category 'type' and hands every object with
+    the variables from its cache entry to 'cb'. If the file can't be
+    read, 'cb' gets no variables, so the object is read with ask_textdir,
+    which reports the problem like before.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+bulk_textdir(int debuglvl, void *backend, int type,
+        int (*cb)(int debuglvl, void *ctx, char *name, int zonetype, struct BackendBulkVar_ *vars, unsigned int nvars),
+        void *ctx)
+{
+    struct TextdirBackend_      *ptr = NULL;
+    struct TextdirCacheFile_    *file_ptr = NULL;
+    struct TextdirCacheVar_     *var_ptr = NULL;
+    struct BackendBulkVar_      *vars = NULL,
+                                *new_vars = NULL;
+    struct TextdirBulkItem_     *item = NULL,
+                                *new_items = NULL;
+    struct TextdirBulk_         bulk;
+    ParallelJob                 job;
+    unsigned int                nvars = 0,
+                                size = 0,
+                                n = 0,
+                                n_alloc = 0,
+                                i = 0;
+    d_list_node                 *d_node = NULL;
+    char                        name[MAX_HOST_NET_ZONE] = "";
+    int                         zonetype = 0,
+                                retval = 0;
+
+    /* safety */
+    if(!(ptr = (struct TextdirBackend_ *)backend) || cb == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+            "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(ptr->cache_open == 0 && textdir_cache_setup(debuglvl, ptr) < 0)
+        return(-1);
+
+    memset(&bulk, 0, sizeof(bulk));
+    bulk.ptr = ptr;
+    memset(&job, 0, sizeof(job));
+
+    /* first list everything */
+    while(list_textdir(debuglvl, backend, name, &zonetype, type) != NULL)
+    {
+        if(n == n_alloc)
+        {
+            n_alloc = n_alloc ? n_alloc * 2 : 64;
+            if(!(new_items = realloc(bulk.items, n_alloc * sizeof(struct TextdirBulkItem_))))
+            {
+                (void)vrprint.error(-1, "Error", "realloc failed: %s (in: %s:%d).",
+                        strerror(errno), __FUNC__, __LINE__);
+                retval = -1;
+                break;
+            }
+            bulk.items = new_items;
+        }
+
+        item = &bulk.items[n++];
+        memset(item, 0, sizeof(struct TextdirBulkItem_));
+        (void)strlcpy(item->name, name, sizeof(item->name));
+        item->zonetype = zonetype;
+        item->file_location = get_filelocation(debuglvl, backend, name, zonetype);
+    }
+
+    /* read the files that are not in the cache on all cpu's */
+    if(retval == 0 && parallel_setup(debuglvl, &job, n, bulk_textdir_prefetch, &bulk) == 0)
+    {
+        (void)parallel_run(debuglvl, &job, NULL);
+    }
+    else
+    {
+        retval = -1;
+    }
+
+    /* and hand them over in the order of the list */
+    for(i = 0; retval == 0 && i < n; i++)
+    {
+        item = &bulk.items[i];
+        nvars = 0;
+        file_ptr = NULL;
+
+        parallel_replay(debuglvl, &job, i);
+
+        if(item->parsed != NULL)
+        {
+            textdir_cache_invalidate(debuglvl, ptr, item->file_location);
+            file_ptr = textdir_cache_insert(debuglvl, ptr, item->parsed);
+            item->parsed = NULL;
+        }
+        else if(item->file_location != NULL && item->failed == FALSE)
+        {
+            file_ptr = textdir_cache_get(debuglvl, ptr, item->file_location);
+        }
+
+        if(file_ptr != NULL)
+        {
+            /* always have an array, also for empty files */
+            if(file_ptr->vars.len + 1 > size)
+            {
+                if(!(new_vars = realloc(vars, (file_ptr->vars.len + 1) * sizeof(struct BackendBulkVar_))))
+                {
+                    (void)vrprint.error(-1, "Error", "realloc failed: %s (in: %s:%d).",
+                            strerror(errno), __FUNC__, __LINE__);
+                    retval = -1;
+                    break;
+                }
+                vars = new_vars;
+                size = file_ptr->vars.len + 1;
+            }
+
+            for(d_node = file_ptr->vars.top; d_node; d_node = d_node->next)
+            {
+                var_ptr = d_node->data;
+
+                vars[nvars].variable = var_ptr->variable;
+                vars[nvars].value = var_ptr->value;
+                nvars++;
+            }
+        }
+
+        if(cb(debuglvl, ctx, item->name, item->zonetype, file_ptr ? vars : NULL, nvars) < 0)
+        {
+            retval = -1;
+            break;
+        }
+    }
+
+    if(job.msgs != NULL)
+        parallel_cleanup(debuglvl, &job);
+
+    for(i = 0; i < n; i++)
+    {
+        free(bulk.items[i].file_location);
+        if(bulk.items[i].parsed != NULL)
+            textdir_cache_free_file(bulk.items[i].parsed);
+    }
+    free(bulk.items);
+    free(vars);
+    return(retval);
+}
@@ -478,6 +478,13 @@ close_textdir(int debuglvl, void *backend, int type)
         ptr->backend_open = 0;
     }
 
+    /* a transaction that was not ended is dropped */
+    if(ptr->tell_file != NULL)
+        (void)tell_end_textdir(debuglvl, ptr, 0);
+
+    /* drop the object cache */
+    textdir_cache_cleanup(debuglvl, ptr);
+
     /* cleanup regex */
     if(type == CAT_ZONES && ptr->zonename_reg != NULL)
     {
@@ -860,6 +867,9 @@ del_textdir(const int debuglvl, void *backend, char *name, int type, int recurs)
         return(-1);
     }
 
+    /* files will disappear or move, so drop the cache */
+    textdir_cache_invalidate(debuglvl, ptr, NULL);
+
     /* determine the location of the file */
     if(!(file_location = get_filelocation(debuglvl, backend, name, type)))
         return(-1);
@@ -1114,6 +1124,9 @@ rename_textdir(const int debuglvl, void *backend, char *name, char *newname, int
         return(-1);
     }
 
+    /* files will disappear or move, so drop the cache */
+    textdir_cache_invalidate(debuglvl, ptr, NULL);
+
     /* first see if the name and newname are the same */
     if(strcmp(name, newname) == 0)
         return(0);
@@ -1346,7 +1359,10 @@ setup_textdir(int debuglvl, const struct vuurmuur_config *vuurmuur_config, void
     ptr->interface_p = NULL;
     ptr->rule_p = NULL;
 
-    ptr->file = NULL;
+    ptr->cache_open = 0;
+    ptr->multi_file = NULL;
+    ptr->multi_node = NULL;
+    ptr->tell_file = NULL;
 
     ptr->zonename_reg = NULL;
     ptr->servicename_reg = NULL;
@@ -1361,6 +1377,124 @@ setup_textdir(int debuglvl, const struct vuurmuur_config *vuurmuur_config, void
 }
 
 
+/* newest mtime/ctime of 'path' and, if it is a dir, everything below it */
+static int
+stamp_textdir_walk(const int debuglvl, const char *path, struct timespec *ts)
+{
+    struct stat     st;
+    DIR             *dir = NULL;
+    struct dirent   *entry = NULL;
+    char            sub_location[512] = "";
+    int             retval = 0;
+
+    if(lstat(path, &st) == -1)
+    {
+        /* removed while we were looking, the parent dir changed then */
+        if(errno == ENOENT)
+            return(0);
+
+        (void)vrprint.error(-1, "Error", "stat '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(st.st_mtim.tv_sec > ts->tv_sec ||
+       (st.st_mtim.tv_sec == ts->tv_sec && st.st_mtim.tv_nsec > ts->tv_nsec))
+        *ts = st.st_mtim;
+    if(st.st_ctim.tv_sec > ts->tv_sec ||
+       (st.st_ctim.tv_sec == ts->tv_sec && st.st_ctim.tv_nsec > ts->tv_nsec))
+        *ts = st.st_ctim;
+
+    if(!S_ISDIR(st.st_mode))
+        return(0);
+
+    if(!(dir = opendir(path)))
+    {
+        (void)vrprint.error(-1, "Error", "opening '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    while(retval == 0 && (entry = readdir(dir)) != NULL)
+    {
+        if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        if(snprintf(sub_location, sizeof(sub_location), "%s/%s", path, entry->d_name) >= (int)sizeof(sub_location))
+        {
+            (void)vrprint.error(-1, "Error", "buffer overflow (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            retval = -1;
+            break;
+        }
+
+        retval = stamp_textdir_walk(debuglvl, sub_location, ts);
+    }
+
+    (void)closedir(dir);
+    return(retval);
+}
+
+
+/*  stamp_textdir
+
+    Gets the time of the newest change in the directory of category
+    'type': the newest mtime or ctime of the dir and all files and
+    dirs below it. Hand edits, added and removed files all show up.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+stamp_textdir(int debuglvl, void *backend, int type, struct timespec *ts)
+{
+    struct TextdirBackend_  *ptr = NULL;
+    char                    dir_location[512] = "";
+    const char              *subdir = NULL;
+
+    if(!(ptr = (struct TextdirBackend_ *)backend) || ts == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    switch(type)
+    {
+        case CAT_ZONES:
+            subdir = "zones";
+            break;
+        case CAT_SERVICES:
+            subdir = "services";
+            break;
+        case CAT_INTERFACES:
+            subdir = "interfaces";
+            break;
+        case CAT_RULES:
+            subdir = "rules";
+            break;
+        default:
+            (void)vrprint.error(-1, "Internal Error", "unknown type %d (in: %s:%d).",
+                    type, __FUNC__, __LINE__);
+            return(-1);
+    }
+
+    if(snprintf(dir_location, sizeof(dir_location), "%s/%s", ptr->textdirlocation, subdir) >= (int)sizeof(dir_location))
+    {
+        (void)vrprint.error(-1, "Error", "buffer overflow (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    ts->tv_sec = 0;
+    ts->tv_nsec = 0;
+
+    return(stamp_textdir_walk(debuglvl, dir_location, ts));
+}
+
+
+
 void __attribute__ ((constructor)) 
 textdir_init(void)
 {
@@ -1375,6 +1509,10 @@ textdir_init(void)
     BackendFunctions.rename = rename_textdir;
     BackendFunctions.conf = conf_textdir;
     BackendFunctions.setup = setup_textdir;
+    BackendFunctions.bulk = bulk_textdir;
+    BackendFunctions.tell_begin = tell_begin_textdir;
+    BackendFunctions.tell_end = tell_end_textdir;
+    BackendFunctions.stamp = stamp_textdir;
 
     /* set the version */
     BackendFunctions.version = LIBVUURMUUR_VERSION;
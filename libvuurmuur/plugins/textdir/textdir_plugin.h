@@ -31,6 +31,28 @@
 
 #define MAX_RULE_NAME   32
 
+/* a variable from a file with its value */
+struct TextdirCacheVar_
+{
+    char    variable[64];
+    char    value[];
+};
+
+/* a parsed file in the object cache */
+struct TextdirCacheFile_
+{
+    char        *path;
+
+    /* to see if the file changed on disk */
+    struct stat st;
+
+    /* list of TextdirCacheVar_'s in file order */
+    d_list      vars;
+
+    /* our node in the cache_list */
+    d_list_node *node;
+};
+
 struct TextdirBackend_
 {
     /* 0: if backend is closed, 1: open */
@@ -50,7 +72,20 @@ struct TextdirBackend_
 
     DIR     *rule_p;
 
-    FILE    *file;
+    /* object cache: parsed files by path */
+    int     cache_open;
+    d_list  cache_list;
+    Hash    cache_hash;
+
+    /* where we are in a 'multi' question */
+    struct TextdirCacheFile_    *multi_file;
+    d_list_node                 *multi_node;
+    char                        multi_question[64];
+
+    /* open tell transaction: the lines of 'tell_file' are changed in
+       memory until tell_end_textdir() writes them out at once */
+    char                        *tell_file;
+    d_list                      tell_lines;
 
     char    cur_zone[MAX_ZONE],
             cur_network[MAX_NETWORK],
@@ -78,6 +113,8 @@ struct TextdirBackend_
 char *get_filelocation(const int debuglvl, void *backend, char *name, const int type);
 int ask_textdir(const int debuglvl, void *backend, char *name, char *question, char *answer, size_t max_answer, int type, int multi);
 int tell_textdir(const int debuglvl, void *backend, char *name, char *question, char *answer, int overwrite, int type);
+int tell_begin_textdir(int debuglvl, void *backend, char *name, int type);
+int tell_end_textdir(int debuglvl, void *backend, int commit);
 int open_textdir(int debuglvl, void *backend, int mode, int type);
 int close_textdir(int debuglvl, void *backend, int type);
 char *list_textdir(int debuglvl, void *backend, char *name, int *zonetype, int type);
@@ -87,5 +124,12 @@ int del_textdir(const int debuglvl, void *backend, char *name, int type, int rec
 int rename_textdir(const int debuglvl, void *backend, char *name, char *newname, int type);
 int conf_textdir(const int debuglvl, void *backend);
 int setup_textdir(int debuglvl, const struct vuurmuur_config *vuurmuur_config, void **backend);
+int stamp_textdir(int debuglvl, void *backend, int type, struct timespec *ts);
+
+int textdir_cache_setup(const int debuglvl, struct TextdirBackend_ *ptr);
+void textdir_cache_cleanup(const int debuglvl, struct TextdirBackend_ *ptr);
+void textdir_cache_invalidate(const int debuglvl, struct TextdirBackend_ *ptr, const char *file_location);
+struct TextdirCacheFile_ *textdir_cache_get(const int debuglvl, struct TextdirBackend_ *ptr, const char *file_location);
+int bulk_textdir(int debuglvl, void *backend, int type, int (*cb)(int debuglvl, void *ctx, char *name, int zonetype, struct BackendBulkVar_ *vars, unsigned int nvars), void *ctx);
 
 #endif
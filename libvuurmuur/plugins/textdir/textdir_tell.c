@@ -21,340 +21,443 @@
 #include "textdir_plugin.h"
 
 /*
+    Telling to the backend
+
+    A file is read into a list of lines, the variable is changed in the
+    list and the list is written to a temp file that is synced and renamed
+    over the old file, so a crash never leaves a half-written file.
+
+    To change many values of one object (e.g. all members of a group), the
+    caller can open a transaction with tell_begin_textdir(). All tells for
+    that object then only change the list in memory, and
+    tell_end_textdir() writes the file once. Only one transaction per
+    backend can be open, and asking the object during it returns the old
+    values.
+*/
+
+
+/*  tell_read_lines
 
+    Reads the file into the list 'lines'.
+
+    Returncodes:
+         0: ok
+        -1: error
 */
-int
-tell_textdir(const int debuglvl, void *backend, char *name, char *question, char *answer, int overwrite, int type)
+static int
+tell_read_lines(const int debuglvl, struct TextdirBackend_ *ptr, char *file_location, d_list *lines)
 {
-    int                     retval=0;
-    char                    *file_location = NULL;
-    char                    line[512] = "",
-                            *line_ptr = NULL,
-                            *tmp_line_ptr = NULL;
-    int                     i=0,
-                            found = 0,
-                            skip = 0;
-    int                     delta = 'a' - 'A';
-    FILE                    *fp = NULL;
-    struct TextdirBackend_  *ptr = NULL;
-    d_list                  storelist;
-    d_list_node             *d_node = NULL;
+    FILE    *fp = NULL;
+    char    line[MAX_LINE_LENGTH] = "",
+            *line_ptr = NULL;
 
-    /*
-        safety
-    */
-    if(!backend || !name || !question || !answer)
+    if(d_list_setup(debuglvl, lines, free) < 0)
+        return(-1);
+
+    if(!(fp = vuurmuur_fopen(debuglvl, ptr->vuurmuur_config, file_location, "r")))
     {
-        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s).", __FUNC__);
+        (void)vrprint.error(-1, "Error", "unable to open file '%s' for reading: %s.", file_location, strerror(errno));
+        (void)d_list_cleanup(debuglvl, lines);
         return(-1);
     }
 
-    if(debuglvl >= HIGH)
-        (void)vrprint.debug(__FUNC__, "question: %s, answer: %s, name: %s, overwrite: %d, type: %d", question, answer, name, overwrite, type);
+    while(fgets(line, (int)sizeof(line), fp) != NULL)
+    {
+        if(!(line_ptr = strdup(line)))
+        {
+            (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+            (void)d_list_cleanup(debuglvl, lines);
+            (void)fclose(fp);
+            return(-1);
+        }
 
-    if(!(ptr = (struct TextdirBackend_ *)backend))
+        if(d_list_append(debuglvl, lines, line_ptr) == NULL)
+        {
+            (void)vrprint.error(-1, "Internal Error", "inserting line into temporary storage list failed (in: %s:%d).", __FUNC__, __LINE__);
+            free(line_ptr);
+            (void)d_list_cleanup(debuglvl, lines);
+            (void)fclose(fp);
+            return(-1);
+        }
+    }
+
+    if(fclose(fp) < 0)
     {
-        (void)vrprint.error(-1, "Internal Error", "backend parameter problem (in: %s).", __FUNC__);
+        (void)vrprint.error(-1, "Error", "closing file '%s' failed: %s.", file_location, strerror(errno));
+        (void)d_list_cleanup(debuglvl, lines);
         return(-1);
     }
-    
-    /*
-        check if backend is open
-    */
-    if(!ptr->backend_open)
+
+    return(0);
+}
+
+
+/*  tell_edit_lines
+
+    Sets question to answer in the list. With overwrite all lines of
+    question are replaced by one line, otherwise the new line is inserted
+    after the last line of question, or at the end of the list.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+tell_edit_lines(const int debuglvl, d_list *lines, char *question, char *answer, int overwrite)
+{
+    char        line[MAX_LINE_LENGTH] = "",
+                *line_ptr = NULL;
+    size_t      qlen = strlen(question);
+    d_list_node *d_node = NULL,
+                *next_node = NULL,
+                *last_node = NULL;
+    int         found = 0;
+
+    snprintf(line, sizeof(line), "%s=\"%s\"\n", question, answer);
+
+    for(d_node = lines->top; d_node; d_node = next_node)
     {
-        (void)vrprint.error(-1, "Error", "backend not opened yet (in: %s).", __FUNC__);
+        next_node = d_node->next;
+        line_ptr = d_node->data;
+
+        /* make sure we don't match BW_IN on BW_IN_UNIT */
+        if(strncmp(question, line_ptr, qlen) != 0 || line_ptr[qlen] != '=')
+            continue;
+
+        if(overwrite && !found)
+        {
+            /* replace the first one */
+            if(!(line_ptr = strdup(line)))
+            {
+                (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+                return(-1);
+            }
+            free(d_node->data);
+            d_node->data = line_ptr;
+        }
+        else if(overwrite)
+        {
+            /* and remove the others */
+            if(d_list_remove_node(debuglvl, lines, d_node) < 0)
+                return(-1);
+            continue;
+        }
+
+        found = 1;
+        last_node = d_node;
+    }
+
+    if(overwrite && found)
+        return(0);
+
+    if(!(line_ptr = strdup(line)))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
         return(-1);
     }
 
-    /*
-        convert question to uppercase
-    */
-    while(question[i])
+    /* insert just below the last one, or at the end of the list if
+       last_node is NULL */
+    if(d_list_insert_after(debuglvl, lines, last_node, line_ptr) == NULL)
     {
-        if((question[i] >= 'a') && (question[i] <= 'z')) question[i] -= delta;
-        ++i;
+        (void)vrprint.error(-1, "Internal Error", "inserting line into temporary storage list failed (in: %s:%d).", __FUNC__, __LINE__);
+        free(line_ptr);
+        return(-1);
     }
 
-    /*
-        determine the location of the file
-    */
-    if(!(file_location = get_filelocation(debuglvl, backend, name, type)))
+    return(0);
+}
+
+
+/*  tell_write_lines
+
+    Writes the list to a temp file next to file_location, syncs it and
+    renames it over file_location. The mode of the old file is kept.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+tell_write_lines(const int debuglvl, struct TextdirBackend_ *ptr, char *file_location, d_list *lines)
+{
+    char        tmp_location[512] = "",
+                dir_location[512] = "",
+                *slash = NULL;
+    int         fd = -1,
+                dir_fd = -1;
+    FILE        *fp = NULL;
+    struct stat st;
+    d_list_node *d_node = NULL;
+
+    if(stat(file_location, &st) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "stat on '%s' failed: %s (in: %s:%d).", file_location, strerror(errno), __FUNC__, __LINE__);
         return(-1);
+    }
 
-    /*
-        first open the file for reading
-    */
-    if(!(fp = vuurmuur_fopen(debuglvl, ptr->vuurmuur_config, file_location, "r")))
+    if(snprintf(tmp_location, sizeof(tmp_location), "%s.XXXXXX", file_location) >= (int)sizeof(tmp_location))
     {
-        (void)vrprint.error(-1, "Error", "unable to open file '%s' for reading: %s.", file_location, strerror(errno));
+        (void)vrprint.error(-1, "Internal Error", "buffer overflow (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
 
-        free(file_location);
+    if((fd = mkstemp(tmp_location)) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "creating temp file for '%s' failed: %s (in: %s:%d).", file_location, strerror(errno), __FUNC__, __LINE__);
         return(-1);
     }
+    (void)fchmod(fd, st.st_mode & (S_IRWXU|S_IRWXG|S_IRWXO));
 
-    /*
-        initialize the store list
-    */
-    if(d_list_setup(debuglvl, &storelist, free) < 0)
+    if(!(fp = fdopen(fd, "w")))
     {
-        free(file_location);
-        fclose(fp);
+        (void)vrprint.error(-1, "Error", "unable to open file '%s' for writing: %s (in: %s:%d).", tmp_location, strerror(errno), __FUNC__, __LINE__);
+        (void)close(fd);
+        (void)unlink(tmp_location);
         return(-1);
     }
 
-    /*
-        loop trough the current file
-    */
-    while(fgets(line, MAX_LINE_LENGTH, fp) != NULL)
+    for(d_node = lines->top; d_node; d_node = d_node->next)
     {
-        if(!(line_ptr = malloc(sizeof(line))))
-        {
-            (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s).", strerror(errno), __FUNC__);
+        fprintf(fp, "%s", (char *)d_node->data);
+    }
 
-            /* cleanup */
-            d_list_cleanup(debuglvl, &storelist);
-            free(file_location);
-            fclose(fp);
+    if(fflush(fp) != 0 || fsync(fd) == -1 || ferror(fp))
+    {
+        (void)vrprint.error(-1, "Error", "writing file '%s' failed: %s.", tmp_location, strerror(errno));
+        (void)fclose(fp);
+        (void)unlink(tmp_location);
+        return(-1);
+    }
 
-            return(-1);
-        }
+    if(fclose(fp) < 0)
+    {
+        (void)vrprint.error(-1, "Error", "closing file '%s' failed: %s.", tmp_location, strerror(errno));
+        (void)unlink(tmp_location);
+        return(-1);
+    }
+
+    if(rename(tmp_location, file_location) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "renaming '%s' to '%s' failed: %s.", tmp_location, file_location, strerror(errno));
+        (void)unlink(tmp_location);
+        return(-1);
+    }
 
-        /*
-            compare the line
+    /* sync the directory so the rename itself is on disk as well */
+    (void)strlcpy(dir_location, file_location, sizeof(dir_location));
+    if((slash = strrchr(dir_location, '/')) != NULL)
+    {
+        *slash = '\0';
 
-            make sure we don't match BW_IN on BW_IN_UNIT
-            XXX: redo this one day
-        */
-        if(strncmp(question, line, strlen(question)) == 0 && line[strlen(question)] == '=')
+        if((dir_fd = open(dir_location[0] ? dir_location : "/", O_RDONLY)) != -1)
         {
-            if(overwrite && !found)
-            {
-//TODO
-                snprintf(line_ptr, sizeof(line), "%s=\"%s\"\n", question, answer);
-                
-                found = 1;
-            }
-            else if(overwrite && found)
-            {
-                skip = 1;
-            }
-            else
-            {
-                if(strlcpy(line_ptr, line, sizeof(line)) >= sizeof(line))
-                {
-                    (void)vrprint.error(-1, "Error", "buffer overflow (in: %s:%d).", __FUNC__, __LINE__);
-
-                    /* cleanup */
-                    d_list_cleanup(debuglvl, &storelist);
-                    free(line_ptr);
-                    free(file_location);
-                    fclose(fp);
-                    return(-1);
-                }
-
-                found = 1;
-            }
+            (void)fsync(dir_fd);
+            (void)close(dir_fd);
         }
-        else
-        {
-            if(strlcpy(line_ptr, line, sizeof(line)) >= sizeof(line))
-            {
-                (void)vrprint.error(-1, "Error", "buffer overflow (in: %s:%d).", __FUNC__, __LINE__);
+    }
 
-                /* cleanup */
-                d_list_cleanup(debuglvl, &storelist);
-                free(line_ptr);
-                free(file_location);
-                fclose(fp);
-                return(-1);
-            }
-        }
+    /* the cached copy is outdated now */
+    textdir_cache_invalidate(debuglvl, ptr, file_location);
+    return(0);
+}
 
-        /*
-            now append the line to the storelist, except if we were told to skip this one. Then just free the data.
-        */
-        if(!skip)
-        {
-            if(d_list_append(debuglvl, &storelist, line_ptr) == NULL)
-            {
-                (void)vrprint.error(-1, "Internal Error", "inserting line into temporary storage list failed (in: %s).", __FUNC__);
 
-                /* cleanup */
-                d_list_cleanup(debuglvl, &storelist);
-                free(line_ptr);
-                free(file_location);
-                fclose(fp);
-                return(-1);
-            }
+/*  tell_check
 
-            /* we dont need this anymore */
-            line_ptr = NULL;
-        }
-        else
-        {
-            /* free and null */
-            free(line_ptr);
-            line_ptr = NULL;
+    Common checks for the tell functions.
 
-            skip = 0;
-        }
+    Returncodes:
+        pointer to the backend
+        NULL on error
+*/
+static struct TextdirBackend_ *
+tell_check(void *backend)
+{
+    struct TextdirBackend_  *ptr = NULL;
+
+    if(!(ptr = (struct TextdirBackend_ *)backend))
+    {
+        (void)vrprint.error(-1, "Internal Error", "backend parameter problem (in: %s).", __FUNC__);
+        return(NULL);
     }
 
-    /*
-        if we are not overwriting and the type of data is already found somewhere, we try to insert is just below
-        the last one.
-    */
-    if(!overwrite && found)
+    /* check if backend is open */
+    if(!ptr->backend_open)
     {
-        if(!(line_ptr = malloc(sizeof(line))))
-        {
-            (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s).", strerror(errno), __FUNC__);
+        (void)vrprint.error(-1, "Error", "backend not opened yet (in: %s).", __FUNC__);
+        return(NULL);
+    }
 
-            /* cleanup */
-            d_list_cleanup(debuglvl, &storelist);
-            free(file_location);
-            fclose(fp);
-            return(-1);
-        }
-        
-        /* assemble the line */
-//TODO
-        snprintf(line_ptr, sizeof(line), "%s=\"%s\"\n", question, answer);
-        
-        /*
-            loop the list bottom up so we match the last one first
-        */
-        for(d_node = storelist.bot; d_node; d_node = d_node->prev)
-        {
-            if(!(tmp_line_ptr = d_node->data))
-            {
-                (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s)", __FUNC__);
+    return(ptr);
+}
 
-                /* cleanup */
-                d_list_cleanup(debuglvl, &storelist);
-                free(file_location);
-                free(line_ptr);
-                fclose(fp);
-                return(-1);
-            }
 
-            /*
-                check if the line is the same. If so insert after it.
-            */
-            if(strncmp(question, tmp_line_ptr, strlen(question)) == 0)
-            {
-                if(d_list_insert_after(debuglvl, &storelist, d_node, line_ptr) < 0)
-                {
-                    (void)vrprint.error(-1, "Internal Error", "inserting line into temporary storage list failed (in: %s).", __FUNC__);
-                    
-                    /* cleanup */
-                    d_list_cleanup(debuglvl, &storelist);
-                    free(file_location);
-                    free(line_ptr);
-                    fclose(fp);
-                    return(-1);
-                }
-                
-                /* we no longer need these */
-                tmp_line_ptr = NULL;
-                line_ptr = NULL;
-                
-                /* after inserting we're done */
-                break;
-                
-            }
-        }
-    }
-    
-    /*
-        if its not found, we insert it at the end of the list
-    */
-    if(found == 0)
+/*  tell_begin_textdir
+
+    Opens a transaction for object 'name': the next tells for it are kept
+    in memory until tell_end_textdir().
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+tell_begin_textdir(int debuglvl, void *backend, char *name, int type)
+{
+    struct TextdirBackend_  *ptr = NULL;
+    char                    *file_location = NULL;
+
+    if(!backend || !name)
     {
-        /* first alloc */
-        if(!(line_ptr = malloc(sizeof(line))))
-        {
-            (void)vrprint.error(-1, "Error", "malloc failed: %s.", strerror(errno));
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
 
-            /* cleanup */
-            d_list_cleanup(debuglvl, &storelist);
-            free(file_location);
-            fclose(fp);
-            return(-1);
-        }
+    if(!(ptr = tell_check(backend)))
+        return(-1);
 
-        /* assemble the line */
-//TODO
-        snprintf(line_ptr, sizeof(line), "%s=\"%s\"\n", question, answer);
+    if(ptr->tell_file != NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "transaction for '%s' still open (in: %s:%d).",
+                ptr->tell_file, __FUNC__, __LINE__);
+        return(-1);
+    }
 
-        /* append into the list */
-        if(d_list_append(debuglvl, &storelist, line_ptr) == NULL)
-        {
-            (void)vrprint.error(-1, "Internal Error", "inserting line into temporary storage list failed (in: %s).", __FUNC__);
+    if(!(file_location = get_filelocation(debuglvl, backend, name, type)))
+        return(-1);
 
-            /* cleanup */
-            d_list_cleanup(debuglvl, &storelist);
-            free(file_location);
-            free(line_ptr);
-            fclose(fp);
-            return(-1);
-        }
-        
-        /* we no longer need this */
-        line_ptr = NULL;
+    if(tell_read_lines(debuglvl, ptr, file_location, &ptr->tell_lines) < 0)
+    {
+        free(file_location);
+        return(-1);
     }
 
-    /*
-        close the file
-    */
-    if(fclose(fp) < 0)
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "transaction for '%s' opened.", file_location);
+
+    ptr->tell_file = file_location;
+    return(0);
+}
+
+
+/*  tell_end_textdir
+
+    Closes the transaction. If commit is 1 the file is written, otherwise
+    the changes are dropped.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+tell_end_textdir(int debuglvl, void *backend, int commit)
+{
+    struct TextdirBackend_  *ptr = NULL;
+    int                     retval = 0;
+
+    if(!(ptr = (struct TextdirBackend_ *)backend))
     {
-        (void)vrprint.error(-1, "Error", "closing file '%s' failed: %s.", file_location, strerror(errno));
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
 
-        /* cleanup */
-        d_list_cleanup(debuglvl, &storelist);
-        free(file_location);
+    if(ptr->tell_file == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "no transaction open (in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
     }
 
+    if(commit == 1)
+        retval = tell_write_lines(debuglvl, ptr, ptr->tell_file, &ptr->tell_lines);
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "transaction for '%s' %s.", ptr->tell_file,
+                commit == 1 ? "committed" : "dropped");
+
+    (void)d_list_cleanup(debuglvl, &ptr->tell_lines);
+    free(ptr->tell_file);
+    ptr->tell_file = NULL;
+
+    return(retval);
+}
+
+
+/*  tell_textdir
+
+    Sets 'question' to 'answer' for object 'name'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+tell_textdir(const int debuglvl, void *backend, char *name, char *question, char *answer, int overwrite, int type)
+{
+    int                     retval = 0;
+    char                    *file_location = NULL;
+    int                     i = 0;
+    int                     delta = 'a' - 'A';
+    struct TextdirBackend_  *ptr = NULL;
+    d_list                  storelist;
+
     /*
-        now open the file for writing
+        safety
     */
-    if(!(fp = vuurmuur_fopen(debuglvl, ptr->vuurmuur_config, file_location, "w+")))
+    if(!backend || !name || !question || !answer)
     {
-        (void)vrprint.error(-1, "Error", "unable to open file '%s' for writing: %s (in: %s).", file_location, strerror(errno), __FUNC__);
-        
-        /* cleanup */
-        d_list_cleanup(debuglvl, &storelist);
-        free(file_location);
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s).", __FUNC__);
         return(-1);
     }
-    
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "question: %s, answer: %s, name: %s, overwrite: %d, type: %d", question, answer, name, overwrite, type);
+
+    if(!(ptr = tell_check(backend)))
+        return(-1);
+
     /*
-        print the list into the file
+        convert question to uppercase
     */
-    for(d_node = storelist.top; d_node; d_node = d_node->next)
+    while(question[i])
     {
-        fprintf(fp, "%s", (char *)d_node->data);
+        if((question[i] >= 'a') && (question[i] <= 'z')) question[i] -= delta;
+        ++i;
     }
 
-    if(fclose(fp) < 0)
+    /*
+        determine the location of the file
+    */
+    if(!(file_location = get_filelocation(debuglvl, backend, name, type)))
+        return(-1);
+
+    /*
+        in a transaction for this file we only change the lines in memory
+    */
+    if(ptr->tell_file != NULL && strcmp(ptr->tell_file, file_location) == 0)
     {
-        (void)vrprint.error(-1, "Error", "closing file '%s' failed: %s.", file_location, strerror(errno));
+        retval = tell_edit_lines(debuglvl, &ptr->tell_lines, question, answer, overwrite);
+        free(file_location);
+        return(retval);
+    }
 
-        /* cleanup */
-        d_list_cleanup(debuglvl, &storelist);
+    if(tell_read_lines(debuglvl, ptr, file_location, &storelist) < 0)
+    {
         free(file_location);
         return(-1);
     }
 
+    if(tell_edit_lines(debuglvl, &storelist, question, answer, overwrite) < 0 ||
+       tell_write_lines(debuglvl, ptr, file_location, &storelist) < 0)
+    {
+        retval = -1;
+    }
+
     /*
         destroy the temp storage
     */
-    d_list_cleanup(debuglvl, &storelist);
+    (void)d_list_cleanup(debuglvl, &storelist);
     free(file_location);
 
     return(retval);
 }
-
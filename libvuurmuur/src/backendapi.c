@@ -164,6 +164,10 @@ load_plugin(const int debuglvl, d_list *plugin_list, char *plugin_name, struct B
         plugin->f->rename   = BackendFunctions.rename;
         plugin->f->conf     = BackendFunctions.conf;
         plugin->f->setup    = BackendFunctions.setup;
+        plugin->f->bulk     = BackendFunctions.bulk;
+        plugin->f->tell_begin = BackendFunctions.tell_begin;
+        plugin->f->tell_end = BackendFunctions.tell_end;
+        plugin->f->stamp    = BackendFunctions.stamp;
 
         /* get the versions */
         plugin->version         = BackendFunctions.version;
@@ -416,6 +420,9 @@ unload_backends(const int debuglvl, d_list *plugin_list)
         return(-1);
     }
 
+    /* use the real backend functions again */
+    snapshot_detach(debuglvl);
+
     /*
         SERVICES
     */
@@ -466,3 +473,282 @@ unload_backends(const int debuglvl, d_list *plugin_list)
 
     return(0);
 }
+
+
+/*
+    Bulk loading
+
+    When a backend has a 'bulk' function, backend_bulk_load gets all
+    objects of a category with all their variables in one call. The
+    loader of the caller gets a copy of the backend functions in which
+    'ask' is replaced by bulk_ask, and the BulkLoad_ as the backend.
+    bulk_ask answers the questions about the object being loaded from
+    the variables we got. Questions about other objects (e.g. the
+    members of a group) still go to the real backend. This way the
+    normal read functions (read_zonedata, read_service,
+    read_interface_info) are used for both ways of loading, and nothing
+    global is changed.
+*/
+struct BulkLoad_
+{
+    /* the real functions and backend */
+    struct BackendFunctions_    *f;
+    void                        *backend;
+
+    /* the functions handed to the loader */
+    struct BackendFunctions_    bulk_f;
+
+    /* the loader of the caller */
+    int                         (*load)(const int debuglvl, void *ctx, struct BackendFunctions_ *f, void *backend, char *name, int zonetype);
+    void                        *ctx;
+
+    /* the object being loaded */
+    char                        *name;
+    int                         zonetype;
+    struct BackendBulkVar_      *vars;
+    unsigned int                nvars;
+
+    /* position of the last answer to a 'multi' question */
+    unsigned int                multi_pos;
+    char                        multi_question[64];
+};
+
+
+/* compare the question the same way the backends do: the question is
+   uppercase, the variable is used as is */
+static int
+bulk_question_match(const char *question, const char *variable)
+{
+    for( ; *question != '\0' && *variable != '\0'; question++, variable++)
+    {
+        if(toupper((unsigned char)*question) != *variable)
+            return(0);
+    }
+
+    return(*question == '\0' && *variable == '\0');
+}
+
+
+static int
+bulk_ask(int debuglvl, void *backend, char *name, char *question,
+        char *answer, size_t max_answer, int type, int multi)
+{
+    struct BulkLoad_    *bl = backend;
+    unsigned int        i = 0;
+    int                 retval = 0;
+    size_t              len = 0;
+
+    /* not the object we are loading: ask the backend */
+    if(bl->vars == NULL || name == NULL || question == NULL ||
+       type != bl->zonetype || strcmp(name, bl->name) != 0)
+    {
+        return(bl->f->ask(debuglvl, bl->backend, name, question, answer,
+                max_answer, type, multi));
+    }
+
+    /* continue a 'multi' question where we left off */
+    if(multi == 1 && bl->multi_question[0] != '\0' &&
+       strcmp(bl->multi_question, question) == 0)
+        i = bl->multi_pos + 1;
+
+    for( ; i < bl->nvars; i++)
+    {
+        if(!bulk_question_match(question, bl->vars[i].variable))
+            continue;
+
+        len = strlcpy(answer, bl->vars[i].value, max_answer);
+        if(len >= max_answer)
+        {
+            (void)vrprint.error(-1, "Error", "buffer overrun when reading '%s', question '%s': len %u, max: %u (in: %s:%d).",
+                    name, question, len, max_answer, __FUNC__, __LINE__);
+            bl->multi_question[0] = '\0';
+            return(-1);
+        }
+
+        /* only return when bigger than 0 */
+        if(len > 0)
+            retval = 1;
+
+        break;
+    }
+
+    if(multi == 1 && retval == 1)
+    {
+        bl->multi_pos = i;
+        (void)strlcpy(bl->multi_question, question, sizeof(bl->multi_question));
+    }
+    else
+    {
+        bl->multi_question[0] = '\0';
+    }
+
+    return(retval);
+}
+
+
+/*  bulk_tell, bulk_del and bulk_rename
+
+    Changing the backend while loading (e.g. when converting an old
+    setting) makes the variables we got from the bulk function stale,
+    so after that we ask the backend again.
+*/
+static int
+bulk_tell(int debuglvl, void *backend, char *name, char *question,
+        char *answer, int overwrite, int type)
+{
+    struct BulkLoad_    *bl = backend;
+
+    bl->vars = NULL;
+    return(bl->f->tell(debuglvl, bl->backend, name, question, answer,
+            overwrite, type));
+}
+
+
+static int
+bulk_del(int debuglvl, void *backend, char *name, int type, int recurs)
+{
+    struct BulkLoad_    *bl = backend;
+
+    bl->vars = NULL;
+    return(bl->f->del(debuglvl, bl->backend, name, type, recurs));
+}
+
+
+static int
+bulk_rename(int debuglvl, void *backend, char *name, char *newname, int type)
+{
+    struct BulkLoad_    *bl = backend;
+
+    bl->vars = NULL;
+    return(bl->f->rename(debuglvl, bl->backend, name, newname, type));
+}
+
+
+static int
+bulk_load_object(int debuglvl, void *ctx, char *name, int zonetype,
+        struct BackendBulkVar_ *vars, unsigned int nvars)
+{
+    struct BulkLoad_    *bl = ctx;
+    int                 result = 0;
+
+    bl->name = name;
+    bl->zonetype = zonetype;
+    bl->vars = vars;
+    bl->nvars = nvars;
+    bl->multi_question[0] = '\0';
+
+    result = bl->load(debuglvl, bl->ctx, &bl->bulk_f, bl, name, zonetype);
+
+    bl->name = NULL;
+    bl->vars = NULL;
+    bl->nvars = 0;
+
+    return(result);
+}
+
+
+/*  backend_bulk_load
+
+    Loads all objects of category 'type' using the bulk function of the
+    backend 'f', calling 'load' for every object. 'load' gets the
+    functions and backend to read the object with, which only answer
+    from the bulk variables while 'load' runs.
+
+    Returncodes:
+         1: ok
+         0: backend has no bulk function, use 'list' and 'ask'
+        -1: error
+*/
+int
+backend_bulk_load(const int debuglvl, struct BackendFunctions_ *f,
+        void *backend, int type,
+        int (*load)(const int debuglvl, void *ctx, struct BackendFunctions_ *f, void *backend, char *name, int zonetype),
+        void *ctx)
+{
+    struct BulkLoad_    bl;
+    int                 result = 0;
+
+    /* safety */
+    if(f == NULL || load == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+            "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(f->bulk == NULL)
+        return(0);
+
+    memset(&bl, 0, sizeof(bl));
+    bl.f = f;
+    bl.backend = backend;
+    bl.load = load;
+    bl.ctx = ctx;
+
+    /* only what the read functions use: the others would get the
+       BulkLoad_ as their backend */
+    bl.bulk_f.version = f->version;
+    bl.bulk_f.ask = bulk_ask;
+    bl.bulk_f.tell = bulk_tell;
+    bl.bulk_f.del = bulk_del;
+    bl.bulk_f.rename = bulk_rename;
+
+    result = f->bulk(debuglvl, backend, type, bulk_load_object, &bl);
+    if(result < 0)
+        return(-1);
+
+    return(1);
+}
+
+
+/*  backend_tell_begin
+
+    Starts collecting the tells for object 'name', so the backend can
+    write them at once in backend_tell_end(). Does nothing for backends
+    without support for it, the tells are written one by one then.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+backend_tell_begin(const int debuglvl, struct BackendFunctions_ *f, void *backend, char *name, int type)
+{
+    if(f == NULL || backend == NULL || name == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+            "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(f->tell_begin == NULL || f->tell_end == NULL)
+        return(0);
+
+    return(f->tell_begin(debuglvl, backend, name, type));
+}
+
+
+/*  backend_tell_end
+
+    Writes (commit 1) or drops (commit 0) the tells collected since
+    backend_tell_begin().
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+backend_tell_end(const int debuglvl, struct BackendFunctions_ *f, void *backend, int commit)
+{
+    if(f == NULL || backend == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+            "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(f->tell_begin == NULL || f->tell_end == NULL)
+        return(0);
+
+    return(f->tell_end(debuglvl, backend, commit));
+}
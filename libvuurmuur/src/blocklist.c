@@ -606,15 +606,73 @@ blocklist_write_file(const int debuglvl, d_list *block_list)
 }
 
 
-int
-blocklist_save_list(const int debuglvl, BlockList *blocklist)
+/*  blocklist_tell_list
+
+    Writes the list to the backend, one rule at a time. Called by
+    blocklist_save_list() inside a backend transaction.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+blocklist_tell_list(const int debuglvl, BlockList *blocklist)
 {
-    int         result = 0;
     char        *line = NULL;
     int         overwrite = 0;
     d_list_node *d_node = NULL;
     char        rule_str[128] = "";
 
+    /* empty list, so clear all */
+    if(blocklist->list.len == 0)
+    {
+        if(rf->tell(debuglvl, rule_backend, "blocklist", "RULE", "", 1, TYPE_RULE) < 0)
+        {
+            (void)vrprint.error(-1, "Internal Error", "rf->tell() failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(-1);
+        }
+    }
+    else
+    {
+        overwrite = 1;
+
+        /* loop trough the list */
+        for(d_node = blocklist->list.top; d_node ; d_node = d_node->next)
+        {
+            if(!(line = d_node->data))
+            {
+                (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
+                        __FUNC__, __LINE__);
+                return(-1);
+            }
+
+            if(line[strlen(line)-1] == '\n')
+                line[strlen(line)-1] = '\0';
+
+            snprintf(rule_str, sizeof(rule_str), "block %s", line);
+
+            /* write to the backend */
+            if(rf->tell(debuglvl, rule_backend, "blocklist", "RULE", rule_str, overwrite, TYPE_RULE) < 0)
+            {
+                (void)vrprint.error(-1, "Internal Error", "rf->tell() failed (in: %s:%d).",
+                        __FUNC__, __LINE__);
+                return(-1);
+            }
+
+            overwrite = 0;
+        }
+    }
+
+    return(0);
+}
+
+
+int
+blocklist_save_list(const int debuglvl, BlockList *blocklist)
+{
+    int         result = 0;
+
     /* safety */
     if(blocklist == NULL)
     {
@@ -631,46 +689,15 @@ blocklist_save_list(const int debuglvl, BlockList *blocklist)
     }
     else
     {
-        /* empty list, so clear all */
-        if(blocklist->list.len == 0)
-        {
-            if(rf->tell(debuglvl, rule_backend, "blocklist", "RULE", "", 1, TYPE_RULE) < 0)
-            {
-                (void)vrprint.error(-1, "Internal Error", "rf->tell() failed (in: %s:%d).",
-                        __FUNC__, __LINE__);
-                return(-1);
-            }
-        }
-        else
-        {
-            overwrite = 1;
-
-            /* loop trough the list */
-            for(d_node = blocklist->list.top; d_node ; d_node = d_node->next)
-            {
-                if(!(line = d_node->data))
-                {
-                    (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
-                            __FUNC__, __LINE__);
-                    return(-1);
-                }
-
-                if(line[strlen(line)-1] == '\n')
-                    line[strlen(line)-1] = '\0';
+        if(backend_tell_begin(debuglvl, rf, rule_backend, "blocklist", TYPE_RULE) < 0)
+            return(-1);
 
-                snprintf(rule_str, sizeof(rule_str), "block %s", line);
+        result = blocklist_tell_list(debuglvl, blocklist);
 
-                /* write to the backend */
-                if(rf->tell(debuglvl, rule_backend, "blocklist", "RULE", rule_str, overwrite, TYPE_RULE) < 0)
-                {
-                    (void)vrprint.error(-1, "Internal Error", "rf->tell() failed (in: %s:%d).",
-                            __FUNC__, __LINE__);
-                    return(-1);
-                }
-
-                overwrite = 0;
-            }
-        }
+        if(backend_tell_end(debuglvl, rf, rule_backend, result == 0 ? 1 : 0) < 0)
+            return(-1);
+        if(result < 0)
+            return(-1);
     }
 
     return(0);
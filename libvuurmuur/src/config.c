@@ -385,6 +385,43 @@ check_tc_command(const int debuglvl, struct vuurmuur_config *cnf, char *tc_locat
 }
 
 
+/*
+*/
+int
+check_nft_command(const int debuglvl, struct vuurmuur_config *cnf, char *nft_location, char quiet)
+{
+    /* safety */
+    if(cnf == NULL || nft_location == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    /* first check if there even is a value */
+    if(strcmp(nft_location, "") == 0)
+    {
+        if(quiet == IPTCHK_VERBOSE)
+            (void)vrprint.error(0, "Error", "The path to the 'nft'-command was not set.");
+
+        return(0);
+    }
+    else
+    {
+        char *args[] = { nft_location, "--version", NULL };
+        int r = libvuurmuur_exec_command(debuglvl, cnf, nft_location, args, NULL);
+        if (r != 0)
+        {
+            if(quiet == IPTCHK_VERBOSE)
+                (void)vrprint.error(0, "Error", "The path '%s' to the 'nft'-command seems to be wrong.", nft_location);
+
+            return(0);
+        }
+    }
+
+    return(1);
+}
+
+
 /* updates the logdirlocations in the cnf struct based on cnf->vuurmuur_log_dir */
 int
 config_set_log_names(const int debuglvl, struct vuurmuur_config *cnf)
@@ -798,6 +835,149 @@ init_config(const int debuglvl, struct vuurmuur_config *cnf)
         return(VR_CNF_E_UNKNOWN_ERR);
 
 
+    /* NFTABLES */
+    result = ask_configfile(askconfig_debuglvl, cnf, "NFTABLES", answer, cnf->configfile, sizeof(answer));
+    if(result == 1)
+    {
+        /* ok, found */
+        if(strcasecmp(answer, "yes") == 0)
+        {
+            cnf->use_nftables = TRUE;
+        }
+        else if(strcasecmp(answer, "no") == 0)
+        {
+            cnf->use_nftables = FALSE;
+        }
+        else
+        {
+            (void)vrprint.warning("Warning", "'%s' is not a valid value for option NFTABLES.", answer);
+            cnf->use_nftables = DEFAULT_USE_NFTABLES;
+
+            retval = VR_CNF_W_ILLEGAL_VAR;
+        }
+    }
+    else if(result == 0)
+    {
+        /* if this is missing, we use the default */
+        cnf->use_nftables = DEFAULT_USE_NFTABLES;
+    }
+    else
+        return(VR_CNF_E_UNKNOWN_ERR);
+
+
+    /* HOST_ACCOUNTING */
+    result = ask_configfile(askconfig_debuglvl, cnf, "HOST_ACCOUNTING", answer, cnf->configfile, sizeof(answer));
+    if(result == 1)
+    {
+        /* ok, found */
+        if(strcasecmp(answer, "yes") == 0)
+        {
+            cnf->host_accounting = TRUE;
+        }
+        else if(strcasecmp(answer, "no") == 0)
+        {
+            cnf->host_accounting = FALSE;
+        }
+        else
+        {
+            (void)vrprint.warning("Warning", "'%s' is not a valid value for option HOST_ACCOUNTING.", answer);
+            cnf->host_accounting = DEFAULT_HOST_ACCOUNTING;
+
+            retval = VR_CNF_W_ILLEGAL_VAR;
+        }
+    }
+    else if(result == 0)
+    {
+        /* if this is missing, we use the default */
+        cnf->host_accounting = DEFAULT_HOST_ACCOUNTING;
+    }
+    else
+        return(VR_CNF_E_UNKNOWN_ERR);
+
+
+    /* FLOW_HISTORY */
+    result = ask_configfile(askconfig_debuglvl, cnf, "FLOW_HISTORY", answer, cnf->configfile, sizeof(answer));
+    if(result == 1)
+    {
+        /* ok, found */
+        if(strcasecmp(answer, "yes") == 0)
+        {
+            cnf->flow_history = TRUE;
+        }
+        else if(strcasecmp(answer, "no") == 0)
+        {
+            cnf->flow_history = FALSE;
+        }
+        else
+        {
+            (void)vrprint.warning("Warning", "'%s' is not a valid value for option FLOW_HISTORY.", answer);
+            cnf->flow_history = DEFAULT_FLOW_HISTORY;
+
+            retval = VR_CNF_W_ILLEGAL_VAR;
+        }
+    }
+    else if(result == 0)
+    {
+        /* if this is missing, we use the default */
+        cnf->flow_history = DEFAULT_FLOW_HISTORY;
+    }
+    else
+        return(VR_CNF_E_UNKNOWN_ERR);
+
+
+    /* FLOW_HISTORY_DAYS */
+    result = ask_configfile(askconfig_debuglvl, cnf, "FLOW_HISTORY_DAYS", answer, cnf->configfile, sizeof(answer));
+    if(result == 1)
+    {
+        /* ok, found */
+        result = atoi(answer);
+        if(result <= 0)
+        {
+            (void)vrprint.warning("Warning", "FLOW_HISTORY_DAYS must be 1 or more, using default (%u).", DEFAULT_FLOW_HISTORY_DAYS);
+            cnf->flow_history_days = DEFAULT_FLOW_HISTORY_DAYS;
+
+            retval = VR_CNF_W_ILLEGAL_VAR;
+        }
+        else
+        {
+            cnf->flow_history_days = (unsigned int)result;
+        }
+    }
+    else if(result == 0)
+    {
+        /* if this is missing, we use the default */
+        cnf->flow_history_days = DEFAULT_FLOW_HISTORY_DAYS;
+    }
+    else
+        return(VR_CNF_E_UNKNOWN_ERR);
+
+
+    /* SHAPE_LEAF */
+    result = ask_configfile(askconfig_debuglvl, cnf, "SHAPE_LEAF", answer, cnf->configfile, sizeof(answer));
+    if(result == 1)
+    {
+        /* ok, found */
+        if(libvuurmuur_is_shape_leaf(debuglvl, answer) == 1)
+        {
+            (void)strlcpy(cnf->shape_leaf, answer, sizeof(cnf->shape_leaf));
+        }
+        else
+        {
+            (void)vrprint.warning("Warning", "'%s' is not a valid value for option SHAPE_LEAF.", answer);
+            (void)strlcpy(cnf->shape_leaf, DEFAULT_SHAPE_LEAF, sizeof(cnf->shape_leaf));
+
+            retval = VR_CNF_W_ILLEGAL_VAR;
+        }
+    }
+    else if(result == 0)
+    {
+        /* if this is missing, we use the default */
+        (void)strlcpy(cnf->shape_leaf, DEFAULT_SHAPE_LEAF, sizeof(cnf->shape_leaf));
+    }
+    else
+        return(VR_CNF_E_UNKNOWN_ERR);
+
+
     /* LOG_BLOCKLIST */
     result = ask_configfile(askconfig_debuglvl, cnf, "LOG_BLOCKLIST", answer, cnf->configfile, sizeof(answer));
     if(result == 1)
@@ -1440,6 +1620,27 @@ init_config(const int debuglvl, struct vuurmuur_config *cnf)
 
     sanitize_path(debuglvl, cnf->iptablesrestore_location, sizeof(cnf->iptablesrestore_location));
 
+    /* not in older configfiles, so silently fall back to the default */
+    result = ask_configfile(askconfig_debuglvl, cnf, "IPTABLES_SAVE", cnf->iptablessave_location, cnf->configfile, sizeof(cnf->iptablessave_location));
+    if(result == 1)
+    {
+        /* ok */
+    }
+    else if(result == 0)
+    {
+        if(strlcpy(cnf->iptablessave_location, DEFAULT_IPTABLES_SAVE_LOCATION, sizeof(cnf->iptablessave_location)) >= sizeof(cnf->iptablessave_location))
+        {
+            (void)vrprint.error(VR_CNF_E_UNKNOWN_ERR, "Internal Error",
+                    "string overflow (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(VR_CNF_E_UNKNOWN_ERR);
+        }
+    }
+    else
+        return(VR_CNF_E_UNKNOWN_ERR);
+
+    sanitize_path(debuglvl, cnf->iptablessave_location, sizeof(cnf->iptablessave_location));
+
 #ifdef IPV6_ENABLED
     result = ask_configfile(askconfig_debuglvl, cnf, "IP6TABLES", cnf->ip6tables_location, cnf->configfile, sizeof(cnf->ip6tables_location));
     if(result == 1)
@@ -1487,6 +1688,27 @@ init_config(const int debuglvl, struct vuurmuur_config *cnf)
         return(VR_CNF_E_UNKNOWN_ERR);
 
     sanitize_path(debuglvl, cnf->ip6tablesrestore_location, sizeof(cnf->ip6tablesrestore_location));
+
+    /* not in older configfiles, so silently fall back to the default */
+    result = ask_configfile(askconfig_debuglvl, cnf, "IP6TABLES_SAVE", cnf->ip6tablessave_location, cnf->configfile, sizeof(cnf->ip6tablessave_location));
+    if(result == 1)
+    {
+        /* ok */
+    }
+    else if(result == 0)
+    {
+        if(strlcpy(cnf->ip6tablessave_location, DEFAULT_IP6TABLES_SAVE_LOCATION, sizeof(cnf->ip6tablessave_location)) >= sizeof(cnf->ip6tablessave_location))
+        {
+            (void)vrprint.error(VR_CNF_E_UNKNOWN_ERR, "Internal Error",
+                    "string overflow (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(VR_CNF_E_UNKNOWN_ERR);
+        }
+    }
+    else
+        return(VR_CNF_E_UNKNOWN_ERR);
+
+    sanitize_path(debuglvl, cnf->ip6tablessave_location, sizeof(cnf->ip6tablessave_location));
 #endif
 
     result = ask_configfile(askconfig_debuglvl, cnf, "CONNTRACK", cnf->conntrack_location, cnf->configfile, sizeof(cnf->conntrack_location));
@@ -1539,6 +1761,50 @@ init_config(const int debuglvl, struct vuurmuur_config *cnf)
     sanitize_path(debuglvl, cnf->tc_location, sizeof(cnf->tc_location));
 
 
+    /* not in older configfiles, so silently fall back to the default */
+    result = ask_configfile(askconfig_debuglvl, cnf, "NFT", cnf->nft_location, cnf->configfile, sizeof(cnf->nft_location));
+    if(result == 1)
+    {
+        /* ok */
+    }
+    else if(result == 0)
+    {
+        if(strlcpy(cnf->nft_location, DEFAULT_NFT_LOCATION, sizeof(cnf->nft_location)) >= sizeof(cnf->nft_location))
+        {
+            (void)vrprint.error(VR_CNF_E_UNKNOWN_ERR, "Internal Error",
+                    "string overflow (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(VR_CNF_E_UNKNOWN_ERR);
+        }
+    }
+    else
+        return(VR_CNF_E_UNKNOWN_ERR);
+
+    sanitize_path(debuglvl, cnf->nft_location, sizeof(cnf->nft_location));
+
+
+    /* not in older configfiles, so silently fall back to the default */
+    result = ask_configfile(askconfig_debuglvl, cnf, "IPSET", cnf->ipset_location, cnf->configfile, sizeof(cnf->ipset_location));
+    if(result == 1)
+    {
+        /* ok */
+    }
+    else if(result == 0)
+    {
+        if(strlcpy(cnf->ipset_location, DEFAULT_IPSET_LOCATION, sizeof(cnf->ipset_location)) >= sizeof(cnf->ipset_location))
+        {
+            (void)vrprint.error(VR_CNF_E_UNKNOWN_ERR, "Internal Error",
+                    "string overflow (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(VR_CNF_E_UNKNOWN_ERR);
+        }
+    }
+    else
+        return(VR_CNF_E_UNKNOWN_ERR);
+
+    sanitize_path(debuglvl, cnf->ipset_location, sizeof(cnf->ipset_location));
+
+
     result = ask_configfile(askconfig_debuglvl, cnf, "MODPROBE", cnf->modprobe_location, cnf->configfile, sizeof(cnf->modprobe_location));
     if(result == 1)
     {
@@ -1788,6 +2054,8 @@ reload_config(const int debuglvl, struct vuurmuur_config *old_cnf)
     {
         /* rule creation method is not allowed to change */
         new_cnf.old_rulecreation_method = old_cnf->old_rulecreation_method;
+        /* neither is the firewall backend */
+        new_cnf.use_nftables = old_cnf->use_nftables;
 
         /* in old_create_method mode, loglevel is not allowed to change at runtime, and neigther log_tcp_options */
         if(new_cnf.old_rulecreation_method == TRUE)
@@ -1810,120 +2078,277 @@ reload_config(const int debuglvl, struct vuurmuur_config *old_cnf)
 }
 
 
-/* ask_configfile
-
-    This function ask questions from the configfile.
+/*
+    The config file cache
 
-    Returncodes:
-     1: ok
-     0: ok, but question not found.
-    -1: error
+    A config file is read once into a list of variable/value pairs and
+    ask_configfile answers from that list. Before answering we stat the
+    file and read it again if it was changed or replaced. This saves
+    opening and scanning the file for every single question.
 */
-int
-ask_configfile(const int debuglvl, const struct vuurmuur_config *cnf, char *question, char *answer_ptr, char *file_location, size_t size)
+struct ConfigFileVar_
 {
-    int     retval = 0;
-    size_t  i = 0,
-            k = 0,
-            j = 0;
-    FILE    *fp = NULL;
-    char    line[512] = "",
-            variable[128] = "",
-            value[256] = "";
+    char    variable[128];
+    char    value[];
+};
 
-    if(!question || !file_location || size == 0)
-        return(-1);
+struct ConfigFile_
+{
+    char        *path;
+    struct stat st;
+    d_list      vars;
+};
+
+/* list of struct ConfigFile_ */
+static d_list   config_cache;
+static int      config_cache_setup = 0;
+
+
+static void
+config_cache_free_file(void *data)
+{
+    struct ConfigFile_  *file_ptr = data;
+
+    if(file_ptr == NULL)
+        return;
+
+    (void)d_list_cleanup(0, &file_ptr->vars);
+    free(file_ptr->path);
+    free(file_ptr);
+}
+
+
+/*  config_cache_parse
+
+    Reads the file into a new cache entry. Comments and empty lines are
+    skipped, the quotes around a value are stripped.
 
-    if(!(fp = vuurmuur_fopen(debuglvl, cnf, file_location,"r")))
+    Returns the entry or NULL on error.
+*/
+static struct ConfigFile_ *
+config_cache_parse(const int debuglvl, const struct vuurmuur_config *cnf, const char *file_location)
+{
+    struct ConfigFile_      *file_ptr = NULL;
+    struct ConfigFileVar_   *var_ptr = NULL;
+    FILE                    *fp = NULL;
+    char                    line[512] = "",
+                            *value = NULL;
+    size_t                  var_len = 0,
+                            val_len = 0;
+
+    if(!(fp = vuurmuur_fopen(debuglvl, cnf, file_location, "r")))
     {
         (void)vrprint.error(-1, "Error", "unable to open configfile '%s': %s (in: ask_configfile).", file_location, strerror(errno));
-        return(-1);
+        return(NULL);
     }
 
+    if(!(file_ptr = malloc(sizeof(struct ConfigFile_))))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        (void)fclose(fp);
+        return(NULL);
+    }
+    memset(file_ptr, 0, sizeof(struct ConfigFile_));
+
+    /* stat after opening: vuurmuur_fopen may have fixed the mode */
+    if(fstat(fileno(fp), &file_ptr->st) == -1 ||
+       !(file_ptr->path = strdup(file_location)) ||
+       d_list_setup(debuglvl, &file_ptr->vars, free) < 0)
+    {
+        (void)vrprint.error(-1, "Error", "reading configfile '%s' failed: %s (in: %s:%d).",
+                file_location, strerror(errno), __FUNC__, __LINE__);
+        free(file_ptr->path);
+        free(file_ptr);
+        (void)fclose(fp);
+        return(NULL);
+    }
 
     while(fgets(line, (int)sizeof(line), fp) != NULL)
     {
-        if ((line[0] == '#' ) || (strlen(line) < 1) || (line[0] == '\n'))
+        /* skip comments, empty lines and lines without a variable */
+        if(line[0] == '#' || line[0] == '\n' || line[0] == '\0')
+            continue;
+        if((value = strchr(line, '=')) == NULL)
+            continue;
+
+        var_len = value - line;
+        if(var_len >= sizeof(var_ptr->variable))
+            continue;
+
+        /* strip the newline and the quotes around the value */
+        value++;
+        val_len = strcspn(value, "\n");
+        while(val_len > 0 && value[0] == '\"')
         {
-            /* do nothing, its a comment. */
+            value++;
+            val_len--;
         }
-        else
+        if(val_len > 0 && value[val_len - 1] == '\"')
+            val_len--;
+
+        if(!(var_ptr = malloc(sizeof(struct ConfigFileVar_) + val_len + 1)))
         {
-            k=0; j=0;
+            (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                    strerror(errno), __FUNC__, __LINE__);
+            config_cache_free_file(file_ptr);
+            (void)fclose(fp);
+            return(NULL);
+        }
+        memcpy(var_ptr->variable, line, var_len);
+        var_ptr->variable[var_len] = '\0';
+        memcpy(var_ptr->value, value, val_len);
+        var_ptr->value[val_len] = '\0';
 
-            /* variable */
-            while(line[k] != '=' && k < size)
-            {
-                variable[j]=line[k];
-                k++; j++;
-            }
-            variable[j]='\0';
+        if(debuglvl >= HIGH)
+            (void)vrprint.debug(__FUNC__, "variable '%s' value '%s'", var_ptr->variable, var_ptr->value);
+
+        if(d_list_append(debuglvl, &file_ptr->vars, var_ptr) == NULL)
+        {
+            (void)vrprint.error(-1, "Internal Error", "d_list_append() failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            free(var_ptr);
+            config_cache_free_file(file_ptr);
+            (void)fclose(fp);
+            return(NULL);
+        }
+    }
 
-            if(debuglvl >= HIGH)
-                (void)vrprint.debug(__FUNC__, "question '%s' variable '%s' (%d)", question, variable, size);
+    if(fclose(fp) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "closing file '%s' failed: %s.", file_location, strerror(errno));
+        config_cache_free_file(file_ptr);
+        return(NULL);
+    }
 
-            /* value */
-            j=0;
-            i=k+1;
-            while(line[i] != '\0' && line[i] != '\n' && i < (size+k+1))
-            {
-                /* if the first character is a '"' we strip it. */
-                if(j == 0 && line[i] == '\"')
-                {
-                    i++;
-                }
-                else
-                {
-                    value[j] = line[i];
-                    i++;
-                    j++;
-                }
-            }
-            /* if the last character is a'"' we strip it. */
-            if(j > 0)
-            {
-                if(value[j-1] == '\"')
-                {
-                    value[j-1] = '\0';
-                }
-                else
-                    value[j] = '\0';
-            }
-            else
-                value[j] = '\0';
+    return(file_ptr);
+}
 
-            if(debuglvl >= HIGH)
-                (void)vrprint.debug(__FUNC__, "question '%s' value '%s' (%u)", question, value, size);
 
-            if(strcmp(question, variable) == 0)
-            {
-                if(debuglvl >= HIGH)
-                    (void)vrprint.debug(__FUNC__, "question '%s' matched, value: '%s'", question, value);
-
-                if(strlcpy(answer_ptr, value, size) >= size)
-                {
-                    (void)vrprint.error(-1, "Error", "value for question '%s' too big (in: %s:%d).",
-                            question,
-                            __FUNC__, __LINE__);
-                    retval = -1;
-                }
-                else
-                {
-                    retval = 1;
-                }
-
-                break;
-            }
+/*  config_cache_invalidate
+
+    Drops the cache entry of a file, so it will be read again.
+*/
+static void
+config_cache_invalidate(const int debuglvl, const char *file_location)
+{
+    d_list_node         *d_node = NULL;
+    struct ConfigFile_  *file_ptr = NULL;
+
+    if(config_cache_setup == 0)
+        return;
+
+    for(d_node = config_cache.top; d_node; d_node = d_node->next)
+    {
+        file_ptr = d_node->data;
+
+        if(strcmp(file_ptr->path, file_location) == 0)
+        {
+            (void)d_list_remove_node(debuglvl, &config_cache, d_node);
+            return;
         }
     }
+}
 
-    if(fclose(fp) == -1)
+
+/*  config_cache_get
+
+    Returns the up to date cache entry of the file, reading it if
+    needed. NULL on error.
+*/
+static struct ConfigFile_ *
+config_cache_get(const int debuglvl, const struct vuurmuur_config *cnf, const char *file_location)
+{
+    d_list_node         *d_node = NULL;
+    struct ConfigFile_  *file_ptr = NULL;
+    struct stat         st;
+
+    if(config_cache_setup == 0)
     {
-        (void)vrprint.error(-1, "Error", "closing file '%s' failed: %s.", file_location, strerror(errno));
-        retval = -1;
+        if(d_list_setup(debuglvl, &config_cache, config_cache_free_file) < 0)
+            return(NULL);
+
+        config_cache_setup = 1;
     }
 
-    return(retval);
+    for(d_node = config_cache.top; d_node; d_node = d_node->next)
+    {
+        file_ptr = d_node->data;
+
+        if(strcmp(file_ptr->path, file_location) == 0)
+            break;
+    }
+
+    if(d_node != NULL)
+    {
+        if(stat(file_location, &st) == 0 && stat_changed(&file_ptr->st, &st) == 0)
+            return(file_ptr);
+
+        if(debuglvl >= MEDIUM)
+            (void)vrprint.debug(__FUNC__, "'%s' changed, reading it again.", file_location);
+
+        (void)d_list_remove_node(debuglvl, &config_cache, d_node);
+    }
+
+    if(!(file_ptr = config_cache_parse(debuglvl, cnf, file_location)))
+        return(NULL);
+
+    if(d_list_append(debuglvl, &config_cache, file_ptr) == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "d_list_append() failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        config_cache_free_file(file_ptr);
+        return(NULL);
+    }
+
+    return(file_ptr);
+}
+
+
+/* ask_configfile
+
+    This function ask questions from the configfile.
+
+    Returncodes:
+     1: ok
+     0: ok, but question not found.
+    -1: error
+*/
+int
+ask_configfile(const int debuglvl, const struct vuurmuur_config *cnf, char *question, char *answer_ptr, char *file_location, size_t size)
+{
+    struct ConfigFile_      *file_ptr = NULL;
+    struct ConfigFileVar_   *var_ptr = NULL;
+    d_list_node             *d_node = NULL;
+
+    if(!question || !file_location || size == 0)
+        return(-1);
+
+    if(!(file_ptr = config_cache_get(debuglvl, cnf, file_location)))
+        return(-1);
+
+    for(d_node = file_ptr->vars.top; d_node; d_node = d_node->next)
+    {
+        var_ptr = d_node->data;
+
+        if(strcmp(question, var_ptr->variable) != 0)
+            continue;
+
+        if(debuglvl >= HIGH)
+            (void)vrprint.debug(__FUNC__, "question '%s' matched, value: '%s'", question, var_ptr->value);
+
+        if(strlcpy(answer_ptr, var_ptr->value, size) >= size)
+        {
+            (void)vrprint.error(-1, "Error", "value for question '%s' too big (in: %s:%d).",
+                    question,
+                    __FUNC__, __LINE__);
+            return(-1);
+        }
+
+        return(1);
+    }
+
+    return(0);
 }
 
 /*  write_configfile
@@ -1972,16 +2397,24 @@ write_configfile(const int debuglvl, char *file_location)
     fprintf(fp, "IPTABLES=\"%s\"\n\n", conf.iptables_location);
     fprintf(fp, "# Location of the iptables-restore-command (full path).\n");
     fprintf(fp, "IPTABLES_RESTORE=\"%s\"\n\n", conf.iptablesrestore_location);
+    fprintf(fp, "# Location of the iptables-save-command (full path).\n");
+    fprintf(fp, "IPTABLES_SAVE=\"%s\"\n\n", conf.iptablessave_location);
 #ifdef IPV6_ENABLED
     fprintf(fp, "# Location of the ip6tables-command (full path).\n");
     fprintf(fp, "IP6TABLES=\"%s\"\n\n", conf.ip6tables_location);
     fprintf(fp, "# Location of the ip6tables-restore-command (full path).\n");
     fprintf(fp, "IP6TABLES_RESTORE=\"%s\"\n\n", conf.ip6tablesrestore_location);
+    fprintf(fp, "# Location of the ip6tables-save-command (full path).\n");
+    fprintf(fp, "IP6TABLES_SAVE=\"%s\"\n\n", conf.ip6tablessave_location);
 #endif
     fprintf(fp, "# Location of the conntrack-command (full path).\n");
     fprintf(fp, "CONNTRACK=\"%s\"\n\n", conf.conntrack_location);
     fprintf(fp, "# Location of the tc-command (full path).\n");
     fprintf(fp, "TC=\"%s\"\n\n", conf.tc_location);
+    fprintf(fp, "# Location of the nft-command (full path).\n");
+    fprintf(fp, "NFT=\"%s\"\n\n", conf.nft_location);
+    fprintf(fp, "# Location of the ipset-command (full path).\n");
+    fprintf(fp, "IPSET=\"%s\"\n\n", conf.ipset_location);
 
     fprintf(fp, "# Location of the modprobe-command (full path).\n");
     fprintf(fp, "MODPROBE=\"%s\"\n\n", conf.modprobe_location);
@@ -1997,6 +2430,20 @@ write_configfile(const int debuglvl, char *file_location)
     fprintf(fp, "# If set to yes, each rule will be loaded into the system individually using\n");
     fprintf(fp, "# iptables. Otherwise iptables-restore will be used (yes/no).\n");
     fprintf(fp, "OLD_CREATE_METHOD=\"%s\"\n\n", conf.old_rulecreation_method ? "Yes" : "No");
+    fprintf(fp, "# If set to yes, the ruleset is created for nftables and loaded in a single\n");
+    fprintf(fp, "# 'nft -f' transaction instead of using iptables (yes/no).\n");
+    fprintf(fp, "NFTABLES=\"%s\"\n\n", conf.use_nftables ? "Yes" : "No");
+    fprintf(fp, "# If set to yes, the traffic of every host and network is counted, so the\n");
+    fprintf(fp, "# top talkers can be shown in vuurmuur_conf (yes/no).\n");
+    fprintf(fp, "HOST_ACCOUNTING=\"%s\"\n\n", conf.host_accounting ? "Yes" : "No");
+    fprintf(fp, "# If set to yes, vuurmuur_log keeps a record of every connection that ended,\n");
+    fprintf(fp, "# see vuurmuur_flows (yes/no).\n");
+    fprintf(fp, "FLOW_HISTORY=\"%s\"\n\n", conf.flow_history ? "Yes" : "No");
+    fprintf(fp, "# The number of days the connection records are kept.\n");
+    fprintf(fp, "FLOW_HISTORY_DAYS=\"%u\"\n\n", conf.flow_history_days);
+    fprintf(fp, "# The qdisc that queues the traffic of a shaping class, unless the rule or\n");
+    fprintf(fp, "# the interface sets another one (sfq, fq_codel, cake or fq).\n");
+    fprintf(fp, "SHAPE_LEAF=\"%s\"\n\n", conf.shape_leaf);
 
     fprintf(fp, "# Will we be using NFLOG logging?\n");
     fprintf(fp, "RULE_NFLOG=\"%s\"\n\n", conf.rule_nflog ? "Yes" : "No");
@@ -2065,6 +2512,9 @@ write_configfile(const int debuglvl, char *file_location)
         return(-1);
     }
 
+    /* make sure we don't answer from the old contents */
+    config_cache_invalidate(debuglvl, file_location);
+
     (void)vrprint.info("Info", "Rewritten config file.");
     return(0);
 }
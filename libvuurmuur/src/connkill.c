@@ -0,0 +1,792 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+
+/*
+    Killing connections
+
+    conn_kill() removes all flows from the connection tracking table
+    that match one of the filters. Over ctnetlink this is one
+    conversation with the kernel: the table is dumped, and a delete for
+    every flow that matches is sent in batches of many messages per
+    send, each answered with an ack.
+
+    Without ctnetlink (module not loaded, older kernel) we fall back to
+    the conntrack tool, with one 'conntrack -D' per filter. The tool
+    deletes all flows matching the filter itself.
+*/
+
+/* size of the receive buffer */
+#define CONNKILL_BUFSIZE    65536
+/*  number of deletes we send at once. Every one of them is answered
+    with an ack that is queued on our socket until we read it, so the
+    batch must not overflow the socket receive buffer. */
+#define CONNKILL_BATCH      64
+/* seconds to wait for the kernel */
+#define CONNKILL_TIMEOUT    5
+
+
+/* a flow from the dump */
+struct ConnKillFlow_
+{
+    char            src_ip[46];
+    char            dst_ip[46];
+    int             protocol;
+    int             src_port;
+    int             dst_port;
+    unsigned int    mark;
+};
+
+/* the filters, sorted for the lookup */
+struct ConnKillFilters_
+{
+    /* filters with a source and a destination ip: sorted on them */
+    VR_ConnKillFilter   *exact;
+    unsigned int        exact_n;
+
+    /* the others are checked one by one */
+    VR_ConnKillFilter   *wide;
+    unsigned int        wide_n;
+};
+
+/* the delete messages we still have to send */
+struct ConnKillMsgs_
+{
+    char                *buf;
+    size_t              len;
+    size_t              size;
+    unsigned int        n;
+};
+
+
+static int
+connkill_filter_cmp(const void *a, const void *b)
+{
+    const VR_ConnKillFilter *fa = (const VR_ConnKillFilter *)a,
+                            *fb = (const VR_ConnKillFilter *)b;
+    int                     result = 0;
+
+    if((result = strcmp(fa->src_ip, fb->src_ip)) != 0)
+        return(result);
+
+    return(strcmp(fa->dst_ip, fb->dst_ip));
+}
+
+
+static int
+connkill_filter_match(const VR_ConnKillFilter *filter, const struct ConnKillFlow_ *flow)
+{
+    if(filter->src_ip[0] != '\0' && strcmp(filter->src_ip, flow->src_ip) != 0)
+        return(0);
+    if(filter->dst_ip[0] != '\0' && strcmp(filter->dst_ip, flow->dst_ip) != 0)
+        return(0);
+    if(filter->protocol != 0 && filter->protocol != flow->protocol)
+        return(0);
+    if(filter->src_port != 0 && filter->src_port != flow->src_port)
+        return(0);
+    if(filter->dst_port != 0 && filter->dst_port != flow->dst_port)
+        return(0);
+    if(filter->mark_mask != 0 &&
+        (flow->mark & filter->mark_mask) != (filter->mark & filter->mark_mask))
+        return(0);
+
+    return(1);
+}
+
+
+/*  connkill_filters_setup
+
+    Checks the filters and sorts them for the lookup. A filter that
+    would match every connection is refused.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+connkill_filters_setup(const int debuglvl, struct ConnKillFilters_ *filters,
+        VR_ConnKillFilter *filter, unsigned int n)
+{
+    unsigned int    i = 0;
+
+    memset(filters, 0, sizeof(*filters));
+
+    for(i = 0; i < n; i++)
+    {
+        if(filter[i].src_ip[0] == '\0' && filter[i].dst_ip[0] == '\0' &&
+            filter[i].protocol == 0 && filter[i].src_port == 0 &&
+            filter[i].dst_port == 0 && filter[i].mark_mask == 0)
+        {
+            (void)vrprint.error(-1, "Error", "refusing to kill all connections (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(-1);
+        }
+    }
+
+    if(!(filters->exact = calloc(n, sizeof(VR_ConnKillFilter))) ||
+        !(filters->wide = calloc(n, sizeof(VR_ConnKillFilter))))
+    {
+        (void)vrprint.error(-1, "Error", "calloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        free(filters->exact);
+        return(-1);
+    }
+
+    for(i = 0; i < n; i++)
+    {
+        if(filter[i].src_ip[0] != '\0' && filter[i].dst_ip[0] != '\0')
+            filters->exact[filters->exact_n++] = filter[i];
+        else
+            filters->wide[filters->wide_n++] = filter[i];
+    }
+
+    qsort(filters->exact, filters->exact_n, sizeof(VR_ConnKillFilter), connkill_filter_cmp);
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "%u exact and %u wide filters.",
+                filters->exact_n, filters->wide_n);
+    return(0);
+}
+
+
+static int
+connkill_filters_match(struct ConnKillFilters_ *filters, const struct ConnKillFlow_ *flow)
+{
+    unsigned int        low = 0,
+                        high = filters->exact_n,
+                        mid = 0,
+                        i = 0;
+    VR_ConnKillFilter   key;
+
+    for(i = 0; i < filters->wide_n; i++)
+    {
+        if(connkill_filter_match(&filters->wide[i], flow))
+            return(1);
+    }
+
+    /* the first exact filter for the src/dst pair of the flow */
+    (void)strlcpy(key.src_ip, flow->src_ip, sizeof(key.src_ip));
+    (void)strlcpy(key.dst_ip, flow->dst_ip, sizeof(key.dst_ip));
+
+    while(low < high)
+    {
+        mid = low + (high - low) / 2;
+
+        if(connkill_filter_cmp(&filters->exact[mid], &key) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    for(i = low; i < filters->exact_n &&
+            connkill_filter_cmp(&filters->exact[i], &key) == 0; i++)
+    {
+        if(connkill_filter_match(&filters->exact[i], flow))
+            return(1);
+    }
+
+    return(0);
+}
+
+
+static void
+connkill_filters_cleanup(struct ConnKillFilters_ *filters)
+{
+    free(filters->exact);
+    free(filters->wide);
+    memset(filters, 0, sizeof(*filters));
+}
+
+
+/* walk the attributes in 'buf' */
+#define CONNKILL_ATTR_OK(nla, len) \
+    ((len) >= (int)sizeof(struct nlattr) && \
+     (nla)->nla_len >= sizeof(struct nlattr) && \
+     (int)(nla)->nla_len <= (len))
+#define CONNKILL_ATTR_NEXT(nla, len) \
+    ((len) -= NLA_ALIGN((nla)->nla_len), \
+     (struct nlattr *)((char *)(nla) + NLA_ALIGN((nla)->nla_len)))
+#define CONNKILL_ATTR_DATA(nla) ((void *)((char *)(nla) + NLA_HDRLEN))
+#define CONNKILL_ATTR_LEN(nla)  ((int)(nla)->nla_len - NLA_HDRLEN)
+#define CONNKILL_ATTR_TYPE(nla) ((nla)->nla_type & NLA_TYPE_MASK)
+
+
+/*  connkill_parse_tuple
+
+    Fills the ips, the protocol and the ports of 'flow' from the
+    CTA_TUPLE_ORIG attribute.
+*/
+static void
+connkill_parse_tuple(int family, struct nlattr *tuple, struct ConnKillFlow_ *flow)
+{
+    struct nlattr   *nla = CONNKILL_ATTR_DATA(tuple),
+                    *sub = NULL;
+    int             len = CONNKILL_ATTR_LEN(tuple),
+                    sublen = 0;
+    uint16_t        port = 0;
+
+    for(; CONNKILL_ATTR_OK(nla, len); nla = CONNKILL_ATTR_NEXT(nla, len))
+    {
+        sub = CONNKILL_ATTR_DATA(nla);
+        sublen = CONNKILL_ATTR_LEN(nla);
+
+        if(CONNKILL_ATTR_TYPE(nla) == CTA_TUPLE_IP)
+        {
+            for(; CONNKILL_ATTR_OK(sub, sublen); sub = CONNKILL_ATTR_NEXT(sub, sublen))
+            {
+                switch(CONNKILL_ATTR_TYPE(sub))
+                {
+                    case CTA_IP_V4_SRC:
+                    case CTA_IP_V6_SRC:
+                        (void)inet_ntop(family, CONNKILL_ATTR_DATA(sub),
+                                flow->src_ip, sizeof(flow->src_ip));
+                        break;
+                    case CTA_IP_V4_DST:
+                    case CTA_IP_V6_DST:
+                        (void)inet_ntop(family, CONNKILL_ATTR_DATA(sub),
+                                flow->dst_ip, sizeof(flow->dst_ip));
+                        break;
+                }
+            }
+        }
+        else if(CONNKILL_ATTR_TYPE(nla) == CTA_TUPLE_PROTO)
+        {
+            for(; CONNKILL_ATTR_OK(sub, sublen); sub = CONNKILL_ATTR_NEXT(sub, sublen))
+            {
+                switch(CONNKILL_ATTR_TYPE(sub))
+                {
+                    case CTA_PROTO_NUM:
+                        flow->protocol = *(uint8_t *)CONNKILL_ATTR_DATA(sub);
+                        break;
+                    case CTA_PROTO_SRC_PORT:
+                        memcpy(&port, CONNKILL_ATTR_DATA(sub), sizeof(port));
+                        flow->src_port = ntohs(port);
+                        break;
+                    case CTA_PROTO_DST_PORT:
+                        memcpy(&port, CONNKILL_ATTR_DATA(sub), sizeof(port));
+                        flow->dst_port = ntohs(port);
+                        break;
+                }
+            }
+        }
+    }
+}
+
+
+/*  connkill_add_delete
+
+    Adds the delete message for a flow to 'msgs'. It is the original
+    tuple of the flow as the kernel gave it to us, and its zone.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+connkill_add_delete(struct ConnKillMsgs_ *msgs, int family,
+        struct nlattr *tuple, struct nlattr *zone)
+{
+    struct nlmsghdr *nlh = NULL;
+    struct nfgenmsg *nfg = NULL;
+    size_t          len = 0;
+    char            *ptr = NULL;
+
+    len = NLMSG_SPACE(sizeof(struct nfgenmsg)) + NLA_ALIGN(tuple->nla_len);
+    if(zone != NULL)
+        len += NLA_ALIGN(zone->nla_len);
+
+    if(msgs->len + len > msgs->size)
+    {
+        size_t  size = msgs->size ? msgs->size * 2 : CONNKILL_BUFSIZE;
+
+        while(msgs->len + len > size)
+            size *= 2;
+
+        if(!(ptr = realloc(msgs->buf, size)))
+        {
+            (void)vrprint.error(-1, "Error", "realloc failed: %s (in: %s:%d).",
+                    strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+        msgs->buf = ptr;
+        msgs->size = size;
+    }
+
+    ptr = msgs->buf + msgs->len;
+    memset(ptr, 0, len);
+
+    nlh = (struct nlmsghdr *)ptr;
+    nlh->nlmsg_len = (uint32_t)len;
+    nlh->nlmsg_type = (NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_DELETE;
+    nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+    nlh->nlmsg_seq = msgs->n + 1;
+
+    nfg = NLMSG_DATA(nlh);
+    nfg->nfgen_family = (uint8_t)family;
+    nfg->version = NFNETLINK_V0;
+
+    ptr += NLMSG_SPACE(sizeof(struct nfgenmsg));
+    memcpy(ptr, tuple, tuple->nla_len);
+    ptr += NLA_ALIGN(tuple->nla_len);
+    if(zone != NULL)
+        memcpy(ptr, zone, zone->nla_len);
+
+    msgs->len += len;
+    msgs->n++;
+    return(0);
+}
+
+
+/*  connkill_dump
+
+    Dumps the conntrack table and adds a delete for every flow that
+    matches a filter.
+
+    Returncodes:
+         0: ok
+        -1: error, errno is set when the dump itself failed
+*/
+static int
+connkill_dump(const int debuglvl, int sock, char *buf,
+        struct ConnKillFilters_ *filters, struct ConnKillMsgs_ *msgs)
+{
+    struct
+    {
+        struct nlmsghdr nlh;
+        struct nfgenmsg nfg;
+    } req;
+    struct nlmsghdr         *nlh = NULL;
+    struct nfgenmsg         *nfg = NULL;
+    struct nlattr           *nla = NULL,
+                            *tuple = NULL,
+                            *zone = NULL;
+    struct ConnKillFlow_    flow;
+    struct nlmsgerr         *err = NULL;
+    ssize_t                 result = 0;
+    int                     len = 0,
+                            done = 0;
+    uint32_t                mark = 0;
+    unsigned int            flows = 0;
+
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct nfgenmsg));
+    req.nlh.nlmsg_type = (NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_GET;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    /* AF_UNSPEC: ipv4 and ipv6 */
+    req.nfg.nfgen_family = AF_UNSPEC;
+    req.nfg.version = NFNETLINK_V0;
+
+    if(send(sock, &req, req.nlh.nlmsg_len, 0) < 0)
+        return(-1);
+
+    while(!done)
+    {
+        if((result = recv(sock, buf, CONNKILL_BUFSIZE, 0)) < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return(-1);
+        }
+
+        for(nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, (unsigned int)result);
+                nlh = NLMSG_NEXT(nlh, result))
+        {
+            if(nlh->nlmsg_type == NLMSG_DONE)
+            {
+                done = 1;
+                break;
+            }
+            else if(nlh->nlmsg_type == NLMSG_ERROR)
+            {
+                err = NLMSG_DATA(nlh);
+                errno = -err->error;
+                return(-1);
+            }
+
+            nfg = NLMSG_DATA(nlh);
+            nla = (struct nlattr *)((char *)nfg + NLMSG_ALIGN(sizeof(struct nfgenmsg)));
+            len = (int)nlh->nlmsg_len - NLMSG_SPACE(sizeof(struct nfgenmsg));
+
+            memset(&flow, 0, sizeof(flow));
+            tuple = zone = NULL;
+
+            for(; CONNKILL_ATTR_OK(nla, len); nla = CONNKILL_ATTR_NEXT(nla, len))
+            {
+                switch(CONNKILL_ATTR_TYPE(nla))
+                {
+                    case CTA_TUPLE_ORIG:
+                        tuple = nla;
+                        connkill_parse_tuple(nfg->nfgen_family, nla, &flow);
+                        break;
+                    case CTA_ZONE:
+                        zone = nla;
+                        break;
+                    case CTA_MARK:
+                        memcpy(&mark, CONNKILL_ATTR_DATA(nla), sizeof(mark));
+                        flow.mark = ntohl(mark);
+                        break;
+                }
+            }
+            flows++;
+
+            if(tuple == NULL || !connkill_filters_match(filters, &flow))
+                continue;
+
+            if(debuglvl >= HIGH)
+                (void)vrprint.debug(__FUNC__, "kill %s:%d -> %s:%d (%d)",
+                        flow.src_ip, flow.src_port, flow.dst_ip,
+                        flow.dst_port, flow.protocol);
+
+            if(connkill_add_delete(msgs, nfg->nfgen_family, tuple, zone) < 0)
+            {
+                errno = 0;
+                return(-1);
+            }
+        }
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "%u flows, %u match.", flows, msgs->n);
+    return(0);
+}
+
+
+/*  connkill_delete
+
+    Sends the deletes in batches and counts the acks.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+connkill_delete(const int debuglvl, int sock, char *buf, struct ConnKillMsgs_ *msgs,
+        VR_ConnKillStats *stats, VR_ConnKillProgress progress, void *ctx)
+{
+    struct nlmsghdr *nlh = NULL;
+    struct nlmsgerr *err = NULL;
+    size_t          offset = 0,
+                    batch_len = 0;
+    unsigned int    batch_n = 0,
+                    acked = 0,
+                    done = 0;
+    ssize_t         result = 0;
+
+    while(offset < msgs->len)
+    {
+        /* the next batch */
+        for(batch_len = 0, batch_n = 0; offset + batch_len < msgs->len; batch_n++)
+        {
+            nlh = (struct nlmsghdr *)(msgs->buf + offset + batch_len);
+
+            if(batch_n == CONNKILL_BATCH)
+                break;
+
+            batch_len += nlh->nlmsg_len;
+        }
+
+        if(send(sock, msgs->buf + offset, batch_len, 0) < 0)
+        {
+            (void)vrprint.error(-1, "Error", "sending to ctnetlink failed: %s (in: %s:%d).",
+                    strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+
+        /* every delete is answered */
+        for(acked = 0; acked < batch_n; )
+        {
+            if((result = recv(sock, buf, CONNKILL_BUFSIZE, 0)) < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+
+                (void)vrprint.error(-1, "Error", "reading from ctnetlink failed: %s (in: %s:%d).",
+                        strerror(errno), __FUNC__, __LINE__);
+                return(-1);
+            }
+
+            for(nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, (unsigned int)result);
+                    nlh = NLMSG_NEXT(nlh, result))
+            {
+                if(nlh->nlmsg_type != NLMSG_ERROR)
+                    continue;
+
+                err = NLMSG_DATA(nlh);
+                if(err->error == 0)
+                    stats->killed++;
+                else if(err->error == -ENOENT)
+                    stats->gone++;
+                else
+                {
+                    if(debuglvl >= LOW)
+                        (void)vrprint.debug(__FUNC__, "delete %u failed: %s",
+                                nlh->nlmsg_seq, strerror(-err->error));
+                    stats->failed++;
+                }
+                acked++;
+            }
+        }
+
+        offset += batch_len;
+        done += batch_n;
+
+        if(progress != NULL)
+            progress(ctx, done, msgs->n);
+    }
+
+    return(0);
+}
+
+
+/*  connkill_netlink
+
+    Returncodes:
+         0: ok
+        -1: error
+        -2: ctnetlink is not available, try the conntrack tool
+*/
+static int
+connkill_netlink(const int debuglvl, struct ConnKillFilters_ *filters,
+        VR_ConnKillStats *stats, VR_ConnKillProgress progress, void *ctx)
+{
+    struct sockaddr_nl      addr;
+    struct timeval          tv;
+    struct ConnKillMsgs_    msgs;
+    char                    *buf = NULL;
+    int                     sock = -1,
+                            retval = 0,
+                            one = 1;
+
+    memset(&msgs, 0, sizeof(msgs));
+
+    if((sock = socket(AF_NETLINK, SOCK_RAW, NETLINK_NETFILTER)) == -1)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "no ctnetlink socket: %s", strerror(errno));
+        return(-2);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+
+    tv.tv_sec = CONNKILL_TIMEOUT;
+    tv.tv_usec = 0;
+
+    if(bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == -1)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "ctnetlink socket setup failed: %s", strerror(errno));
+        (void)close(sock);
+        return(-2);
+    }
+
+#ifdef NETLINK_CAP_ACK
+    /* don't copy the whole delete into the ack, linux >= 4.3 */
+    (void)setsockopt(sock, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one));
+#endif
+
+    if(!(buf = malloc(CONNKILL_BUFSIZE)))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        (void)close(sock);
+        return(-1);
+    }
+
+    if(connkill_dump(debuglvl, sock, buf, filters, &msgs) < 0)
+    {
+        if(errno == 0)
+            retval = -1;
+        else
+        {
+            /* no ctnetlink module, or not allowed */
+            if(debuglvl >= LOW)
+                (void)vrprint.debug(__FUNC__, "ctnetlink dump failed: %s", strerror(errno));
+            retval = -2;
+        }
+    }
+    else
+    {
+        stats->matched = msgs.n;
+        if(msgs.n > 0)
+            retval = connkill_delete(debuglvl, sock, buf, &msgs, stats, progress, ctx);
+    }
+
+    free(msgs.buf);
+    free(buf);
+    (void)close(sock);
+    return(retval);
+}
+
+
+/*  connkill_exec
+
+    One 'conntrack -D' per filter.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+connkill_exec(const int debuglvl, struct vuurmuur_config *cnf, VR_ConnKillFilter *filter,
+        unsigned int n, VR_ConnKillStats *stats, VR_ConnKillProgress progress, void *ctx)
+{
+    struct protoent *proto_ptr = NULL;
+    char            proto_str[32] = "",
+                    sp_str[6] = "",
+                    dp_str[6] = "",
+                    mark_str[24] = "";
+    char            *args[16];
+    unsigned int    i = 0;
+    int             a = 0,
+                    result = 0;
+
+    if(cnf->conntrack_location[0] == '\0')
+    {
+        (void)vrprint.error(-1, "Error", "ctnetlink is not available and the "
+                "location of the 'conntrack' tool is not set.");
+        return(-1);
+    }
+
+    for(i = 0; i < n; i++)
+    {
+        a = 0;
+        args[a++] = cnf->conntrack_location;
+        args[a++] = "-D";
+
+        if(filter[i].src_ip[0] != '\0')
+        {
+            args[a++] = "-s";
+            args[a++] = filter[i].src_ip;
+        }
+        if(filter[i].dst_ip[0] != '\0')
+        {
+            args[a++] = "-d";
+            args[a++] = filter[i].dst_ip;
+        }
+        if(filter[i].protocol != 0)
+        {
+            if((proto_ptr = getprotobynumber(filter[i].protocol)) != NULL)
+                (void)strlcpy(proto_str, proto_ptr->p_name, sizeof(proto_str));
+            else
+                snprintf(proto_str, sizeof(proto_str), "%d", filter[i].protocol);
+
+            args[a++] = "-p";
+            args[a++] = proto_str;
+
+            /* the tool only knows ports with a protocol */
+            if(filter[i].src_port != 0)
+            {
+                snprintf(sp_str, sizeof(sp_str), "%d", filter[i].src_port);
+                args[a++] = "--orig-port-src";
+                args[a++] = sp_str;
+            }
+            if(filter[i].dst_port != 0)
+            {
+                snprintf(dp_str, sizeof(dp_str), "%d", filter[i].dst_port);
+                args[a++] = "--orig-port-dst";
+                args[a++] = dp_str;
+            }
+        }
+        if(filter[i].mark_mask != 0)
+        {
+            snprintf(mark_str, sizeof(mark_str), "%u/%u",
+                    filter[i].mark, filter[i].mark_mask);
+            args[a++] = "-m";
+            args[a++] = mark_str;
+        }
+        args[a] = NULL;
+
+        result = libvuurmuur_exec_command(debuglvl, cnf, cnf->conntrack_location, args, NULL);
+
+        /* the tool doesn't tell us how many flows it removed */
+        stats->matched++;
+        if(result == 0)
+            stats->killed++;
+        else
+            stats->failed++;
+
+        if(progress != NULL)
+            progress(ctx, i + 1, n);
+    }
+
+    return(0);
+}
+
+
+/*  conn_kill
+
+    Kills all connections that match one of the 'n' filters. The
+    fields of a filter that are empty or zero match everything, but a
+    filter that matches all connections is refused. 'progress' is
+    called with the number of flows that were handled so far, it may
+    be NULL.
+
+    Returncodes:
+         0: ok, see 'stats' for the result
+        -1: error
+*/
+int
+conn_kill(const int debuglvl, struct vuurmuur_config *cnf, VR_ConnKillFilter *filter,
+        unsigned int n, VR_ConnKillStats *stats, VR_ConnKillProgress progress, void *ctx)
+{
+    struct ConnKillFilters_ filters;
+    int                     result = 0;
+
+    /* safety */
+    if(cnf == NULL || stats == NULL || (filter == NULL && n > 0))
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    if(n == 0)
+        return(0);
+
+    if(connkill_filters_setup(debuglvl, &filters, filter, n) < 0)
+        return(-1);
+
+    result = connkill_netlink(debuglvl, &filters, stats, progress, ctx);
+    connkill_filters_cleanup(&filters);
+
+    if(result == -2)
+    {
+        memset(stats, 0, sizeof(*stats));
+        result = connkill_exec(debuglvl, cnf, filter, n, stats, progress, ctx);
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "matched %u, killed %u, gone %u, failed %u.",
+                stats->matched, stats->killed, stats->gone, stats->failed);
+    return(result);
+}
@@ -0,0 +1,391 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <stdint.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*
+    The control channel
+
+    The daemon listens on a unix socket (CONTROL_SOCKET) for requests of
+    the other tools, so they don't have to poll the shared memory. Every
+    message is a frame: a ControlHeader_ followed by 'len' bytes of data.
+    A request gets zero or more CONTROL_PROGRESS and CONTROL_DATA replies,
+    and always ends with a CONTROL_RESULT reply. The connection can be
+    used for more requests after that.
+
+    Only root can connect: the socket is mode 0600, and the daemon checks
+    the credentials of the peer as well.
+*/
+
+#define CONTROL_MAGIC   0x56524354U     /* VRCT */
+
+struct ControlHeader_
+{
+    uint32_t    magic;
+    uint32_t    type;
+    uint32_t    len;
+};
+
+
+static int
+control_sockaddr(const char *path, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+
+    if(strlcpy(addr->sun_path, path, sizeof(addr->sun_path)) >= sizeof(addr->sun_path))
+    {
+        (void)vrprint.error(-1, "Internal Error", "socket path '%s' too long (in: %s:%d).",
+                path, __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  control_listen
+
+    Creates the socket the daemon listens on. An old socket at 'path'
+    is removed first.
+
+    Returncodes:
+        the socket
+        -1: error
+*/
+int
+control_listen(const int debuglvl, const char *path)
+{
+    struct sockaddr_un  addr;
+    int                 fd = -1;
+    mode_t              old_umask = 0;
+
+    if(path == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(control_sockaddr(path, &addr) < 0)
+        return(-1);
+
+    if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "creating socket failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if(unlink(path) == -1 && errno != ENOENT)
+    {
+        (void)vrprint.error(-1, "Error", "removing old socket '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        (void)close(fd);
+        return(-1);
+    }
+
+    /* only root may connect */
+    old_umask = umask(0077);
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "binding socket '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        (void)umask(old_umask);
+        (void)close(fd);
+        return(-1);
+    }
+    (void)umask(old_umask);
+
+    if(listen(fd, 8) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "listening on socket '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        (void)close(fd);
+        (void)unlink(path);
+        return(-1);
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "listening on '%s'.", path);
+
+    return(fd);
+}
+
+
+/*  control_connect
+
+    Connects to the daemon. Failing is not an error: the daemon may not
+    be running, or be an older version without the control channel.
+
+    Returncodes:
+        the socket
+        -1: not connected
+*/
+int
+control_connect(const int debuglvl, const char *path)
+{
+    struct sockaddr_un  addr;
+    struct stat         st;
+    int                 fd = -1;
+
+    if(path == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(control_sockaddr(path, &addr) < 0)
+        return(-1);
+
+    /* only talk to a socket of root */
+    if(lstat(path, &st) == -1 || !S_ISSOCK(st.st_mode) || st.st_uid != 0)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "no usable socket at '%s'.", path);
+        return(-1);
+    }
+
+    if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "creating socket failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "connecting to '%s' failed: %s.", path, strerror(errno));
+        (void)close(fd);
+        return(-1);
+    }
+
+    return(fd);
+}
+
+
+/*  control_send
+
+    Sends one frame. Never raises SIGPIPE when the peer is gone.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+control_send(const int debuglvl, int fd, int type, const void *data, size_t len)
+{
+    struct ControlHeader_   hdr;
+    struct iovec            iov[2];
+    struct msghdr           msg;
+    ssize_t                 sent = 0;
+
+    if(fd < 0 || len > CONTROL_MAX_DATA || (len > 0 && data == NULL))
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    hdr.magic = CONTROL_MAGIC;
+    hdr.type = (uint32_t)type;
+    hdr.len = (uint32_t)len;
+
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = (void *)data;
+    iov[1].iov_len = len;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = len > 0 ? 2 : 1;
+
+    /* frames are small, so a short write means the peer is stuck */
+    do
+    {
+        sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    }
+    while(sent == -1 && errno == EINTR);
+
+    if(sent != (ssize_t)(sizeof(hdr) + len))
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "sending frame failed: %s.",
+                    sent == -1 ? strerror(errno) : "short write");
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/* read exactly 'len' bytes, waiting at most 'timeout' ms for each part */
+static int
+control_read(int fd, void *buf, size_t len, int timeout)
+{
+    struct pollfd   pfd;
+    ssize_t         n = 0;
+    size_t          done = 0;
+    int             result = 0;
+
+    while(done < len)
+    {
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        result = poll(&pfd, 1, timeout);
+        if(result == -1 && errno == EINTR)
+            continue;
+        if(result <= 0)
+            return(-1);
+
+        n = read(fd, (char *)buf + done, len - done);
+        if(n == -1 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return(-1);
+
+        done += (size_t)n;
+    }
+
+    return(0);
+}
+
+
+/*  control_recv
+
+    Receives one frame. 'data' is always '\0' terminated, so text can be
+    used directly. 'timeout' is in milliseconds, -1 waits forever.
+
+    Returncodes:
+        >= 0: length of the data
+        -1: error, timeout or connection closed
+*/
+int
+control_recv(const int debuglvl, int fd, int *type, char *data, size_t size, int timeout)
+{
+    struct ControlHeader_   hdr;
+
+    if(fd < 0 || type == NULL || data == NULL || size == 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(control_read(fd, &hdr, sizeof(hdr), timeout) < 0)
+        return(-1);
+
+    if(hdr.magic != CONTROL_MAGIC || hdr.len > CONTROL_MAX_DATA || hdr.len >= size)
+    {
+        (void)vrprint.error(-1, "Error", "invalid frame on the control channel (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(hdr.len > 0 && control_read(fd, data, hdr.len, timeout) < 0)
+        return(-1);
+    data[hdr.len] = '\0';
+
+    *type = (int)hdr.type;
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "type %d, len %u.", *type, hdr.len);
+
+    return((int)hdr.len);
+}
+
+
+/*  control_request
+
+    Sends request 'type' with the optional text 'arg' to the daemon at
+    'path' and waits for the result. For every CONTROL_PROGRESS and
+    CONTROL_DATA reply 'cb' is called, if set.
+
+    Returncodes:
+         1: done, 'result' contains the VR_RR_* result
+         0: the daemon could not be reached, use the old ways
+        -1: error
+*/
+int
+control_request(const int debuglvl, const char *path, int type, const char *arg,
+        int (*cb)(const int debuglvl, void *ctx, int type, char *data, size_t len),
+        void *ctx, int *result)
+{
+    int     fd = -1,
+            reply_type = 0,
+            len = 0,
+            value = 0;
+    char    data[CONTROL_MAX_DATA + 1] = "";
+
+    if(path == NULL || result == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if((fd = control_connect(debuglvl, path)) < 0)
+        return(0);
+
+    if(control_send(debuglvl, fd, type, arg, arg ? strlen(arg) : 0) < 0)
+    {
+        /* the daemon went away between connect and send */
+        (void)close(fd);
+        return(0);
+    }
+
+    /* a reload sends progress between the steps, so this is per step */
+    while((len = control_recv(debuglvl, fd, &reply_type, data, sizeof(data), 300000)) >= 0)
+    {
+        if(reply_type == CONTROL_RESULT || reply_type == CONTROL_PROGRESS)
+        {
+            if(len != (int)sizeof(value))
+                break;
+            memcpy(&value, data, sizeof(value));
+        }
+
+        if(reply_type == CONTROL_RESULT)
+        {
+            *result = value;
+            (void)close(fd);
+            return(1);
+        }
+
+        if(cb != NULL && cb(debuglvl, ctx, reply_type, data, (size_t)len) < 0)
+            break;
+    }
+
+    (void)vrprint.error(-1, "Error", "no result from the daemon on the control channel (in: %s:%d).",
+            __FUNC__, __LINE__);
+    (void)close(fd);
+    return(-1);
+}
@@ -0,0 +1,455 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+#include <sys/wait.h>
+
+/* number of rows in the chain hash. We only have a handful of chains per
+   interface, so this is plenty. */
+#define IPT_COUNTERS_HASH_ROWS  64
+
+
+static void
+ipt_counters_rule_free(void *data)
+{
+    IptCounterRule  *rule_ptr = (IptCounterRule *)data;
+
+    if(rule_ptr == NULL)
+        return;
+
+    free(rule_ptr->rule);
+    free(rule_ptr);
+}
+
+
+static void
+ipt_counters_chain_free(void *data)
+{
+    IptCounterChain *chain_ptr = (IptCounterChain *)data;
+
+    if(chain_ptr == NULL)
+        return;
+
+    (void)d_list_cleanup(0, &chain_ptr->rules);
+    free(chain_ptr);
+}
+
+
+static int
+compare_chainname(const void *table_data, const void *search_data)
+{
+    const IptCounterChain   *chain_ptr = (const IptCounterChain *)table_data;
+
+    if(table_data == NULL || search_data == NULL)
+        return(0);
+
+    if(strcmp(chain_ptr->name, (const char *)search_data) == 0)
+        return(1);
+
+    return(0);
+}
+
+
+/*  ipt_counters_add_chain
+
+    Handles a ':<chain> <policy> [<packets>:<bytes>]' line.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+ipt_counters_add_chain(const int debuglvl, IptCounters *counters, char *line)
+{
+    IptCounterChain *chain_ptr = NULL;
+    char            policy[16] = "";
+
+    if(!(chain_ptr = malloc(sizeof(IptCounterChain))))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    memset(chain_ptr, 0, sizeof(IptCounterChain));
+    (void)d_list_setup(debuglvl, &chain_ptr->rules, ipt_counters_rule_free);
+
+    /* user defined chains have policy '-' and always [0:0] */
+    if(sscanf(line, ":%31s %15s [%llu:%llu]", chain_ptr->name, policy,
+                &chain_ptr->packets, &chain_ptr->bytes) < 1)
+    {
+        (void)vrprint.error(-1, "Internal Error", "malformed chain line "
+                "'%s' (in: %s:%d).", line, __FUNC__, __LINE__);
+        free(chain_ptr);
+        return(-1);
+    }
+
+    if(d_list_append(debuglvl, &counters->chains, chain_ptr) == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "d_list_append() "
+                "failed (in: %s:%d).", __FUNC__, __LINE__);
+        ipt_counters_chain_free(chain_ptr);
+        return(-1);
+    }
+
+    if(hash_insert(debuglvl, &counters->chain_hash, chain_ptr) < 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "hash_insert() "
+                "failed (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  ipt_counters_add_rule
+
+    Handles a '[<packets>:<bytes>] -A <chain> <rule>' line.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+ipt_counters_add_rule(const int debuglvl, IptCounters *counters, char *line)
+{
+    IptCounterChain *chain_ptr = NULL;
+    IptCounterRule  *rule_ptr = NULL;
+    char            chain[32] = "",
+                    *spec = NULL,
+                    *token = NULL,
+                    *saveptr = NULL,
+                    *copy = NULL;
+    unsigned long long  packets = 0,
+                        bytes = 0;
+    int             pos = 0;
+    char            want_in = FALSE,
+                    want_out = FALSE;
+
+    if(sscanf(line, "[%llu:%llu] -A %31s %n", &packets, &bytes, chain, &pos) < 3 ||
+        pos == 0)
+    {
+        /* not a rule with counters, ignore */
+        return(0);
+    }
+    spec = line + pos;
+
+    if(!(chain_ptr = ipt_counters_get_chain(debuglvl, counters, chain)))
+    {
+        (void)vrprint.error(-1, "Internal Error", "rule for unknown chain "
+                "'%s' (in: %s:%d).", chain, __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(!(rule_ptr = malloc(sizeof(IptCounterRule))))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    memset(rule_ptr, 0, sizeof(IptCounterRule));
+    rule_ptr->packets = packets;
+    rule_ptr->bytes = bytes;
+
+    if(!(rule_ptr->rule = strdup(spec)) || !(copy = strdup(spec)))
+    {
+        (void)vrprint.error(-1, "Error", "strdup failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        ipt_counters_rule_free(rule_ptr);
+        return(-1);
+    }
+
+    /*  A rule is an interface counter if it only has '-i' and/or '-o'
+        before the target. This matches what we used to look for in
+        the output of 'iptables -vnL': no source, no destination,
+        protocol 'all'. */
+    rule_ptr->iface_only = TRUE;
+    for(token = strtok_r(copy, " ", &saveptr); token;
+        token = strtok_r(NULL, " ", &saveptr))
+    {
+        if(want_in == TRUE)
+        {
+            (void)strlcpy(rule_ptr->in_iface, token, sizeof(rule_ptr->in_iface));
+            want_in = FALSE;
+        }
+        else if(want_out == TRUE)
+        {
+            (void)strlcpy(rule_ptr->out_iface, token, sizeof(rule_ptr->out_iface));
+            want_out = FALSE;
+        }
+        else if(strcmp(token, "-i") == 0)
+            want_in = TRUE;
+        else if(strcmp(token, "-o") == 0)
+            want_out = TRUE;
+        else if(strcmp(token, "-j") == 0 || strcmp(token, "-g") == 0)
+            break;
+        else
+            rule_ptr->iface_only = FALSE;
+    }
+    free(copy);
+
+    if(rule_ptr->in_iface[0] == '\0' && rule_ptr->out_iface[0] == '\0')
+        rule_ptr->iface_only = FALSE;
+
+    if(d_list_append(debuglvl, &chain_ptr->rules, rule_ptr) == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "d_list_append() "
+                "failed (in: %s:%d).", __FUNC__, __LINE__);
+        ipt_counters_rule_free(rule_ptr);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  ipt_counters_load
+
+    Runs 'iptables-save -c' (or 'ip6tables-save -c') once for 'table' and
+    stores all chain and rule counters in 'counters'. The caller has to
+    call ipt_counters_cleanup() when done, also on error.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+ipt_counters_load(const int debuglvl, struct vuurmuur_config *cnf,
+        IptCounters *counters, int ipv, char *table)
+{
+    char    command[MAX_PIPE_COMMAND] = "",
+            line[1024] = "",
+            cur_table[16] = "";
+    char    *save_location = NULL;
+    FILE    *p = NULL;
+    int     retval = 0,
+            status = 0;
+    size_t  len = 0;
+
+    /* safety */
+    if(cnf == NULL || counters == NULL || table == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    memset(counters, 0, sizeof(IptCounters));
+    counters->ipv = ipv;
+    (void)strlcpy(counters->table, table, sizeof(counters->table));
+
+    if(d_list_setup(debuglvl, &counters->chains, ipt_counters_chain_free) < 0)
+        return(-1);
+    if(hash_setup(debuglvl, &counters->chain_hash, IPT_COUNTERS_HASH_ROWS,
+            hash_name, compare_chainname) < 0)
+        return(-1);
+
+#ifdef IPV6_ENABLED
+    if(ipv == VR_IPV6)
+        save_location = cnf->ip6tablessave_location;
+    else
+#endif
+        save_location = cnf->iptablessave_location;
+
+    snprintf(command, sizeof(command), "%s -c -t %s 2>/dev/null",
+            save_location, table);
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "command: '%s'.", command);
+
+    if(!(p = popen(command, "r")))
+    {
+        (void)vrprint.error(-1, "Internal Error", "pipe failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    while(fgets(line, (int)sizeof(line), p) != NULL)
+    {
+        len = strlen(line);
+        if(len > 0 && line[len - 1] == '\n')
+            line[len - 1] = '\0';
+
+        if(line[0] == '*')
+        {
+            (void)strlcpy(cur_table, line + 1, sizeof(cur_table));
+            continue;
+        }
+
+        /* -t should make sure we only get our table, but be sure */
+        if(strcmp(cur_table, table) != 0)
+            continue;
+
+        if(line[0] == ':')
+        {
+            if(ipt_counters_add_chain(debuglvl, counters, line) < 0)
+            {
+                retval = -1;
+                break;
+            }
+        }
+        else if(line[0] == '[')
+        {
+            if(ipt_counters_add_rule(debuglvl, counters, line) < 0)
+            {
+                retval = -1;
+                break;
+            }
+        }
+    }
+
+    /* drain the pipe if we bailed out early */
+    while(retval != 0 && fgets(line, (int)sizeof(line), p) != NULL);
+
+    /* a failing iptables-save gives us nothing to parse, that is not
+     * an empty table */
+    status = pclose(p);
+    if(retval == 0 && (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0))
+    {
+        (void)vrprint.warning("Warning", "'%s' failed.", command);
+        retval = -1;
+    }
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "table %s: %u chains.",
+                table, counters->chains.len);
+
+    return(retval);
+}
+
+
+/*  ipt_counters_cleanup
+
+    Frees all memory of a snapshot loaded by ipt_counters_load().
+*/
+void
+ipt_counters_cleanup(const int debuglvl, IptCounters *counters)
+{
+    if(counters == NULL)
+        return;
+
+    if(counters->chain_hash.table != NULL)
+        (void)hash_cleanup(debuglvl, &counters->chain_hash);
+
+    (void)d_list_cleanup(debuglvl, &counters->chains);
+
+    memset(counters, 0, sizeof(IptCounters));
+}
+
+
+/*  ipt_counters_get_chain
+
+    Returns the chain with name 'chain' or NULL if it is not in the
+    snapshot.
+*/
+IptCounterChain *
+ipt_counters_get_chain(const int debuglvl, IptCounters *counters, const char *chain)
+{
+    if(counters == NULL || chain == NULL || counters->chain_hash.table == NULL)
+        return(NULL);
+
+    return(hash_search(debuglvl, &counters->chain_hash, (void *)chain));
+}
+
+
+/*  ipt_counters_get_iface
+
+    Snapshot version of get_iface_stats_from_ipt(): get the counters of
+    the rules in 'chain' that match only on 'iface_name' as in- or
+    outgoing interface.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+ipt_counters_get_iface(const int debuglvl, IptCounters *counters,
+        const char *iface_name, const char *chain,
+        unsigned long long *recv_packets, unsigned long long *recv_bytes,
+        unsigned long long *trans_packets, unsigned long long *trans_bytes)
+{
+    IptCounterChain *chain_ptr = NULL;
+    IptCounterRule  *rule_ptr = NULL;
+    d_list_node     *d_node = NULL;
+    char            trans_done = 0,
+                    recv_done = 0;
+
+    if(counters == NULL || iface_name == NULL || chain == NULL ||
+        recv_packets == NULL || recv_bytes == NULL ||
+        trans_packets == NULL || trans_bytes == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    *trans_bytes = 0;
+    *recv_bytes = 0;
+    *trans_packets = 0;
+    *recv_packets = 0;
+
+    /* if we are looking for the input or output numbers we can skip one direction,
+       if we need FORWARD, we need both */
+    if(strcmp(chain, "INPUT") == 0)
+        trans_done = 1;
+    else if(strcmp(chain, "OUTPUT") == 0)
+        recv_done = 1;
+
+    if(!(chain_ptr = ipt_counters_get_chain(debuglvl, counters, chain)))
+    {
+        if(debuglvl >= MEDIUM)
+            (void)vrprint.debug(__FUNC__, "chain '%s' not in snapshot.", chain);
+        return(0);
+    }
+
+    for(d_node = chain_ptr->rules.top;
+        d_node && (!recv_done || !trans_done);
+        d_node = d_node->next)
+    {
+        rule_ptr = d_node->data;
+
+        if(rule_ptr->iface_only == FALSE)
+            continue;
+
+        /* outgoing */
+        if(!trans_done && rule_ptr->in_iface[0] == '\0' &&
+            strcmp(rule_ptr->out_iface, iface_name) == 0)
+        {
+            *trans_packets = rule_ptr->packets;
+            *trans_bytes = rule_ptr->bytes;
+            trans_done = 1;
+        }
+        /* incoming */
+        else if(!recv_done && rule_ptr->out_iface[0] == '\0' &&
+            strcmp(rule_ptr->in_iface, iface_name) == 0)
+        {
+            *recv_packets = rule_ptr->packets;
+            *recv_bytes = rule_ptr->bytes;
+            recv_done = 1;
+        }
+    }
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "%s: %s: recv %llu/%llu trans %llu/%llu",
+                chain, iface_name, *recv_packets, *recv_bytes,
+                *trans_packets, *trans_bytes);
+
+    return(0);
+}
@@ -0,0 +1,842 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+
+/*
+    The flow store
+
+    vuurmuur_log writes a record for every connection that ended. The
+    store has two files per day (local time) in its directory:
+
+    flows-yyyymmdd          a header and then the fixed size records, in
+                            the order the connections ended.
+    flows-yyyymmdd.names    a header and then the names of the zones,
+                            networks, hosts and services, each ending
+                            with a '\0'. A record refers to a name by
+                            its offset in this file.
+
+    Both files are only appended to. Because the records are in the
+    order of their end time, a query finds the start of a time range
+    with a binary search. A record that was only partly written (a
+    crash) is ignored by the readers. The names are written unbuffered
+    and always before the records that use them.
+
+    Old days are removed by deleting their files, see flowstore_expire.
+*/
+
+#define FLOWSTORE_MAGIC         "VRMRFLOW"
+#define FLOWSTORE_NAMES_MAGIC   "VRMRFLNM"
+#define FLOWSTORE_VERSION       1
+
+/* rows in the name hash of the writer */
+#define FLOWSTORE_HASH_ROWS     1024
+
+/* a name of 0 is "": the offset of the header can't be a name */
+#define FLOWSTORE_NO_NAME       0
+
+struct FlowStoreHeader_
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    record_size;
+};
+
+struct FlowStoreRecord_
+{
+    uint32_t    end;
+    uint32_t    duration;
+    uint8_t     ipv;
+    uint8_t     protocol;
+    uint8_t     flags;
+    uint8_t     reserved1;
+    uint16_t    src_port;
+    uint16_t    dst_port;
+    uint8_t     src[16];
+    uint8_t     dst[16];
+    uint32_t    from_name;
+    uint32_t    to_name;
+    uint32_t    ser_name;
+    uint32_t    reserved2;
+    uint64_t    out_packets;
+    uint64_t    out_bytes;
+    uint64_t    in_packets;
+    uint64_t    in_bytes;
+};
+
+/* the writer keeps the names of the day */
+struct FlowStoreName_
+{
+    /* this should always be on top: we hash on it */
+    char        name[MAX_HOST_NET_ZONE];
+    uint32_t    offset;
+};
+
+
+static int
+flowstore_compare_name(const void *table_data, const void *search_data)
+{
+    const struct FlowStoreName_ *name_ptr = (const struct FlowStoreName_ *)table_data;
+
+    if(table_data == NULL || search_data == NULL)
+        return(0);
+
+    if(strcmp(name_ptr->name, (const char *)search_data) == 0)
+        return(1);
+
+    return(0);
+}
+
+
+/* yyyymmdd of 't' in local time */
+static unsigned int
+flowstore_day(time_t t)
+{
+    struct tm   tm;
+
+    if(localtime_r(&t, &tm) == NULL)
+        return(0);
+
+    return((unsigned int)((tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday));
+}
+
+
+static void
+flowstore_path(char *path, size_t size, const char *dir, unsigned int day, char names)
+{
+    snprintf(path, size, "%s/flows-%08u%s", dir, day, names ? ".names" : "");
+}
+
+
+static void
+flowstore_close_day(const int debuglvl, FlowStore *store)
+{
+    if(store->rec_fp != NULL)
+        (void)fclose(store->rec_fp);
+    if(store->names_fp != NULL)
+        (void)fclose(store->names_fp);
+    store->rec_fp = NULL;
+    store->names_fp = NULL;
+    store->names_size = 0;
+    store->day = 0;
+
+    if(store->name_hash.table != NULL)
+        (void)hash_cleanup(debuglvl, &store->name_hash);
+    (void)d_list_cleanup(debuglvl, &store->names);
+}
+
+
+static int
+flowstore_add_name(const int debuglvl, FlowStore *store, const char *name, uint32_t offset)
+{
+    struct FlowStoreName_   *name_ptr = NULL;
+
+    if(!(name_ptr = malloc(sizeof(struct FlowStoreName_))))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    (void)strlcpy(name_ptr->name, name, sizeof(name_ptr->name));
+    name_ptr->offset = offset;
+
+    if(d_list_append(debuglvl, &store->names, name_ptr) == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "d_list_append() "
+                "failed (in: %s:%d).", __FUNC__, __LINE__);
+        free(name_ptr);
+        return(-1);
+    }
+
+    if(hash_insert(debuglvl, &store->name_hash, name_ptr) < 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "hash_insert() "
+                "failed (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  flowstore_open_file
+
+    Opens 'path' for appending and writes the header if the file is new.
+    An existing file has to start with the header 'hdr'.
+*/
+static FILE *
+flowstore_open_file(const char *path, const void *hdr, size_t hdr_size)
+{
+    FILE    *fp = NULL;
+    char    buf[sizeof(struct FlowStoreHeader_)];
+    long    size = 0;
+    int     fd = -1;
+
+    /* like the traffic volume, only for root */
+    if((fd = open(path, O_RDWR|O_APPEND|O_CREAT, 0600)) == -1 ||
+       !(fp = fdopen(fd, "a+")))
+    {
+        (void)vrprint.error(-1, "Error", "opening '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        if(fd != -1)
+            (void)close(fd);
+        return(NULL);
+    }
+
+    if(fseek(fp, 0, SEEK_END) == -1 || (size = ftell(fp)) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "seeking in '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        (void)fclose(fp);
+        return(NULL);
+    }
+
+    if(size == 0)
+    {
+        if(fwrite(hdr, hdr_size, 1, fp) != 1 || fflush(fp) != 0)
+        {
+            (void)vrprint.error(-1, "Error", "writing to '%s' failed: %s (in: %s:%d).",
+                    path, strerror(errno), __FUNC__, __LINE__);
+            (void)fclose(fp);
+            return(NULL);
+        }
+        return(fp);
+    }
+
+    rewind(fp);
+    if(fread(buf, hdr_size, 1, fp) != 1 || memcmp(buf, hdr, hdr_size) != 0)
+    {
+        (void)vrprint.error(-1, "Error", "'%s' is not a valid flow store file "
+                "(in: %s:%d).", path, __FUNC__, __LINE__);
+        (void)fclose(fp);
+        return(NULL);
+    }
+    (void)fseek(fp, 0, SEEK_END);
+
+    return(fp);
+}
+
+
+/*  flowstore_open_day
+
+    Opens the files of 'day' for writing. The names that are already in
+    the names file are read back, so a restarted writer adds to them.
+*/
+static int
+flowstore_open_day(const int debuglvl, FlowStore *store, unsigned int day)
+{
+    struct FlowStoreHeader_ hdr;
+    char                    path[PATH_MAX] = "",
+                            name[MAX_HOST_NET_ZONE] = "";
+    size_t                  len = 0;
+    unsigned long           offset = 0;
+    long                    size = 0;
+    int                     c = 0;
+
+    flowstore_close_day(debuglvl, store);
+
+    if(d_list_setup(debuglvl, &store->names, free) < 0 ||
+       hash_setup(debuglvl, &store->name_hash, FLOWSTORE_HASH_ROWS,
+            hash_name, flowstore_compare_name) < 0)
+    {
+        flowstore_close_day(debuglvl, store);
+        return(-1);
+    }
+
+    /* the names */
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, FLOWSTORE_NAMES_MAGIC, sizeof(hdr.magic));
+    hdr.version = FLOWSTORE_VERSION;
+
+    flowstore_path(path, sizeof(path), store->dir, day, TRUE);
+    if(!(store->names_fp = flowstore_open_file(path, &hdr, sizeof(hdr))))
+    {
+        flowstore_close_day(debuglvl, store);
+        return(-1);
+    }
+
+    (void)fseek(store->names_fp, (long)sizeof(hdr), SEEK_SET);
+    offset = sizeof(hdr);
+
+    while((c = fgetc(store->names_fp)) != EOF)
+    {
+        if(c != '\0')
+        {
+            if(len < sizeof(name) - 1)
+                name[len] = (char)c;
+            len++;
+            continue;
+        }
+
+        name[len < sizeof(name) - 1 ? len : sizeof(name) - 1] = '\0';
+        if(flowstore_add_name(debuglvl, store, name, (uint32_t)offset) < 0)
+        {
+            flowstore_close_day(debuglvl, store);
+            return(-1);
+        }
+        offset += len + 1;
+        len = 0;
+    }
+    /* a name without its '\0' was cut off: skip it */
+    if(len > 0)
+    {
+        (void)fseek(store->names_fp, 0, SEEK_END);
+        (void)fputc('\0', store->names_fp);
+        offset += len + 1;
+    }
+    store->names_size = offset;
+
+    /* the records */
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, FLOWSTORE_MAGIC, sizeof(hdr.magic));
+    hdr.version = FLOWSTORE_VERSION;
+    hdr.record_size = sizeof(struct FlowStoreRecord_);
+
+    flowstore_path(path, sizeof(path), store->dir, day, FALSE);
+    if(!(store->rec_fp = flowstore_open_file(path, &hdr, sizeof(hdr))))
+    {
+        flowstore_close_day(debuglvl, store);
+        return(-1);
+    }
+
+    /* drop a record that was cut off, or all that follow would be off */
+    size = ftell(store->rec_fp);
+    if(size > (long)sizeof(hdr) &&
+       (size - (long)sizeof(hdr)) % (long)sizeof(struct FlowStoreRecord_) != 0)
+    {
+        size -= (size - (long)sizeof(hdr)) % (long)sizeof(struct FlowStoreRecord_);
+        if(ftruncate(fileno(store->rec_fp), (off_t)size) == -1)
+        {
+            (void)vrprint.error(-1, "Error", "truncating '%s' failed: %s (in: %s:%d).",
+                    path, strerror(errno), __FUNC__, __LINE__);
+            flowstore_close_day(debuglvl, store);
+            return(-1);
+        }
+        (void)fseek(store->rec_fp, 0, SEEK_END);
+    }
+
+    store->day = day;
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "opened day %08u with %u names.",
+                day, store->names.len);
+
+    return(0);
+}
+
+
+/* the offset of 'name' in the names file, it's added if it's new */
+static int
+flowstore_name(const int debuglvl, FlowStore *store, const char *name, uint32_t *offset)
+{
+    struct FlowStoreName_   *name_ptr = NULL;
+    size_t                  len = 0;
+
+    if(name == NULL || name[0] == '\0')
+    {
+        *offset = FLOWSTORE_NO_NAME;
+        return(0);
+    }
+
+    if((name_ptr = hash_search(debuglvl, &store->name_hash, (void *)name)) != NULL)
+    {
+        *offset = name_ptr->offset;
+        return(0);
+    }
+
+    /* flush every name, so it's never behind a record that uses it */
+    len = strlen(name) + 1;
+    if(fwrite(name, len, 1, store->names_fp) != 1 || fflush(store->names_fp) != 0)
+    {
+        (void)vrprint.error(-1, "Error", "writing to the names of the flow store "
+                "failed: %s (in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    *offset = (uint32_t)store->names_size;
+    store->names_size += len;
+
+    return(flowstore_add_name(debuglvl, store, name, *offset));
+}
+
+
+static void
+flowstore_addr(int ipv, const char *ip, uint8_t *addr)
+{
+    memset(addr, 0, 16);
+    (void)inet_pton(ipv == VR_IPV6 ? AF_INET6 : AF_INET, ip, addr);
+}
+
+
+/*  flowstore_open
+
+    Prepares 'store' for writing to the flow store in 'dir', which is
+    created if it doesn't exist yet. The files of a day are opened when
+    the first record of that day is appended.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+flowstore_open(const int debuglvl, FlowStore *store, const char *dir)
+{
+    /* safety */
+    if(store == NULL || dir == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    memset(store, 0, sizeof(FlowStore));
+
+    if(strlcpy(store->dir, dir, sizeof(store->dir)) >= sizeof(store->dir))
+    {
+        (void)vrprint.error(-1, "Error", "flow store directory '%s' is too long "
+                "(in: %s:%d).", dir, __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(mkdir(dir, 0700) == -1 && errno != EEXIST)
+    {
+        (void)vrprint.error(-1, "Error", "creating the directory '%s' failed: %s "
+                "(in: %s:%d).", dir, strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  flowstore_close
+
+    Writes what is buffered and closes the files.
+*/
+void
+flowstore_close(const int debuglvl, FlowStore *store)
+{
+    if(store == NULL)
+        return;
+
+    flowstore_close_day(debuglvl, store);
+    memset(store, 0, sizeof(FlowStore));
+}
+
+
+/*  flowstore_append
+
+    Adds a record for 'flow' to the day it ended. The record is buffered:
+    call flowstore_flush when there is nothing more to add for now.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+flowstore_append(const int debuglvl, FlowStore *store, FlowRecord *flow)
+{
+    struct FlowStoreRecord_ rec;
+    unsigned int            day = 0;
+
+    /* safety */
+    if(store == NULL || flow == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    day = flowstore_day(flow->end);
+    if(day != store->day)
+    {
+        if(store->rec_fp != NULL && fflush(store->rec_fp) != 0)
+        {
+            (void)vrprint.error(-1, "Error", "writing to the flow store failed: %s "
+                    "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+        }
+
+        if(flowstore_open_day(debuglvl, store, day) < 0)
+            return(-1);
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.end = (uint32_t)flow->end;
+    rec.duration = flow->duration;
+    rec.ipv = (uint8_t)flow->ipv;
+    rec.protocol = (uint8_t)flow->protocol;
+    rec.flags = (uint8_t)flow->flags;
+    rec.src_port = (uint16_t)flow->src_port;
+    rec.dst_port = (uint16_t)flow->dst_port;
+    flowstore_addr(flow->ipv, flow->src_ip, rec.src);
+    flowstore_addr(flow->ipv, flow->dst_ip, rec.dst);
+    rec.out_packets = flow->out_packets;
+    rec.out_bytes = flow->out_bytes;
+    rec.in_packets = flow->in_packets;
+    rec.in_bytes = flow->in_bytes;
+
+    if(flowstore_name(debuglvl, store, flow->from_name, &rec.from_name) < 0 ||
+       flowstore_name(debuglvl, store, flow->to_name, &rec.to_name) < 0 ||
+       flowstore_name(debuglvl, store, flow->ser_name, &rec.ser_name) < 0)
+        return(-1);
+
+    if(fwrite(&rec, sizeof(rec), 1, store->rec_fp) != 1)
+    {
+        (void)vrprint.error(-1, "Error", "writing to the flow store failed: %s "
+                "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  flowstore_flush
+
+    Writes the buffered records to the files.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+flowstore_flush(const int debuglvl, FlowStore *store)
+{
+    if(store == NULL || store->rec_fp == NULL)
+        return(0);
+
+    if(fflush(store->rec_fp) != 0)
+    {
+        (void)vrprint.error(-1, "Error", "writing to the flow store failed: %s "
+                "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  flowstore_expire
+
+    Removes the files of the days that are more than 'days' days before
+    'now'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+flowstore_expire(const int debuglvl, const char *dir, unsigned int days, time_t now)
+{
+    DIR             *dirp = NULL;
+    struct dirent   *entry = NULL;
+    char            path[PATH_MAX] = "",
+                    *end = NULL;
+    unsigned int    oldest = 0;
+    unsigned long   day = 0;
+
+    /* safety */
+    if(dir == NULL || days == 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    oldest = flowstore_day(now - (time_t)days * 86400);
+
+    if(!(dirp = opendir(dir)))
+    {
+        if(errno == ENOENT)
+            return(0);
+
+        (void)vrprint.error(-1, "Error", "opening '%s' failed: %s (in: %s:%d).",
+                dir, strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    while((entry = readdir(dirp)) != NULL)
+    {
+        if(strncmp(entry->d_name, "flows-", 6) != 0)
+            continue;
+
+        day = strtoul(entry->d_name + 6, &end, 10);
+        if(end != entry->d_name + 14 || (*end != '\0' && strcmp(end, ".names") != 0))
+            continue;
+
+        if(day >= oldest)
+            continue;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if(unlink(path) == -1)
+        {
+            (void)vrprint.warning("Warning", "removing '%s' failed: %s.",
+                    path, strerror(errno));
+            continue;
+        }
+
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "removed '%s'.", path);
+    }
+
+    (void)closedir(dirp);
+    return(0);
+}
+
+
+/* maps 'path' read-only, 1 if it doesn't exist */
+static int
+flowstore_map(const char *path, char **map, size_t *size)
+{
+    struct stat st;
+    int         fd = -1;
+
+    *map = NULL;
+    *size = 0;
+
+    if((fd = open(path, O_RDONLY)) == -1)
+    {
+        if(errno == ENOENT)
+            return(1);
+
+        (void)vrprint.error(-1, "Error", "opening '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+    {
+        (void)vrprint.error(-1, "Error", "'%s' is not a regular file (in: %s:%d).",
+                path, __FUNC__, __LINE__);
+        (void)close(fd);
+        return(-1);
+    }
+
+    if(st.st_size < (off_t)sizeof(struct FlowStoreHeader_))
+    {
+        (void)close(fd);
+        return(1);
+    }
+
+    *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    (void)close(fd);
+
+    if(*map == MAP_FAILED)
+    {
+        (void)vrprint.error(-1, "Error", "mapping '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        *map = NULL;
+        return(-1);
+    }
+
+    *size = (size_t)st.st_size;
+    return(0);
+}
+
+
+static const char *
+flowstore_get_name(const char *names, size_t size, uint32_t offset)
+{
+    if(names == NULL || offset == FLOWSTORE_NO_NAME || offset >= size ||
+       offset < sizeof(struct FlowStoreHeader_))
+        return("");
+
+    /* the last name may be cut off */
+    if(memchr(names + offset, '\0', size - offset) == NULL)
+        return("");
+
+    return(names + offset);
+}
+
+
+/*  flowstore_query_day
+
+    Calls 'cb' for the records of 'day' that ended from 'from' up to and
+    including 'to'.
+
+    Returncodes:
+         0: ok
+         1: stopped by the callback
+        -1: error
+*/
+static int
+flowstore_query_day(const int debuglvl, const char *dir, unsigned int day,
+        time_t from, time_t to, int (*cb)(void *ctx, FlowRecord *flow), void *ctx)
+{
+    struct FlowStoreHeader_ *hdr = NULL;
+    struct FlowStoreRecord_ *recs = NULL,
+                            *rec = NULL;
+    FlowRecord              flow;
+    char                    path[PATH_MAX] = "",
+                            *map = NULL,
+                            *names = NULL;
+    size_t                  size = 0,
+                            names_size = 0,
+                            nrecs = 0,
+                            lo = 0,
+                            hi = 0,
+                            mid = 0;
+    int                     retval = 0,
+                            result = 0,
+                            family = 0;
+
+    flowstore_path(path, sizeof(path), dir, day, FALSE);
+    if((result = flowstore_map(path, &map, &size)) != 0)
+        return(result > 0 ? 0 : -1);
+
+    hdr = (struct FlowStoreHeader_ *)map;
+    if(memcmp(hdr->magic, FLOWSTORE_MAGIC, sizeof(hdr->magic)) != 0 ||
+       hdr->version != FLOWSTORE_VERSION ||
+       hdr->record_size != sizeof(struct FlowStoreRecord_))
+    {
+        (void)vrprint.error(-1, "Error", "'%s' is not a valid flow store file "
+                "(in: %s:%d).", path, __FUNC__, __LINE__);
+        (void)munmap(map, size);
+        return(-1);
+    }
+
+    /* without the names we still have the addresses */
+    flowstore_path(path, sizeof(path), dir, day, TRUE);
+    if(flowstore_map(path, &names, &names_size) < 0)
+        names = NULL;
+
+    recs = (struct FlowStoreRecord_ *)(map + sizeof(*hdr));
+    nrecs = (size - sizeof(*hdr)) / sizeof(struct FlowStoreRecord_);
+
+    /* the first record that ended at or after 'from' */
+    lo = 0;
+    hi = nrecs;
+    while(lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if((time_t)recs[mid].end < from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "day %08u: %lu records, starting at %lu.",
+                day, (unsigned long)nrecs, (unsigned long)lo);
+
+    for(rec = recs + lo; rec < recs + nrecs && (time_t)rec->end <= to; rec++)
+    {
+        memset(&flow, 0, sizeof(flow));
+        flow.end = (time_t)rec->end;
+        flow.duration = rec->duration;
+        flow.ipv = rec->ipv;
+        flow.protocol = rec->protocol;
+        flow.flags = rec->flags;
+        flow.src_port = rec->src_port;
+        flow.dst_port = rec->dst_port;
+
+        family = (rec->ipv == VR_IPV6) ? AF_INET6 : AF_INET;
+        (void)inet_ntop(family, rec->src, flow.src_ip, sizeof(flow.src_ip));
+        (void)inet_ntop(family, rec->dst, flow.dst_ip, sizeof(flow.dst_ip));
+
+        flow.from_name = flowstore_get_name(names, names_size, rec->from_name);
+        flow.to_name = flowstore_get_name(names, names_size, rec->to_name);
+        flow.ser_name = flowstore_get_name(names, names_size, rec->ser_name);
+
+        flow.out_packets = rec->out_packets;
+        flow.out_bytes = rec->out_bytes;
+        flow.in_packets = rec->in_packets;
+        flow.in_bytes = rec->in_bytes;
+
+        if((result = cb(ctx, &flow)) != 0)
+        {
+            retval = (result < 0) ? -1 : 1;
+            break;
+        }
+    }
+
+    if(names != NULL)
+        (void)munmap(names, names_size);
+    (void)munmap(map, size);
+
+    return(retval);
+}
+
+
+/*  flowstore_query
+
+    Calls 'cb' for every connection in the flow store in 'dir' that ended
+    from 'from' up to and including 'to', in the order they ended. The
+    names in the record are only valid during the call. When 'cb' returns
+    non-zero the query stops: below zero is an error.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+flowstore_query(const int debuglvl, const char *dir, time_t from, time_t to,
+        int (*cb)(void *ctx, FlowRecord *flow), void *ctx)
+{
+    struct tm       tm;
+    time_t          t = 0;
+    unsigned int    day = 0,
+                    last = 0;
+    int             result = 0;
+
+    /* safety */
+    if(dir == NULL || cb == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(to < from)
+        return(0);
+
+    last = flowstore_day(to);
+
+    /* walk the days at noon, so a change of the clock can't skip one */
+    if(localtime_r(&from, &tm) == NULL)
+        return(-1);
+    tm.tm_hour = 12;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+
+    for(t = mktime(&tm); t != (time_t)-1; )
+    {
+        day = flowstore_day(t);
+        if(day > last)
+            break;
+
+        if((result = flowstore_query_day(debuglvl, dir, day, from, to, cb, ctx)) != 0)
+            return(result < 0 ? -1 : 0);
+
+        tm.tm_mday++;
+        tm.tm_hour = 12;
+        tm.tm_isdst = -1;
+        t = mktime(&tm);
+    }
+
+    return(0);
+}
@@ -216,6 +216,86 @@ hash_remove(const int debuglvl, Hash *hash_table, void *data)
 }
 
 
+/*  hash_insert_key
+
+    Like hash_insert, but the row is determined by hashing 'key' instead
+    of 'data'. This way objects can be indexed by one of their members
+    (e.g. their name) and found with hash_search(key), as long as the
+    compare function compares the table data against such a key.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+hash_insert_key(const int debuglvl, Hash *hash_table, const void *key, const void *data)
+{
+    unsigned int    row = 0;
+
+    /* safety */
+    if(!hash_table || !key || !data)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    row = hash_table->hash_func(key) % hash_table->rows;
+
+    if(!(d_list_append(debuglvl, &hash_table->table[row], data)))
+    {
+        (void)vrprint.error(-1, "Internal Error", "appending to the list failed (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    hash_table->cells++;
+    return(0);
+}
+
+
+/*  hash_remove_key
+
+    Removes 'data' that was inserted with hash_insert_key under 'key'.
+    Unlike hash_remove the data is matched by pointer, so of two objects
+    with the same key the right one is removed.
+
+    Returncodes:
+         0: ok
+        -1: error or not found
+*/
+int
+hash_remove_key(const int debuglvl, Hash *hash_table, const void *key, const void *data)
+{
+    d_list_node     *d_node = NULL;
+    unsigned int    row = 0;
+
+    /* safety */
+    if(!hash_table || !key || !data)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    row = hash_table->hash_func(key) % hash_table->rows;
+
+    for(d_node = hash_table->table[row].top; d_node; d_node = d_node->next)
+    {
+        if(d_node->data == data)
+        {
+            if(d_list_remove_node(debuglvl, &hash_table->table[row], d_node) < 0)
+            {
+                (void)vrprint.error(-1, "Internal Error", "removing from the list failed (in: %s:%d).", __FUNC__, __LINE__);
+                return(-1);
+            }
+
+            hash_table->cells--;
+            return(0);
+        }
+    }
+
+    return(-1);
+}
+
+
 /*  hash_search
 
     Returns a pointer to the data if found, NULL if not found.
@@ -445,6 +525,27 @@ hash_string(const void *key)
     return(retval);
 }
 
+/*  hash_name
+
+    Hashes the whole string (djb2), unlike hash_string which only
+    looks at the first character. Use this for tables that may hold
+    many names with the same first letter.
+*/
+unsigned int
+hash_name(const void *key)
+{
+    const unsigned char *str_ptr = NULL;
+    unsigned int        retval = 5381;
+
+    if(!key)
+        return(1);
+
+    for(str_ptr = (const unsigned char *)key; *str_ptr != '\0'; str_ptr++)
+        retval = ((retval << 5) + retval) + *str_ptr;
+
+    return(retval);
+}
+
 int compare_string(const void *string1, const void *string2)
 {
     char *str1_ptr, *str2_ptr;
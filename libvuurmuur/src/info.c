@@ -153,7 +153,7 @@ determine_action(const int debuglvl, char *query, char *action, size_t size, str
 
 
 int
-get_ip_info(const int debuglvl, char *name, struct ZoneData_ *answer_ptr, struct rgx_ *reg)
+get_ip_info(const int debuglvl, struct BackendFunctions_ *f, void *backend, char *name, struct ZoneData_ *answer_ptr, struct rgx_ *reg)
 {
     int retval = 0,
         result = 0;
@@ -173,7 +173,7 @@ get_ip_info(const int debuglvl, char *name, struct ZoneData_ *answer_ptr, struct
         case TYPE_HOST:
 
             /* ask the ipaddress for this host */
-            result = zf->ask(debuglvl, zone_backend, name, "IPADDRESS", answer_ptr->ipv4.ipaddress, sizeof(answer_ptr->ipv4.ipaddress), TYPE_HOST, 0);
+            result = f->ask(debuglvl, backend, name, "IPADDRESS", answer_ptr->ipv4.ipaddress, sizeof(answer_ptr->ipv4.ipaddress), TYPE_HOST, 0);
             if(result < 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "zf->ask() failed (in: %s:%d).",
@@ -192,7 +192,7 @@ get_ip_info(const int debuglvl, char *name, struct ZoneData_ *answer_ptr, struct
 
 #ifdef IPV6_ENABLED
             /* ask the ipaddress for this host */
-            result = zf->ask(debuglvl, zone_backend, name, "IPV6ADDRESS", answer_ptr->ipv6.ip6, sizeof(answer_ptr->ipv6.ip6), TYPE_HOST, 0);
+            result = f->ask(debuglvl, backend, name, "IPV6ADDRESS", answer_ptr->ipv6.ip6, sizeof(answer_ptr->ipv6.ip6), TYPE_HOST, 0);
             if(result < 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "zf->ask() failed (in: %s:%d).",
@@ -216,7 +216,7 @@ get_ip_info(const int debuglvl, char *name, struct ZoneData_ *answer_ptr, struct
             if(debuglvl >= HIGH)
                 (void)vrprint.debug(__FUNC__, "get network_ip for '%s', max_size: %d.", name, sizeof(answer_ptr->ipv4.network));
 
-            result = zf->ask(debuglvl, zone_backend, name, "NETWORK", answer_ptr->ipv4.network, sizeof(answer_ptr->ipv4.network), TYPE_NETWORK, 0);
+            result = f->ask(debuglvl, backend, name, "NETWORK", answer_ptr->ipv4.network, sizeof(answer_ptr->ipv4.network), TYPE_NETWORK, 0);
             if(result < 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "zf->ask() failed (in: %s:%d).",
@@ -227,7 +227,7 @@ get_ip_info(const int debuglvl, char *name, struct ZoneData_ *answer_ptr, struct
             /*
                 netmask
             */
-            result = zf->ask(debuglvl, zone_backend, name, "NETMASK", answer_ptr->ipv4.netmask, sizeof(answer_ptr->ipv4.netmask), TYPE_NETWORK, 0);
+            result = f->ask(debuglvl, backend, name, "NETMASK", answer_ptr->ipv4.netmask, sizeof(answer_ptr->ipv4.netmask), TYPE_NETWORK, 0);
             if(result < 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "zf->ask() failed (in: %s:%d).",
@@ -247,7 +247,7 @@ get_ip_info(const int debuglvl, char *name, struct ZoneData_ *answer_ptr, struct
             }
 
 #ifdef IPV6_ENABLED
-            result = zf->ask(debuglvl, zone_backend, name, "IPV6NETWORK", answer_ptr->ipv6.net6, sizeof(answer_ptr->ipv6.net6), TYPE_NETWORK, 0);
+            result = f->ask(debuglvl, backend, name, "IPV6NETWORK", answer_ptr->ipv6.net6, sizeof(answer_ptr->ipv6.net6), TYPE_NETWORK, 0);
             if(result < 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "zf->ask() failed (in: %s:%d).",
@@ -256,7 +256,7 @@ get_ip_info(const int debuglvl, char *name, struct ZoneData_ *answer_ptr, struct
             }
 
             char cidrstr[4] = "";
-            result = zf->ask(debuglvl, zone_backend, name, "IPV6CIDR", cidrstr, sizeof(cidrstr), TYPE_NETWORK, 0);
+            result = f->ask(debuglvl, backend, name, "IPV6CIDR", cidrstr, sizeof(cidrstr), TYPE_NETWORK, 0);
             if(result < 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "zf->ask() failed (in: %s:%d).",
@@ -361,7 +361,7 @@ create_broadcast_ip(const int debuglvl, char *network, char *netmask, char *broa
         -1: error
  */
 int
-get_group_info(const int debuglvl, Zones *zones, char *groupname, struct ZoneData_ *answer_ptr)
+get_group_info(const int debuglvl, struct BackendFunctions_ *f, void *backend, Zones *zones, char *groupname, struct ZoneData_ *answer_ptr)
 {
     int                 result = 0;
     char                total_zone[MAX_HOST_NET_ZONE] = "",
@@ -388,7 +388,7 @@ get_group_info(const int debuglvl, Zones *zones, char *groupname, struct ZoneDat
     answer_ptr->group_member_count = 0;
 
     /* get the members */
-    while((result = zf->ask(debuglvl, zone_backend, groupname, "MEMBER", cur_mem, sizeof(cur_mem), TYPE_GROUP, 1)) == 1)
+    while((result = f->ask(debuglvl, backend, groupname, "MEMBER", cur_mem, sizeof(cur_mem), TYPE_GROUP, 1)) == 1)
     {
         answer_ptr->group_member_count++;
 
@@ -646,7 +646,8 @@ portopts_to_list(const int debuglvl, const char *opt, d_list *dlist)
 /*  check_active
 
     Checks if the supplied zoneinfo is active. It does this by calling ask_backend with
-    the question 'ACTIVE'.
+    the question 'ACTIVE'. 'f' and 'backend' must be those of the type, e.g. zf and
+    zone_backend for a host.
 
     return codes:
     -1: error
@@ -654,7 +655,7 @@ portopts_to_list(const int debuglvl, const char *opt, d_list *dlist)
      1: active
  */
 int
-check_active(const int debuglvl, char *name, int type)
+check_active(const int debuglvl, struct BackendFunctions_ *f, void *backend, char *name, int type)
 {
     int     result = 0;
     char    active[4] = "";
@@ -686,28 +687,17 @@ check_active(const int debuglvl, char *name, int type)
         return(1);
     }
 
-    /* service */
-    if(type == TYPE_SERVICE || type == TYPE_SERVICEGRP)
-    {
-        result = sf->ask(debuglvl, serv_backend, name, "ACTIVE", active, sizeof(active), type, 0);
-    }
-    /* interface */
-    else if(type == TYPE_INTERFACE)
-    {
-        result = af->ask(debuglvl, ifac_backend, name, "ACTIVE", active, sizeof(active), type, 0);
-    }
-    /* zone, network, host, group */
-    else if(type == TYPE_ZONE || type == TYPE_NETWORK || type == TYPE_HOST || type == TYPE_GROUP)
-    {
-        result = zf->ask(debuglvl, zone_backend, name, "ACTIVE", active, sizeof(active), type, 0);
-    }
-    else
+    /* service, interface or zone, network, host, group */
+    if(type != TYPE_SERVICE && type != TYPE_SERVICEGRP && type != TYPE_INTERFACE &&
+       type != TYPE_ZONE && type != TYPE_NETWORK && type != TYPE_HOST && type != TYPE_GROUP)
     {
         (void)vrprint.error(-1, "Internal Error", "type '%d' is unsupported (in: %s:%d).",
                 type, __FUNC__, __LINE__);
         return(-1);
     }
 
+    result = f->ask(debuglvl, backend, name, "ACTIVE", active, sizeof(active), type, 0);
+
     if(debuglvl >= HIGH)
         (void)vrprint.debug(__FUNC__, "'%s' (result: %d).", active, result);
 
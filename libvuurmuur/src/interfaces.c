@@ -21,6 +21,29 @@
 #include "config.h"
 #include "vuurmuur.h"
 
+/* rows of the interface name index */
+#define INTERFACES_HASH_ROWS    64
+
+
+/*  compare_ifacename
+
+    Compare function for the name index: table data is an interface,
+    the search data is a name.
+*/
+static int
+compare_ifacename(const void *table_data, const void *search_data)
+{
+    const struct InterfaceData_ *iface_ptr = (const struct InterfaceData_ *)table_data;
+
+    if(table_data == NULL || search_data == NULL)
+        return(0);
+
+    if(strcmp(iface_ptr->name, (const char *)search_data) == 0)
+        return(1);
+
+    return(0);
+}
+
 
 static int
 insert_interface_list(const int debuglvl, Interfaces *interfaces,
@@ -121,15 +144,22 @@ insert_interface_list(const int debuglvl, Interfaces *interfaces,
         }
     }
 
+    /* and index it */
+    if(interfaces->name_hash.table != NULL)
+    {
+        if(hash_insert_key(debuglvl, &interfaces->name_hash,
+                iface_ptr->name, iface_ptr) < 0)
+            return(-1);
+    }
+
     return(0);
 }
 
 
 /*  search_interface
 
-    Function to search the InterfacesList. This is a very slow
-    function. It worst case performance is O(n) where 'n' is the
-    size of the list.
+    Function to search the InterfacesList. Uses the name index set up
+    by init_interfaces.
 
     It returns the pointer or a NULL-pointer if not found.
 */
@@ -157,28 +187,40 @@ search_interface(const int debuglvl, const Interfaces *interfaces, const char *n
     if(interfaces->list.len == 0)
         return(NULL);
 
-    /*
-        loop trough the list and compare the names
-    */
-    for(d_node = interfaces->list.top; d_node; d_node = d_node->next)
+    if(interfaces->name_hash.table != NULL)
     {
-        if(!(iface_ptr = d_node->data))
+        iface_ptr = hash_search(debuglvl, &interfaces->name_hash, (void *)name);
+    }
+    else
+    {
+        /*
+            no index, loop trough the list and compare the names
+        */
+        for(d_node = interfaces->list.top; d_node; d_node = d_node->next)
         {
-            (void)vrprint.error(-1, "Internal Error", "NULL "
-                    "pointer (in: %s:%d).", __FUNC__, __LINE__);
-            return(NULL);
+            if(!(iface_ptr = d_node->data))
+            {
+                (void)vrprint.error(-1, "Internal Error", "NULL "
+                        "pointer (in: %s:%d).", __FUNC__, __LINE__);
+                return(NULL);
+            }
+
+            if(strcmp(iface_ptr->name, name) == 0)
+                break;
         }
+        if(d_node == NULL)
+            iface_ptr = NULL;
+    }
 
-        if(strcmp(iface_ptr->name, name) == 0)
-        {
-            /* Found! */
-            if(debuglvl >= HIGH)
-                (void)vrprint.debug(__FUNC__, "Interface '%s' "
-                        "found!", name);
+    if(iface_ptr != NULL)
+    {
+        /* Found! */
+        if(debuglvl >= HIGH)
+            (void)vrprint.debug(__FUNC__, "Interface '%s' "
+                    "found!", name);
 
-            /* return the pointer we found */
-            return(iface_ptr);
-        }
+        /* return the pointer we found */
+        return(iface_ptr);
     }
 
     /* if we get here, the interface was not found, so return NULL */
@@ -189,8 +231,14 @@ search_interface(const int debuglvl, const Interfaces *interfaces, const char *n
 }
 
 
-/*
+/*  search_interface_by_ip
+
+    Looks for the interface with ipaddress 'ip'. The ipaddress of an
+    interface changes in many places (dynamic interfaces, reloads,
+    editing) and there are only a handful of interfaces, so there is
+    no index for it: the list is searched.
 
+    It returns the pointer or a NULL-pointer if not found.
 */
 void *
 search_interface_by_ip(const int debuglvl, Interfaces *interfaces, const char *ip)
@@ -217,7 +265,7 @@ search_interface_by_ip(const int debuglvl, Interfaces *interfaces, const char *i
         return(NULL);
 
     /*
-        loop trough the list and compare the names
+        loop trough the list and compare the ipaddresses
     */
     for(d_node = interfaces->list.top; d_node; d_node = d_node->next)
     {
@@ -336,7 +384,7 @@ interface_ipv6_enabled(const int debuglvl, struct InterfaceData_ *iface_ptr) {
     backend. It will issue an error but set the interface to inactive.
 */
 int
-read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
+read_interface_info(const int debuglvl, struct BackendFunctions_ *f, void *backend, struct InterfaceData_ *iface_ptr)
 {
     int     result = 0;
     char    yesno[4] = "";
@@ -355,7 +403,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
         (void)vrprint.debug(__FUNC__, "start: name: %s", iface_ptr->name);
 
     /* check if the interface is active */
-    result = check_active(debuglvl, iface_ptr->name, TYPE_INTERFACE);
+    result = check_active(debuglvl, f, backend, iface_ptr->name, TYPE_INTERFACE);
     if(result == 1)
     {
         iface_ptr->active = TRUE;
@@ -373,7 +421,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
 
 
     /* ask the backend about the possible virtualness of the device */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "VIRTUAL", yesno, sizeof(yesno), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "VIRTUAL", yesno, sizeof(yesno), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(strcasecmp(yesno, "yes") == 0)
@@ -399,7 +447,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
 
 
     /* ask the backend about the interface of this interface. Get it? */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "DEVICE", iface_ptr->device, sizeof(iface_ptr->device), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "DEVICE", iface_ptr->device, sizeof(iface_ptr->device), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(debuglvl >= HIGH)
@@ -421,7 +469,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
             (void)vrprint.debug(__FUNC__, "no DEVICE defined for interface '%s', trying pre-0.5.68s INTERFACE.",
                     iface_ptr->name);
 
-        result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "INTERFACE", iface_ptr->device, sizeof(iface_ptr->device), TYPE_INTERFACE, 0);
+        result = f->ask(debuglvl, backend, iface_ptr->name, "INTERFACE", iface_ptr->device, sizeof(iface_ptr->device), TYPE_INTERFACE, 0);
         if(result == 1)
         {
             if(debuglvl >= HIGH)
@@ -459,7 +507,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
 
 
     /* ask the ipaddress of this interface */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "IPADDRESS", iface_ptr->ipv4.ipaddress, sizeof(iface_ptr->ipv4.ipaddress), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "IPADDRESS", iface_ptr->ipv4.ipaddress, sizeof(iface_ptr->ipv4.ipaddress), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(debuglvl >= HIGH)
@@ -487,7 +535,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
 
 #ifdef IPV6_ENABLED
     /* ask the ipv6 address of this interface */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "IPV6ADDRESS", iface_ptr->ipv6.ip6, sizeof(iface_ptr->ipv6.ip6), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "IPV6ADDRESS", iface_ptr->ipv6.ip6, sizeof(iface_ptr->ipv6.ip6), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(debuglvl >= HIGH)
@@ -516,7 +564,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
 #endif /* IPV6_ENABLED */
 
     /* lookup if we need shaping */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "SHAPE", yesno, sizeof(yesno), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "SHAPE", yesno, sizeof(yesno), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(strcasecmp(yesno, "yes") == 0)
@@ -541,7 +589,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
     }
 
     /* ask the BW_IN of this interface */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "BW_IN", bw_str, sizeof(bw_str), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "BW_IN", bw_str, sizeof(bw_str), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(debuglvl >= HIGH)
@@ -563,7 +611,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
         return(-1);
     }
     /* ask the BW_IN_UNIT of this interface */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "BW_IN_UNIT", iface_ptr->bw_in_unit, sizeof(iface_ptr->bw_in_unit), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "BW_IN_UNIT", iface_ptr->bw_in_unit, sizeof(iface_ptr->bw_in_unit), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(debuglvl >= HIGH)
@@ -593,7 +641,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
 
 
     /* ask the BW_OUT of this interface */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "BW_OUT", bw_str, sizeof(bw_str), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "BW_OUT", bw_str, sizeof(bw_str), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(debuglvl >= HIGH)
@@ -615,7 +663,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
         return(-1);
     }
     /* ask the BW_OUT_UNIT of this interface */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "BW_OUT_UNIT", iface_ptr->bw_out_unit, sizeof(iface_ptr->bw_out_unit), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "BW_OUT_UNIT", iface_ptr->bw_out_unit, sizeof(iface_ptr->bw_out_unit), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(debuglvl >= HIGH)
@@ -641,11 +689,61 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
         return(-1);
     }
 
+    /* ask the SHAPE_LEAF of this interface */
+    result = f->ask(debuglvl, backend, iface_ptr->name, "SHAPE_LEAF", iface_ptr->shape_leaf, sizeof(iface_ptr->shape_leaf), TYPE_INTERFACE, 0);
+    if(result == 1)
+    {
+        if(strcmp(iface_ptr->shape_leaf, "") != 0 &&
+            libvuurmuur_is_shape_leaf(debuglvl, iface_ptr->shape_leaf) == 0)
+        {
+            (void)vrprint.warning("Warning", "'%s' is not a valid SHAPE_LEAF for interface '%s', using the default.",
+                    iface_ptr->shape_leaf, iface_ptr->name);
+            iface_ptr->shape_leaf[0] = '\0';
+        }
+    }
+    else if(result == 0)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "no SHAPE_LEAF defined for interface '%s', using the default.",
+                    iface_ptr->name);
+        iface_ptr->shape_leaf[0] = '\0';
+    }
+    else
+    {
+        (void)vrprint.error(-1, "Internal Error", "af->ask() failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    /* lookup if the nic does the shaping */
+    result = f->ask(debuglvl, backend, iface_ptr->name, "SHAPE_OFFLOAD", yesno, sizeof(yesno), TYPE_INTERFACE, 0);
+    if(result == 1)
+    {
+        if(strcasecmp(yesno, "yes") == 0)
+            iface_ptr->shape_offload = TRUE;
+        else
+            iface_ptr->shape_offload = FALSE;
+    }
+    else if(result == 0)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "no SHAPE_OFFLOAD defined for interface '%s', assuming no offload.",
+                    iface_ptr->name);
+
+        iface_ptr->shape_offload = FALSE;
+    }
+    else
+    {
+        (void)vrprint.error(-1, "Internal Error", "af->ask() failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
 
     if(iface_ptr->device_virtual == FALSE)
     {
         /* get the rules */
-        if(interfaces_get_rules(debuglvl, iface_ptr) < 0)
+        if(interfaces_get_rules(debuglvl, f, backend, iface_ptr) < 0)
         {
             (void)vrprint.error(-1, "Internal Error", "interfaces_get_rules() failed (in: %s:%d).",
                     __FUNC__, __LINE__);
@@ -654,7 +752,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
     }
 
     /* lookup if we need tcpmss */
-    result = af->ask(debuglvl, ifac_backend, iface_ptr->name, "TCPMSS", yesno, sizeof(yesno), TYPE_INTERFACE, 0);
+    result = f->ask(debuglvl, backend, iface_ptr->name, "TCPMSS", yesno, sizeof(yesno), TYPE_INTERFACE, 0);
     if(result == 1)
     {
         if(strcasecmp(yesno, "yes") == 0)
@@ -714,7 +812,8 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
 
 /*  insert_interface
 
-    Inserts the interface 'name' into the linked-list.
+    Inserts the interface 'name' into the linked-list. It is read with
+    'f' and 'backend', normally af and ifac_backend.
 
     Returncodes:
         -1: error
@@ -722,7 +821,7 @@ read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr)
          1: interface failed, maybe it is inactive
 */
 int
-insert_interface(const int debuglvl, Interfaces *interfaces, char *name)
+insert_interface(const int debuglvl, struct BackendFunctions_ *f, void *backend, Interfaces *interfaces, char *name)
 {
     struct InterfaceData_   *iface_ptr = NULL;
 
@@ -759,7 +858,7 @@ insert_interface(const int debuglvl, Interfaces *interfaces, char *name)
 
 
     /* call read_interface_info. here the info is read. */
-    if(read_interface_info(debuglvl, iface_ptr) < 0)
+    if(read_interface_info(debuglvl, f, backend, iface_ptr) < 0)
     {
         (void)vrprint.error(-1, "Internal Error", "read_interface_info() failed (in: %s:%d).",
                 __FUNC__, __LINE__);
@@ -790,9 +889,42 @@ insert_interface(const int debuglvl, Interfaces *interfaces, char *name)
 }
 
 
+/*  init_interfaces_load
+
+    Inserts one interface, read with 'f' and 'backend'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+init_interfaces_load(const int debuglvl, void *ctx, struct BackendFunctions_ *f, void *backend, char *ifacname, int zonetype)
+{
+    Interfaces  *interfaces = ctx;
+    int         result = 0;
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "loading interface %s", ifacname);
+
+    result = insert_interface(debuglvl, f, backend, interfaces, ifacname);
+    if(result < 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "insert_interface() failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "loading interface succes: '%s'.", ifacname);
+
+    return(0);
+}
+
+
 /*  init_interfaces
 
-    Loads all interfaces in memory.
+    Loads all interfaces in memory. If the backend supports it, all
+    interfaces are read in one go, otherwise they are listed and asked.
 
     Returncodes:
          0: succes
@@ -802,7 +934,6 @@ int
 init_interfaces(const int debuglvl, Interfaces *interfaces)
 {
     int     result = 0,
-            counter = 0,
             zonetype = 0;
     char    ifacname[MAX_INTERFACE] = "";
 
@@ -824,27 +955,22 @@ init_interfaces(const int debuglvl, Interfaces *interfaces)
     /* setup the list */
     if(d_list_setup(debuglvl, &interfaces->list, NULL) < 0)
         return(-1);
+    /* and the index */
+    if(hash_setup(debuglvl, &interfaces->name_hash, INTERFACES_HASH_ROWS,
+            hash_name, compare_ifacename) < 0)
+        return(-1);
 
 
     /* get the list from the backend */
-    while(af->list(debuglvl, ifac_backend, ifacname, &zonetype, CAT_INTERFACES) != NULL)
+    result = backend_bulk_load(debuglvl, af, ifac_backend, CAT_INTERFACES, init_interfaces_load, interfaces);
+    if(result < 0)
+        return(-1);
+    else if(result == 0)
     {
-        if(debuglvl >= MEDIUM)
-            (void)vrprint.debug(__FUNC__, "loading interface %s", ifacname);
-
-        result = insert_interface(debuglvl, interfaces, ifacname);
-        if(result < 0)
+        while(af->list(debuglvl, ifac_backend, ifacname, &zonetype, CAT_INTERFACES) != NULL)
         {
-            (void)vrprint.error(-1, "Internal Error", "insert_interface() failed (in: %s:%d).",
-                    __FUNC__, __LINE__);
-            return(-1);
-        }
-        else
-        {
-            counter++;
-
-            if(debuglvl >= LOW)
-                (void)vrprint.debug(__FUNC__, "loading interface succes: '%s'.", ifacname);
+            if(init_interfaces_load(debuglvl, interfaces, af, ifac_backend, ifacname, zonetype) < 0)
+                return(-1);
         }
     }
 
@@ -1144,8 +1270,12 @@ delete_interface(const int debuglvl, Interfaces *interfaces, char *iface_name)
         {
             /*  this is the interface
 
-                now remove it from the list
+                now remove it from the index and the list
             */
+            if(interfaces->name_hash.table != NULL)
+                (void)hash_remove_key(debuglvl, &interfaces->name_hash,
+                        iface_ptr->name, iface_ptr);
+
             if(d_list_remove_node(debuglvl, &interfaces->list, d_node) < 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "d_list_remove_node() failed (in: %s:%d).",
@@ -1705,6 +1835,47 @@ destroy_interfaceslist(const int debuglvl, Interfaces *interfaces)
 
     /* then the list itself */
     d_list_cleanup(debuglvl, &interfaces->list);
+
+    /* and the index */
+    if(interfaces->name_hash.table != NULL)
+    {
+        (void)hash_cleanup(debuglvl, &interfaces->name_hash);
+        interfaces->name_hash.table = NULL;
+    }
+}
+
+
+/*  interfaces_rehash
+
+    Updates the name index after 'iface_ptr' was renamed from 'old_name'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+interfaces_rehash(const int debuglvl, Interfaces *interfaces,
+        struct InterfaceData_ *iface_ptr, const char *old_name)
+{
+    /* safety */
+    if(interfaces == NULL || iface_ptr == NULL || old_name == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(interfaces->name_hash.table == NULL)
+        return(0);
+
+    if(hash_remove_key(debuglvl, &interfaces->name_hash, old_name, iface_ptr) < 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "interface '%s' not found in the index (in: %s:%d).",
+                old_name, __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(hash_insert_key(debuglvl, &interfaces->name_hash, iface_ptr->name, iface_ptr));
 }
 
 
@@ -1909,7 +2080,7 @@ interfaces_rule_parse_line(const int debuglvl, const char *line, struct RuleData
 
 
 int
-interfaces_get_rules(const int debuglvl, struct InterfaceData_ *iface_ptr)
+interfaces_get_rules(const int debuglvl, struct BackendFunctions_ *f, void *backend, struct InterfaceData_ *iface_ptr)
 {
     char                currule[MAX_RULE_LENGTH] = "";
     struct RuleData_    *rule_ptr = NULL;
@@ -1925,7 +2096,7 @@ interfaces_get_rules(const int debuglvl, struct InterfaceData_ *iface_ptr)
     }
 
     /* get all rules from the backend */
-    while((af->ask(debuglvl, ifac_backend, iface_ptr->name, "RULE", currule, sizeof(currule), TYPE_INTERFACE, 1)) == 1)
+    while((f->ask(debuglvl, backend, iface_ptr->name, "RULE", currule, sizeof(currule), TYPE_INTERFACE, 1)) == 1)
     {
         /* get mem */
         if(!(rule_ptr = rule_malloc()))
@@ -2083,12 +2254,24 @@ interfaces_check(const int debuglvl, struct InterfaceData_ *iface_ptr)
          0: ok
         -1: error
 */
+/* check one interface for load_interfaces. 'ctx' is the array of interfaces. */
+static int
+load_interfaces_check(const int debuglvl, void *ctx, unsigned int i)
+{
+    return(interfaces_check(debuglvl, ((struct InterfaceData_ **)ctx)[i]));
+}
+
+
 int
 load_interfaces(const int debuglvl, Interfaces *interfaces)
 {
-    struct InterfaceData_   *iface_ptr = NULL;
+    struct InterfaceData_   *iface_ptr = NULL,
+                            **iface_array = NULL;
     d_list_node             *d_node = NULL;
     int                     result = 0;
+    unsigned int            n = 0,
+                            i = 0;
+    ParallelJob             job;
 
     (void)vrprint.info("Info", "Loading interfaces...");
 
@@ -2102,7 +2285,14 @@ load_interfaces(const int debuglvl, Interfaces *interfaces)
     }
 
 
-    /* loop through the interfaces */
+    /* the checks are done in parallel */
+    if(!(iface_array = calloc(interfaces->list.len + 1, sizeof(struct InterfaceData_ *))))
+    {
+        (void)vrprint.error(-1, "Error", "calloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
     for(d_node = interfaces->list.top; d_node; d_node = d_node->next)
     {
         iface_ptr = d_node->data;
@@ -2110,13 +2300,34 @@ load_interfaces(const int debuglvl, Interfaces *interfaces)
         {
             (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
                     __FUNC__, __LINE__);
+            free(iface_array);
             return(-1);
         }
 
-        result = interfaces_check(debuglvl, iface_ptr);
-        if(result == -1)
+        iface_array[n++] = iface_ptr;
+    }
+
+    if(parallel_setup(debuglvl, &job, n, load_interfaces_check, iface_array) < 0)
+    {
+        free(iface_array);
+        return(-1);
+    }
+    (void)parallel_run(debuglvl, &job, NULL);
+
+    /* report in the order of the list */
+    for(i = 0; i < n; i++)
+    {
+        iface_ptr = iface_array[i];
+
+        parallel_replay(debuglvl, &job, i);
+
+        if(job.results[i] == -1)
+        {
+            parallel_cleanup(debuglvl, &job);
+            free(iface_array);
             return(-1);
-        else if(result == 0)
+        }
+        else if(job.results[i] == 0)
         {
             (void)vrprint.info("Info", "Interface '%s' has been deactivated because of errors while checking it.",
                     iface_ptr->name);
@@ -2124,6 +2335,9 @@ load_interfaces(const int debuglvl, Interfaces *interfaces)
         }
     }
 
+    parallel_cleanup(debuglvl, &job);
+    free(iface_array);
+
     (void)vrprint.info("Info", "Loading interfaces succesfull.");
     return(0);
 }
@@ -161,7 +161,7 @@ stat_ok(const int debuglvl, const struct vuurmuur_config *cnf, const char *file_
     }
 
     /* we demand that all files are owned by root */
-    if(stat_buf.st_uid != 0 || stat_buf.st_gid != 0)
+    if(cnf->skip_owner_check == FALSE && (stat_buf.st_uid != 0 || stat_buf.st_gid != 0))
     {
         if(output == STATOK_VERBOSE)
             (void)vrprint.error(-1, "Error", "opening '%s': For security reasons Vuurmuur will not open files or directories that are not owned by root.", file_loc);
@@ -195,6 +195,35 @@ stat_ok(const int debuglvl, const struct vuurmuur_config *cnf, const char *file_
 }
 
 
+/*  stat_changed
+
+    Compare two stat results of the same path to see if the file was
+    changed or replaced in between. The times are compared with their
+    nanoseconds, so a change within the same second is seen as well.
+
+    Returncodes:
+        1: changed
+        0: not changed
+*/
+int
+stat_changed(const struct stat *old_st, const struct stat *new_st)
+{
+    if(old_st->st_ino != new_st->st_ino     ||
+       old_st->st_dev != new_st->st_dev     ||
+       old_st->st_size != new_st->st_size   ||
+       old_st->st_mode != new_st->st_mode   ||
+       old_st->st_uid != new_st->st_uid     ||
+       old_st->st_gid != new_st->st_gid     ||
+       old_st->st_mtim.tv_sec != new_st->st_mtim.tv_sec     ||
+       old_st->st_mtim.tv_nsec != new_st->st_mtim.tv_nsec   ||
+       old_st->st_ctim.tv_sec != new_st->st_ctim.tv_sec     ||
+       old_st->st_ctim.tv_nsec != new_st->st_ctim.tv_nsec)
+        return(1);
+
+    return(0);
+}
+
+
 /**
  * \brief Check PID file for running process
  *
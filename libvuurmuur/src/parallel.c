@@ -0,0 +1,405 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <stdarg.h>
+#include <pthread.h>
+
+/*
+    Running independent work on all cpu's
+
+    Loading a large config is mostly reading and checking objects that
+    don't depend on each other. A ParallelJob runs the work for a number
+    of items on a few threads. The order in which the items are done is
+    unknown, so everything the work prints is kept per item. The caller
+    prints it with parallel_replay() in the order it wants, normally the
+    order of the list. That way the output is the same as when the work
+    was done one item after the other.
+
+    The work may only touch its own item: the lists, the hashes and the
+    backends are not thread safe.
+*/
+
+#define PARALLEL_MAX_THREADS    8
+/* don't start a thread for less than this many items */
+#define PARALLEL_MIN_ITEMS      32
+
+enum
+{
+    PMSG_ERROR = 0,
+    PMSG_WARNING,
+    PMSG_INFO,
+    PMSG_DEBUG,
+    PMSG_AUDIT,
+};
+
+struct ParallelMsg_
+{
+    struct ParallelMsg_ *next;
+
+    int                 type;
+    int                 errorcode;
+    char                *head;
+    char                msg[];
+};
+
+/* the message list of the item the current thread works on */
+static __thread struct ParallelMsg_ **parallel_last = NULL;
+/* the count of messages of that item we could not keep */
+static __thread unsigned int        *parallel_lost = NULL;
+
+static struct vrprint_  parallel_saved;
+static pthread_mutex_t  parallel_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+static int
+parallel_keep(int type, int errorcode, char *head, char *fmt, va_list ap)
+{
+    struct ParallelMsg_ *msg = NULL;
+    va_list             ap2;
+    int                 len = 0;
+
+    va_copy(ap2, ap);
+    len = vsnprintf(NULL, 0, fmt, ap2);
+    va_end(ap2);
+    if(len < 0)
+    {
+        (*parallel_lost)++;
+        return(-1);
+    }
+
+    /* no vrprint here: we are vrprint. parallel_replay() reports it. */
+    if(!(msg = malloc(sizeof(struct ParallelMsg_) + (size_t)len + 1)))
+    {
+        (*parallel_lost)++;
+        return(-1);
+    }
+
+    msg->next = NULL;
+    msg->type = type;
+    msg->errorcode = errorcode;
+    msg->head = head;
+    (void)vsnprintf(msg->msg, (size_t)len + 1, fmt, ap);
+
+    *parallel_last = msg;
+    parallel_last = &msg->next;
+    return(0);
+}
+
+
+static int
+parallel_error(int errorcode, char *head, char *fmt, ...)
+{
+    va_list ap;
+    int     result = 0;
+
+    va_start(ap, fmt);
+    if(parallel_last != NULL)
+    {
+        result = parallel_keep(PMSG_ERROR, errorcode, head, fmt, ap);
+    }
+    else
+    {
+        char line[2048] = "";
+        (void)vsnprintf(line, sizeof(line), fmt, ap);
+        result = parallel_saved.error(errorcode, head, "%s", line);
+    }
+    va_end(ap);
+    return(result);
+}
+
+
+#define PARALLEL_PRINT(name, type, call)                                    \
+static int                                                                  \
+name(char *head, char *fmt, ...)                                            \
+{                                                                           \
+    va_list ap;                                                             \
+    int     result = 0;                                                     \
+    char    line[2048] = "";                                                \
+                                                                            \
+    va_start(ap, fmt);                                                      \
+    if(parallel_last != NULL)                                               \
+    {                                                                       \
+        result = parallel_keep((type), 0, head, fmt, ap);                   \
+    }                                                                       \
+    else                                                                    \
+    {                                                                       \
+        (void)vsnprintf(line, sizeof(line), fmt, ap);                       \
+        result = parallel_saved.call(head, "%s", line);                     \
+    }                                                                       \
+    va_end(ap);                                                             \
+    return(result);                                                         \
+}
+
+PARALLEL_PRINT(parallel_warning, PMSG_WARNING, warning)
+PARALLEL_PRINT(parallel_info, PMSG_INFO, info)
+PARALLEL_PRINT(parallel_debug, PMSG_DEBUG, debug)
+
+
+static int
+parallel_audit(char *fmt, ...)
+{
+    va_list ap;
+    int     result = 0;
+    char    line[2048] = "";
+
+    va_start(ap, fmt);
+    if(parallel_last != NULL)
+    {
+        result = parallel_keep(PMSG_AUDIT, 0, NULL, fmt, ap);
+    }
+    else
+    {
+        (void)vsnprintf(line, sizeof(line), fmt, ap);
+        result = parallel_saved.audit("%s", line);
+    }
+    va_end(ap);
+    return(result);
+}
+
+
+/* take the next selected item and do the work for it, until there are
+   none left */
+static void *
+parallel_worker(void *arg)
+{
+    ParallelJob     *job = arg;
+    unsigned int    i = 0;
+
+    while(1)
+    {
+        (void)pthread_mutex_lock(&parallel_mutex);
+        while(job->next < job->n && job->select != NULL && job->select[job->next] == FALSE)
+            job->next++;
+        i = job->next++;
+        (void)pthread_mutex_unlock(&parallel_mutex);
+
+        if(i >= job->n)
+            break;
+
+        parallel_last = &job->msgs[i];
+        while(*parallel_last != NULL)
+            parallel_last = &(*parallel_last)->next;
+        parallel_lost = &job->lost[i];
+
+        job->results[i] = job->work(job->debuglvl, job->ctx, i);
+
+        parallel_last = NULL;
+        parallel_lost = NULL;
+    }
+
+    return(NULL);
+}
+
+
+/*  parallel_setup
+
+    Sets up a job of 'n' items.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+parallel_setup(const int debuglvl, ParallelJob *job, unsigned int n,
+        int (*work)(const int debuglvl, void *ctx, unsigned int i), void *ctx)
+{
+    if(job == NULL || work == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    memset(job, 0, sizeof(ParallelJob));
+    job->n = n;
+    job->work = work;
+    job->ctx = ctx;
+
+    /* calloc(0) may return NULL */
+    if(!(job->results = calloc(n + 1, sizeof(int))) ||
+       !(job->msgs = calloc(n + 1, sizeof(struct ParallelMsg_ *))) ||
+       !(job->lost = calloc(n + 1, sizeof(unsigned int))))
+    {
+        (void)vrprint.error(-1, "Error", "calloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        free(job->results);
+        free(job->msgs);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  parallel_run
+
+    Does the work for the items that are set in 'select', or for all items
+    if 'select' is NULL. Nothing is printed, see parallel_replay().
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+parallel_run(const int debuglvl, ParallelJob *job, char *select)
+{
+    pthread_t       threads[PARALLEL_MAX_THREADS];
+    unsigned int    n_threads = 0,
+                    started = 0,
+                    todo = 0,
+                    i = 0;
+    long            cpus = 0;
+
+    if(job == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    for(i = 0; i < job->n; i++)
+    {
+        if(select == NULL || select[i] == TRUE)
+            todo++;
+    }
+
+    /* one thread per PARALLEL_MIN_ITEMS items, up to the number of cpu's
+       we have. The calling thread is one of them. */
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if(cpus < 1)
+        cpus = 1;
+    n_threads = todo / PARALLEL_MIN_ITEMS;
+    if(n_threads > (unsigned int)cpus)
+        n_threads = (unsigned int)cpus;
+    if(n_threads > PARALLEL_MAX_THREADS)
+        n_threads = PARALLEL_MAX_THREADS;
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "%u items, %u threads.", todo, n_threads ? n_threads : 1);
+
+    job->select = select;
+    job->next = 0;
+    job->debuglvl = debuglvl;
+
+    /* keep what is printed, from here on until all threads are done */
+    parallel_saved = vrprint;
+    vrprint.error = parallel_error;
+    vrprint.warning = parallel_warning;
+    vrprint.info = parallel_info;
+    vrprint.debug = parallel_debug;
+    vrprint.audit = parallel_audit;
+
+    for(started = 1; started < n_threads; started++)
+    {
+        if(pthread_create(&threads[started], NULL, parallel_worker, job) != 0)
+            break;
+    }
+
+    (void)parallel_worker(job);
+
+    for(i = 1; i < started; i++)
+        (void)pthread_join(threads[i], NULL);
+
+    vrprint = parallel_saved;
+    job->select = NULL;
+
+    return(0);
+}
+
+
+/*  parallel_replay
+
+    Prints the messages of item 'i', like they would have been printed
+    without threads. They are printed only once. Messages that could
+    not be kept for lack of memory are counted and reported.
+*/
+void
+parallel_replay(const int debuglvl, ParallelJob *job, unsigned int i)
+{
+    struct ParallelMsg_ *msg = NULL,
+                        *next = NULL;
+
+    if(job == NULL || i >= job->n)
+        return;
+
+    for(msg = job->msgs[i]; msg; msg = next)
+    {
+        next = msg->next;
+
+        switch(msg->type)
+        {
+            case PMSG_ERROR:
+                (void)vrprint.error(msg->errorcode, msg->head, "%s", msg->msg);
+                break;
+            case PMSG_WARNING:
+                (void)vrprint.warning(msg->head, "%s", msg->msg);
+                break;
+            case PMSG_INFO:
+                (void)vrprint.info(msg->head, "%s", msg->msg);
+                break;
+            case PMSG_DEBUG:
+                (void)vrprint.debug(msg->head, "%s", msg->msg);
+                break;
+            case PMSG_AUDIT:
+                (void)vrprint.audit("%s", msg->msg);
+                break;
+        }
+
+        free(msg);
+    }
+
+    job->msgs[i] = NULL;
+
+    if(job->lost[i] > 0)
+    {
+        (void)vrprint.warning("Warning", "%u message(s) lost: out of memory while keeping them.",
+                job->lost[i]);
+        job->lost[i] = 0;
+    }
+}
+
+
+void
+parallel_cleanup(const int debuglvl, ParallelJob *job)
+{
+    struct ParallelMsg_ *msg = NULL,
+                        *next = NULL;
+    unsigned int        i = 0;
+
+    if(job == NULL || job->msgs == NULL)
+        return;
+
+    for(i = 0; i < job->n; i++)
+    {
+        for(msg = job->msgs[i]; msg; msg = next)
+        {
+            next = msg->next;
+            free(msg);
+        }
+    }
+
+    free(job->msgs);
+    free(job->results);
+    free(job->lost);
+    memset(job, 0, sizeof(ParallelJob));
+}
@@ -1420,97 +1420,87 @@ rules_write_file(const int debuglvl, const struct vuurmuur_config *cnf, Rules *r
 }
 
 
-int
-rules_save_list(const int debuglvl, Rules *rules, struct vuurmuur_config *cnf)
+/*  rules_tell_list
+
+    Writes the list to the backend, one rule at a time. Called by
+    rules_save_list() inside a backend transaction.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+rules_tell_list(const int debuglvl, Rules *rules)
 {
-    int                 result = 0;
     char                *line = NULL,
                         eline[1024] = "";
     d_list_node         *d_node = NULL;
     struct RuleData_    *rule_ptr = NULL;
     char                overwrite = FALSE;
 
-
-    /* safety */
-    if(cnf == NULL || rules == NULL)
-    {
-        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
-                __FUNC__, __LINE__);
-        return(-1);
-    }
-
-    if(rules->old_rulesfile_used == TRUE)
+    /* empty list, so clear all */
+    if(rules->list.len == 0)
     {
-        result = rules_write_file(debuglvl, cnf, rules, cnf->rules_location);
-        if(result < 0)
+        if(rf->tell(debuglvl, rule_backend, "rules", "RULE", "", 1, TYPE_RULE) < 0)
+        {
+            (void)vrprint.error(-1, "Internal Error", "rf->tell() failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
             return(-1);
+        }
     }
     else
     {
-        /* empty list, so clear all */
-        if(rules->list.len == 0)
+        overwrite = TRUE;
+
+        /* loop trough the list */
+        for(d_node = rules->list.top; d_node ; d_node = d_node->next)
         {
-            if(rf->tell(debuglvl, rule_backend, "rules", "RULE", "", 1, TYPE_RULE) < 0)
+            if(!(rule_ptr = d_node->data))
             {
-                (void)vrprint.error(-1, "Internal Error", "rf->tell() failed (in: %s:%d).",
+                (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
                         __FUNC__, __LINE__);
                 return(-1);
             }
-        }
-        else
-        {
-            overwrite = TRUE;
 
-            /* loop trough the list */
-            for(d_node = rules->list.top; d_node ; d_node = d_node->next)
+            if(!(line = rules_assemble_rule(debuglvl, rule_ptr)))
             {
-                if(!(rule_ptr = d_node->data))
-                {
-                    (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
-                            __FUNC__, __LINE__);
-                    return(-1);
-                }
-
-                if(!(line = rules_assemble_rule(debuglvl, rule_ptr)))
-                {
-                    (void)vrprint.error(-1, "Internal Error", "rules_assemble_rule() failed (in: %s:%d).",
-                            __FUNC__, __LINE__);
-
-                    return(-1);
-                }
+                (void)vrprint.error(-1, "Internal Error", "rules_assemble_rule() failed (in: %s:%d).",
+                        __FUNC__, __LINE__);
 
-                if(line[strlen(line)-1] == '\n')
-                    line[strlen(line)-1] = '\0';
+                return(-1);
+            }
 
-                if(strlcpy(eline, line, sizeof(eline)) >= sizeof(eline))
-                {
-                    (void)vrprint.error(-1, "Internal Error", "copy rule failed: buffer to small (in: %s:%d).",
-                            __FUNC__, __LINE__);
-                    return(-1);
-                }
+            if(line[strlen(line)-1] == '\n')
+                line[strlen(line)-1] = '\0';
 
-                free(line);
-                line = NULL;
+            if(strlcpy(eline, line, sizeof(eline)) >= sizeof(eline))
+            {
+                (void)vrprint.error(-1, "Internal Error", "copy rule failed: buffer to small (in: %s:%d).",
+                        __FUNC__, __LINE__);
+                return(-1);
+            }
 
+            free(line);
+            line = NULL;
 
-                /* encode */
-                if(rules_encode_rule(debuglvl, eline, sizeof(eline)) < 0)
-                {
-                    (void)vrprint.error(-1, "Internal Error", "encode rule failed (in: %s:%d).",
-                            __FUNC__, __LINE__);
-                    return(-1);
-                }
 
-                /* write to the backend */
-                if(rf->tell(debuglvl, rule_backend, "rules", "RULE", eline, overwrite, TYPE_RULE) < 0)
-                {
-                    (void)vrprint.error(-1, "Internal Error", "rf->tell() failed (in: %s:%d).",
-                            __FUNC__, __LINE__);
-                    return(-1);
-                }
+            /* encode */
+            if(rules_encode_rule(debuglvl, eline, sizeof(eline)) < 0)
+            {
+                (void)vrprint.error(-1, "Internal Error", "encode rule failed (in: %s:%d).",
+                        __FUNC__, __LINE__);
+                return(-1);
+            }
 
-                overwrite = FALSE;
+            /* write to the backend */
+            if(rf->tell(debuglvl, rule_backend, "rules", "RULE", eline, overwrite, TYPE_RULE) < 0)
+            {
+                (void)vrprint.error(-1, "Internal Error", "rf->tell() failed (in: %s:%d).",
+                        __FUNC__, __LINE__);
+                return(-1);
             }
+
+            overwrite = FALSE;
         }
     }
 
@@ -1518,6 +1508,43 @@ rules_save_list(const int debuglvl, Rules *rules, struct vuurmuur_config *cnf)
 }
 
 
+int
+rules_save_list(const int debuglvl, Rules *rules, struct vuurmuur_config *cnf)
+{
+    int                 result = 0;
+
+
+    /* safety */
+    if(cnf == NULL || rules == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(rules->old_rulesfile_used == TRUE)
+    {
+        result = rules_write_file(debuglvl, cnf, rules, cnf->rules_location);
+        if(result < 0)
+            return(-1);
+    }
+    else
+    {
+        if(backend_tell_begin(debuglvl, rf, rule_backend, "rules", TYPE_RULE) < 0)
+            return(-1);
+
+        result = rules_tell_list(debuglvl, rules);
+
+        if(backend_tell_end(debuglvl, rf, rule_backend, result == 0 ? 1 : 0) < 0)
+            return(-1);
+        if(result < 0)
+            return(-1);
+    }
+
+    return(0);
+}
+
+
 /*  cleanup_ruleslist
 
     O(n) function: with n is the number of rules
@@ -2179,6 +2206,28 @@ rules_assemble_options_string(const int debuglvl, struct options *opt,
         }
     }
 
+    if (strcmp(opt->shape_leaf, "") != 0)
+    {
+        if(strlcat(options, "leaf=\"", sizeof(options)) >= sizeof(options))
+        {
+            (void)vrprint.error(-1, "Internal Error", "string "
+                    "overflow (in: %s:%d).", __FUNC__, __LINE__);
+            return(NULL);
+        }
+        if(strlcat(options, opt->shape_leaf, sizeof(options)) >= sizeof(options))
+        {
+            (void)vrprint.error(-1, "Internal Error", "string "
+                    "overflow (in: %s:%d).", __FUNC__, __LINE__);
+            return(NULL);
+        }
+        if(strlcat(options, "\",", sizeof(options)) >= sizeof(options))
+        {
+            (void)vrprint.error(-1, "Internal Error", "string "
+                    "overflow (in: %s:%d).", __FUNC__, __LINE__);
+            return(NULL);
+        }
+    }
+
     if (opt->random == TRUE)
     {
         if (strlcat(options, "random,", sizeof(options)) >= sizeof(options))
@@ -2883,6 +2932,30 @@ rules_read_options(const int debuglvl, char *optstr, struct options *op)
                 //if(debuglvl >= MEDIUM)
                     (void)vrprint.debug(__FUNC__, "prio: %d, %s", op->prio, portstring);
             }
+            /* leaf */
+            else if(strncmp(curopt, "leaf", strlen("leaf")) == 0)
+            {
+                for(p = 0, o = strlen("leaf") + 1;
+                        o < strlen(curopt) && p < sizeof(op->shape_leaf) - 1;
+                        o++)
+                {
+                    if(curopt[o] != '\"')
+                    {
+                        op->shape_leaf[p] = curopt[o];
+                        p++;
+                    }
+                }
+                op->shape_leaf[p] = '\0';
+
+                if(libvuurmuur_is_shape_leaf(debuglvl, op->shape_leaf) == 0)
+                {
+                    (void)vrprint.warning("Warning", "%s is not a valid leaf qdisc, using the default.", op->shape_leaf);
+                    op->shape_leaf[0] = '\0';
+                }
+
+                if(debuglvl >= MEDIUM)
+                    (void)vrprint.debug(__FUNC__, "leaf: %s", op->shape_leaf);
+            }
             /* in_max */
             else if(strncmp(curopt, "in_max", strlen("in_max")) == 0)
             {
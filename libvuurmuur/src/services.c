@@ -21,6 +21,9 @@
 #include "config.h"
 #include "vuurmuur.h"
 
+/* rows of the services name index */
+#define SERVICES_HASH_ROWS      1024
+
 
 static int
 insert_service_list(const int debuglvl, Services *services, const struct ServicesData_ *ser_ptr)
@@ -109,13 +112,24 @@ insert_service_list(const int debuglvl, Services *services, const struct Service
         }
     }
 
+    /* and index it by name */
+    if(services->name_hash.table != NULL)
+    {
+        if(hash_insert_key(debuglvl, &services->name_hash, ser_ptr->name, ser_ptr) < 0)
+        {
+            (void)vrprint.error(-1, "Internal Error", "hash_insert_key() failed (in: %s:%d).", __FUNC__, __LINE__);
+            return(-1);
+        }
+    }
+
     return(0);
 }
 
 
 /*  insert_service
 
-    Inserts the service 'name' into the linked-list.
+    Inserts the service 'name' into the linked-list. It is read with
+    'f' and 'backend', normally sf and serv_backend.
 
     Returncodes:
         -1: error
@@ -126,7 +140,7 @@ insert_service_list(const int debuglvl, Services *services, const struct Service
     and by error an internal program error.
 */
 int
-insert_service(const int debuglvl, Services *services, char *name)
+insert_service(const int debuglvl, struct BackendFunctions_ *f, void *backend, Services *services, char *name)
 {
     int                     retval = 0,
                             result = 0;
@@ -150,7 +164,7 @@ insert_service(const int debuglvl, Services *services, char *name)
     }
 
     /* reading the service information */
-    result = read_service(debuglvl, name, ser_ptr);
+    result = read_service(debuglvl, f, backend, name, ser_ptr);
     if(result == -1)
     {
         (void)vrprint.error(-1, "Internal Error", "read_service() failed (in: %s:%d).",
@@ -172,9 +186,30 @@ insert_service(const int debuglvl, Services *services, char *name)
 }
 
 
+/*  compare_servicename
+
+    Compare function for the name index: table data is a service, the
+    search data is a name.
+*/
+static int
+compare_servicename(const void *table_data, const void *search_data)
+{
+    const struct ServicesData_  *ser_ptr = (const struct ServicesData_ *)table_data;
+
+    if(table_data == NULL || search_data == NULL)
+        return(0);
+
+    if(strcmp(ser_ptr->name, (const char *)search_data) == 0)
+        return(1);
+
+    return(0);
+}
+
+
 /*  search_service
 
-    Function to search the ServicesList.
+    Function to search the ServicesList. Uses the name index set up by
+    init_services.
 
     It returns the pointer or a NULL-pointer if not found.
 */
@@ -196,25 +231,37 @@ search_service(const int debuglvl, const Services *services, char *servicename)
     if(debuglvl >= MEDIUM)
         (void)vrprint.debug(__FUNC__, "looking for service '%s'.", servicename);
 
-    /* loop the list and compare */
-    for(d_node = services->list.top; d_node ; d_node = d_node->next)
+    if(services->name_hash.table != NULL)
+    {
+        service_ptr = hash_search(debuglvl, &services->name_hash, servicename);
+    }
+    else
     {
-        if(!(service_ptr = d_node->data))
+        /* no index, loop the list and compare */
+        for(d_node = services->list.top; d_node ; d_node = d_node->next)
         {
-            (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
-                    __FUNC__, __LINE__);
-            return(NULL);
+            if(!(service_ptr = d_node->data))
+            {
+                (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
+                        __FUNC__, __LINE__);
+                return(NULL);
+            }
+
+            if(strcmp(service_ptr->name, servicename) == 0)
+                break;
         }
+        if(d_node == NULL)
+            service_ptr = NULL;
+    }
 
-        if(strcmp(service_ptr->name, servicename) == 0)
-        {
-            if(debuglvl >= HIGH)
-                (void)vrprint.debug(__FUNC__, "service %s found at address: %p",
-                        servicename, service_ptr);
+    if(service_ptr != NULL)
+    {
+        if(debuglvl >= HIGH)
+            (void)vrprint.debug(__FUNC__, "service %s found at address: %p",
+                    servicename, service_ptr);
 
-            /* return the pointer */
-            return(service_ptr);
-        }
+        /* return the pointer */
+        return(service_ptr);
     }
 
     /* if the value wasn't found tell the debuglog */
@@ -226,6 +273,40 @@ search_service(const int debuglvl, const Services *services, char *servicename)
 }
 
 
+/*  services_rehash
+
+    Updates the name index after 'ser_ptr' was renamed from 'old_name'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+services_rehash(const int debuglvl, Services *services,
+        struct ServicesData_ *ser_ptr, const char *old_name)
+{
+    /* safety */
+    if(services == NULL || ser_ptr == NULL || old_name == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(services->name_hash.table == NULL)
+        return(0);
+
+    if(hash_remove_key(debuglvl, &services->name_hash, old_name, ser_ptr) < 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "service '%s' not found in the index (in: %s:%d).",
+                old_name, __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(hash_insert_key(debuglvl, &services->name_hash, ser_ptr->name, ser_ptr));
+}
+
+
 /*  read_service
 
     This function takes the service 'sername', and reads the info from the service.
@@ -237,7 +318,7 @@ search_service(const int debuglvl, const Services *services, char *servicename)
         -1: error
 */
 int
-read_service(const int debuglvl, char *sername, struct ServicesData_ *service_ptr)
+read_service(const int debuglvl, struct BackendFunctions_ *f, void *backend, char *sername, struct ServicesData_ *service_ptr)
 {
     int     retval = 0,
             result = 0;
@@ -262,7 +343,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
     }
 
     /* first the active check */
-    result = check_active(debuglvl, sername, TYPE_SERVICE);
+    result = check_active(debuglvl, f, backend, sername, TYPE_SERVICE);
     if(result == 1)
     {
         /* active */
@@ -283,7 +364,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
         return(-1);
 
     /* first check RANGE */
-    while((result = sf->ask(debuglvl, serv_backend, sername, "RANGE", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
+    while((result = f->ask(debuglvl, backend, sername, "RANGE", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
     {
         /* process */
         if(process_portrange(debuglvl, "RANGE", portrange, service_ptr) < 0)
@@ -298,7 +379,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
     /* no ranges, fallback to old behavior */
     if (service_ptr->PortrangeList.len == 0) {
         /* first check TCP */
-        while((result = sf->ask(debuglvl, serv_backend, sername, "TCP", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
+        while((result = f->ask(debuglvl, backend, sername, "TCP", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
         {
             /* process */
             if(process_portrange(debuglvl, "TCP", portrange, service_ptr) < 0)
@@ -312,7 +393,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
         }
 
         /* then check udp */
-        while((result = sf->ask(debuglvl, serv_backend, sername, "UDP", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
+        while((result = f->ask(debuglvl, backend, sername, "UDP", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
         {
             /* process */
             if(process_portrange(debuglvl, "UDP", portrange, service_ptr) < 0)
@@ -326,7 +407,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
         }
 
         /* then check icmp */
-        while((result = sf->ask(debuglvl, serv_backend, sername, "ICMP", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
+        while((result = f->ask(debuglvl, backend, sername, "ICMP", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
         {
             /* process */
             if(process_portrange(debuglvl, "ICMP", portrange, service_ptr) < 0)
@@ -340,7 +421,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
         }
 
         /* then check gre */
-        while((result = sf->ask(debuglvl, serv_backend, sername, "GRE", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
+        while((result = f->ask(debuglvl, backend, sername, "GRE", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
         {
             /* process */
             if(process_portrange(debuglvl, "GRE", portrange, service_ptr) < 0)
@@ -354,7 +435,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
         }
 
         /* then check ah */
-        while((result = sf->ask(debuglvl, serv_backend, sername, "AH", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
+        while((result = f->ask(debuglvl, backend, sername, "AH", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
         {
             /* process */
             if(process_portrange(debuglvl, "AH", portrange, service_ptr) < 0)
@@ -368,7 +449,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
         }
 
         /* then check esp */
-        while((result = sf->ask(debuglvl, serv_backend, sername, "ESP", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
+        while((result = f->ask(debuglvl, backend, sername, "ESP", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
         {
             /* process */
             if(process_portrange(debuglvl, "ESP", portrange, service_ptr) < 0)
@@ -382,7 +463,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
         }
 
         /* then check protocol 41 */
-        while((result = sf->ask(debuglvl, serv_backend, sername, "PROTO_41", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
+        while((result = f->ask(debuglvl, backend, sername, "PROTO_41", portrange, sizeof(portrange), TYPE_SERVICE, 1)) == 1)
         {
             /* process */
             if(process_portrange(debuglvl, "PROTO_41", portrange, service_ptr) < 0)
@@ -397,7 +478,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
     }
 
     /* see if we need a helper */
-    result = sf->ask(debuglvl, serv_backend, sername, "HELPER", service_ptr->helper, sizeof(service_ptr->helper), TYPE_SERVICE, 0);
+    result = f->ask(debuglvl, backend, sername, "HELPER", service_ptr->helper, sizeof(service_ptr->helper), TYPE_SERVICE, 0);
     if(result < 0)
     {
         (void)vrprint.error(-1, "Internal Error", "sf->ask() failed (in: %s:%d).",
@@ -406,7 +487,7 @@ read_service(const int debuglvl, char *sername, struct ServicesData_ *service_pt
     }
 
     /* check if the protocol is broadcasting */
-    result=sf->ask(debuglvl, serv_backend, sername, "BROADCAST", broadcast, sizeof(broadcast), TYPE_SERVICE, 0);
+    result=f->ask(debuglvl, backend, sername, "BROADCAST", broadcast, sizeof(broadcast), TYPE_SERVICE, 0);
     if(result < 0)
     {
         (void)vrprint.error(-1, "Internal Error", "sf->ask() failed (in: %s:%d).",
@@ -781,6 +862,12 @@ destroy_serviceslist(const int debuglvl, Services *services)
 
     /* then the list itself */
     d_list_cleanup(debuglvl, &services->list);
+
+    if(services->name_hash.table != NULL)
+    {
+        (void)hash_cleanup(debuglvl, &services->name_hash);
+        services->name_hash.table = NULL;
+    }
 }
 
 
@@ -894,7 +981,7 @@ delete_service(const int debuglvl, Services *services, char *sername, int sertyp
         return(-1);
     }
 
-    /* this is a bit overkill right now, but when we start using hash-searching, it wont be */
+    /* cheap now that we have the name index */
     if((search_service(debuglvl, services, sername) == NULL))
     {
         (void)vrprint.error(-1, "Internal Error", "service %s not found in memory (in: %s:%d).",
@@ -918,6 +1005,10 @@ delete_service(const int debuglvl, Services *services, char *sername, int sertyp
 
         if(strcmp(sername, ser_list_ptr->name) == 0)
         {
+            if(services->name_hash.table != NULL)
+                (void)hash_remove_key(debuglvl, &services->name_hash,
+                        ser_list_ptr->name, ser_list_ptr);
+
             if(d_list_remove_node(debuglvl, &services->list, d_node) < 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "d_list_remove_node() failed (in: %s:%d).",
@@ -974,8 +1065,8 @@ validate_servicename(const int debuglvl, const char *servicename, regex_t *reg_e
 }
 
 
-int
-services_save_portranges(const int debuglvl, struct ServicesData_ *ser_ptr)
+static int
+services_tell_portranges(const int debuglvl, struct ServicesData_ *ser_ptr)
 {
     struct portdata *port_ptr = NULL;
     char            prot_format[24] = "",
@@ -1126,6 +1217,40 @@ services_save_portranges(const int debuglvl, struct ServicesData_ *ser_ptr)
 }
 
 
+
+/*  services_save_portranges
+
+    Save the portranges of the service to the backend. All ranges are
+    written to the backend at once.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+services_save_portranges(const int debuglvl, struct ServicesData_ *ser_ptr)
+{
+    int result = 0;
+
+    /* safety */
+    if(ser_ptr == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(backend_tell_begin(debuglvl, sf, serv_backend, ser_ptr->name, TYPE_SERVICE) < 0)
+        return(-1);
+
+    result = services_tell_portranges(debuglvl, ser_ptr);
+
+    if(backend_tell_end(debuglvl, sf, serv_backend, result == 0 ? 1 : 0) < 0)
+        return(-1);
+
+    return(result);
+}
+
 /*
     returns 0 if invalid
         1 if valid
@@ -1140,9 +1265,64 @@ valid_tcpudp_port(const int debuglvl, int port)
 }
 
 
+/* what init_services_load needs */
+struct ServicesLoad_
+{
+    Services        *services;
+    struct rgx_     *reg;
+};
+
+
+/*  init_services_load
+
+    Validates and inserts one service, read with 'f' and 'backend'.
+
+    Returncodes:
+         0: ok (or skipped)
+        -1: error
+*/
+static int
+init_services_load(const int debuglvl, void *ctx, struct BackendFunctions_ *f, void *backend, char *name, int zonetype)
+{
+    struct ServicesLoad_    *sl = ctx;
+    int                     result = 0;
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "loading service '%s' ...", name);
+
+    /* but first validate the name */
+    if(validate_servicename(debuglvl, name, sl->reg->servicename, VALNAME_VERBOSE) == 0)
+    {
+        /* now call insert_service, which will gather the info and insert it into the list */
+        result = insert_service(debuglvl, f, backend, sl->services, name);
+        if(result == 0)
+        {
+            if(debuglvl >= LOW)
+                (void)vrprint.debug(__FUNC__, "loading service succes: '%s'.", name);
+        }
+        else if(result == 1)
+        {
+            /* we failed, but non-fatal (e.g. inactive) */
+            if(debuglvl >= LOW)
+                (void)vrprint.debug(__FUNC__, "loading service failed with a non fatal failure: '%s'.", name);
+        }
+        else
+        {
+            /* failed with fatal error */
+            (void)vrprint.error(-1, "Internal Error", "insert_service() failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(-1);
+        }
+    }
+
+    return(0);
+}
+
+
 /*  init_services
 
-    Loads all services in memory.
+    Loads all services in memory. If the backend supports it, all
+    services are read in one go, otherwise they are listed and asked.
 
     Returncodes:
          0: succes
@@ -1151,10 +1331,11 @@ valid_tcpudp_port(const int debuglvl, int port)
 int
 init_services(const int debuglvl, Services *services, struct rgx_ *reg)
 {
-    int     retval=0,
-            result=0;
-    char    name[MAX_SERVICE]="";
-    int     zonetype=0;
+    int                     retval=0,
+                            result=0;
+    char                    name[MAX_SERVICE]="";
+    int                     zonetype=0;
+    struct ServicesLoad_    sl;
 
     /* safety */
     if(services == NULL || reg == NULL)
@@ -1173,38 +1354,25 @@ init_services(const int debuglvl, Services *services, struct rgx_ *reg)
                 __FUNC__, __LINE__);
         return(-1);
     }
+    if(hash_setup(debuglvl, &services->name_hash, SERVICES_HASH_ROWS,
+            hash_name, compare_servicename) < 0)
+        return(-1);
 
-    /*
-        now loop trough the list and insert
-    */
-    while(sf->list(debuglvl, serv_backend, name, &zonetype, CAT_SERVICES) != NULL)
-    {
-        if(debuglvl >= MEDIUM)
-            (void)vrprint.debug(__FUNC__, "loading service '%s' ...", name);
+    sl.services = services;
+    sl.reg = reg;
 
-        /* but first validate the name */
-        if(validate_servicename(debuglvl, name, reg->servicename, VALNAME_VERBOSE) == 0)
+    result = backend_bulk_load(debuglvl, sf, serv_backend, CAT_SERVICES, init_services_load, &sl);
+    if(result < 0)
+        return(-1);
+    else if(result == 0)
+    {
+        /*
+            now loop trough the list and insert
+        */
+        while(sf->list(debuglvl, serv_backend, name, &zonetype, CAT_SERVICES) != NULL)
         {
-            /* now call insert_service, which will gather the info and insert it into the list */
-            result = insert_service(debuglvl, services, name);
-            if(result == 0)
-            {
-                if(debuglvl >= LOW)
-                    (void)vrprint.debug(__FUNC__, "loading service succes: '%s'.", name);
-            }
-            else if(result == 1)
-            {
-                /* we failed, but non-fatal (e.g. inactive) */
-                if(debuglvl >= LOW)
-                    (void)vrprint.debug(__FUNC__, "loading service failed with a non fatal failure: '%s'.", name);
-            }
-            else
-            {
-                /* failed with fatal error */
-                (void)vrprint.error(-1, "Internal Error", "insert_service() failed (in: %s:%d).",
-                        __FUNC__, __LINE__);
+            if(init_services_load(debuglvl, &sl, sf, serv_backend, name, zonetype) < 0)
                 return(-1);
-            }
         }
     }
 
@@ -1242,6 +1410,14 @@ services_check(const int debuglvl, struct ServicesData_ *ser_ptr)
 }
 
 
+/* check one service for load_services. 'ctx' is the array of services. */
+static int
+load_services_check(const int debuglvl, void *ctx, unsigned int i)
+{
+    return(services_check(debuglvl, ((struct ServicesData_ **)ctx)[i]));
+}
+
+
 /*  load_services
 
     calls init_services and does some checking
@@ -1255,7 +1431,11 @@ load_services(const int debuglvl, Services *services, struct rgx_ *reg)
 {
     int                     result = 0;
     d_list_node             *d_node = NULL;
-    struct ServicesData_    *ser_ptr = NULL;
+    struct ServicesData_    *ser_ptr = NULL,
+                            **ser_array = NULL;
+    unsigned int            n = 0,
+                            i = 0;
+    ParallelJob             job;
 
 
     (void)vrprint.info("Info", "Loading services...");
@@ -1267,6 +1447,14 @@ load_services(const int debuglvl, Services *services, struct rgx_ *reg)
         return(-1);
     }
 
+    /* the checks are done in parallel */
+    if(!(ser_array = calloc(services->list.len + 1, sizeof(struct ServicesData_ *))))
+    {
+        (void)vrprint.error(-1, "Error", "calloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
     for(d_node = services->list.top; d_node; d_node = d_node->next)
     {
         ser_ptr = d_node->data;
@@ -1274,13 +1462,34 @@ load_services(const int debuglvl, Services *services, struct rgx_ *reg)
         {
             (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
                     __FUNC__, __LINE__);
+            free(ser_array);
             return(-1);
         }
 
-        result = services_check(debuglvl, ser_ptr);
-        if(result == -1)
+        ser_array[n++] = ser_ptr;
+    }
+
+    if(parallel_setup(debuglvl, &job, n, load_services_check, ser_array) < 0)
+    {
+        free(ser_array);
+        return(-1);
+    }
+    (void)parallel_run(debuglvl, &job, NULL);
+
+    /* report in the order of the list */
+    for(i = 0; i < n; i++)
+    {
+        ser_ptr = ser_array[i];
+
+        parallel_replay(debuglvl, &job, i);
+
+        if(job.results[i] == -1)
+        {
+            parallel_cleanup(debuglvl, &job);
+            free(ser_array);
             return(-1);
-        else if(result == 0)
+        }
+        else if(job.results[i] == 0)
         {
             (void)vrprint.info("Info", "Service '%s' has been deactivated because of errors while checking it.",
                     ser_ptr->name);
@@ -1288,6 +1497,9 @@ load_services(const int debuglvl, Services *services, struct rgx_ *reg)
         }
     }
 
+    parallel_cleanup(debuglvl, &job);
+    free(ser_array);
+
     (void)vrprint.info("Info", "Loading services succesfull.");
     return(0);
 }
@@ -62,6 +62,21 @@ libvuurmuur_is_shape_outgoing_rule(const int debuglvl, /*@null@*/struct options
     return(0);
 }
 
+/*  the leaf qdiscs that can be put under a shaping class */
+int
+libvuurmuur_is_shape_leaf(const int debuglvl, /*@null@*/const char *leaf) {
+    if (leaf != NULL &&
+        (strcmp(leaf, "sfq") == 0 ||
+        strcmp(leaf, "fq_codel") == 0 ||
+        strcmp(leaf, "cake") == 0 ||
+        strcmp(leaf, "fq") == 0))
+    {
+        return(1);
+    }
+
+    return(0);
+}
+
 int
 libvuurmuur_is_shape_interface(const int debuglvl, /*@null@*/InterfaceData *iface_ptr) {
     if (iface_ptr != NULL &&
@@ -0,0 +1,1012 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <stdint.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+/*
+    The backend snapshot
+
+    After every succesful (re)load the daemon writes all objects of the
+    backends (services, interfaces, zones and rules) with their variables
+    to SNAPSHOT_LOCATION. The file contains no pointers, only offsets
+    from the start of the file, so other tools can mmap it read-only and
+    use it as is. A hash index on type and name is included.
+
+    When a tool attaches to a fresh snapshot, the ask, list and bulk
+    functions of the backends are answered from the snapshot. The
+    first change through the backend (tell, add, del, rename) removes
+    the snapshot and detaches, so from then on the backend is used.
+
+    A snapshot is fresh when the config file is unchanged, the daemon
+    that wrote it is still running and the backends report no change
+    to their storage since it was written (see the 'stamp' backend
+    function). So hand edits of the files make the tools use the
+    backends again. Backends without a stamp function get no snapshot.
+*/
+
+#define SNAPSHOT_MAGIC      "VRMRSNAP"
+#define SNAPSHOT_VERSION    2
+#define SNAPSHOT_NONE       0xffffffffU
+
+struct SnapshotHeader_
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    header_size;
+    uint64_t    size;           /* size of the whole file */
+
+    /* the config this snapshot was created with */
+    char        configfile[256];
+    uint64_t    config_dev;
+    uint64_t    config_ino;
+    uint64_t    config_size;
+    int64_t     config_mtime;
+    int64_t     config_mtime_nsec;
+
+    int64_t     created;
+    int32_t     pid;            /* the daemon that wrote it */
+
+    /* newest change of the backend storage per CAT_*, when it was written */
+    int64_t     stamp_sec[4];
+    int64_t     stamp_nsec[4];
+
+    uint32_t    objects;        /* offset of the objects */
+    uint32_t    nobjects;
+    uint32_t    vars;           /* offset of the variables */
+    uint32_t    nvars;
+    uint32_t    index;          /* offset of the hash index */
+    uint32_t    index_rows;
+};
+
+struct SnapshotObject_
+{
+    uint32_t    name;           /* offset of the name */
+    int32_t     category;       /* CAT_* */
+    int32_t     type;           /* TYPE_* */
+    uint32_t    first_var;
+    uint32_t    nvars;
+    uint32_t    next;           /* next object in the same index row */
+};
+
+struct SnapshotVar_
+{
+    uint32_t    variable;       /* offset of the variable */
+    uint32_t    value;          /* offset of the value */
+};
+
+
+/* a backend while attached: the real functions and our replacement */
+struct SnapshotBackend_
+{
+    struct BackendFunctions_    **func_ptr;
+    struct BackendFunctions_    *real;
+    struct BackendFunctions_    shim;
+    uint32_t                    list_pos;
+};
+
+static struct SnapshotBackend_  snapshot_backend[4];
+
+/* the mapped snapshot, NULL if not attached */
+static char                     *snapshot_map = NULL;
+static size_t                   snapshot_size = 0;
+
+/* position of the last answer to a 'multi' question */
+static uint32_t                 snapshot_multi_var = SNAPSHOT_NONE;
+static char                     snapshot_multi_question[64] = "";
+
+
+/* the snapshot_backend entry for a TYPE_* */
+static struct SnapshotBackend_ *
+snapshot_backend_by_type(int type)
+{
+    switch(type)
+    {
+        case TYPE_SERVICE:
+            return(&snapshot_backend[CAT_SERVICES]);
+        case TYPE_INTERFACE:
+            return(&snapshot_backend[CAT_INTERFACES]);
+        case TYPE_RULE:
+            return(&snapshot_backend[CAT_RULES]);
+        default:
+            return(&snapshot_backend[CAT_ZONES]);
+    }
+}
+
+
+static unsigned int
+snapshot_hash(const char *name, int type)
+{
+    return(hash_name(name) + (unsigned int)type);
+}
+
+
+static const struct SnapshotHeader_ *
+snapshot_header(void)
+{
+    return((const struct SnapshotHeader_ *)snapshot_map);
+}
+
+
+static const struct SnapshotObject_ *
+snapshot_object(uint32_t i)
+{
+    return((const struct SnapshotObject_ *)(snapshot_map + snapshot_header()->objects) + i);
+}
+
+
+static const struct SnapshotVar_ *
+snapshot_var(uint32_t i)
+{
+    return((const struct SnapshotVar_ *)(snapshot_map + snapshot_header()->vars) + i);
+}
+
+
+/*  snapshot_lookup
+
+    Returns the index of the object or SNAPSHOT_NONE.
+*/
+static uint32_t
+snapshot_lookup(const char *name, int type)
+{
+    const struct SnapshotHeader_    *hdr = snapshot_header();
+    const uint32_t                  *index = NULL;
+    const struct SnapshotObject_    *obj = NULL;
+    uint32_t                        i = 0;
+
+    index = (const uint32_t *)(snapshot_map + hdr->index);
+
+    for(i = index[snapshot_hash(name, type) % hdr->index_rows]; i != SNAPSHOT_NONE; i = obj->next)
+    {
+        obj = snapshot_object(i);
+
+        if(obj->type == type && strcmp(snapshot_map + obj->name, name) == 0)
+            return(i);
+    }
+
+    return(SNAPSHOT_NONE);
+}
+
+
+/*
+    The functions replacing the backend functions while attached.
+*/
+
+static int
+snapshot_ask(int debuglvl, void *backend, char *name, char *question,
+        char *answer, size_t max_answer, int type, int multi)
+{
+    const struct SnapshotObject_    *obj = NULL;
+    const struct SnapshotVar_       *var = NULL;
+    uint32_t                        i = 0,
+                                    o = SNAPSHOT_NONE;
+    size_t                          len = 0;
+    const char                      *v = NULL,
+                                    *q = NULL;
+    int                             retval = 0;
+
+    if(snapshot_map != NULL && name != NULL && question != NULL)
+        o = snapshot_lookup(name, type);
+
+    if(o == SNAPSHOT_NONE)
+    {
+        return(snapshot_backend_by_type(type)->real->ask(debuglvl, backend,
+                name, question, answer, max_answer, type, multi));
+    }
+
+    obj = snapshot_object(o);
+    i = obj->first_var;
+
+    /* continue a 'multi' question where we left off */
+    if(multi == 1 && snapshot_multi_var != SNAPSHOT_NONE &&
+       snapshot_multi_var >= obj->first_var &&
+       snapshot_multi_var < obj->first_var + obj->nvars &&
+       strcmp(snapshot_multi_question, question) == 0)
+        i = snapshot_multi_var + 1;
+
+    for( ; i < obj->first_var + obj->nvars; i++)
+    {
+        var = snapshot_var(i);
+
+        /* the question is uppercase, the variable is used as is */
+        for(q = question, v = snapshot_map + var->variable;
+            *q != '\0' && toupper((unsigned char)*q) == *v; q++, v++);
+        if(*q != '\0' || *v != '\0')
+            continue;
+
+        len = strlcpy(answer, snapshot_map + var->value, max_answer);
+        if(len >= max_answer)
+        {
+            (void)vrprint.error(-1, "Error", "buffer overrun when reading '%s', question '%s': len %u, max: %u (in: %s:%d).",
+                    name, question, len, max_answer, __FUNC__, __LINE__);
+            snapshot_multi_var = SNAPSHOT_NONE;
+            return(-1);
+        }
+
+        /* only return when bigger than 0 */
+        if(len > 0)
+            retval = 1;
+
+        break;
+    }
+
+    if(multi == 1 && retval == 1)
+    {
+        snapshot_multi_var = i;
+        (void)strlcpy(snapshot_multi_question, question, sizeof(snapshot_multi_question));
+    }
+    else
+    {
+        snapshot_multi_var = SNAPSHOT_NONE;
+    }
+
+    return(retval);
+}
+
+
+static char *
+snapshot_list(int debuglvl, void *backend, char *name, int *zonetype, int type)
+{
+    struct SnapshotBackend_         *sb = &snapshot_backend[type];
+    const struct SnapshotObject_    *obj = NULL;
+    size_t                          size = 0;
+
+    if(snapshot_map == NULL)
+        return(sb->real->list(debuglvl, backend, name, zonetype, type));
+
+    /* the size of the buffers the callers use */
+    if(type == CAT_ZONES)
+        size = MAX_HOST_NET_ZONE;
+    else if(type == CAT_INTERFACES)
+        size = MAX_INTERFACE;
+    else
+        size = MAX_SERVICE;
+
+    for( ; sb->list_pos < snapshot_header()->nobjects; sb->list_pos++)
+    {
+        obj = snapshot_object(sb->list_pos);
+        if(obj->category != type)
+            continue;
+
+        (void)strlcpy(name, snapshot_map + obj->name, size);
+        *zonetype = obj->type;
+
+        sb->list_pos++;
+        return(name);
+    }
+
+    /* done, start over next time */
+    sb->list_pos = 0;
+    return(NULL);
+}
+
+
+static int
+snapshot_bulk(int debuglvl, void *backend, int type,
+        int (*cb)(int debuglvl, void *ctx, char *name, int zonetype, struct BackendBulkVar_ *vars, unsigned int nvars),
+        void *ctx)
+{
+    struct SnapshotBackend_         *sb = &snapshot_backend[type];
+    const struct SnapshotObject_    *obj = NULL;
+    struct BackendBulkVar_          *vars = NULL;
+    char                            name[MAX_HOST_NET_ZONE] = "";
+    uint32_t                        o = 0,
+                                    i = 0,
+                                    nobjects = 0;
+    int                             zonetype = 0,
+                                    retval = 0;
+
+    if(snapshot_map == NULL)
+    {
+        if(sb->real->bulk != NULL)
+            return(sb->real->bulk(debuglvl, backend, type, cb, ctx));
+
+        /* no bulk function: hand out the objects without variables */
+        while(sb->real->list(debuglvl, backend, name, &zonetype, type) != NULL)
+        {
+            if(cb(debuglvl, ctx, name, zonetype, NULL, 0) < 0)
+                return(-1);
+        }
+        return(0);
+    }
+
+    /* a change while loading detaches us, so remember the size */
+    nobjects = snapshot_header()->nobjects;
+
+    for(o = 0; o < nobjects && snapshot_map != NULL; o++)
+    {
+        obj = snapshot_object(o);
+        if(obj->category != type)
+            continue;
+
+        /* the variables are strings in the map, hand out pointers to them */
+        if(!(vars = malloc((obj->nvars + 1) * sizeof(struct BackendBulkVar_))))
+        {
+            (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                    strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+        for(i = 0; i < obj->nvars; i++)
+        {
+            vars[i].variable = snapshot_map + snapshot_var(obj->first_var + i)->variable;
+            vars[i].value = snapshot_map + snapshot_var(obj->first_var + i)->value;
+        }
+
+        (void)strlcpy(name, snapshot_map + obj->name, sizeof(name));
+
+        retval = cb(debuglvl, ctx, name, obj->type, vars, obj->nvars);
+        free(vars);
+
+        if(retval < 0)
+            return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  snapshot_invalidate
+
+    Called before changing the backend: the snapshot is no longer
+    valid, so remove it and use the backend from now on.
+*/
+static void
+snapshot_invalidate(const int debuglvl)
+{
+    if(snapshot_map == NULL)
+        return;
+
+    if(unlink(SNAPSHOT_LOCATION) == -1 && errno != ENOENT)
+    {
+        (void)vrprint.error(-1, "Error", "removing '%s' failed: %s (in: %s:%d).",
+                SNAPSHOT_LOCATION, strerror(errno), __FUNC__, __LINE__);
+    }
+
+    snapshot_detach(debuglvl);
+}
+
+
+static int
+snapshot_tell(int debuglvl, void *backend, char *name, char *question,
+        char *answer, int overwrite, int type)
+{
+    snapshot_invalidate(debuglvl);
+    return(snapshot_backend_by_type(type)->real->tell(debuglvl, backend,
+            name, question, answer, overwrite, type));
+}
+
+
+static int
+snapshot_add(int debuglvl, void *backend, char *name, int type)
+{
+    snapshot_invalidate(debuglvl);
+    return(snapshot_backend_by_type(type)->real->add(debuglvl, backend, name, type));
+}
+
+
+static int
+snapshot_del(int debuglvl, void *backend, char *name, int type, int recurs)
+{
+    snapshot_invalidate(debuglvl);
+    return(snapshot_backend_by_type(type)->real->del(debuglvl, backend, name, type, recurs));
+}
+
+
+static int
+snapshot_rename(int debuglvl, void *backend, char *name, char *newname, int type)
+{
+    snapshot_invalidate(debuglvl);
+    return(snapshot_backend_by_type(type)->real->rename(debuglvl, backend, name, newname, type));
+}
+
+
+/*
+    Writing the snapshot
+*/
+
+/* the snapshot while we collect it */
+struct SnapshotWrite_
+{
+    int                     category;
+    int                     failed;
+
+    struct SnapshotObject_  *objects;
+    uint32_t                nobjects,
+                            objects_size;
+
+    struct SnapshotVar_     *vars;
+    uint32_t                nvars,
+                            vars_size;
+
+    /* offsets are relative to the start of the strings for now */
+    char                    *strings;
+    size_t                  strings_len,
+                            strings_size;
+};
+
+
+/* grow 'ptr' so it can hold 'needed' elements of 'elem_size' */
+static int
+snapshot_grow(void **ptr, uint32_t *size, uint32_t needed, size_t elem_size)
+{
+    void        *new_ptr = NULL;
+    uint32_t    new_size = *size ? *size : 64;
+
+    if(needed <= *size)
+        return(0);
+
+    while(new_size < needed)
+        new_size *= 2;
+
+    if(!(new_ptr = realloc(*ptr, new_size * elem_size)))
+    {
+        (void)vrprint.error(-1, "Error", "realloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    *ptr = new_ptr;
+    *size = new_size;
+    return(0);
+}
+
+
+/* add a string to the strings, returns its offset or SNAPSHOT_NONE */
+static uint32_t
+snapshot_add_string(struct SnapshotWrite_ *sw, const char *str)
+{
+    size_t      len = strlen(str) + 1;
+    uint32_t    offset = (uint32_t)sw->strings_len;
+    uint32_t    size = (uint32_t)sw->strings_size;
+
+    if(sw->strings_len + len >= SNAPSHOT_NONE / 2)
+        return(SNAPSHOT_NONE);
+
+    if(snapshot_grow((void **)&sw->strings, &size, (uint32_t)(sw->strings_len + len), 1) < 0)
+        return(SNAPSHOT_NONE);
+    sw->strings_size = size;
+
+    memcpy(sw->strings + sw->strings_len, str, len);
+    sw->strings_len += len;
+    return(offset);
+}
+
+
+static int
+snapshot_collect(int debuglvl, void *ctx, char *name, int zonetype,
+        struct BackendBulkVar_ *vars, unsigned int nvars)
+{
+    struct SnapshotWrite_   *sw = ctx;
+    struct SnapshotObject_  *obj = NULL;
+    unsigned int            i = 0;
+
+    if(sw->failed)
+        return(0);
+
+    /*  we can't read this object in one go, so we can't make a
+        snapshot. We don't stop the backend halfway though. */
+    if(vars == NULL)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "no variables for '%s', no snapshot.", name);
+        sw->failed = 1;
+        return(0);
+    }
+
+    if(snapshot_grow((void **)&sw->objects, &sw->objects_size, sw->nobjects + 1, sizeof(struct SnapshotObject_)) < 0 ||
+       snapshot_grow((void **)&sw->vars, &sw->vars_size, sw->nvars + nvars, sizeof(struct SnapshotVar_)) < 0)
+    {
+        sw->failed = 1;
+        return(0);
+    }
+
+    obj = &sw->objects[sw->nobjects];
+    obj->category = sw->category;
+    obj->type = zonetype;
+    obj->first_var = sw->nvars;
+    obj->nvars = nvars;
+    obj->next = SNAPSHOT_NONE;
+
+    if((obj->name = snapshot_add_string(sw, name)) == SNAPSHOT_NONE)
+    {
+        sw->failed = 1;
+        return(0);
+    }
+
+    for(i = 0; i < nvars; i++)
+    {
+        sw->vars[sw->nvars + i].variable = snapshot_add_string(sw, vars[i].variable);
+        sw->vars[sw->nvars + i].value = snapshot_add_string(sw, vars[i].value);
+
+        if(sw->vars[sw->nvars + i].variable == SNAPSHOT_NONE ||
+           sw->vars[sw->nvars + i].value == SNAPSHOT_NONE)
+        {
+            sw->failed = 1;
+            return(0);
+        }
+    }
+
+    sw->nvars += nvars;
+    sw->nobjects++;
+    return(0);
+}
+
+
+/* write 'len' bytes or fail */
+static int
+snapshot_write_all(int fd, const void *buf, size_t len)
+{
+    const char  *p = buf;
+    ssize_t     n = 0;
+
+    while(len > 0)
+    {
+        if((n = write(fd, p, len)) == -1)
+        {
+            if(errno == EINTR)
+                continue;
+            return(-1);
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+
+    return(0);
+}
+
+
+/*  snapshot_write
+
+    Writes the snapshot of the backends. To be called by the daemon
+    after loading succesfully. Backends without a bulk or stamp
+    function are not supported, then no snapshot is written.
+
+    Returncodes:
+         0: ok (or nothing written)
+        -1: error
+*/
+int
+snapshot_write(const int debuglvl)
+{
+    struct SnapshotWrite_   sw;
+    struct SnapshotHeader_  hdr;
+    struct BackendFunctions_    *f[4];
+    void                    *backend[4];
+    struct timespec         stamp[4];
+    uint32_t                *index = NULL;
+    uint32_t                i = 0,
+                            row = 0;
+    uint64_t                size = 0;
+    struct stat             st;
+    char                    tmp_location[sizeof(SNAPSHOT_LOCATION) + 4] = "";
+    int                     fd = -1,
+                            cat = 0,
+                            retval = 0;
+
+    f[CAT_ZONES] = zf;          backend[CAT_ZONES] = zone_backend;
+    f[CAT_SERVICES] = sf;       backend[CAT_SERVICES] = serv_backend;
+    f[CAT_INTERFACES] = af;     backend[CAT_INTERFACES] = ifac_backend;
+    f[CAT_RULES] = rf;          backend[CAT_RULES] = rule_backend;
+
+    for(cat = CAT_ZONES; cat <= CAT_RULES; cat++)
+    {
+        if(f[cat] == NULL || f[cat]->bulk == NULL || f[cat]->stamp == NULL)
+        {
+            if(debuglvl >= LOW)
+                (void)vrprint.debug(__FUNC__, "backend has no bulk or stamp function, no snapshot.");
+            (void)unlink(SNAPSHOT_LOCATION);
+            return(0);
+        }
+    }
+
+    if(stat(conf.configfile, &st) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "stat '%s' failed: %s (in: %s:%d).",
+                conf.configfile, strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    /*  stamp before collecting: a change while we collect makes the
+        snapshot look stale, never fresh */
+    for(cat = CAT_ZONES; cat <= CAT_RULES; cat++)
+    {
+        if(f[cat]->stamp(debuglvl, backend[cat], cat, &stamp[cat]) < 0)
+        {
+            (void)unlink(SNAPSHOT_LOCATION);
+            return(-1);
+        }
+    }
+
+    /* collect the objects */
+    memset(&sw, 0, sizeof(sw));
+
+    for(cat = CAT_ZONES; cat <= CAT_RULES && !sw.failed; cat++)
+    {
+        sw.category = cat;
+
+        if(f[cat]->bulk(debuglvl, backend[cat], cat, snapshot_collect, &sw) < 0)
+            sw.failed = 1;
+    }
+
+    if(sw.failed || sw.nobjects == 0)
+    {
+        /* an old one would be wrong now */
+        (void)unlink(SNAPSHOT_LOCATION);
+        retval = sw.failed ? -1 : 0;
+        goto end;
+    }
+
+    /* the index */
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.index_rows = sw.nobjects * 2 + 1;
+
+    if(!(index = malloc(hdr.index_rows * sizeof(uint32_t))))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        retval = -1;
+        goto end;
+    }
+    for(row = 0; row < hdr.index_rows; row++)
+        index[row] = SNAPSHOT_NONE;
+
+    for(i = sw.nobjects; i > 0; i--)
+    {
+        row = snapshot_hash(sw.strings + sw.objects[i - 1].name,
+                sw.objects[i - 1].type) % hdr.index_rows;
+
+        sw.objects[i - 1].next = index[row];
+        index[row] = i - 1;
+    }
+
+    /* the header, the layout is: header, objects, vars, index, strings */
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.header_size = sizeof(hdr);
+    (void)strlcpy(hdr.configfile, conf.configfile, sizeof(hdr.configfile));
+    hdr.config_dev = st.st_dev;
+    hdr.config_ino = st.st_ino;
+    hdr.config_size = st.st_size;
+    hdr.config_mtime = st.st_mtim.tv_sec;
+    hdr.config_mtime_nsec = st.st_mtim.tv_nsec;
+    hdr.created = time(NULL);
+    hdr.pid = getpid();
+    for(cat = CAT_ZONES; cat <= CAT_RULES; cat++)
+    {
+        hdr.stamp_sec[cat] = stamp[cat].tv_sec;
+        hdr.stamp_nsec[cat] = stamp[cat].tv_nsec;
+    }
+
+    hdr.objects = sizeof(hdr);
+    hdr.nobjects = sw.nobjects;
+    hdr.vars = hdr.objects + sw.nobjects * sizeof(struct SnapshotObject_);
+    hdr.nvars = sw.nvars;
+    hdr.index = hdr.vars + sw.nvars * sizeof(struct SnapshotVar_);
+    size = hdr.index + hdr.index_rows * sizeof(uint32_t);
+
+    if(size + sw.strings_len >= SNAPSHOT_NONE)
+    {
+        (void)vrprint.error(-1, "Error", "snapshot too big (in: %s:%d).",
+                __FUNC__, __LINE__);
+        retval = -1;
+        goto end;
+    }
+
+    /* make the string offsets relative to the start of the file */
+    for(i = 0; i < sw.nobjects; i++)
+        sw.objects[i].name += (uint32_t)size;
+    for(i = 0; i < sw.nvars; i++)
+    {
+        sw.vars[i].variable += (uint32_t)size;
+        sw.vars[i].value += (uint32_t)size;
+    }
+    hdr.size = size + sw.strings_len;
+
+    /* write to a tempfile and rename it, so readers never see half a snapshot */
+    snprintf(tmp_location, sizeof(tmp_location), "%s.tmp", SNAPSHOT_LOCATION);
+
+    if((fd = open(tmp_location, O_WRONLY|O_CREAT|O_TRUNC, 0600)) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "creating '%s' failed: %s (in: %s:%d).",
+                tmp_location, strerror(errno), __FUNC__, __LINE__);
+        retval = -1;
+        goto end;
+    }
+
+    if(snapshot_write_all(fd, &hdr, sizeof(hdr)) < 0 ||
+       snapshot_write_all(fd, sw.objects, sw.nobjects * sizeof(struct SnapshotObject_)) < 0 ||
+       snapshot_write_all(fd, sw.vars, sw.nvars * sizeof(struct SnapshotVar_)) < 0 ||
+       snapshot_write_all(fd, index, hdr.index_rows * sizeof(uint32_t)) < 0 ||
+       snapshot_write_all(fd, sw.strings, sw.strings_len) < 0 ||
+       fsync(fd) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "writing '%s' failed: %s (in: %s:%d).",
+                tmp_location, strerror(errno), __FUNC__, __LINE__);
+        (void)close(fd);
+        (void)unlink(tmp_location);
+        retval = -1;
+        goto end;
+    }
+
+    if(close(fd) == -1 || rename(tmp_location, SNAPSHOT_LOCATION) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "saving '%s' failed: %s (in: %s:%d).",
+                SNAPSHOT_LOCATION, strerror(errno), __FUNC__, __LINE__);
+        (void)unlink(tmp_location);
+        retval = -1;
+        goto end;
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "snapshot written: %u objects, %u variables, %u bytes.",
+                hdr.nobjects, hdr.nvars, (unsigned int)hdr.size);
+
+end:
+    free(index);
+    free(sw.objects);
+    free(sw.vars);
+    free(sw.strings);
+    return(retval);
+}
+
+
+/*
+    Attaching to the snapshot
+*/
+
+/* did the storage of one of the backends change after the snapshot was written? */
+static int
+snapshot_stamps_changed(const int debuglvl, const struct SnapshotHeader_ *hdr)
+{
+    struct BackendFunctions_    *f[4];
+    void                        *backend[4];
+    struct timespec             ts;
+    int                         cat = 0;
+
+    f[CAT_ZONES] = zf;          backend[CAT_ZONES] = zone_backend;
+    f[CAT_SERVICES] = sf;       backend[CAT_SERVICES] = serv_backend;
+    f[CAT_INTERFACES] = af;     backend[CAT_INTERFACES] = ifac_backend;
+    f[CAT_RULES] = rf;          backend[CAT_RULES] = rule_backend;
+
+    for(cat = CAT_ZONES; cat <= CAT_RULES; cat++)
+    {
+        if(f[cat] == NULL || f[cat]->stamp == NULL ||
+           f[cat]->stamp(debuglvl, backend[cat], cat, &ts) < 0 ||
+           hdr->stamp_sec[cat] != (int64_t)ts.tv_sec ||
+           hdr->stamp_nsec[cat] != (int64_t)ts.tv_nsec)
+            return(1);
+    }
+
+    return(0);
+}
+
+
+/* check the snapshot before we trust it */
+static int
+snapshot_check(const int debuglvl, const char *map, size_t size)
+{
+    const struct SnapshotHeader_    *hdr = (const struct SnapshotHeader_ *)map;
+    const struct SnapshotObject_    *obj = NULL;
+    const struct SnapshotVar_       *var = NULL;
+    const uint32_t                  *index = NULL;
+    struct stat                     st;
+    uint32_t                        i = 0;
+
+    if(size < sizeof(struct SnapshotHeader_) ||
+       memcmp(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic)) != 0 ||
+       hdr->version != SNAPSHOT_VERSION ||
+       hdr->header_size != sizeof(struct SnapshotHeader_) ||
+       hdr->size != size)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "snapshot has the wrong format.");
+        return(0);
+    }
+
+    /* is it still fresh? */
+    if(strncmp(hdr->configfile, conf.configfile, sizeof(hdr->configfile)) != 0 ||
+       stat(conf.configfile, &st) == -1 ||
+       hdr->config_dev != (uint64_t)st.st_dev ||
+       hdr->config_ino != (uint64_t)st.st_ino ||
+       hdr->config_size != (uint64_t)st.st_size ||
+       hdr->config_mtime != (int64_t)st.st_mtim.tv_sec ||
+       hdr->config_mtime_nsec != (int64_t)st.st_mtim.tv_nsec)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "config changed since the snapshot was written.");
+        return(0);
+    }
+    if(hdr->pid <= 0 || (kill((pid_t)hdr->pid, 0) == -1 && errno != EPERM))
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "the daemon that wrote the snapshot is gone.");
+        return(0);
+    }
+    if(snapshot_stamps_changed(debuglvl, hdr))
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "backend changed since the snapshot was written.");
+        return(0);
+    }
+
+    /* all offsets must be inside the file, and the strings terminated */
+    if(hdr->objects < sizeof(struct SnapshotHeader_) ||
+       hdr->objects + (uint64_t)hdr->nobjects * sizeof(struct SnapshotObject_) > size ||
+       hdr->vars + (uint64_t)hdr->nvars * sizeof(struct SnapshotVar_) > size ||
+       hdr->index_rows == 0 ||
+       hdr->index + (uint64_t)hdr->index_rows * sizeof(uint32_t) > size ||
+       hdr->objects % sizeof(uint32_t) != 0 || hdr->vars % sizeof(uint32_t) != 0 ||
+       hdr->index % sizeof(uint32_t) != 0 ||
+       map[size - 1] != '\0')
+        goto corrupt;
+
+    index = (const uint32_t *)(map + hdr->index);
+    for(i = 0; i < hdr->index_rows; i++)
+    {
+        if(index[i] != SNAPSHOT_NONE && index[i] >= hdr->nobjects)
+            goto corrupt;
+    }
+
+    for(i = 0; i < hdr->nobjects; i++)
+    {
+        obj = (const struct SnapshotObject_ *)(map + hdr->objects) + i;
+
+        if(obj->name >= size || obj->category < CAT_ZONES || obj->category > CAT_RULES ||
+           (uint64_t)obj->first_var + obj->nvars > hdr->nvars ||
+           (obj->next != SNAPSHOT_NONE && obj->next >= hdr->nobjects))
+            goto corrupt;
+    }
+
+    for(i = 0; i < hdr->nvars; i++)
+    {
+        var = (const struct SnapshotVar_ *)(map + hdr->vars) + i;
+
+        if(var->variable >= size || var->value >= size)
+            goto corrupt;
+    }
+
+    return(1);
+
+corrupt:
+    (void)vrprint.warning("Warning", "ignoring corrupt snapshot '%s'.", SNAPSHOT_LOCATION);
+    return(0);
+}
+
+
+/*  snapshot_attach
+
+    Maps the snapshot and, if it is fresh, answers the backend
+    questions from it. To be called after load_backends.
+
+    Returncodes:
+         1: attached
+         0: no (fresh) snapshot, the backends are used
+*/
+int
+snapshot_attach(const int debuglvl)
+{
+    struct BackendFunctions_    **func_ptr[4];
+    struct SnapshotBackend_     *sb = NULL;
+    struct stat                 st;
+    void                        *map = NULL;
+    int                         fd = -1,
+                                cat = 0;
+
+    if(snapshot_map != NULL)
+        return(1);
+
+    if((fd = open(SNAPSHOT_LOCATION, O_RDONLY)) == -1)
+        return(0);
+
+    /* only trust a snapshot written by root that nobody else can change */
+    if(fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_uid != 0 ||
+       (st.st_mode & (S_IWGRP|S_IWOTH)) || st.st_size <= 0 ||
+       (uint64_t)st.st_size >= SNAPSHOT_NONE)
+    {
+        (void)close(fd);
+        return(0);
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    (void)close(fd);
+    if(map == MAP_FAILED)
+    {
+        (void)vrprint.error(-1, "Error", "mmap of '%s' failed: %s (in: %s:%d).",
+                SNAPSHOT_LOCATION, strerror(errno), __FUNC__, __LINE__);
+        return(0);
+    }
+
+    if(snapshot_check(debuglvl, map, (size_t)st.st_size) == 0)
+    {
+        (void)munmap(map, (size_t)st.st_size);
+        return(0);
+    }
+
+    /* replace the backend functions */
+    func_ptr[CAT_ZONES] = &zf;
+    func_ptr[CAT_SERVICES] = &sf;
+    func_ptr[CAT_INTERFACES] = &af;
+    func_ptr[CAT_RULES] = &rf;
+
+    for(cat = CAT_ZONES; cat <= CAT_RULES; cat++)
+    {
+        sb = &snapshot_backend[cat];
+
+        sb->func_ptr = func_ptr[cat];
+        sb->real = *func_ptr[cat];
+        sb->list_pos = 0;
+
+        sb->shim = *sb->real;
+        sb->shim.ask = snapshot_ask;
+        sb->shim.list = snapshot_list;
+        sb->shim.bulk = snapshot_bulk;
+        sb->shim.tell = snapshot_tell;
+        sb->shim.add = snapshot_add;
+        sb->shim.del = snapshot_del;
+        sb->shim.rename = snapshot_rename;
+
+        *sb->func_ptr = &sb->shim;
+    }
+
+    snapshot_map = map;
+    snapshot_size = (size_t)st.st_size;
+    snapshot_multi_var = SNAPSHOT_NONE;
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "attached to snapshot: %u objects.",
+                snapshot_header()->nobjects);
+
+    return(1);
+}
+
+
+/*  snapshot_detach
+
+    Stop using the snapshot and use the backends again.
+*/
+void
+snapshot_detach(const int debuglvl)
+{
+    struct SnapshotBackend_ *sb = NULL;
+    int                     cat = 0;
+
+    if(snapshot_map == NULL)
+        return;
+
+    for(cat = CAT_ZONES; cat <= CAT_RULES; cat++)
+    {
+        sb = &snapshot_backend[cat];
+
+        /*  a bulk load in progress still has our shim as its real
+            backend, which just passes everything on now. */
+        *sb->func_ptr = sb->real;
+    }
+
+    (void)munmap(snapshot_map, snapshot_size);
+    snapshot_map = NULL;
+    snapshot_size = 0;
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "detached from the snapshot.");
+}
@@ -0,0 +1,798 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <stdint.h>
+#include <libgen.h>
+#include <sys/mman.h>
+
+/*
+    The traffic volume store
+
+    The daemon samples the byte counters of the interfaces every minute
+    and adds what was transferred since the last sample to the store.
+    Every series (an interface, or anything else with an in- and an
+    outgoing counter) has a ring of buckets for each of the rollups:
+    minutes, hours and days. A bucket holds the number of the period it
+    is for, so a bucket that was not written since the ring went round
+    is recognized as empty.
+
+    The file is a header followed by the fixed size records of the
+    series, so readers can mmap it and use it as is. The writer only
+    appends new series and grows the file when needed: a reader only
+    looks at the series that fit in what it mapped.
+
+    Periods are counted in local time, so a day bucket is a day on the
+    clock of the firewall.
+*/
+
+#define TRAFVOL_MAGIC       "VRMRTVOL"
+#define TRAFVOL_VERSION     1
+
+/* number of series the file grows with */
+#define TRAFVOL_GROW        16
+
+/* rows in the name hash of the writer */
+#define TRAFVOL_HASH_ROWS   1024
+
+/* don't trust more than this number of buckets per rollup */
+#define TRAFVOL_MAX_SLOTS   (1 << 20)
+
+/* a day with minutes, two months with hours and two years with days */
+static const unsigned int   trafvol_default_slots[TRAFVOL_UNITS] = { 1440, 1488, 732 };
+
+static const unsigned int   trafvol_unit_seconds[TRAFVOL_UNITS] = { 60, 3600, 86400 };
+
+struct TrafVolHeader_
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    header_size;
+    uint32_t    slots[TRAFVOL_UNITS];
+    uint32_t    record_size;
+    uint32_t    nseries;        /* series in use */
+    uint32_t    capacity;       /* series the file has room for */
+};
+
+struct TrafVolRecord_
+{
+    char        name[32];
+    int32_t     source;         /* TRAFVOL_SRC_* */
+    uint32_t    reserved;
+
+    /* the counters at the last sample */
+    uint64_t    last_in;
+    uint64_t    last_out;
+    int64_t     last_time;
+
+    /* followed by the buckets of the rollups */
+};
+
+struct TrafVolBucket_
+{
+    uint64_t    in;
+    uint64_t    out;
+    uint32_t    period;         /* 0: never used */
+    uint32_t    reserved;
+};
+
+/* the writer keeps the series by name */
+struct TrafVolName_
+{
+    /* this should always be on top: we hash on it */
+    char            name[32];
+    unsigned int    series;
+};
+
+
+static struct TrafVolHeader_ *
+trafvol_header(TrafVolStore *store)
+{
+    return((struct TrafVolHeader_ *)store->map);
+}
+
+
+static struct TrafVolRecord_ *
+trafvol_record(TrafVolStore *store, unsigned int series)
+{
+    struct TrafVolHeader_   *hdr = trafvol_header(store);
+
+    return((struct TrafVolRecord_ *)(store->map + hdr->header_size +
+            (size_t)series * hdr->record_size));
+}
+
+
+/* the first bucket of rollup 'unit' of a record */
+static struct TrafVolBucket_ *
+trafvol_buckets(TrafVolStore *store, struct TrafVolRecord_ *rec, int unit)
+{
+    struct TrafVolHeader_   *hdr = trafvol_header(store);
+    struct TrafVolBucket_   *bucket = (struct TrafVolBucket_ *)(rec + 1);
+    int                     u = 0;
+
+    for(u = 0; u < unit; u++)
+        bucket += hdr->slots[u];
+
+    return(bucket);
+}
+
+
+static uint32_t
+trafvol_record_size(const uint32_t *slots)
+{
+    return((uint32_t)(sizeof(struct TrafVolRecord_) + sizeof(struct TrafVolBucket_) *
+            ((uint64_t)slots[TRAFVOL_MINUTE] + slots[TRAFVOL_HOUR] + slots[TRAFVOL_DAY])));
+}
+
+
+/* 't' in seconds since the epoch on the local clock */
+static int64_t
+trafvol_local(time_t t)
+{
+    struct tm   tm;
+    int64_t     local = (int64_t)t;
+
+    if(localtime_r(&t, &tm) != NULL)
+        local += (int64_t)tm.tm_gmtoff;
+
+    return(local);
+}
+
+
+/* the number of the period of 'unit' that 't' is in, in local time */
+static uint32_t
+trafvol_period(int unit, time_t t)
+{
+    return((uint32_t)(trafvol_local(t) / trafvol_unit_seconds[unit]));
+}
+
+
+/* add to the bucket of 'period' of a rollup, unless the ring already
+   went past that period */
+static void
+trafvol_add(struct TrafVolBucket_ *buckets, uint32_t slots, uint32_t period,
+        unsigned long long in_bytes, unsigned long long out_bytes)
+{
+    struct TrafVolBucket_   *bucket = buckets + (period % slots);
+
+    if(bucket->period > period)
+        return;
+
+    if(bucket->period != period)
+    {
+        bucket->in = 0;
+        bucket->out = 0;
+        bucket->period = period;
+    }
+    bucket->in += in_bytes;
+    bucket->out += out_bytes;
+}
+
+
+/* the number of series a reader can use: they must be in our map */
+static unsigned int
+trafvol_visible(TrafVolStore *store)
+{
+    struct TrafVolHeader_   *hdr = NULL;
+    size_t                  fits = 0;
+
+    if(store == NULL || store->map == NULL)
+        return(0);
+
+    hdr = trafvol_header(store);
+    fits = (store->size - hdr->header_size) / hdr->record_size;
+
+    return(hdr->nseries < fits ? hdr->nseries : (unsigned int)fits);
+}
+
+
+static int
+trafvol_compare_name(const void *table_data, const void *search_data)
+{
+    const struct TrafVolName_   *name_ptr = (const struct TrafVolName_ *)table_data;
+
+    if(table_data == NULL || search_data == NULL)
+        return(0);
+
+    if(strcmp(name_ptr->name, (const char *)search_data) == 0)
+        return(1);
+
+    return(0);
+}
+
+
+/* check the file before we trust it */
+static int
+trafvol_check(const char *map, size_t size)
+{
+    const struct TrafVolHeader_ *hdr = (const struct TrafVolHeader_ *)map;
+    int                         unit = 0;
+
+    if(size < sizeof(struct TrafVolHeader_) ||
+       memcmp(hdr->magic, TRAFVOL_MAGIC, sizeof(hdr->magic)) != 0 ||
+       hdr->version != TRAFVOL_VERSION ||
+       hdr->header_size != sizeof(struct TrafVolHeader_))
+        return(0);
+
+    for(unit = 0; unit < TRAFVOL_UNITS; unit++)
+    {
+        if(hdr->slots[unit] == 0 || hdr->slots[unit] > TRAFVOL_MAX_SLOTS)
+            return(0);
+    }
+
+    if(hdr->record_size != trafvol_record_size(hdr->slots) ||
+       hdr->nseries > hdr->capacity ||
+       hdr->header_size + (uint64_t)hdr->capacity * hdr->record_size > size)
+        return(0);
+
+    return(1);
+}
+
+
+/* (re)map the file after it was created or has grown */
+static int
+trafvol_map(const int debuglvl, TrafVolStore *store, size_t size)
+{
+    void    *map = NULL;
+
+    if(store->map != NULL)
+    {
+        (void)munmap(store->map, store->size);
+        store->map = NULL;
+        store->size = 0;
+    }
+
+    map = mmap(NULL, size, store->writable ? PROT_READ|PROT_WRITE : PROT_READ,
+            MAP_SHARED, store->fd, 0);
+    if(map == MAP_FAILED)
+    {
+        (void)vrprint.error(-1, "Error", "mmap of the traffic volume store "
+                "failed: %s (in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    store->map = map;
+    store->size = size;
+    return(0);
+}
+
+
+/* make room for at least one more series */
+static int
+trafvol_grow(const int debuglvl, TrafVolStore *store)
+{
+    struct TrafVolHeader_   *hdr = trafvol_header(store);
+    uint32_t                capacity = hdr->capacity;
+    size_t                  size = 0;
+
+    capacity += capacity < TRAFVOL_GROW ? TRAFVOL_GROW : capacity;
+    size = hdr->header_size + (size_t)capacity * hdr->record_size;
+
+    if(ftruncate(store->fd, (off_t)size) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "growing the traffic volume store failed: "
+                "%s (in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(trafvol_map(debuglvl, store, size) < 0)
+        return(-1);
+
+    trafvol_header(store)->capacity = capacity;
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "room for %u series now.", capacity);
+
+    return(0);
+}
+
+
+static int
+trafvol_add_name(const int debuglvl, TrafVolStore *store, const char *name, unsigned int series)
+{
+    struct TrafVolName_ *name_ptr = NULL;
+
+    if(!(name_ptr = malloc(sizeof(struct TrafVolName_))))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    (void)strlcpy(name_ptr->name, name, sizeof(name_ptr->name));
+    name_ptr->series = series;
+
+    if(d_list_append(debuglvl, &store->names, name_ptr) == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "d_list_append() "
+                "failed (in: %s:%d).", __FUNC__, __LINE__);
+        free(name_ptr);
+        return(-1);
+    }
+
+    if(hash_insert(debuglvl, &store->name_hash, name_ptr) < 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "hash_insert() "
+                "failed (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  trafvol_open
+
+    Opens the traffic volume store at 'path'. The writer (the daemon)
+    creates it if it doesn't exist yet, with 'slots' buckets per rollup
+    or the defaults if 'slots' is NULL. Readers map it read-only.
+
+    Returncodes:
+         0: ok
+         1: no store yet (only for readers)
+        -1: error
+*/
+int
+trafvol_open(const int debuglvl, TrafVolStore *store, const char *path,
+        char writable, const unsigned int *slots)
+{
+    struct TrafVolHeader_   hdr;
+    struct TrafVolRecord_   *rec = NULL;
+    struct stat             st;
+    char                    dir[PATH_MAX] = "";
+    unsigned int            i = 0,
+                            nseries = 0;
+    int                     unit = 0;
+
+    /* safety */
+    if(store == NULL || path == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    memset(store, 0, sizeof(TrafVolStore));
+    store->fd = -1;
+    store->writable = writable;
+
+    if(writable)
+    {
+        /* the directory may not be there yet */
+        (void)strlcpy(dir, path, sizeof(dir));
+        if(mkdir(dirname(dir), 0700) == -1 && errno != EEXIST)
+        {
+            (void)vrprint.error(-1, "Error", "creating the directory for '%s' "
+                    "failed: %s (in: %s:%d).", path, strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+
+        store->fd = open(path, O_RDWR|O_CREAT, 0600);
+    }
+    else
+    {
+        store->fd = open(path, O_RDONLY);
+        if(store->fd == -1 && errno == ENOENT)
+            return(1);
+    }
+    if(store->fd == -1)
+    {
+        (void)vrprint.error(-1, "Error", "opening '%s' failed: %s (in: %s:%d).",
+                path, strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(fstat(store->fd, &st) == -1 || !S_ISREG(st.st_mode))
+    {
+        (void)vrprint.error(-1, "Error", "'%s' is not a regular file (in: %s:%d).",
+                path, __FUNC__, __LINE__);
+        trafvol_close(debuglvl, store);
+        return(-1);
+    }
+
+    /* the writer didn't get to write the header yet */
+    if(!writable && (size_t)st.st_size < sizeof(hdr))
+    {
+        trafvol_close(debuglvl, store);
+        return(1);
+    }
+
+    /* a new store: write the header */
+    if(st.st_size == 0 && writable)
+    {
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, TRAFVOL_MAGIC, sizeof(hdr.magic));
+        hdr.version = TRAFVOL_VERSION;
+        hdr.header_size = sizeof(hdr);
+        for(unit = 0; unit < TRAFVOL_UNITS; unit++)
+        {
+            hdr.slots[unit] = slots ? slots[unit] : trafvol_default_slots[unit];
+            if(hdr.slots[unit] == 0 || hdr.slots[unit] > TRAFVOL_MAX_SLOTS)
+                hdr.slots[unit] = trafvol_default_slots[unit];
+        }
+        hdr.record_size = trafvol_record_size(hdr.slots);
+
+        if(pwrite(store->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+        {
+            (void)vrprint.error(-1, "Error", "writing '%s' failed: %s (in: %s:%d).",
+                    path, strerror(errno), __FUNC__, __LINE__);
+            trafvol_close(debuglvl, store);
+            return(-1);
+        }
+        st.st_size = (off_t)sizeof(hdr);
+    }
+
+    if(trafvol_map(debuglvl, store, (size_t)st.st_size) < 0 ||
+       trafvol_check(store->map, store->size) == 0)
+    {
+        (void)vrprint.error(-1, "Error", "'%s' is not a valid traffic volume "
+                "store (in: %s:%d).", path, __FUNC__, __LINE__);
+        trafvol_close(debuglvl, store);
+        return(-1);
+    }
+
+    if(writable)
+    {
+        if(d_list_setup(debuglvl, &store->names, free) < 0 ||
+           hash_setup(debuglvl, &store->name_hash, TRAFVOL_HASH_ROWS,
+                hash_name, trafvol_compare_name) < 0)
+        {
+            trafvol_close(debuglvl, store);
+            return(-1);
+        }
+
+        nseries = trafvol_visible(store);
+        for(i = 0; i < nseries; i++)
+        {
+            rec = trafvol_record(store, i);
+            rec->name[sizeof(rec->name) - 1] = '\0';
+
+            if(trafvol_add_name(debuglvl, store, rec->name, i) < 0)
+            {
+                trafvol_close(debuglvl, store);
+                return(-1);
+            }
+        }
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "'%s': %u series.", path, trafvol_visible(store));
+
+    return(0);
+}
+
+
+/*  trafvol_close
+
+    Unmaps the store and frees the memory of the writer.
+*/
+void
+trafvol_close(const int debuglvl, TrafVolStore *store)
+{
+    if(store == NULL)
+        return;
+
+    if(store->name_hash.table != NULL)
+        (void)hash_cleanup(debuglvl, &store->name_hash);
+    (void)d_list_cleanup(debuglvl, &store->names);
+
+    if(store->map != NULL)
+        (void)munmap(store->map, store->size);
+    if(store->fd != -1)
+        (void)close(store->fd);
+
+    memset(store, 0, sizeof(TrafVolStore));
+    store->fd = -1;
+}
+
+
+/*  trafvol_update
+
+    Adds a sample of the counters of series 'name' to the store. The
+    counters are the totals as the kernel counts them: what changed since
+    the previous sample is added to the buckets that 'now' is in. When
+    the previous sample is more than one bucket ago (a late sample, or
+    the daemon was not running) the change is spread evenly over the
+    time in between, as far as the rings reach back. A new series, or a
+    series that changed its 'source', starts counting from this sample.
+    If a counter went back it was reset, so all of it is new.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+trafvol_update(const int debuglvl, TrafVolStore *store, const char *name,
+        int source, time_t now, unsigned long long in_bytes,
+        unsigned long long out_bytes)
+{
+    struct TrafVolHeader_   *hdr = NULL;
+    struct TrafVolRecord_   *rec = NULL;
+    struct TrafVolBucket_   *buckets = NULL;
+    struct TrafVolName_     *name_ptr = NULL;
+    unsigned long long      delta_in = 0,
+                            delta_out = 0,
+                            part_in = 0,
+                            part_out = 0,
+                            done_in = 0,
+                            done_out = 0;
+    int64_t                 from = 0,
+                            to = 0,
+                            start = 0,
+                            end = 0,
+                            unit_seconds = 0;
+    uint32_t                period = 0,
+                            first = 0;
+    unsigned int            series = 0;
+    int                     unit = 0,
+                            all = 0;
+
+    /* safety */
+    if(store == NULL || store->map == NULL || !store->writable ||
+        name == NULL || name[0] == '\0')
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(strlen(name) >= sizeof(rec->name))
+    {
+        (void)vrprint.error(-1, "Internal Error", "name '%s' too long for the "
+                "traffic volume store (in: %s:%d).", name, __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if((name_ptr = hash_search(debuglvl, &store->name_hash, (void *)name)) == NULL)
+    {
+        hdr = trafvol_header(store);
+        if(hdr->nseries >= hdr->capacity)
+        {
+            if(trafvol_grow(debuglvl, store) < 0)
+                return(-1);
+            hdr = trafvol_header(store);
+        }
+
+        series = hdr->nseries;
+        rec = trafvol_record(store, series);
+        memset(rec, 0, hdr->record_size);
+        (void)strlcpy(rec->name, name, sizeof(rec->name));
+        rec->source = source;
+        rec->last_in = in_bytes;
+        rec->last_out = out_bytes;
+        rec->last_time = (int64_t)now;
+
+        /* only now the readers may see it */
+        hdr->nseries++;
+
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "new series '%s'.", name);
+
+        return(trafvol_add_name(debuglvl, store, name, series));
+    }
+
+    rec = trafvol_record(store, name_ptr->series);
+
+    if(rec->source == source)
+    {
+        delta_in = in_bytes >= rec->last_in ? in_bytes - rec->last_in : in_bytes;
+        delta_out = out_bytes >= rec->last_out ? out_bytes - rec->last_out : out_bytes;
+    }
+    from = trafvol_local((time_t)rec->last_time);
+    to = trafvol_local(now);
+
+    rec->source = source;
+    rec->last_in = in_bytes;
+    rec->last_out = out_bytes;
+    rec->last_time = (int64_t)now;
+
+    if(delta_in == 0 && delta_out == 0)
+        return(0);
+
+    hdr = trafvol_header(store);
+    for(unit = 0; unit < TRAFVOL_UNITS; unit++)
+    {
+        buckets = trafvol_buckets(store, rec, unit);
+        unit_seconds = trafvol_unit_seconds[unit];
+        period = (uint32_t)(to / unit_seconds);
+        first = (uint32_t)(from / unit_seconds);
+
+        /* one period, or the clock went back: all of it goes to now */
+        if(from >= to || first == period)
+        {
+            trafvol_add(buckets, hdr->slots[unit], period, delta_in, delta_out);
+            continue;
+        }
+
+        /*  spread over the periods between the samples, by the seconds
+            of each period that are in between. What is older than the
+            ring is dropped. */
+        all = (period - first < hdr->slots[unit]);
+        if(!all)
+            first = period - hdr->slots[unit] + 1;
+
+        done_in = 0;
+        done_out = 0;
+        for( ; first < period; first++)
+        {
+            start = (int64_t)first * unit_seconds;
+            end = start + unit_seconds;
+            if(start < from)
+                start = from;
+
+            part_in = (unsigned long long)((long double)delta_in * (end - start) / (to - from));
+            part_out = (unsigned long long)((long double)delta_out * (end - start) / (to - from));
+
+            trafvol_add(buckets, hdr->slots[unit], first, part_in, part_out);
+            done_in += part_in;
+            done_out += part_out;
+        }
+
+        /* the period of now gets the rest, so no byte is lost to rounding */
+        if(all)
+        {
+            part_in = delta_in - done_in;
+            part_out = delta_out - done_out;
+        }
+        else
+        {
+            start = (int64_t)period * unit_seconds;
+            part_in = (unsigned long long)((long double)delta_in * (to - start) / (to - from));
+            part_out = (unsigned long long)((long double)delta_out * (to - start) / (to - from));
+        }
+        trafvol_add(buckets, hdr->slots[unit], period, part_in, part_out);
+    }
+
+    return(0);
+}
+
+
+/*  trafvol_count
+
+    Returns the number of series in the store.
+*/
+unsigned int
+trafvol_count(TrafVolStore *store)
+{
+    return(trafvol_visible(store));
+}
+
+
+/*  trafvol_name
+
+    Returns the name of 'series' or NULL if there is no such series.
+*/
+const char *
+trafvol_name(TrafVolStore *store, unsigned int series)
+{
+    struct TrafVolRecord_   *rec = NULL;
+
+    if(series >= trafvol_visible(store))
+        return(NULL);
+
+    rec = trafvol_record(store, series);
+    if(memchr(rec->name, '\0', sizeof(rec->name)) == NULL)
+        return(NULL);
+
+    return(rec->name);
+}
+
+
+/*  trafvol_find
+
+    Returncodes:
+        >= 0: the series with name 'name'
+          -1: not in the store
+*/
+int
+trafvol_find(const int debuglvl, TrafVolStore *store, const char *name)
+{
+    struct TrafVolName_     *name_ptr = NULL;
+    const char              *series_name = NULL;
+    unsigned int            nseries = 0,
+                            i = 0;
+
+    if(store == NULL || store->map == NULL || name == NULL)
+        return(-1);
+
+    if(store->writable)
+    {
+        name_ptr = hash_search(debuglvl, &store->name_hash, (void *)name);
+        return(name_ptr ? (int)name_ptr->series : -1);
+    }
+
+    /* readers look up a handful of series, no need for a hash */
+    nseries = trafvol_visible(store);
+    for(i = 0; i < nseries; i++)
+    {
+        series_name = trafvol_name(store, i);
+        if(series_name != NULL && strcmp(series_name, name) == 0)
+            return((int)i);
+    }
+
+    return(-1);
+}
+
+
+/*  trafvol_get
+
+    Adds up the traffic of 'count' periods of rollup 'unit' of 'series',
+    starting with the period 'start' is in. Periods older than the ring
+    of the rollup are no longer in the store.
+
+    Returncodes:
+         1: ok
+         0: no data for these periods
+        -1: error
+*/
+int
+trafvol_get(const int debuglvl, TrafVolStore *store, unsigned int series,
+        int unit, time_t start, unsigned int count,
+        unsigned long long *in_bytes, unsigned long long *out_bytes)
+{
+    struct TrafVolHeader_   *hdr = NULL;
+    struct TrafVolRecord_   *rec = NULL;
+    struct TrafVolBucket_   *buckets = NULL,
+                            *bucket = NULL;
+    uint32_t                period = 0;
+    unsigned int            i = 0;
+    int                     retval = 0;
+
+    /* safety */
+    if(store == NULL || store->map == NULL || unit < 0 || unit >= TRAFVOL_UNITS ||
+        in_bytes == NULL || out_bytes == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    *in_bytes = 0;
+    *out_bytes = 0;
+
+    if(series >= trafvol_visible(store))
+        return(0);
+
+    hdr = trafvol_header(store);
+    rec = trafvol_record(store, series);
+    buckets = trafvol_buckets(store, rec, unit);
+
+    if(count > hdr->slots[unit])
+        count = hdr->slots[unit];
+
+    period = trafvol_period(unit, start);
+    for(i = 0; i < count; i++, period++)
+    {
+        bucket = buckets + (period % hdr->slots[unit]);
+        if(bucket->period != period)
+            continue;
+
+        *in_bytes += bucket->in;
+        *out_bytes += bucket->out;
+        retval = 1;
+    }
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "'%s': in %llu, out %llu.",
+                rec->name, *in_bytes, *out_bytes);
+
+    return(retval);
+}
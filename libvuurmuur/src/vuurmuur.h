@@ -109,9 +109,11 @@
 #define DEFAULT_SYSCTL_LOCATION         "/sbin/sysctl"
 #define DEFAULT_IPTABLES_LOCATION       "/sbin/iptables"
 #define DEFAULT_IPTABLES_REST_LOCATION  "/sbin/iptables-restore"
+#define DEFAULT_IPTABLES_SAVE_LOCATION  "/sbin/iptables-save"
 #ifdef IPV6_ENABLED
 #define DEFAULT_IP6TABLES_LOCATION      "/sbin/ip6tables"
 #define DEFAULT_IP6TABLES_REST_LOCATION "/sbin/ip6tables-restore"
+#define DEFAULT_IP6TABLES_SAVE_LOCATION "/sbin/ip6tables-save"
 #endif
 #define DEFAULT_RULES_LOCATION          "rules.conf"
 #define DEFAULT_LOGDIR_LOCATION         "/var/log/vuurmuur"
@@ -119,6 +121,8 @@
 #define DEFAULT_MODPROBE_LOCATION       "/sbin/modprobe"
 #define DEFAULT_CONNTRACK_LOCATION      "/usr/sbin/conntrack"
 #define DEFAULT_TC_LOCATION             "/sbin/tc"
+#define DEFAULT_NFT_LOCATION            "/usr/sbin/nft"
+#define DEFAULT_IPSET_LOCATION          "/usr/sbin/ipset"
 
 #define DEFAULT_BACKEND                 "textdir"
 
@@ -151,6 +155,11 @@
 #define DEFAULT_PROTECT_ECHOBROADCAST   TRUE                /* default we protect against echo-broadcasting */
 
 #define DEFAULT_OLD_CREATE_METHOD       FALSE               /* default we use new method */
+#define DEFAULT_USE_NFTABLES            FALSE               /* default we use iptables */
+#define DEFAULT_HOST_ACCOUNTING         FALSE               /* default we only count the interfaces */
+#define DEFAULT_FLOW_HISTORY            FALSE               /* default we don't keep the flows */
+#define DEFAULT_FLOW_HISTORY_DAYS       (unsigned int)31    /* days of flows we keep */
+#define DEFAULT_SHAPE_LEAF              "fq_codel"          /* leaf qdisc of the shaping classes */
 
 #define DEFAULT_LOAD_MODULES            TRUE                /* default we load modules */
 #define DEFAULT_MODULES_WAITTIME        0                   /* default we don't wait */
@@ -364,14 +373,18 @@ struct vuurmuur_config
     char            sysctl_location[128];
     char            iptables_location[128];
     char            iptablesrestore_location[128];
+    char            iptablessave_location[128];
 #ifdef IPV6_ENABLED
     char            ip6tables_location[128];
     char            ip6tablesrestore_location[128];
+    char            ip6tablessave_location[128];
     /** Fail when there is an error with IPv6 configuration, when set to TRUE */
     char            check_ipv6;
 #endif
     char            conntrack_location[128];
     char            tc_location[128];
+    char            nft_location[128];
+    char            ipset_location[128];
 
 //    char            use_blocklist;
     char            blocklist_location[64];
@@ -432,6 +445,12 @@ struct vuurmuur_config
     unsigned int    dynamic_changes_interval;   /* check every x seconds for changes in the dynamic interfaces */
 
     char            old_rulecreation_method;    /* 0: off, 1: on: if on we use iptables else iptables-restore */
+    char            use_nftables;               /* 0: off, 1: on: if on the ruleset is loaded with 'nft -f' */
+    char            host_accounting;            /* 0: off, 1: on: count the traffic of hosts and networks */
+    char            flow_history;               /* 0: off, 1: on: vuurmuur_log keeps the ended connections */
+    unsigned int    flow_history_days;          /* days to keep them */
+
+    char            shape_leaf[16];             /* leaf qdisc of the shaping classes: sfq, fq_codel, cake or fq */
 
     char            load_modules;           /* load modules if needed? 1: yes, 0: no */
     unsigned int    modules_wait_time;      /* time to wait in 1/10 th of a second */
@@ -445,6 +464,7 @@ struct vuurmuur_config
     char            bash_out;
     char            verbose_out;
     char            test_mode;
+    char            skip_owner_check;       /* only for vuurmuur_bench: accept files not owned by root */
 
 
     /* this is detected at runtime */
@@ -489,6 +509,61 @@ struct vrprint_
 
 
 /* DATA STRUCTURES */
+
+/*
+    iptables counter snapshot
+
+    One run of 'iptables-save -c' parsed into memory, so the counters of
+    many chains can be looked up without calling iptables for each of them.
+*/
+typedef struct IptCounterRule_
+{
+    /* the rule as printed by iptables-save, without '-A <chain> ' */
+    char                *rule;
+
+    /* interfaces the rule matches on, empty if none */
+    char                in_iface[16];
+    char                out_iface[16];
+
+    /* 1 if the rule only matches on the in- or outgoing interface */
+    char                iface_only;
+
+    unsigned long long  packets;
+    unsigned long long  bytes;
+
+} IptCounterRule;
+
+
+typedef struct IptCounterChain_
+{
+    /* this should always be on top: we hash on it */
+    char                name[32];
+
+    /* policy counters, only set for builtin chains */
+    unsigned long long  packets;
+    unsigned long long  bytes;
+
+    /* list of IptCounterRule's in the order of the chain */
+    d_list              rules;
+
+} IptCounterChain;
+
+
+typedef struct
+{
+    /* VR_IPV4 or VR_IPV6 */
+    int         ipv;
+    /* table the snapshot was taken from */
+    char        table[16];
+
+    /* list of IptCounterChain's */
+    d_list      chains;
+    /* the chains hashed by name */
+    Hash        chain_hash;
+
+} IptCounters;
+
+
 typedef struct
 {
     /* the list with interfaces */
@@ -502,6 +577,9 @@ typedef struct
 
     u_int16_t   shape_handle;
 
+    /* the interfaces indexed by name */
+    Hash        name_hash;
+
 } Interfaces;
 
 
@@ -510,6 +588,9 @@ typedef struct
     /* the list with services */
     d_list  list;
 
+    /* the services indexed by name */
+    Hash    name_hash;
+
 } Services;
 
 
@@ -518,6 +599,9 @@ typedef struct
     /* the list with zones */
     d_list  list;
 
+    /* the zones, networks, hosts and groups indexed by name */
+    Hash    name_hash;
+
 } Zones;
 
 
@@ -625,6 +709,7 @@ struct options
     u_int32_t       bw_out_min;         /* rate from src to dst */
     char            bw_out_min_unit[5]; /* kbit, mbit, kbps, mbps */
     u_int8_t        prio;               /* priority */
+    char            shape_leaf[16];     /* leaf qdisc, empty for the interface default */
 
     char            random; /* adds --random to the DNAT/SNAT/??? target */
 };
@@ -743,6 +828,8 @@ typedef struct InterfaceData_
     char            bw_out_unit[5];     /* kbit or mbit */
     u_int32_t       min_bw_in;          /* minimal per rule rate in kbits (download) */
     u_int32_t       min_bw_out;         /* minimal per rule rate in kbits (upload) */
+    char            shape_leaf[16];     /* leaf qdisc, empty for the global default */
+    char            shape_offload;      /* offload the htb tree to the nic: 1: yes, 0: no */
 
     u_int16_t       shape_handle;       /* tc handle */
     u_int32_t       shape_default_rate; /* rate used by default rule and shaping rules
@@ -1047,6 +1134,33 @@ typedef struct
 } VR_ConntrackRequest;
 
 
+/* a filter for conn_kill(): empty ips and a zero protocol, port or
+   mark_mask match everything */
+typedef struct
+{
+    char            src_ip[46];
+    char            dst_ip[46];
+    int             protocol;
+    int             src_port;
+    int             dst_port;
+    unsigned int    mark;
+    unsigned int    mark_mask;
+} VR_ConnKillFilter;
+
+typedef struct
+{
+    /* flows that matched a filter. With the conntrack tool: filters */
+    unsigned int    matched;
+    unsigned int    killed;
+    /* gone before we could kill them */
+    unsigned int    gone;
+    unsigned int    failed;
+} VR_ConnKillStats;
+
+/* called with the number of flows that were handled so far */
+typedef void (*VR_ConnKillProgress)(void *ctx, unsigned int done, unsigned int total);
+
+
 
 /*
     Iptables Capabilities
@@ -1323,6 +1437,11 @@ typedef struct
 } VR_user_t;
 
 
+/* the backend functions, see below. The read functions take them as
+   argument, so they can be used while bulk loading. */
+struct BackendFunctions_;
+
+
 /*
     libvuurmuur.c
 */
@@ -1352,6 +1471,8 @@ int hash_setup(const int debuglvl, Hash *hash_table, unsigned int rows, unsigned
 int hash_cleanup(const int debuglvl, Hash *hash_table);
 int hash_insert(const int debuglvl, Hash *hash_table, const void *data);
 int hash_remove(const int debuglvl, Hash *hash_table, void *data);
+int hash_insert_key(const int debuglvl, Hash *hash_table, const void *key, const void *data);
+int hash_remove_key(const int debuglvl, Hash *hash_table, const void *key, const void *data);
 void *hash_search(const int debuglvl, const Hash *hash_table, void *data);
 
 int compare_ports(const void *string1, const void *string2);
@@ -1360,6 +1481,7 @@ int compare_string(const void *string1, const void *string2);
 unsigned int hash_port(const void *key);
 unsigned int hash_ipaddress(const void *key);
 unsigned int hash_string(const void *key);
+unsigned int hash_name(const void *key);
 
 void print_table_service(const int debuglvl, const Hash *hash_table);
 int init_zonedata_hashtable(const int debuglvl, unsigned int n_rows, d_list *d_list, unsigned int (*hash)(const void *key), int (*match)(const void *string1, const void *string2), Hash *hash_table);
@@ -1384,9 +1506,10 @@ void rules_free_options(const int debuglvl, struct options *opt);
 int insert_zonedata_list(const int, Zones *, const struct ZoneData_ *);
 void zonedata_print_list(const Zones *);
 int init_zonedata(const int, /*@out@*/ Zones *, Interfaces *, struct rgx_ *);
-int insert_zonedata(const int, Zones *, Interfaces *, char *, int, struct rgx_ *);
-int read_zonedata(const int, Zones *, Interfaces *, char *, int, struct ZoneData_ *, struct rgx_ *);
+int insert_zonedata(const int, struct BackendFunctions_ *, void *, Zones *, Interfaces *, char *, int, struct rgx_ *);
+int read_zonedata(const int, struct BackendFunctions_ *, void *, Zones *, Interfaces *, char *, int, struct ZoneData_ *, struct rgx_ *);
 void *search_zonedata(const int, const Zones *, char *);
+int zones_rehash(const int, Zones *, struct ZoneData_ *, const char *);
 void destroy_zonedatalist(const int, Zones *);
 int count_zones(const int, Zones *, int, char *, char *);
 int new_zone(const int, Zones *, char *, int);
@@ -1397,9 +1520,9 @@ int validate_zonename(const int, const char *, int, char *, char *, char *, rege
 int zones_group_save_members(const int, struct ZoneData_ *);
 int zones_network_add_iface(const int, Interfaces *, struct ZoneData_ *, char *);
 int zones_network_rem_iface(const int, struct ZoneData_ *, char *);
-int zones_network_get_interfaces(const int, struct ZoneData_ *, Interfaces *);
+int zones_network_get_interfaces(const int, struct BackendFunctions_ *, void *, struct ZoneData_ *, Interfaces *);
 int zones_network_save_interfaces(const int, struct ZoneData_ *);
-int zones_network_get_protectrules(const int, struct ZoneData_ *);
+int zones_network_get_protectrules(const int, struct BackendFunctions_ *, void *, struct ZoneData_ *);
 int zones_group_rem_member(const int, struct ZoneData_ *, char *);
 int zones_group_add_member(const int, Zones *, struct ZoneData_ *, char *);
 int zones_active(const int, struct ZoneData_ *);
@@ -1416,9 +1539,10 @@ int zones_network_ipv6_enabled(const int, struct ZoneData_ *);
     services.c
 */
 int init_services(const int, /*@out@*/ Services *, struct rgx_ *);
-int insert_service(const int, Services *, char *);
+int insert_service(const int, struct BackendFunctions_ *, void *, Services *, char *);
 void *search_service(const int, const Services *, char *);
-int read_service(const int, char *, struct ServicesData_ *);
+int services_rehash(const int, Services *, struct ServicesData_ *, const char *);
+int read_service(const int, struct BackendFunctions_ *, void *, char *, struct ServicesData_ *);
 void services_print_list(const Services *);
 int split_portrange(char *, int *, int *);
 int process_portrange(const int, const char *, const char *, struct ServicesData_ *);
@@ -1438,12 +1562,12 @@ int load_services(const int, Services *, struct rgx_ *);
 */
 int determine_action(const int debuglvl, char *query, char *action, size_t size, struct options *option);
 //int determine_chain(const int debuglvl, struct RuleData_ *rule_ptr, char *chain, size_t size, int *ruletype);
-int get_ip_info(const int debuglvl, char *name, struct ZoneData_ *answer_ptr, struct rgx_ *reg);
+int get_ip_info(const int debuglvl, struct BackendFunctions_ *f, void *backend, char *name, struct ZoneData_ *answer_ptr, struct rgx_ *reg);
 int create_broadcast_ip(const int debuglvl, char *network, char *netmask, char *broadcast_ip, size_t size);
-int get_group_info(const int, Zones *, char *, struct ZoneData_ *);
+int get_group_info(const int, struct BackendFunctions_ *, void *, Zones *, char *, struct ZoneData_ *);
 char *list_to_portopts(const int, d_list *, /*@null@*/char *);
 int portopts_to_list(const int debuglvl, const char *opt, d_list *dlist);
-int check_active(const int debuglvl, char *data, int type);
+int check_active(const int debuglvl, struct BackendFunctions_ *f, void *backend, char *data, int type);
 int get_dynamic_ip(const int debuglvl, char *device, char *answer_ptr, size_t size);
 int check_ipv4address(const int debuglvl, char *network, char *netmask, char *ipaddress, char quiet);
 int get_mac_address(const int debuglvl, char *hostname, char *answer_ptr, size_t size, regex_t *mac_rgx);
@@ -1524,6 +1648,7 @@ int libvuurmuur_logstdoutprint_error(int errorlevel, char *head, char *fmt, ...)
 FILE *vuurmuur_fopen(const int, const struct vuurmuur_config *, const char *path, const char *mode);
 DIR *vuurmuur_opendir(const int, const struct vuurmuur_config *, const char *);
 int stat_ok(const int, const struct vuurmuur_config *, const char *, char, char, char);
+int stat_changed(const struct stat *, const struct stat *);
 int check_pidfile(char *pidfile_location, char *service, pid_t *thepid);
 int create_pidfile(char *pidfile_location, int shm_id);
 int remove_pidfile(char *pidfile_location);
@@ -1549,6 +1674,7 @@ int check_ip6tables_command(const int, struct vuurmuur_config *, char *, char);
 int check_ip6tablesrestore_command(const int, struct vuurmuur_config *, char *, char);
 #endif
 int check_tc_command(const int, struct vuurmuur_config *, char *, char);
+int check_nft_command(const int, struct vuurmuur_config *, char *, char);
 int init_config(const int, struct vuurmuur_config *cnf);
 int reload_config(const int, struct vuurmuur_config *);
 int ask_configfile(const int debuglvl, const struct vuurmuur_config *, char *question, char *answer_ptr, char *file_location, size_t size);
@@ -1561,6 +1687,187 @@ int pre_init_config(struct vuurmuur_config *);
 */
 int load_backends(int debuglvl, d_list *plugin_list);
 int unload_backends(int debuglvl, d_list *plugin_list);
+int backend_bulk_load(const int debuglvl, struct BackendFunctions_ *f, void *backend, int type, int (*load)(const int debuglvl, void *ctx, struct BackendFunctions_ *f, void *backend, char *name, int zonetype), void *ctx);
+int backend_tell_begin(const int debuglvl, struct BackendFunctions_ *f, void *backend, char *name, int type);
+int backend_tell_end(const int debuglvl, struct BackendFunctions_ *f, void *backend, int commit);
+
+
+/*
+    snapshot.c
+*/
+#define SNAPSHOT_LOCATION   "/var/run/vuurmuur.snapshot"
+
+int snapshot_write(const int debuglvl);
+int snapshot_attach(const int debuglvl);
+void snapshot_detach(const int debuglvl);
+
+
+/*
+    trafvol.c
+*/
+#define TRAFVOL_LOCATION    "/var/lib/vuurmuur/trafvol"
+/* per host and network, series "h:<ip>" and "n:<network>/<cidr>" */
+#define HOSTVOL_LOCATION    "/var/lib/vuurmuur/hostvol"
+
+/* the rollups of the traffic volume store */
+enum
+{
+    TRAFVOL_MINUTE = 0,
+    TRAFVOL_HOUR,
+    TRAFVOL_DAY,
+    TRAFVOL_UNITS
+};
+
+/* where the counters of a series come from */
+enum
+{
+    TRAFVOL_SRC_NONE = 0,
+    TRAFVOL_SRC_ACC,        /* the ACC-<device> chain */
+    TRAFVOL_SRC_PROC,       /* /proc/net/dev */
+    TRAFVOL_SRC_SET,        /* the counters of an ipset or nft set */
+};
+
+typedef struct TrafVolStore_
+{
+    char            *map;
+    size_t          size;
+    int             fd;
+    char            writable;
+
+    /* the writer: the series by name */
+    d_list          names;
+    Hash            name_hash;
+
+} TrafVolStore;
+
+int trafvol_open(const int debuglvl, TrafVolStore *store, const char *path, char writable, const unsigned int *slots);
+void trafvol_close(const int debuglvl, TrafVolStore *store);
+int trafvol_update(const int debuglvl, TrafVolStore *store, const char *name, int source, time_t now, unsigned long long in_bytes, unsigned long long out_bytes);
+unsigned int trafvol_count(TrafVolStore *store);
+const char *trafvol_name(TrafVolStore *store, unsigned int series);
+int trafvol_find(const int debuglvl, TrafVolStore *store, const char *name);
+int trafvol_get(const int debuglvl, TrafVolStore *store, unsigned int series, int unit, time_t start, unsigned int count, unsigned long long *in_bytes, unsigned long long *out_bytes);
+
+
+/*
+    flowstore.c
+*/
+#define FLOWSTORE_LOCATION  "/var/lib/vuurmuur/flows"
+
+/* the source or destination is a host, network or zone of ours */
+#define FLOW_SRC_KNOWN      0x01
+#define FLOW_DST_KNOWN      0x02
+
+/* a connection that ended */
+typedef struct FlowRecord_
+{
+    time_t              end;
+    unsigned int        duration;       /* in seconds */
+    int                 ipv;            /* VR_IPV4 or VR_IPV6 */
+    int                 protocol;
+    int                 src_port;
+    int                 dst_port;
+    char                src_ip[46];
+    char                dst_ip[46];
+    unsigned int        flags;          /* FLOW_* */
+
+    /* "host.network.zone" or the ip, and the service or "" */
+    const char          *from_name;
+    const char          *to_name;
+    const char          *ser_name;
+
+    /* out: from src to dst, in: the replies */
+    unsigned long long  out_packets;
+    unsigned long long  out_bytes;
+    unsigned long long  in_packets;
+    unsigned long long  in_bytes;
+
+} FlowRecord;
+
+typedef struct FlowStore_
+{
+    char                dir[256];
+
+    /* the files of the day we write to */
+    unsigned int        day;            /* yyyymmdd, 0: none open */
+    FILE                *rec_fp;
+    FILE                *names_fp;
+    unsigned long       names_size;
+
+    /* the names of the day by name */
+    d_list              names;
+    Hash                name_hash;
+
+} FlowStore;
+
+int flowstore_open(const int debuglvl, FlowStore *store, const char *dir);
+void flowstore_close(const int debuglvl, FlowStore *store);
+int flowstore_append(const int debuglvl, FlowStore *store, FlowRecord *flow);
+int flowstore_flush(const int debuglvl, FlowStore *store);
+int flowstore_expire(const int debuglvl, const char *dir, unsigned int days, time_t now);
+int flowstore_query(const int debuglvl, const char *dir, time_t from, time_t to, int (*cb)(void *ctx, FlowRecord *flow), void *ctx);
+
+
+/*
+    control.c
+*/
+#define CONTROL_SOCKET      "/var/run/vuurmuur.ctl"
+#define CONTROL_MAX_DATA    4096
+
+/* message types of the control channel */
+enum
+{
+    /* requests */
+    CONTROL_RELOAD = 1,     /* reload, replies with progress and a result */
+    CONTROL_STATUS,         /* replies with data and a result */
+    CONTROL_BLOCK,          /* data: ip/host/group to block, then reload */
+    CONTROL_UNBLOCK,        /* data: ip/host/group to unblock, then reload */
+    CONTROL_COUNTERS,       /* replies with data and a result */
+
+    /* replies */
+    CONTROL_PROGRESS = 64,  /* data: int percentage */
+    CONTROL_DATA,           /* data: text */
+    CONTROL_RESULT,         /* data: int VR_RR_* code, last reply */
+};
+
+int control_listen(const int debuglvl, const char *path);
+int control_connect(const int debuglvl, const char *path);
+int control_send(const int debuglvl, int fd, int type, const void *data, size_t len);
+int control_recv(const int debuglvl, int fd, int *type, char *data, size_t size, int timeout);
+int control_request(const int debuglvl, const char *path, int type, const char *arg, int (*cb)(const int debuglvl, void *ctx, int type, char *data, size_t len), void *ctx, int *result);
+
+
+/*
+    parallel.c
+*/
+struct ParallelMsg_;
+
+typedef struct ParallelJob_
+{
+    unsigned int        n;
+
+    /* does the work for item 'i', its returncode ends up in results[i] */
+    int                 (*work)(const int debuglvl, void *ctx, unsigned int i);
+    void                *ctx;
+
+    int                 *results;
+
+    /* the messages printed while working on an item */
+    struct ParallelMsg_ **msgs;
+    /* the number of messages per item lost for lack of memory */
+    unsigned int        *lost;
+
+    /* used while running */
+    char                *select;
+    unsigned int        next;
+    int                 debuglvl;
+
+} ParallelJob;
+
+int parallel_setup(const int debuglvl, ParallelJob *job, unsigned int n, int (*work)(const int debuglvl, void *ctx, unsigned int i), void *ctx);
+int parallel_run(const int debuglvl, ParallelJob *job, char *select);
+void parallel_replay(const int debuglvl, ParallelJob *job, unsigned int i);
+void parallel_cleanup(const int debuglvl, ParallelJob *job);
 
 
 /*
@@ -1568,9 +1875,10 @@ int unload_backends(int debuglvl, d_list *plugin_list);
 */
 void *search_interface(const int, const Interfaces *, const char *);
 void *search_interface_by_ip(const int, Interfaces *, const char *);
+int interfaces_rehash(const int, Interfaces *, struct InterfaceData_ *, const char *);
 void interfaces_print_list(const Interfaces *interfaces);
-int read_interface_info(const int debuglvl, struct InterfaceData_ *iface_ptr);
-int insert_interface(const int debuglvl, Interfaces *interfaces, char *name);
+int read_interface_info(const int debuglvl, struct BackendFunctions_ *f, void *backend, struct InterfaceData_ *iface_ptr);
+int insert_interface(const int debuglvl, struct BackendFunctions_ *f, void *backend, Interfaces *interfaces, char *name);
 int init_interfaces(const int debuglvl, /*@out@*/ Interfaces *interfaces);
 int new_interface(const int, Interfaces *, char *);
 int delete_interface(const int, Interfaces *, char *);
@@ -1580,7 +1888,7 @@ int get_iface_stats(const int, const char *, unsigned long *, unsigned long *, u
 int get_iface_stats_from_ipt(const int debuglvl, const char *iface_name, const char *chain, unsigned long long *recv_packets, unsigned long long *recv_bytes, unsigned long long *trans_packets, unsigned long long *trans_bytes);
 int validate_interfacename(const int, const char *, regex_t *);
 void destroy_interfaceslist(const int debuglvl, Interfaces *interfaces);
-int interfaces_get_rules(const int debuglvl, struct InterfaceData_ *iface_ptr);
+int interfaces_get_rules(const int debuglvl, struct BackendFunctions_ *f, void *backend, struct InterfaceData_ *iface_ptr);
 int interfaces_save_rules(const int, struct InterfaceData_ *);
 int interfaces_check(const int, struct InterfaceData_ *);
 int load_interfaces(const int, Interfaces *);
@@ -1592,6 +1900,15 @@ int interface_check_devicename(const int, char *);
 int interface_ipv6_enabled(const int, struct InterfaceData_ *);
 #endif
 
+/*
+    counters.c
+*/
+int ipt_counters_load(const int, struct vuurmuur_config *, /*@out@*/ IptCounters *, int, char *);
+void ipt_counters_cleanup(const int, IptCounters *);
+IptCounterChain *ipt_counters_get_chain(const int, IptCounters *, const char *);
+int ipt_counters_get_iface(const int, IptCounters *, const char *, const char *, unsigned long long *, unsigned long long *, unsigned long long *, unsigned long long *);
+
+
 /*
     icmp.c
 */
@@ -1614,6 +1931,11 @@ void conn_list_cleanup(const int debuglvl, d_list *conn_dlist);
 void VR_connreq_setup(const int debuglvl, VR_ConntrackRequest *connreq);
 void VR_connreq_cleanup(const int debuglvl, VR_ConntrackRequest *connreq);
 
+/*
+    connkill.c
+*/
+int conn_kill(const int, struct vuurmuur_config *, VR_ConnKillFilter *, unsigned int, VR_ConnKillStats *, VR_ConnKillProgress, void *);
+
 /*
     linked list
 */
@@ -1660,6 +1982,7 @@ int libvuurmuur_is_shape_rule(const int, /*@null@*/struct options *);
 int libvuurmuur_is_shape_incoming_rule(const int, /*@null@*/struct options *);
 int libvuurmuur_is_shape_outgoing_rule(const int, /*@null@*/struct options *);
 int libvuurmuur_is_shape_interface(const int, /*@null@*/InterfaceData *);
+int libvuurmuur_is_shape_leaf(const int, /*@null@*/const char *);
 
 
 /*
@@ -1698,6 +2021,17 @@ void *ifac_backend;
 void *rule_backend;
 
 
+/*  One variable of an object, handed out by the bulk function of a
+    backend. Variables with more than one value ('multi') appear more
+    than once, in the order of the backend.
+*/
+struct BackendBulkVar_
+{
+    char    *variable;
+    char    *value;
+};
+
+
 /*  These functions are to be used for modifing the backend, reading from it, etc.
 
 */
@@ -1734,6 +2068,25 @@ struct BackendFunctions_
     /* version */
     char *version;
 
+    /*  optional: hand out all objects of a category with all their
+        variables in one go, calling 'cb' for every object. When 'vars'
+        is NULL the object is read with 'ask' like before. May be NULL
+        for backends that don't support it. */
+    int (*bulk)(int debuglvl, void *backend, int type,
+            int (*cb)(int debuglvl, void *ctx, char *name, int zonetype, struct BackendBulkVar_ *vars, unsigned int nvars),
+            void *ctx);
+
+    /*  optional: collect the tells for object 'name' and write them in
+        one go on tell_end (commit 1) or drop them (commit 0). May be
+        NULL for backends that don't support it. */
+    int (*tell_begin)(int debuglvl, void *backend, char *name, int type);
+    int (*tell_end)(int debuglvl, void *backend, int commit);
+
+    /*  optional: the time of the newest change to the storage of
+        category 'type', to see if it was changed behind our back. May
+        be NULL for backends that don't support it. */
+    int (*stamp)(int debuglvl, void *backend, int type, struct timespec *ts);
+
 } BackendFunctions;
 
 
@@ -25,6 +25,9 @@
 #include "config.h"
 #include "vuurmuur.h"
 
+/* rows of the zones name index */
+#define ZONES_HASH_ROWS         4096
+
 
 /*  zones_split_zonename
 
@@ -343,20 +346,33 @@ insert_zonedata_list(const int debuglvl, Zones *zones,
         }
     }
 
+    /* and index it by name */
+    if(zones->name_hash.table != NULL)
+    {
+        if(hash_insert_key(debuglvl, &zones->name_hash, zone_ptr->name, zone_ptr) < 0)
+        {
+            (void)vrprint.error(-1, "Internal Error",
+                    "hash_insert_key() failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(-1);
+        }
+    }
+
     return(0);
 }
 
 
 /*  insert_zonedata
 
-    Inserts the zonedata 'name' into the linked-list.
+    Inserts the zonedata 'name' into the linked-list. It is read with
+    'f' and 'backend', normally zf and zone_backend.
 
     Returncodes:
         -1: error
          0: succes
 */
 int
-insert_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
+insert_zonedata(const int debuglvl, struct BackendFunctions_ *f, void *backend, Zones *zones, Interfaces *interfaces,
         char *name, int type, struct rgx_ *reg)
 {
     struct ZoneData_    *zone_ptr = NULL;
@@ -377,7 +393,7 @@ insert_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
     /*
         read the data for this zone
     */
-    if(read_zonedata(debuglvl, zones, interfaces, name, type, zone_ptr, reg) < 0)
+    if(read_zonedata(debuglvl, f, backend, zones, interfaces, name, type, zone_ptr, reg) < 0)
     {
         free(zone_ptr);
         return(-1);
@@ -409,7 +425,7 @@ insert_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
         -1: error
 */
 int
-read_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
+read_zonedata(const int debuglvl, struct BackendFunctions_ *f, void *backend, Zones *zones, Interfaces *interfaces,
           char *name, int type, struct ZoneData_ *zone_ptr, struct rgx_ *reg)
 {
     int     result = 0;
@@ -459,7 +475,7 @@ read_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
     }
 
     /* get the active */
-    result = check_active(debuglvl, zone_ptr->name, zone_ptr->type);
+    result = check_active(debuglvl, f, backend, zone_ptr->name, zone_ptr->type);
     if(result == -1)
     {
         /* set false to be sure */
@@ -480,7 +496,7 @@ read_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
     {
         if(zone_ptr->type == TYPE_NETWORK)
         {
-            result = zones_network_get_interfaces(debuglvl, zone_ptr, interfaces);
+            result = zones_network_get_interfaces(debuglvl, f, backend, zone_ptr, interfaces);
             if(result < 0)
             {
                 (void)vrprint.error(-1, "Internal Error",
@@ -489,7 +505,7 @@ read_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
                 return(-1);
             }
 
-            result = zones_network_get_protectrules(debuglvl, zone_ptr);
+            result = zones_network_get_protectrules(debuglvl, f, backend, zone_ptr);
             if(result < 0)
             {
                 (void)vrprint.error(-1, "Internal Error",
@@ -502,7 +518,7 @@ read_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
         /*
             get ip and mask
         */
-        result = get_ip_info(debuglvl, name, zone_ptr, reg);
+        result = get_ip_info(debuglvl, f, backend, name, zone_ptr, reg);
         if(result != 0)
         {
             (void)vrprint.error(-1, "Internal Error", "get_ip_info() "
@@ -513,7 +529,7 @@ read_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
     else if(zone_ptr->type == TYPE_GROUP)
     {
         /* get group info */
-        result = get_group_info(debuglvl, zones, name, zone_ptr);
+        result = get_group_info(debuglvl, f, backend, zones, name, zone_ptr);
         if(result != 0)
         {
             (void)vrprint.error(-1, "Internal Error", "get_group_info() "
@@ -526,9 +542,32 @@ read_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces,
 }
 
 
+/*  compare_zonename
+
+    Compare function for the name index: table data is a zone, the
+    search data is a name.
+*/
+static int
+compare_zonename(const void *table_data, const void *search_data)
+{
+    const struct ZoneData_  *zone_ptr = (const struct ZoneData_ *)table_data;
+
+    if(table_data == NULL || search_data == NULL)
+        return(0);
+
+    if(strcmp(zone_ptr->name, (const char *)search_data) == 0)
+        return(1);
+
+    return(0);
+}
+
+
 /*  search_zonedata
 
-    Function to search the ServicesList.
+    Function to search the ZonesList. Uses the name index set up by
+    init_zonedata, so it is O(1) on average. The firewall entries added
+    by ins_iface_into_zonelist and add_broadcasts_zonelist are not in the
+    index; they are only looked up by ipaddress.
 
     It returns the pointer or a NULL-pointer if not found.
 */
@@ -547,26 +586,37 @@ search_zonedata(const int debuglvl, const Zones *zones, char *name)
         return(NULL);
     }
 
-
-    /* now search */
-    for(d_node = zones->list.top; d_node ; d_node = d_node->next)
+    if(zones->name_hash.table != NULL)
+    {
+        zonedata_ptr = hash_search(debuglvl, &zones->name_hash, name);
+    }
+    else
     {
-        if(!(zonedata_ptr = d_node->data))
+        /* no index, search the list */
+        for(d_node = zones->list.top; d_node ; d_node = d_node->next)
         {
-            (void)vrprint.error(-1, "Internal Error", "NULL pointer "
-                    "(in: %s:%d).", __FUNC__, __LINE__);
-            return(NULL);
+            if(!(zonedata_ptr = d_node->data))
+            {
+                (void)vrprint.error(-1, "Internal Error", "NULL pointer "
+                        "(in: %s:%d).", __FUNC__, __LINE__);
+                return(NULL);
+            }
+
+            if(strcmp(zonedata_ptr->name, name) == 0)
+                break;
         }
+        if(d_node == NULL)
+            zonedata_ptr = NULL;
+    }
 
-        if(strcmp(zonedata_ptr->name, name) == 0)
-        {
-            if(debuglvl >= HIGH)
-                (void)vrprint.debug(__FUNC__, "zone '%s' found.",
-                        name);
+    if(zonedata_ptr != NULL)
+    {
+        if(debuglvl >= HIGH)
+            (void)vrprint.debug(__FUNC__, "zone '%s' found.",
+                    name);
 
-            /* found, return */
-            return(zonedata_ptr);
-        }
+        /* found, return */
+        return(zonedata_ptr);
     }
 
     if(debuglvl >= LOW)
@@ -578,6 +628,41 @@ search_zonedata(const int debuglvl, const Zones *zones, char *name)
 }
 
 
+/*  zones_rehash
+
+    Updates the name index after 'zone_ptr' was renamed from 'old_name'.
+    Call this after changing zone_ptr->name of a zone in the list.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+zones_rehash(const int debuglvl, Zones *zones, struct ZoneData_ *zone_ptr,
+        const char *old_name)
+{
+    /* safety */
+    if(zones == NULL || zone_ptr == NULL || old_name == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(zones->name_hash.table == NULL)
+        return(0);
+
+    if(hash_remove_key(debuglvl, &zones->name_hash, old_name, zone_ptr) < 0)
+    {
+        (void)vrprint.error(-1, "Internal Error", "zone '%s' not found "
+                "in the index (in: %s:%d).", old_name, __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(hash_insert_key(debuglvl, &zones->name_hash, zone_ptr->name, zone_ptr));
+}
+
+
 /*- print_list - */
 void
 zonedata_print_list(const Zones *zones)
@@ -600,9 +685,61 @@ zonedata_print_list(const Zones *zones)
 }
 
 
+/* what init_zonedata_load needs */
+struct ZonesLoad_
+{
+    Zones           *zones;
+    Interfaces      *interfaces;
+    struct rgx_     *reg;
+};
+
+
+/*  init_zonedata_load
+
+    Validates and inserts one zone/network/host/group, read with 'f'
+    and 'backend'.
+
+    returncodes:
+         0: ok (or name invalid, skipped)
+        -1: error
+*/
+static int
+init_zonedata_load(const int debuglvl, void *ctx, struct BackendFunctions_ *f, void *backend, char *zonename, int zonetype)
+{
+    struct ZonesLoad_   *zl = ctx;
+    int                 result = 0;
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "loading zone: '%s', "
+                "type: %d", zonename, zonetype);
+
+    if(validate_zonename(debuglvl, zonename, 1, NULL, NULL, NULL, zl->reg->zonename, VALNAME_VERBOSE) == 0)
+    {
+        result = insert_zonedata(debuglvl, f, backend, zl->zones, zl->interfaces, zonename, zonetype, zl->reg);
+        if(result < 0)
+        {
+            (void)vrprint.error(-1, "Internal Error",
+                    "insert_zonedata() failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(-1);
+        }
+        else
+        {
+            if(debuglvl >= LOW)
+                (void)vrprint.debug(__FUNC__, "loading "
+                        "zone succes: '%s' (type %d).",
+                        zonename, zonetype);
+        }
+    }
+
+    return(0);
+}
+
+
 /*  init_zonedata
 
-    Loads all zonedata in memory.
+    Loads all zonedata in memory. If the backend supports it, all
+    zones are read in one go, otherwise they are listed and asked.
 
     returncodes:
          0: succes
@@ -612,10 +749,11 @@ zonedata_print_list(const Zones *zones)
 int
 init_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces, struct rgx_ *reg)
 {
-    int     retval = 0,
-            result = 0,
-            zonetype = 0;
-    char    zonename[MAX_HOST_NET_ZONE] = "";
+    int                 retval = 0,
+                        result = 0,
+                        zonetype = 0;
+    char                zonename[MAX_HOST_NET_ZONE] = "";
+    struct ZonesLoad_   zl;
 
     /* safety */
     if(zones == NULL || interfaces == NULL || reg == NULL)
@@ -631,31 +769,24 @@ init_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces, struct r
     /* create the list */
     if(d_list_setup(debuglvl, &zones->list, NULL) < 0)
         return(-1);
+    if(hash_setup(debuglvl, &zones->name_hash, ZONES_HASH_ROWS,
+            hash_name, compare_zonename) < 0)
+        return(-1);
+
+    zl.zones = zones;
+    zl.interfaces = interfaces;
+    zl.reg = reg;
 
     /* get the info from the backend */
-    while(zf->list(debuglvl, zone_backend, zonename, &zonetype, CAT_ZONES) != NULL)
+    result = backend_bulk_load(debuglvl, zf, zone_backend, CAT_ZONES, init_zonedata_load, &zl);
+    if(result < 0)
+        return(-1);
+    else if(result == 0)
     {
-        if(debuglvl >= MEDIUM)
-            (void)vrprint.debug(__FUNC__, "loading zone: '%s', "
-                    "type: %d", zonename, zonetype);
-
-        if(validate_zonename(debuglvl, zonename, 1, NULL, NULL, NULL, reg->zonename, VALNAME_VERBOSE) == 0)
+        while(zf->list(debuglvl, zone_backend, zonename, &zonetype, CAT_ZONES) != NULL)
         {
-            result = insert_zonedata(debuglvl, zones, interfaces, zonename, zonetype, reg);
-            if(result < 0)
-            {
-                (void)vrprint.error(-1, "Internal Error",
-                        "insert_zonedata() failed (in: %s:%d).",
-                        __FUNC__, __LINE__);
+            if(init_zonedata_load(debuglvl, &zl, zf, zone_backend, zonename, zonetype) < 0)
                 return(-1);
-            }
-            else
-            {
-                if(debuglvl >= LOW)
-                    (void)vrprint.debug(__FUNC__, "loading "
-                            "zone succes: '%s' (type %d).",
-                            zonename, zonetype);
-            }
         }
     }
 
@@ -688,6 +819,12 @@ destroy_zonedatalist(const int debuglvl, Zones *zones)
     }
 
     d_list_cleanup(debuglvl, &zones->list);
+
+    if(zones->name_hash.table != NULL)
+    {
+        (void)hash_cleanup(debuglvl, &zones->name_hash);
+        zones->name_hash.table = NULL;
+    }
 }
 
 
@@ -815,6 +952,11 @@ delete_zone(const int debuglvl, Zones *zones, char *zonename, int zonetype)
 
         if(strcmp(zonename, zone_list_ptr->name) == 0)
         {
+            /* remove from the index */
+            if(zones->name_hash.table != NULL)
+                (void)hash_remove_key(debuglvl, &zones->name_hash,
+                        zone_list_ptr->name, zone_list_ptr);
+
             /* remove from list */
             if(d_list_remove_node(debuglvl, &zones->list, d_node) < 0)
             {
@@ -1268,16 +1410,8 @@ validate_zonename(const int debuglvl, const char *zonename, int onlyvalidate, ch
 }
 
 
-/*  zones_group_save_members
-
-    Save the group members to the backend.
-
-    Returncodes:
-         0: ok
-        -1: error
-*/
-int
-zones_group_save_members(const int debuglvl, struct ZoneData_ *group_ptr)
+static int
+zones_group_tell_members(const int debuglvl, struct ZoneData_ *group_ptr)
 {
     d_list_node         *d_node = NULL;
     struct ZoneData_    *member_ptr = NULL;
@@ -1342,6 +1476,39 @@ zones_group_save_members(const int debuglvl, struct ZoneData_ *group_ptr)
 }
 
 
+
+/*  zones_group_save_members
+
+    Save the group members to the backend. All members are written to the
+    backend at once.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+zones_group_save_members(const int debuglvl, struct ZoneData_ *group_ptr)
+{
+    int result = 0;
+
+    /* safety */
+    if(!group_ptr)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s).", __FUNC__);
+        return(-1);
+    }
+
+    if(backend_tell_begin(debuglvl, zf, zone_backend, group_ptr->name, TYPE_GROUP) < 0)
+        return(-1);
+
+    result = zones_group_tell_members(debuglvl, group_ptr);
+
+    if(backend_tell_end(debuglvl, zf, zone_backend, result == 0 ? 1 : 0) < 0)
+        return(-1);
+
+    return(result);
+}
+
 int
 zones_group_rem_member(const int debuglvl, struct ZoneData_ *group_ptr, char *hostname)
 {
@@ -1591,7 +1758,7 @@ zones_network_rem_iface(const int debuglvl, struct ZoneData_ *network_ptr, char
         -1: error
  */
 int
-zones_network_get_interfaces(const int debuglvl, struct ZoneData_ *zone_ptr, Interfaces *interfaces)
+zones_network_get_interfaces(const int debuglvl, struct BackendFunctions_ *f, void *backend, struct ZoneData_ *zone_ptr, Interfaces *interfaces)
 {
     char    cur_ifac[MAX_INTERFACE] = "";
 
@@ -1615,7 +1782,7 @@ zones_network_get_interfaces(const int debuglvl, struct ZoneData_ *zone_ptr, Int
     zone_ptr->active_interfaces = 0;
 
     /* get all interfaces from the backend */
-    while((zf->ask(debuglvl, zone_backend, zone_ptr->name, "INTERFACE", cur_ifac, sizeof(cur_ifac), TYPE_NETWORK, 1)) == 1)
+    while((f->ask(debuglvl, backend, zone_ptr->name, "INTERFACE", cur_ifac, sizeof(cur_ifac), TYPE_NETWORK, 1)) == 1)
     {
         if(zones_network_add_iface(debuglvl, interfaces, zone_ptr, cur_ifac) < 0)
         {
@@ -1983,7 +2150,7 @@ zones_network_rule_parse_line(const int debuglvl, const char *line, struct RuleD
 
 
 int
-zones_network_get_protectrules(const int debuglvl, struct ZoneData_ *network_ptr)
+zones_network_get_protectrules(const int debuglvl, struct BackendFunctions_ *f, void *backend, struct ZoneData_ *network_ptr)
 {
     char                currule[MAX_RULE_LENGTH] = "";
     struct RuleData_    *rule_ptr = NULL;
@@ -2004,7 +2171,7 @@ zones_network_get_protectrules(const int debuglvl, struct ZoneData_ *network_ptr
     }
 
     /* get all rules from the backend */
-    while((zf->ask(debuglvl, zone_backend, network_ptr->name, "RULE", currule, sizeof(currule), TYPE_NETWORK, 1)) == 1)
+    while((f->ask(debuglvl, backend, network_ptr->name, "RULE", currule, sizeof(currule), TYPE_NETWORK, 1)) == 1)
     {
         /* get mem */
         if(!(rule_ptr = rule_malloc()))
@@ -2294,6 +2461,23 @@ zones_check_group(const int debuglvl, struct ZoneData_ *zone_ptr)
 }
 
 
+/* check one zone for load_zones. 'ctx' is the array of zones. */
+static int
+load_zones_check(const int debuglvl, void *ctx, unsigned int i)
+{
+    struct ZoneData_    *zone_ptr = ((struct ZoneData_ **)ctx)[i];
+
+    if(zone_ptr->type == TYPE_HOST)
+        return(zones_check_host(debuglvl, zone_ptr));
+    else if(zone_ptr->type == TYPE_GROUP)
+        return(zones_check_group(debuglvl, zone_ptr));
+    else if(zone_ptr->type == TYPE_NETWORK)
+        return(zones_check_network(debuglvl, zone_ptr));
+
+    return(1);
+}
+
+
 /*  load_zones
 
     calls init_zonedata and does some checking
@@ -2305,9 +2489,15 @@ zones_check_group(const int debuglvl, struct ZoneData_ *zone_ptr)
 int
 load_zones(const int debuglvl, Zones *zones, Interfaces *interfaces, struct rgx_ *reg)
 {
-    struct ZoneData_    *zone_ptr = NULL;
+    struct ZoneData_    *zone_ptr = NULL,
+                        **zone_array = NULL;
     d_list_node         *d_node = NULL;
-    int                 result = 0;
+    int                 result = 0,
+                        retval = 0;
+    unsigned int        n = 0,
+                        i = 0;
+    char                *select = NULL;
+    ParallelJob         job;
 
     (void)vrprint.info("Info", "Loading zones...");
 
@@ -2319,7 +2509,16 @@ load_zones(const int debuglvl, Zones *zones, Interfaces *interfaces, struct rgx_
         return(-1);
     }
 
-    /* loop through the zones */
+    /* the checks of the zones are done in parallel */
+    if(!(zone_array = calloc(zones->list.len + 1, sizeof(struct ZoneData_ *))) ||
+       !(select = calloc(zones->list.len + 1, sizeof(char))))
+    {
+        (void)vrprint.error(-1, "Error", "calloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        free(zone_array);
+        return(-1);
+    }
+
     for(d_node = zones->list.top; d_node; d_node = d_node->next)
     {
         zone_ptr = d_node->data;
@@ -2327,50 +2526,71 @@ load_zones(const int debuglvl, Zones *zones, Interfaces *interfaces, struct rgx_
         {
             (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
                     __FUNC__, __LINE__);
+            free(zone_array);
+            free(select);
             return(-1);
         }
 
-        if(zone_ptr->type == TYPE_HOST)
+        zone_array[n++] = zone_ptr;
+    }
+
+    if(parallel_setup(debuglvl, &job, n, load_zones_check, zone_array) < 0)
+    {
+        free(zone_array);
+        free(select);
+        return(-1);
+    }
+
+    /* networks first: hosts and groups look at the network they are in */
+    for(i = 0; i < n; i++)
+        select[i] = (zone_array[i]->type == TYPE_NETWORK);
+    (void)parallel_run(debuglvl, &job, select);
+
+    for(i = 0; i < n; i++)
+    {
+        if(select[i] == TRUE && job.results[i] == 0)
+            zone_array[i]->active = FALSE;
+    }
+
+    for(i = 0; i < n; i++)
+        select[i] = (zone_array[i]->type == TYPE_HOST || zone_array[i]->type == TYPE_GROUP);
+    (void)parallel_run(debuglvl, &job, select);
+
+    /* report in the order of the list */
+    for(i = 0; i < n; i++)
+    {
+        zone_ptr = zone_array[i];
+
+        parallel_replay(debuglvl, &job, i);
+
+        if(zone_ptr->type != TYPE_HOST && zone_ptr->type != TYPE_GROUP &&
+           zone_ptr->type != TYPE_NETWORK)
         {
-            result = zones_check_host(debuglvl, zone_ptr);
-            if(result == -1)
-                return(-1);
-            else if(result == 0)
-            {
-                (void)vrprint.info("Info", "Host '%s' has been deactivated because of previous warnings.",
-                        zone_ptr->name);
-                zone_ptr->active = FALSE;
-            }
+            continue;
         }
-        else if(zone_ptr->type == TYPE_GROUP)
+
+        if(job.results[i] == -1)
         {
-            result = zones_check_group(debuglvl, zone_ptr);
-            if(result == -1)
-                return(-1);
-            else if(result == 0)
-            {
-                (void)vrprint.info("Info", "Group '%s' has been deactivated because of previous warnings.",
-                        zone_ptr->name);
-                zone_ptr->active = FALSE;
-            }
+            retval = -1;
+            break;
         }
-        else if(zone_ptr->type == TYPE_NETWORK)
+        else if(job.results[i] == 0)
         {
-            result = zones_check_network(debuglvl, zone_ptr);
-            if(result == -1)
-                return(-1);
-            else if(result == 0)
-            {
-                (void)vrprint.info("Info", "Network '%s' has been deactivated because of previous warnings.",
-                        zone_ptr->name);
-                zone_ptr->active = FALSE;
-            }
+            (void)vrprint.info("Info", "%s '%s' has been deactivated because of previous warnings.",
+                    zone_ptr->type == TYPE_HOST ? "Host" :
+                    (zone_ptr->type == TYPE_GROUP ? "Group" : "Network"),
+                    zone_ptr->name);
+            zone_ptr->active = FALSE;
         }
-
     }
 
-    (void)vrprint.info("Info", "Loading zones succesfull.");
-    return(0);
+    parallel_cleanup(debuglvl, &job);
+    free(zone_array);
+    free(select);
+
+    if(retval == 0)
+        (void)vrprint.info("Info", "Loading zones succesfull.");
+    return(retval);
 }
 
 
@@ -30,393 +30,54 @@ struct TrafVolSection_
 
 } TrafVolSection;
 
-struct TrafVol_
-{
-    int             year;
-    int             month;
-    int             day;
-
-    char            total;  /* total for this timeunit */
-
-    unsigned int    recv_mb;
-    unsigned int    send_mb;
-
-} TrafVol;
-
-
-/*  strip the buf src from the spaces before the text. Leave other
-    spaces alone.
-*/
-void
-strip_buf(char *src, char *dst, size_t dstsize)
-{
-    size_t  i = 0,
-            k = 0;
-    char    copy_space = 0;
-
-    for(i = 0; i < dstsize && i < StrMemLen(src); i++)
-    {
-        if(src[i] != ' ')
-            copy_space = 1;
-
-        if(src[i] != ' ' || copy_space == 1)
-        {
-            dst[k] = src[i];
-            k++;
-        }
-    }
-    dst[k] = '\0';
-}
-
-
-/*
+/*  bandwidth_get_iface
 
-*/
-static int
-bandwidth_store(const int debuglvl, d_list *list, int year, int month, int day,
-            char total, unsigned int recv, unsigned int send)
-{
-    struct TrafVol_ *bw_ptr = NULL;
+    Gets the traffic volume of 'device' in MB for 'days' days, starting
+    with the day 'start' is in, from the traffic volume store.
 
-    bw_ptr = malloc(sizeof(struct TrafVol_));
-    if(bw_ptr == NULL)
-    {
-        (void)vrprint.error(-1, VR_ERR,
-                gettext("malloc failed: %s (in: %s:%d)."),
-                strerror(errno), __FUNC__, __LINE__);
-        return(-1);
-    }
-    
-    bw_ptr->year = year;
-    bw_ptr->month = month;
-    bw_ptr->day = day;
-    
-    bw_ptr->total = total;
-    
-    bw_ptr->recv_mb = recv;
-    bw_ptr->send_mb = send;
-
-    /* append to the list */
-    if(d_list_append(debuglvl, list, bw_ptr) == NULL)
-    {
-        (void)vrprint.error(-1, VR_INTERR, "d_list_append() failed "
-                "(in: %s:%d).", __FUNC__, __LINE__);
-
-        free(bw_ptr);
-        return(-1);
-    }
-
-    return(0);
-}
-
-
-/*
-    on first sight it may look if this function solves an easy problem
-    the hard way, just reading the output one line at a time should
-    be enough right?
-
-    wrong... the number of interfaces determines how long the lines
-    are... so we read a number of bytes and try to analyse it...
-
-    if days is 0, we don't limit the number of days.
-
-    returncodes:
+    Returncodes:
         -1: error
          0: ok, but no data
          1: ok
 */
-int
-bandwidth_get_iface(const int debuglvl, char *device, int year, int month,
-            int start_day, int days, char only_total, d_list *list)
+static int
+bandwidth_get_iface(const int debuglvl, TrafVolStore *store, char *device,
+            time_t start, unsigned int days, unsigned int *recv_mb,
+            unsigned int *send_mb)
 {
-    char            bw_buf[512] = "",
-                    sect_buf[32] = "",
-                    sect_buf_stripped[32] = "",
-                    tmpfile[] = "/tmp/vuurmuur-iptrafvol-XXXXXX";
-    char            done = FALSE;
-    int             fd = 0;
-    int             result = 0;
-    ssize_t         readsize = 0;
-
-    char            data_month = 0;
-    int             data_day = 0;
-
-    unsigned int    i = 0,
-                    k = 0;
-
-    int             act_border = 0;
-
-    int             device_column = 0; /* column where our
-                                    device can be found. */
-    int             cur_column = 0;
-
-    int             line_num = 0;
-
-    char            buf_done = 0;
-
-    char            parsing_device_line = 0,
-                    parsing_total_line = 0;
-
-    char            parsing_data = 0;
-
-    char            month_str[4] = "";
-
-    unsigned int    recv = 0,
-                    recv_sub = 0,
-                    send = 0,
-                    send_sub = 0;
-
-    int             retval = 0;
-
-    char            cmd_year_str[5] = "",
-                    cmd_month_str[3] = "",
-                    cmd_start_day_str[3] = "",
-                    cmd_num_days_str[8] = "";
+    unsigned long long  recv = 0,
+                        send = 0;
+    int                 series = 0,
+                        result = 0;
 
     /* safety */
-    if(device == NULL || list == NULL)
+    if(store == NULL || device == NULL || recv_mb == NULL || send_mb == NULL)
     {
         (void)vrprint.error(-1, VR_INTERR, "parameter problem "
                 "(in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
     }
 
-    /* setup the list */
-    d_list_setup(debuglvl, list, free);
-
-    if(debuglvl >= LOW)
-        (void)vrprint.debug(__FUNC__, "looking for data for '%s'.", device);
-
-    /* create the tempfile */
-    fd = create_tempfile(debuglvl, tmpfile);
-    if(fd == -1)
-        return(-1);
-    else
-        close(fd);
-
-    snprintf(cmd_year_str, sizeof(cmd_year_str), "%d", year);
-    snprintf(cmd_month_str, sizeof(cmd_month_str), "%d", month);
-    snprintf(cmd_start_day_str, sizeof(cmd_start_day_str), "%d", start_day);
-
-    /* see if we need to pass the -s option to iptrafvol*/
-    if(days > 0) {
-        snprintf(cmd_num_days_str, sizeof(cmd_num_days_str), "%d", days);
-        char *args[] = { vccnf.iptrafvol_location,
-                         "-d", "-y", cmd_year_str,
-                         "-m", cmd_month_str,
-                         "-b", cmd_start_day_str,
-                         "-s", cmd_num_days_str, NULL };
-        char *outputs[] = { tmpfile, "/dev/null", NULL };
-        result = libvuurmuur_exec_command(debuglvl, &conf, vccnf.iptrafvol_location, args, outputs);
-    } else {
-        char *args[] = { vccnf.iptrafvol_location,
-                         "-d", "-y", cmd_year_str,
-                         "-m", cmd_month_str,
-                         "-b", cmd_start_day_str, NULL };
-        char *outputs[] = { tmpfile, "/dev/null", NULL };
-        result = libvuurmuur_exec_command(debuglvl, &conf, vccnf.iptrafvol_location, args, outputs);
-    }
-    if(result != 0)
-    {
-        return(-1);
-    }
-
-    /* open the file for reaing */
-    fd = open(tmpfile, 0);
-    if(fd < 0)
-    {
-        (void)vrprint.error(-1, VR_ERR,
-                gettext("opening '%s' failed: %s (in: %s:%d)."),
-                tmpfile, strerror(errno), __FUNC__, __LINE__);
-        return(-1);
-    }
-
-    while(done == FALSE)
-    {
-        memset(bw_buf, 0, sizeof(bw_buf));
-
-        readsize = read(fd, bw_buf, sizeof(bw_buf));
-        if(readsize > 0)
-        {
-            //fprintf(stdout, "bw_buf: '%s'.\n", bw_buf);
-
-            for(i = 0; i < (unsigned int)readsize; i++)
-            {
-                //(void)vrprint.info(__FUNC__, "bw_buf[%d] = '%c', k = %d", i, bw_buf[i], k);
-
-                if(bw_buf[i] == '\n')
-                {
-                    line_num++;
-
-                    act_border = 0;
-
-                    sect_buf[k] = '\0';
-                    k = 0;
-
-                    //(void)vrprint.info(__FUNC__, "newline (act_border: %d, k: %d, line_num: %d, sect_buf '%s'.)", act_border, k, line_num, sect_buf);
-
-                    if(parsing_device_line == 1)
-                    {
-                        parsing_device_line = 0;
-                    }
-                    if(parsing_total_line == 1)
-                    {
-                        //retval = 1;
-                        done = 1;
-                        break;
-                    }
-
-                    buf_done = 1;
-                }
-                else if(bw_buf[i] == '|')
-                {
-                    act_border++;
-                    sect_buf[k] = '\0';
-                    k = 0;
-
-                    //(void)vrprint.info(__FUNC__, "border  (act_border: %d, k: %d, line_num: %d, sect_buf '%s'.)", act_border, k, line_num, sect_buf);
-                    buf_done = 1;
-                }
-                else
-                {
-                    if(k < (unsigned int)sizeof(sect_buf) - 1)
-                    {
-                        sect_buf[k] = bw_buf[i];
-                        k++;
-                    }
-                    else
-                    {
-                        sect_buf[k] = '\0';
-                    }
-                }
-
-                if(line_num > 5)
-                    parsing_data = 1;
+    *recv_mb = 0;
+    *send_mb = 0;
 
-                if(buf_done == 1)
-                {
-                    buf_done = 0;
-
-                    /* strip the buffer from the starting whitespaces */
-                    strip_buf(sect_buf, sect_buf_stripped, sizeof(sect_buf_stripped));
-
-                    /* get the current column */
-                    cur_column = act_border - 1;
-
-                    if(line_num == 1)
-                    {
-                        if(debuglvl >= HIGH)
-                            (void)vrprint.debug(__FUNC__, "line_num == 1: '%s'", sect_buf_stripped);
-
-                        if(strncmp("no data", sect_buf_stripped, 7) == 0)
-                        {
-                            retval = 0;
-                            done = TRUE;
-                            break;
-                        }
-                    }
-
-                    /* the deviceline starts with MBytes */
-                    if(strncmp(sect_buf_stripped, "MBytes", 6) == 0)
-                        parsing_device_line = 1;
-
-                    /* this is the total line */
-                    if(strcmp(sect_buf_stripped, "Total:") == 0)
-                        parsing_total_line = 1;
-
-                    /* date column */
-                    if( parsing_data == 1 && cur_column == 1 && only_total == 0)
-                    {
-                        sscanf(sect_buf_stripped, "%d %3s", &data_day, month_str);
-
-                        /* parse the month */
-                        if(strcmp(month_str, "Jan") == 0)       data_month = 1;
-                        else if(strcmp(month_str, "Feb") == 0)  data_month = 2;
-                        else if(strcmp(month_str, "Mar") == 0)  data_month = 3;
-                        else if(strcmp(month_str, "Apr") == 0)  data_month = 4;
-                        else if(strcmp(month_str, "May") == 0)  data_month = 5;
-                        else if(strcmp(month_str, "Jun") == 0)  data_month = 6;
-                        else if(strcmp(month_str, "Jul") == 0)  data_month = 7;
-                        else if(strcmp(month_str, "Aug") == 0)  data_month = 8;
-                        else if(strcmp(month_str, "Sep") == 0)  data_month = 9;
-                        else if(strcmp(month_str, "Oct") == 0)  data_month = 10;
-                        else if(strcmp(month_str, "Nov") == 0)  data_month = 11;
-                        else if(strcmp(month_str, "Dec") == 0)  data_month = 12;
-                        else
-                        {
-                            (void)vrprint.error(-1, VR_ERR, gettext("could not parse month '%s' (in: %s:%d)."),
-                                                    month_str,
-                                                    __FUNC__, __LINE__);
-                            return(-1);
-                        }
-
-                        //(void)vrprint.info(__FUNC__, "day: '%d', month: '%d'", data_day, data_month);
-                    }
-                    /* device column */
-                    if( parsing_data == 1 && device_column > 1 && cur_column == device_column &&
-                        ((only_total == 1 && parsing_total_line == 1) || only_total == 0))
-                    {
-                        sscanf(sect_buf_stripped, "%u.%u %u.%u", &recv, &recv_sub, &send, &send_sub);
-
-                        recv = ((recv * 10) + recv_sub) / 10;
-                        send = ((send * 10) + send_sub) / 10;
-
-                        if(debuglvl >= LOW)
-                            (void)vrprint.info(__FUNC__, "recv = %.1u, send = %.1u.", recv, send);
-
-                        retval = 1;
-
-                        /* we asume that the date is already parsed */
-                        result = bandwidth_store(debuglvl, list, year, data_month, data_day, parsing_total_line, recv, send);
-                        if(result < 0)
-                        {
-                            (void)vrprint.error(-1, VR_INTERR, "bandwidth_store() failed (in: %s:%d).", __FUNC__, __LINE__);
-
-                            done = TRUE;
-                            retval = -1;
-                        }
-                    }
-
-                    /* parse the deviceline to determine the column */
-                    if(parsing_device_line == 1)
-                    {
-                        if(strcmp(sect_buf_stripped, device) == 0)
-                        {
-                            /* act border includes the last borderline, so -1. */
-                            device_column = cur_column;
-
-                            if(debuglvl >= LOW)
-                                (void)vrprint.info(__FUNC__, "sect_buf_stripped '%s' match! (device: %s) column = %d.", sect_buf_stripped, device, device_column);
-                        }
-                    }
-                }
-            }
-        }
-        else
-        {
-            done = TRUE;
-        }
-    }
+    /* not sampled (yet) */
+    if((series = trafvol_find(debuglvl, store, device)) < 0)
+        return(0);
 
-    /* close the file again */
-    if(close(fd) == -1)
+    result = trafvol_get(debuglvl, store, (unsigned int)series, TRAFVOL_DAY,
+            start, days, &recv, &send);
+    if(result == 1)
     {
-        (void)vrprint.error(-1, VR_ERR,
-                gettext("closing of '%s' failed: %s (in: %s:%d)."),
-                tmpfile, strerror(errno), __FUNC__, __LINE__);
-        return(-1);
-    }
+        *recv_mb = (unsigned int)(recv / (1024 * 1024));
+        *send_mb = (unsigned int)(send / (1024 * 1024));
 
-    /* remove the file */
-    if(unlink(tmpfile) == -1)
-    {
-        (void)vrprint.error(-1, VR_ERR,
-                gettext("removing '%s' failed (unlink): %s (in: %s:%d)."),
-                tmpfile, strerror(errno), __FUNC__, __LINE__);
-        return(-1);
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "%s: recv = %u, send = %u.",
+                    device, *recv_mb, *send_mb);
     }
 
-    return(retval);
+    return(result);
 }
 
 
@@ -679,6 +340,37 @@ create_bw_string(const int debuglvl, unsigned int mb, char *str, size_t len)
 }
 
 
+/*  trafvol_set_fields
+
+    Puts the result of bandwidth_get_iface() in the in and out fields.
+*/
+static void
+trafvol_set_fields(const int debuglvl, int result, unsigned int recv_mb,
+            unsigned int send_mb, FIELD *in_fld, FIELD *out_fld)
+{
+    char    bw_str[6] = "";
+
+    if(result == 1)
+    {
+        create_bw_string(debuglvl, recv_mb, bw_str, sizeof(bw_str));
+        set_field_buffer_wrap(debuglvl, in_fld, 0, bw_str);
+
+        create_bw_string(debuglvl, send_mb, bw_str, sizeof(bw_str));
+        set_field_buffer_wrap(debuglvl, out_fld, 0, bw_str);
+    }
+    else if(result == 0)
+    {
+        set_field_buffer_wrap(debuglvl, in_fld, 0, "  -  ");
+        set_field_buffer_wrap(debuglvl, out_fld, 0, "  -  ");
+    }
+    else
+    {
+        set_field_buffer_wrap(debuglvl, in_fld, 0, gettext("error"));
+        set_field_buffer_wrap(debuglvl, out_fld, 0, gettext("error"));
+    }
+}
+
+
 /*  trafvol_section
 
     This section shows bandwidth usage of the system.
@@ -702,22 +394,23 @@ trafvol_section(const int debuglvl, Zones *zones, Interfaces *interfaces,
     unsigned int            ifac_num = 0;
     struct InterfaceData_   *iface_ptr=NULL;
 
-    d_list_node             *d_node = NULL,
-                            *bw_d_node = NULL;
-    struct TrafVol_         *bw_ptr = NULL;
-    d_list                  bw_list;
+    d_list_node             *d_node = NULL;
 
-    int                     year = 0,
-                            month = 0;
+    TrafVolStore            store,
+                            *store_ptr = NULL;
+    int                     store_result = 0;
 
     time_t                  cur_time,
                             yesterday_time,
-                            lastweek_time;
+                            lastweek_time,
+                            month_time,
+                            lastmonth_time;
     struct tm               cur_tm,
-                            yesterday_tm,
-                            lastweek_tm;
+                            month_tm;
+    unsigned int            lastmonth_days = 0;
 
-    char                    bw_str[6] = "";
+    unsigned int            recv_mb = 0,
+                            send_mb = 0;
 
     int                     result=0;
 
@@ -725,12 +418,14 @@ trafvol_section(const int debuglvl, Zones *zones, Interfaces *interfaces,
     int                     slept_so_far    = 10000000; /* time slept since last update */
 
     /* top menu */
-    char                    *key_choices[] = {  "F12",
+    char                    *key_choices[] = {  "t",
+                                                "F12",
                                                 "F10"};
-    int                     key_choices_n = 2;
-    char                    *cmd_choices[] = {  gettext("help"),
+    int                     key_choices_n = 3;
+    char                    *cmd_choices[] = {  gettext("top talkers"),
+                                                gettext("help"),
                                                 gettext("back")};
-    int                     cmd_choices_n = 2;
+    int                     cmd_choices_n = 3;
 
     if(interfaces->list.len == 0)
     {
@@ -738,12 +433,6 @@ trafvol_section(const int debuglvl, Zones *zones, Interfaces *interfaces,
         return(0);
     }
 
-    if(strcmp(vccnf.iptrafvol_location, "") == 0)
-    {
-        (void)vrprint.error(-1, VR_ERR, gettext("please set the location of the iptrafvol.pl command in the Settings."));
-        return(-1);
-    }
-
     getmaxyx(stdscr, max_height, max_width);
     max_onscreen = max_height - 6 - 6;
 
@@ -809,17 +498,35 @@ trafvol_section(const int debuglvl, Zones *zones, Interfaces *interfaces,
                 return(-1);
             }
 
-            if(localtime_r(&yesterday_time, &yesterday_tm) == NULL)
+            /*  the first of this month and of the last month. At noon,
+                so daylight saving time can't move us to another day. */
+            month_tm = cur_tm;
+            month_tm.tm_mday = 1;
+            month_tm.tm_hour = 12;
+            month_tm.tm_min = 0;
+            month_tm.tm_sec = 0;
+            month_tm.tm_isdst = -1;
+            month_time = mktime(&month_tm);
+
+            /* mktime handles month -1 (Dec of last year) */
+            month_tm.tm_mon--;
+            month_tm.tm_isdst = -1;
+            lastmonth_time = mktime(&month_tm);
+
+            if(month_time == -1 || lastmonth_time == -1)
             {
-                (void)vrprint.error(-1, VR_INTERR, "converting yesterday's time failed (in: %s:%d).", __FUNC__, __LINE__);
+                (void)vrprint.error(-1, VR_INTERR, "converting the month failed (in: %s:%d).", __FUNC__, __LINE__);
                 return(-1);
             }
+            lastmonth_days = (unsigned int)((month_time - lastmonth_time + 43200) / 86400);
 
-            if(localtime_r(&lastweek_time, &lastweek_tm) == NULL)
-            {
-                (void)vrprint.error(-1, VR_INTERR, "converting lastweeks's time failed (in: %s:%d).", __FUNC__, __LINE__);
-                return(-1);
-            }
+            /* map the store again: the daemon may have added interfaces */
+            store_result = trafvol_open(debuglvl, &store, TRAFVOL_LOCATION, FALSE, NULL);
+            store_ptr = store_result == 0 ? &store : NULL;
+
+            /* no store yet, so no data */
+            if(store_result == 1)
+                store_result = 0;
 
             /* update data here */
             for(d_node = interfaces->list.top, i = 0; d_node && i < ifac_num; d_node = d_node->next)
@@ -835,188 +542,33 @@ trafvol_section(const int debuglvl, Zones *zones, Interfaces *interfaces,
                     /* interface name */
                     set_field_buffer_wrap(debuglvl, TrafVolSection.fields[11 * i], 0, iface_ptr->name);
 
-                    /* get the bw for today */
-                    result = bandwidth_get_iface(debuglvl, iface_ptr->device, cur_tm.tm_year + 1900, cur_tm.tm_mon + 1, cur_tm.tm_mday, 1, 1, &bw_list);
-                    if(result == 1)
-                    {
-                        for(bw_d_node = bw_list.top; bw_d_node; bw_d_node = bw_d_node->next)
-                        {
-                            if(!(bw_ptr = bw_d_node->data))
-                            {
-                                (void)vrprint.error(-1, VR_INTERR, "NULL pointer (in: %s:%d).", __FUNC__, __LINE__);
-                                return(-1);
-                            }
-                            //printf("%2d/%2d/%4d: in: %u, out: %u %s\n", bw_ptr->day, bw_ptr->month, bw_ptr->year, bw_ptr->recv_mb, bw_ptr->send_mb, bw_ptr->total ? "(total)" : "");
-
-                            create_bw_string(debuglvl, bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[1 + (11 * i)], 0, bw_str);
-
-                            create_bw_string(debuglvl, bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[2 + (11 * i)], 0, bw_str);
-                        }
-                        d_list_cleanup(debuglvl, &bw_list);
-                    }
-                    else if(result == 0)
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[1 + (11 * i)], 0, "  -  ");
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[2 + (11 * i)], 0, "  -  ");
-                    }
-                    else
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[1 + (11 * i)], 0, gettext("error"));
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[2 + (11 * i)], 0, gettext("error"));
-                    }
-
-                    /* get the bw for yesterday */
-                    result = bandwidth_get_iface(debuglvl, iface_ptr->device, yesterday_tm.tm_year + 1900, yesterday_tm.tm_mon + 1, yesterday_tm.tm_mday, 1, 1, &bw_list);
-                    if(result == 1)
-                    {
-                        for(bw_d_node = bw_list.top; bw_d_node; bw_d_node = bw_d_node->next)
-                        {
-                            if(!(bw_ptr = bw_d_node->data))
-                            {
-                                (void)vrprint.error(-1, VR_INTERR, "NULL pointer (in: %s:%d).", __FUNC__, __LINE__);
-                                return(-1);
-                            }
-                            //printf("%2d/%2d/%4d: in: %u, out: %u %s\n", bw_ptr->day, bw_ptr->month, bw_ptr->year, bw_ptr->recv_mb, bw_ptr->send_mb, bw_ptr->total ? "(total)" : "");
-
-                            create_bw_string(debuglvl, bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[3 + (11 * i)], 0, bw_str);
-
-                            create_bw_string(debuglvl, bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[4 + (11 * i)], 0, bw_str);
-                        }
-                        d_list_cleanup(debuglvl, &bw_list);
-                    }
-                    else if(result == 0)
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[3 + (11 * i)], 0, "  -  ");
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[4 + (11 * i)], 0, "  -  ");
-                    }
-                    else
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[3 + (11 * i)], 0, gettext("error"));
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[4 + (11 * i)], 0, gettext("error"));
-                    }
-
-                    /* get the bw for past 7 days */
-                    result = bandwidth_get_iface(debuglvl, iface_ptr->device, lastweek_tm.tm_year + 1900, lastweek_tm.tm_mon + 1, lastweek_tm.tm_mday, 7, 1, &bw_list);
-                    if(result == 1)
-                    {
-                        for(bw_d_node = bw_list.top; bw_d_node; bw_d_node = bw_d_node->next)
-                        {
-                            if(!(bw_ptr = bw_d_node->data))
-                            {
-                                (void)vrprint.error(-1, VR_INTERR, "NULL pointer (in: %s:%d).", __FUNC__, __LINE__);
-                                return(-1);
-                            }
-                            //printf("%2d/%2d/%4d: in: %u, out: %u %s\n", bw_ptr->day, bw_ptr->month, bw_ptr->year, bw_ptr->recv_mb, bw_ptr->send_mb, bw_ptr->total ? "(total)" : "");
-
-                            create_bw_string(debuglvl, bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[5 + (11 * i)], 0, bw_str);
-
-                            create_bw_string(debuglvl, bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[6 + (11 * i)], 0, bw_str);
-                        }
-                        d_list_cleanup(debuglvl, &bw_list);
-                    }
-                    else if(result == 0)
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[5 + (11 * i)], 0, "  -  ");
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[6 + (11 * i)], 0, "  -  ");
-                    }
-                    else
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[5 + (11 * i)], 0, gettext("error"));
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[6 + (11 * i)], 0, gettext("error"));
-                    }
-
-                    /* get the bw for the current month */
-                    result = bandwidth_get_iface(debuglvl, iface_ptr->device, cur_tm.tm_year + 1900, cur_tm.tm_mon + 1, 1, 0, 1, &bw_list);
-                    if(result == 1)
-                    {
-                        for(bw_d_node = bw_list.top; bw_d_node; bw_d_node = bw_d_node->next)
-                        {
-                            if(!(bw_ptr = bw_d_node->data))
-                            {
-                                (void)vrprint.error(-1, VR_INTERR, "NULL pointer (in: %s:%d).", __FUNC__, __LINE__);
-                                return(-1);
-                            }
-                            //printf("%2d/%2d/%4d: in: %u, out: %u %s\n", bw_ptr->day, bw_ptr->month, bw_ptr->year, bw_ptr->recv_mb, bw_ptr->send_mb, bw_ptr->total ? "(total)" : "");
-
-                            create_bw_string(debuglvl, bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[7 + (11 * i)], 0, bw_str);
-
-                            create_bw_string(debuglvl, bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[8 + (11 * i)], 0, bw_str);
-                        }
-                        d_list_cleanup(debuglvl, &bw_list);
-                    }
-                    else if(result == 0)
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[7 + (11 * i)], 0, "  -  ");
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[8 + (11 * i)], 0, "  -  ");
-                    }
-                    else
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[7 + (11 * i)], 0, gettext("error"));
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[8 + (11 * i)], 0, gettext("error"));
-                    }
+                    /* today */
+                    result = store_ptr ? bandwidth_get_iface(debuglvl, store_ptr, iface_ptr->device, cur_time, 1, &recv_mb, &send_mb) : store_result;
+                    trafvol_set_fields(debuglvl, result, recv_mb, send_mb, TrafVolSection.fields[1 + (11 * i)], TrafVolSection.fields[2 + (11 * i)]);
 
-            
-                    /* get the bw for the last month */
-                    year = cur_tm.tm_year + 1900;
-                    /* get prev month (by not adding +1) */
-                    month = cur_tm.tm_mon;
-
-                    /*  if month = 0 (Jan), set it to 12
-                        (Dec) and subtract one of the
-                        year.
-                    */
-                    if(month == 0)
-                    {
-                        month = 12;
-                        year = year - 1;
-                    }
-
-                    result = bandwidth_get_iface(debuglvl, iface_ptr->device, year, month, 1, 0, 1, &bw_list);
-                    if(result == 1)
-                    {
-                        for(bw_d_node = bw_list.top; bw_d_node; bw_d_node = bw_d_node->next)
-                        {
-                            if(!(bw_ptr = bw_d_node->data))
-                            {
-                                (void)vrprint.error(-1, VR_INTERR, "NULL pointer (in: %s:%d).", __FUNC__, __LINE__);
-                                return(-1);
-                            }
-                            //printf("%2d/%2d/%4d: in: %u, out: %u %s\n", bw_ptr->day, bw_ptr->month, bw_ptr->year, bw_ptr->recv_mb, bw_ptr->send_mb, bw_ptr->total ? "(total)" : "");
-
-                            create_bw_string(debuglvl, bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[9 + (11 * i)], 0, bw_str);
-
-                            create_bw_string(debuglvl, bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                            set_field_buffer_wrap(debuglvl, TrafVolSection.fields[10 + (11 * i)], 0, bw_str);
-                        }
-                        d_list_cleanup(debuglvl, &bw_list);
-                    }
-                    else if(result == 0)
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[9  + (11 * i)], 0, "  -  ");
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[10 + (11 * i)], 0, "  -  ");
-                    }
-                    else
-                    {
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[9  + (11 * i)], 0, gettext("error"));
-                        set_field_buffer_wrap(debuglvl, TrafVolSection.fields[10 + (11 * i)], 0, gettext("error"));
-                    }
-
-                    /* finally draw the screen */
-                    wrefresh(TrafVolSection.win);
+                    /* yesterday */
+                    result = store_ptr ? bandwidth_get_iface(debuglvl, store_ptr, iface_ptr->device, yesterday_time, 1, &recv_mb, &send_mb) : store_result;
+                    trafvol_set_fields(debuglvl, result, recv_mb, send_mb, TrafVolSection.fields[3 + (11 * i)], TrafVolSection.fields[4 + (11 * i)]);
+
+                    /* the past 7 days */
+                    result = store_ptr ? bandwidth_get_iface(debuglvl, store_ptr, iface_ptr->device, lastweek_time, 7, &recv_mb, &send_mb) : store_result;
+                    trafvol_set_fields(debuglvl, result, recv_mb, send_mb, TrafVolSection.fields[5 + (11 * i)], TrafVolSection.fields[6 + (11 * i)]);
+
+                    /* the current month, up to today */
+                    result = store_ptr ? bandwidth_get_iface(debuglvl, store_ptr, iface_ptr->device, month_time, (unsigned int)cur_tm.tm_mday, &recv_mb, &send_mb) : store_result;
+                    trafvol_set_fields(debuglvl, result, recv_mb, send_mb, TrafVolSection.fields[7 + (11 * i)], TrafVolSection.fields[8 + (11 * i)]);
+
+                    /* the last month */
+                    result = store_ptr ? bandwidth_get_iface(debuglvl, store_ptr, iface_ptr->device, lastmonth_time, lastmonth_days, &recv_mb, &send_mb) : store_result;
+                    trafvol_set_fields(debuglvl, result, recv_mb, send_mb, TrafVolSection.fields[9 + (11 * i)], TrafVolSection.fields[10 + (11 * i)]);
 
                     /* update the line */
                     i++;
                 }
             }
+
+            if(store_ptr != NULL)
+                trafvol_close(debuglvl, store_ptr);
         }
 
         /* finally draw the screen */
@@ -1034,6 +586,15 @@ trafvol_section(const int debuglvl, Zones *zones, Interfaces *interfaces,
                 quit = 1;
                 break;
 
+            case 't':
+            case 'T':
+                (void)toptalkers_section(debuglvl, zones);
+
+                draw_top_menu(debuglvl, top_win, gettext("Traffic Volume"), key_choices_n, key_choices, cmd_choices_n, cmd_choices);
+                update_panels();
+                doupdate();
+                break;
+
             case KEY_F(12):
             case 'h':
             case 'H':
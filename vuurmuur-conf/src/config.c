@@ -24,8 +24,6 @@
 int
 vcconfig_use_defaults(const int debuglvl, vc_cnf *cnf)
 {
-    size_t  size = 0;
-    
     if(cnf == NULL)
     {
         (void)vrprint.error(-1, VR_INTERR, "parameter problem "
@@ -41,15 +39,6 @@ vcconfig_use_defaults(const int debuglvl, vc_cnf *cnf)
     cnf->logview_bufsize = DEFAULT_LOGVIEW_BUFFERSIZE;
     cnf->background = 0; /* blue */
 
-    size = strlcpy(cnf->iptrafvol_location, DEFAULT_IPTRAFVOL_LOCATION,
-        sizeof(cnf->iptrafvol_location));
-    if(size >= sizeof(cnf->iptrafvol_location))
-    {
-        (void)vrprint.error(-1, "Error", "buffer overflow (in: %s:%d).",
-                __FUNC__, __LINE__);
-        return(-1);
-    }
-
     return(0);
 }
 
@@ -64,7 +53,6 @@ init_vcconfig(const int debuglvl, char *configfile_location, vc_cnf *cnf)
             result = 0;
     char    answer[32] = "";
     FILE    *fp = NULL;
-    size_t  size = 0;
 
 
     /* safety first */
@@ -187,34 +175,6 @@ init_vcconfig(const int debuglvl, char *configfile_location, vc_cnf *cnf)
         return(VR_CNF_E_UNKNOWN_ERR);
 
 
-    /* IPTRAFVOL */
-    result = ask_configfile(debuglvl, &conf, "IPTRAFVOL", cnf->iptrafvol_location, configfile_location, sizeof(cnf->iptrafvol_location));
-    if(result == 1)
-    {
-        /* ok */
-    }
-    else if(result == 0)
-    {
-        (void)vrprint.debug(__FUNC__, "Variable IPTRAFVOL not found in '%s', using default value: %s",
-                        configfile_location,
-                        DEFAULT_IPTRAFVOL_LOCATION);
-
-        size = strlcpy(cnf->iptrafvol_location, DEFAULT_IPTRAFVOL_LOCATION,
-            sizeof(cnf->iptrafvol_location));
-        if(size >= sizeof(cnf->iptrafvol_location))
-        {
-            (void)vrprint.error(-1, "Error", "buffer overflow "
-                    "(in: %s:%d).", __FUNC__, __LINE__);
-            return(-1);
-        }
-    }
-    else
-        return(VR_CNF_E_UNKNOWN_ERR);
-
-    sanitize_path(debuglvl, cnf->iptrafvol_location,
-            sizeof(cnf->iptrafvol_location));
-
-
     /* NEWRULE_LOG */
     result = ask_configfile(debuglvl, &conf, "NEWRULE_LOG", answer, configfile_location, sizeof(answer));
     if(result == 1)
@@ -375,9 +335,6 @@ write_vcconfigfile(const int debuglvl, char *file_location, vc_cnf *cnf)
     fprintf(fp, "# LOGVIEW_BUFSIZE sets the buffersize (in loglines) of the logviewer for scrolling back.\n");
     fprintf(fp, "LOGVIEW_BUFSIZE=\"%u\"\n\n", cnf->logview_bufsize);
 
-    fprintf(fp, "# The location of the iptrafvol.pl command.\n");
-    fprintf(fp, "IPTRAFVOL=\"%s\"\n\n", cnf->iptrafvol_location);
-
     fprintf(fp, "# Background color: blue or black.\n");
     fprintf(fp, "BACKGROUND=\"%s\"\n\n", cnf->background ? "black" : "blue");
 
@@ -1706,8 +1706,7 @@ struct
             *logview_bufsizefld,
             *advancedmodefld,
             *mainmenu_statusfld,
-            *backgroundfld,
-            *iptrafvollocfld;
+            *backgroundfld;
 
     char    number[8];
 
@@ -1721,7 +1720,7 @@ edit_vcconfig_init(const int debuglvl, int height, int width, int starty, int st
     int     rows = 0,
             cols = 0;
 
-    ConfigSection.n_fields = 7;
+    ConfigSection.n_fields = 6;
     ConfigSection.fields = (FIELD **)calloc(ConfigSection.n_fields + 1, sizeof(FIELD *));
 
     /* fields */
@@ -1733,8 +1732,6 @@ edit_vcconfig_init(const int debuglvl, int height, int width, int starty, int st
     VcConfig.mainmenu_statusfld  = (ConfigSection.fields[4] = new_field(1, 1,  7, 53, 0, 0));
     VcConfig.backgroundfld       = (ConfigSection.fields[5] = new_field(1, 1,  8, 53, 0, 0));
 
-    VcConfig.iptrafvollocfld     = (ConfigSection.fields[6] = new_field(1, 64, 11, 1, 0, 0));
-
     ConfigSection.fields[ConfigSection.n_fields] = NULL;
 
     /* create win & pan */
@@ -1763,7 +1760,6 @@ edit_vcconfig_init(const int debuglvl, int height, int width, int starty, int st
     set_field_buffer_wrap(debuglvl, VcConfig.advancedmodefld, 0, vccnf.advanced_mode ? "X" : " ");
     set_field_buffer_wrap(debuglvl, VcConfig.mainmenu_statusfld, 0, vccnf.draw_status ? "X" : " ");
     set_field_buffer_wrap(debuglvl, VcConfig.backgroundfld, 0, vccnf.background ? "X" : " ");
-    set_field_buffer_wrap(debuglvl, VcConfig.iptrafvollocfld, 0, vccnf.iptrafvol_location);
 
     /* set the field options */
     for(i = 0; i < ConfigSection.n_fields; i++)
@@ -1816,8 +1812,6 @@ edit_vcconfig_init(const int debuglvl, int height, int width, int starty, int st
     mvwprintw(ConfigSection.win, 9, 54, "[");
     mvwprintw(ConfigSection.win, 9, 56, "]");
 
-    mvwprintw(ConfigSection.win, 11, 2, gettext("iptrafvol.pl location (full path)"));
-
     return(0);
 }
 
@@ -1892,17 +1886,6 @@ edit_vcconfig_save(const int debuglvl)
                     vccnf.logview_bufsize = (unsigned int)bufsize;
                 }
             }
-            else if(ConfigSection.fields[i] == VcConfig.iptrafvollocfld)
-            {
-                /* synlimit */
-                if(!(copy_field2buf(vccnf.iptrafvol_location,
-                                    field_buffer(ConfigSection.fields[i], 0),
-                                    sizeof(vccnf.iptrafvol_location))))
-                    return(-1);
-
-                sanitize_path(debuglvl, vccnf.iptrafvol_location,
-                        StrLen(vccnf.iptrafvol_location));
-            }
             else
             {
                 (void)vrprint.error(-1, VR_INTERR, "unknown field.");
@@ -1972,8 +1955,7 @@ edit_vcconfig(const int debuglvl)
         not_defined = 0;
 
         if(cur == VcConfig.newrule_loglimitfld ||
-           cur == VcConfig.logview_bufsizefld ||
-           cur == VcConfig.iptrafvollocfld)
+           cur == VcConfig.logview_bufsizefld)
         {
             if(nav_field_simpletext(debuglvl, ConfigSection.form, ch) < 0)
                 not_defined = 1;
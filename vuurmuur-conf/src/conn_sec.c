@@ -28,6 +28,32 @@ static char ser_snprintf_str[32] = "",
             fromzone_snprintf_str[32] = "",
             tozone_snprintf_str[32] = "";
 
+/*  the row cache: what is on each line of the screen. A line is only
+    drawn again if the connection group on it changed, so a refresh
+    doesn't send the whole screen over a slow link again. */
+struct ConnRow_
+{
+    char                valid;      /* the fields below are on screen */
+    char                printed;    /* printed in this refresh */
+
+    char                sername[MAX_SERVICE];
+    char                fromname[MAX_HOST_NET_ZONE];
+    char                toname[MAX_HOST_NET_ZONE];
+    char                src_ip[46];
+    char                dst_ip[46];
+    int                 protocol;
+    int                 src_port;
+    int                 dst_port;
+    int                 cnt;
+    int                 connect_status;
+    int                 direction_status;
+    char                use_acc;
+    unsigned long long  to_src_bytes;
+    unsigned long long  to_dst_bytes;
+};
+static struct ConnRow_  *conn_rows = NULL;
+static int              conn_rows_n = 0;
+
 /* wrapper for strlcpy, that truncates a string a little nicer */
 static void
 copy_name(char *dst, char *src, size_t size)
@@ -49,6 +75,98 @@ copy_name(char *dst, char *src, size_t size)
     }
 }
 
+/* is 'cd_ptr' what is on the line of 'row'? */
+static int
+conn_row_equal(struct ConnRow_ *row, struct ConntrackData *cd_ptr)
+{
+    if(row->valid == FALSE)
+        return(0);
+
+    if(row->cnt != cd_ptr->cnt ||
+        row->connect_status != cd_ptr->connect_status ||
+        row->direction_status != cd_ptr->direction_status ||
+        row->use_acc != cd_ptr->use_acc ||
+        row->to_src_bytes != cd_ptr->to_src_bytes ||
+        row->to_dst_bytes != cd_ptr->to_dst_bytes ||
+        row->protocol != cd_ptr->protocol ||
+        row->src_port != cd_ptr->src_port ||
+        row->dst_port != cd_ptr->dst_port)
+        return(0);
+
+    if(strncmp(row->sername, cd_ptr->sername, sizeof(row->sername)) != 0 ||
+        strncmp(row->fromname, cd_ptr->fromname, sizeof(row->fromname)) != 0 ||
+        strncmp(row->toname, cd_ptr->toname, sizeof(row->toname)) != 0 ||
+        strncmp(row->src_ip, cd_ptr->src_ip, sizeof(row->src_ip)) != 0 ||
+        strncmp(row->dst_ip, cd_ptr->dst_ip, sizeof(row->dst_ip)) != 0)
+        return(0);
+
+    return(1);
+}
+
+
+static void
+conn_row_store(struct ConnRow_ *row, struct ConntrackData *cd_ptr)
+{
+    (void)strlcpy(row->sername, cd_ptr->sername, sizeof(row->sername));
+    (void)strlcpy(row->fromname, cd_ptr->fromname, sizeof(row->fromname));
+    (void)strlcpy(row->toname, cd_ptr->toname, sizeof(row->toname));
+    (void)strlcpy(row->src_ip, cd_ptr->src_ip, sizeof(row->src_ip));
+    (void)strlcpy(row->dst_ip, cd_ptr->dst_ip, sizeof(row->dst_ip));
+    row->protocol = cd_ptr->protocol;
+    row->src_port = cd_ptr->src_port;
+    row->dst_port = cd_ptr->dst_port;
+    row->cnt = cd_ptr->cnt;
+    row->connect_status = cd_ptr->connect_status;
+    row->direction_status = cd_ptr->direction_status;
+    row->use_acc = cd_ptr->use_acc;
+    row->to_src_bytes = cd_ptr->to_src_bytes;
+    row->to_dst_bytes = cd_ptr->to_dst_bytes;
+    row->valid = TRUE;
+}
+
+
+/*  conn_rows_reset
+
+    Forget what is on the screen, so every line is drawn again: for a
+    new layout or new column widths. The caller erases the window.
+*/
+static void
+conn_rows_reset(void)
+{
+    int i = 0;
+
+    for(i = 0; i < conn_rows_n; i++)
+    {
+        conn_rows[i].valid = FALSE;
+        conn_rows[i].printed = FALSE;
+    }
+}
+
+
+/*  conn_rows_clear_unused
+
+    Clears the lines that had a connection group on them in the last
+    refresh, but not in this one.
+*/
+static void
+conn_rows_clear_unused(WINDOW *local_win)
+{
+    int i = 0;
+
+    for(i = 0; i < conn_rows_n; i++)
+    {
+        if(conn_rows[i].printed == FALSE && conn_rows[i].valid == TRUE)
+        {
+            wmove(local_win, i, 0);
+            wclrtoeol(local_win);
+            conn_rows[i].valid = FALSE;
+        }
+
+        conn_rows[i].printed = FALSE;
+    }
+}
+
+
 /**
  *  \param acct print accounting is enabled
  */
@@ -105,8 +223,20 @@ print_connection(const int debuglvl, WINDOW *local_win,
         start_print = cnt;
     }
 
-    /* move cursor to new line */
-    mvwprintw(local_win, start_print, 0, "");
+    /* the same group as in the last refresh is on this line */
+    if(start_print >= 0 && start_print < conn_rows_n)
+    {
+        conn_rows[start_print].printed = TRUE;
+
+        if(conn_row_equal(&conn_rows[start_print], cd_ptr))
+            return(1);
+
+        conn_row_store(&conn_rows[start_print], cd_ptr);
+    }
+
+    /* move cursor to new line, and clear what was there */
+    wmove(local_win, start_print, 0);
+    wclrtoeol(local_win);
 
     if(connreq->group_conns == TRUE)
     {
@@ -720,6 +850,23 @@ connections_section(const int debuglvl, struct vuurmuur_config *cnf,
     int                 printed = 0;
     int                 print_accounting = 0;
 
+    /* what the screen was drawn with: if it changes the column widths
+       are computed again and the whole window is redrawn. Otherwise only
+       the lines that changed are. */
+    struct ConnLayout_
+    {
+        int sername_max;
+        int fromname_max;
+        int toname_max;
+        int print_accounting;
+        int group_conns;
+        int unknown_ip_as_net;
+        int sort_conn_status;
+        int sort_in_out_fwd;
+        int draw_acc_data;
+        int draw_details;
+    } layout, drawn;
+
     /* init filter */
     VR_connreq_setup(debuglvl, &connreq);
     connreq.group_conns = TRUE;
@@ -749,6 +896,19 @@ connections_section(const int debuglvl, struct vuurmuur_config *cnf,
     if(ct == NULL)
         return(-1);
 
+    /* one cached row per line, nothing drawn yet */
+    memset(&drawn, 0, sizeof(drawn));
+    drawn.sername_max = -1;
+    conn_rows_n = max_onscreen;
+    if(!(conn_rows = calloc((size_t)conn_rows_n, sizeof(struct ConnRow_))))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("calloc failed: %s (in: %s:%d)."),
+                strerror(errno), __FUNC__, __LINE__);
+        conn_rows_n = 0;
+        conn_free_ct(debuglvl, &ct, zones);
+        return(-1);
+    }
+
     draw_top_menu(debuglvl, top_win, gettext("Connections"),
             key_choices_n, key_choices, cmd_choices_n, cmd_choices);
 
@@ -779,9 +939,17 @@ connections_section(const int debuglvl, struct vuurmuur_config *cnf,
             else
                 print_accounting = 0;
 
-            update_draw_size(debuglvl, &connreq, max_width-2,
-                    ct->conn_stats.sername_max+1, ct->conn_stats.fromname_max+1,
-                    ct->conn_stats.toname_max+1);
+            memset(&layout, 0, sizeof(layout));
+            layout.sername_max = ct->conn_stats.sername_max;
+            layout.fromname_max = ct->conn_stats.fromname_max;
+            layout.toname_max = ct->conn_stats.toname_max;
+            layout.print_accounting = print_accounting;
+            layout.group_conns = connreq.group_conns;
+            layout.unknown_ip_as_net = connreq.unknown_ip_as_net;
+            layout.sort_conn_status = connreq.sort_conn_status;
+            layout.sort_in_out_fwd = connreq.sort_in_out_fwd;
+            layout.draw_acc_data = connreq.draw_acc_data;
+            layout.draw_details = connreq.draw_details;
 
             /* determine how many lines we can draw for each section */
             if(connreq.sort_conn_status)
@@ -807,9 +975,17 @@ connections_section(const int debuglvl, struct vuurmuur_config *cnf,
                 outgoing   = 0;
             }
 
-            /* clear screen */
-            if(control.print)
+            /* new layout: new column widths and clear screen */
+            if(control.print && memcmp(&layout, &drawn, sizeof(layout)) != 0)
+            {
+                update_draw_size(debuglvl, &connreq, max_width-2,
+                        ct->conn_stats.sername_max+1, ct->conn_stats.fromname_max+1,
+                        ct->conn_stats.toname_max+1);
+
                 werase(conn_win);
+                conn_rows_reset();
+                drawn = layout;
+            }
 
             if(control.print)
             {
@@ -936,6 +1112,9 @@ connections_section(const int debuglvl, struct vuurmuur_config *cnf,
                     }
                 }
 
+                /* clear the lines that are empty now */
+                conn_rows_clear_unused(conn_win);
+
                 /* print the seperators */
                 if(connreq.sort_conn_status)
                 {
@@ -1187,6 +1366,10 @@ connections_section(const int debuglvl, struct vuurmuur_config *cnf,
 
     conn_free_ct(debuglvl, &ct, zones);
 
+    free(conn_rows);
+    conn_rows = NULL;
+    conn_rows_n = 0;
+
     /* filter clean up */
     VR_connreq_cleanup(debuglvl, &connreq);
 
@@ -1217,45 +1400,105 @@ enum {
 };
 
 
-/* TODO move to lib */
-int
-kill_connection(const int debuglvl, char *cmd, char *srcip, char *dstip, int proto, int sp, int dp)
+/* shows how far we are in the status bar */
+static void
+kill_connections_progress(void *ctx, unsigned int done, unsigned int total)
 {
-    char cmd_sp_str[6] = "";
-    char cmd_dp_str[6] = "";
-    int result = 0;
+    status_print(status_win, gettext("Killing connections: %u of %u..."), done, total);
+}
 
-    snprintf(cmd_sp_str, sizeof(cmd_sp_str), "%d", sp);
-    snprintf(cmd_dp_str, sizeof(cmd_dp_str), "%d", dp);
 
-    if(proto == VR_PROTO_TCP)
-    {
-        char *args[] = { cmd,
-                         "-D", "-s", srcip,
-                         "-d", dstip,
-                         "-p", "tcp",
-                         "--orig-port-src", cmd_sp_str,
-                         "--orig-port-dst", cmd_dp_str,
-                        NULL };
-        result = libvuurmuur_exec_command(debuglvl, NULL, cmd, args, NULL);
-    }
-    else if(proto == VR_PROTO_UDP)
+/*  kill_connections_filters
+
+    Kills the connections matching 'filter' and reports the result.
+    'what' describes them for the audit log.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+kill_connections_filters(const int debuglvl, struct vuurmuur_config *cnf,
+        VR_ConnKillFilter *filter, unsigned int n, const char *what)
+{
+    VR_ConnKillStats    stats;
+    int                 result = 0;
+
+    result = conn_kill(debuglvl, cnf, filter, n, &stats,
+            kill_connections_progress, NULL);
+    status_print(status_win, "");
+
+    if(result < 0)
+        return(-1);
+
+    if(stats.killed > 0 || stats.failed > 0)
     {
-        char *args[] = { cmd,
-                         "-D", "-s", srcip,
-                         "-d", dstip,
-                         "-p", "udp",
-                         "--orig-port-src", cmd_sp_str,
-                         "--orig-port-dst", cmd_dp_str,
-                        NULL };
-        result = libvuurmuur_exec_command(debuglvl, NULL, cmd, args, NULL);
+        /* TRANSLATORS: example "killed 3 connection(s), 0 failed: 1.2.3.4 -> any" */
+        (void)vrprint.audit("%s %u %s, %u %s: %s", gettext("killed"), stats.killed,
+                gettext("connection(s)"), stats.failed, gettext("failed"), what);
     }
+
+    if(stats.killed == 0 && stats.failed == 0)
+        (void)vrprint.warning(VR_WARN,
+            gettext("all connections already gone, none killed."));
+    else if(stats.failed > 0 && stats.killed > 0)
+        (void)vrprint.warning(VR_WARN,
+            gettext("killing of %d out of %d connections failed."),
+            stats.failed, stats.killed + stats.failed);
+    else if(stats.failed > 0)
+        (void)vrprint.warning(VR_WARN,
+            gettext("killing of all %d connections failed."), stats.failed);
     else
+        (void)vrprint.info(VR_INFO, "%d connection(s) killed.", stats.killed);
+
+    return(0);
+}
+
+
+/* a filter for the flow(s) of 'cd_ptr' */
+static void
+kill_connections_filter_set(VR_ConnKillFilter *filter, struct ConntrackData *cd_ptr)
+{
+    memset(filter, 0, sizeof(*filter));
+
+    (void)strlcpy(filter->src_ip, cd_ptr->src_ip, sizeof(filter->src_ip));
+    /* for DNATted connections we use the orig_dst_ip */
+    (void)strlcpy(filter->dst_ip, cd_ptr->orig_dst_ip[0] ?
+            cd_ptr->orig_dst_ip : cd_ptr->dst_ip, sizeof(filter->dst_ip));
+    filter->protocol = cd_ptr->protocol;
+    filter->dst_port = cd_ptr->dst_port;
+
+    /*  a group is more than one flow, they only share the service
+        and the first flow's ip's. */
+    if(cd_ptr->cnt <= 1)
+        filter->src_port = cd_ptr->src_port;
+}
+
+
+int
+kill_connection(const int debuglvl, struct vuurmuur_config *cnf, char *srcip, char *dstip, int proto, int sp, int dp)
+{
+    VR_ConnKillFilter   filter;
+    VR_ConnKillStats    stats;
+    int                 result = 0;
+
+    if(proto != VR_PROTO_TCP && proto != VR_PROTO_UDP)
     {
         (void)vrprint.error(-1, VR_ERR, gettext("killing connections is only supported for TCP and UDP."));
         return(-1);
     }
 
+    memset(&filter, 0, sizeof(filter));
+    (void)strlcpy(filter.src_ip, srcip, sizeof(filter.src_ip));
+    (void)strlcpy(filter.dst_ip, dstip, sizeof(filter.dst_ip));
+    filter.protocol = proto;
+    filter.src_port = sp;
+    filter.dst_port = dp;
+
+    if(conn_kill(debuglvl, cnf, &filter, 1, &stats, NULL, NULL) < 0 ||
+        stats.failed > 0)
+        result = -1;
+
     /* TRANSLATORS: example "killed connection: 1.2.3.4:5678 -> 8.7.6.5:4321 (6)" */
     (void)vrprint.audit("%s: %s:%d -> %s:%d (%d)", result ? gettext("failed to kill connection") : gettext("killed connection"), srcip, sp, dstip, dp, proto);
     return(result);
@@ -1269,18 +1512,22 @@ kill_connections_by_name(const int debuglvl, struct vuurmuur_config *cnf,
 {
     d_list_node             *d_node = NULL;
     struct ConntrackData    *cd_ptr = NULL;
-    int                     cnt = 0,
-                            failed = 0;
-    char                    *dip = NULL;
+    VR_ConnKillFilter       *filter = NULL;
+    unsigned int            n = 0;
+    char                    what[256] = "";
+    int                     result = 0;
 
-    /* check if the conntrack tool is set */
-    if(cnf->conntrack_location[0] == '\0')
+    if(ct->conn_list.len == 0)
     {
-        (void)vrprint.error(-1, VR_ERR, gettext("'conntrack' location "
-            "not set. To be able to kill connections, set the "
-            "location of the 'conntrack' tool in 'Vuurmuur Options "
-            "-> General'. Note that the tool requires kernel "
-            "version 2.6.14 or higher."));
+        (void)vrprint.warning(VR_WARN,
+            gettext("all connections already gone, none killed."));
+        return(0);
+    }
+
+    if(!(filter = calloc(ct->conn_list.len, sizeof(VR_ConnKillFilter))))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("calloc failed: %s (in: %s:%d)."),
+                strerror(errno), __FUNC__, __LINE__);
         return(-1);
     }
 
@@ -1292,46 +1539,24 @@ kill_connections_by_name(const int debuglvl, struct vuurmuur_config *cnf,
                 cd_ptr->fromname, cd_ptr->toname,
                 cd_ptr->sername, cd_ptr->cnt);
 
-        if(srcname == NULL || strcmp(srcname, cd_ptr->fromname) == 0)
-        {
-            if(dstname == NULL || strcmp(dstname, cd_ptr->toname) == 0)
-            {
-                /* for DNATted connections we use the
-                   orig_dst_ip */
-                dip = cd_ptr->orig_dst_ip[0] ?
-                    cd_ptr->orig_dst_ip : cd_ptr->dst_ip;
-
-                if(sername == NULL || strcmp(sername, cd_ptr->sername) == 0)
-                {
-                    if(connect_status == CONN_UNUSED || connect_status == cd_ptr->connect_status) {
-                            if(kill_connection(debuglvl, cnf->conntrack_location,
-                            cd_ptr->src_ip,  dip,
-                            cd_ptr->protocol, cd_ptr->src_port,
-                            cd_ptr->dst_port) == -1)
-                        {
-                            failed++;
-                        }
+        if(srcname != NULL && strcmp(srcname, cd_ptr->fromname) != 0)
+            continue;
+        if(dstname != NULL && strcmp(dstname, cd_ptr->toname) != 0)
+            continue;
+        if(sername != NULL && strcmp(sername, cd_ptr->sername) != 0)
+            continue;
+        if(connect_status != CONN_UNUSED && connect_status != cd_ptr->connect_status)
+            continue;
 
-                        cnt++;
-                    }
-                }
-            }
-        }
+        kill_connections_filter_set(&filter[n++], cd_ptr);
     }
 
-    if(cnt == 0)
-        (void)vrprint.warning(VR_WARN,
-            gettext("all connections already gone, none killed."));
-    else if(failed > 0 && failed != cnt)
-        (void)vrprint.warning(VR_WARN,
-            gettext("killing of %d out of %d connections failed."), failed, cnt);
-    else if(failed > 0)
-        (void)vrprint.warning(VR_WARN,
-            gettext("killing of all %d connections failed."), failed);
-    else
-        (void)vrprint.info(VR_INFO, "%d connection(s) killed.", cnt);
+    snprintf(what, sizeof(what), "%s -> %s (%s)", srcname ? srcname : "any",
+            dstname ? dstname : "any", sername ? sername : "any");
 
-    return(0);
+    result = kill_connections_filters(debuglvl, cnf, filter, n, what);
+    free(filter);
+    return(result);
 }
 
 
@@ -1342,66 +1567,64 @@ kill_connections_by_ip(const int debuglvl, struct vuurmuur_config *cnf,
 {
     d_list_node             *d_node = NULL;
     struct ConntrackData    *cd_ptr = NULL;
-    int                     cnt = 0,
-                            failed = 0;
-    char                    *dip = NULL;
+    VR_ConnKillFilter       *filter = NULL;
+    unsigned int            n = 0;
+    char                    what[256] = "";
+    int                     result = 0;
+
+    snprintf(what, sizeof(what), "%s -> %s (%s)", srcip ? srcip : "any",
+            dstip ? dstip : "any", sername ? sername : "any");
+
+    /*  all connections of the ip's: let conntrack find them, so we
+        also get the ones that are not in our list (anymore). */
+    if(sername == NULL && connect_status == CONN_UNUSED)
+    {
+        VR_ConnKillFilter   ip_filter;
+
+        memset(&ip_filter, 0, sizeof(ip_filter));
+        if(srcip != NULL)
+            (void)strlcpy(ip_filter.src_ip, srcip, sizeof(ip_filter.src_ip));
+        if(dstip != NULL)
+            (void)strlcpy(ip_filter.dst_ip, dstip, sizeof(ip_filter.dst_ip));
+
+        return(kill_connections_filters(debuglvl, cnf, &ip_filter, 1, what));
+    }
 
-    /* check if the conntrack tool is set */
-    if(cnf->conntrack_location[0] == '\0')
+    if(ct->conn_list.len == 0)
     {
-        (void)vrprint.error(-1, VR_ERR, gettext("'conntrack' location "
-            "not set. To be able to kill connections, set the "
-            "location of the 'conntrack' tool in 'Vuurmuur Options "
-            "-> General'. Note that the tool requires kernel "
-            "version 2.6.14 or higher."));
+        (void)vrprint.warning(VR_WARN,
+            gettext("all connections already gone, none killed."));
+        return(0);
+    }
+
+    if(!(filter = calloc(ct->conn_list.len, sizeof(VR_ConnKillFilter))))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("calloc failed: %s (in: %s:%d)."),
+                strerror(errno), __FUNC__, __LINE__);
         return(-1);
     }
 
     for(d_node = ct->conn_list.top; d_node; d_node = d_node->next)
     {
         cd_ptr = d_node->data;
-    
-        if(srcip == NULL || strcmp(srcip, cd_ptr->src_ip) == 0)
-        {
-            if(  dstip == NULL ||
-                (cd_ptr->orig_dst_ip[0] == '\0' && strcmp(dstip, cd_ptr->dst_ip) == 0) ||
-                (cd_ptr->orig_dst_ip[0] != '\0' && strcmp(dstip, cd_ptr->orig_dst_ip) == 0))
-            {
-                /* for DNATted connections we use the
-                orig_dst_ip */
-                dip = cd_ptr->orig_dst_ip[0] ?
-                    cd_ptr->orig_dst_ip : cd_ptr->dst_ip;
 
-                if(sername == NULL || strcmp(sername, cd_ptr->sername) == 0)
-                {
-                    if(connect_status == CONN_UNUSED || connect_status == cd_ptr->connect_status) {
-                        if(kill_connection(debuglvl, cnf->conntrack_location,
-                            cd_ptr->src_ip, dip, cd_ptr->protocol,
-                            cd_ptr->src_port, cd_ptr->dst_port) == -1)
-                        {
-                            failed++;
-                        }
-
-                        cnt++;
-                    }
-                }
-            }
-        }
+        if(srcip != NULL && strcmp(srcip, cd_ptr->src_ip) != 0)
+            continue;
+        if(dstip != NULL &&
+            ((cd_ptr->orig_dst_ip[0] == '\0' && strcmp(dstip, cd_ptr->dst_ip) != 0) ||
+             (cd_ptr->orig_dst_ip[0] != '\0' && strcmp(dstip, cd_ptr->orig_dst_ip) != 0)))
+            continue;
+        if(sername != NULL && strcmp(sername, cd_ptr->sername) != 0)
+            continue;
+        if(connect_status != CONN_UNUSED && connect_status != cd_ptr->connect_status)
+            continue;
+
+        kill_connections_filter_set(&filter[n++], cd_ptr);
     }
 
-    if(cnt == 0)
-        (void)vrprint.warning(VR_WARN,
-            gettext("all connections already gone, none killed."));
-    else if(failed > 0 && failed != cnt)
-        (void)vrprint.warning(VR_WARN,
-            gettext("killing of %d out of %d connections failed."), failed, cnt);
-    else if(failed > 0)
-        (void)vrprint.warning(VR_WARN,
-            gettext("killing of all %d connections failed."), failed);
-    else
-        (void)vrprint.info(VR_INFO, "%d connection(s) killed.", cnt);
-
-    return(0);
+    result = kill_connections_filters(debuglvl, cnf, filter, n, what);
+    free(filter);
+    return(result);
 }
 
 /*
@@ -1420,6 +1643,7 @@ block_and_kill(const int debuglvl, Conntrack *ct, Zones *zones,
         BlockList *blocklist, Interfaces *interfaces, char *ip)
 {
     struct InterfaceData_   *iface_ptr = NULL;
+    VR_ConnKillFilter       filter[2];
 
     VrBusyWinShow();
 
@@ -1459,14 +1683,14 @@ block_and_kill(const int debuglvl, Conntrack *ct, Zones *zones,
     /* apply the changes */
     vc_apply_changes(debuglvl);
 
-    /*  if we don't support killing connections we are happy with
-        only blocking as well */
-    if(conf.conntrack_location[0] != '\0')
-    {
-        /* kill all connections for this ip */
-        kill_connections_by_ip(debuglvl, &conf, ct, NULL, ip, NULL, CONN_UNUSED);
-        kill_connections_by_ip(debuglvl, &conf, ct, ip, NULL, NULL, CONN_UNUSED);
-    }
+    /*  kill all connections for this ip, to and from it in one go.
+        conn_kill uses ctnetlink, or the conntrack tool if that is not
+        available. If we can't kill connections we are happy with only
+        blocking as well. */
+    memset(filter, 0, sizeof(filter));
+    (void)strlcpy(filter[0].src_ip, ip, sizeof(filter[0].src_ip));
+    (void)strlcpy(filter[1].dst_ip, ip, sizeof(filter[1].dst_ip));
+    (void)kill_connections_filters(debuglvl, &conf, filter, 2, ip);
 
     VrBusyWinHide();
     return(0);
@@ -190,7 +190,9 @@ struct ShapeIfaceCnf_ {
     struct InterfaceData_ *iface_ptr;
     char in[10], out[10];
     char in_unit[5], out_unit[5];
+    char leaf[16];
     char enabled;
+    char offload;
 };
 
 static int
@@ -201,6 +203,8 @@ VrShapeIfaceSetup(const int debuglvl, struct ShapeIfaceCnf_ *c, struct Interface
     c->iface_ptr = iface_ptr;
 
     c->enabled = iface_ptr->shape;
+    c->offload = iface_ptr->shape_offload;
+    strlcpy(c->leaf, iface_ptr->shape_leaf, sizeof(c->leaf));
 
     snprintf(c->in, sizeof(c->in),   "%u", c->iface_ptr->bw_in);
     snprintf(c->out, sizeof(c->out), "%u", c->iface_ptr->bw_out);
@@ -327,6 +331,53 @@ VrShapeIfaceSave(const int debuglvl, void *ctx, char *name, char *value)
                 STR_WAS, c->enabled ? "Yes" : "No");
         }
         c->iface_ptr->shape = enabled;
+    } else if(strcmp(name,"leaf") == 0) {
+        if (strcmp(value, "") != 0 && libvuurmuur_is_shape_leaf(debuglvl, value) == 0) {
+            (void)vrprint.error(-1, VR_ERR, gettext("'%s' is not a valid leaf qdisc. Use sfq, fq_codel, cake or fq."), value);
+            return(-1);
+        }
+
+        if (strcmp(value, c->iface_ptr->shape_leaf) != 0) {
+            result = af->tell(debuglvl, ifac_backend, c->iface_ptr->name, "SHAPE_LEAF", value, 1, TYPE_INTERFACE);
+            if(result < 0)
+            {
+                (void)vrprint.error(-1, VR_ERR, "%s (in: %s:%d).",
+                    STR_SAVING_TO_BACKEND_FAILED,
+                    __FUNC__, __LINE__);
+                return(-1);
+            }
+
+            /* example: "interface 'lan' has been changed: active is now set to 'Yes' (was: 'No')." */
+            (void)vrprint.audit("%s '%s' %s: %s %s '%s' (%s: '%s').",
+                STR_INTERFACE, c->iface_ptr->name, STR_HAS_BEEN_CHANGED,
+                STR_SHAPE_LEAF, STR_IS_NOW_SET_TO, value,
+                STR_WAS, c->iface_ptr->shape_leaf);
+        }
+        strlcpy(c->iface_ptr->shape_leaf, value, sizeof(c->iface_ptr->shape_leaf));
+    } else if(strcmp(name,"O") == 0) {
+        char offload = 0;
+
+        if (strcmp(value,"X") == 0) {
+            offload = 1;
+        }
+
+        if (c->offload != offload) {
+            result = af->tell(debuglvl, ifac_backend, c->iface_ptr->name, "SHAPE_OFFLOAD", offload ? "Yes" : "No", 1, TYPE_INTERFACE);
+            if(result < 0)
+            {
+                (void)vrprint.error(-1, VR_ERR, "%s (in: %s:%d).",
+                    STR_SAVING_TO_BACKEND_FAILED,
+                    __FUNC__, __LINE__);
+                return(-1);
+            }
+
+            /* example: "interface 'lan' has been changed: active is now set to 'Yes' (was: 'No')." */
+            (void)vrprint.audit("%s '%s' %s: %s %s '%s' (%s: '%s').",
+                STR_INTERFACE, c->iface_ptr->name, STR_HAS_BEEN_CHANGED,
+                STR_SHAPE_OFFLOAD, STR_IS_NOW_SET_TO, offload ? "Yes" : "No",
+                STR_WAS, c->offload ? "Yes" : "No");
+        }
+        c->iface_ptr->shape_offload = offload;
     }
 
     return(0);
@@ -345,7 +396,7 @@ void VrShapeIface(const int debuglvl, struct InterfaceData_ *iface_ptr) {
     }
 
     /* create the window and put it in the middle of the screen */
-    win = VrNewWin(11,51,0,0,vccnf.color_win);
+    win = VrNewWin(15,51,0,0,vccnf.color_win);
     if(win == NULL)
     {
         (void)vrprint.error(-1, VR_ERR, "VrNewWin failed");
@@ -353,7 +404,7 @@ void VrShapeIface(const int debuglvl, struct InterfaceData_ *iface_ptr) {
     }
     VrWinSetTitle(win, gettext("Shaping"));
 
-    form = VrNewForm(9, 58, 1, 1, 9, vccnf.color_win, vccnf.color_win_rev | A_BOLD);
+    form = VrNewForm(13, 58, 1, 1, 14, vccnf.color_win, vccnf.color_win_rev | A_BOLD);
 
     VrFormSetSaveFunc(debuglvl, form, VrShapeIfaceSave, &config);
 
@@ -365,6 +416,10 @@ void VrShapeIface(const int debuglvl, struct InterfaceData_ *iface_ptr) {
     VrFormAddLabelField(debuglvl,   form, 1, 25, 5, 1,  vccnf.color_win, gettext("Outgoing bandwidth"));
     VrFormAddTextField(debuglvl,    form, 1, 10, 5, 28, vccnf.color_win_rev | A_BOLD, "out", config.out);
     VrFormAddTextField(debuglvl,    form, 1,  5, 5, 41, vccnf.color_win_rev | A_BOLD, "unit2", config.out_unit);
+    VrFormAddLabelField(debuglvl,   form, 1, 25, 7, 1,  vccnf.color_win, gettext("Leaf qdisc"));
+    VrFormAddTextField(debuglvl,    form, 1, 10, 7, 28, vccnf.color_win_rev | A_BOLD, "leaf", config.leaf);
+    VrFormAddLabelField(debuglvl,   form, 1, 25, 9, 1,  vccnf.color_win, gettext("Offload to the nic"));
+    VrFormAddCheckboxField(debuglvl,form,        9, 28, vccnf.color_win, "O", config.offload);
 
     VrFormConnectToWin(debuglvl, form, win);
 
@@ -1798,6 +1853,8 @@ rename_interface(const int debuglvl, Interfaces *interfaces, Zones *zones,
         (void)vrprint.error(-1, VR_INTERR, "buffer overflow (in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
     }
+    if(interfaces_rehash(debuglvl, interfaces, iface_ptr, save_name) < 0)
+        return(-1);
     iface_ptr = NULL;
 
     /* update references in the networks */
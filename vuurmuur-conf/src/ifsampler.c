@@ -0,0 +1,371 @@
+/***************************************************************************
+ *   Copyright (C) 2003-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "main.h"
+
+/*  Interface counter sampler
+
+    The status section used to open /proc/net/dev once per interface and
+    run 'iptables -vnL' three times per interface on every update. The
+    sampler instead reads /proc/net/dev once and takes one iptables-save
+    snapshot per tick for all interfaces, and keeps the last
+    IFACE_SAMPLER_RING samples of every interface so rates (and anything
+    drawing a history) can be computed from memory.
+*/
+
+
+static void
+iface_sampler_free_samples(void *data)
+{
+    free(data);
+}
+
+
+/*  iface_sampler_setup
+
+    Creates one ring for every real (non virtual) device in 'interfaces'.
+    Devices used by more than one interface get a single ring.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+iface_sampler_setup(const int debuglvl, IfaceSampler *sampler, Interfaces *interfaces)
+{
+    struct InterfaceData_   *iface_ptr = NULL;
+    IfaceSamples            *samples_ptr = NULL;
+    d_list_node             *d_node = NULL;
+
+    /* safety */
+    if(sampler == NULL || interfaces == NULL)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    memset(sampler, 0, sizeof(IfaceSampler));
+
+    if(d_list_setup(debuglvl, &sampler->list, iface_sampler_free_samples) < 0)
+        return(-1);
+
+    for(d_node = interfaces->list.top; d_node; d_node = d_node->next)
+    {
+        iface_ptr = d_node->data;
+
+        if(iface_ptr->device_virtual == TRUE || iface_ptr->device[0] == '\0')
+            continue;
+
+        /* already sampling this device */
+        if(iface_sampler_get(debuglvl, sampler, iface_ptr->device) != NULL)
+            continue;
+
+        if(!(samples_ptr = malloc(sizeof(IfaceSamples))))
+        {
+            (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."),
+                    strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+        memset(samples_ptr, 0, sizeof(IfaceSamples));
+
+        (void)strlcpy(samples_ptr->device, iface_ptr->device,
+                sizeof(samples_ptr->device));
+
+        if(d_list_append(debuglvl, &sampler->list, samples_ptr) == NULL)
+        {
+            (void)vrprint.error(-1, VR_INTERR, "d_list_append() failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            free(samples_ptr);
+            return(-1);
+        }
+    }
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "sampling %u devices.", sampler->list.len);
+
+    return(0);
+}
+
+
+void
+iface_sampler_cleanup(const int debuglvl, IfaceSampler *sampler)
+{
+    if(sampler == NULL)
+        return;
+
+    d_list_cleanup(debuglvl, &sampler->list);
+}
+
+
+/*  iface_sampler_get
+
+    Returns the ring of 'device', or NULL if we don't sample it.
+*/
+IfaceSamples *
+iface_sampler_get(const int debuglvl, IfaceSampler *sampler, const char *device)
+{
+    IfaceSamples    *samples_ptr = NULL;
+    d_list_node     *d_node = NULL;
+
+    if(sampler == NULL || device == NULL)
+        return(NULL);
+
+    for(d_node = sampler->list.top; d_node; d_node = d_node->next)
+    {
+        samples_ptr = d_node->data;
+
+        if(strcmp(samples_ptr->device, device) == 0)
+            return(samples_ptr);
+    }
+
+    return(NULL);
+}
+
+
+/*  iface_sampler_sample
+
+    Returns the sample taken 'back' ticks ago, 0 being the newest, or
+    NULL if the ring doesn't go back that far.
+*/
+IfaceSample *
+iface_sampler_sample(IfaceSamples *samples_ptr, unsigned int back)
+{
+    if(samples_ptr == NULL || back >= samples_ptr->count)
+        return(NULL);
+
+    return(&samples_ptr->ring[(samples_ptr->head + IFACE_SAMPLER_RING - back) % IFACE_SAMPLER_RING]);
+}
+
+
+/*  iface_sampler_read_proc
+
+    Reads /proc/net/dev once and stores the byte and packet counters in
+    'cur' of every device we sample.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+iface_sampler_read_proc(const int debuglvl, IfaceSampler *sampler, IfaceSample *cur)
+{
+    char            proc_net_dev[] = "/proc/net/dev",
+                    line[256] = "";
+    char            *name = NULL,
+                    *colon = NULL;
+    FILE            *fp = NULL;
+    IfaceSamples    *samples_ptr = NULL;
+    unsigned int    i = 0;
+    d_list_node     *d_node = NULL;
+    unsigned long long  recv_bytes = 0,
+                        recv_packets = 0,
+                        trans_bytes = 0,
+                        trans_packets = 0;
+
+    if(!(fp = fopen(proc_net_dev, "r")))
+    {
+        (void)vrprint.error(-1, VR_INTERR, "unable to open '%s': %s (in: %s:%d).",
+                proc_net_dev, strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    while(fgets(line, (int)sizeof(line), fp) != NULL)
+    {
+        /*  lo: 3335005   17735 ...
+            eth0:1055472756 4679465 ...
+
+            the bytes may be glued to the colon, so split on it.
+        */
+        if(!(colon = strchr(line, ':')))
+            continue;
+        *colon = '\0';
+
+        for(name = line; *name == ' '; name++);
+
+        if(sscanf(colon + 1, "%llu %llu %*u %*u %*u %*u %*u %*u %llu %llu",
+                &recv_bytes, &recv_packets, &trans_bytes, &trans_packets) != 4)
+            continue;
+
+        for(i = 0, d_node = sampler->list.top; d_node; d_node = d_node->next, i++)
+        {
+            samples_ptr = d_node->data;
+
+            if(strcmp(samples_ptr->device, name) == 0)
+            {
+                cur[i].found = TRUE;
+                cur[i].recv_bytes = recv_bytes;
+                cur[i].recv_packets = recv_packets;
+                cur[i].trans_bytes = trans_bytes;
+                cur[i].trans_packets = trans_packets;
+                break;
+            }
+        }
+    }
+
+    if(fclose(fp) < 0)
+        return(-1);
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "read %s.", proc_net_dev);
+
+    return(0);
+}
+
+
+/*  iface_sampler_update
+
+    Takes one sample of all devices: one pass over /proc/net/dev and,
+    if 'ipt' is TRUE, one iptables counter snapshot of the filter table.
+    If getting the snapshot fails (no iptables-save, not root, nftables)
+    it is reported once and only the /proc counters are used from then
+    on.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+iface_sampler_update(const int debuglvl, struct vuurmuur_config *cnf, IfaceSampler *sampler, char ipt)
+{
+    IfaceSample     *cur = NULL;
+    IfaceSamples    *samples_ptr = NULL;
+    IptCounters     counters;
+    d_list_node     *d_node = NULL;
+    unsigned int    i = 0;
+    unsigned long long  tmp_ull = 0;
+    struct timeval  tv;
+    int             retval = 0;
+
+    /* safety */
+    if(cnf == NULL || sampler == NULL)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(sampler->list.len == 0)
+        return(0);
+
+    /* build the new samples aside, the rings are only advanced when done */
+    if(!(cur = calloc(sampler->list.len, sizeof(IfaceSample))))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."),
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(iface_sampler_read_proc(debuglvl, sampler, cur) < 0)
+        retval = -1;
+
+    /* all devices share the same timestamp */
+    gettimeofday(&tv, 0);
+
+    if(retval == 0 && ipt == TRUE && sampler->ipt_failed == FALSE)
+    {
+        if(ipt_counters_load(debuglvl, cnf, &counters, VR_IPV4, "filter") < 0)
+        {
+            (void)vrprint.info(VR_INFO, gettext("iptables counters not available, "
+                    "only using the interface counters."));
+            sampler->ipt_failed = TRUE;
+        }
+        else
+        {
+            for(i = 0, d_node = sampler->list.top; d_node; d_node = d_node->next, i++)
+            {
+                samples_ptr = d_node->data;
+
+                (void)ipt_counters_get_iface(debuglvl, &counters, samples_ptr->device, "INPUT",
+                        &cur[i].recv_host_packets, &cur[i].recv_host, &tmp_ull, &tmp_ull);
+                (void)ipt_counters_get_iface(debuglvl, &counters, samples_ptr->device, "OUTPUT",
+                        &tmp_ull, &tmp_ull, &cur[i].send_host_packets, &cur[i].send_host);
+                (void)ipt_counters_get_iface(debuglvl, &counters, samples_ptr->device, "FORWARD",
+                        &cur[i].recv_net_packets, &cur[i].recv_net,
+                        &cur[i].send_net_packets, &cur[i].send_net);
+            }
+        }
+        ipt_counters_cleanup(debuglvl, &counters);
+    }
+
+    if(retval == 0)
+    {
+        for(i = 0, d_node = sampler->list.top; d_node; d_node = d_node->next, i++)
+        {
+            samples_ptr = d_node->data;
+
+            cur[i].tv = tv;
+
+            if(samples_ptr->count > 0)
+                samples_ptr->head = (samples_ptr->head + 1) % IFACE_SAMPLER_RING;
+            if(samples_ptr->count < IFACE_SAMPLER_RING)
+                samples_ptr->count++;
+
+            samples_ptr->ring[samples_ptr->head] = cur[i];
+        }
+    }
+
+    free(cur);
+    return(retval);
+}
+
+
+/*  iface_sampler_rate
+
+    Calculates the average receive and transmit speed in bytes per second
+    of 'samples_ptr' over the last 'ticks' samples.
+
+    Returncodes:
+         0: ok
+        -1: not enough samples (yet)
+*/
+int
+iface_sampler_rate(IfaceSamples *samples_ptr, unsigned int ticks, double *recv_speed, double *send_speed)
+{
+    IfaceSample *new_ptr = NULL,
+                *old_ptr = NULL;
+    double      elapse = 0;
+
+    if(recv_speed != NULL)
+        *recv_speed = 0;
+    if(send_speed != NULL)
+        *send_speed = 0;
+
+    if(ticks == 0 ||
+        !(new_ptr = iface_sampler_sample(samples_ptr, 0)) ||
+        !(old_ptr = iface_sampler_sample(samples_ptr, ticks)))
+        return(-1);
+
+    if(new_ptr->found == FALSE || old_ptr->found == FALSE)
+        return(-1);
+
+    elapse  = (double)new_ptr->tv.tv_sec + (double)new_ptr->tv.tv_usec * 1e-6;
+    elapse -= (double)old_ptr->tv.tv_sec + (double)old_ptr->tv.tv_usec * 1e-6;
+    if(elapse <= 0)
+        return(-1);
+
+    /* counters may have been reset, e.g. by a driver reload */
+    if(recv_speed != NULL && new_ptr->recv_bytes >= old_ptr->recv_bytes)
+        *recv_speed = (double)(new_ptr->recv_bytes - old_ptr->recv_bytes) / elapse;
+    if(send_speed != NULL && new_ptr->trans_bytes >= old_ptr->trans_bytes)
+        *send_speed = (double)(new_ptr->trans_bytes - old_ptr->trans_bytes) / elapse;
+
+    return(0);
+}
@@ -0,0 +1,212 @@
+/***************************************************************************
+ *   Copyright (C) 2003-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "main.h"
+
+/*  Ring of log lines
+
+    The logview keeps the last 'size' lines of a log. Every line used to
+    be a malloc'd struct in a d_list, with the oldest freed for every new
+    line once the buffer was full. A LogRing allocates everything once: a
+    ring of small records and an arena the raw lines are copied into. The
+    arena is used as a circular buffer as well. A line is always stored
+    in one piece: if it doesn't fit before the end of the arena we
+    continue at the start. Adding a line drops the oldest lines until
+    there is room for it.
+
+    The arena is sized for lines of LOGRING_AVG_LINE bytes. If the lines
+    are longer on average the ring holds fewer than 'size' lines.
+*/
+
+#define LOGRING_AVG_LINE    384
+/* the arena can at least hold this many lines of the maximum length */
+#define LOGRING_MIN_LINES   16
+
+
+/*  logring_setup
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+logring_setup(const int debuglvl, LogRing *ring, unsigned int size)
+{
+    /* safety */
+    if(ring == NULL || size == 0)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    memset(ring, 0, sizeof(LogRing));
+
+    ring->size = size;
+    ring->arena_size = (size_t)size * LOGRING_AVG_LINE;
+    if(ring->arena_size < LOGRING_MIN_LINES * LOGRING_MAX_LINE)
+        ring->arena_size = LOGRING_MIN_LINES * LOGRING_MAX_LINE;
+
+    if(!(ring->records = malloc(size * sizeof(LogRingRecord))) ||
+        !(ring->arena = malloc(ring->arena_size)))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."),
+                strerror(errno), __FUNC__, __LINE__);
+        logring_cleanup(ring);
+        return(-1);
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "%u lines, arena %lu bytes.",
+                size, (unsigned long)ring->arena_size);
+
+    return(0);
+}
+
+
+void
+logring_cleanup(LogRing *ring)
+{
+    if(ring == NULL)
+        return;
+
+    free(ring->records);
+    free(ring->arena);
+    memset(ring, 0, sizeof(LogRing));
+}
+
+
+/*  logring_clear
+
+    Drops all lines, the memory is kept.
+*/
+void
+logring_clear(LogRing *ring)
+{
+    if(ring == NULL)
+        return;
+
+    ring->head = 0;
+    ring->len = 0;
+    ring->arena_write = 0;
+}
+
+
+/*  logring_get
+
+    Returns line 'i' of the ring, 0 being the oldest.
+*/
+LogRingRecord *
+logring_get(LogRing *ring, unsigned int i)
+{
+    if(ring == NULL || i >= ring->len)
+        return(NULL);
+
+    return(&ring->records[(ring->head + i) % ring->size]);
+}
+
+
+static void
+logring_drop_oldest(LogRing *ring)
+{
+    ring->head = (ring->head + 1) % ring->size;
+    ring->len--;
+}
+
+
+/*  logring_add
+
+    Copies 'line' into the ring, dropping the oldest lines if needed.
+    Lines longer than LOGRING_MAX_LINE - 1 are cut.
+
+    Returns the new record.
+*/
+LogRingRecord *
+logring_add(LogRing *ring, const char *line)
+{
+    LogRingRecord   *rec = NULL;
+    size_t          len = 0,
+                    need = 0,
+                    oldest = 0;
+
+    if(ring == NULL || line == NULL || ring->records == NULL)
+        return(NULL);
+
+    len = strlen(line);
+    if(len > LOGRING_MAX_LINE - 1)
+        len = LOGRING_MAX_LINE - 1;
+    need = len + 1;
+
+    if(ring->len == ring->size)
+        logring_drop_oldest(ring);
+
+    /*  the lines are in the arena in the order of the ring: from the
+        oldest up to arena_write, possibly wrapping around the end */
+    while(ring->len > 0)
+    {
+        oldest = ring->records[ring->head].offset;
+
+        if(ring->arena_write > oldest)
+        {
+            /* free from arena_write to the end and before the oldest */
+            if(ring->arena_write + need <= ring->arena_size)
+                break;
+
+            ring->arena_write = 0;
+        }
+        else
+        {
+            /* free from arena_write up to the oldest */
+            if(oldest - ring->arena_write >= need)
+                break;
+
+            logring_drop_oldest(ring);
+        }
+    }
+    if(ring->len == 0)
+        ring->arena_write = 0;
+
+    rec = &ring->records[(ring->head + ring->len) % ring->size];
+    rec->offset = (unsigned int)ring->arena_write;
+    rec->len = (unsigned short)len;
+    rec->filtered = 0;
+
+    memcpy(ring->arena + ring->arena_write, line, len);
+    ring->arena[ring->arena_write + len] = '\0';
+
+    ring->arena_write += need;
+    ring->len++;
+
+    return(rec);
+}
+
+
+/*  logring_line
+
+    The line of a record. It is valid until the record is dropped.
+*/
+char *
+logring_line(LogRing *ring, LogRingRecord *rec)
+{
+    if(ring == NULL || rec == NULL)
+        return(NULL);
+
+    return(ring->arena + rec->offset);
+}
@@ -0,0 +1,650 @@
+/***************************************************************************
+ *   Copyright (C) 2003-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/* for memmem() and memrchr() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "main.h"
+
+#include <dirent.h>
+#include <pthread.h>
+
+/*  Log search
+
+    Searching used to run a shell script that piped every rotated log
+    through grep, and the logview read the results from the pipe one line
+    per screen update. Now a worker thread scans the logs itself, oldest
+    file first like the script did. Plain searches are done with memmem()
+    over whole blocks, so only lines that contain the string are looked
+    at. For a regular expression the longest literal part of it is used
+    the same way before running regexec() on the line.
+
+    The results are kept in a ring of 'max_results' lines: the logview
+    can't show more than that anyway, so when the ui can't keep up, the
+    oldest results are dropped instead of holding up the search.
+
+    The worker may not print: vrprint writes to the screen from the ui
+    thread. Errors are kept in 'error' and printed by logsearch_finish().
+*/
+
+#define LOGSEARCH_BLOCK     65536
+/* the longest line we hand to the logview, including the newline */
+#define LOGSEARCH_LINE      512
+
+struct LogSearch_
+{
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+
+    char            dir[256];
+    char            logname[64];
+    char            pattern[256];
+
+    /* a string every match has to contain, or empty */
+    char            literal[256];
+    size_t          literal_len;
+
+    char            use_regex;
+    regex_t         reg;
+
+    /* read buffer of the worker, one byte extra for a terminating nul */
+    char            *buf;
+
+    /* protected by the mutex */
+    char            stop;
+    char            done;
+    char            error[256];
+    unsigned long   matches;
+
+    char            **results;
+    unsigned int    max_results,
+                    results_head,
+                    results_len;
+};
+
+
+static char
+logsearch_stopped(LogSearch *search_ptr)
+{
+    char    stop = 0;
+
+    pthread_mutex_lock(&search_ptr->mutex);
+    stop = search_ptr->stop;
+    pthread_mutex_unlock(&search_ptr->mutex);
+
+    return(stop);
+}
+
+
+static void
+logsearch_set_error(LogSearch *search_ptr, const char *fmt, ...)
+{
+    va_list ap;
+
+    pthread_mutex_lock(&search_ptr->mutex);
+    va_start(ap, fmt);
+    vsnprintf(search_ptr->error, sizeof(search_ptr->error), fmt, ap);
+    va_end(ap);
+    pthread_mutex_unlock(&search_ptr->mutex);
+}
+
+
+/*  logsearch_add
+
+    Adds a matching line to the results. If the ring is full the oldest
+    result is dropped.
+*/
+static void
+logsearch_add(LogSearch *search_ptr, const char *line, size_t len)
+{
+    char            *result = NULL;
+    unsigned int    pos = 0;
+
+    if(len > LOGSEARCH_LINE - 2)
+        len = LOGSEARCH_LINE - 2;
+
+    /* if we can't get memory we just miss this one */
+    if(!(result = malloc(len + 2)))
+        return;
+
+    memcpy(result, line, len);
+    result[len] = '\n';
+    result[len + 1] = '\0';
+
+    pthread_mutex_lock(&search_ptr->mutex);
+    if(search_ptr->results_len == search_ptr->max_results)
+    {
+        free(search_ptr->results[search_ptr->results_head]);
+        search_ptr->results_head = (search_ptr->results_head + 1) % search_ptr->max_results;
+        search_ptr->results_len--;
+    }
+    pos = (search_ptr->results_head + search_ptr->results_len) % search_ptr->max_results;
+    search_ptr->results[pos] = result;
+    search_ptr->results_len++;
+    search_ptr->matches++;
+    pthread_mutex_unlock(&search_ptr->mutex);
+}
+
+
+/*  logsearch_block
+
+    Searches 'len' bytes of 'buf', which holds complete lines. The byte
+    after the block may be overwritten.
+*/
+static void
+logsearch_block(LogSearch *search_ptr, char *buf, size_t len)
+{
+    char    *ptr = buf,
+            *end = buf + len,
+            *line = NULL,
+            *eol = NULL,
+            *hit = NULL;
+    char    save = 0;
+    int     match = 0;
+
+    while(ptr < end)
+    {
+        if(search_ptr->literal_len > 0)
+        {
+            if(!(hit = memmem(ptr, (size_t)(end - ptr), search_ptr->literal, search_ptr->literal_len)))
+                break;
+
+            if((line = memrchr(ptr, '\n', (size_t)(hit - ptr))))
+                line++;
+            else
+                line = ptr;
+        }
+        else
+        {
+            line = ptr;
+        }
+
+        if(!(eol = memchr(line, '\n', (size_t)(end - line))))
+            eol = end;
+
+        if(search_ptr->use_regex == TRUE)
+        {
+            save = *eol;
+            *eol = '\0';
+            match = (regexec(&search_ptr->reg, line, 0, NULL, 0) == 0);
+            *eol = save;
+        }
+        else
+        {
+            match = 1;
+        }
+
+        if(match)
+            logsearch_add(search_ptr, line, (size_t)(eol - line));
+
+        ptr = eol + 1;
+    }
+}
+
+
+/*  logsearch_file
+
+    Searches one (possibly gzipped) logfile.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+logsearch_file(LogSearch *search_ptr, const char *path)
+{
+    FILE            *fp = NULL;
+    char            is_pipe = FALSE,
+                    command[512] = "";
+    unsigned char   magic[2];
+    char            *nl = NULL;
+    size_t          len = 0,
+                    n = 0,
+                    avail = 0;
+
+    if(!(fp = fopen(path, "r")))
+    {
+        logsearch_set_error(search_ptr, gettext("opening file '%s' failed: %s."), path, strerror(errno));
+        return(-1);
+    }
+
+    /* gzip'd by logrotate: have gzip unpack it for us */
+    if(fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && magic[0] == 0x1f && magic[1] == 0x8b)
+    {
+        (void)fclose(fp);
+
+        if(strchr(path, '\'') != NULL)
+            return(0);
+
+        snprintf(command, sizeof(command), "gzip -dc '%s' 2>/dev/null", path);
+        if(!(fp = popen(command, "r")))
+        {
+            logsearch_set_error(search_ptr, gettext("opening pipe failed: %s."), strerror(errno));
+            return(-1);
+        }
+        is_pipe = TRUE;
+    }
+    else
+    {
+        rewind(fp);
+    }
+
+    while(logsearch_stopped(search_ptr) == FALSE)
+    {
+        n = fread(search_ptr->buf + len, 1, LOGSEARCH_BLOCK - len, fp);
+        len += n;
+        if(len == 0)
+            break;
+
+        /*  search up to the last newline, keep the partial line for the
+            next block. At the end of the file, or if a line doesn't fit
+            in the block, take what we have. */
+        if((nl = memrchr(search_ptr->buf, '\n', len)))
+            avail = (size_t)(nl - search_ptr->buf) + 1;
+        else if(n == 0 || len == LOGSEARCH_BLOCK)
+            avail = len;
+        else
+            continue;
+
+        logsearch_block(search_ptr, search_ptr->buf, avail);
+
+        memmove(search_ptr->buf, search_ptr->buf + avail, len - avail);
+        len -= avail;
+
+        if(n == 0 && len == 0)
+            break;
+    }
+
+    if(is_pipe == TRUE)
+        (void)pclose(fp);
+    else
+        (void)fclose(fp);
+
+    return(0);
+}
+
+
+static int
+logsearch_compare_names(const void *a, const void *b)
+{
+    /* reverse order: oldest rotated log first */
+    return(strcmp(*(char * const *)b, *(char * const *)a));
+}
+
+
+static void *
+logsearch_thread(void *arg)
+{
+    LogSearch       *search_ptr = (LogSearch *)arg;
+    DIR             *dir_p = NULL;
+    struct dirent   *dir_entry_p = NULL;
+    char            **files = NULL,
+                    **tmp_files = NULL,
+                    path[512] = "";
+    unsigned int    files_n = 0,
+                    files_size = 0,
+                    i = 0;
+    struct stat     stat_buf;
+
+    snprintf(path, sizeof(path), "%s/%s", search_ptr->dir, search_ptr->logname);
+    if(stat(path, &stat_buf) == -1)
+    {
+        logsearch_set_error(search_ptr, gettext("The file \"%s\" does not exist."), path);
+        goto done;
+    }
+
+    if(!(dir_p = opendir(search_ptr->dir)))
+    {
+        logsearch_set_error(search_ptr, gettext("opening directory '%s' failed: %s."), search_ptr->dir, strerror(errno));
+        goto done;
+    }
+
+    /* the log and its rotated versions: traffic.log, traffic.log.1, traffic.log.2.gz, ... */
+    while((dir_entry_p = readdir(dir_p)) != NULL)
+    {
+        if(strstr(dir_entry_p->d_name, search_ptr->logname) == NULL)
+            continue;
+
+        if(files_n == files_size)
+        {
+            files_size = files_size ? files_size * 2 : 16;
+            if(!(tmp_files = realloc(files, files_size * sizeof(char *))))
+            {
+                logsearch_set_error(search_ptr, gettext("malloc failed: %s (in: %s:%d)."), strerror(errno), __FUNC__, __LINE__);
+                goto done;
+            }
+            files = tmp_files;
+        }
+
+        if(!(files[files_n] = strdup(dir_entry_p->d_name)))
+        {
+            logsearch_set_error(search_ptr, gettext("malloc failed: %s (in: %s:%d)."), strerror(errno), __FUNC__, __LINE__);
+            goto done;
+        }
+        files_n++;
+    }
+
+    if(files_n > 1)
+        qsort(files, files_n, sizeof(char *), logsearch_compare_names);
+
+    for(i = 0; i < files_n && logsearch_stopped(search_ptr) == FALSE; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%s", search_ptr->dir, files[i]);
+
+        if(stat(path, &stat_buf) == -1 || !S_ISREG(stat_buf.st_mode))
+            continue;
+
+        if(logsearch_file(search_ptr, path) < 0)
+            break;
+    }
+
+done:
+    if(dir_p != NULL)
+        (void)closedir(dir_p);
+    for(i = 0; i < files_n; i++)
+        free(files[i]);
+    free(files);
+
+    pthread_mutex_lock(&search_ptr->mutex);
+    search_ptr->done = TRUE;
+    pthread_mutex_unlock(&search_ptr->mutex);
+
+    return(NULL);
+}
+
+
+/*  logsearch_setup_pattern
+
+    Decides how to match 'pattern', which is a basic regular expression
+    like grep uses. Without special chars it is a plain string. Otherwise
+    we look for the longest run of plain chars that every match must
+    contain, which is only safe if nothing in the pattern can make a char
+    optional ('*' and the '\' extensions).
+
+    Returncodes:
+         0: ok
+        -1: invalid regex
+*/
+static int
+logsearch_setup_pattern(LogSearch *search_ptr)
+{
+    const char  *p = NULL,
+                *run = NULL,
+                *best = NULL;
+    size_t      best_len = 0;
+
+    if(strpbrk(search_ptr->pattern, "\\.[]*^$") == NULL)
+    {
+        (void)strlcpy(search_ptr->literal, search_ptr->pattern, sizeof(search_ptr->literal));
+        search_ptr->literal_len = strlen(search_ptr->literal);
+        search_ptr->use_regex = FALSE;
+        return(0);
+    }
+
+    if(regcomp(&search_ptr->reg, search_ptr->pattern, REG_NOSUB) != 0)
+        return(-1);
+    search_ptr->use_regex = TRUE;
+
+    if(strpbrk(search_ptr->pattern, "\\*") != NULL)
+        return(0);
+
+    for(p = search_ptr->pattern; ; p++)
+    {
+        if(*p == '\0' || *p == '.' || *p == '[' || *p == '^' || *p == '$')
+        {
+            if(run != NULL && (size_t)(p - run) > best_len)
+            {
+                best = run;
+                best_len = (size_t)(p - run);
+            }
+            run = NULL;
+
+            if(*p == '\0')
+                break;
+
+            /* skip the bracket expression, a ']' right after the '[' or '[^' is part of it */
+            if(*p == '[')
+            {
+                p++;
+                if(*p == '^')
+                    p++;
+                if(*p == ']')
+                    p++;
+                while(*p != '\0' && *p != ']')
+                    p++;
+                if(*p == '\0')
+                    break;
+            }
+        }
+        else if(run == NULL)
+        {
+            run = p;
+        }
+    }
+
+    if(best != NULL && best_len < sizeof(search_ptr->literal))
+    {
+        memcpy(search_ptr->literal, best, best_len);
+        search_ptr->literal[best_len] = '\0';
+        search_ptr->literal_len = best_len;
+    }
+
+    return(0);
+}
+
+
+/*  logsearch_start
+
+    Starts searching 'dir' for lines matching 'pattern' in 'logname' and
+    its rotated versions. The latest 'max_results' matches are kept.
+
+    Returns the search, or NULL on error.
+*/
+LogSearch *
+logsearch_start(const int debuglvl, const char *dir, const char *logname,
+        const char *pattern, unsigned int max_results)
+{
+    LogSearch   *search_ptr = NULL;
+
+    /* safety */
+    if(dir == NULL || logname == NULL || pattern == NULL || max_results == 0)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(NULL);
+    }
+
+    if(!(search_ptr = calloc(1, sizeof(LogSearch))))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."),
+                strerror(errno), __FUNC__, __LINE__);
+        return(NULL);
+    }
+
+    (void)strlcpy(search_ptr->dir, dir, sizeof(search_ptr->dir));
+    (void)strlcpy(search_ptr->logname, logname, sizeof(search_ptr->logname));
+    (void)strlcpy(search_ptr->pattern, pattern, sizeof(search_ptr->pattern));
+    search_ptr->max_results = max_results;
+
+    if(logsearch_setup_pattern(search_ptr) < 0)
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("invalid search '%s'."), pattern);
+        free(search_ptr);
+        return(NULL);
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "pattern '%s', regex %s, literal '%s'.",
+                search_ptr->pattern, search_ptr->use_regex ? "yes" : "no",
+                search_ptr->literal);
+
+    if(!(search_ptr->results = calloc(max_results, sizeof(char *))) ||
+        !(search_ptr->buf = malloc(LOGSEARCH_BLOCK + 1)))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."),
+                strerror(errno), __FUNC__, __LINE__);
+        goto error;
+    }
+
+    if(pthread_mutex_init(&search_ptr->mutex, NULL) != 0)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "pthread_mutex_init failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        goto error;
+    }
+
+    if(pthread_create(&search_ptr->thread, NULL, logsearch_thread, search_ptr) != 0)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "pthread_create failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        pthread_mutex_destroy(&search_ptr->mutex);
+        goto error;
+    }
+
+    return(search_ptr);
+
+error:
+    if(search_ptr->use_regex == TRUE)
+        regfree(&search_ptr->reg);
+    free(search_ptr->results);
+    free(search_ptr->buf);
+    free(search_ptr);
+    return(NULL);
+}
+
+
+/*  logsearch_getline
+
+    Gets the oldest result we didn't hand out yet.
+
+    Returncodes:
+         1: 'line' was filled
+         0: no result right now, the search is still running
+        -1: the search is done and all results were handed out
+*/
+int
+logsearch_getline(LogSearch *search_ptr, char *line, size_t size)
+{
+    int     retval = 0;
+
+    if(search_ptr == NULL || line == NULL)
+        return(-1);
+
+    pthread_mutex_lock(&search_ptr->mutex);
+    if(search_ptr->results_len > 0)
+    {
+        (void)strlcpy(line, search_ptr->results[search_ptr->results_head], size);
+        free(search_ptr->results[search_ptr->results_head]);
+        search_ptr->results[search_ptr->results_head] = NULL;
+
+        search_ptr->results_head = (search_ptr->results_head + 1) % search_ptr->max_results;
+        search_ptr->results_len--;
+        retval = 1;
+    }
+    else if(search_ptr->done == TRUE)
+    {
+        retval = -1;
+    }
+    pthread_mutex_unlock(&search_ptr->mutex);
+
+    return(retval);
+}
+
+
+/*  logsearch_matches
+
+    Number of matches found so far.
+*/
+unsigned long
+logsearch_matches(LogSearch *search_ptr)
+{
+    unsigned long   matches = 0;
+
+    if(search_ptr == NULL)
+        return(0);
+
+    pthread_mutex_lock(&search_ptr->mutex);
+    matches = search_ptr->matches;
+    pthread_mutex_unlock(&search_ptr->mutex);
+
+    return(matches);
+}
+
+
+/*  logsearch_stop
+
+    Asks the worker to stop, it will do so after the current block.
+*/
+void
+logsearch_stop(LogSearch *search_ptr)
+{
+    if(search_ptr == NULL)
+        return;
+
+    pthread_mutex_lock(&search_ptr->mutex);
+    search_ptr->stop = TRUE;
+    pthread_mutex_unlock(&search_ptr->mutex);
+}
+
+
+/*  logsearch_finish
+
+    Waits for the worker, prints its error if it had one and frees the
+    search.
+
+    Returncodes:
+         0: ok
+        -1: the search failed
+*/
+int
+logsearch_finish(const int debuglvl, LogSearch *search_ptr)
+{
+    int             retval = 0;
+    unsigned int    i = 0;
+
+    if(search_ptr == NULL)
+        return(-1);
+
+    (void)pthread_join(search_ptr->thread, NULL);
+
+    if(search_ptr->error[0] != '\0')
+    {
+        (void)vrprint.error(-1, VR_ERR, "%s", search_ptr->error);
+        retval = -1;
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "%lu matches.", search_ptr->matches);
+
+    for(i = 0; i < search_ptr->results_len; i++)
+        free(search_ptr->results[(search_ptr->results_head + i) % search_ptr->max_results]);
+    free(search_ptr->results);
+    free(search_ptr->buf);
+
+    if(search_ptr->use_regex == TRUE)
+        regfree(&search_ptr->reg);
+
+    pthread_mutex_destroy(&search_ptr->mutex);
+    free(search_ptr);
+
+    return(retval);
+}
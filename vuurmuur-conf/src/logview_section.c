@@ -18,17 +18,16 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+/* for memrchr() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "main.h"
 
 
 /* LogRule moved to main.h */
 
-struct PlainLogRule_
-{
-    int filtered;
-    char line[512];
-};
-
 
 /*  logline2logrule
 
@@ -104,24 +103,6 @@ logline2logrule(char *logline, struct LogRule_ *logrule)
 }
 
 
-/*  logline2plainlogrule
-
-    Returncodes:
-        -1: error
-         (0: filtered)
-         0: ok
-*/
-static int
-logline2plainlogrule(char *logline, struct PlainLogRule_ *logrule)
-{
-    if(!logline || !logrule)
-        return(-1);
-
-    (void)strlcpy(logrule->line, logline, sizeof(logrule->line));
-    return(0);
-}
-
-
 /*
 
     Returncodes:
@@ -206,6 +187,203 @@ plainlogrule_filtered(const int debuglvl, char *line, VR_filter *filter)
 }
 
 
+/*  logline_filter_literal
+
+    The filter matches '.*str.*'. Often 'str' is a name or an ipaddress,
+    which can be checked on the raw line before parsing it.
+
+    If 'str' has no special chars besides '.', '^' and '$', every run of
+    normal chars in it must be in the line for it to match. We keep the
+    longest one in 'literal'. The chars that separate the fields of a
+    traffic log line also end a run: that way a run can only match
+    within a field, and every field is copied unchanged from the raw
+    line. So a raw line without the literal can't match.
+
+    Returncodes:
+        1: 'literal' is the whole filter: for plain logs containing it
+           is the same as matching
+        0: 'literal' must be in a matching line (it can be empty)
+*/
+static char
+logline_filter_literal(VR_filter *filter, char *literal, size_t size)
+{
+    const char  *p = NULL,
+                *run = NULL,
+                *best = NULL;
+    size_t      best_len = 0;
+
+    literal[0] = '\0';
+
+    if(filter == NULL || filter->reg_active == FALSE || filter->str[0] == '\0')
+        return(0);
+
+    if(strpbrk(filter->str, "[]()*+?{}|\\") != NULL)
+        return(0);
+
+    for(p = filter->str; ; p++)
+    {
+        if(*p == '\0' || strchr(".^$ \t\"',:", *p) != NULL)
+        {
+            if(run != NULL && (size_t)(p - run) > best_len)
+            {
+                best = run;
+                best_len = (size_t)(p - run);
+            }
+            run = NULL;
+
+            if(*p == '\0')
+                break;
+        }
+        else if(run == NULL)
+        {
+            run = p;
+        }
+    }
+
+    if(best == NULL || best_len >= size)
+        return(0);
+
+    memcpy(literal, best, best_len);
+    literal[best_len] = '\0';
+
+    return(best_len == strlen(filter->str));
+}
+
+
+/*  logline_filtered
+
+    Checks the filter for a line of the buffer. A line without the
+    literal of the filter (see logline_filter_literal) is decided
+    without parsing it, and so is a plain log line if the literal is the
+    whole filter.
+
+    Returncodes:
+        0: not filtered
+        1: filtered
+*/
+static int
+logline_filtered(const int debuglvl, char traffic_log, char *line,
+        VR_filter *filter, char *literal, char exact)
+{
+    struct LogRule_ logrule;
+
+    if(literal[0] != '\0')
+    {
+        if(strstr(line, literal) == NULL)
+            return(filter->neg == FALSE ? 1 : 0);
+        else if(exact && !traffic_log)
+            return(filter->neg == FALSE ? 0 : 1);
+    }
+
+    if(traffic_log)
+    {
+        memset(&logrule, 0, sizeof(logrule));
+        if(logline2logrule(line, &logrule) < 0)
+            return(0);
+
+        return(logrule_filtered(debuglvl, &logrule, filter));
+    }
+
+    return(plainlogrule_filtered(debuglvl, line, filter));
+}
+
+
+/*  logview_find_start
+
+    Finds the offset in 'fp' where the last 'lines' lines start by
+    reading blocks backwards from the end of the file.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+logview_find_start(const int debuglvl, FILE *fp, unsigned int lines, off_t *start)
+{
+    char            block[65536];
+    off_t           pos = 0;
+    size_t          len = 0;
+    unsigned int    newlines = 0;
+    char            *nl = NULL;
+
+    if(fseeko(fp, 0, SEEK_END) < 0)
+        return(-1);
+    pos = ftello(fp);
+    *start = 0;
+
+    /*  every complete line ends with a newline, so the start is just
+        after newline number 'lines' + 1 counted from the end. */
+    while(pos > 0)
+    {
+        len = (pos > (off_t)sizeof(block)) ? sizeof(block) : (size_t)pos;
+        pos -= (off_t)len;
+
+        if(fseeko(fp, pos, SEEK_SET) < 0 || fread(block, 1, len, fp) != len)
+            return(-1);
+
+        while(len > 0 && (nl = memrchr(block, '\n', len)) != NULL)
+        {
+            newlines++;
+            if(newlines == lines + 1)
+            {
+                *start = pos + (off_t)(nl - block) + 1;
+
+                if(debuglvl >= MEDIUM)
+                    (void)vrprint.debug(__FUNC__, "start at %lld.", (long long)*start);
+                return(0);
+            }
+            len = (size_t)(nl - block);
+        }
+    }
+
+    return(0);
+}
+
+
+/*  logview_logrules
+
+    Fills 'list' with the parsed rules of all lines in 'ring'. The caller
+    has to d_list_cleanup() the list, also on error.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+logview_logrules(const int debuglvl, LogRing *ring, d_list *list)
+{
+    struct LogRule_ *logrule_ptr = NULL;
+    LogRingRecord   *rec = NULL;
+    unsigned int    i = 0;
+
+    if(d_list_setup(debuglvl, list, free) < 0)
+        return(-1);
+
+    for(i = 0; i < ring->len; i++)
+    {
+        rec = logring_get(ring, i);
+
+        if(!(logrule_ptr = calloc(1, sizeof(struct LogRule_))))
+        {
+            (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."), strerror(errno), __FUNCTION__, __LINE__);
+            return(-1);
+        }
+
+        (void)logline2logrule(logring_line(ring, rec), logrule_ptr);
+        logrule_ptr->filtered = rec->filtered;
+
+        if(d_list_append(debuglvl, list, logrule_ptr) == NULL)
+        {
+            (void)vrprint.error(-1, VR_INTERR, "unable to add line to list.");
+            free(logrule_ptr);
+            return(-1);
+        }
+    }
+
+    return(0);
+}
+
+
 static void
 draw_filter(PANEL *pan, WINDOW *win, char *filter)
 {
@@ -244,53 +422,6 @@ draw_search(PANEL *pan, WINDOW *win, char *search)
 }
 
 
-static int
-check_search_script(const int debuglvl, char *script)
-{
-    struct stat stat_buf;
-
-    if(!script)
-        return(-1);
-
-    /* stat the damn thing */
-    if(lstat(script, &stat_buf) == -1)
-    {
-        (void)vrprint.error(-1, VR_ERR,  gettext("checking failed for '%s': %s."), script, strerror(errno));
-        return(0);
-    }
-
-    /* we wont open symbolic links */
-    if(S_ISLNK(stat_buf.st_mode) == 1)
-    {
-        (void)vrprint.error(-1, VR_ERR, gettext("opening file '%s': For security reasons Vuurmuur will not allow following symbolic-links."), script);
-        return(0);
-    }
-
-    /* only allow files and dirs */
-    if(!S_ISREG(stat_buf.st_mode) && !S_ISDIR(stat_buf.st_mode))
-    {
-        (void)vrprint.error(-1, VR_ERR, gettext("opening file '%s': For security reasons Vuurmuur will not allow opening anything other than a file or a directory."), script);
-        return(0);
-    }
-
-    /* if a file is writable by someone other than root, we refuse to open it */
-    if(stat_buf.st_mode & S_IWGRP || stat_buf.st_mode & S_IWOTH)
-    {
-        (void)vrprint.error(-1, VR_ERR, gettext("opening file '%s': For security reasons Vuurmuur will not open files that are writable by 'group' or 'other'. Check the file content & permissions."), script);
-        return(0);
-    }
-
-    /* we demand that all files are owned by root */
-    if(stat_buf.st_uid != 0)
-    {
-        (void)vrprint.error(-1, VR_ERR, gettext("opening file '%s': For security reasons Vuurmuur will not open files that are not owned by root."), script);
-        return(0);
-    }
-
-    return(0);
-}
-
-
 static void
 print_logrule(WINDOW *log_win, struct LogRule_ *logrule_ptr,
         size_t max_logrule_length, size_t cur_logrule_length,
@@ -595,21 +726,6 @@ print_plainlogrule(WINDOW *log_win, char *line,
 }
 
 
-static void
-sanitize_search_str(const int debuglvl, char *str, size_t size)
-{
-    size_t  i = 0;
-
-    for(i = 0; i < size; i++)
-    {
-        if(str[i] == '\'')
-            str[i] = '_';
-        else if(str[i] == '\"')
-            str[i] = '_';
-    }
-}
-
-
 #define READLINE_LEN    512
 
 int
@@ -627,9 +743,10 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                     *wait_panels[1],
                     *info_bar_panels[2];
 
-    d_list          LogBufferList,
-                    SearchBufferList,
+    LogRing         LogBuffer,
+                    SearchBuffer,
                     *buffer_ptr = NULL;
+    LogRingRecord   *rec = NULL;
     unsigned int    max_buffer_size = vccnf.logview_bufsize; // default
 
     unsigned int    i = 0;
@@ -637,20 +754,19 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                     ch = 0;
 
     FILE            *fp = NULL,
-                    *traffic_fp = NULL,
-                    *search_pipe = NULL;
+                    *traffic_fp = NULL;
     
     size_t          linelen = 0;
-    char            *line = NULL,
+    char            line[READLINE_LEN] = "",
             
                     *logfile = NULL,
 
                     /* infobar stuff */
                     search[32] = "none";
 
-    char            use_filter = FALSE;
-
-    d_list_node     *d_node = NULL;
+    char            use_filter = FALSE,
+                    filter_literal[32] = "",
+                    filter_exact = 0;
 
     int             max_onscreen=0;
     unsigned int    offset=0,
@@ -682,25 +798,22 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
         0,
     };
 
-    struct LogRule_         *logrule_ptr = NULL;
-    struct PlainLogRule_    *plainlogrule_ptr = NULL;
+    struct LogRule_         logrule;
+    d_list                  logrule_list;
 
     size_t                  max_logrule_length=0,
                             cur_logrule_length=0;
 
     VR_filter               vfilter;
     
-    int                     done = 0,
-                            first_logline_done = 0,
-                            filtered_lines = 0;
+    int                     filtered_lines = 0;
             
     unsigned int            run_count = 0;
     int                     delta = 0;
     unsigned int            first_draw = 0;
     int                     drawn_lines = 0;
     
-    off_t                   logfile_size = 0;
-    long                    logfile_fseek_offset = 0;
+    off_t                   logfile_start = 0;
 
     /* search */
     char                    search_mode = 0;
@@ -709,11 +822,9 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                             search_error = 0;
     unsigned long           search_results = 0;
     
-    char                    *search_ptr = NULL,
-                            search_string[512] = "";
-            
-    char                    search_script_checked = 0,
-                            search_script_ok = 0;
+    char                    *search_ptr = NULL;
+    LogSearch               *logsearch = NULL;
+    char                    got_line = FALSE;
     
     /* is the current log the trafficlog? */
     char                    traffic_log = FALSE;
@@ -755,9 +866,6 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                                                         gettext("back")};
     int                     nt_cmd_choices_n = 6;
 
-    /* stat buffer, for checking the file size of the traffic-log */
-    struct stat             stat_buf;
-
 
     /* safety */
     if(zones == NULL || blocklist == NULL)
@@ -809,22 +917,11 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
     }
 
 
-    /* setup the buffer */
-    if(d_list_setup(debuglvl, &LogBufferList, free) < 0)
-    {
-        (void)vrprint.error(-1, VR_INTERR, "setting up buffer failed (in: %s:%d).", __FUNCTION__, __LINE__);
-        return(-1);
-    }
-    /* point the buffer pointer to the LogBufferList */
-    buffer_ptr = &LogBufferList;
-
-
     /* begin with the traffic log */
     traffic_fp = fopen(logfile, "r");
     if(!traffic_fp)
     {
         (void)vrprint.error(-1, VR_ERR, gettext("opening logfile '%s' failed: %s."), conf.trafficlog_location, strerror(errno));
-        d_list_cleanup(debuglvl, buffer_ptr);
         return(-1);
     }
     /* point it to the fp */
@@ -842,25 +939,22 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
     if(max_buffer_size < (unsigned int)max_onscreen)
         max_buffer_size = (unsigned int)max_onscreen;
 
-    /*  get the size of the logfile and check if were asking to much of
-        fseek. If so, ask less.
-    */
-    if(stat(logfile, &stat_buf) == -1)
+    /* setup the buffer */
+    memset(&SearchBuffer, 0, sizeof(SearchBuffer));
+    if(logring_setup(debuglvl, &LogBuffer, max_buffer_size) < 0)
     {
-        (void)vrprint.error(-1, VR_ERR, gettext("could not examine the logfile: %s."), strerror(errno));
+        (void)vrprint.error(-1, VR_INTERR, "setting up buffer failed (in: %s:%d).", __FUNCTION__, __LINE__);
         return(-1);
     }
-    
-    logfile_size = stat_buf.st_size;
-    logfile_fseek_offset = (int)max_buffer_size * READLINE_LEN * -1;
-
-    if(logfile_fseek_offset < (logfile_size * -1))
-        logfile_fseek_offset = logfile_size * -1;
+    /* point the buffer pointer to the LogBuffer */
+    buffer_ptr = &LogBuffer;
 
-    /* listen at the logfile_fseek_offset point in the file, so we start with a populated buffer */
-    if(fseek(fp, logfile_fseek_offset, SEEK_END) < 0)
+    /* start at the last max_buffer_size lines, so we start with a populated buffer */
+    if(logview_find_start(debuglvl, fp, max_buffer_size, &logfile_start) < 0 ||
+        fseeko(fp, logfile_start, SEEK_SET) < 0)
     {
         (void)vrprint.error(-1, VR_ERR, gettext("fseek failed: %s."), strerror(errno));
+        logring_cleanup(&LogBuffer);
         return(-1);
     }
     
@@ -888,138 +982,30 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
     /*
         load the initial rules
     */
-    while(!done)
+    while(fgets(line, READLINE_LEN, fp) != NULL)
     {
-        /* read line from log */
-        if(!(line = malloc(READLINE_LEN)))
-        {
-            (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."), strerror(errno), __FUNCTION__, __LINE__);
-            d_list_cleanup(debuglvl, buffer_ptr);
-            return(-1);
-        }
+        linelen = StrMemLen(line);
 
-        if(fgets(line, READLINE_LEN, fp) != NULL)
+        /*
+            if the line doesn't end with a newline character we rewind and try again later.
+        */
+        if(linelen < READLINE_LEN-1 && line[linelen - 1] != '\n')
         {
-            linelen = StrMemLen(line);
+            fseek(fp, (long)(linelen*-1), SEEK_CUR);
 
-            /*  ignore the first line we read for it shall almost certainly be broken
-                because of fseek.
-            */
-            if(!first_logline_done)
-            {
-                first_logline_done = 1;
-                free(line);
-            }
-            /*
-                if the line doesn't end with a newline character we rewind and try again.
-            */
-            else if(linelen < READLINE_LEN-1 && line[linelen - 1] != '\n')
-            {
-                fseek(fp, (long)(StrMemLen(line)*-1), SEEK_CUR);
-                free(line);
-
-                /* done because we reached the end of the file which does not have a newline */
-                done = 1;
-            }
-            /*
-                insert the line into the buffer list
-            */
-            else
-            {
-                if(traffic_log)
-                {
-                    /* here we can analyse the rule */
-                    if(!(logrule_ptr = malloc(sizeof(struct LogRule_))))
-                    {
-                        (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."), strerror(errno), __FUNCTION__, __LINE__);
-                        return(-1);
-                    }
-
-                    /* start not filtered (was filtered) */
-                    logrule_ptr->filtered = 0;
-
-                    result = logline2logrule(line, logrule_ptr);
-                    if(result < 0)
-                    {
-                        free(logrule_ptr);
-                        free(line);
-    
-                        return(-1);
-                    }
-
-                    /* now insert the rule */
-                    if(d_list_append(debuglvl, buffer_ptr, logrule_ptr)  == NULL)
-                    {
-                        (void)vrprint.error(-1, VR_INTERR, "unable to add line to buffer.");
-                        return(-1);
-                    }
-
-                    /* if the bufferlist is full, remove the oldest item from it */
-                    if(buffer_ptr->len > max_buffer_size)
-                    {
-                        if(d_list_remove_top(debuglvl, buffer_ptr) < 0)
-                        {
-                            (void)vrprint.error(-1, VR_INTERR, "unable to remove line from buffer (initial buffer fill).");
-                            return(-1);
-                        }
-                    }
-
-                    logrule_ptr = NULL;
-                    control.queue++;
-                }
-                else
-                {
-                    /* here we can analyse the rule */
-                    if(!(plainlogrule_ptr = malloc(sizeof(struct PlainLogRule_))))
-                    {
-                        (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."), strerror(errno), __FUNCTION__, __LINE__);
-                        return(-1);
-                    }
-
-                    /* start not filtered (was filtered) */
-                    plainlogrule_ptr->filtered = 0;
-
-                    result = logline2plainlogrule(line, plainlogrule_ptr);
-                    if(result < 0)
-                    {
-                        free(plainlogrule_ptr);
-                        free(line);
-    
-                        return(-1);
-                    }
-
-                    /* now insert the rule */
-                    if(d_list_append(debuglvl, buffer_ptr, plainlogrule_ptr)  == NULL)
-                    {
-                        (void)vrprint.error(-1, VR_INTERR, "unable to add line to buffer.");
-                        return(-1);
-                    }
-
-                    /* if the bufferlist is full, remove the oldest item from it */
-                    if(buffer_ptr->len > max_buffer_size)
-                    {
-                        if(d_list_remove_top(debuglvl, buffer_ptr) < 0)
-                        {
-                            (void)vrprint.error(-1, VR_INTERR, "unable to remove line from buffer (initial buffer fill).");
-                            return(-1);
-                        }
-                    }
-
-                    plainlogrule_ptr = NULL;
-                    control.queue++;
-                }
-
-                /* free the line string, we don't need it anymore */
-                free(line);
-            }
+            /* done because we reached the end of the file which does not have a newline */
+            break;
         }
-        else
-        {
-            /* free the alloced line */
-            free(line);
 
-            done = 1;
+        /*
+            insert the line into the buffer
+        */
+        if(logring_add(buffer_ptr, line) == NULL)
+        {
+            (void)vrprint.error(-1, VR_INTERR, "unable to add line to buffer.");
+            return(-1);
         }
+        control.queue++;
     }
 
     status_print(status_win, gettext("Loading loglines into memory... loaded %d lines."), buffer_ptr->len);
@@ -1076,156 +1062,51 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
     /* the main loop */
     while(quit == 0)
     {
-        /* read line from log */
-        if(!(line = malloc(READLINE_LEN)))
+        /*  read a line if we are not in pause mode: from the search
+            results in search mode, from the log otherwise. */
+        got_line = FALSE;
+        if(!control.pause)
         {
-            (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."), strerror(errno), __FUNCTION__, __LINE__);
-            d_list_cleanup(debuglvl, buffer_ptr);
-            return(-1);
+            if(search_mode)
+            {
+                result = logsearch_getline(logsearch, line, READLINE_LEN);
+                if(result == 1)
+                    got_line = TRUE;
+                else if(result < 0)
+                    search_completed = 1;
+            }
+            else if(fgets(line, READLINE_LEN, fp) != NULL)
+            {
+                got_line = TRUE;
+            }
         }
 
-        /* read a line if we are not in pause mode */
-        if(!control.pause && fgets(line, READLINE_LEN, fp) != NULL)
+        if(got_line)
         {
             linelen = StrMemLen(line);
 
             /* if the line doesn't end with a newline character we rewind and try again the next run. */
-            if(linelen < READLINE_LEN-1 && line[linelen - 1] != '\n')
+            if(!search_mode && linelen < READLINE_LEN-1 && line[linelen - 1] != '\n')
             {
                 fseek(fp, (long)(linelen * -1), SEEK_CUR);
-                free(line);
-                line = NULL;
+                control.sleep = 1;
             }
-            else if(search_mode)
+            /* insert the line into the buffer */
+            else
             {
-                if(strncmp(line, "SL:EOF:", 7) == 0)
-                {
-                    search_completed = 1;
-                }
-                else if(strncmp(line, "SL:ERROR:", 9) == 0)
-                {
-                    search_error = 1;
-                    search_completed = 1;
-
-                    line[StrMemLen(line)-2] = '\0';
-                    (void)vrprint.error(-1, VR_ERR, "%s", line);
-                }
-                else
-                {
-                    search_results++;
-                }
-
-                if(search_completed)
+                if(!(rec = logring_add(buffer_ptr, line)))
                 {
-                    /* if we bail out here it's because of an EOF or ERROR
-                       and we are not interested in the line. So free it.
-                    */
-                    free(line);
-                    line = NULL;
+                    (void)vrprint.error(-1, VR_INTERR, "unable to add line to buffer.");
+                    return(-1);
                 }
-            }
 
-            /* insert the line into the buffer list */
-            if(line)
-            {
-                if(traffic_log)
+                /* if we have a filter check it now */
+                if(use_filter)
                 {
-                    /* here we can analyse the rule */
-                    if(!(logrule_ptr = malloc(sizeof(struct LogRule_))))
-                    {
-                        (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."), strerror(errno), __FUNCTION__, __LINE__);
-                        return(-1);
-                    }
-
-                    /* we asume unfiltered (was filtered) */
-                    logrule_ptr->filtered = 0;
-
-                    /* convert the raw line to our data structure */
-                    result = logline2logrule(line, logrule_ptr);
-                    if(result < 0)
-                    {
-                        free(logrule_ptr);
-                        free(line);
-
-                        return(-1);
-                    }
-
-                    /* if we have a filter check it now */
-                    if(use_filter)
-                    {
-                        logrule_ptr->filtered = logrule_filtered(debuglvl, logrule_ptr, &vfilter);
-                    }
-                    
-                    /* now really insert the rule into the buffer */
-                    if(d_list_append(debuglvl, buffer_ptr, logrule_ptr)  == NULL)
-                    {
-                        (void)vrprint.error(-1, VR_INTERR, "unable to add line to buffer.");
-                        return(-1);
-                    }
-
-                    /* if the bufferlist is full, remove the oldest item from it */
-                    if(buffer_ptr->len > max_buffer_size)
-                    {
-                        if(d_list_remove_top(debuglvl, buffer_ptr) < 0)
-                        {
-                            (void)vrprint.error(-1, VR_INTERR, "unable to remove line from buffer (runtime).");
-                            return(-1);
-                        }
-                    }
-
-                    control.queue++;
-                    logrule_ptr = NULL;
-                }
-                else
-                {
-                    /* here we can analyse the rule */
-                    if(!(plainlogrule_ptr = malloc(sizeof(struct PlainLogRule_))))
-                    {
-                        (void)vrprint.error(-1, VR_ERR, gettext("malloc failed: %s (in: %s:%d)."), strerror(errno), __FUNCTION__, __LINE__);
-                        return(-1);
-                    }
-
-                    /* we asume unfiltered (was filtered) */
-                    plainlogrule_ptr->filtered = 0;
-
-                    result = logline2plainlogrule(line, plainlogrule_ptr);
-                    if(result < 0)
-                    {
-                        free(plainlogrule_ptr);
-                        free(line);
-    
-                        return(-1);
-                    }
-
-                    /* if we have a filter check it now */
-                    if(use_filter)
-                    {
-                        plainlogrule_ptr->filtered = plainlogrule_filtered(debuglvl, plainlogrule_ptr->line, &vfilter);
-                    }
-
-                    /* now insert the rule */
-                    if(d_list_append(debuglvl, buffer_ptr, plainlogrule_ptr)  == NULL)
-                    {
-                        (void)vrprint.error(-1, VR_INTERR, "unable to add line to buffer.");
-                        return(-1);
-                    }
-
-                    /* if the bufferlist is full, remove the oldest item from it */
-                    if(buffer_ptr->len > max_buffer_size)
-                    {
-                        if(d_list_remove_top(debuglvl, buffer_ptr) < 0)
-                        {
-                            (void)vrprint.error(-1, VR_INTERR, "unable to remove line from buffer (initial buffer fill).");
-                            return(-1);
-                        }
-                    }
-
-                    plainlogrule_ptr = NULL;
-                    control.queue++;
+                    rec->filtered = logline_filtered(debuglvl, traffic_log, line, &vfilter, filter_literal, filter_exact);
                 }
 
-                /* free the line string, we don't need it anymore */
-                free(line);
+                control.queue++;
             }
         }
         /*  no rule read
@@ -1234,10 +1115,6 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
         */
         else
         {
-            /* free the allocated buffer */
-            free(line);
-            line = NULL;
-
             /* so we sleep, */
             control.sleep = 1;
 
@@ -1261,7 +1138,7 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                 2. inform the user
                 
                 One thing is not done here: we don't clean the buffer and
-                we dont restore the bufferpointer to the LogBufferList
+                we dont restore the bufferpointer to the LogBuffer
                 This is done only after the user disables the pause mode.
                 
                 The reason for this is that we want to be able to scroll 
@@ -1269,14 +1146,15 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
             */
             if(search_completed)
             {
-                /* close the pipe */
-                if(pclose(search_pipe) < 0)
-                {
-                    (void)vrprint.error(-1, VR_ERR, gettext("closing search pipe failed: %s."), strerror(errno));
-                }
+                /* wait for the worker to stop */
+                if(search_stop)
+                    logsearch_stop(logsearch);
 
-                /* restore file pointer */
-                fp = traffic_fp;
+                search_results = logsearch_matches(logsearch);
+
+                if(logsearch_finish(debuglvl, logsearch) < 0)
+                    search_error = 1;
+                logsearch = NULL;
 
                 /* disable search_mode */
                 search_mode = 0;
@@ -1385,6 +1263,7 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                     status_print(status_win, gettext("Filter removed."));
                     use_filter = FALSE;
                 }
+                filter_exact = logline_filter_literal(&vfilter, filter_literal, sizeof(filter_literal));
 
                 if(use_filter == TRUE)
                 {
@@ -1412,41 +1291,17 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                 update_panels();
                 doupdate();
 
-                for(d_node = buffer_ptr->top; d_node; d_node = d_node->next)
+                for(i = 0; i < buffer_ptr->len; i++)
                 {
-                    if(traffic_log)
-                    {
-                        if(!(logrule_ptr = d_node->data))
-                        {
-                            (void)vrprint.error(-1, VR_INTERR, "NULL pointer.");
-                            return(-1);
-                        }
+                    rec = logring_get(buffer_ptr, i);
 
-                        if(use_filter)
-                        {
-                            logrule_ptr->filtered = logrule_filtered(debuglvl, logrule_ptr, &vfilter);
-                        }
-                        else
-                        {
-                            logrule_ptr->filtered = 0;
-                        }
+                    if(use_filter)
+                    {
+                        rec->filtered = logline_filtered(debuglvl, traffic_log, logring_line(buffer_ptr, rec), &vfilter, filter_literal, filter_exact);
                     }
                     else
                     {
-                        if(!(plainlogrule_ptr = d_node->data))
-                        {
-                            (void)vrprint.error(-1, VR_INTERR, "NULL pointer.");
-                            return(-1);
-                        }
-
-                        if(use_filter)
-                        {
-                            plainlogrule_ptr->filtered = plainlogrule_filtered(debuglvl, plainlogrule_ptr->line, &vfilter);
-                        }
-                        else
-                        {
-                            plainlogrule_ptr->filtered = 0;
-                        }
+                        rec->filtered = 0;
                     }
                 }
                 
@@ -1463,13 +1318,7 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
             case 'c':
                 werase(log_win);
 
-                d_list_cleanup(debuglvl, buffer_ptr);
-
-                if(d_list_setup(debuglvl, buffer_ptr, free) < 0)
-                {
-                    (void)vrprint.error(-1, VR_INTERR, "re-initializing buffer failed.");
-                    return(-1);
-                }
+                logring_clear(buffer_ptr);
 
                 control.print = 1;
                 break;
@@ -1507,10 +1356,10 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                     if(search_completed)
                     {
                         /* cleanup the buffer */
-                        d_list_cleanup(debuglvl, buffer_ptr);
+                        logring_cleanup(&SearchBuffer);
 
                         /* restore buffer pointer */
-                        buffer_ptr = &LogBufferList;
+                        buffer_ptr = &LogBuffer;
                         
                         search_completed = 0;
                         
@@ -1686,76 +1535,38 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                 }
                 else
                 {
-                    if(!search_script_checked)
+                    if((search_ptr = input_box(32, gettext("Search"), gettext("What do you want to search for?"))))
                     {
-                        /* check if the search script exists */
-                        snprintf(search_string, sizeof(search_string), "%s/vuurmuur-searchlog.sh", vccnf.scripts_location);
-
-                        if(check_search_script(debuglvl, search_string) < 0)
+                        /* start the search in the background */
+                        if(!(logsearch = logsearch_start(debuglvl, conf.vuurmuur_logdir_location, logname, search_ptr, max_buffer_size)))
                         {
-                            search_script_ok = 0;
+                            free(search_ptr);
+                            search_ptr = NULL;
+                            break;
                         }
-                        else
-                        {
-                            search_script_ok = 1;
-                        }
-
-                        search_script_checked = 1;
-                    }
 
-                    /* search already checked */
-                    if(search_script_ok)
-                    {
-                        if((search_ptr = input_box(32, gettext("Search"), gettext("What do you want to search for?"))))
+                        /* setup the search-buffer */
+                        if(logring_setup(debuglvl, &SearchBuffer, max_buffer_size) < 0)
                         {
-                            /* regex check the search-string */
-                            sanitize_search_str(debuglvl, search_ptr, strlen(search_ptr));
-
-                            /* setup the search-buffer */
-                            if(d_list_setup(debuglvl, &SearchBufferList, free) < 0)
-                            {
-                                (void)vrprint.error(-1, VR_INTERR, "initializing search buffer failed.");
-                                return(-1);
-                            }
-
-                            /* point the buffer-pointer to the SearchBufferList */
-                            buffer_ptr = &SearchBufferList;
-
-                            /* temp store the traffic pointer */
-                            traffic_fp = fp;
-
-                            /* assemble search string => ignore stderr because it messes up the screen */
-                            snprintf(search_string, sizeof(search_string), "/bin/bash %s/vuurmuur-searchlog.sh %s %s/ '%s' 2>/dev/null", vccnf.scripts_location, logname, conf.vuurmuur_logdir_location, search_ptr);
-                            (void)vrprint.debug(__FUNC__, "search_string: '%s'.", search_string);
-
-                            /* open the pipe */
-                            if(!(search_pipe = popen(search_string, "r")))
-                            {
-                                (void)vrprint.error(-1, VR_ERR, gettext("opening pipe failed: %s."), strerror(errno));
-                                return(-1);
-                            }
+                            (void)vrprint.error(-1, VR_INTERR, "initializing search buffer failed.");
+                            return(-1);
+                        }
 
-                            /* set the file pointer to the search_pipe */
-                            fp = search_pipe;
+                        /* point the buffer-pointer to the SearchBuffer */
+                        buffer_ptr = &SearchBuffer;
 
-                            /* we are in search-mode */
-                            search_mode = 1;
+                        /* we are in search-mode */
+                        search_mode = 1;
 
-                            status_print(status_win, gettext("Search started. Press 'S' to stop searching."));
-                            control.print = 1;
+                        status_print(status_win, gettext("Search started. Press 'S' to stop searching."));
+                        control.print = 1;
 
-                            /* copy the search term for the infobar */
-                            (void)strlcpy(search, search_ptr, sizeof(search));
+                        /* copy the search term for the infobar */
+                        (void)strlcpy(search, search_ptr, sizeof(search));
 
-                            /* draw the search panel */
-                            draw_search(info_bar_panels[1], search_ib_win, search);
-                        }
-                    }
-                    else
-                    {
-                        (void)vrprint.error(-1, VR_ERR, gettext("search script was not ok, search is disabled."));
+                        /* draw the search panel */
+                        draw_search(info_bar_panels[1], search_ib_win, search);
                     }
-
                 }
                 break;
 
@@ -1782,11 +1593,16 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
             case 'M':
                 if(traffic_log == 1)
                 {
-                    statevent(debuglvl, cnf, STATEVENTTYPE_LOG,
-                        &LogBufferList, /* no ct */NULL,
-                        /* no connreq*/NULL,
-                        zones, blocklist, interfaces,
-                        services);
+                    /* statevent wants the parsed rules */
+                    if(logview_logrules(debuglvl, &LogBuffer, &logrule_list) == 0)
+                    {
+                        statevent(debuglvl, cnf, STATEVENTTYPE_LOG,
+                            &logrule_list, /* no ct */NULL,
+                            /* no connreq*/NULL,
+                            zones, blocklist, interfaces,
+                            services);
+                    }
+                    d_list_cleanup(debuglvl, &logrule_list);
 
                     draw_top_menu(debuglvl, top_win,
                         gettext("Logview"), key_choices_n,
@@ -1836,54 +1652,29 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                 status_print(status_win, "buf_size: %u, max_onscr: %d, start: %d, o: %u, p: %d, q: %d, s: %d", buffer_size, max_onscreen, start_print, offset, control.print, control.queue, control.sleep);
         }
 
-        /* if we're filtered, check for each line if it will be printed */
-        if(use_filter)
+        /* if the queue is getting too full, print */
+        if(control.queue > (max_onscreen/3))
+            control.print = 1;
+
+        /*  if we're filtered, check for each line if it will be printed. Only
+            needed when we are going to print: this walks the buffer. */
+        if(use_filter && control.print)
         {
-            for(d_node = buffer_ptr->bot, run_count = 0, delta = 0, filtered_lines = 0;
+            for(run_count = 0, delta = 0, filtered_lines = 0;
                 run_count < buffer_size;
-                d_node = d_node->prev, run_count++)
+                run_count++)
             {
-                if(traffic_log)
+                rec = logring_get(buffer_ptr, buffer_size - run_count - 1);
+
+                if(rec->filtered == 0)
                 {
-                    if(!(logrule_ptr = d_node->data))
-                    {
-                        (void)vrprint.error(-1, VR_INTERR,
-                                "NULL pointer (in: %s:%d).",
-                                __FUNC__, __LINE__);
-                        return(-1);
-                    }
-        
-                    if(logrule_ptr->filtered == 0)
-                    {
-                        delta++;
-                        
-                        first_draw = buffer_size - run_count - 1;
-                    }
-                    else
-                    {
-                        filtered_lines++;
-                    }
+                    delta++;
+
+                    first_draw = buffer_size - run_count - 1;
                 }
                 else
                 {
-                    if(!(plainlogrule_ptr = d_node->data))
-                    {
-                        (void)vrprint.error(-1, VR_INTERR,
-                                "NULL pointer (in: %s:%d).",
-                                __FUNC__, __LINE__);
-                        return(-1);
-                    }
-        
-                    if(plainlogrule_ptr->filtered == 0)
-                    {
-                        delta++;
-
-                        first_draw = buffer_size - run_count - 1;
-                    }
-                    else
-                    {
-                        filtered_lines++;
-                    }
+                    filtered_lines++;
                 }
                 
                 if(delta == max_onscreen + offset)
@@ -1900,10 +1691,6 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
             if(debuglvl >= HIGH)
                 status_print(status_win, "filter :st: %d, max: %d, buf: %u, del: %d, fil: %d, run: %d, fir: %d, offset: %u", start_print, max_onscreen, buffer_size, delta, filtered_lines, run_count, first_draw, offset);
         }
-        
-        /* if the queue is getting too full, print */
-        if(control.queue > (max_onscreen/3))
-            control.print = 1;
 
         /* display counters for debuging */
         if(debuglvl >= LOW)
@@ -1917,6 +1704,8 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
                the queue. */
             if(search_mode)
             {
+                search_results = logsearch_matches(logsearch);
+
                 if(!control.pause)
                     status_print(status_win, gettext("Search in progress: %lu matches so far. SPACE to pause, 'S' to stop."), search_results);
                 else
@@ -1927,48 +1716,26 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
             werase(log_win);
 
             /* start the loop */
-            for(i=0, d_node = buffer_ptr->top, drawn_lines = 0; d_node ; d_node = d_node->next, i++)
+            for(i = start_print, drawn_lines = 0; i < buffer_ptr->len && drawn_lines < max_onscreen; i++)
             {
-                if(i >= start_print && drawn_lines < max_onscreen)
-                {
-                    cur_logrule_length = 0;
+                rec = logring_get(buffer_ptr, i);
 
-                    if(traffic_log)
-                    {
-                        if(!(logrule_ptr = d_node->data))
-                        {
-                            (void)vrprint.error(-1, VR_INTERR, "NULL pointer (in: %s).", __FUNC__);
-                            return(-1);
-                        }
+                if(use_filter && rec->filtered)
+                    continue;
 
-                        if(!use_filter || (use_filter && !logrule_ptr->filtered))
-                        {
-                            drawn_lines++;
-                    
-                            print_logrule(log_win, logrule_ptr, max_logrule_length, cur_logrule_length, hide_date, hide_action, hide_service, hide_from, hide_to, hide_prefix, hide_details);
-                        }
-                    }
-                    else
-                    {
-                        if(!(plainlogrule_ptr = d_node->data))
-                        {
-                            (void)vrprint.error(-1, VR_INTERR, "NULL pointer (in: %s).", __FUNC__);
-                            return(-1);
-                        }
+                cur_logrule_length = 0;
+                drawn_lines++;
 
-                        if(!use_filter || (use_filter && !plainlogrule_ptr->filtered))
-                        {
-                            drawn_lines++;
+                if(traffic_log)
+                {
+                    memset(&logrule, 0, sizeof(logrule));
+                    (void)logline2logrule(logring_line(buffer_ptr, rec), &logrule);
 
-                            print_plainlogrule(log_win, plainlogrule_ptr->line, max_logrule_length, cur_logrule_length);
-                        }
-                    }
+                    print_logrule(log_win, &logrule, max_logrule_length, cur_logrule_length, hide_date, hide_action, hide_service, hide_from, hide_to, hide_prefix, hide_details);
                 }
-                /*  when we have drawn the entire screen, there is no
-                    use in keep running through the loop. So break out. */
-                else if(drawn_lines >= max_onscreen)
+                else
                 {
-                    break;
+                    print_plainlogrule(log_win, logring_line(buffer_ptr, rec), max_logrule_length, cur_logrule_length);
                 }
             }
 
@@ -1980,14 +1747,6 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
             control.print = 0;
             control.queue = 0;
             control.sleep = 0;
-
-            /* if we are in search mode, there is no need to keep up with the log in real-time.
-               So we take some time to draw the screen. It will slow down the printing and thereby
-               the searching, but it will keep the log better readable
-               
-               furthermore it will decrease the load on the system during a search */
-            if(search_mode)
-                usleep(90000);
         }
 
         /* sleep for 1 tenth of a second if we want to sleep */
@@ -2008,7 +1767,8 @@ logview_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones,
     VR_filter_cleanup(debuglvl, &vfilter);
 
     nodelay(log_win, FALSE);
-    d_list_cleanup(debuglvl, buffer_ptr);
+    logring_cleanup(&LogBuffer);
+    logring_cleanup(&SearchBuffer);
 
     if(fclose(fp) < 0)
     {
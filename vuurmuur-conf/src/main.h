@@ -144,8 +144,6 @@ typedef struct
 
     char            draw_status;    /* draw the status stuff in the main_menu? */
 
-    char            iptrafvol_location[128];
-
     /*
         colors
     */
@@ -206,8 +204,6 @@ vc_cnf vccnf;
 /* default print mainmenu_status */
 #define DEFAULT_MAINMENU_STATUS     1
 
-#define DEFAULT_IPTRAFVOL_LOCATION  "/usr/bin/iptrafvol.pl"
-
 struct VuurmuurStatus_
 {
     d_list  StatusList;
@@ -387,6 +383,59 @@ int validate_commentfield(const int, char *, regex_t *);
 */
 int status_section(const int, struct vuurmuur_config *, Zones *, Interfaces *, Services *);
 
+/* interface counter sampler (ifsampler.c) */
+#define IFACE_SAMPLER_RING  60
+
+typedef struct IfaceSample_
+{
+    struct timeval      tv;
+
+    /* device was in /proc/net/dev */
+    char                found;
+
+    unsigned long long  recv_bytes,
+                        recv_packets,
+                        trans_bytes,
+                        trans_packets;
+
+    /* from the iptables snapshot */
+    unsigned long long  recv_host,
+                        send_host,
+                        recv_host_packets,
+                        send_host_packets,
+
+                        recv_net,
+                        send_net,
+                        recv_net_packets,
+                        send_net_packets;
+} IfaceSample;
+
+typedef struct IfaceSamples_
+{
+    char                device[32];
+
+    /* ring of samples, 'head' is the newest */
+    IfaceSample         ring[IFACE_SAMPLER_RING];
+    unsigned int        head;
+    unsigned int        count;
+} IfaceSamples;
+
+typedef struct IfaceSampler_
+{
+    /* list of IfaceSamples, one per device */
+    d_list              list;
+
+    /* getting the iptables counters failed, don't try again */
+    char                ipt_failed;
+} IfaceSampler;
+
+int iface_sampler_setup(const int, IfaceSampler *, Interfaces *);
+void iface_sampler_cleanup(const int, IfaceSampler *);
+IfaceSamples *iface_sampler_get(const int, IfaceSampler *, const char *);
+IfaceSample *iface_sampler_sample(IfaceSamples *, unsigned int);
+int iface_sampler_update(const int, struct vuurmuur_config *, IfaceSampler *, char);
+int iface_sampler_rate(IfaceSamples *, unsigned int, double *, double *);
+
 
 /*
     connections
@@ -424,6 +473,11 @@ int vc_apply_changes(const int debuglvl);
 */
 int trafvol_section(const int, Zones *, Interfaces *, Services *);
 
+/*
+    top talkers
+*/
+int toptalkers_section(const int, Zones *);
+
 /*
     about
 */
@@ -453,6 +507,37 @@ typedef struct LogRule_
     char details[256];
 } LogRule;
 
+/* logring: the lines of the logview */
+#define LOGRING_MAX_LINE    512
+
+typedef struct LogRingRecord_
+{
+    /* the line is at this offset in the arena */
+    unsigned int    offset;
+    unsigned short  len;
+
+    char            filtered;
+} LogRingRecord;
+
+typedef struct LogRing_
+{
+    LogRingRecord   *records;
+    unsigned int    size,
+                    head,   /* the oldest line */
+                    len;
+
+    char            *arena;
+    size_t          arena_size,
+                    arena_write;
+} LogRing;
+
+int logring_setup(const int, LogRing *, unsigned int);
+void logring_cleanup(LogRing *);
+void logring_clear(LogRing *);
+LogRingRecord *logring_get(LogRing *, unsigned int);
+LogRingRecord *logring_add(LogRing *, const char *);
+char *logring_line(LogRing *, LogRingRecord *);
+
 typedef struct ct_
 {
     /* hashes for the vuurmuur names */
@@ -470,7 +555,7 @@ typedef struct ct_
 
 int kill_connections_by_ip(const int debuglvl, struct vuurmuur_config *cnf, Conntrack *ct, char *srcip, char *dstip, char *sername, char connect_status);
 int block_and_kill(const int debuglvl, Conntrack *ct, Zones *zones, BlockList *blocklist, Interfaces *interfaces, char *ip);
-int kill_connection(const int debuglvl, char *cmd, char *srcip, char *dstip, int proto, int sp, int dp);
+int kill_connection(const int debuglvl, struct vuurmuur_config *cnf, char *srcip, char *dstip, int proto, int sp, int dp);
 int kill_connections_by_name(const int debuglvl, struct vuurmuur_config *cnf, Conntrack *ct, char *srcname, char *dstname, char *sername, char connect_status);
 
 Conntrack *conn_init_ct(const int debuglvl, Zones *zones, Interfaces *interfaces, Services *services, BlockList *blocklist );
@@ -480,6 +565,15 @@ void conn_ct_clear_connections(const int debuglvl, Conntrack *ct);
 
 void statevent(const int, struct vuurmuur_config *, int, d_list *, Conntrack *, VR_ConntrackRequest *, Zones *, BlockList *, Interfaces *, Services *);
 
+/* logsearch */
+typedef struct LogSearch_ LogSearch;
+
+LogSearch *logsearch_start(const int, const char *, const char *, const char *, unsigned int);
+int logsearch_getline(LogSearch *, char *, size_t);
+unsigned long logsearch_matches(LogSearch *);
+void logsearch_stop(LogSearch *);
+int logsearch_finish(const int, LogSearch *);
+
 
 /* length in chars (be it wide chars or normal chars) */
 static inline size_t
@@ -1120,6 +1120,28 @@ mm_update_overall_status(const int debuglvl)
 
 
 
+/* show the progress vuurmuur sends over the control channel */
+static int
+mm_reload_progress(const int debuglvl, void *ctx, int type, char *data, size_t len)
+{
+    FIELD   *fld = (FIELD *)ctx;
+    int     percent = 0;
+    char    str[4] = "";
+
+    if(type == CONTROL_PROGRESS && len == sizeof(percent))
+    {
+        memcpy(&percent, data, sizeof(percent));
+
+        (void)snprintf(str, sizeof(str), "%3d", percent);
+        set_field_buffer_wrap(debuglvl, fld, 0, str);
+        update_panels();
+        doupdate();
+    }
+
+    return(0);
+}
+
+
 static int
 mm_reload_shm(const int debuglvl)
 {
@@ -1151,6 +1173,7 @@ mm_reload_shm(const int debuglvl)
     char    str[4] = "";
 
     char    failed = 0;
+    char    vuurmuur_ctl = 0;
 
     /* reset the last reload result */
     last_vuurmuur_result = 1;
@@ -1197,8 +1220,39 @@ mm_reload_shm(const int debuglvl)
 
     (void)vrprint.audit(gettext("Applying changes ..."));
 
+    /* vuurmuur listens on the control channel: reload it there, which
+       returns as soon as it is done. Otherwise fall back to shm. */
+    if(control_request(debuglvl, CONTROL_SOCKET, CONTROL_RELOAD, NULL,
+            mm_reload_progress, vuurmuurfld, &vuurmuur_result) == 1)
+    {
+        vuurmuur_ctl = 1;
+        vuurmuur_progress = 100;
+        set_field_buffer_wrap(debuglvl, vuurmuurfld, 0, "100");
+
+        if(vuurmuur_result == VR_RR_SUCCES)
+        {
+            wattron(wait_win, vccnf.color_win_green);
+            mvwprintw(wait_win, 4, 29, SHM_REL_SUCCESS);
+            wattroff(wait_win, vccnf.color_win_green);
+        }
+        else if(vuurmuur_result == VR_RR_NOCHANGES)
+        {
+            mvwprintw(wait_win, 4, 29, SHM_REL_NO_CHANGES);
+        }
+        else
+        {
+            wattron(wait_win, vccnf.color_win_red);
+            mvwprintw(wait_win, 4, 29, SHM_REL_ERROR);
+            wattroff(wait_win, vccnf.color_win_red);
+
+            last_vuurmuur_result = 0;
+            failed = 1;
+        }
+
+        vuurmuur_result = VR_RR_READY;
+    }
     /* notify both vuurmuur and vuurmuurlog */
-    if(vuurmuur_semid != -1)
+    else if(vuurmuur_semid != -1)
     {
         if(LOCK(vuurmuur_semid))
         {
@@ -1264,7 +1318,7 @@ mm_reload_shm(const int debuglvl)
             set_field_buffer_wrap(debuglvl, vuurmuurfld, 0, str);
         }
 
-        if(vuurmuur_progress == 100)
+        if(vuurmuur_progress == 100 && vuurmuur_ctl == 0)
         {
             if(vuurmuur_semid == -1)
             {
@@ -118,6 +118,7 @@ struct ShapeRuleCnf_ {
     struct options *opt;
 
     char in_min[10], out_min[10], in_max[10], out_max[10], prio[4];
+    char leaf[16];
     char in_min_unit[5], out_min_unit[5], in_max_unit[5], out_max_unit[5];
 };
 
@@ -154,6 +155,7 @@ VrShapeRuleSetup(const int debuglvl, struct ShapeRuleCnf_ *c, struct options *op
         snprintf(c->out_max_unit, sizeof(c->out_max_unit), "%s", c->opt->bw_out_max_unit);
 
     snprintf(c->prio, sizeof(c->prio), "%u", c->opt->prio);
+    strlcpy(c->leaf, c->opt->shape_leaf, sizeof(c->leaf));
 
     return(0);
 }
@@ -183,6 +185,12 @@ VrShapeRuleSave(const int debuglvl, void *ctx, char *name, char *value)
         strlcpy(c->opt->bw_out_max_unit, value, sizeof(c->opt->bw_out_max_unit));
     } else if (strcmp(name,"prio") == 0) {
         c->opt->prio = atoi(value);
+    } else if (strcmp(name,"leaf") == 0) {
+        if (strcmp(value, "") != 0 && libvuurmuur_is_shape_leaf(debuglvl, value) == 0) {
+            (void)vrprint.error(-1, VR_ERR, gettext("'%s' is not a valid leaf qdisc. Use sfq, fq_codel, cake or fq."), value);
+            return(-1);
+        }
+        strlcpy(c->opt->shape_leaf, value, sizeof(c->opt->shape_leaf));
     }
 
     return(0);
@@ -201,7 +209,7 @@ void VrShapeRule(const int debuglvl, struct options *opt) {
     }
 
     /* create the window and put it in the middle of the screen */
-    win = VrNewWin(16,51,0,0,vccnf.color_win);
+    win = VrNewWin(18,51,0,0,vccnf.color_win);
     if (win == NULL)
     {
         (void)vrprint.error(-1, VR_ERR, "VrNewWin failed");
@@ -209,7 +217,7 @@ void VrShapeRule(const int debuglvl, struct options *opt) {
     }
     VrWinSetTitle(win, gettext("Shaping"));
 
-    form = VrNewForm(14, 58, 1, 1, 14, vccnf.color_win, vccnf.color_win | A_BOLD);
+    form = VrNewForm(16, 58, 1, 1, 16, vccnf.color_win, vccnf.color_win | A_BOLD);
 
     VrFormSetSaveFunc(debuglvl, form, VrShapeRuleSave, &config);
 
@@ -230,6 +238,9 @@ void VrShapeRule(const int debuglvl, struct options *opt) {
     VrFormAddLabelField(debuglvl, form, 1, 25, 9, 1,  vccnf.color_win, gettext("Priority"));
     VrFormAddTextField(debuglvl, form,  1,  5, 9, 28, vccnf.color_win_rev | A_BOLD, "prio", config.prio);
 
+    VrFormAddLabelField(debuglvl, form, 1, 25, 11, 1,  vccnf.color_win, gettext("Leaf qdisc"));
+    VrFormAddTextField(debuglvl, form,  1, 10, 11, 28, vccnf.color_win_rev | A_BOLD, "leaf", config.leaf);
+
     VrFormConnectToWin(debuglvl, form, win);
     VrFormPost(debuglvl, form);
     update_panels();
@@ -2476,6 +2476,8 @@ rename_service(const int debuglvl, Services *services, Rules *rules, char *cur_n
         (void)vrprint.error(-1, VR_INTERR, "servicename overflow (in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
     }
+    if(services_rehash(debuglvl, services, ser_ptr, old_ser_name) < 0)
+        return(-1);
     ser_ptr = NULL;
 
     /* update rules */
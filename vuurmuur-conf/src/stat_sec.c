@@ -185,6 +185,41 @@ int count_conntrack_conn(struct vuurmuur_config *cnf, int *conntrack_count,
     return(0);
 }
 
+/*  get_conntrack_count
+
+    Gets the number of connections from the counter the kernel keeps,
+    so we don't have to read the whole connection table for it.
+
+    Returncodes:
+         0: ok
+        -1: error (e.g. the kernel doesn't have the counter)
+*/
+int get_conntrack_count(int *conntrack_count)
+{
+    FILE    *fp = NULL;
+    char    proc_nf_conntrack_count[] = "/proc/sys/net/netfilter/nf_conntrack_count",
+            proc_ip_conntrack_count[] = "/proc/sys/net/ipv4/netfilter/ip_conntrack_count",
+            line[16] = "";
+    int     retval = -1;
+
+    if(!(fp = fopen(proc_nf_conntrack_count, "r"))) {
+        if(!(fp = fopen(proc_ip_conntrack_count, "r"))) {
+            return(-1);
+        }
+    }
+
+    if(fgets(line, (int)sizeof(line), fp) != NULL)
+    {
+        *conntrack_count = atoi(line);
+        retval = 0;
+    }
+
+    if(fclose(fp) < 0)
+        return(-1);
+
+    return(retval);
+}
+
 int get_conntrack_max(int *conntrack_max)
 {
     FILE    *fp = NULL;
@@ -678,6 +713,7 @@ status_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones, In
             conntrack_conn_tcp = 0,
             conntrack_conn_udp = 0,
             conntrack_conn_other = 0,
+            conntrack_conn_scanned = 0,
 
             mem_total=0,
             mem_free=0,
@@ -712,97 +748,57 @@ status_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones, In
     /* uname struct, for gettig the kernel version */
     struct utsname  uts_name;
 
-    /* the byte counters */
-    unsigned long   recv_bytes=0,
-                    trans_bytes=0,
-                    delta_bytes=0,
-                    speed_bytes=0;
+    /* the speed in bytes per second */
+    double          recv_speed_bytes = 0,
+                    send_speed_bytes = 0;
+    int             speed_ok = 0;
 
     /* load */
     float   load_s = 0, // 1 min
             load_m = 0, // 5 min
             load_l = 0; // 15 min
 
-    /* structure for storing byte counters per interface */
-    struct shadow_ifac_
-    {
-        char            calc;
-
-        unsigned long   prev_recv_bytes;
-        unsigned long   prev_send_bytes;
-
-        unsigned long   prev_recv_packets;
-        unsigned long   prev_send_packets;
-
-        unsigned long   cur_recv_bytes;
-        unsigned long   cur_send_bytes;
-
-        unsigned long   cur_recv_packets;
-        unsigned long   cur_send_packets;
-
-        unsigned long long  send_host,
-                            recv_host,
-
-                            send_host_packets,
-                            recv_host_packets,
-
-                            send_net,
-                            recv_net,
-                            
-                            send_net_packets,
-                            recv_net_packets;
-
-        /* for the correction of the speed */
-        struct timeval      begin_tv;
-        struct timeval      end_tv;
-    };
-
-    struct shadow_ifac_     *shadow_ptr=NULL;
+    /* the byte counters of all interfaces, sampled once per update */
+    IfaceSampler            sampler;
+    IfaceSamples            *samples_ptr = NULL;
+    IfaceSample             *sample_ptr = NULL;
     struct InterfaceData_   *iface_ptr=NULL;
 
     d_list_node             *d_node = NULL;
-    d_list_node             *shadow_node = NULL;
-
-    // list which will hold the structs analog to the interfaces list
-    d_list                  shadow_list;
-
-    // we correct the speed with the time it takes to get all stats
-    double                  elapse = 0;
-    float                   correction = 0;
 
     int                     update_interval = 1000000; /* weird, in pratice this seems to be two sec */
     int                     slept_so_far    = 1000000; /* time slept since last update */
 
+    /*  counting connections per protocol means reading the whole
+        connection table, which is expensive on a busy box. We only do
+        it when asked for (or when the kernel has no counter for the
+        total), and then at most every scan_interval, which grows with
+        the time the last scan took. */
+    char                    conn_details = FALSE;
+    int                     conn_count_result = 0,
+                            conn_scan_result = -1;
+    double                  scan_interval = 0,
+                            scan_time = 0;
+    struct timeval          scan_begin_tv,
+                            scan_end_tv,
+                            next_scan_tv;
+
     /* top menu */
     char                    *key_choices[] =    {   "F12",
+                                                    "d",
                                                     "F10"};
-    int                     key_choices_n = 2;
+    int                     key_choices_n = 3;
     char                    *cmd_choices[] =    {   gettext("help"),
+                                                    gettext("details"),
                                                     gettext("back")};
-    int                     cmd_choices_n = 2;
-
+    int                     cmd_choices_n = 3;
 
-    // first create our shadow list
-    if(d_list_setup(debuglvl, &shadow_list, free) < 0)
-        return(-1);
 
-    for(i=0; i < interfaces->list.len; i++)
+    /* one ring of counter samples per device */
+    if(iface_sampler_setup(debuglvl, &sampler, interfaces) < 0)
     {
-        if(!(shadow_ptr = malloc(sizeof(struct shadow_ifac_))))
-            return(-1);
-
-        shadow_ptr->calc = 1;
-
-        shadow_ptr->prev_recv_bytes = 0;
-        shadow_ptr->prev_send_bytes = 0;
-        shadow_ptr->cur_recv_bytes = 0;
-        shadow_ptr->cur_send_bytes = 0;
-
-        gettimeofday(&shadow_ptr->begin_tv, 0);
-
-        /* append to the list */
-        if(d_list_append(debuglvl, &shadow_list, shadow_ptr)  == NULL)
-            return(-1);
+        iface_sampler_cleanup(debuglvl, &sampler);
+        return(-1);
     }
 
     /* create the service and zone hash for conn_get_stats */
@@ -850,6 +846,9 @@ status_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones, In
 
     draw_top_menu(debuglvl, top_win, gettext("System Status"), key_choices_n, key_choices, cmd_choices_n, cmd_choices);
 
+    /* scan right away when needed */
+    gettimeofday(&next_scan_tv, 0);
+
     update_panels();
     doupdate();
 
@@ -887,16 +886,66 @@ status_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones, In
                 return(-1);
             }
 
-            if(count_conntrack_conn(cnf, &conntrack_conn_total, &conntrack_conn_tcp, &conntrack_conn_udp, &conntrack_conn_other) < 0)
+            /* the total is cheap if the kernel keeps count */
+            conn_count_result = get_conntrack_count(&conntrack_conn_total);
+
+            if(conn_details == TRUE || conn_count_result < 0)
             {
+                gettimeofday(&scan_begin_tv, 0);
+                if(timercmp(&scan_begin_tv, &next_scan_tv, >=))
+                {
+                    conn_scan_result = count_conntrack_conn(cnf,
+                            conn_count_result < 0 ? &conntrack_conn_total : &conntrack_conn_scanned,
+                            &conntrack_conn_tcp, &conntrack_conn_udp,
+                            &conntrack_conn_other);
+
+                    /* keep scanning below 5% of the time, between once
+                       per update and once per 30 seconds */
+                    gettimeofday(&scan_end_tv, 0);
+                    scan_time  = (double)scan_end_tv.tv_sec + (double)scan_end_tv.tv_usec * 1e-6;
+                    scan_time -= (double)scan_begin_tv.tv_sec + (double)scan_begin_tv.tv_usec * 1e-6;
+
+                    scan_interval = scan_time * 20;
+                    if(scan_interval > 30)
+                        scan_interval = 30;
+
+                    next_scan_tv.tv_sec = scan_end_tv.tv_sec + (time_t)scan_interval;
+                    next_scan_tv.tv_usec = scan_end_tv.tv_usec +
+                        (suseconds_t)((scan_interval - (time_t)scan_interval) * 1000000);
+                    if(next_scan_tv.tv_usec >= 1000000)
+                    {
+                        next_scan_tv.tv_sec++;
+                        next_scan_tv.tv_usec -= 1000000;
+                    }
+
+                    if(debuglvl >= LOW)
+                        (void)vrprint.debug(__FUNC__, "conntrack scan took %.3fs, next in %.3fs.",
+                                scan_time, scan_interval);
+                }
+
+                if(conn_count_result < 0)
+                    conn_count_result = conn_scan_result;
+            }
+
+            if(conn_count_result < 0)
                 snprintf(conn_total, sizeof(conn_total), gettext("error"));
+            else
+                snprintf(conn_total, sizeof(conn_total), "%6d", conntrack_conn_total);
+
+            if(conn_details == FALSE && conn_scan_result < 0)
+            {
+                snprintf(conn_tcp,   sizeof(conn_tcp),   "%6s", "-");
+                snprintf(conn_udp,   sizeof(conn_udp),   "%6s", "-");
+                snprintf(conn_other, sizeof(conn_other), "%6s", "-");
+            }
+            else if(conn_scan_result < 0)
+            {
                 snprintf(conn_tcp,   sizeof(conn_tcp),   gettext("error"));
                 snprintf(conn_udp,   sizeof(conn_udp),   gettext("error"));
                 snprintf(conn_other, sizeof(conn_other), gettext("error"));
             }
             else
             {
-                snprintf(conn_total, sizeof(conn_total), "%6d", conntrack_conn_total);
                 snprintf(conn_tcp,   sizeof(conn_tcp),   "%6d", conntrack_conn_tcp);
                 snprintf(conn_udp,   sizeof(conn_udp),   "%6d", conntrack_conn_udp);
                 snprintf(conn_other, sizeof(conn_other), "%6d", conntrack_conn_other);
@@ -1001,95 +1050,81 @@ status_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones, In
                 }
             }
 
+            /* sample the counters of all interfaces at once */
+            (void)iface_sampler_update(debuglvl, cnf, &sampler, TRUE);
+
             /* print interfaces, starting at line 13 */
-            for(cur_interface = 0, y = 13, d_node = interfaces->list.top, shadow_node = shadow_list.top;
+            for(cur_interface = 0, y = 13, d_node = interfaces->list.top;
                 d_node && y < max_height-8;
-                d_node = d_node->next, shadow_node = shadow_node->next)
+                d_node = d_node->next)
             {
-                unsigned long long  tmp_ull;
-
                 iface_ptr = d_node->data;
-                shadow_ptr = shadow_node->data;
 
                 /* only show real interfaces */
                 if(iface_ptr->device_virtual == FALSE)
                 {
-                    /* get the counters for determining speed */
-                    get_iface_stats(debuglvl, iface_ptr->device, &recv_bytes, NULL, &trans_bytes, NULL);
+                    IfaceSample empty_sample;
 
-                    /* get the real counters from iptables */
-                    get_iface_stats_from_ipt(debuglvl, iface_ptr->device, "INPUT", &shadow_ptr->recv_host_packets, &shadow_ptr->recv_host, &tmp_ull, &tmp_ull);
-                    get_iface_stats_from_ipt(debuglvl, iface_ptr->device, "OUTPUT", &tmp_ull, &tmp_ull, &shadow_ptr->send_host_packets, &shadow_ptr->send_host);
-                    get_iface_stats_from_ipt(debuglvl, iface_ptr->device, "FORWARD", &shadow_ptr->recv_net_packets, &shadow_ptr->recv_net, &shadow_ptr->send_net_packets, &shadow_ptr->send_net);
+                    samples_ptr = iface_sampler_get(debuglvl, &sampler, iface_ptr->device);
+                    if(!(sample_ptr = iface_sampler_sample(samples_ptr, 0)))
+                    {
+                        memset(&empty_sample, 0, sizeof(empty_sample));
+                        sample_ptr = &empty_sample;
+                    }
 
                     /* RECV host/firewall */
-                    if((shadow_ptr->recv_host/(1024*1024)) >= 1000)
+                    if((sample_ptr->recv_host/(1024*1024)) >= 1000)
                     {
-                        snprintf(recv_host, sizeof(recv_host), "%7.3f GB", (float)shadow_ptr->recv_host/(1024*1024*1024));
+                        snprintf(recv_host, sizeof(recv_host), "%7.3f GB", (float)sample_ptr->recv_host/(1024*1024*1024));
                         if(debuglvl >= HIGH)
                             (void)vrprint.debug(__FUNC__, "recv_host: '%s'.", recv_host);
                     }
-                    else if((shadow_ptr->recv_host/(1024*1024)) < 1)
-                        snprintf(recv_host, sizeof(recv_host), "%7d kb", (int)shadow_ptr->recv_host/(1024));
+                    else if((sample_ptr->recv_host/(1024*1024)) < 1)
+                        snprintf(recv_host, sizeof(recv_host), "%7d kb", (int)sample_ptr->recv_host/(1024));
                     else
-                        snprintf(recv_host, sizeof(recv_host), "%7.3f MB", (float)shadow_ptr->recv_host/(1024*1024));
+                        snprintf(recv_host, sizeof(recv_host), "%7.3f MB", (float)sample_ptr->recv_host/(1024*1024));
 
                     /* SEND host/firewall */
-                    if((shadow_ptr->send_host/(1024*1024)) >= 1000)
-                        snprintf(send_host, sizeof(send_host), "%7.3f GB", (float)shadow_ptr->send_host/(1024*1024*1024));
-                    else if((shadow_ptr->send_host/(1024*1024)) < 1)
-                        snprintf(send_host, sizeof(send_host), "%7d kb", (int)shadow_ptr->send_host/(1024));
+                    if((sample_ptr->send_host/(1024*1024)) >= 1000)
+                        snprintf(send_host, sizeof(send_host), "%7.3f GB", (float)sample_ptr->send_host/(1024*1024*1024));
+                    else if((sample_ptr->send_host/(1024*1024)) < 1)
+                        snprintf(send_host, sizeof(send_host), "%7d kb", (int)sample_ptr->send_host/(1024));
                     else
-                        snprintf(send_host, sizeof(send_host), "%7.3f MB", (float)shadow_ptr->send_host/(1024*1024));
+                        snprintf(send_host, sizeof(send_host), "%7.3f MB", (float)sample_ptr->send_host/(1024*1024));
 
                     /* RECV net/forward */
-                    if((shadow_ptr->recv_net/(1024*1024)) >= 1000)
-                        snprintf(recv_net, sizeof(recv_net), "%7.3f GB", (float)shadow_ptr->recv_net/(1024*1024*1024));
-                    else if((shadow_ptr->recv_net/(1024*1024)) < 1)
-                        snprintf(recv_net, sizeof(recv_net), "%7d kb", (int)shadow_ptr->recv_net/(1024));
+                    if((sample_ptr->recv_net/(1024*1024)) >= 1000)
+                        snprintf(recv_net, sizeof(recv_net), "%7.3f GB", (float)sample_ptr->recv_net/(1024*1024*1024));
+                    else if((sample_ptr->recv_net/(1024*1024)) < 1)
+                        snprintf(recv_net, sizeof(recv_net), "%7d kb", (int)sample_ptr->recv_net/(1024));
                     else
-                        snprintf(recv_net, sizeof(recv_net), "%7.3f MB", (float)shadow_ptr->recv_net/(1024*1024));
+                        snprintf(recv_net, sizeof(recv_net), "%7.3f MB", (float)sample_ptr->recv_net/(1024*1024));
 
                     /* SEND net/forward */
-                    if((shadow_ptr->send_net/(1024*1024)) >= 1000)
-                        snprintf(send_net, sizeof(send_net), "%7.3f GB", (float)shadow_ptr->send_net/(1024*1024*1024));
-                    else if((shadow_ptr->send_net/(1024*1024)) < 1)
-                        snprintf(send_net, sizeof(send_net), "%7d kb", (int)shadow_ptr->send_net/(1024));
+                    if((sample_ptr->send_net/(1024*1024)) >= 1000)
+                        snprintf(send_net, sizeof(send_net), "%7.3f GB", (float)sample_ptr->send_net/(1024*1024*1024));
+                    else if((sample_ptr->send_net/(1024*1024)) < 1)
+                        snprintf(send_net, sizeof(send_net), "%7d kb", (int)sample_ptr->send_net/(1024));
                     else
-                        snprintf(send_net, sizeof(send_net), "%7.3f MB", (float)shadow_ptr->send_net/(1024*1024));
-
-                    /* store the number of bytes */
-                    shadow_ptr->cur_recv_bytes = recv_bytes;
-                    shadow_ptr->cur_send_bytes = trans_bytes;
-
-                    /* get the time we needed for our run */
-                    gettimeofday(&shadow_ptr->end_tv, 0);
-                    elapse  = (double)shadow_ptr->end_tv.tv_sec + (double)shadow_ptr->end_tv.tv_usec * 1e-6;
-                    elapse -= (double)shadow_ptr->begin_tv.tv_sec + (double)shadow_ptr->begin_tv.tv_usec * 1e-6;
-                    gettimeofday(&shadow_ptr->begin_tv, 0);
+                        snprintf(send_net, sizeof(send_net), "%7.3f MB", (float)sample_ptr->send_net/(1024*1024));
 
-                    /* this the correction value */
-                    correction = elapse;
-
-                    /* this is the value to be corrected */
-                    delta_bytes = (shadow_ptr->cur_recv_bytes - shadow_ptr->prev_recv_bytes);
-                    /* now we correct it */
-                    speed_bytes = (delta_bytes/correction);
+                    /* speed over the last update */
+                    speed_ok = iface_sampler_rate(samples_ptr, 1, &recv_speed_bytes, &send_speed_bytes);
 
                     if(debuglvl >= HIGH)
-                        (void)vrprint.debug(__FUNC__, "bytes: %d, corrections: %f", (int)speed_bytes, correction);
+                        (void)vrprint.debug(__FUNC__, "recv: %.0f, send: %.0f", recv_speed_bytes, send_speed_bytes);
 
                     /* calculating the current connection speed */
                     if(iface_ptr->up == TRUE)
                     {
-                        if(shadow_ptr->calc == 1)
+                        if(speed_ok < 0)
                             snprintf(recv_speed, sizeof(recv_speed), "calc");
-                        else if((speed_bytes/1024) < 1)
-                            snprintf(recv_speed, sizeof(recv_speed), "%5d b", (int)speed_bytes);
-                        else if((speed_bytes/1024) >= 1024)
-                            snprintf(recv_speed, sizeof(recv_speed), "%5.1f mb", (float)speed_bytes/(1024*1024));
+                        else if((recv_speed_bytes/1024) < 1)
+                            snprintf(recv_speed, sizeof(recv_speed), "%5d b", (int)recv_speed_bytes);
+                        else if((recv_speed_bytes/1024) >= 1024)
+                            snprintf(recv_speed, sizeof(recv_speed), "%5.1f mb", (float)recv_speed_bytes/(1024*1024));
                         else
-                            snprintf(recv_speed, sizeof(recv_speed), "%5.1f kb", (float)speed_bytes/1024);
+                            snprintf(recv_speed, sizeof(recv_speed), "%5.1f kb", (float)recv_speed_bytes/1024);
                     }
                     else
                     {
@@ -1097,21 +1132,16 @@ status_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones, In
                     }
 
 
-                    /* this is the value to be corrected */
-                    delta_bytes = (shadow_ptr->cur_send_bytes - shadow_ptr->prev_send_bytes);
-                    /* now we correct it */
-                    delta_bytes = (delta_bytes/correction);
-
                     if(iface_ptr->up == TRUE)
                     {
-                        if(shadow_ptr->calc == 1)
+                        if(speed_ok < 0)
                             snprintf(send_speed, sizeof(send_speed), "calc");
-                        else if((delta_bytes/1024) < 1)
-                            snprintf(send_speed, sizeof(send_speed), "%5d b", (int)delta_bytes);
-                        else if((delta_bytes/1024) >= 1024)
-                            snprintf(send_speed, sizeof(send_speed), "%5.1f mb", (float)delta_bytes/(1024*1024));
+                        else if((send_speed_bytes/1024) < 1)
+                            snprintf(send_speed, sizeof(send_speed), "%5d b", (int)send_speed_bytes);
+                        else if((send_speed_bytes/1024) >= 1024)
+                            snprintf(send_speed, sizeof(send_speed), "%5.1f mb", (float)send_speed_bytes/(1024*1024));
                         else
-                            snprintf(send_speed, sizeof(send_speed), "%5.1f kb", (float)delta_bytes/1024);
+                            snprintf(send_speed, sizeof(send_speed), "%5.1f kb", (float)send_speed_bytes/1024);
                     }
                     else
                     {
@@ -1155,17 +1185,8 @@ status_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones, In
                     if(iface_ptr->up == TRUE)
                         wattroff(StatusSection.win, vccnf.color_win|A_BOLD);
 
-                    /* store the number of bytes */
-                    shadow_ptr->prev_recv_bytes = recv_bytes;
-                    shadow_ptr->prev_send_bytes = trans_bytes;
-
                     y++;
 
-                    /*  after the first run we are no
-                        longer calculating. */
-                    if(shadow_ptr->calc > 0)
-                        shadow_ptr->calc--;
-
                 } /* end if virtual device */
             }
 
@@ -1193,6 +1214,22 @@ status_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones, In
             case '?':
                 print_help(debuglvl, ":[VUURMUUR:STATUS]:");
                 break;
+
+            /* toggle the per protocol connection counts */
+            case 'd':
+            case 'D':
+                if(conn_details == FALSE)
+                    conn_details = TRUE;
+                else
+                {
+                    conn_details = FALSE;
+                    conn_scan_result = -1;
+                }
+                gettimeofday(&next_scan_tv, 0);
+
+                /* update the screen now */
+                slept_so_far = update_interval;
+                break;
         }
 
         if(quit == 0)
@@ -1205,8 +1242,8 @@ status_section(const int debuglvl, struct vuurmuur_config *cnf, Zones *zones, In
         }
     }
 
-    /* destroy hashtables and the shadowlist */
-    d_list_cleanup(debuglvl, &shadow_list);
+    /* destroy the samples */
+    iface_sampler_cleanup(debuglvl, &sampler);
 
     /* EXIT: cleanup */
     nodelay(StatusSection.win, FALSE);
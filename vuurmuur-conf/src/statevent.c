@@ -603,17 +603,12 @@ statevent_interactivemenu_conn( const int debuglvl, struct vuurmuur_config *cnf,
                     {
                         case 1: /* kill */
                         {
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else if(con->cnt == 1)
+                            if(con->cnt == 1)
                             {
                                 if(confirm(gettext("Kill connection"),gettext("Are you sure?"),
                                     vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                                 {
-                                    kill_connection(debuglvl, conf.conntrack_location,
+                                    kill_connection(debuglvl, &conf,
                                         con->src_ip, con->dst_ip, con->protocol,
                                         con->src_port, con->dst_port);
                                 }
@@ -634,12 +629,7 @@ statevent_interactivemenu_conn( const int debuglvl, struct vuurmuur_config *cnf,
                         }
 
                         case 2: /* kill all src ip */
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
+                            if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
                                 vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                             {
                                 kill_connections_by_ip(debuglvl, &conf, ct, con->src_ip, NULL, NULL, CONN_UNUSED);
@@ -647,12 +637,7 @@ statevent_interactivemenu_conn( const int debuglvl, struct vuurmuur_config *cnf,
                             break;
 
                         case 3: /* kill all dst ip */
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
+                            if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
                                 vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                             {
                                 kill_connections_by_ip(debuglvl, &conf, ct, NULL, con->dst_ip, NULL, CONN_UNUSED);
@@ -660,12 +645,7 @@ statevent_interactivemenu_conn( const int debuglvl, struct vuurmuur_config *cnf,
                             break;
 
                         case 4:
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
+                            if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
                                 vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                             {
                                 kill_connections_by_ip(debuglvl, &conf, ct, NULL, con->src_ip, NULL, CONN_UNUSED);
@@ -674,12 +654,7 @@ statevent_interactivemenu_conn( const int debuglvl, struct vuurmuur_config *cnf,
                             break;
 
                         case 5:
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
+                            if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
                                 vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                             {
                                 kill_connections_by_ip(debuglvl, &conf, ct, NULL, con->dst_ip, NULL, CONN_UNUSED);
@@ -897,30 +872,17 @@ statevent_interactivemenu_log(  const int debuglvl, struct vuurmuur_config *cnf,
                     {
                         case 1: /* kill */
                         {
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else
+                            if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
+                                vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                             {
-                                if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
-                                    vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
-                                {
-                                    kill_connections_by_ip(debuglvl, &conf, ctr,
-                                        log->src_ip, log->dst_ip, log->ser, CONN_UNUSED);
-                                }
+                                kill_connections_by_ip(debuglvl, &conf, ctr,
+                                    log->src_ip, log->dst_ip, log->ser, CONN_UNUSED);
                             }
                             break;
                         }
 
                         case 2: /* kill all src ip */
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
+                            if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
                                 vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                             {
                                 kill_connections_by_ip(debuglvl, &conf, ctr, log->src_ip, NULL, NULL, CONN_UNUSED);
@@ -928,12 +890,7 @@ statevent_interactivemenu_log(  const int debuglvl, struct vuurmuur_config *cnf,
                             break;
 
                         case 3: /* kill all dst ip */
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
+                            if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
                                 vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                             {
                                 kill_connections_by_ip(debuglvl, &conf, ctr, NULL, log->dst_ip, NULL, CONN_UNUSED);
@@ -941,12 +898,7 @@ statevent_interactivemenu_log(  const int debuglvl, struct vuurmuur_config *cnf,
                             break;
 
                         case 4:
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
+                            if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
                                 vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                             {
                                 kill_connections_by_ip(debuglvl, &conf, ctr, NULL, log->src_ip, NULL, CONN_UNUSED);
@@ -955,12 +907,7 @@ statevent_interactivemenu_log(  const int debuglvl, struct vuurmuur_config *cnf,
                             break;
                 
                         case 5:
-                            /* check if the conntrack tool is set */
-                            if(conf.conntrack_location[0] == '\0')
-                            {
-                                (void)vrprint.error(-1, VR_ERR, STR_CONNTRACK_LOC_NOT_SET);
-                            }
-                            else if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
+                            if(confirm(gettext("Kill connections"),gettext("Are you sure?"),
                                 vccnf.color_win_note, vccnf.color_win_note_rev|A_BOLD, 1) == 1)
                             {
                                 kill_connections_by_ip(debuglvl, &conf, ctr, NULL, log->dst_ip, NULL, CONN_UNUSED);
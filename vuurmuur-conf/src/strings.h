@@ -79,6 +79,8 @@
 #define STR_IN_UNIT         gettext("Incoming unit")
 #define STR_OUT_UNIT        gettext("Outgoing unit")
 #define STR_SHAPE           gettext("Shaping")
+#define STR_SHAPE_LEAF      gettext("Leaf qdisc")
+#define STR_SHAPE_OFFLOAD   gettext("Shaping offload")
 #define STR_TCPMSS          gettext("Tcpmss")
 
 /* TRANSLATORS: "interface 'lan' has been changed: rules are changed: number of rules: 5 (listed below)." */
@@ -201,6 +203,5 @@
 #define STR_REDIRECT_REQUIRES_OPT   gettext("the action 'Redirect' requires the 'Redirect port' option to be set.")
 
 
-#define STR_CONNTRACK_LOC_NOT_SET   gettext("'conntrack' location not set. To be able to kill connections, set the location of the 'conntrack' tool in 'Vuurmuur Options -> General'. Note that the tool requires kernel version 2.6.14 or higher.")
 
 #endif
@@ -0,0 +1,593 @@
+/***************************************************************************
+ *   Copyright (C) 2003-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "main.h"
+
+/*
+    Top talkers
+
+    Shows the hosts, networks or zones that transferred the most in the
+    last hour, today or this month. The daemon keeps the counters in the
+    host store (see hostacc.c in the daemon, trafvol.c in libvuurmuur)
+    when HOST_ACCOUNTING is enabled. Zones are the sum of their networks.
+*/
+
+#define TOPTALK_HASH_ROWS   1024
+
+/* refresh every 5 seconds, the daemon samples every minute */
+#define TOPTALK_INTERVAL    5000000
+
+enum
+{
+    TOPTALK_HOSTS = 0,
+    TOPTALK_NETWORKS,
+    TOPTALK_ZONES,
+    TOPTALK_MODES
+};
+
+enum
+{
+    TOPTALK_LASTHOUR = 0,
+    TOPTALK_TODAY,
+    TOPTALK_MONTH,
+    TOPTALK_PERIODS
+};
+
+/* a host or network by the name of its series in the store */
+struct TopTalkAddr_
+{
+    char                addr[24];   /* keep this first, we hash on it */
+    ZoneData            *zone_ptr;
+};
+
+struct TopTalkRow_
+{
+    char                name[MAX_HOST_NET_ZONE];
+    char                addr[24];
+    unsigned long long  in_bytes;
+    unsigned long long  out_bytes;
+};
+
+struct TopTalkSection_
+{
+    PANEL               *panel[1];
+    WINDOW              *win;
+
+    struct TopTalkRow_  *rows;
+    unsigned int        rows_n;
+
+    /* the name column gets what is left of the width of the screen */
+    int                 name_width;
+
+} TopTalkSection;
+
+
+static int
+toptalk_netmask_to_cidr(const char *netmask)
+{
+    struct in_addr  mask;
+    unsigned long   m = 0;
+    int             cidr = 0;
+
+    if(inet_pton(AF_INET, netmask, &mask) != 1)
+        return(-1);
+
+    for(m = ntohl(mask.s_addr); m & 0x80000000UL; m = (m << 1) & 0xffffffffUL)
+        cidr++;
+
+    return(cidr);
+}
+
+
+/*  toptalk_setup_addrs
+
+    Builds the lookup of the series names ("h:<ip>", "n:<net>/<cidr>")
+    to the hosts and networks.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+toptalk_setup_addrs(const int debuglvl, Zones *zones, d_list *list, Hash *hash)
+{
+    d_list_node         *d_node = NULL;
+    ZoneData            *zone_ptr = NULL;
+    struct TopTalkAddr_ *addr_ptr = NULL;
+    int                 cidr = 0;
+
+    for(d_node = zones->list.top; d_node != NULL; d_node = d_node->next)
+    {
+        zone_ptr = d_node->data;
+        if(zone_ptr == NULL)
+            continue;
+
+        if(zone_ptr->type != TYPE_HOST && zone_ptr->type != TYPE_NETWORK)
+            continue;
+
+        if(!(addr_ptr = calloc(1, sizeof(struct TopTalkAddr_))))
+        {
+            (void)vrprint.error(-1, VR_ERR, gettext("calloc failed: %s (in: %s:%d)."),
+                    strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+        addr_ptr->zone_ptr = zone_ptr;
+
+        if(zone_ptr->type == TYPE_HOST)
+        {
+            snprintf(addr_ptr->addr, sizeof(addr_ptr->addr), "h:%s", zone_ptr->ipv4.ipaddress);
+        }
+        else
+        {
+            if((cidr = toptalk_netmask_to_cidr(zone_ptr->ipv4.netmask)) < 0)
+            {
+                free(addr_ptr);
+                continue;
+            }
+            if(snprintf(addr_ptr->addr, sizeof(addr_ptr->addr), "n:%s/%d",
+                    zone_ptr->ipv4.network, cidr) >= (int)sizeof(addr_ptr->addr))
+            {
+                free(addr_ptr);
+                continue;
+            }
+        }
+
+        if(d_list_append(debuglvl, list, addr_ptr) == NULL)
+        {
+            free(addr_ptr);
+            return(-1);
+        }
+
+        /* the first host with an address wins */
+        if(hash_search(debuglvl, hash, addr_ptr) == NULL &&
+            hash_insert(debuglvl, hash, addr_ptr) != 0)
+            return(-1);
+    }
+
+    return(0);
+}
+
+
+/* sort the biggest total first */
+static int
+toptalk_compare(const void *a, const void *b)
+{
+    const struct TopTalkRow_    *ra = a,
+                                *rb = b;
+    unsigned long long          ta = ra->in_bytes + ra->out_bytes,
+                                tb = rb->in_bytes + rb->out_bytes;
+
+    if(ta > tb)
+        return(-1);
+    if(ta < tb)
+        return(1);
+
+    return(strcmp(ra->name, rb->name));
+}
+
+
+/*  toptalk_load
+
+    Fills TopTalkSection.rows from the host store for 'mode' and
+    'period', sorted by the total.
+
+    Returncodes:
+         1: ok
+         0: no store (yet)
+        -1: error
+*/
+static int
+toptalk_load(const int debuglvl, Hash *addr_hash, int mode, int period)
+{
+    TrafVolStore        store;
+    struct TopTalkAddr_ search,
+                        *addr_ptr = NULL;
+    struct TopTalkRow_  *row = NULL;
+    const char          *name = NULL;
+    char                prefix = (mode == TOPTALK_HOSTS) ? 'h' : 'n';
+    unsigned long long  in_bytes = 0,
+                        out_bytes = 0;
+    unsigned int        series = 0,
+                        i = 0,
+                        count = 0;
+    int                 unit = 0,
+                        result = 0;
+    time_t              now = time(NULL),
+                        start = 0;
+    struct tm           now_tm,
+                        start_tm;
+
+    TopTalkSection.rows_n = 0;
+
+    if(localtime_r(&now, &now_tm) == NULL)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "converting current time failed (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    /* the buckets of the period, the current one included */
+    if(period == TOPTALK_LASTHOUR)
+    {
+        unit = TRAFVOL_MINUTE;
+        start = now - 59 * 60;
+        count = 60;
+    }
+    else if(period == TOPTALK_TODAY)
+    {
+        unit = TRAFVOL_HOUR;
+        start_tm = now_tm;
+        start_tm.tm_hour = 0;
+        start_tm.tm_min = 0;
+        start_tm.tm_sec = 0;
+        start_tm.tm_isdst = -1;
+        start = mktime(&start_tm);
+        count = (unsigned int)now_tm.tm_hour + 1;
+    }
+    else
+    {
+        /* at noon, so daylight saving time can't move us to another day */
+        unit = TRAFVOL_DAY;
+        start_tm = now_tm;
+        start_tm.tm_mday = 1;
+        start_tm.tm_hour = 12;
+        start_tm.tm_min = 0;
+        start_tm.tm_sec = 0;
+        start_tm.tm_isdst = -1;
+        start = mktime(&start_tm);
+        count = (unsigned int)now_tm.tm_mday;
+    }
+
+    if(start == -1)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "converting the period failed (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if((result = trafvol_open(debuglvl, &store, HOSTVOL_LOCATION, FALSE, NULL)) != 0)
+        return(result == 1 ? 0 : -1);
+
+    free(TopTalkSection.rows);
+    if(!(TopTalkSection.rows = calloc(trafvol_count(&store) + 1, sizeof(struct TopTalkRow_))))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("calloc failed: %s (in: %s:%d)."),
+                strerror(errno), __FUNC__, __LINE__);
+        trafvol_close(debuglvl, &store);
+        return(-1);
+    }
+
+    for(series = 0; series < trafvol_count(&store); series++)
+    {
+        if(!(name = trafvol_name(&store, series)) || name[0] != prefix)
+            continue;
+
+        if(trafvol_get(debuglvl, &store, series, unit, start, count, &in_bytes, &out_bytes) != 1)
+            continue;
+        if(in_bytes == 0 && out_bytes == 0)
+            continue;
+
+        (void)strlcpy(search.addr, name, sizeof(search.addr));
+        addr_ptr = hash_search(debuglvl, addr_hash, &search);
+
+        if(mode == TOPTALK_ZONES)
+        {
+            /* a network we don't know anymore has no zone */
+            if(addr_ptr == NULL)
+                continue;
+
+            /* there are only a few zones, so just look */
+            for(i = 0, row = NULL; i < TopTalkSection.rows_n; i++)
+            {
+                if(strcmp(TopTalkSection.rows[i].name, addr_ptr->zone_ptr->zone_name) == 0)
+                {
+                    row = &TopTalkSection.rows[i];
+                    break;
+                }
+            }
+            if(row == NULL)
+            {
+                row = &TopTalkSection.rows[TopTalkSection.rows_n++];
+                (void)strlcpy(row->name, addr_ptr->zone_ptr->zone_name, sizeof(row->name));
+            }
+        }
+        else
+        {
+            row = &TopTalkSection.rows[TopTalkSection.rows_n++];
+            (void)strlcpy(row->name, addr_ptr ? addr_ptr->zone_ptr->name : "-", sizeof(row->name));
+            (void)strlcpy(row->addr, name + 2, sizeof(row->addr));
+        }
+
+        row->in_bytes += in_bytes;
+        row->out_bytes += out_bytes;
+    }
+
+    trafvol_close(debuglvl, &store);
+
+    qsort(TopTalkSection.rows, TopTalkSection.rows_n, sizeof(struct TopTalkRow_), toptalk_compare);
+    return(1);
+}
+
+
+static void
+toptalk_bytes(char *str, size_t len, unsigned long long bytes)
+{
+    if(bytes < 1024ULL * 10)
+        snprintf(str, len, "%lluB", bytes);
+    else if(bytes < 1024ULL * 1024 * 10)
+        snprintf(str, len, "%lluK", bytes / 1024);
+    else if(bytes < 1024ULL * 1024 * 1024 * 10)
+        snprintf(str, len, "%lluM", bytes / (1024 * 1024));
+    else
+        snprintf(str, len, "%lluG", bytes / (1024 * 1024 * 1024));
+}
+
+
+static void
+toptalk_draw(const int debuglvl, int result, int mode, int period, unsigned int offset, int lines)
+{
+    const char          *modes[TOPTALK_MODES] = { gettext("hosts"), gettext("networks"), gettext("zones") };
+    const char          *periods[TOPTALK_PERIODS] = { gettext("last hour"), gettext("today"), gettext("this month") };
+    struct TopTalkRow_  *row = NULL;
+    char                in_str[24] = "",
+                        out_str[24] = "",
+                        total_str[24] = "";
+    unsigned int        i = 0;
+    int                 y = 0;
+
+    werase(TopTalkSection.win);
+    box(TopTalkSection.win, 0, 0);
+
+    mvwprintw(TopTalkSection.win, 1, 2, "%s: %-12s %s: %s", gettext("Period"), periods[period],
+            gettext("Show"), modes[mode]);
+
+    wattron(TopTalkSection.win, A_BOLD);
+    mvwprintw(TopTalkSection.win, 3, 1, "%3s  %-*.*s %-18.18s %8s %8s %8s", "#",
+            TopTalkSection.name_width, TopTalkSection.name_width,
+            gettext("Name"), mode == TOPTALK_ZONES ? "" : gettext("Address"),
+            gettext("In"), gettext("Out"), gettext("Total"));
+    wattroff(TopTalkSection.win, A_BOLD);
+
+    if(result == 0)
+    {
+        mvwprintw(TopTalkSection.win, 5, 2, "%s", gettext("No data. Is HOST_ACCOUNTING enabled in the Vuurmuur config?"));
+    }
+    else if(result < 0)
+    {
+        mvwprintw(TopTalkSection.win, 5, 2, "%s", gettext("Reading the host traffic volume store failed."));
+    }
+    else if(TopTalkSection.rows_n == 0)
+    {
+        mvwprintw(TopTalkSection.win, 5, 2, "%s", gettext("No traffic in this period."));
+    }
+
+    for(i = offset, y = 4; result > 0 && i < TopTalkSection.rows_n && y < 4 + lines; i++, y++)
+    {
+        row = &TopTalkSection.rows[i];
+
+        toptalk_bytes(in_str, sizeof(in_str), row->in_bytes);
+        toptalk_bytes(out_str, sizeof(out_str), row->out_bytes);
+        toptalk_bytes(total_str, sizeof(total_str), row->in_bytes + row->out_bytes);
+
+        mvwprintw(TopTalkSection.win, y, 1, "%3u  %-*.*s %-18.18s %8s %8s %8s",
+                i + 1, TopTalkSection.name_width, TopTalkSection.name_width,
+                row->name, row->addr, in_str, out_str, total_str);
+    }
+}
+
+
+/*  toptalkers_section
+
+    Shows the top talkers. Keys: 'p' switches the period, 'm' between
+    hosts, networks and zones.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+toptalkers_section(const int debuglvl, Zones *zones)
+{
+    d_list          addr_list;
+    Hash            addr_hash;
+    int             quit = 0,
+                    ch = 0,
+                    retval = 0,
+                    result = 0,
+                    mode = TOPTALK_HOSTS,
+                    period = TOPTALK_LASTHOUR,
+                    max_height = 0,
+                    max_width = 0,
+                    lines = 0,
+                    slept_so_far = TOPTALK_INTERVAL;
+    unsigned int    offset = 0;
+    char            redraw = TRUE;
+
+    /* top menu */
+    char            *key_choices[] = {  "p",
+                                        "m",
+                                        "F12",
+                                        "F10"};
+    int             key_choices_n = 4;
+    char            *cmd_choices[] = {  gettext("period"),
+                                        gettext("mode"),
+                                        gettext("help"),
+                                        gettext("back")};
+    int             cmd_choices_n = 4;
+
+    /* safety */
+    if(zones == NULL)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(d_list_setup(debuglvl, &addr_list, free) < 0)
+        return(-1);
+    if(hash_setup(debuglvl, &addr_hash, TOPTALK_HASH_ROWS, hash_name, compare_string) != 0)
+    {
+        (void)d_list_cleanup(debuglvl, &addr_list);
+        return(-1);
+    }
+
+    if(toptalk_setup_addrs(debuglvl, zones, &addr_list, &addr_hash) < 0)
+    {
+        (void)hash_cleanup(debuglvl, &addr_hash);
+        (void)d_list_cleanup(debuglvl, &addr_list);
+        return(-1);
+    }
+
+    getmaxyx(stdscr, max_height, max_width);
+    lines = max_height - 6 - 5;
+
+    memset(&TopTalkSection, 0, sizeof(TopTalkSection));
+
+    /* the other columns and the border take 53 */
+    TopTalkSection.name_width = max_width - 2 - 53;
+    if(TopTalkSection.name_width < 10)
+        TopTalkSection.name_width = 10;
+
+    if(!(TopTalkSection.win = create_newwin(max_height - 6, max_width - 2, 3, 1,
+            gettext("Top Talkers"), vccnf.color_win)))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("creating window failed."));
+        retval = -1;
+    }
+    else if(!(TopTalkSection.panel[0] = new_panel(TopTalkSection.win)))
+    {
+        (void)vrprint.error(-1, VR_ERR, gettext("creating panel failed."));
+        destroy_win(TopTalkSection.win);
+        retval = -1;
+    }
+
+    if(retval == 0)
+    {
+        /* make sure wgetch doesn't block */
+        nodelay(TopTalkSection.win, TRUE);
+        keypad(TopTalkSection.win, TRUE);
+
+        draw_top_menu(debuglvl, top_win, gettext("Top Talkers"), key_choices_n, key_choices, cmd_choices_n, cmd_choices);
+    }
+
+    while(quit == 0 && retval == 0)
+    {
+        if(slept_so_far >= TOPTALK_INTERVAL)
+        {
+            slept_so_far = 0;
+            result = toptalk_load(debuglvl, &addr_hash, mode, period);
+            redraw = TRUE;
+        }
+
+        if(redraw == TRUE)
+        {
+            if(offset >= TopTalkSection.rows_n)
+                offset = 0;
+
+            toptalk_draw(debuglvl, result, mode, period, offset, lines);
+            update_panels();
+            doupdate();
+            redraw = FALSE;
+        }
+
+        ch = wgetch(TopTalkSection.win);
+        switch(ch)
+        {
+            /* quit */
+            case 27:
+            case 'q':
+            case 'Q':
+            case KEY_F(10):
+                quit = 1;
+                break;
+
+            case 'p':
+            case 'P':
+                period = (period + 1) % TOPTALK_PERIODS;
+                slept_so_far = TOPTALK_INTERVAL;
+                break;
+
+            case 'm':
+            case 'M':
+                mode = (mode + 1) % TOPTALK_MODES;
+                offset = 0;
+                slept_so_far = TOPTALK_INTERVAL;
+                break;
+
+            case KEY_DOWN:
+                if(offset + (unsigned int)lines < TopTalkSection.rows_n)
+                {
+                    offset++;
+                    redraw = TRUE;
+                }
+                break;
+
+            case KEY_UP:
+                if(offset > 0)
+                {
+                    offset--;
+                    redraw = TRUE;
+                }
+                break;
+
+            case KEY_NPAGE:
+                if(offset + (unsigned int)lines < TopTalkSection.rows_n)
+                {
+                    offset += (unsigned int)lines;
+                    redraw = TRUE;
+                }
+                break;
+
+            case KEY_PPAGE:
+                offset = (offset > (unsigned int)lines) ? offset - (unsigned int)lines : 0;
+                redraw = TRUE;
+                break;
+
+            case KEY_F(12):
+            case 'h':
+            case 'H':
+            case '?':
+                print_help(debuglvl, ":[VUURMUUR:TOPTALKERS]:");
+                redraw = TRUE;
+                break;
+        }
+
+        if(quit == 0)
+        {
+            usleep(10000);
+            slept_so_far = slept_so_far + 10000;
+        }
+    }
+
+    if(TopTalkSection.panel[0] != NULL)
+    {
+        nodelay(TopTalkSection.win, FALSE);
+        del_panel(TopTalkSection.panel[0]);
+        destroy_win(TopTalkSection.win);
+    }
+    free(TopTalkSection.rows);
+    TopTalkSection.rows = NULL;
+
+    (void)hash_cleanup(debuglvl, &addr_hash);
+    (void)d_list_cleanup(debuglvl, &addr_list);
+
+    update_panels();
+    doupdate();
+
+    return(retval);
+}
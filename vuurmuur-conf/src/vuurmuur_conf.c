@@ -747,6 +747,8 @@ startup_screen(const int debuglvl, Rules *rules, Zones *zones, Services *service
         (void)vrprint.error(-1, VR_ERR, gettext("loading the plugins failed."));
         return(-1);
     }
+    /* use the snapshot of the daemon if it is fresh */
+    (void)snapshot_attach(debuglvl);
     werase(startup_print_win); wprintw(startup_print_win, "%s... %s", STR_LOAD_PLUGINS, STR_COK); update_panels(); doupdate();
 
 
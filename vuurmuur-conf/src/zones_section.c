@@ -1121,6 +1121,8 @@ zones_rename_host_group(const int debuglvl, Zones *zones, Rules *rules, BlockLis
         (void)vrprint.error(-1, VR_INTERR, "name overflow (in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
     }
+    if(zones_rehash(debuglvl, zones, zone_ptr, old_host_name) < 0)
+        return(-1);
     if(strlcpy(zone_ptr->host_name, new_host, sizeof(zone_ptr->host_name)) >= sizeof(zone_ptr->host_name))
     {
         (void)vrprint.error(-1, VR_INTERR, "name overflow (in: %s:%d).", __FUNC__, __LINE__);
@@ -3252,7 +3254,8 @@ zones_rename_network_zone(const int debuglvl, Zones *zones, Rules *rules, BlockL
                         rule_zone[MAX_ZONE] = "",
                         old_host[MAX_HOST] = "",
                         old_net[MAX_NETWORK] = "",
-                        old_zone[MAX_ZONE] = "";
+                        old_zone[MAX_ZONE] = "",
+                        old_child_name[MAX_HOST_NET_ZONE] = "";
     char                *blocklist_item = NULL,
                         *new_blocklist_item = NULL;
     size_t              size = 0;
@@ -3316,6 +3319,8 @@ zones_rename_network_zone(const int debuglvl, Zones *zones, Rules *rules, BlockL
         (void)vrprint.error(-1, VR_INTERR, "name overflow (in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
     }
+    if(zones_rehash(debuglvl, zones, zone_ptr, old_name) < 0)
+        return(-1);
     if(type == TYPE_ZONE)
     {
         if(strlcpy(zone_ptr->zone_name, new_zone, sizeof(zone_ptr->zone_name)) >= sizeof(zone_ptr->zone_name))
@@ -3414,6 +3419,9 @@ zones_rename_network_zone(const int debuglvl, Zones *zones, Rules *rules, BlockL
             return(-1);
         }
 
+        /* remember the name for updating the index */
+        (void)strlcpy(old_child_name, zone_ptr->name, sizeof(old_child_name));
+
         /* change full name and the network or zonename */
         if(type == TYPE_ZONE)
         {
@@ -3469,6 +3477,12 @@ zones_rename_network_zone(const int debuglvl, Zones *zones, Rules *rules, BlockL
                 }
             }
         }
+
+        if(strcmp(old_child_name, zone_ptr->name) != 0)
+        {
+            if(zones_rehash(debuglvl, zones, zone_ptr, old_child_name) < 0)
+                return(-1);
+        }
     }
 
 
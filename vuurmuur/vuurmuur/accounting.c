@@ -0,0 +1,238 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "main.h"
+
+/*
+    Traffic volume accounting
+
+    Every ACCOUNTING_INTERVAL seconds the counters of the interfaces are
+    added to the traffic volume store (see trafvol.c in libvuurmuur). We
+    use the ACC-<device> chains of the ruleset. Without them, like with
+    nftables, we use the counters of the kernel in /proc/net/dev.
+
+    With HOST_ACCOUNTING the hosts and networks are sampled as well, see
+    hostacc.c.
+*/
+
+static TrafVolStore     acc_store;
+static char             acc_open = FALSE;
+/* set when the store can't be used, so we don't complain every minute */
+static char             acc_disabled = FALSE;
+
+
+/* the interfaces we keep the traffic volume of */
+static int
+accounting_iface(struct InterfaceData_ *iface_ptr)
+{
+    if(iface_ptr == NULL || iface_ptr->active == FALSE ||
+        iface_ptr->device_virtual == TRUE || iface_ptr->device[0] == '\0')
+        return(0);
+
+    return(1);
+}
+
+
+/*  accounting_sample_proc
+
+    One pass over /proc/net/dev for all interfaces that are marked in
+    'want'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+accounting_sample_proc(const int debuglvl, Interfaces *interfaces, char *want, time_t now)
+{
+    struct InterfaceData_   *iface_ptr = NULL;
+    d_list_node             *d_node = NULL;
+    FILE                    *fp = NULL;
+    char                    line[512] = "",
+                            *colon = NULL,
+                            *device = NULL;
+    unsigned long long      recv_bytes = 0,
+                            trans_bytes = 0,
+                            skip = 0;
+    unsigned int            i = 0;
+
+    if(!(fp = fopen("/proc/net/dev", "r")))
+    {
+        (void)vrprint.error(-1, "Error", "unable to open '/proc/net/dev': %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    while(fgets(line, (int)sizeof(line), fp) != NULL)
+    {
+        /* '  eth0:1055472756 4679465 ...', the two header lines have no ':' */
+        if(!(colon = strchr(line, ':')))
+            continue;
+        *colon = '\0';
+
+        for(device = line; *device == ' '; device++);
+
+        if(sscanf(colon + 1, "%llu %llu %llu %llu %llu %llu %llu %llu %llu",
+                &recv_bytes, &skip, &skip, &skip, &skip, &skip, &skip, &skip,
+                &trans_bytes) != 9)
+            continue;
+
+        for(i = 0, d_node = interfaces->list.top; d_node; d_node = d_node->next, i++)
+        {
+            iface_ptr = d_node->data;
+
+            if(want[i] == FALSE || strcmp(iface_ptr->device, device) != 0)
+                continue;
+
+            if(trafvol_update(debuglvl, &acc_store, iface_ptr->device, TRAFVOL_SRC_PROC,
+                    now, recv_bytes, trans_bytes) < 0)
+            {
+                (void)fclose(fp);
+                return(-1);
+            }
+            want[i] = FALSE;
+        }
+    }
+
+    (void)fclose(fp);
+    return(0);
+}
+
+
+/*  accounting_sample
+
+    Adds the counters of all interfaces to the traffic volume store.
+    To be called every ACCOUNTING_INTERVAL seconds by the daemon.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+accounting_sample(const int debuglvl, Interfaces *interfaces)
+{
+    struct InterfaceData_   *iface_ptr = NULL;
+    d_list_node             *d_node = NULL;
+    IptCounters             counters;
+    char                    acc_chain[32] = "",
+                            ipt = FALSE,
+                            *want = NULL,
+                            need_proc = FALSE;
+    unsigned long long      recv_packets = 0,
+                            recv_bytes = 0,
+                            trans_packets = 0,
+                            trans_bytes = 0;
+    unsigned int            i = 0;
+    time_t                  now = time(NULL);
+    int                     retval = 0;
+
+    /* safety */
+    if(interfaces == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(acc_disabled == TRUE || interfaces->list.len == 0)
+        return(hostacc_sample(debuglvl, now));
+
+    if(acc_open == FALSE)
+    {
+        if(trafvol_open(debuglvl, &acc_store, TRAFVOL_LOCATION, TRUE, NULL) != 0)
+        {
+            (void)vrprint.warning("Warning", "can't open the traffic volume store, "
+                    "no accounting.");
+            acc_disabled = TRUE;
+            return(-1);
+        }
+        acc_open = TRUE;
+    }
+
+    if(!(want = calloc(interfaces->list.len, sizeof(char))))
+    {
+        (void)vrprint.error(-1, "Error", "calloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    /* the ACC- chains only exist in the iptables ruleset */
+    if(conf.use_nftables == FALSE)
+    {
+        if(ipt_counters_load(debuglvl, &conf, &counters, VR_IPV4, "filter") == 0)
+            ipt = TRUE;
+        else
+            ipt_counters_cleanup(debuglvl, &counters);
+    }
+
+    for(i = 0, d_node = interfaces->list.top; d_node && retval == 0; d_node = d_node->next, i++)
+    {
+        iface_ptr = d_node->data;
+
+        if(!accounting_iface(iface_ptr))
+            continue;
+
+        snprintf(acc_chain, sizeof(acc_chain), "ACC-%s", iface_ptr->device);
+
+        if(ipt == TRUE && ipt_counters_get_chain(debuglvl, &counters, acc_chain) != NULL)
+        {
+            (void)ipt_counters_get_iface(debuglvl, &counters, iface_ptr->device, acc_chain,
+                    &recv_packets, &recv_bytes, &trans_packets, &trans_bytes);
+
+            if(trafvol_update(debuglvl, &acc_store, iface_ptr->device, TRAFVOL_SRC_ACC,
+                    now, recv_bytes, trans_bytes) < 0)
+                retval = -1;
+        }
+        else
+        {
+            want[i] = TRUE;
+            need_proc = TRUE;
+        }
+    }
+
+    if(ipt == TRUE)
+        ipt_counters_cleanup(debuglvl, &counters);
+
+    if(retval == 0 && need_proc == TRUE)
+        retval = accounting_sample_proc(debuglvl, interfaces, want, now);
+
+    free(want);
+
+    if(hostacc_sample(debuglvl, now) < 0)
+        retval = -1;
+
+    return(retval);
+}
+
+
+/*  accounting_cleanup
+
+    Closes the traffic volume stores.
+*/
+void
+accounting_cleanup(const int debuglvl)
+{
+    if(acc_open == TRUE)
+        trafvol_close(debuglvl, &acc_store);
+    hostacc_cleanup(debuglvl);
+
+    acc_open = FALSE;
+    acc_disabled = FALSE;
+}
@@ -0,0 +1,992 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+    vuurmuur_bench: runs the rule generation pipeline of Vuurmuur in
+    ruleset mode against a (generated) textdir config and reports time,
+    allocations, peak RSS and the number of rules emitted per phase.
+
+    Nothing is loaded into the kernel: the ruleset is written to an
+    unlinked tempfile and the sysctl/proc settings are only printed, like
+    with 'vuurmuur -b'. Build it with 'make vuurmuur_bench'.
+*/
+
+#include "main.h"
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+/*
+    Allocation counting. With glibc we can interpose malloc and friends
+    in the executable and forward to the real allocator. This also counts
+    the allocations done by libvuurmuur and the plugins. The load phase
+    uses threads (see parallel.c), so the counters are updated atomically.
+*/
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+#define BENCH_COUNT(n, bytes) do { \
+        (void)__atomic_fetch_add(&bench_allocs, (n), __ATOMIC_RELAXED); \
+        (void)__atomic_fetch_add(&bench_alloc_bytes, (bytes), __ATOMIC_RELAXED); \
+    } while(0)
+
+static unsigned long long bench_allocs = 0;
+static unsigned long long bench_alloc_bytes = 0;
+
+void *
+malloc(size_t size)
+{
+    BENCH_COUNT(1, size);
+    return(__libc_malloc(size));
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+    BENCH_COUNT(1, nmemb * size);
+    return(__libc_calloc(nmemb, size));
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+    BENCH_COUNT(1, size);
+    return(__libc_realloc(ptr, size));
+}
+#define BENCH_COUNT_ALLOCS 1
+#endif /* __GLIBC__ */
+
+
+/* sizes of the generated config */
+struct BenchSizes_
+{
+    unsigned int    zones;
+    unsigned int    networks;       /* per zone */
+    unsigned int    hosts;          /* per network */
+    unsigned int    groups;         /* per network */
+    unsigned int    services;
+    unsigned int    rules;
+    unsigned int    interfaces;
+    unsigned int    virtuals;
+    unsigned int    seed;
+};
+
+struct BenchPhase_
+{
+    char                name[16];
+
+    struct timeval      begin_tv;
+    double              msec;
+
+    unsigned long long  allocs;
+    unsigned long long  alloc_bytes;
+
+    long                peak_rss;       /* in kb */
+    unsigned long       rules;          /* rules emitted, 0 if n/a */
+};
+
+#define BENCH_MAX_PHASES    8
+
+static struct BenchPhase_   phases[BENCH_MAX_PHASES];
+static int                  phases_cnt = 0;
+
+static unsigned int         bench_rand_state = 1;
+
+
+static unsigned int
+bench_rand(unsigned int max)
+{
+    bench_rand_state = bench_rand_state * 1103515245 + 12345;
+
+    if(max == 0)
+        return(0);
+
+    return(((bench_rand_state >> 16) & 0x7fff) % max);
+}
+
+
+/*  bench_peak_rss
+
+    Peak resident set size in kb. We use VmHWM because it can be reset
+    between phases through /proc/self/clear_refs (Linux 4.0+), otherwise
+    it's the peak of the whole process like ru_maxrss.
+*/
+static long
+bench_peak_rss(void)
+{
+    FILE            *fp = NULL;
+    char            line[128] = "";
+    long            kb = -1;
+    struct rusage   usage;
+
+    if((fp = fopen("/proc/self/status", "r")))
+    {
+        while(fgets(line, (int)sizeof(line), fp) != NULL)
+        {
+            if(strncmp(line, "VmHWM:", 6) == 0)
+            {
+                kb = atol(line + 6);
+                break;
+            }
+        }
+        fclose(fp);
+    }
+
+    if(kb < 0 && getrusage(RUSAGE_SELF, &usage) == 0)
+        kb = usage.ru_maxrss;
+
+    return(kb);
+}
+
+
+static void
+bench_peak_rss_reset(void)
+{
+    FILE    *fp = NULL;
+
+    if((fp = fopen("/proc/self/clear_refs", "w")))
+    {
+        fputs("5", fp);
+        fclose(fp);
+    }
+}
+
+
+static struct BenchPhase_ *
+bench_phase_begin(const char *name)
+{
+    struct BenchPhase_  *phase = NULL;
+
+    if(phases_cnt >= BENCH_MAX_PHASES)
+        return(NULL);
+
+    phase = &phases[phases_cnt++];
+    memset(phase, 0, sizeof(struct BenchPhase_));
+    (void)strlcpy(phase->name, name, sizeof(phase->name));
+
+    bench_peak_rss_reset();
+#ifdef BENCH_COUNT_ALLOCS
+    phase->allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+    phase->alloc_bytes = __atomic_load_n(&bench_alloc_bytes, __ATOMIC_RELAXED);
+#endif
+    gettimeofday(&phase->begin_tv, NULL);
+    return(phase);
+}
+
+
+static void
+bench_phase_end(struct BenchPhase_ *phase, unsigned long rules)
+{
+    struct timeval  end_tv;
+
+    if(phase == NULL)
+        return;
+
+    gettimeofday(&end_tv, NULL);
+
+    phase->msec = (end_tv.tv_sec - phase->begin_tv.tv_sec) * 1000.0 +
+                  (end_tv.tv_usec - phase->begin_tv.tv_usec) / 1000.0;
+#ifdef BENCH_COUNT_ALLOCS
+    phase->allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED) - phase->allocs;
+    phase->alloc_bytes = __atomic_load_n(&bench_alloc_bytes, __ATOMIC_RELAXED) - phase->alloc_bytes;
+#endif
+    phase->peak_rss = bench_peak_rss();
+    phase->rules = rules;
+}
+
+
+static void
+bench_print_report(FILE *fp)
+{
+    int i = 0;
+
+    fprintf(fp, "%-12s %10s %12s %12s %12s %10s\n",
+            "phase", "time(ms)", "allocs", "alloc(kb)", "peak-rss(kb)", "rules");
+
+    for(i = 0; i < phases_cnt; i++)
+    {
+#ifdef BENCH_COUNT_ALLOCS
+        fprintf(fp, "%-12s %10.2f %12llu %12llu %12ld %10lu\n",
+                phases[i].name, phases[i].msec, phases[i].allocs,
+                phases[i].alloc_bytes / 1024, phases[i].peak_rss,
+                phases[i].rules);
+#else
+        fprintf(fp, "%-12s %10.2f %12s %12s %12ld %10lu\n",
+                phases[i].name, phases[i].msec, "n/a", "n/a",
+                phases[i].peak_rss, phases[i].rules);
+#endif
+    }
+}
+
+
+/*
+    Config generator
+*/
+
+static int
+bench_mkdir(const char *fmt, ...)
+{
+    char    path[512] = "";
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(path, sizeof(path), fmt, ap);
+    va_end(ap);
+
+    if(mkdir(path, 0700) == -1 && errno != EEXIST)
+    {
+        fprintf(stderr, "Error: creating directory '%s' failed: %s.\n", path, strerror(errno));
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/* open a file for writing, the path is a printf format */
+static FILE *
+bench_fopen(const char *fmt, ...)
+{
+    char    path[512] = "";
+    FILE    *fp = NULL;
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(path, sizeof(path), fmt, ap);
+    va_end(ap);
+
+    if(!(fp = fopen(path, "w")))
+    {
+        fprintf(stderr, "Error: creating file '%s' failed: %s.\n", path, strerror(errno));
+        return(NULL);
+    }
+
+    return(fp);
+}
+
+
+/*  bench_object_name
+
+    Picks a random object for a rule. 'any' is only picked when
+    allow_any is set.
+*/
+static void
+bench_object_name(struct BenchSizes_ *sizes, char *name, size_t size, int allow_any)
+{
+    unsigned int    z = bench_rand(sizes->zones),
+                    n = bench_rand(sizes->networks),
+                    type = bench_rand(allow_any ? 6 : 5);
+
+    if(type == 0 && sizes->hosts == 0)
+        type = 2;
+    if(type == 1 && sizes->groups == 0)
+        type = 2;
+
+    switch(type)
+    {
+        case 0:
+            snprintf(name, size, "host%u.net%u.zone%u", bench_rand(sizes->hosts), n, z);
+            break;
+        case 1:
+            snprintf(name, size, "group%u.net%u.zone%u", bench_rand(sizes->groups), n, z);
+            break;
+        case 2:
+            snprintf(name, size, "net%u.zone%u", n, z);
+            break;
+        case 3:
+            snprintf(name, size, "zone%u", z);
+            break;
+        case 4:
+            snprintf(name, size, "firewall");
+            break;
+        default:
+            snprintf(name, size, "any");
+            break;
+    }
+}
+
+
+/*  bench_generate
+
+    Creates a textdir config in 'dir'. The layout is the same as the
+    installed one: dir/vuurmuur/config.conf, dir/vuurmuur/plugins/textdir.conf
+    and the objects under dir/vuurmuur/textdir.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+bench_generate(const char *dir, struct BenchSizes_ *sizes)
+{
+    FILE            *fp = NULL;
+    unsigned int    i = 0,
+                    z = 0,
+                    n = 0,
+                    h = 0,
+                    g = 0;
+    unsigned int    all_ifaces = sizes->interfaces + sizes->virtuals;
+    char            from[64] = "",
+                    to[64] = "",
+                    svc[32] = "";
+    static const char *actions[] = { "accept", "accept", "accept", "drop", "reject", "log" };
+
+    (void)umask(0077);
+
+    if(bench_mkdir("%s", dir) < 0 ||
+       bench_mkdir("%s/log", dir) < 0 ||
+       bench_mkdir("%s/vuurmuur", dir) < 0 ||
+       bench_mkdir("%s/vuurmuur/plugins", dir) < 0 ||
+       bench_mkdir("%s/vuurmuur/textdir", dir) < 0 ||
+       bench_mkdir("%s/vuurmuur/textdir/interfaces", dir) < 0 ||
+       bench_mkdir("%s/vuurmuur/textdir/services", dir) < 0 ||
+       bench_mkdir("%s/vuurmuur/textdir/zones", dir) < 0 ||
+       bench_mkdir("%s/vuurmuur/textdir/rules", dir) < 0)
+        return(-1);
+
+    /* main config */
+    if(!(fp = bench_fopen("%s/vuurmuur/config.conf", dir)))
+        return(-1);
+    fprintf(fp, "SERVICES_BACKEND=\"textdir\"\n");
+    fprintf(fp, "ZONES_BACKEND=\"textdir\"\n");
+    fprintf(fp, "INTERFACES_BACKEND=\"textdir\"\n");
+    fprintf(fp, "RULES_BACKEND=\"textdir\"\n");
+    fprintf(fp, "LOGDIR=\"%s/log\"\n", dir);
+    fclose(fp);
+
+    if(!(fp = bench_fopen("%s/vuurmuur/plugins/textdir.conf", dir)))
+        return(-1);
+    fprintf(fp, "LOCATION=%s/vuurmuur/textdir/\n", dir);
+    fclose(fp);
+
+    /* an empty blocklist */
+    if(!(fp = bench_fopen("%s/vuurmuur/blocked.list", dir)))
+        return(-1);
+    fclose(fp);
+
+    /* interfaces */
+    for(i = 0; i < sizes->interfaces; i++)
+    {
+        if(!(fp = bench_fopen("%s/vuurmuur/textdir/interfaces/if%u.conf", dir, i)))
+            return(-1);
+        fprintf(fp, "ACTIVE=\"Yes\"\nDEVICE=\"vrb%u\"\nIPADDRESS=\"172.16.%u.1\"\nVIRTUAL=\"No\"\n", i, i);
+        fclose(fp);
+    }
+    for(i = 0; i < sizes->virtuals; i++)
+    {
+        if(!(fp = bench_fopen("%s/vuurmuur/textdir/interfaces/vif%u.conf", dir, i)))
+            return(-1);
+        fprintf(fp, "ACTIVE=\"Yes\"\nDEVICE=\"vrbv%u\"\nIPADDRESS=\"172.17.%u.1\"\nVIRTUAL=\"Yes\"\n", i, i);
+        fclose(fp);
+    }
+
+    /* services */
+    for(i = 0; i < sizes->services; i++)
+    {
+        if(!(fp = bench_fopen("%s/vuurmuur/textdir/services/svc%u", dir, i)))
+            return(-1);
+        fprintf(fp, "ACTIVE=\"Yes\"\n");
+        if(i % 5 == 4)
+            fprintf(fp, "TCP=\"%u:%u*1024:65535\"\n", 10000 + i, 10010 + i);
+        else
+            fprintf(fp, "TCP=\"%u*1024:65535\"\n", 10000 + i);
+        if(i % 3 == 2)
+            fprintf(fp, "UDP=\"%u*1024:65535\"\n", 10000 + i);
+        fprintf(fp, "BROADCAST=\"No\"\n");
+        fclose(fp);
+    }
+
+    /* zones, networks, hosts and groups */
+    for(z = 0; z < sizes->zones; z++)
+    {
+        if(bench_mkdir("%s/vuurmuur/textdir/zones/zone%u", dir, z) < 0 ||
+           bench_mkdir("%s/vuurmuur/textdir/zones/zone%u/networks", dir, z) < 0)
+            return(-1);
+
+        if(!(fp = bench_fopen("%s/vuurmuur/textdir/zones/zone%u/zone.config", dir, z)))
+            return(-1);
+        fprintf(fp, "ACTIVE=\"Yes\"\n");
+        fclose(fp);
+
+        for(n = 0; n < sizes->networks; n++)
+        {
+            if(bench_mkdir("%s/vuurmuur/textdir/zones/zone%u/networks/net%u", dir, z, n) < 0 ||
+               bench_mkdir("%s/vuurmuur/textdir/zones/zone%u/networks/net%u/hosts", dir, z, n) < 0 ||
+               bench_mkdir("%s/vuurmuur/textdir/zones/zone%u/networks/net%u/groups", dir, z, n) < 0)
+                return(-1);
+
+            if(!(fp = bench_fopen("%s/vuurmuur/textdir/zones/zone%u/networks/net%u/network.config", dir, z, n)))
+                return(-1);
+            i = (z * sizes->networks + n) % all_ifaces;
+            fprintf(fp, "ACTIVE=\"Yes\"\nNETWORK=\"10.%u.%u.0\"\nNETMASK=\"255.255.255.0\"\n", z, n);
+            if(i < sizes->interfaces)
+                fprintf(fp, "INTERFACE=\"if%u\"\n", i);
+            else
+                fprintf(fp, "INTERFACE=\"vif%u\"\n", i - sizes->interfaces);
+            fclose(fp);
+
+            for(h = 0; h < sizes->hosts; h++)
+            {
+                if(!(fp = bench_fopen("%s/vuurmuur/textdir/zones/zone%u/networks/net%u/hosts/host%u.host", dir, z, n, h)))
+                    return(-1);
+                fprintf(fp, "ACTIVE=\"Yes\"\nIPADDRESS=\"10.%u.%u.%u\"\n", z, n, h + 1);
+                fclose(fp);
+            }
+
+            for(g = 0; g < sizes->groups; g++)
+            {
+                if(!(fp = bench_fopen("%s/vuurmuur/textdir/zones/zone%u/networks/net%u/groups/group%u.group", dir, z, n, g)))
+                    return(-1);
+                fprintf(fp, "ACTIVE=\"Yes\"\n");
+                for(h = g; h < sizes->hosts; h += sizes->groups)
+                    fprintf(fp, "MEMBER=\"host%u\"\n", h);
+                fclose(fp);
+            }
+        }
+    }
+
+    /* rules */
+    if(!(fp = bench_fopen("%s/vuurmuur/textdir/rules/rules.conf", dir)))
+        return(-1);
+
+    bench_rand_state = sizes->seed;
+
+    for(i = 0; i < sizes->rules; i++)
+    {
+        snprintf(svc, sizeof(svc), "svc%u", bench_rand(sizes->services));
+
+        if(i % 20 == 10)
+        {
+            /* masquerade a network to a zone */
+            fprintf(fp, "RULE=\"masq service any from net%u.zone%u to zone%u\"\n",
+                    bench_rand(sizes->networks), bench_rand(sizes->zones),
+                    bench_rand(sizes->zones));
+            continue;
+        }
+        else if(i % 20 == 15 && sizes->hosts > 0)
+        {
+            /* portforward from a zone to a host */
+            fprintf(fp, "RULE=\"portfw service %s from zone%u to host%u.net%u.zone%u\"\n",
+                    svc, bench_rand(sizes->zones), bench_rand(sizes->hosts),
+                    bench_rand(sizes->networks), bench_rand(sizes->zones));
+            continue;
+        }
+
+        do
+        {
+            bench_object_name(sizes, from, sizeof(from), 0);
+            bench_object_name(sizes, to, sizeof(to), strcmp(from, "firewall") != 0);
+        }
+        while(strcmp(from, to) == 0);
+
+        fprintf(fp, "RULE=\"%s service %s from %s to %s%s\"\n",
+                actions[bench_rand(sizeof(actions) / sizeof(actions[0]))],
+                svc, from, to, (i % 4 == 0) ? " options log" : "");
+    }
+    fclose(fp);
+
+    return(0);
+}
+
+
+/* sum the rules in all the lists of the ruleset */
+static unsigned long
+bench_ruleset_count(RuleSet *ruleset)
+{
+    d_list          *lists[] = {
+        &ruleset->raw_preroute,
+        &ruleset->mangle_preroute, &ruleset->mangle_input,
+        &ruleset->mangle_forward, &ruleset->mangle_output,
+        &ruleset->mangle_postroute, &ruleset->mangle_shape_in,
+        &ruleset->mangle_shape_out, &ruleset->mangle_shape_fw,
+        &ruleset->nat_preroute, &ruleset->nat_postroute,
+        &ruleset->nat_output,
+        &ruleset->filter_input, &ruleset->filter_forward,
+        &ruleset->filter_output, &ruleset->filter_antispoof,
+        &ruleset->filter_blocklist, &ruleset->filter_blocktarget,
+        &ruleset->filter_badtcp, &ruleset->filter_synlimittarget,
+        &ruleset->filter_udplimittarget, &ruleset->filter_tcpresettarget,
+        &ruleset->filter_newaccepttarget, &ruleset->filter_newqueuetarget,
+        &ruleset->filter_newnfqueuetarget,
+        &ruleset->filter_estrelnfqueuetarget,
+        &ruleset->filter_accounting,
+    };
+    unsigned long   cnt = 0;
+    size_t          i = 0;
+
+    for(i = 0; i < sizeof(lists) / sizeof(lists[0]); i++)
+        cnt += lists[i]->len;
+
+    return(cnt);
+}
+
+
+/* count the '-A' lines in the ruleset file */
+static unsigned long
+bench_file_count(int fd)
+{
+    FILE            *fp = NULL;
+    char            line[1024] = "";
+    unsigned long   cnt = 0;
+
+    if(lseek(fd, 0, SEEK_SET) == (off_t)-1)
+        return(0);
+
+    if(!(fp = fdopen(dup(fd), "r")))
+        return(0);
+
+    while(fgets(line, (int)sizeof(line), fp) != NULL)
+    {
+        if(strncmp(line, "-A ", 3) == 0)
+            cnt++;
+    }
+    fclose(fp);
+
+    return(cnt);
+}
+
+
+/*  bench_ruleset
+
+    The create and fill phases of load_ruleset for one ip version.
+    Output of the sysctl/proc code is sent to /dev/null.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+bench_ruleset(const int debuglvl, VuurmuurCtx *vctx, int ipv)
+{
+    RuleSet             ruleset;
+    struct BenchPhase_  *phase = NULL;
+    char                path[] = "/tmp/vuurmuur-bench-XXXXXX";
+    int                 fd = -1,
+                        stdout_fd = -1,
+                        null_fd = -1,
+                        retval = 0;
+
+    if(ruleset_setup(debuglvl, &ruleset) != 0)
+        return(-1);
+    ruleset.ipv = ipv;
+
+    fflush(stdout);
+    stdout_fd = dup(STDOUT_FILENO);
+    if((null_fd = open("/dev/null", O_WRONLY)) >= 0)
+    {
+        (void)dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+
+    phase = bench_phase_begin(ipv == VR_IPV4 ? "create-ipv4" : "create-ipv6");
+    if(ruleset_create_ruleset(debuglvl, vctx, &ruleset) < 0)
+        retval = -1;
+    bench_phase_end(phase, bench_ruleset_count(&ruleset));
+
+    fflush(stdout);
+    if(stdout_fd >= 0)
+    {
+        (void)dup2(stdout_fd, STDOUT_FILENO);
+        close(stdout_fd);
+    }
+
+    if(retval == 0)
+    {
+        fd = create_tempfile(debuglvl, path);
+        if(fd == -1)
+        {
+            ruleset_cleanup(debuglvl, &ruleset);
+            return(-1);
+        }
+        (void)unlink(path);
+
+        phase = bench_phase_begin(ipv == VR_IPV4 ? "fill-ipv4" : "fill-ipv6");
+        if(rules_get_custom_chains(debuglvl, vctx->rules) < 0 ||
+           ruleset_fill_file(debuglvl, vctx, &ruleset, fd, ipv) < 0)
+        {
+            retval = -1;
+        }
+        d_list_cleanup(debuglvl, &vctx->rules->custom_chain_list);
+        bench_phase_end(phase, bench_file_count(fd));
+
+        close(fd);
+    }
+
+    ruleset_cleanup(debuglvl, &ruleset);
+    return(retval);
+}
+
+
+/*  bench_nftables
+
+    Generate the nft script into a memory buffer. If output is set the
+    script is also written to that file.
+*/
+static int
+bench_nftables(const int debuglvl, VuurmuurCtx *vctx, const char *output)
+{
+    struct BenchPhase_  *phase = NULL;
+    char                *buf = NULL,
+                        *s = NULL;
+    size_t              len = 0;
+    FILE                *fp = NULL;
+    unsigned long       cnt = 0;
+    int                 retval = 0;
+
+    if(!(fp = open_memstream(&buf, &len)))
+        return(-1);
+
+    phase = bench_phase_begin("nftables");
+    if(nftables_create_ruleset(debuglvl, vctx, fp) != 0)
+        retval = -1;
+    fflush(fp);
+
+    /* every line in a chain that doesn't start a block is a rule */
+    s = buf;
+    while(s != NULL && *s != '\0')
+    {
+        if(strncmp(s, "\t\t", 2) == 0 && strncmp(s, "\t\ttype ", 7) != 0 &&
+           strncmp(s, "\t\tflags ", 8) != 0 && strncmp(s, "\t\telements ", 11) != 0)
+            cnt++;
+
+        if((s = strchr(s, '\n')) != NULL)
+            s++;
+    }
+    bench_phase_end(phase, cnt);
+
+    fclose(fp);
+
+    if(retval == 0 && output != NULL)
+    {
+        if(!(fp = fopen(output, "w")))
+        {
+            fprintf(stderr, "Error: opening '%s' failed: %s.\n", output, strerror(errno));
+            retval = -1;
+        }
+        else
+        {
+            if(fwrite(buf, 1, len, fp) != len)
+                retval = -1;
+            if(fclose(fp) != 0)
+                retval = -1;
+        }
+    }
+
+    free(buf);
+    return(retval);
+}
+
+
+static void
+print_help(void)
+{
+    fprintf(stdout, "Usage: vuurmuur_bench [OPTION]\n");
+    fprintf(stdout, "\n");
+    fprintf(stdout, "Runs the Vuurmuur rule generation in ruleset mode and reports time,\n");
+    fprintf(stdout, "allocations, peak RSS and the emitted rules per phase. Like vuurmuur\n");
+    fprintf(stdout, "itself it only reads config files that are owned by root, unless -u\n");
+    fprintf(stdout, "is given.\n");
+    fprintf(stdout, "\n");
+    fprintf(stdout, "Options:\n");
+    fprintf(stdout, "-g, --generate DIR\tgenerate a config in DIR and benchmark it\n");
+    fprintf(stdout, "-e, --etcdir DIR\tbenchmark the config in DIR/vuurmuur (default: the installed config)\n");
+    fprintf(stdout, "-z, --zones N\t\tzones to generate (default: 4)\n");
+    fprintf(stdout, "-n, --networks N\tnetworks per zone (default: 4)\n");
+    fprintf(stdout, "-H, --hosts N\t\thosts per network (default: 16)\n");
+    fprintf(stdout, "-G, --groups N\t\tgroups per network (default: 2)\n");
+    fprintf(stdout, "-s, --services N\tservices (default: 32)\n");
+    fprintf(stdout, "-r, --rules N\t\trules (default: 200)\n");
+    fprintf(stdout, "-i, --interfaces N\tinterfaces (default: 4)\n");
+    fprintf(stdout, "-V, --virtual N\t\tvirtual interfaces (default: 0)\n");
+    fprintf(stdout, "-S, --seed N\t\tseed for the rule generator (default: 1)\n");
+    fprintf(stdout, "-N, --nftables\t\talso benchmark the nftables generator\n");
+    fprintf(stdout, "-o, --nft-output FILE\twrite the nftables ruleset to FILE (implies -N)\n");
+    fprintf(stdout, "-u, --no-owner-check\talso read files that are not owned by root (for tests)\n");
+    fprintf(stdout, "-d, --debug N\t\tenables debugging (1 low, 3 high)\n");
+    fprintf(stdout, "-h, --help\t\tgives this help\n");
+    fprintf(stdout, "\n");
+
+    exit(EXIT_SUCCESS);
+}
+
+
+static unsigned int
+bench_size_arg(const char *opt, const char *arg, unsigned int max)
+{
+    int n = atoi(arg);
+
+    if(n < 0 || (unsigned int)n > max)
+    {
+        fprintf(stderr, "Error: %s: %s out of range (max: %u).\n", opt, arg, max);
+        exit(EXIT_FAILURE);
+    }
+
+    return((unsigned int)n);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    Interfaces          interfaces;
+    Services            services;
+    Zones               zones;
+    Rules               rules;
+    BlockList           blocklist;
+    IptCap              iptcap;
+    VuurmuurCtx         vctx;
+    struct rgx_         reg;
+    struct BenchSizes_  sizes = { 4, 4, 16, 2, 32, 200, 4, 0, 1 };
+    struct BenchPhase_  *phase = NULL;
+    char                *gendir = NULL,
+                        *etcdir = NULL,
+                        *nft_output = NULL;
+    char                nftables = FALSE;
+    int                 debuglvl = 0,
+                        optch,
+                        option_index = 0,
+                        retval = 0;
+    static char optstring[] = "hd:g:e:z:n:H:G:s:r:i:V:S:No:u";
+    struct option prog_opts[] =
+    {
+        { "help", no_argument, NULL, 'h' },
+        { "debug", required_argument, NULL, 'd' },
+        { "generate", required_argument, NULL, 'g' },
+        { "etcdir", required_argument, NULL, 'e' },
+        { "zones", required_argument, NULL, 'z' },
+        { "networks", required_argument, NULL, 'n' },
+        { "hosts", required_argument, NULL, 'H' },
+        { "groups", required_argument, NULL, 'G' },
+        { "services", required_argument, NULL, 's' },
+        { "rules", required_argument, NULL, 'r' },
+        { "interfaces", required_argument, NULL, 'i' },
+        { "virtual", required_argument, NULL, 'V' },
+        { "seed", required_argument, NULL, 'S' },
+        { "nftables", no_argument, NULL, 'N' },
+        { "nft-output", required_argument, NULL, 'o' },
+        { "no-owner-check", no_argument, NULL, 'u' },
+        { 0, 0, 0, 0 },
+    };
+
+    vctx.zones = &zones;
+    vctx.rules = &rules;
+    vctx.services = &services;
+    vctx.blocklist = &blocklist;
+    vctx.iptcaps = &iptcap;
+    vctx.interfaces = &interfaces;
+    vctx.conf = &conf;
+
+    snprintf(version_string, sizeof(version_string), "%s (using libvuurmuur %s)", VUURMUUR_VERSION, libvuurmuur_get_version());
+
+    get_user_info(debuglvl, &user_data);
+
+    vrprint.logger = "vuurmuur_bench";
+    vrprint.error = libvuurmuur_stdoutprint_error;
+    vrprint.warning = libvuurmuur_stdoutprint_warning;
+    vrprint.info = libvuurmuur_stdoutprint_info;
+    vrprint.debug = libvuurmuur_stdoutprint_debug;
+    vrprint.username = user_data.realusername;
+    vrprint.audit = libvuurmuur_stdoutprint_audit;
+
+    if(pre_init_config(&conf) < 0)
+        exit(EXIT_FAILURE);
+
+    shm_table = NULL;
+    sem_id = 0;
+    memset(&cmdline, 0, sizeof(cmdline));
+
+    while((optch = getopt_long(argc, argv, optstring, prog_opts, &option_index)) != -1)
+    {
+        switch(optch)
+        {
+            case 'd' :
+                debuglvl = atoi(optarg);
+                if(debuglvl < 0 || debuglvl > HIGH)
+                {
+                    fprintf(stderr, "Error: illegal debug level: %d (max: %d).\n", debuglvl, HIGH);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'g' :
+                gendir = optarg;
+                break;
+            case 'e' :
+                etcdir = optarg;
+                break;
+            /* the ipaddresses of the generated objects limit the sizes */
+            case 'z' :
+                sizes.zones = bench_size_arg("zones", optarg, 255);
+                break;
+            case 'n' :
+                sizes.networks = bench_size_arg("networks", optarg, 255);
+                break;
+            case 'H' :
+                sizes.hosts = bench_size_arg("hosts", optarg, 254);
+                break;
+            case 'G' :
+                sizes.groups = bench_size_arg("groups", optarg, 254);
+                break;
+            case 's' :
+                sizes.services = bench_size_arg("services", optarg, 50000);
+                break;
+            case 'r' :
+                sizes.rules = bench_size_arg("rules", optarg, 1000000);
+                break;
+            case 'i' :
+                sizes.interfaces = bench_size_arg("interfaces", optarg, 255);
+                break;
+            case 'V' :
+                sizes.virtuals = bench_size_arg("virtual", optarg, 255);
+                break;
+            case 'S' :
+                sizes.seed = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'N' :
+                nftables = TRUE;
+                break;
+            case 'o' :
+                nft_output = optarg;
+                nftables = TRUE;
+                break;
+            case 'u' :
+                conf.skip_owner_check = TRUE;
+                break;
+            case 'h' :
+            default:
+                print_help();
+                break;
+        }
+    }
+
+    if(gendir != NULL)
+    {
+        if(sizes.zones == 0 || sizes.networks == 0 || sizes.services == 0 ||
+           sizes.interfaces + sizes.virtuals == 0)
+        {
+            fprintf(stderr, "Error: need at least one zone, network, service and interface.\n");
+            exit(EXIT_FAILURE);
+        }
+        if(sizes.groups > sizes.hosts)
+            sizes.groups = sizes.hosts;
+
+        phase = bench_phase_begin("generate");
+        if(bench_generate(gendir, &sizes) < 0)
+            exit(EXIT_FAILURE);
+        bench_phase_end(phase, sizes.rules);
+
+        etcdir = gendir;
+    }
+
+    if(etcdir != NULL)
+    {
+        if(strlcpy(conf.etcdir, etcdir, sizeof(conf.etcdir)) >= sizeof(conf.etcdir) ||
+           snprintf(conf.configfile, sizeof(conf.configfile), "%s/vuurmuur/config.conf", etcdir) >= (int)sizeof(conf.configfile))
+        {
+            fprintf(stderr, "Error: etcdir '%s' too long.\n", etcdir);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* load everything, like vuurmuur does at startup */
+    phase = bench_phase_begin("load");
+
+    if(init_config(debuglvl, &conf) < VR_CNF_OK)
+    {
+        fprintf(stderr, "Error: initializing config failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* from here on errors go to the logfiles */
+    vrprint.error = libvuurmuur_logprint_error;
+    vrprint.warning = libvuurmuur_logprint_warning;
+    vrprint.info = libvuurmuur_logprint_info;
+    vrprint.debug = libvuurmuur_logprint_debug;
+    vrprint.audit = libvuurmuur_logprint_audit;
+
+    /* never touch the system: sysctl and proc settings are printed, and
+     * listing the current chains (rules_get_system_chains) runs a no-op
+     * instead of iptables, as if no ruleset was loaded. This also keeps
+     * the output independent of the ruleset of the host. */
+    conf.bash_out = TRUE;
+    (void)strlcpy(conf.iptables_location, "/bin/true", sizeof(conf.iptables_location));
+    (void)strlcpy(conf.ip6tables_location, "/bin/true", sizeof(conf.ip6tables_location));
+    conf.check_iptcaps = FALSE;
+    memset(&iptcap, 0, sizeof(IptCap));
+
+    create_loglevel_string(debuglvl, &conf, loglevel, sizeof(loglevel));
+    create_logtcpoptions_string(debuglvl, &conf, log_tcp_options, sizeof(log_tcp_options));
+
+    if(setup_rgx(1, &reg) < 0 ||
+       load_backends(debuglvl, &PluginList) < 0 ||
+       load_services(debuglvl, &services, &reg) == -1 ||
+       load_interfaces(debuglvl, &interfaces) == -1 ||
+       load_zones(debuglvl, &zones, &interfaces, &reg) == -1)
+    {
+        fprintf(stderr, "Error: loading the config failed. Please see error.log.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(blocklist_init_list(debuglvl, &zones, &blocklist, /*load_ips*/TRUE, /*no_refcnt*/FALSE) < 0)
+        (void)vrprint.error(-1, "Error", "blocklist_read_file failed.");
+
+    if(rules_init_list(debuglvl, &rules, &reg) != 0)
+    {
+        fprintf(stderr, "Error: loading the rules failed. Please see error.log.\n");
+        exit(EXIT_FAILURE);
+    }
+    bench_phase_end(phase, rules.list.len);
+
+    phase = bench_phase_begin("analyze");
+    if(analyze_all_rules(debuglvl, &vctx, vctx.rules) != 0)
+    {
+        fprintf(stderr, "Error: analyzing the rules failed. Please see error.log.\n");
+        exit(EXIT_FAILURE);
+    }
+    bench_phase_end(phase, rules.list.len);
+
+    if(bench_ruleset(debuglvl, &vctx, VR_IPV4) < 0)
+        retval = -1;
+#ifdef IPV6_ENABLED
+    if(bench_ruleset(debuglvl, &vctx, VR_IPV6) < 0)
+        retval = -1;
+#endif
+    if(nftables == TRUE && bench_nftables(debuglvl, &vctx, nft_output) < 0)
+        retval = -1;
+
+    fprintf(stdout, "objects: zones/networks/hosts/groups %u, services %u, interfaces %u, rules %u\n",
+            zones.list.len, services.list.len, interfaces.list.len, rules.list.len);
+    bench_print_report(stdout);
+
+    if(retval < 0)
+        fprintf(stderr, "Error: creating the rules failed. Please see error.log.\n");
+
+    (void)unload_backends(debuglvl, &PluginList);
+    destroy_serviceslist(debuglvl, &services);
+    destroy_zonedatalist(debuglvl, &zones);
+    destroy_interfaceslist(debuglvl, &interfaces);
+    (void)rules_cleanup_list(debuglvl, &rules);
+    d_list_cleanup(debuglvl, &blocklist.list);
+    (void)setup_rgx(0, &reg);
+
+    return(retval == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,524 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/* for struct ucred */
+#define _GNU_SOURCE
+
+#include "main.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+
+/*
+    The daemon side of the control channel (see control.c in libvuurmuur).
+
+    The sockets are handled from the main loop: control_server_wait()
+    replaces the sleep between the checks. Requests that need a reload
+    (reload, block, unblock) only mark the client as waiting, the main
+    loop does the reload and sends the progress and the result to all
+    waiting clients. So a number of requests at once cost one reload.
+*/
+
+#define CONTROL_MAX_CLIENTS 8
+
+static int      listen_fd = -1;
+
+static struct
+{
+    int     fd;
+    char    waiting;    /* waiting for the result of a reload */
+} clients[CONTROL_MAX_CLIENTS];
+
+static char     reload_requested = FALSE;
+static time_t   started = 0;
+static time_t   last_reload = 0;
+static int      last_result = VR_RR_READY;
+static unsigned int reload_count = 0;
+
+
+static void
+control_server_drop(const int debuglvl, int i)
+{
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "closing client %d.", i);
+
+    (void)close(clients[i].fd);
+    clients[i].fd = -1;
+    clients[i].waiting = FALSE;
+}
+
+
+static int
+control_server_reply(const int debuglvl, int i, int result)
+{
+    int value = result;
+
+    if(control_send(debuglvl, clients[i].fd, CONTROL_RESULT, &value, sizeof(value)) < 0)
+    {
+        control_server_drop(debuglvl, i);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/* send the text in 'buf' to the client, in as many frames as needed */
+static int
+control_server_data(const int debuglvl, int i, const char *buf, size_t len)
+{
+    size_t  chunk = 0;
+
+    while(len > 0)
+    {
+        chunk = len > CONTROL_MAX_DATA ? CONTROL_MAX_DATA : len;
+
+        if(control_send(debuglvl, clients[i].fd, CONTROL_DATA, buf, chunk) < 0)
+        {
+            control_server_drop(debuglvl, i);
+            return(-1);
+        }
+
+        buf += chunk;
+        len -= chunk;
+    }
+
+    return(0);
+}
+
+
+static int
+control_server_status(const int debuglvl, int i)
+{
+    char    buf[256] = "";
+    int     len = 0;
+    time_t  now = time(NULL);
+
+    len = snprintf(buf, sizeof(buf),
+            "pid %ld\nuptime %ld\nreloads %u\nlast_reload %ld\nlast_result %d\n",
+            (long)getpid(), (long)(now - started), reload_count,
+            last_reload ? (long)(now - last_reload) : -1L, last_result);
+    if(len < 0 || len >= (int)sizeof(buf))
+        return(-1);
+
+    if(control_server_data(debuglvl, i, buf, (size_t)len) < 0)
+        return(-1);
+
+    return(control_server_reply(debuglvl, i, VR_RR_SUCCES));
+}
+
+
+/* one line per interface: name device rx_bytes rx_packets tx_bytes tx_packets */
+static int
+control_server_counters(const int debuglvl, VuurmuurCtx *vctx, int i)
+{
+    d_list_node             *d_node = NULL;
+    struct InterfaceData_   *iface_ptr = NULL;
+    char                    buf[CONTROL_MAX_DATA] = "";
+    size_t                  len = 0;
+    int                     n = 0;
+    unsigned long           recv_bytes = 0,
+                            recv_packets = 0,
+                            trans_bytes = 0,
+                            trans_packets = 0;
+
+    for(d_node = vctx->interfaces->list.top; d_node; d_node = d_node->next)
+    {
+        if(!(iface_ptr = d_node->data))
+            continue;
+
+        if(iface_ptr->device[0] == '\0' ||
+            get_iface_stats(debuglvl, iface_ptr->device, &recv_bytes, &recv_packets,
+                    &trans_bytes, &trans_packets) != 0)
+        {
+            continue;
+        }
+
+        n = snprintf(buf + len, sizeof(buf) - len, "%s %s %lu %lu %lu %lu\n",
+                iface_ptr->name, iface_ptr->device, recv_bytes, recv_packets,
+                trans_bytes, trans_packets);
+        if(n < 0)
+            return(-1);
+
+        /* full: send what we have and retry this line in an empty buffer */
+        if((size_t)n >= sizeof(buf) - len)
+        {
+            if(len == 0 || control_server_data(debuglvl, i, buf, len) < 0)
+                return(-1);
+
+            len = (size_t)snprintf(buf, sizeof(buf), "%s %s %lu %lu %lu %lu\n",
+                    iface_ptr->name, iface_ptr->device, recv_bytes, recv_packets,
+                    trans_bytes, trans_packets);
+        }
+        else
+        {
+            len += (size_t)n;
+        }
+    }
+
+    if(len > 0 && control_server_data(debuglvl, i, buf, len) < 0)
+        return(-1);
+
+    return(control_server_reply(debuglvl, i, VR_RR_SUCCES));
+}
+
+
+/*  control_server_blocklist
+
+    Adds 'item' to or removes it from the blocklist in the backend. The
+    list is read like vuurmuur_script does: only the names, without
+    touching the refcnt of the zones we use.
+
+    Returncodes:
+         0: changed, needs a reload
+         1: no changes
+        -1: error
+*/
+static int
+control_server_blocklist(const int debuglvl, VuurmuurCtx *vctx, int type, char *item)
+{
+    BlockList   blocklist;
+    d_list_node *d_node = NULL;
+    unsigned int len = 0;
+    int         retval = 0;
+
+    if(item[0] == '\0')
+        return(-1);
+
+    if(blocklist_init_list(debuglvl, vctx->zones, &blocklist, FALSE, TRUE) < 0)
+    {
+        (void)vrprint.error(-1, "Error", "loading the blocklist failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    for(d_node = blocklist.list.top; d_node; d_node = d_node->next)
+    {
+        if(d_node->data != NULL && strcmp((char *)d_node->data, item) == 0)
+            break;
+    }
+
+    if(type == CONTROL_BLOCK)
+    {
+        len = blocklist.list.len;
+
+        if(d_node != NULL)
+            retval = 1;
+        else if(blocklist_add_one(debuglvl, vctx->zones, &blocklist, FALSE, TRUE, item) < 0 ||
+                blocklist.list.len == len)
+            /* not an ipaddress, host or group */
+            retval = -1;
+    }
+    else
+    {
+        if(d_node == NULL)
+            retval = 1;
+        else if(d_list_remove_node(debuglvl, &blocklist.list, d_node) < 0)
+            retval = -1;
+    }
+
+    if(retval == 0)
+    {
+        if(blocklist_save_list(debuglvl, &blocklist) < 0)
+        {
+            (void)vrprint.error(-1, "Error", "saving the blocklist failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            retval = -1;
+        }
+        else
+        {
+            (void)vrprint.audit("IPC-CTL: '%s' %s the blocklist.", item,
+                    type == CONTROL_BLOCK ? "added to" : "removed from");
+        }
+    }
+
+    d_list_cleanup(debuglvl, &blocklist.list);
+    return(retval);
+}
+
+
+static void
+control_server_request(const int debuglvl, VuurmuurCtx *vctx, int i)
+{
+    char    data[CONTROL_MAX_DATA + 1] = "";
+    int     type = 0,
+            result = 0;
+
+    /* the rest of the frame follows the header right away */
+    if(control_recv(debuglvl, clients[i].fd, &type, data, sizeof(data), 1000) < 0)
+    {
+        control_server_drop(debuglvl, i);
+        return;
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "client %d: request %d '%s'.", i, type, data);
+
+    switch(type)
+    {
+        case CONTROL_RELOAD:
+            (void)vrprint.audit("IPC-CTL: reload requested.");
+            clients[i].waiting = TRUE;
+            reload_requested = TRUE;
+            break;
+
+        case CONTROL_STATUS:
+            (void)control_server_status(debuglvl, i);
+            break;
+
+        case CONTROL_COUNTERS:
+            (void)control_server_counters(debuglvl, vctx, i);
+            break;
+
+        case CONTROL_BLOCK:
+        case CONTROL_UNBLOCK:
+            result = control_server_blocklist(debuglvl, vctx, type, data);
+            if(result == 0)
+            {
+                clients[i].waiting = TRUE;
+                reload_requested = TRUE;
+            }
+            else
+            {
+                (void)control_server_reply(debuglvl, i,
+                        result == 1 ? VR_RR_NOCHANGES : VR_RR_ERROR);
+            }
+            break;
+
+        default:
+            (void)vrprint.warning("Warning", "unknown request %d on the control channel.", type);
+            (void)control_server_reply(debuglvl, i, VR_RR_ERROR);
+            break;
+    }
+}
+
+
+static void
+control_server_accept(const int debuglvl)
+{
+    struct ucred    cred;
+    socklen_t       credlen = sizeof(cred);
+    int             fd = -1,
+                    i = 0;
+
+    if((fd = accept(listen_fd, NULL, NULL)) == -1)
+        return;
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    /* the socket is 0600, but make sure */
+    if(getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &credlen) == -1 || cred.uid != 0)
+    {
+        (void)vrprint.warning("Warning", "refused a non-root client on the control channel.");
+        (void)close(fd);
+        return;
+    }
+
+    for(i = 0; i < CONTROL_MAX_CLIENTS; i++)
+    {
+        if(clients[i].fd == -1)
+        {
+            clients[i].fd = fd;
+            clients[i].waiting = FALSE;
+
+            if(debuglvl >= MEDIUM)
+                (void)vrprint.debug(__FUNC__, "client %d (pid %ld) connected.", i, (long)cred.pid);
+            return;
+        }
+    }
+
+    (void)vrprint.warning("Warning", "too many clients on the control channel.");
+    (void)close(fd);
+}
+
+
+/*  control_server_setup
+
+    Creates the control socket.
+
+    Returncodes:
+         0: ok
+        -1: error, the control channel is not available
+*/
+int
+control_server_setup(const int debuglvl)
+{
+    int i = 0;
+
+    for(i = 0; i < CONTROL_MAX_CLIENTS; i++)
+    {
+        clients[i].fd = -1;
+        clients[i].waiting = FALSE;
+    }
+
+    started = time(NULL);
+
+    if((listen_fd = control_listen(debuglvl, CONTROL_SOCKET)) < 0)
+        return(-1);
+
+    return(0);
+}
+
+
+/*  control_server_wait
+
+    Waits at most 'timeout' seconds for requests, and handles them. Returns
+    early when a request needs a reload, or when 'watch_fd' (if not -1)
+    becomes readable. Without any socket this is just a sleep.
+
+    Returncodes:
+         2: watch_fd is readable
+         1: a reload was requested
+         0: timeout
+*/
+int
+control_server_wait(const int debuglvl, VuurmuurCtx *vctx, int timeout, int watch_fd)
+{
+    struct pollfd   pfd[CONTROL_MAX_CLIENTS + 2];
+    int             idx[CONTROL_MAX_CLIENTS + 2];
+    int             n = 0,
+                    i = 0,
+                    result = 0,
+                    left = 0;
+    time_t          deadline = 0;
+
+    if(listen_fd < 0 && watch_fd < 0)
+    {
+        (void)sleep((unsigned int)timeout);
+        return(0);
+    }
+
+    deadline = time(NULL) + timeout;
+
+    while(reload_requested == FALSE && (left = (int)(deadline - time(NULL))) > 0)
+    {
+        /* poll() ignores negative fds, so these two are always there */
+        n = 0;
+        pfd[n].fd = listen_fd;
+        pfd[n].events = POLLIN;
+        idx[n++] = -1;
+        pfd[n].fd = watch_fd;
+        pfd[n].events = POLLIN;
+        idx[n++] = -1;
+
+        for(i = 0; i < CONTROL_MAX_CLIENTS; i++)
+        {
+            /* clients waiting for a reload can only go away */
+            if(clients[i].fd != -1)
+            {
+                pfd[n].fd = clients[i].fd;
+                pfd[n].events = POLLIN;
+                idx[n++] = i;
+            }
+        }
+
+        result = poll(pfd, (nfds_t)n, left * 1000);
+        if(result == -1 && errno == EINTR)
+            /* a signal: let the main loop look at it */
+            break;
+        if(result <= 0)
+            break;
+
+        if(pfd[1].revents & POLLIN)
+            return(2);
+
+        for(i = 2; i < n; i++)
+        {
+            if(pfd[i].revents & POLLIN)
+                control_server_request(debuglvl, vctx, idx[i]);
+            else if(pfd[i].revents & (POLLHUP|POLLERR|POLLNVAL))
+                control_server_drop(debuglvl, idx[i]);
+        }
+
+        if(pfd[0].revents & POLLIN)
+            control_server_accept(debuglvl);
+    }
+
+    if(reload_requested == TRUE)
+    {
+        reload_requested = FALSE;
+        return(1);
+    }
+
+    return(0);
+}
+
+
+/*  control_server_progress
+
+    Tells the clients waiting for the reload how far we are.
+*/
+void
+control_server_progress(const int debuglvl, int percent)
+{
+    int i = 0;
+
+    for(i = 0; i < CONTROL_MAX_CLIENTS; i++)
+    {
+        if(clients[i].fd != -1 && clients[i].waiting == TRUE)
+        {
+            if(control_send(debuglvl, clients[i].fd, CONTROL_PROGRESS, &percent, sizeof(percent)) < 0)
+                control_server_drop(debuglvl, i);
+        }
+    }
+}
+
+
+/*  control_server_result
+
+    Records the result of a reload and sends it to the waiting clients.
+*/
+void
+control_server_result(const int debuglvl, int result)
+{
+    int i = 0;
+
+    reload_count++;
+    last_reload = time(NULL);
+    last_result = result;
+
+    for(i = 0; i < CONTROL_MAX_CLIENTS; i++)
+    {
+        if(clients[i].fd != -1 && clients[i].waiting == TRUE)
+        {
+            clients[i].waiting = FALSE;
+            (void)control_server_reply(debuglvl, i, result);
+        }
+    }
+}
+
+
+void
+control_server_cleanup(const int debuglvl)
+{
+    int i = 0;
+
+    for(i = 0; i < CONTROL_MAX_CLIENTS; i++)
+    {
+        if(clients[i].fd != -1)
+            control_server_drop(debuglvl, i);
+    }
+
+    if(listen_fd >= 0)
+    {
+        (void)close(listen_fd);
+        listen_fd = -1;
+        (void)unlink(CONTROL_SOCKET);
+    }
+}
@@ -3131,6 +3131,46 @@ static int pre_rules_interface_counters_ipv4(const int debuglvl,
     return (retval);
 }
 
+static int pre_rules_host_accounting_ipv4(const int debuglvl,
+        /*@null@*/RuleSet *ruleset, IptCap *iptcap, int ipv)
+{
+    int retval = 0;
+    char cmd[MAX_PIPE_COMMAND] = "";
+    const char *dir = NULL;
+    int set = 0;
+
+    /*
+        the hosts and networks are in ipsets (see hostacc.c), so these
+        rules only count: no target, and the same number of rules for
+        any number of hosts.
+    */
+    if (hostacc_ipsets_loaded() == FALSE)
+        return(0);
+
+    if (conf.bash_out == TRUE)
+        fprintf(stdout, "\n# Creating host accounting rules...\n");
+
+    if (debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "Creating host accounting rules...");
+
+    for (set = 0; set < HOSTACC_SETS; set++)
+    {
+        dir = (set == HOSTACC_HOST_SRC || set == HOSTACC_NET_SRC) ? "src" : "dst";
+        snprintf(cmd, sizeof(cmd), "-m set --match-set %s %s",
+                hostacc_set_names[set], dir);
+
+        /* from a host to the firewall, or from the firewall to a host */
+        if (process_rule(debuglvl, ruleset, ipv, TB_FILTER,
+                    strcmp(dir, "src") == 0 ? CH_INPUT : CH_OUTPUT, cmd, 0, 0) < 0)
+            retval = -1;
+
+        if (process_rule(debuglvl, ruleset, ipv, TB_FILTER, CH_FORWARD, cmd, 0, 0) < 0)
+            retval = -1;
+    }
+
+    return (retval);
+}
+
 static int pre_rules_set_policy(const int debuglvl, /*@null@*/RuleSet *ruleset,
         IptCap *iptcap, int ipv)
 {
@@ -4104,6 +4144,9 @@ pre_rules(const int debuglvl, /*@null@*/RuleSet *ruleset, Interfaces *interfaces
     pre_rules_interface_counters_ipv4(debuglvl, ruleset, interfaces,
             iptcap, VR_IPV4);
 
+    /* host and network counters, IPv4 only */
+    pre_rules_host_accounting_ipv4(debuglvl, ruleset, iptcap, VR_IPV4);
+
     /* set the policy */
     pre_rules_set_policy(debuglvl, ruleset, iptcap, VR_IPV4);
 #ifdef IPV6_ENABLED
@@ -0,0 +1,653 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "main.h"
+
+/*
+    Host and network accounting
+
+    With HOST_ACCOUNTING the traffic of every active host and network is
+    counted. The addresses go into four sets with a counter per element:
+    ipsets for iptables, named sets in the nftables ruleset. A constant
+    number of rules matches against the sets, so the ruleset doesn't grow
+    with the number of hosts.
+
+    The sets are updated with the difference between what is loaded and
+    what we want, so the counters of the hosts that stay survive a reload.
+    With nftables the sets live in a table of their own that is not
+    deleted on a reload (see nft_acc_sets() in nftables.c).
+
+    The samples go into their own traffic volume store, with the series
+    "h:<ipaddress>" for hosts and "n:<network>/<cidr>" for networks.
+*/
+
+#define HOSTACC_HASH_ROWS   1024
+
+/* the rollups of the host store: an hour, two days and two months */
+static const unsigned int   hostacc_slots[TRAFVOL_UNITS] = { 60, 48, 62 };
+
+/* the sets, in the order of HOSTACC_* in main.h */
+const char                  *hostacc_set_names[HOSTACC_SETS] =
+{
+    "vrmr_acc_host_src",
+    "vrmr_acc_host_dst",
+    "vrmr_acc_net_src",
+    "vrmr_acc_net_dst",
+};
+
+static TrafVolStore         hostacc_store;
+static char                 hostacc_store_open = FALSE;
+static char                 hostacc_store_disabled = FALSE;
+
+/* set when the ipsets were loaded, so pre_rules can match against them */
+static char                 hostacc_ipsets = FALSE;
+
+/* one element of a set while sampling */
+struct HostAccCount_
+{
+    char                name[24];   /* keep this first, we hash on it */
+    unsigned long long  in_bytes;
+    unsigned long long  out_bytes;
+};
+
+/* the elements of one sample, by name */
+struct HostAccCounts_
+{
+    d_list              list;
+    Hash                hash;
+};
+
+
+static int
+hostacc_is_net(int set)
+{
+    return(set == HOSTACC_NET_SRC || set == HOSTACC_NET_DST);
+}
+
+
+static int
+hostacc_netmask_to_cidr(const char *netmask)
+{
+    struct in_addr  mask;
+    unsigned long   m = 0;
+    int             cidr = 0;
+
+    if(inet_pton(AF_INET, netmask, &mask) != 1)
+        return(-1);
+
+    for(m = ntohl(mask.s_addr); m & 0x80000000UL; m = (m << 1) & 0xffffffffUL)
+        cidr++;
+
+    return(cidr);
+}
+
+
+/*  hostacc_add_unique
+
+    Appends a copy of 'str' to 'list', unless 'seen' already has it.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+hostacc_add_unique(const int debuglvl, d_list *list, Hash *seen, const char *str)
+{
+    char    *copy = NULL;
+
+    if(hash_search(debuglvl, seen, (void *)str) != NULL)
+        return(0);
+
+    if(!(copy = strdup(str)))
+    {
+        (void)vrprint.error(-1, "Error", "strdup failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    if(d_list_append(debuglvl, list, copy) == NULL)
+    {
+        free(copy);
+        return(-1);
+    }
+    if(hash_insert(debuglvl, seen, copy) != 0)
+        return(-1);
+
+    return(0);
+}
+
+
+/*  hostacc_collect
+
+    Fills 'hosts' with the ipaddresses of the active hosts and 'nets'
+    with 'network/cidr' of the active networks. Both lists have to be
+    setup by the caller, with free() as remove function.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+hostacc_collect(const int debuglvl, Zones *zones, d_list *hosts, d_list *nets)
+{
+    d_list_node     *d_node = NULL;
+    ZoneData        *zone_ptr = NULL;
+    Hash            seen;
+    char            net[32] = "";
+    int             cidr = 0,
+                    retval = 0;
+
+    /* safety */
+    if(zones == NULL || hosts == NULL || nets == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(hash_setup(debuglvl, &seen, HOSTACC_HASH_ROWS, hash_name, compare_string) != 0)
+        return(-1);
+
+    for(d_node = zones->list.top; d_node != NULL && retval == 0; d_node = d_node->next)
+    {
+        zone_ptr = d_node->data;
+        if(zone_ptr == NULL || zone_ptr->active == FALSE)
+            continue;
+
+        if(zone_ptr->type == TYPE_HOST && zone_ptr->ipv4.ipaddress[0] != '\0')
+        {
+            retval = hostacc_add_unique(debuglvl, hosts, &seen, zone_ptr->ipv4.ipaddress);
+        }
+        else if(zone_ptr->type == TYPE_NETWORK && zone_ptr->ipv4.network[0] != '\0')
+        {
+            /* a /0 'network' like the internet is everything: we
+               can't put it in a set and it says nothing anyway */
+            if((cidr = hostacc_netmask_to_cidr(zone_ptr->ipv4.netmask)) <= 0)
+                continue;
+
+            snprintf(net, sizeof(net), "%s/%d", zone_ptr->ipv4.network, cidr);
+            retval = hostacc_add_unique(debuglvl, nets, &seen, net);
+        }
+    }
+
+    (void)hash_cleanup(debuglvl, &seen);
+    return(retval);
+}
+
+
+/*  hostacc_parse
+
+    Reads the elements with their byte counters from the output of
+    'ipset save <set>':
+
+        add vrmr_acc_host_src 192.168.1.2 packets 10 bytes 840
+
+    or 'nft list set ...':
+
+        elements = { 192.168.1.2 counter packets 10 bytes 840,
+
+    and calls 'cb' for each of them. Networks that cover one address
+    are printed without '/32', we add it so they match what we loaded.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+hostacc_parse(const int debuglvl, FILE *fp, int set,
+        int (*cb)(const int, int, const char *, unsigned long long, void *), void *ctx)
+{
+    char                *line = NULL,
+                        *tok = NULL,
+                        *saveptr = NULL,
+                        cand[24] = "",
+                        elem[24] = "";
+    size_t              line_size = 0;
+    unsigned long long  bytes = 0;
+    int                 state = 0,
+                        retval = 0;
+
+    while(retval == 0 && getline(&line, &line_size, fp) != -1)
+    {
+        state = 0;
+
+        for(tok = strtok_r(line, " \t\r\n,{}=", &saveptr); tok != NULL && retval == 0;
+            tok = strtok_r(NULL, " \t\r\n,{}=", &saveptr))
+        {
+            switch(state)
+            {
+                case 0:
+                    if(strcmp(tok, "packets") == 0)
+                    {
+                        (void)strlcpy(elem, cand, sizeof(elem));
+                        state = 1;
+                    }
+                    else if(strcmp(tok, "counter") != 0)
+                        (void)strlcpy(cand, tok, sizeof(cand));
+                    break;
+                case 1:
+                    /* the packets, we don't keep them */
+                    state = 2;
+                    break;
+                case 2:
+                    state = (strcmp(tok, "bytes") == 0) ? 3 : 0;
+                    break;
+                case 3:
+                    bytes = strtoull(tok, NULL, 10);
+                    if(hostacc_is_net(set) && strchr(elem, '/') == NULL)
+                        (void)strlcat(elem, "/32", sizeof(elem));
+
+                    retval = cb(debuglvl, set, elem, bytes, ctx);
+                    state = 0;
+                    break;
+            }
+        }
+    }
+
+    /* drain the pipe if we bailed out early */
+    while(getline(&line, &line_size, fp) != -1);
+
+    free(line);
+    return(retval);
+}
+
+
+/*  hostacc_list_set
+
+    Runs 'ipset save' or 'nft list set' for one of our sets and hands
+    its elements to hostacc_parse.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+hostacc_list_set(const int debuglvl, int set,
+        int (*cb)(const int, int, const char *, unsigned long long, void *), void *ctx)
+{
+    char    command[MAX_PIPE_COMMAND] = "";
+    FILE    *p = NULL;
+    int     retval = 0;
+
+    if(conf.use_nftables == TRUE)
+        snprintf(command, sizeof(command), "%s list set inet %s %s 2>/dev/null",
+                conf.nft_location, HOSTACC_NFT_TABLE, hostacc_set_names[set]);
+    else
+        snprintf(command, sizeof(command), "%s save %s 2>/dev/null",
+                conf.ipset_location, hostacc_set_names[set]);
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "command: '%s'.", command);
+
+    if(!(p = popen(command, "r")))
+    {
+        (void)vrprint.error(-1, "Internal Error", "pipe failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    retval = hostacc_parse(debuglvl, p, set, cb, ctx);
+
+    (void)pclose(p);
+    return(retval);
+}
+
+
+/* remember what is loaded in the ipsets: the 'src' sets have the same elements */
+static int
+hostacc_loaded_cb(const int debuglvl, int set, const char *elem,
+        unsigned long long bytes, void *ctx)
+{
+    d_list  *list = (d_list *)ctx;
+    char    *copy = NULL;
+
+    if(!(copy = strdup(elem)))
+    {
+        (void)vrprint.error(-1, "Error", "strdup failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    if(d_list_append(debuglvl, list, copy) == NULL)
+    {
+        free(copy);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  hostacc_loaded
+
+    Appends the elements that are in 'set' now to 'loaded'. A set that
+    doesn't exist yet just has no elements.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+hostacc_loaded(const int debuglvl, int set, d_list *loaded)
+{
+    return(hostacc_list_set(debuglvl, set, hostacc_loaded_cb, loaded));
+}
+
+
+/*  hostacc_ipset_write
+
+    Writes the 'ipset restore' commands that make 'set' contain 'want'.
+    'loaded' is what is in the set now, or NULL if we don't know.
+*/
+static int
+hostacc_ipset_write(const int debuglvl, FILE *fp, int set, d_list *want, d_list *loaded)
+{
+    d_list_node *d_node = NULL;
+    Hash        want_hash,
+                loaded_hash;
+    int         retval = 0;
+
+    if(hash_setup(debuglvl, &want_hash, HOSTACC_HASH_ROWS, hash_name, compare_string) != 0 ||
+        hash_setup(debuglvl, &loaded_hash, HOSTACC_HASH_ROWS, hash_name, compare_string) != 0)
+        return(-1);
+
+    for(d_node = want->top; d_node != NULL && retval == 0; d_node = d_node->next)
+    {
+        if(hash_insert(debuglvl, &want_hash, d_node->data) != 0)
+            retval = -1;
+    }
+    for(d_node = loaded ? loaded->top : NULL; d_node != NULL && retval == 0; d_node = d_node->next)
+    {
+        if(hash_insert(debuglvl, &loaded_hash, d_node->data) != 0)
+            retval = -1;
+    }
+
+    if(retval == 0)
+    {
+        fprintf(fp, "create %s %s counters\n", hostacc_set_names[set],
+                hostacc_is_net(set) ? "hash:net" : "hash:ip");
+
+        for(d_node = loaded ? loaded->top : NULL; d_node != NULL; d_node = d_node->next)
+        {
+            if(hash_search(debuglvl, &want_hash, d_node->data) == NULL)
+                fprintf(fp, "del %s %s\n", hostacc_set_names[set], (char *)d_node->data);
+        }
+        for(d_node = want->top; d_node != NULL; d_node = d_node->next)
+        {
+            if(hash_search(debuglvl, &loaded_hash, d_node->data) == NULL)
+                fprintf(fp, "add %s %s\n", hostacc_set_names[set], (char *)d_node->data);
+        }
+    }
+
+    (void)hash_cleanup(debuglvl, &want_hash);
+    (void)hash_cleanup(debuglvl, &loaded_hash);
+    return(retval);
+}
+
+
+/*  hostacc_setup
+
+    Loads the hosts and networks into the ipsets, before the iptables
+    ruleset that matches against them is created. In bash mode the
+    'ipset restore' commands are printed instead. nftables has the sets
+    in its own ruleset, see nftables.c.
+
+    Returncodes:
+         0: ok, or host accounting is off
+        -1: error, no host accounting rules will be created
+*/
+int
+hostacc_setup(const int debuglvl, VuurmuurCtx *vctx)
+{
+    d_list      hosts,
+                nets,
+                loaded;
+    FILE        *p = NULL;
+    char        command[MAX_PIPE_COMMAND] = "",
+                result_path[] = "/tmp/vuurmuur-ipset-result-XXXXXX";
+    int         retval = 0,
+                result_fd = -1,
+                status = 0,
+                set = 0;
+
+    /* safety */
+    if(vctx == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    hostacc_ipsets = FALSE;
+
+    if(conf.host_accounting == FALSE || conf.use_nftables == TRUE)
+        return(0);
+
+    if(d_list_setup(debuglvl, &hosts, free) < 0 ||
+        d_list_setup(debuglvl, &nets, free) < 0 ||
+        d_list_setup(debuglvl, &loaded, free) < 0)
+        return(-1);
+
+    if(hostacc_collect(debuglvl, vctx->zones, &hosts, &nets) < 0)
+        retval = -1;
+
+    if(retval == 0 && conf.bash_out == TRUE)
+    {
+        fprintf(stdout, "\n# Loading the host accounting sets...\n");
+        fprintf(stdout, "%s restore -exist <<EOF\n", conf.ipset_location);
+        for(set = 0; set < HOSTACC_SETS && retval == 0; set++)
+            retval = hostacc_ipset_write(debuglvl, stdout, set,
+                    hostacc_is_net(set) ? &nets : &hosts, NULL);
+        fprintf(stdout, "EOF\n");
+    }
+    else if(retval == 0)
+    {
+        /* what ipset complains about goes to the resultfile */
+        if((result_fd = create_tempfile(debuglvl, result_path)) == -1)
+        {
+            (void)vrprint.error(-1, "Error", "creating resultfile failed (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            retval = -1;
+        }
+        else
+        {
+            (void)close(result_fd);
+
+            snprintf(command, sizeof(command), "%s restore -exist 2>> %s",
+                    conf.ipset_location, result_path);
+            if(debuglvl >= HIGH)
+                (void)vrprint.debug(__FUNC__, "command: '%s'.", command);
+
+            if(!(p = popen(command, "w")))
+            {
+                (void)vrprint.error(-1, "Internal Error", "pipe failed: %s (in: %s:%d).",
+                        strerror(errno), __FUNC__, __LINE__);
+                retval = -1;
+            }
+        }
+
+        for(set = 0; set < HOSTACC_SETS && retval == 0; set++)
+        {
+            if(hostacc_loaded(debuglvl, set, &loaded) < 0 ||
+                hostacc_ipset_write(debuglvl, p, set,
+                    hostacc_is_net(set) ? &nets : &hosts, &loaded) < 0)
+                retval = -1;
+
+            (void)d_list_cleanup(debuglvl, &loaded);
+            (void)d_list_setup(debuglvl, &loaded, free);
+        }
+
+        if(p != NULL)
+        {
+            status = pclose(p);
+            if(status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                (void)vrprint.error(-1, "Error", "loading the host accounting sets with '%s' failed.",
+                        conf.ipset_location);
+                (void)ruleset_log_resultfile(debuglvl, result_path);
+                retval = -1;
+            }
+        }
+
+        if(result_fd != -1)
+            (void)unlink(result_path);
+    }
+
+    if(retval == 0)
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "host accounting: %u hosts, %u networks.",
+                    hosts.len, nets.len);
+        hostacc_ipsets = TRUE;
+    }
+
+    (void)d_list_cleanup(debuglvl, &hosts);
+    (void)d_list_cleanup(debuglvl, &nets);
+    (void)d_list_cleanup(debuglvl, &loaded);
+    return(retval);
+}
+
+
+/* are the ipsets loaded? If so, pre_rules creates the rules that use them. */
+int
+hostacc_ipsets_loaded(void)
+{
+    return(hostacc_ipsets);
+}
+
+
+/* add the counter of an element to its series */
+static int
+hostacc_count_cb(const int debuglvl, int set, const char *elem,
+        unsigned long long bytes, void *ctx)
+{
+    struct HostAccCounts_   *counts = (struct HostAccCounts_ *)ctx;
+    struct HostAccCount_    *count = NULL,
+                            search;
+
+    snprintf(search.name, sizeof(search.name), "%c:%s",
+            hostacc_is_net(set) ? 'n' : 'h', elem);
+
+    if(!(count = hash_search(debuglvl, &counts->hash, &search)))
+    {
+        if(!(count = calloc(1, sizeof(struct HostAccCount_))))
+        {
+            (void)vrprint.error(-1, "Error", "calloc failed: %s (in: %s:%d).",
+                    strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+        (void)strlcpy(count->name, search.name, sizeof(count->name));
+
+        if(d_list_append(debuglvl, &counts->list, count) == NULL)
+        {
+            free(count);
+            return(-1);
+        }
+        if(hash_insert(debuglvl, &counts->hash, count) != 0)
+            return(-1);
+    }
+
+    /* traffic from the host is outgoing for it, to the host incoming */
+    if(set == HOSTACC_HOST_SRC || set == HOSTACC_NET_SRC)
+        count->out_bytes = bytes;
+    else
+        count->in_bytes = bytes;
+
+    return(0);
+}
+
+
+/*  hostacc_sample
+
+    Reads the counters of the sets and adds them to the host store.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+hostacc_sample(const int debuglvl, time_t now)
+{
+    struct HostAccCounts_   counts;
+    struct HostAccCount_    *count = NULL;
+    d_list_node             *d_node = NULL;
+    int                     set = 0,
+                            retval = 0;
+
+    if(conf.host_accounting == FALSE || hostacc_store_disabled == TRUE)
+        return(0);
+
+    /* with iptables we only have counters if the ipsets were loaded */
+    if(conf.use_nftables == FALSE && hostacc_ipsets == FALSE)
+        return(0);
+
+    if(hostacc_store_open == FALSE)
+    {
+        if(trafvol_open(debuglvl, &hostacc_store, HOSTVOL_LOCATION, TRUE, hostacc_slots) != 0)
+        {
+            (void)vrprint.warning("Warning", "can't open the host traffic volume store, "
+                    "no host accounting.");
+            hostacc_store_disabled = TRUE;
+            return(-1);
+        }
+        hostacc_store_open = TRUE;
+    }
+
+    if(d_list_setup(debuglvl, &counts.list, free) < 0)
+        return(-1);
+    if(hash_setup(debuglvl, &counts.hash, HOSTACC_HASH_ROWS, hash_name, compare_string) != 0)
+    {
+        (void)d_list_cleanup(debuglvl, &counts.list);
+        return(-1);
+    }
+
+    for(set = 0; set < HOSTACC_SETS && retval == 0; set++)
+        retval = hostacc_list_set(debuglvl, set, hostacc_count_cb, &counts);
+
+    for(d_node = counts.list.top; d_node != NULL && retval == 0; d_node = d_node->next)
+    {
+        count = d_node->data;
+
+        if(trafvol_update(debuglvl, &hostacc_store, count->name, TRAFVOL_SRC_SET,
+                now, count->in_bytes, count->out_bytes) < 0)
+            retval = -1;
+    }
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "%u hosts and networks sampled.", counts.list.len);
+
+    (void)hash_cleanup(debuglvl, &counts.hash);
+    (void)d_list_cleanup(debuglvl, &counts.list);
+    return(retval);
+}
+
+
+/*  hostacc_cleanup
+
+    Closes the host store. The sets are left alone, the ruleset uses
+    them.
+*/
+void
+hostacc_cleanup(const int debuglvl)
+{
+    if(hostacc_store_open == TRUE)
+        trafvol_close(debuglvl, &hostacc_store);
+
+    hostacc_store_open = FALSE;
+    hostacc_store_disabled = FALSE;
+}
@@ -0,0 +1,278 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "main.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+/*
+    Watching the dynamic interfaces
+
+    Instead of asking every dynamic interface for its ipaddress every
+    DYN_INT_INTERVAL seconds, we listen to the link and ipv4 address
+    events of the kernel. Only the interfaces an event is about are
+    checked, and we know about a new DHCP lease or PPP link right away.
+*/
+
+/* DHCP and PPP tend to send a burst of events, wait this long (ms) for
+   the burst to end so we reload only once. But a flapping link doesn't
+   keep us here for more than IFWATCH_SETTLE_MAX rounds. */
+#define IFWATCH_SETTLE      200
+#define IFWATCH_SETTLE_MAX  10
+
+static int  ifwatch_sock = -1;
+
+
+/*  ifwatch_setup
+
+    Returncodes:
+         0: ok
+        -1: error, fall back to polling
+*/
+int
+ifwatch_setup(const int debuglvl)
+{
+    struct sockaddr_nl  addr;
+
+    if((ifwatch_sock = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE)) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "creating netlink socket failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    (void)fcntl(ifwatch_sock, F_SETFD, FD_CLOEXEC);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK|RTMGRP_IPV4_IFADDR;
+
+    if(bind(ifwatch_sock, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        (void)vrprint.error(-1, "Error", "binding netlink socket failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        (void)close(ifwatch_sock);
+        ifwatch_sock = -1;
+        return(-1);
+    }
+
+    if(debuglvl >= LOW)
+        (void)vrprint.debug(__FUNC__, "watching the interfaces through netlink.");
+
+    return(0);
+}
+
+
+int
+ifwatch_fd(void)
+{
+    return(ifwatch_sock);
+}
+
+
+void
+ifwatch_cleanup(const int debuglvl)
+{
+    if(ifwatch_sock >= 0)
+    {
+        (void)close(ifwatch_sock);
+        ifwatch_sock = -1;
+    }
+}
+
+
+/* the device name of a link or address message, "" if we can't tell */
+static void
+ifwatch_device(struct nlmsghdr *nlh, char *device, size_t size)
+{
+    struct ifinfomsg    *ifi = NULL;
+    struct ifaddrmsg    *ifa = NULL;
+    struct rtattr       *rta = NULL;
+    int                 len = 0;
+    unsigned int        index = 0;
+    char                name[IF_NAMESIZE] = "";
+
+    device[0] = '\0';
+
+    if(nlh->nlmsg_type == RTM_NEWLINK || nlh->nlmsg_type == RTM_DELLINK)
+    {
+        ifi = NLMSG_DATA(nlh);
+        index = (unsigned int)ifi->ifi_index;
+
+        /* a deleted link has no index anymore, but it does have a name */
+        len = (int)IFLA_PAYLOAD(nlh);
+        for(rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+        {
+            if(rta->rta_type == IFLA_IFNAME)
+            {
+                (void)strlcpy(device, RTA_DATA(rta), size);
+                return;
+            }
+        }
+    }
+    else
+    {
+        ifa = NLMSG_DATA(nlh);
+        index = ifa->ifa_index;
+    }
+
+    if(if_indextoname(index, name) != NULL)
+        (void)strlcpy(device, name, size);
+}
+
+
+/* drain the socket. 'devices' gets the names, space separated */
+static int
+ifwatch_drain(const int debuglvl, char *devices, size_t size, char *overflow)
+{
+    char                buf[8192];
+    struct nlmsghdr     *nlh = NULL;
+    ssize_t             len = 0;
+    int                 msglen = 0;
+    char                device[IF_NAMESIZE] = "",
+                        match[IF_NAMESIZE + 2] = "";
+
+    while(1)
+    {
+        len = recv(ifwatch_sock, buf, sizeof(buf), MSG_DONTWAIT);
+        if(len == -1)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                return(0);
+
+            /* we missed events, so we can't tell who changed */
+            if(errno == ENOBUFS)
+            {
+                *overflow = TRUE;
+                continue;
+            }
+
+            (void)vrprint.error(-1, "Error", "reading netlink socket failed: %s (in: %s:%d).",
+                    strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+
+        msglen = (int)len;
+        for(nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, msglen); nlh = NLMSG_NEXT(nlh, msglen))
+        {
+            if(nlh->nlmsg_type != RTM_NEWLINK && nlh->nlmsg_type != RTM_DELLINK &&
+                nlh->nlmsg_type != RTM_NEWADDR && nlh->nlmsg_type != RTM_DELADDR)
+            {
+                continue;
+            }
+
+            ifwatch_device(nlh, device, sizeof(device));
+            if(device[0] == '\0')
+            {
+                *overflow = TRUE;
+                continue;
+            }
+
+            if(debuglvl >= MEDIUM)
+                (void)vrprint.debug(__FUNC__, "event %u for '%s'.", nlh->nlmsg_type, device);
+
+            /* remember every device once */
+            snprintf(match, sizeof(match), " %s ", device);
+            if(strstr(devices, match) == NULL)
+            {
+                if(devices[0] == '\0')
+                    (void)strlcpy(devices, " ", size);
+                (void)strlcat(devices, device, size);
+                (void)strlcat(devices, " ", size);
+            }
+        }
+    }
+}
+
+
+/*  ifwatch_check
+
+    Reads the pending events and checks the dynamic interfaces they are
+    about. Call it when ifwatch_fd() is readable.
+
+    Returncodes:
+        -1: error
+        0: no changes
+        1: changes
+*/
+int
+ifwatch_check(const int debuglvl, Interfaces *interfaces)
+{
+    struct pollfd           pfd;
+    d_list_node             *d_node = NULL;
+    struct InterfaceData_   *iface_ptr = NULL;
+    char                    devices[512] = "",
+                            match[sizeof(iface_ptr->device) + 2] = "",
+                            overflow = FALSE;
+    int                     result = 0,
+                            retval = 0,
+                            rounds = 0;
+
+    if(ifwatch_sock < 0 || interfaces == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    /* read until the burst is over */
+    do
+    {
+        if(ifwatch_drain(debuglvl, devices, sizeof(devices), &overflow) < 0)
+            return(-1);
+
+        pfd.fd = ifwatch_sock;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+    }
+    while(++rounds < IFWATCH_SETTLE_MAX && poll(&pfd, 1, IFWATCH_SETTLE) > 0);
+
+    /* the list is full when names don't fit: check everything */
+    if(strlen(devices) >= sizeof(devices) - IF_NAMESIZE - 2)
+        overflow = TRUE;
+
+    for(d_node = interfaces->list.top; d_node; d_node = d_node->next)
+    {
+        if(!(iface_ptr = d_node->data))
+        {
+            (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).", __FUNC__, __LINE__);
+            return(-1);
+        }
+
+        if(iface_ptr->dynamic != 1 || iface_ptr->device[0] == '\0')
+            continue;
+
+        snprintf(match, sizeof(match), " %s ", iface_ptr->device);
+        if(overflow == FALSE && strstr(devices, match) == NULL)
+            continue;
+
+        result = check_for_changed_dynamic_ip(debuglvl, iface_ptr);
+        if(result < 0)
+            return(-1);
+        else if(result == 1)
+            retval = 1;
+    }
+
+    return(retval);
+}
@@ -60,6 +60,9 @@
 
 #define LOOP_INT                1
 
+/* seconds between two samples of the traffic volume accounting */
+#define ACCOUNTING_INTERVAL     60
+
 #define YES                     1
 #define NO                      0
 
@@ -247,7 +250,7 @@ typedef struct
     /*
         shaping
     */
-    d_list  tc_rules;                   /* list with tc rules */
+    d_list  tc_rules;                   /* list with tc qdiscs and classes (shape.c) */
 
 } RuleSet;
 
@@ -346,8 +349,45 @@ int sysctl_exec(const int debuglvl, struct vuurmuur_config *cnf, char *key, char
 // none ;-)
 
 
+/* control_server.c */
+int control_server_setup(const int debuglvl);
+int control_server_wait(const int debuglvl, VuurmuurCtx *vctx, int timeout, int watch_fd);
+void control_server_progress(const int debuglvl, int percent);
+void control_server_result(const int debuglvl, int result);
+void control_server_cleanup(const int debuglvl);
+
+/* ifwatch.c */
+int ifwatch_setup(const int debuglvl);
+int ifwatch_fd(void);
+void ifwatch_cleanup(const int debuglvl);
+int ifwatch_check(const int debuglvl, Interfaces *interfaces);
+
+/* accounting.c */
+int accounting_sample(const int debuglvl, Interfaces *interfaces);
+void accounting_cleanup(const int debuglvl);
+
+/* hostacc.c */
+enum
+{
+    HOSTACC_HOST_SRC = 0,
+    HOSTACC_HOST_DST,
+    HOSTACC_NET_SRC,
+    HOSTACC_NET_DST,
+    HOSTACC_SETS
+};
+/* the nftables table with the host accounting sets, kept over reloads */
+#define HOSTACC_NFT_TABLE   "vuurmuur_acc"
+extern const char *hostacc_set_names[HOSTACC_SETS];
+int hostacc_collect(const int debuglvl, Zones *zones, d_list *hosts, d_list *nets);
+int hostacc_loaded(const int debuglvl, int set, d_list *loaded);
+int hostacc_setup(const int debuglvl, VuurmuurCtx *vctx);
+int hostacc_ipsets_loaded(void);
+int hostacc_sample(const int debuglvl, time_t now);
+void hostacc_cleanup(const int debuglvl);
+
 /* reload.c */
 int apply_changes(const int, VuurmuurCtx *vctx, struct rgx_ *);
+int apply_changes_dynamic(const int debuglvl, VuurmuurCtx *vctx);
 
 int reload_services(const int, Services *, regex_t *);
 int reload_services_check(const int, struct ServicesData_ *);
@@ -358,24 +398,40 @@ int reload_zonedata_check(const int, Zones *, Interfaces *, struct ZoneData_ *,
 int reload_interfaces(const int, Interfaces *);
 int reload_interfaces_check(const int, struct InterfaceData_ *iface_ptr);
 
+int check_for_changed_dynamic_ip(const int debuglvl, struct InterfaceData_ *iface_ptr);
 int check_for_changed_dynamic_ips(const int debuglvl, Interfaces *interfaces);
 
 /* ruleset */
+int ruleset_setup(const int, RuleSet *);
+void ruleset_cleanup(const int, RuleSet *);
+int ruleset_create_ruleset(const int, VuurmuurCtx *, RuleSet *);
+int ruleset_fill_file(const int, VuurmuurCtx *, RuleSet *, int, int);
 int ruleset_add_rule_to_set(const int, d_list *, char *, char *, unsigned long long, unsigned long long);
 int load_ruleset(const int, VuurmuurCtx *);
+int ruleset_store_failed_set(const int, const char *);
+int ruleset_log_resultfile(const int, char *);
+
+/* nftables */
+int nftables_create_ruleset(const int, VuurmuurCtx *, FILE *);
+int nftables_load_ruleset(const int, VuurmuurCtx *);
+int nftables_clear_ruleset(const int, struct vuurmuur_config *);
+int nftables_table_loaded(const int, struct vuurmuur_config *);
 
 /* shape */
 int shaping_setup_roots (const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, /*@null@*/RuleSet *);
-int shaping_clear_interfaces (const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, /*@null@*/RuleSet *ruleset);
+int shaping_clear_interfaces (const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces);
 int determine_minimal_default_rates(const int debuglvl, Interfaces *interfaces, Rules *rules);
 int shaping_create_default_rules(const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, /*@null@*/RuleSet *ruleset);
 int shaping_shape_rule(const int debuglvl, /*@null@*/struct options *opt);
 int shaping_shape_incoming_rule(const int debuglvl, /*@null@*/struct options *opt);
 int shaping_shape_outgoing_rule(const int debuglvl, /*@null@*/struct options *opt);
 int shaping_shape_interface(const int debuglvl, InterfaceData *iface_ptr);
-int shaping_shape_create_rule(const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, struct RuleCreateData_ *rule, /*@null@*/RuleSet *ruleset, InterfaceData *shape_iface_ptr, InterfaceData *class_iface_ptr, u_int16_t class, u_int32_t rate, char *rate_unit, u_int32_t ceil, char *ceil_unit, u_int8_t prio);
+int shaping_shape_create_rule(const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, struct RuleCreateData_ *rule, /*@null@*/RuleSet *ruleset, InterfaceData *shape_iface_ptr, InterfaceData *class_iface_ptr, u_int16_t class, u_int32_t rate, char *rate_unit, u_int32_t ceil, char *ceil_unit, u_int8_t prio, char *leaf);
 int shaping_determine_minimal_default_rates(const int debuglvl, Interfaces *interfaces, Rules *rules);
 int shaping_create_default_rules(const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, /*@null@*/RuleSet *ruleset);
 int shaping_process_queued_rules(const int debuglvl, struct vuurmuur_config *cnf, /*@null@*/RuleSet *ruleset, struct RuleCreateData_ *rule);
+int shaping_tree_loaded(void);
+int shaping_write_batch(const int debuglvl, RuleSet *ruleset, int fd);
+int shaping_batch_loaded(const int debuglvl, RuleSet *ruleset, char success);
 
 #endif
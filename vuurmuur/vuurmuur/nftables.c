@@ -0,0 +1,2328 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*  functions for creating a ruleset that can be loaded into the system
+    by 'nft -f' in a single transaction.
+
+    Everything lives in one 'inet' table, so IPv4 and IPv6 share the
+    chains. Hosts, groups, networks and zones become named sets: the
+    'ifname . address' flavour pairs each address with the interfaces
+    of its network, like the '-i/-o' + '-s/-d' combination iptables
+    uses. Services become one 'proto . sport . dport' set. The filter
+    base chains dispatch on the interface using verdict maps, so a
+    packet only traverses the rules of the interface it uses.
+
+    Not supported yet: protect rules and shaping. They are skipped with
+    a warning.
+*/
+
+#include "main.h"
+
+#define NFT_TABLE               "vuurmuur"
+#define NFT_HASH_ROWS           256
+
+
+typedef struct NftChain_
+{
+    /* this should always be on top: we hash on it */
+    char    name[48];
+
+    char    *buf;
+    size_t  len;
+    FILE    *fp;
+
+} NftChain;
+
+
+typedef struct NftSet_
+{
+    /* this should always be on top: we hash on it */
+    char    name[128];
+
+    /* set has no elements, so it was not written */
+    char    empty;
+
+} NftSet;
+
+
+/* list of unique strings, in the order they were added */
+typedef struct NftList_
+{
+    d_list      list;
+    Hash        hash;
+
+} NftList;
+
+
+typedef struct NftCtx_
+{
+    VuurmuurCtx *vctx;
+
+    /* the chains in order of creation */
+    d_list      chains;
+    Hash        chain_hash;
+
+    /* sets that have been written */
+    d_list      sets;
+    Hash        set_hash;
+    char        *sets_buf;
+    size_t      sets_len;
+    FILE        *sets_fp;
+
+    /* the host accounting table, see nft_acc_sets() */
+    char        *acc_buf;
+    size_t      acc_len;
+    FILE        *acc_fp;
+    char        acc_failed;
+
+    /* devices that have their own chains */
+    NftList     devices;
+
+} NftCtx;
+
+
+static void
+nft_chain_free(void *data)
+{
+    NftChain    *chain = (NftChain *)data;
+
+    if(chain == NULL)
+        return;
+
+    if(chain->fp != NULL)
+        (void)fclose(chain->fp);
+    free(chain->buf);
+    free(chain);
+}
+
+
+/*  nft_name
+
+    Copy a name into buf, replacing the characters nft doesn't accept
+    in an identifier.
+*/
+static void
+nft_name(char *buf, size_t size, const char *name)
+{
+    size_t  i = 0;
+
+    for(i = 0; i + 1 < size && name[i] != '\0'; i++)
+    {
+        if((name[i] >= 'a' && name[i] <= 'z') ||
+           (name[i] >= 'A' && name[i] <= 'Z') ||
+           (name[i] >= '0' && name[i] <= '9') ||
+            name[i] == '.' || name[i] == '-' || name[i] == '_')
+            buf[i] = name[i];
+        else
+            buf[i] = '_';
+    }
+    buf[i] = '\0';
+}
+
+
+static NftChain *
+nft_chain_add(const int debuglvl, NftCtx *ctx, const char *name)
+{
+    NftChain    *chain = NULL;
+
+    if(!(chain = malloc(sizeof(NftChain))))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(NULL);
+    }
+    memset(chain, 0, sizeof(NftChain));
+
+    nft_name(chain->name, sizeof(chain->name), name);
+
+    if(!(chain->fp = open_memstream(&chain->buf, &chain->len)))
+    {
+        (void)vrprint.error(-1, "Error", "open_memstream failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        free(chain);
+        return(NULL);
+    }
+
+    if(d_list_append(debuglvl, &ctx->chains, chain) == NULL)
+    {
+        nft_chain_free(chain);
+        return(NULL);
+    }
+    if(hash_insert(debuglvl, &ctx->chain_hash, chain) != 0)
+        return(NULL);
+
+    return(chain);
+}
+
+
+static NftChain *
+nft_chain_get(const int debuglvl, NftCtx *ctx, const char *prefix, const char *device)
+{
+    char    name[48] = "",
+            tmp[48] = "";
+
+    if(device != NULL)
+    {
+        snprintf(tmp, sizeof(tmp), "%s_%s", prefix, device);
+        nft_name(name, sizeof(name), tmp);
+    }
+    else
+        (void)strlcpy(name, prefix, sizeof(name));
+
+    return(hash_search(debuglvl, &ctx->chain_hash, name));
+}
+
+
+/*  nft_iface_device
+
+    Get the device we can match on for an interface. Old style
+    virtual devices (eth0:0) are matched by their parent device.
+
+    Returncodes:
+         1: ok
+         0: interface is not usable
+*/
+static int
+nft_iface_device(InterfaceData *iface_ptr, char *dev, size_t size)
+{
+    char    *colon = NULL;
+
+    if(iface_ptr == NULL || iface_ptr->active == FALSE ||
+        iface_ptr->device[0] == '\0')
+        return(0);
+
+    /* same as iptables: skip dynamic interfaces that are down */
+    if(iface_ptr->dynamic == TRUE && iface_ptr->up == FALSE)
+        return(0);
+
+    (void)strlcpy(dev, iface_ptr->device, size);
+    if((colon = strchr(dev, ':')) != NULL)
+        *colon = '\0';
+
+    return(1);
+}
+
+
+static int
+nft_netmask_to_cidr(const char *netmask)
+{
+    struct in_addr  mask;
+    unsigned long   m = 0;
+    int             cidr = 0;
+
+    if(inet_pton(AF_INET, netmask, &mask) != 1)
+        return(-1);
+
+    for(m = ntohl(mask.s_addr); m & 0x80000000UL; m = (m << 1) & 0xffffffffUL)
+        cidr++;
+
+    return(cidr);
+}
+
+
+/*  nft_zone_addr
+
+    Returncodes:
+         1: ok, address in buf
+         0: object has no address for this family
+*/
+static int
+nft_zone_addr(ZoneData *zone_ptr, int ipv, char *buf, size_t size)
+{
+    int cidr = 0;
+
+    if(ipv == VR_IPV4)
+    {
+        if(zone_ptr->type == TYPE_HOST)
+        {
+            if(zone_ptr->ipv4.ipaddress[0] == '\0')
+                return(0);
+
+            (void)strlcpy(buf, zone_ptr->ipv4.ipaddress, size);
+            return(1);
+        }
+        else if(zone_ptr->type == TYPE_NETWORK)
+        {
+            if(zone_ptr->ipv4.network[0] == '\0' ||
+                (cidr = nft_netmask_to_cidr(zone_ptr->ipv4.netmask)) < 0)
+                return(0);
+
+            snprintf(buf, size, "%s/%d", zone_ptr->ipv4.network, cidr);
+            return(1);
+        }
+    }
+#ifdef IPV6_ENABLED
+    else if(ipv == VR_IPV6)
+    {
+        if(zone_ptr->type == TYPE_HOST)
+        {
+            if(zone_ptr->ipv6.ip6[0] == '\0')
+                return(0);
+
+            (void)strlcpy(buf, zone_ptr->ipv6.ip6, size);
+            return(1);
+        }
+        else if(zone_ptr->type == TYPE_NETWORK)
+        {
+            if(zone_ptr->ipv6.net6[0] == '\0' || zone_ptr->ipv6.cidr6 < 0)
+                return(0);
+
+            snprintf(buf, size, "%s/%d", zone_ptr->ipv6.net6, zone_ptr->ipv6.cidr6);
+            return(1);
+        }
+    }
+#endif
+
+    return(0);
+}
+
+
+static int
+nft_list_setup(const int debuglvl, NftList *nlist)
+{
+    if(d_list_setup(debuglvl, &nlist->list, free) < 0)
+        return(-1);
+    if(hash_setup(debuglvl, &nlist->hash, NFT_HASH_ROWS, hash_name, compare_string) != 0)
+    {
+        (void)d_list_cleanup(debuglvl, &nlist->list);
+        return(-1);
+    }
+
+    return(0);
+}
+
+
+static void
+nft_list_cleanup(const int debuglvl, NftList *nlist)
+{
+    (void)hash_cleanup(debuglvl, &nlist->hash);
+    (void)d_list_cleanup(debuglvl, &nlist->list);
+}
+
+
+/*  nft_list_add_unique
+
+    Append a copy of str to the list, unless it is already in it.
+*/
+static int
+nft_list_add_unique(const int debuglvl, NftList *nlist, const char *str)
+{
+    char        *copy = NULL;
+
+    if(hash_search(debuglvl, &nlist->hash, (void *)str) != NULL)
+        return(0);
+
+    if(!(copy = strdup(str)))
+    {
+        (void)vrprint.error(-1, "Error", "strdup failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    if(d_list_append(debuglvl, &nlist->list, copy) == NULL)
+    {
+        free(copy);
+        return(-1);
+    }
+    if(hash_insert(debuglvl, &nlist->hash, copy) != 0)
+        return(-1);
+
+    return(0);
+}
+
+
+/*  nft_collect_network
+
+    Add the address of addr_ptr to the list, once for every interface of
+    network_ptr if with_iface is set.
+*/
+static int
+nft_collect_network(const int debuglvl, ZoneData *network_ptr, ZoneData *addr_ptr,
+        int ipv, int with_iface, NftList *elems)
+{
+    d_list_node *d_node = NULL;
+    char        addr[MAX_IPV6_ADDR_LEN + 16] = "",
+                dev[16] = "",
+                elem[sizeof(addr) + sizeof(dev) + 8] = "";
+
+    if(nft_zone_addr(addr_ptr, ipv, addr, sizeof(addr)) == 0)
+        return(0);
+
+    if(with_iface == FALSE)
+        return(nft_list_add_unique(debuglvl, elems, addr));
+
+    if(network_ptr == NULL)
+        return(0);
+
+    for(d_node = network_ptr->InterfaceList.top; d_node != NULL; d_node = d_node->next)
+    {
+        if(nft_iface_device((InterfaceData *)d_node->data, dev, sizeof(dev)) == 0)
+            continue;
+
+        snprintf(elem, sizeof(elem), "\"%s\" . %s", dev, addr);
+        if(nft_list_add_unique(debuglvl, elems, elem) < 0)
+            return(-1);
+    }
+
+    return(0);
+}
+
+
+static int
+nft_collect_object(const int debuglvl, NftCtx *ctx, ZoneData *obj,
+        int ipv, int with_iface, NftList *elems)
+{
+    d_list_node *d_node = NULL;
+    ZoneData    *zone_ptr = NULL;
+
+    switch(obj->type)
+    {
+        case TYPE_HOST:
+            return(nft_collect_network(debuglvl, obj->network_parent, obj, ipv, with_iface, elems));
+
+        case TYPE_GROUP:
+            for(d_node = obj->GroupList.top; d_node != NULL; d_node = d_node->next)
+            {
+                zone_ptr = (ZoneData *)d_node->data;
+                if(zone_ptr == NULL || zone_ptr->active == FALSE)
+                    continue;
+
+                if(nft_collect_network(debuglvl, obj->network_parent, zone_ptr, ipv, with_iface, elems) < 0)
+                    return(-1);
+            }
+            return(0);
+
+        case TYPE_NETWORK:
+            return(nft_collect_network(debuglvl, obj, obj, ipv, with_iface, elems));
+
+        case TYPE_ZONE:
+            for(d_node = ctx->vctx->zones->list.top; d_node != NULL; d_node = d_node->next)
+            {
+                zone_ptr = (ZoneData *)d_node->data;
+                if(zone_ptr == NULL || zone_ptr->type != TYPE_NETWORK ||
+                    zone_ptr->active == FALSE ||
+                    strcmp(zone_ptr->zone_name, obj->name) != 0)
+                    continue;
+
+                if(nft_collect_network(debuglvl, zone_ptr, zone_ptr, ipv, with_iface, elems) < 0)
+                    return(-1);
+            }
+            return(0);
+    }
+
+    return(0);
+}
+
+
+/*  nft_set_register
+
+    Returncodes:
+         1: set was registered before, *empty is set
+         0: new set
+        -1: error
+*/
+static int
+nft_set_register(const int debuglvl, NftCtx *ctx, const char *name, char *empty, int new_empty)
+{
+    NftSet  *set_ptr = NULL;
+
+    if((set_ptr = hash_search(debuglvl, &ctx->set_hash, (void *)name)) != NULL)
+    {
+        *empty = set_ptr->empty;
+        return(1);
+    }
+    if(new_empty == -1)
+        return(0);
+
+    if(!(set_ptr = malloc(sizeof(NftSet))))
+    {
+        (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+    (void)strlcpy(set_ptr->name, name, sizeof(set_ptr->name));
+    set_ptr->empty = (char)new_empty;
+
+    if(d_list_append(debuglvl, &ctx->sets, set_ptr) == NULL)
+    {
+        free(set_ptr);
+        return(-1);
+    }
+    if(hash_insert(debuglvl, &ctx->set_hash, set_ptr) != 0)
+        return(-1);
+
+    *empty = set_ptr->empty;
+    return(0);
+}
+
+
+static void
+nft_set_print(NftCtx *ctx, const char *name, const char *type, NftList *elems)
+{
+    d_list_node *d_node = NULL;
+
+    fprintf(ctx->sets_fp, "\tset %s {\n\t\ttype %s\n\t\tflags interval\n\t\telements = { ", name, type);
+    for(d_node = elems->list.top; d_node != NULL; d_node = d_node->next)
+    {
+        fprintf(ctx->sets_fp, "%s%s", (char *)d_node->data, d_node->next ? ",\n\t\t\t     " : "");
+    }
+    fprintf(ctx->sets_fp, " }\n\t}\n\n");
+}
+
+
+/*  nft_object_set
+
+    Get the name of the set for a host, group, network or zone. The set is
+    written the first time it is asked for.
+
+    Returncodes:
+         1: ok, set name in name
+         0: the set is empty for this family
+        -1: error
+*/
+static int
+nft_object_set(const int debuglvl, NftCtx *ctx, ZoneData *obj, int ipv,
+        int with_iface, char *name, size_t size)
+{
+    char    tmp[128] = "",
+            empty = 0;
+    NftList elems;
+    int     result = 0;
+
+    snprintf(tmp, sizeof(tmp), "%s_%s%d", obj->name, with_iface ? "if" : "ip",
+            ipv == VR_IPV4 ? 4 : 6);
+    nft_name(name, size, tmp);
+
+    result = nft_set_register(debuglvl, ctx, name, &empty, -1);
+    if(result == 1)
+        return(empty ? 0 : 1);
+
+    if(nft_list_setup(debuglvl, &elems) < 0)
+        return(-1);
+
+    if(nft_collect_object(debuglvl, ctx, obj, ipv, with_iface, &elems) < 0)
+    {
+        nft_list_cleanup(debuglvl, &elems);
+        return(-1);
+    }
+
+    if(elems.list.len > 0)
+    {
+        nft_set_print(ctx, name, ipv == VR_IPV4 ?
+                (with_iface ? "ifname . ipv4_addr" : "ipv4_addr") :
+                (with_iface ? "ifname . ipv6_addr" : "ipv6_addr"), &elems);
+    }
+
+    result = nft_set_register(debuglvl, ctx, name, &empty, elems.list.len == 0);
+    nft_list_cleanup(debuglvl, &elems);
+    if(result < 0)
+        return(-1);
+
+    return(empty ? 0 : 1);
+}
+
+
+static int
+nft_port_is_ranged(struct portdata *port_ptr)
+{
+    return(port_ptr->protocol == 6 || port_ptr->protocol == 17);
+}
+
+
+static void
+nft_port_range(char *buf, size_t size, int low, int high)
+{
+    if(high <= 0 || high == low)
+        snprintf(buf, size, "%d", low);
+    else
+        snprintf(buf, size, "%d-%d", low, high);
+}
+
+
+/*  nft_service_set
+
+    Write the tcp/udp part of a service as a concatenated set.
+
+    Returncodes:
+         1: ok, set name in name
+         0: the service has no tcp/udp portranges
+        -1: error
+*/
+static int
+nft_service_set(const int debuglvl, NftCtx *ctx, ServicesData *ser_ptr, char *name, size_t size)
+{
+    d_list_node         *d_node = NULL;
+    struct portdata     *port_ptr = NULL;
+    char                tmp[64] = "",
+                        sport[16] = "",
+                        dport[16] = "",
+                        elem[64] = "",
+                        empty = 0;
+    NftList             elems;
+    int                 result = 0;
+
+    snprintf(tmp, sizeof(tmp), "svc_%s", ser_ptr->name);
+    nft_name(name, size, tmp);
+
+    result = nft_set_register(debuglvl, ctx, name, &empty, -1);
+    if(result == 1)
+        return(empty ? 0 : 1);
+
+    if(nft_list_setup(debuglvl, &elems) < 0)
+        return(-1);
+
+    for(d_node = ser_ptr->PortrangeList.top; d_node != NULL; d_node = d_node->next)
+    {
+        port_ptr = (struct portdata *)d_node->data;
+        if(port_ptr == NULL || !nft_port_is_ranged(port_ptr))
+            continue;
+
+        nft_port_range(sport, sizeof(sport), port_ptr->src_low, port_ptr->src_high);
+        nft_port_range(dport, sizeof(dport), port_ptr->dst_low, port_ptr->dst_high);
+        snprintf(elem, sizeof(elem), "%s . %s . %s",
+                port_ptr->protocol == 6 ? "tcp" : "udp", sport, dport);
+
+        if(nft_list_add_unique(debuglvl, &elems, elem) < 0)
+        {
+            nft_list_cleanup(debuglvl, &elems);
+            return(-1);
+        }
+    }
+
+    if(elems.list.len > 0)
+        nft_set_print(ctx, name, "inet_proto . inet_service . inet_service", &elems);
+
+    result = nft_set_register(debuglvl, ctx, name, &empty, elems.list.len == 0);
+    nft_list_cleanup(debuglvl, &elems);
+    if(result < 0)
+        return(-1);
+
+    return(empty ? 0 : 1);
+}
+
+
+/*  nft_port_match
+
+    Create the match for a single portrange.
+
+    Returncodes:
+         1: ok
+         0: portrange doesn't apply to this family
+*/
+static int
+nft_port_match(struct portdata *port_ptr, int ipv, char *buf, size_t size)
+{
+    char    sport[16] = "",
+            dport[16] = "";
+
+    if(port_ptr->protocol == 1)
+    {
+        if(ipv == VR_IPV6)
+            return(0);
+
+        if(port_ptr->dst_high == -1)
+            snprintf(buf, size, "icmp type %d", port_ptr->dst_low);
+        else
+            snprintf(buf, size, "icmp type %d icmp code %d", port_ptr->dst_low, port_ptr->dst_high);
+    }
+    else if(port_ptr->protocol == 58)
+    {
+        if(ipv == VR_IPV4)
+            return(0);
+
+        if(port_ptr->dst_high == -1)
+            snprintf(buf, size, "icmpv6 type %d", port_ptr->dst_low);
+        else
+            snprintf(buf, size, "icmpv6 type %d icmpv6 code %d", port_ptr->dst_low, port_ptr->dst_high);
+    }
+    else if(nft_port_is_ranged(port_ptr))
+    {
+        nft_port_range(sport, sizeof(sport), port_ptr->src_low, port_ptr->src_high);
+        nft_port_range(dport, sizeof(dport), port_ptr->dst_low, port_ptr->dst_high);
+        snprintf(buf, size, "%s sport %s %s dport %s",
+                port_ptr->protocol == 6 ? "tcp" : "udp", sport,
+                port_ptr->protocol == 6 ? "tcp" : "udp", dport);
+    }
+    else
+    {
+        snprintf(buf, size, "meta l4proto %d", port_ptr->protocol);
+    }
+
+    return(1);
+}
+
+
+/*  nft_side_match
+
+    Create the address match for one side (from/to) of a rule. A NULL
+    object means 'any' or the firewall.
+
+    Returncodes:
+         1: ok
+         0: object has no addresses for this family
+        -1: error
+*/
+static int
+nft_side_match(const int debuglvl, NftCtx *ctx, ZoneData *obj, const char *if_kw,
+        const char *addr_kw, int ipv, char *buf, size_t size)
+{
+    char    setname[128] = "";
+    int     result = 0;
+
+    buf[0] = '\0';
+    if(obj == NULL)
+        return(1);
+
+    result = nft_object_set(debuglvl, ctx, obj, ipv, if_kw != NULL, setname, sizeof(setname));
+    if(result <= 0)
+        return(result);
+
+    if(if_kw != NULL)
+        snprintf(buf, size, "%s . %s %s @%s", if_kw, ipv == VR_IPV4 ? "ip" : "ip6", addr_kw, setname);
+    else
+        snprintf(buf, size, "%s %s @%s", ipv == VR_IPV4 ? "ip" : "ip6", addr_kw, setname);
+
+    return(1);
+}
+
+
+static void
+nft_chain_rule(NftChain *chain, const char *pre, const char *from, const char *to,
+        const char *svc, const char *verdict)
+{
+    fprintf(chain->fp, "\t\t");
+    if(pre != NULL && pre[0] != '\0')
+        fprintf(chain->fp, "%s ", pre);
+    if(from[0] != '\0')
+        fprintf(chain->fp, "%s ", from);
+    if(to[0] != '\0')
+        fprintf(chain->fp, "%s ", to);
+    if(svc[0] != '\0')
+        fprintf(chain->fp, "%s ", svc);
+    fprintf(chain->fp, "%s\n", verdict);
+}
+
+
+/*  nft_print_rule
+
+    Print a rule into a chain, once for every address family and
+    service part that applies.
+
+    from_if/to_if are the interface keywords (iifname/oifname) used to
+    pair the addresses with the interfaces, or NULL to match on the
+    addresses alone. If port_ptr is set only that portrange is matched
+    instead of the service. only_ipv limits the rule to one family.
+*/
+static int
+nft_print_rule(const int debuglvl, NftCtx *ctx, NftChain *chain, const char *pre,
+        ZoneData *from, const char *from_if, ZoneData *to, const char *to_if,
+        ServicesData *ser_ptr, struct portdata *port_ptr, int only_ipv, const char *verdict)
+{
+    int             ipvs[2] = { VR_IPV4, VR_IPV6 },
+                    n_ipv = 0,
+                    i = 0,
+                    result = 0;
+    char            from_match[192] = "",
+                    to_match[192] = "",
+                    svc_match[192] = "",
+                    setname[64] = "",
+                    pre_buf[128] = "";
+    d_list_node     *d_node = NULL;
+    struct portdata *svc_port_ptr = NULL;
+
+#ifdef IPV6_ENABLED
+    n_ipv = 2;
+#else
+    n_ipv = 1;
+#endif
+
+    /* without addresses one family agnostic rule is enough */
+    if(from == NULL && to == NULL && only_ipv == 0)
+    {
+        ipvs[0] = 0;
+        n_ipv = 1;
+    }
+    else if(only_ipv != 0)
+    {
+        ipvs[0] = only_ipv;
+        n_ipv = 1;
+    }
+
+    for(i = 0; i < n_ipv; i++)
+    {
+        int ipv = ipvs[i];
+
+        if((result = nft_side_match(debuglvl, ctx, from, from_if, "saddr", ipv, from_match, sizeof(from_match))) < 0)
+            return(-1);
+        else if(result == 0)
+            continue;
+        if((result = nft_side_match(debuglvl, ctx, to, to_if, "daddr", ipv, to_match, sizeof(to_match))) < 0)
+            return(-1);
+        else if(result == 0)
+            continue;
+
+        /* no addresses matched: make sure we stay in the family */
+        if(ipv != 0 && from == NULL && to == NULL)
+        {
+            snprintf(pre_buf, sizeof(pre_buf), "%s%smeta nfproto %s", pre ? pre : "",
+                    (pre && pre[0]) ? " " : "", ipv == VR_IPV4 ? "ipv4" : "ipv6");
+        }
+        else
+            (void)strlcpy(pre_buf, pre ? pre : "", sizeof(pre_buf));
+
+        if(port_ptr != NULL)
+        {
+            if(nft_port_match(port_ptr, ipv, svc_match, sizeof(svc_match)) == 1)
+                nft_chain_rule(chain, pre_buf, from_match, to_match, svc_match, verdict);
+            continue;
+        }
+
+        if(ser_ptr == NULL)
+        {
+            nft_chain_rule(chain, pre_buf, from_match, to_match, "", verdict);
+            continue;
+        }
+
+        if((result = nft_service_set(debuglvl, ctx, ser_ptr, setname, sizeof(setname))) < 0)
+            return(-1);
+        else if(result == 1)
+        {
+            snprintf(svc_match, sizeof(svc_match), "meta l4proto . th sport . th dport @%s", setname);
+            nft_chain_rule(chain, pre_buf, from_match, to_match, svc_match, verdict);
+        }
+
+        /* the non tcp/udp parts of the service */
+        for(d_node = ser_ptr->PortrangeList.top; d_node != NULL; d_node = d_node->next)
+        {
+            svc_port_ptr = (struct portdata *)d_node->data;
+            if(svc_port_ptr == NULL || nft_port_is_ranged(svc_port_ptr))
+                continue;
+
+            if(nft_port_match(svc_port_ptr, ipv, svc_match, sizeof(svc_match)) == 1)
+                nft_chain_rule(chain, pre_buf, from_match, to_match, svc_match, verdict);
+        }
+    }
+
+    return(0);
+}
+
+
+static const char *
+nft_loglevel(const char *level)
+{
+    if(strcmp(level, "warning") == 0)
+        return("warn");
+    else if(strcmp(level, "error") == 0)
+        return("err");
+    else if(strcmp(level, "panic") == 0)
+        return("emerg");
+
+    return(level);
+}
+
+
+/*  nft_log_statement
+
+    Create a log statement. The prefix is build just like the iptables
+    prefix so the logfile parser doesn't notice the difference.
+*/
+static void
+nft_log_statement(char *buf, size_t size, const char *action, const char *userprefix)
+{
+    char    prefix[LOGPREFIX_LOG_MAXLEN + 1] = "";
+
+    if(userprefix != NULL && userprefix[0] != '\0')
+        snprintf(prefix, sizeof(prefix), "%s%s %s", LOGPREFIX_PREFIX, action, userprefix);
+    else
+        snprintf(prefix, sizeof(prefix), "%s%s", LOGPREFIX_PREFIX, action);
+
+    if(conf.rule_nflog == 1)
+    {
+        snprintf(buf, size, "log prefix \"%s \" group %u", prefix, (unsigned int)conf.nfgrp);
+    }
+    else
+    {
+        snprintf(buf, size, "log prefix \"%s \"%s%s%s", prefix,
+                conf.loglevel[0] ? " level " : "",
+                conf.loglevel[0] ? nft_loglevel(conf.loglevel) : "",
+                conf.log_tcp_options ? " flags tcp options" : "");
+    }
+}
+
+
+static const char *
+nft_limit_unit(const char *unit)
+{
+    if(strcmp(unit, "min") == 0)
+        return("minute");
+    else if(strcmp(unit, "hour") == 0)
+        return("hour");
+    else if(strcmp(unit, "day") == 0)
+        return("day");
+
+    return("second");
+}
+
+
+static void
+nft_limit(char *buf, size_t size, unsigned int limit, const char *unit, unsigned int burst)
+{
+    buf[0] = '\0';
+
+    if(limit == 0)
+        return;
+
+    if(burst > 0)
+        snprintf(buf, size, "limit rate %u/%s burst %u packets ", limit, unit, burst);
+    else
+        snprintf(buf, size, "limit rate %u/%s ", limit, unit);
+}
+
+
+static void
+nft_comment(char *buf, size_t size, struct options *opt)
+{
+    char    tmp[sizeof(opt->comment)] = "";
+    size_t  i = 0;
+
+    buf[0] = '\0';
+    if(opt->rule_comment == FALSE || opt->comment[0] == '\0')
+        return;
+
+    for(i = 0; i < sizeof(tmp) - 1 && opt->comment[i] != '\0'; i++)
+        tmp[i] = (opt->comment[i] == '"') ? '\'' : opt->comment[i];
+    tmp[i] = '\0';
+
+    snprintf(buf, size, " comment \"%s\"", tmp);
+}
+
+
+static const char *
+nft_action_name(int action)
+{
+    switch(action)
+    {
+        case AT_ACCEPT:     return("ACCEPT");
+        case AT_DROP:       return("DROP");
+        case AT_REJECT:     return("REJECT");
+        case AT_LOG:        return("LOG");
+        case AT_PORTFW:     return("PORTFW");
+        case AT_REDIRECT:   return("REDIRECT");
+        case AT_SNAT:       return("SNAT");
+        case AT_MASQ:       return("MASQ");
+        case AT_QUEUE:      return("QUEUE");
+        case AT_DNAT:       return("DNAT");
+        case AT_NFQUEUE:    return("NFQUEUE");
+    }
+
+    return("");
+}
+
+
+static const char *
+nft_reject_type(const char *type)
+{
+    if(strcmp(type, "icmp-net-unreachable") == 0)
+        return("no-route");
+    else if(strcmp(type, "icmp-host-unreachable") == 0)
+        return("host-unreachable");
+    else if(strcmp(type, "icmp-net-prohibited") == 0 ||
+            strcmp(type, "icmp-host-prohibited") == 0 ||
+            strcmp(type, "icmp-admin-prohibited") == 0)
+        return("admin-prohibited");
+
+    return("port-unreachable");
+}
+
+
+/*  nft_filter_verdict
+
+    Create the statements for a filter rule.
+
+    Returncodes:
+         1: ok
+         0: action not supported by this backend
+*/
+static int
+nft_filter_verdict(struct RuleData_ *rule_ptr, char *verdict, size_t size, char *tcp_verdict, size_t tcp_size)
+{
+    struct options  *opt = &rule_ptr->rulecache.option;
+    char            limit[64] = "",
+                    comment[160] = "",
+                    log[128] = "";
+
+    tcp_verdict[0] = '\0';
+
+    nft_limit(limit, sizeof(limit), opt->limit, nft_limit_unit(opt->limit_unit), opt->burst);
+    nft_comment(comment, sizeof(comment), opt);
+
+    switch(rule_ptr->action)
+    {
+        case AT_ACCEPT:
+            snprintf(verdict, size, "ct state new %scounter accept%s", limit, comment);
+            break;
+        case AT_DROP:
+            snprintf(verdict, size, "%scounter drop%s", limit, comment);
+            break;
+        case AT_REJECT:
+            if(opt->reject_option == TRUE && strcmp(opt->reject_type, "tcp-reset") == 0)
+            {
+                snprintf(tcp_verdict, tcp_size, "meta l4proto tcp %scounter reject with tcp reset%s", limit, comment);
+                snprintf(verdict, size, "%scounter reject%s", limit, comment);
+            }
+            else if(opt->reject_option == TRUE)
+                snprintf(verdict, size, "%scounter reject with icmpx type %s%s", limit, nft_reject_type(opt->reject_type), comment);
+            else
+                snprintf(verdict, size, "%scounter reject%s", limit, comment);
+            break;
+        case AT_LOG:
+            nft_log_statement(log, sizeof(log), "LOG", opt->rule_logprefix ? opt->logprefix : "");
+            snprintf(verdict, size, "%scounter %s%s", limit, log, comment);
+            break;
+        case AT_QUEUE:
+            snprintf(verdict, size, "ct state new %scounter queue num 0%s", limit, comment);
+            break;
+        case AT_NFQUEUE:
+            snprintf(verdict, size, "ct state new %scounter queue num %u%s", limit, (unsigned int)opt->nfqueue_num, comment);
+            break;
+        default:
+            return(0);
+    }
+
+    return(1);
+}
+
+
+/*  nft_log_verdict
+
+    Create the log statement for the 'log' option of a rule.
+
+    Returncodes:
+         1: rule wants logging
+         0: no logging
+*/
+static int
+nft_log_verdict(struct RuleData_ *rule_ptr, char *buf, size_t size)
+{
+    struct options  *opt = &rule_ptr->rulecache.option;
+    char            limit[64] = "",
+                    log[128] = "";
+
+    if(opt->rule_log == FALSE || rule_ptr->action == AT_LOG)
+        return(0);
+
+    nft_limit(limit, sizeof(limit), opt->loglimit, "second", opt->logburst);
+    nft_log_statement(log, sizeof(log), nft_action_name(rule_ptr->action),
+            opt->rule_logprefix ? opt->logprefix : "");
+
+    snprintf(buf, size, "%s%s%s", (rule_ptr->action == AT_ACCEPT ||
+            rule_ptr->action == AT_QUEUE || rule_ptr->action == AT_NFQUEUE ||
+            rule_ptr->action == AT_PORTFW) ? "ct state new " : "", limit, log);
+    return(1);
+}
+
+
+/*  nft_devices
+
+    Collect the devices a rule applies to, based on the object and the
+    interface option.
+
+    Returncodes:
+         1: the rule applies to all devices (and the base chain)
+         0: the rule applies to the devices in the list
+        -1: error
+*/
+static int
+nft_devices(const int debuglvl, NftCtx *ctx, ZoneData *obj, const char *opt_iface, NftList *devs)
+{
+    InterfaceData   *iface_ptr = NULL;
+    d_list_node     *d_node = NULL,
+                    *net_d_node = NULL;
+    ZoneData        *zone_ptr = NULL;
+    char            dev[16] = "",
+                    opt_dev[16] = "";
+
+    if(opt_iface != NULL && opt_iface[0] != '\0')
+    {
+        iface_ptr = search_interface(debuglvl, ctx->vctx->interfaces, opt_iface);
+        if(iface_ptr == NULL)
+        {
+            (void)vrprint.error(-1, "Error", "interface '%s' not found (in: %s:%d).",
+                    opt_iface, __FUNC__, __LINE__);
+            return(-1);
+        }
+        if(nft_iface_device(iface_ptr, opt_dev, sizeof(opt_dev)) == 0)
+            return(0);
+
+        if(obj == NULL)
+            return(nft_list_add_unique(debuglvl, devs, opt_dev));
+    }
+    else if(obj == NULL)
+        return(1);
+
+    for(net_d_node = ctx->vctx->zones->list.top; net_d_node != NULL; net_d_node = net_d_node->next)
+    {
+        zone_ptr = (ZoneData *)net_d_node->data;
+        if(zone_ptr == NULL || zone_ptr->type != TYPE_NETWORK || zone_ptr->active == FALSE)
+            continue;
+
+        if(!((obj->type == TYPE_NETWORK && zone_ptr == obj) ||
+             ((obj->type == TYPE_HOST || obj->type == TYPE_GROUP) && zone_ptr == obj->network_parent) ||
+             (obj->type == TYPE_ZONE && strcmp(zone_ptr->zone_name, obj->name) == 0)))
+            continue;
+
+        for(d_node = zone_ptr->InterfaceList.top; d_node != NULL; d_node = d_node->next)
+        {
+            if(nft_iface_device((InterfaceData *)d_node->data, dev, sizeof(dev)) == 0)
+                continue;
+            if(opt_dev[0] != '\0' && strcmp(opt_dev, dev) != 0)
+                continue;
+
+            if(nft_list_add_unique(debuglvl, devs, dev) < 0)
+                return(-1);
+        }
+    }
+
+    return(0);
+}
+
+
+/*  nft_filter_rule
+
+    Put a filter rule in the interface chains of the chain type:
+    'in', 'out' or 'fwd'.
+*/
+static int
+nft_filter_rule(const int debuglvl, NftCtx *ctx, struct RuleData_ *rule_ptr,
+        const char *type, const char *base, ZoneData *from, ZoneData *to,
+        ServicesData *ser_ptr, struct portdata *port_ptr, const char *verdict)
+{
+    NftList         devs;
+    d_list_node     *d_node = NULL;
+    NftChain        *chain = NULL;
+    ZoneData        *dispatch = NULL;
+    const char      *opt_iface = NULL,
+                    *from_if = NULL,
+                    *to_if = NULL;
+    int             all = 0;
+
+    if(strcmp(type, "out") == 0)
+    {
+        dispatch = to;
+        opt_iface = rule_ptr->rulecache.option.out_int;
+        to_if = "oifname";
+    }
+    else
+    {
+        dispatch = from;
+        opt_iface = rule_ptr->rulecache.option.in_int;
+        from_if = "iifname";
+        if(strcmp(type, "fwd") == 0)
+            to_if = "oifname";
+    }
+
+    if(nft_list_setup(debuglvl, &devs) < 0)
+        return(-1);
+
+    if((all = nft_devices(debuglvl, ctx, dispatch, opt_iface, &devs)) < 0)
+    {
+        nft_list_cleanup(debuglvl, &devs);
+        return(-1);
+    }
+
+    if(all == 1)
+    {
+        for(d_node = ctx->devices.list.top; d_node != NULL; d_node = d_node->next)
+        {
+            if(nft_list_add_unique(debuglvl, &devs, (char *)d_node->data) < 0)
+            {
+                nft_list_cleanup(debuglvl, &devs);
+                return(-1);
+            }
+        }
+    }
+
+    for(d_node = devs.list.top; d_node != NULL; d_node = d_node->next)
+    {
+        if((chain = nft_chain_get(debuglvl, ctx, type, (char *)d_node->data)) == NULL)
+            continue;
+
+        if(nft_print_rule(debuglvl, ctx, chain, NULL, from, from_if, to, to_if,
+                ser_ptr, port_ptr, 0, verdict) < 0)
+        {
+            nft_list_cleanup(debuglvl, &devs);
+            return(-1);
+        }
+    }
+    nft_list_cleanup(debuglvl, &devs);
+
+    /* 'any' also applies to interfaces we don't know about */
+    if(all == 1)
+    {
+        if((chain = nft_chain_get(debuglvl, ctx, base, NULL)) == NULL)
+            return(-1);
+
+        if(nft_print_rule(debuglvl, ctx, chain, NULL, from, from_if, to, to_if,
+                ser_ptr, port_ptr, 0, verdict) < 0)
+            return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  nft_filter_rule_verdicts
+
+    Put the log rule (if any) and the verdict rule(s) in the chains.
+*/
+static int
+nft_filter_rule_verdicts(const int debuglvl, NftCtx *ctx, struct RuleData_ *rule_ptr,
+        const char *type, const char *base, ZoneData *from, ZoneData *to,
+        ServicesData *ser_ptr, struct portdata *port_ptr,
+        const char *log, const char *tcp_verdict, const char *verdict)
+{
+    if(log != NULL && log[0] != '\0')
+    {
+        if(nft_filter_rule(debuglvl, ctx, rule_ptr, type, base, from, to, ser_ptr, port_ptr, log) < 0)
+            return(-1);
+    }
+    if(tcp_verdict != NULL && tcp_verdict[0] != '\0')
+    {
+        if(nft_filter_rule(debuglvl, ctx, rule_ptr, type, base, from, to, ser_ptr, port_ptr, tcp_verdict) < 0)
+            return(-1);
+    }
+
+    return(nft_filter_rule(debuglvl, ctx, rule_ptr, type, base, from, to, ser_ptr, port_ptr, verdict));
+}
+
+
+static void *
+nft_list_nth(d_list *list, unsigned int n)
+{
+    d_list_node     *d_node = NULL;
+    unsigned int    i = 0;
+
+    /* like iptables: if the list is shorter stick to the last item */
+    for(d_node = list->top; d_node != NULL; d_node = d_node->next, i++)
+    {
+        if(i == n || d_node->next == NULL)
+            return(d_node->data);
+    }
+
+    return(NULL);
+}
+
+
+/*  nft_portfw_rule
+
+    PORTFW and DNAT: a dnat rule in prerouting, and for PORTFW a forward
+    rule to let the new connections through.
+*/
+static int
+nft_portfw_rule(const int debuglvl, NftCtx *ctx, struct RuleData_ *rule_ptr, const char *log)
+{
+    struct RuleCache_   *create = &rule_ptr->rulecache;
+    struct options      *opt = &create->option;
+    NftChain            *pre_chain = NULL;
+    char                pre[64] = "",
+                        verdict[192] = "",
+                        fwd_verdict[192] = "",
+                        limit[64] = "",
+                        comment[160] = "",
+                        target[64] = "",
+                        range[16] = "";
+    d_list_node         *d_node = NULL;
+    struct portdata     *port_ptr = NULL,
+                        *listen_ptr = NULL,
+                        *remote_ptr = NULL,
+                        nat_port,
+                        fwd_port;
+    unsigned int        n = 0;
+
+    if(create->to == NULL || create->to->type != TYPE_HOST ||
+        create->to->ipv4.ipaddress[0] == '\0')
+    {
+        (void)vrprint.warning("Warning", "%s rule not created: the destination must be a host.",
+                nft_action_name(rule_ptr->action));
+        return(0);
+    }
+
+    if((pre_chain = nft_chain_get(debuglvl, ctx, "prerouting", NULL)) == NULL)
+        return(-1);
+
+    /* only traffic for the firewall itself is forwarded */
+    if(opt->in_int[0] != '\0')
+    {
+        InterfaceData   *iface_ptr = search_interface(debuglvl, ctx->vctx->interfaces, opt->in_int);
+        char            dev[16] = "";
+
+        if(iface_ptr == NULL || nft_iface_device(iface_ptr, dev, sizeof(dev)) == 0)
+            return(0);
+
+        snprintf(pre, sizeof(pre), "iifname \"%s\" fib daddr type local", dev);
+    }
+    else
+        (void)strlcpy(pre, "fib daddr type local", sizeof(pre));
+
+    nft_limit(limit, sizeof(limit), opt->limit, nft_limit_unit(opt->limit_unit), opt->burst);
+    nft_comment(comment, sizeof(comment), opt);
+
+    if(opt->queue == TRUE)
+        snprintf(fwd_verdict, sizeof(fwd_verdict), "ct state new %scounter queue num 0%s", limit, comment);
+    else
+        snprintf(fwd_verdict, sizeof(fwd_verdict), "ct state new %scounter accept%s", limit, comment);
+
+    /* simple case: the ports stay the same */
+    if(create->service_any == TRUE || create->service == NULL ||
+        (opt->listenport == FALSE && opt->remoteport == FALSE))
+    {
+        snprintf(verdict, sizeof(verdict), "ct state new %scounter dnat ip to %s%s%s",
+                limit, create->to->ipv4.ipaddress, opt->random ? " random" : "", comment);
+
+        if(nft_print_rule(debuglvl, ctx, pre_chain, pre, create->from_any ? NULL : create->from,
+                "iifname", NULL, NULL, create->service_any ? NULL : create->service,
+                NULL, VR_IPV4, verdict) < 0)
+            return(-1);
+
+        if(rule_ptr->action != AT_PORTFW)
+            return(0);
+
+        return(nft_filter_rule_verdicts(debuglvl, ctx, rule_ptr, "fwd", "forward",
+                create->from_any ? NULL : create->from, create->to,
+                create->service_any ? NULL : create->service, NULL, log, NULL, fwd_verdict));
+    }
+
+    /* listenport/remoteport: pair them with the portranges of the service */
+    for(d_node = create->service->PortrangeList.top; d_node != NULL; d_node = d_node->next, n++)
+    {
+        if(!(port_ptr = d_node->data))
+        {
+            (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).",
+                    __FUNC__, __LINE__);
+            return(-1);
+        }
+
+        listen_ptr = opt->listenport ? nft_list_nth(&opt->ListenportList, n) : NULL;
+        remote_ptr = opt->remoteport ? nft_list_nth(&opt->RemoteportList, n) : NULL;
+
+        nat_port = *port_ptr;
+        fwd_port = *port_ptr;
+
+        if(listen_ptr != NULL)
+        {
+            nat_port.dst_low = listen_ptr->dst_low;
+            nat_port.dst_high = listen_ptr->dst_high;
+        }
+        if(remote_ptr != NULL)
+        {
+            fwd_port.dst_low = remote_ptr->dst_low;
+            fwd_port.dst_high = remote_ptr->dst_high;
+        }
+
+        if(nft_port_is_ranged(port_ptr) && (remote_ptr != NULL || listen_ptr != NULL))
+        {
+            nft_port_range(range, sizeof(range), fwd_port.dst_low, fwd_port.dst_high);
+            snprintf(target, sizeof(target), "%s:%s", create->to->ipv4.ipaddress, range);
+        }
+        else
+            (void)strlcpy(target, create->to->ipv4.ipaddress, sizeof(target));
+
+        snprintf(verdict, sizeof(verdict), "ct state new %scounter dnat ip to %s%s%s",
+                limit, target, opt->random ? " random" : "", comment);
+
+        if(nft_print_rule(debuglvl, ctx, pre_chain, pre, create->from_any ? NULL : create->from,
+                "iifname", NULL, NULL, NULL, &nat_port, VR_IPV4, verdict) < 0)
+            return(-1);
+
+        if(rule_ptr->action != AT_PORTFW)
+            continue;
+
+        if(nft_filter_rule_verdicts(debuglvl, ctx, rule_ptr, "fwd", "forward",
+                create->from_any ? NULL : create->from, create->to,
+                NULL, &fwd_port, log, NULL, fwd_verdict) < 0)
+            return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  nft_redirect_rule
+
+    REDIRECT: redirect in prerouting and accept the new port in input.
+*/
+static int
+nft_redirect_rule(const int debuglvl, NftCtx *ctx, struct RuleData_ *rule_ptr, const char *log)
+{
+    struct RuleCache_   *create = &rule_ptr->rulecache;
+    struct options      *opt = &create->option;
+    NftChain            *pre_chain = NULL;
+    char                verdict[192] = "",
+                        in_verdict[192] = "",
+                        limit[64] = "",
+                        comment[160] = "";
+    d_list_node         *d_node = NULL;
+    struct portdata     *port_ptr = NULL,
+                        in_port;
+    ZoneData            *from = create->from_any ? NULL : create->from;
+
+    if((pre_chain = nft_chain_get(debuglvl, ctx, "prerouting", NULL)) == NULL)
+        return(-1);
+
+    nft_limit(limit, sizeof(limit), opt->limit, nft_limit_unit(opt->limit_unit), opt->burst);
+    nft_comment(comment, sizeof(comment), opt);
+
+    snprintf(verdict, sizeof(verdict), "ct state new %scounter redirect to :%d%s",
+            limit, opt->redirectport, comment);
+
+    if(opt->queue == TRUE)
+        snprintf(in_verdict, sizeof(in_verdict), "ct state new %scounter queue num 0%s", limit, comment);
+    else
+        snprintf(in_verdict, sizeof(in_verdict), "ct state new %scounter accept%s", limit, comment);
+
+    if(nft_print_rule(debuglvl, ctx, pre_chain, NULL, from, "iifname",
+            create->to_any ? NULL : create->to, NULL,
+            create->service_any ? NULL : create->service, NULL, VR_IPV4, verdict) < 0)
+        return(-1);
+
+    if(create->service_any == TRUE || create->service == NULL)
+        return(0);
+
+    /* after the redirect the destination port is the redirectport */
+    for(d_node = create->service->PortrangeList.top; d_node != NULL; d_node = d_node->next)
+    {
+        if(!(port_ptr = d_node->data) || !nft_port_is_ranged(port_ptr))
+            continue;
+
+        in_port = *port_ptr;
+        in_port.dst_low = opt->redirectport;
+        in_port.dst_high = 0;
+
+        if(nft_filter_rule_verdicts(debuglvl, ctx, rule_ptr, "in", "input", from, NULL,
+                NULL, &in_port, log, NULL, in_verdict) < 0)
+            return(-1);
+    }
+
+    return(0);
+}
+
+
+/*  nft_snat_rule
+
+    MASQ and SNAT in postrouting. SNAT needs the address of the outgoing
+    interface, so it gets a rule per interface.
+*/
+static int
+nft_snat_rule(const int debuglvl, NftCtx *ctx, struct RuleData_ *rule_ptr)
+{
+    struct RuleCache_   *create = &rule_ptr->rulecache;
+    struct options      *opt = &create->option;
+    NftChain            *post_chain = NULL;
+    InterfaceData       *iface_ptr = NULL;
+    d_list_node         *d_node = NULL;
+    char                verdict[192] = "",
+                        limit[64] = "",
+                        comment[160] = "",
+                        pre[48] = "",
+                        dev[16] = "";
+    ZoneData            *from = create->from_any ? NULL : create->from,
+                        *to = create->to_any ? NULL : create->to;
+    ServicesData        *ser_ptr = create->service_any ? NULL : create->service;
+
+    if((post_chain = nft_chain_get(debuglvl, ctx, "postrouting", NULL)) == NULL)
+        return(-1);
+
+    nft_limit(limit, sizeof(limit), opt->limit, nft_limit_unit(opt->limit_unit), opt->burst);
+    nft_comment(comment, sizeof(comment), opt);
+
+    if(rule_ptr->action == AT_MASQ)
+    {
+        snprintf(verdict, sizeof(verdict), "%scounter masquerade%s%s",
+                limit, opt->random ? " random" : "", comment);
+
+        return(nft_print_rule(debuglvl, ctx, post_chain, NULL, from, NULL,
+                to, "oifname", ser_ptr, NULL, VR_IPV4, verdict));
+    }
+
+    for(d_node = ctx->vctx->interfaces->list.top; d_node != NULL; d_node = d_node->next)
+    {
+        iface_ptr = (InterfaceData *)d_node->data;
+        if(nft_iface_device(iface_ptr, dev, sizeof(dev)) == 0 ||
+            iface_ptr->ipv4.ipaddress[0] == '\0')
+            continue;
+
+        if(opt->out_int[0] != '\0' && strcmp(opt->out_int, iface_ptr->name) != 0)
+            continue;
+
+        snprintf(pre, sizeof(pre), "oifname \"%s\"", dev);
+        snprintf(verdict, sizeof(verdict), "%scounter snat ip to %s%s%s",
+                limit, iface_ptr->ipv4.ipaddress, opt->random ? " random" : "", comment);
+
+        if(nft_print_rule(debuglvl, ctx, post_chain, pre, from, NULL,
+                to, "oifname", ser_ptr, NULL, VR_IPV4, verdict) < 0)
+            return(-1);
+    }
+
+    return(0);
+}
+
+
+static int
+nft_create_rule(const int debuglvl, NftCtx *ctx, struct RuleData_ *rule_ptr)
+{
+    struct RuleCache_   *create = &rule_ptr->rulecache;
+    char                verdict[256] = "",
+                        tcp_verdict[256] = "",
+                        log[192] = "";
+    ZoneData            *from = NULL,
+                        *to = NULL;
+    ServicesData        *ser_ptr = NULL;
+
+    if(create->from_any == FALSE && create->from_firewall == FALSE)
+        from = create->from;
+    if(create->to_any == FALSE && create->to_firewall == FALSE)
+        to = create->to;
+    if(create->service_any == FALSE)
+        ser_ptr = create->service;
+
+    if(nft_log_verdict(rule_ptr, log, sizeof(log)) == 0)
+        log[0] = '\0';
+
+    switch(create->ruletype)
+    {
+        case RT_INPUT:
+        case RT_OUTPUT:
+        case RT_FORWARD:
+            if(nft_filter_verdict(rule_ptr, verdict, sizeof(verdict), tcp_verdict, sizeof(tcp_verdict)) == 0)
+                break;
+
+            if(create->ruletype == RT_INPUT)
+                return(nft_filter_rule_verdicts(debuglvl, ctx, rule_ptr, "in", "input",
+                        from, NULL, ser_ptr, NULL, log, tcp_verdict, verdict));
+            else if(create->ruletype == RT_OUTPUT)
+                return(nft_filter_rule_verdicts(debuglvl, ctx, rule_ptr, "out", "output",
+                        NULL, to, ser_ptr, NULL, log, tcp_verdict, verdict));
+            else
+                return(nft_filter_rule_verdicts(debuglvl, ctx, rule_ptr, "fwd", "forward",
+                        from, to, ser_ptr, NULL, log, tcp_verdict, verdict));
+
+        case RT_MASQ:
+        case RT_SNAT:
+            return(nft_snat_rule(debuglvl, ctx, rule_ptr));
+
+        case RT_PORTFW:
+        case RT_DNAT:
+            return(nft_portfw_rule(debuglvl, ctx, rule_ptr, log));
+
+        case RT_REDIRECT:
+            return(nft_redirect_rule(debuglvl, ctx, rule_ptr, log));
+    }
+
+    (void)vrprint.warning("Warning", "rule with action %s not created: not supported by the nftables backend.",
+            rules_itoaction(rule_ptr->action));
+    return(0);
+}
+
+
+/*  nft_chain_head
+
+    The rules at the start of the filter base chains.
+*/
+static int
+nft_chain_head(const int debuglvl, NftCtx *ctx, NftChain *chain, const char *if_kw)
+{
+    char    log[128] = "",
+            limit[64] = "";
+
+    fprintf(chain->fp, "\t\tct state established,related counter accept\n");
+    /* like pre_rules_icmp_ipv6: ICMPv6 is always accepted, without it
+     * neighbour discovery and path mtu discovery break. Before the
+     * invalid drop because conntrack doesn't track all of it. */
+    fprintf(chain->fp, "\t\tmeta l4proto ipv6-icmp counter accept\n");
+    if(conf.invalid_drop_enabled == TRUE)
+    {
+        if(conf.log_invalid == TRUE)
+        {
+            nft_log_statement(log, sizeof(log), "DROP", "invalid");
+            fprintf(chain->fp, "\t\tct state invalid %s\n", log);
+        }
+        fprintf(chain->fp, "\t\tct state invalid counter drop\n");
+    }
+    fprintf(chain->fp, "\t\t%s \"lo\" accept\n", if_kw);
+
+    if(ctx->vctx->blocklist->list.len == 0)
+        return(0);
+
+    /* the blocklist is ipv4 only, like in the iptables backend */
+    if(conf.log_blocklist == TRUE)
+    {
+        nft_limit(limit, sizeof(limit), conf.log_policy_limit, "second", conf.log_policy_burst);
+        nft_log_statement(log, sizeof(log), "DROP", "BLOCKED");
+        fprintf(chain->fp, "\t\tip saddr @blocklist_ip4 %s%s\n", limit, log);
+        fprintf(chain->fp, "\t\tip daddr @blocklist_ip4 %s%s\n", limit, log);
+    }
+    fprintf(chain->fp, "\t\tip saddr @blocklist_ip4 counter drop\n");
+    fprintf(chain->fp, "\t\tip daddr @blocklist_ip4 counter drop\n");
+
+    return(0);
+}
+
+
+static void
+nft_chain_tail(NftChain *chain, const char *what)
+{
+    char    log[128] = "",
+            limit[64] = "";
+
+    if(conf.log_policy == FALSE)
+        return;
+
+    nft_limit(limit, sizeof(limit), conf.log_policy_limit, "second", conf.log_policy_burst);
+    nft_log_statement(log, sizeof(log), "DROP", what);
+    fprintf(chain->fp, "\t\t%s%s\n", limit, log);
+}
+
+
+static int
+nft_blocklist_set(const int debuglvl, NftCtx *ctx)
+{
+    NftList     elems;
+    d_list_node *d_node = NULL;
+
+    if(ctx->vctx->blocklist->list.len == 0)
+        return(0);
+
+    if(nft_list_setup(debuglvl, &elems) < 0)
+        return(-1);
+
+    /* an ipaddress can be in the blocklist more than once */
+    for(d_node = ctx->vctx->blocklist->list.top; d_node != NULL; d_node = d_node->next)
+    {
+        if(nft_list_add_unique(debuglvl, &elems, (char *)d_node->data) < 0)
+        {
+            nft_list_cleanup(debuglvl, &elems);
+            return(-1);
+        }
+    }
+
+    nft_set_print(ctx, "blocklist_ip4", "ipv4_addr", &elems);
+    nft_list_cleanup(debuglvl, &elems);
+    return(0);
+}
+
+
+/*  nft_acc_overlap
+
+    Removes the networks that overlap with one earlier in the list: the
+    elements of an interval set can't overlap. ipsets don't care, there
+    the most specific network matches.
+*/
+static void
+nft_acc_overlap(const int debuglvl, d_list *nets)
+{
+    d_list_node     *d_node = NULL,
+                    *next_node = NULL,
+                    *prev_node = NULL;
+    struct in_addr  addr;
+    unsigned long   net = 0,
+                    mask = 0,
+                    prev_net = 0,
+                    prev_mask = 0;
+    char            buf[32] = "",
+                    *slash = NULL;
+
+    for(d_node = nets->top; d_node != NULL; d_node = next_node)
+    {
+        next_node = d_node->next;
+
+        (void)strlcpy(buf, (char *)d_node->data, sizeof(buf));
+        if(!(slash = strchr(buf, '/')))
+            continue;
+        *slash = '\0';
+        if(inet_pton(AF_INET, buf, &addr) != 1)
+            continue;
+
+        mask = (0xffffffffUL << (32 - atoi(slash + 1))) & 0xffffffffUL;
+        net = ntohl(addr.s_addr) & mask;
+
+        for(prev_node = nets->top; prev_node != d_node; prev_node = prev_node->next)
+        {
+            (void)strlcpy(buf, (char *)prev_node->data, sizeof(buf));
+            if(!(slash = strchr(buf, '/')))
+                continue;
+            *slash = '\0';
+            if(inet_pton(AF_INET, buf, &addr) != 1)
+                continue;
+
+            prev_mask = (0xffffffffUL << (32 - atoi(slash + 1))) & 0xffffffffUL;
+            prev_net = ntohl(addr.s_addr) & prev_mask;
+
+            /* two networks overlap if one contains the other */
+            if((net & prev_mask) == prev_net || (prev_net & mask) == net)
+            {
+                (void)vrprint.info("Info", "network %s overlaps with %s, it is not counted separately.",
+                        (char *)d_node->data, (char *)prev_node->data);
+                (void)d_list_remove_node(debuglvl, nets, d_node);
+                break;
+            }
+        }
+    }
+}
+
+
+/* one element for an 'add element' or 'delete element' command */
+static void
+nft_acc_element(FILE *fp, const char *cmd, int set, const char *elem, int *first)
+{
+    if(*first)
+        fprintf(fp, "%s element inet %s %s { %s", cmd, HOSTACC_NFT_TABLE,
+                hostacc_set_names[set], elem);
+    else
+        fprintf(fp, ", %s", elem);
+
+    *first = 0;
+}
+
+
+/*  nft_acc_elements
+
+    Writes the commands that make 'set' of the host accounting table
+    contain 'want'. 'loaded' is what is in the set now, or NULL if we
+    don't know: then the set is flushed first. Only the difference is
+    changed, so the counters of the elements that stay are kept.
+*/
+static int
+nft_acc_elements(const int debuglvl, FILE *fp, int set, d_list *want, d_list *loaded)
+{
+    d_list_node *d_node = NULL;
+    Hash        want_hash,
+                loaded_hash;
+    int         first = 1,
+                retval = 0;
+
+    if(hash_setup(debuglvl, &want_hash, NFT_HASH_ROWS, hash_name, compare_string) != 0)
+        return(-1);
+    if(hash_setup(debuglvl, &loaded_hash, NFT_HASH_ROWS, hash_name, compare_string) != 0)
+    {
+        (void)hash_cleanup(debuglvl, &want_hash);
+        return(-1);
+    }
+
+    for(d_node = want->top; d_node != NULL && retval == 0; d_node = d_node->next)
+    {
+        if(hash_insert(debuglvl, &want_hash, d_node->data) != 0)
+            retval = -1;
+    }
+    for(d_node = loaded ? loaded->top : NULL; d_node != NULL && retval == 0; d_node = d_node->next)
+    {
+        if(hash_insert(debuglvl, &loaded_hash, d_node->data) != 0)
+            retval = -1;
+    }
+
+    if(retval == 0)
+    {
+        if(loaded == NULL)
+            fprintf(fp, "flush set inet %s %s\n", HOSTACC_NFT_TABLE, hostacc_set_names[set]);
+
+        for(d_node = loaded ? loaded->top : NULL; d_node != NULL; d_node = d_node->next)
+        {
+            if(hash_search(debuglvl, &want_hash, d_node->data) == NULL)
+                nft_acc_element(fp, "delete", set, (char *)d_node->data, &first);
+        }
+        if(first == 0)
+            fprintf(fp, " }\n");
+
+        first = 1;
+        for(d_node = want->top; d_node != NULL; d_node = d_node->next)
+        {
+            if(hash_search(debuglvl, &loaded_hash, d_node->data) == NULL)
+                nft_acc_element(fp, "add", set, (char *)d_node->data, &first);
+        }
+        if(first == 0)
+            fprintf(fp, " }\n");
+    }
+
+    (void)hash_cleanup(debuglvl, &want_hash);
+    (void)hash_cleanup(debuglvl, &loaded_hash);
+    return(retval);
+}
+
+
+/*  nft_acc_sets
+
+    The host accounting (see hostacc.c) has a table of its own: sets
+    where every element has a counter, and base chains that run before
+    ours with rules without a verdict. Unlike our table it is not
+    deleted on a reload. Declaring what exists already changes nothing,
+    the rules are flushed and created again and only the elements that
+    changed are deleted or added, so the counters survive the reload.
+    Without host accounting the table is removed.
+*/
+static int
+nft_acc_sets(const int debuglvl, NftCtx *ctx)
+{
+    d_list      hosts,
+                nets,
+                loaded,
+                *elems = NULL;
+    FILE        *fp = ctx->acc_fp;
+    const char  *hooks[] = { "input", "forward", "output" };
+    unsigned int i = 0;
+    int         set = 0,
+                retval = 0;
+
+    if(conf.host_accounting == FALSE)
+    {
+        /* creating it first makes sure the delete doesn't fail */
+        fprintf(fp, "table inet %s\n", HOSTACC_NFT_TABLE);
+        fprintf(fp, "delete table inet %s\n", HOSTACC_NFT_TABLE);
+        return(0);
+    }
+
+    if(d_list_setup(debuglvl, &hosts, free) < 0 ||
+        d_list_setup(debuglvl, &nets, free) < 0 ||
+        d_list_setup(debuglvl, &loaded, free) < 0)
+        return(-1);
+
+    if(hostacc_collect(debuglvl, ctx->vctx->zones, &hosts, &nets) < 0)
+        retval = -1;
+    else
+        nft_acc_overlap(debuglvl, &nets);
+
+    if(retval == 0)
+    {
+        fprintf(fp, "table inet %s {\n", HOSTACC_NFT_TABLE);
+        for(set = 0; set < HOSTACC_SETS; set++)
+        {
+            fprintf(fp, "\tset %s {\n\t\ttype ipv4_addr\n", hostacc_set_names[set]);
+            if(set == HOSTACC_NET_SRC || set == HOSTACC_NET_DST)
+                fprintf(fp, "\t\tflags interval\n");
+            fprintf(fp, "\t\tcounter\n\t}\n\n");
+        }
+
+        /* count before our table accepts or drops anything */
+        for(i = 0; i < sizeof(hooks) / sizeof(hooks[0]); i++)
+        {
+            fprintf(fp, "%s\tchain %s {\n\t\ttype filter hook %s priority -1; policy accept;\n\t}\n",
+                    i > 0 ? "\n" : "", hooks[i], hooks[i]);
+        }
+        fprintf(fp, "}\n");
+
+        for(i = 0; i < sizeof(hooks) / sizeof(hooks[0]); i++)
+            fprintf(fp, "flush chain inet %s %s\n", HOSTACC_NFT_TABLE, hooks[i]);
+
+        for(set = 0; set < HOSTACC_SETS; set++)
+        {
+            if(set == HOSTACC_HOST_SRC || set == HOSTACC_NET_SRC)
+            {
+                fprintf(fp, "add rule inet %s input ip saddr @%s\n", HOSTACC_NFT_TABLE, hostacc_set_names[set]);
+                fprintf(fp, "add rule inet %s forward ip saddr @%s\n", HOSTACC_NFT_TABLE, hostacc_set_names[set]);
+            }
+            else
+            {
+                fprintf(fp, "add rule inet %s output ip daddr @%s\n", HOSTACC_NFT_TABLE, hostacc_set_names[set]);
+                fprintf(fp, "add rule inet %s forward ip daddr @%s\n", HOSTACC_NFT_TABLE, hostacc_set_names[set]);
+            }
+        }
+    }
+
+    for(set = 0; set < HOSTACC_SETS && retval == 0; set++)
+    {
+        elems = (set == HOSTACC_NET_SRC || set == HOSTACC_NET_DST) ? &nets : &hosts;
+
+        /* when only printing we can't know what will be loaded */
+        if(conf.bash_out == TRUE)
+        {
+            retval = nft_acc_elements(debuglvl, fp, set, elems, NULL);
+        }
+        else
+        {
+            if(hostacc_loaded(debuglvl, set, &loaded) < 0 ||
+               nft_acc_elements(debuglvl, fp, set, elems, &loaded) < 0)
+                retval = -1;
+
+            (void)d_list_cleanup(debuglvl, &loaded);
+            (void)d_list_setup(debuglvl, &loaded, free);
+        }
+    }
+
+    (void)d_list_cleanup(debuglvl, &hosts);
+    (void)d_list_cleanup(debuglvl, &nets);
+    (void)d_list_cleanup(debuglvl, &loaded);
+
+    /* don't load half of it, the table stays as it is */
+    if(retval < 0)
+        ctx->acc_failed = TRUE;
+
+    return(retval);
+}
+
+
+static int
+nft_setup(const int debuglvl, NftCtx *ctx, VuurmuurCtx *vctx)
+{
+    d_list_node     *d_node = NULL;
+    char            dev[16] = "",
+                    name[48] = "";
+    const char      *types[] = { "in", "fwd", "out" };
+    const char      *bases[] = { "input", "forward", "output", "prerouting", "postrouting" };
+    unsigned int    i = 0;
+
+    memset(ctx, 0, sizeof(NftCtx));
+    ctx->vctx = vctx;
+
+    if(d_list_setup(debuglvl, &ctx->chains, nft_chain_free) < 0 ||
+        d_list_setup(debuglvl, &ctx->sets, free) < 0 ||
+        nft_list_setup(debuglvl, &ctx->devices) < 0)
+        return(-1);
+
+    if(hash_setup(debuglvl, &ctx->chain_hash, NFT_HASH_ROWS, hash_name, compare_string) != 0 ||
+        hash_setup(debuglvl, &ctx->set_hash, NFT_HASH_ROWS, hash_name, compare_string) != 0)
+        return(-1);
+
+    if(!(ctx->sets_fp = open_memstream(&ctx->sets_buf, &ctx->sets_len)) ||
+       !(ctx->acc_fp = open_memstream(&ctx->acc_buf, &ctx->acc_len)))
+    {
+        (void)vrprint.error(-1, "Error", "open_memstream failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    for(d_node = vctx->interfaces->list.top; d_node != NULL; d_node = d_node->next)
+    {
+        if(nft_iface_device((InterfaceData *)d_node->data, dev, sizeof(dev)) == 0)
+            continue;
+
+        /* loopback is accepted in the base chains */
+        if(strcmp(dev, "lo") == 0)
+            continue;
+
+        if(nft_list_add_unique(debuglvl, &ctx->devices, dev) < 0)
+            return(-1);
+    }
+
+    /* the interface chains first, so the maps can refer to them */
+    for(i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        for(d_node = ctx->devices.list.top; d_node != NULL; d_node = d_node->next)
+        {
+            snprintf(name, sizeof(name), "%s_%s", types[i], (char *)d_node->data);
+            if(nft_chain_add(debuglvl, ctx, name) == NULL)
+                return(-1);
+        }
+    }
+
+    for(i = 0; i < sizeof(bases) / sizeof(bases[0]); i++)
+    {
+        if(nft_chain_add(debuglvl, ctx, bases[i]) == NULL)
+            return(-1);
+    }
+
+    return(0);
+}
+
+
+static void
+nft_cleanup(const int debuglvl, NftCtx *ctx)
+{
+    (void)hash_cleanup(debuglvl, &ctx->chain_hash);
+    (void)hash_cleanup(debuglvl, &ctx->set_hash);
+    (void)d_list_cleanup(debuglvl, &ctx->chains);
+    (void)d_list_cleanup(debuglvl, &ctx->sets);
+    nft_list_cleanup(debuglvl, &ctx->devices);
+
+    if(ctx->sets_fp != NULL)
+        (void)fclose(ctx->sets_fp);
+    free(ctx->sets_buf);
+    if(ctx->acc_fp != NULL)
+        (void)fclose(ctx->acc_fp);
+    free(ctx->acc_buf);
+}
+
+
+static void
+nft_print_map(FILE *fp, NftCtx *ctx, const char *name, const char *type)
+{
+    d_list_node     *d_node = NULL;
+    NftChain        *chain = NULL;
+    int             first = 1;
+
+    fprintf(fp, "\tmap %s {\n\t\ttype ifname : verdict\n", name);
+    for(d_node = ctx->devices.list.top; d_node != NULL; d_node = d_node->next)
+    {
+        /* this can't fail, we created the chains in nft_setup */
+        if((chain = nft_chain_get(0, ctx, type, (char *)d_node->data)) == NULL)
+            continue;
+
+        fprintf(fp, "%s\"%s\" : goto %s", first ? "\t\telements = { " : ",\n\t\t\t     ",
+                (char *)d_node->data, chain->name);
+        first = 0;
+    }
+    if(!first)
+        fprintf(fp, " }\n");
+    fprintf(fp, "\t}\n\n");
+}
+
+
+static void
+nft_print_chain(FILE *fp, NftChain *chain, const char *hook)
+{
+    fprintf(fp, "\tchain %s {\n", chain->name);
+    if(hook != NULL)
+        fprintf(fp, "\t\t%s\n", hook);
+    if(chain->len > 0)
+        fwrite(chain->buf, 1, chain->len, fp);
+    fprintf(fp, "\t}\n\n");
+}
+
+
+/*  nftables_create_ruleset
+
+    Create the complete nft ruleset and write it to fp.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+nftables_create_ruleset(const int debuglvl, VuurmuurCtx *vctx, FILE *fp)
+{
+    NftCtx              ctx;
+    d_list_node         *d_node = NULL;
+    struct RuleData_    *rule_ptr = NULL;
+    NftChain            *chain = NULL;
+    InterfaceData       *iface_ptr = NULL;
+    unsigned int        rulescount = 0;
+    int                 retval = 0;
+    const char          *types[] = { "in", "fwd", "out" };
+    const char          *what[] = { "in policy", "fw policy", "out policy" };
+    unsigned int        i = 0;
+
+    /* safety */
+    if(vctx == NULL || fp == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(nft_setup(debuglvl, &ctx, vctx) < 0)
+    {
+        nft_cleanup(debuglvl, &ctx);
+        return(-1);
+    }
+
+    for(d_node = vctx->interfaces->list.top; d_node != NULL; d_node = d_node->next)
+    {
+        iface_ptr = (InterfaceData *)d_node->data;
+        if(iface_ptr != NULL && iface_ptr->active == TRUE && iface_ptr->shape == TRUE)
+        {
+            (void)vrprint.warning("Warning", "shaping on interface '%s' is not supported by the nftables backend.",
+                    iface_ptr->name);
+        }
+    }
+
+    (void)nft_blocklist_set(debuglvl, &ctx);
+    if(nft_acc_sets(debuglvl, &ctx) < 0)
+    {
+        (void)vrprint.warning("Warning", "creating the host accounting sets failed.");
+    }
+
+    (void)nft_chain_head(debuglvl, &ctx, nft_chain_get(debuglvl, &ctx, "input", NULL), "iifname");
+    (void)nft_chain_head(debuglvl, &ctx, nft_chain_get(debuglvl, &ctx, "forward", NULL), "iifname");
+    (void)nft_chain_head(debuglvl, &ctx, nft_chain_get(debuglvl, &ctx, "output", NULL), "oifname");
+
+    fprintf(nft_chain_get(debuglvl, &ctx, "input", NULL)->fp, "\t\tiifname vmap @input_iface\n");
+    fprintf(nft_chain_get(debuglvl, &ctx, "forward", NULL)->fp, "\t\tiifname vmap @forward_iface\n");
+    fprintf(nft_chain_get(debuglvl, &ctx, "output", NULL)->fp, "\t\toifname vmap @output_iface\n");
+
+    /* walk trough the ruleslist and create the rules */
+    for(d_node = vctx->rules->list.top; d_node != NULL; d_node = d_node->next)
+    {
+        if(!(rule_ptr = d_node->data))
+        {
+            (void)vrprint.error(-1, "Internal Error", "NULL pointer "
+                    "(in: %s:%d).", __FUNC__, __LINE__);
+            nft_cleanup(debuglvl, &ctx);
+            return(-1);
+        }
+
+        rulescount++;
+
+        if(rule_ptr->action == AT_SEPARATOR || rule_ptr->active == FALSE)
+            continue;
+
+        /* protect rules (anti-spoofing, syn-limit, the proc settings of
+         * interfaces, ...) are not supported yet */
+        if(rule_ptr->rulecache.who != NULL || rule_ptr->action == AT_PROTECT)
+        {
+            (void)vrprint.warning("Warning", "Rule %u not created: protect rules "
+                    "are not supported by the nftables backend.", rulescount);
+            continue;
+        }
+
+        if((rule_ptr->rulecache.from != NULL && rule_ptr->rulecache.from->active == FALSE) ||
+           (rule_ptr->rulecache.to != NULL && rule_ptr->rulecache.to->active == FALSE) ||
+           (rule_ptr->rulecache.service != NULL && rule_ptr->rulecache.service->active == FALSE))
+        {
+            (void)vrprint.info("Note", "Rule %u not created: inactive.", rulescount);
+            continue;
+        }
+
+        if(nft_create_rule(debuglvl, &ctx, rule_ptr) < 0)
+        {
+            (void)vrprint.error(-1, "Error", "Creating rule %u failed (in: %s:%d).",
+                    rulescount, __FUNC__, __LINE__);
+            nft_cleanup(debuglvl, &ctx);
+            return(-1);
+        }
+    }
+
+    /* whatever didn't match gets the policy, so log it */
+    for(i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        for(d_node = ctx.devices.list.top; d_node != NULL; d_node = d_node->next)
+        {
+            if((chain = nft_chain_get(debuglvl, &ctx, types[i], (char *)d_node->data)) != NULL)
+                nft_chain_tail(chain, what[i]);
+        }
+    }
+    nft_chain_tail(nft_chain_get(debuglvl, &ctx, "input", NULL), what[0]);
+    nft_chain_tail(nft_chain_get(debuglvl, &ctx, "forward", NULL), what[1]);
+    nft_chain_tail(nft_chain_get(debuglvl, &ctx, "output", NULL), what[2]);
+
+    /* flush the memory streams */
+    (void)fflush(ctx.sets_fp);
+    for(d_node = ctx.chains.top; d_node != NULL; d_node = d_node->next)
+        (void)fflush(((NftChain *)d_node->data)->fp);
+
+    /*  assemble: creating and deleting the table first makes sure the
+        'delete' never fails, so the whole file is one transaction that
+        replaces the old ruleset atomically. */
+    fprintf(fp, "# Generated by Vuurmuur %s\n", version_string);
+    fprintf(fp, "table inet %s\n", NFT_TABLE);
+    fprintf(fp, "delete table inet %s\n\n", NFT_TABLE);
+    fprintf(fp, "table inet %s {\n", NFT_TABLE);
+
+    if(ctx.sets_len > 0)
+        fwrite(ctx.sets_buf, 1, ctx.sets_len, fp);
+
+    for(d_node = ctx.chains.top; d_node != NULL; d_node = d_node->next)
+    {
+        chain = (NftChain *)d_node->data;
+        if(strncmp(chain->name, "in_", 3) == 0 ||
+           strncmp(chain->name, "fwd_", 4) == 0 ||
+           strncmp(chain->name, "out_", 4) == 0)
+            nft_print_chain(fp, chain, NULL);
+    }
+
+    nft_print_map(fp, &ctx, "input_iface", "in");
+    nft_print_map(fp, &ctx, "forward_iface", "fwd");
+    nft_print_map(fp, &ctx, "output_iface", "out");
+
+    nft_print_chain(fp, nft_chain_get(debuglvl, &ctx, "input", NULL),
+            "type filter hook input priority 0; policy drop;");
+    nft_print_chain(fp, nft_chain_get(debuglvl, &ctx, "forward", NULL),
+            "type filter hook forward priority 0; policy drop;");
+    nft_print_chain(fp, nft_chain_get(debuglvl, &ctx, "output", NULL),
+            "type filter hook output priority 0; policy drop;");
+
+    /* only create the nat chains if we need them */
+    chain = nft_chain_get(debuglvl, &ctx, "prerouting", NULL);
+    if(chain->len > 0)
+        nft_print_chain(fp, chain, "type nat hook prerouting priority -100; policy accept;");
+    chain = nft_chain_get(debuglvl, &ctx, "postrouting", NULL);
+    if(chain->len > 0)
+        nft_print_chain(fp, chain, "type nat hook postrouting priority 100; policy accept;");
+
+    fprintf(fp, "}\n");
+
+    /* the host accounting table */
+    (void)fflush(ctx.acc_fp);
+    if(ctx.acc_len > 0 && ctx.acc_failed == FALSE)
+    {
+        fprintf(fp, "\n");
+        fwrite(ctx.acc_buf, 1, ctx.acc_len, fp);
+    }
+
+    if(ferror(fp))
+    {
+        (void)vrprint.error(-1, "Error", "writing the nftables ruleset failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        retval = -1;
+    }
+
+    nft_cleanup(debuglvl, &ctx);
+    return(retval);
+}
+
+
+/*  nftables_load_ruleset
+
+    Create the ruleset and load it with 'nft -f'. nft applies the whole
+    file as one transaction: either the new ruleset is active, or the old
+    one stays untouched.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+nftables_load_ruleset(const int debuglvl, VuurmuurCtx *vctx)
+{
+    char    cur_ruleset_path[] = "/tmp/vuurmuur-nft-XXXXXX";
+    char    cur_result_path[] = "/tmp/vuurmuur-load-result-XXXXXX";
+    char    cmd[256] = "";
+    int     ruleset_fd = 0,
+            result_fd = 0;
+    FILE    *fp = NULL;
+
+    /* safety */
+    if(vctx == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    /* create the tempfiles */
+    ruleset_fd = create_tempfile(debuglvl, cur_ruleset_path);
+    if(ruleset_fd == -1)
+    {
+        (void)vrprint.error(-1, "Error", "creating rulesetfile failed (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+    result_fd = create_tempfile(debuglvl, cur_result_path);
+    if(result_fd == -1)
+    {
+        (void)vrprint.error(-1, "Error", "creating resultfile failed (in: %s:%d).", __FUNC__, __LINE__);
+        (void)close(ruleset_fd);
+        return(-1);
+    }
+    (void)close(result_fd);
+
+    if(!(fp = fdopen(ruleset_fd, "w")))
+    {
+        (void)vrprint.error(-1, "Error", "fdopen failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        (void)close(ruleset_fd);
+        return(-1);
+    }
+
+    if(nftables_create_ruleset(debuglvl, vctx, fp) < 0)
+    {
+        (void)vrprint.error(-1, "Error", "creating ruleset failed (in: %s:%d).", __FUNC__, __LINE__);
+        (void)fclose(fp);
+        (void)ruleset_store_failed_set(debuglvl, cur_ruleset_path);
+        return(-1);
+    }
+    if(fclose(fp) != 0)
+    {
+        (void)vrprint.error(-1, "Error", "closing rulesetfile failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(snprintf(cmd, sizeof(cmd), "%s -f %s 2>> %s", vctx->conf->nft_location,
+            cur_ruleset_path, cur_result_path) >= (int)sizeof(cmd))
+    {
+        (void)vrprint.error(-1, "Error", "command string overflow (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(pipe_command(debuglvl, vctx->conf, cmd, PIPE_VERBOSE) < 0)
+    {
+        (void)vrprint.error(-1, "Error", "rulesetfile will be stored as '%s.failed' (in: %s:%d).",
+                cur_ruleset_path, __FUNC__, __LINE__);
+        (void)ruleset_store_failed_set(debuglvl, cur_ruleset_path);
+        (void)ruleset_log_resultfile(debuglvl, cur_result_path);
+        return(-1);
+    }
+
+    if(cmdline.keep_file == FALSE)
+    {
+        if(unlink(cur_ruleset_path) == -1 || unlink(cur_result_path) == -1)
+        {
+            (void)vrprint.error(-1, "Error", "removing tempfile "
+                    "failed: %s (in: %s:%d).",
+                    strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+    }
+
+    (void)vrprint.info("Info", "nftables ruleset loading completed successfully.");
+    return(0);
+}
+
+
+/*  nftables_table_loaded
+
+    Checks if the vuurmuur table is loaded, e.g. by an earlier run with
+    NFTABLES="Yes". Without a working nft there is nothing loaded.
+
+    Returncodes:
+        TRUE: loaded
+        FALSE: not loaded
+*/
+int
+nftables_table_loaded(const int debuglvl, struct vuurmuur_config *cnf)
+{
+    char    *args[] = { cnf->nft_location, "list", "table", "inet", NFT_TABLE, NULL };
+    char    *output[] = { "/dev/null", "/dev/null" };
+
+    if(cnf->nft_location[0] == '\0' || access(cnf->nft_location, X_OK) != 0)
+        return(FALSE);
+
+    if(libvuurmuur_exec_command(debuglvl, cnf, cnf->nft_location, args, output) != 0)
+        return(FALSE);
+
+    return(TRUE);
+}
+
+
+/*  nftables_clear_ruleset
+
+    Remove the vuurmuur table and the one of the host accounting.
+    Creating them first makes sure the delete doesn't fail if they
+    don't exist.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+nftables_clear_ruleset(const int debuglvl, struct vuurmuur_config *cnf)
+{
+    char    *args[] = { cnf->nft_location, "add", "table", "inet", NFT_TABLE, NULL };
+    char    *del_args[] = { cnf->nft_location, "delete", "table", "inet", NFT_TABLE, NULL };
+    char    *acc_args[] = { cnf->nft_location, "add", "table", "inet", HOSTACC_NFT_TABLE, NULL };
+    char    *acc_del_args[] = { cnf->nft_location, "delete", "table", "inet", HOSTACC_NFT_TABLE, NULL };
+
+    if(libvuurmuur_exec_command(debuglvl, cnf, cnf->nft_location, args, NULL) != 0 ||
+        libvuurmuur_exec_command(debuglvl, cnf, cnf->nft_location, del_args, NULL) != 0 ||
+        libvuurmuur_exec_command(debuglvl, cnf, cnf->nft_location, acc_args, NULL) != 0 ||
+        libvuurmuur_exec_command(debuglvl, cnf, cnf->nft_location, acc_del_args, NULL) != 0)
+    {
+        (void)vrprint.error(-1, "Error", "removing the nftables table failed (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(0);
+}
@@ -0,0 +1,42 @@
+#!/bin/sh
+
+# Compares the nftables ruleset generated for a small vuurmuur_bench config
+# with nftables.golden. Run by 'make check'.
+#
+# After an intended change of the output regenerate the golden file with:
+#   ./nftables_check.sh --update
+#
+# (c) 2012 Victor Julien, released under GPL.
+
+srcdir=${srcdir:-.}
+GOLDEN=$srcdir/nftables.golden
+BENCH=./vuurmuur_bench
+
+TMPDIR=`mktemp -d /tmp/vuurmuur-check-XXXXXX` || exit 1
+trap 'rm -rf $TMPDIR' 0
+
+# keep these sizes and the seed fixed, the golden file depends on them.
+# The generated config is owned by whoever runs the check, not by root.
+$BENCH -u -g $TMPDIR/cfg -z 2 -n 2 -H 2 -G 1 -s 4 -r 24 -i 2 -V 1 -S 1 \
+	-o $TMPDIR/out.nft > $TMPDIR/bench.log 2>&1
+if [ $? -ne 0 ]; then
+	echo "FAIL: vuurmuur_bench failed:"
+	cat $TMPDIR/bench.log $TMPDIR/cfg/log/error.log 2>/dev/null
+	exit 1
+fi
+
+# the version in the header is not interesting
+sed -e '/^# Generated by /d' $TMPDIR/out.nft > $TMPDIR/ruleset.nft
+
+if [ "$1" = "--update" ]; then
+	cp $TMPDIR/ruleset.nft $GOLDEN
+	echo "updated $GOLDEN"
+	exit 0
+fi
+
+if ! diff -u $GOLDEN $TMPDIR/ruleset.nft; then
+	echo "FAIL: the generated ruleset differs from $GOLDEN"
+	exit 1
+fi
+
+exit 0
@@ -26,6 +26,15 @@ int reload_rules(const int, VuurmuurCtx *, struct rgx_ *);
 int check_for_changed_networks(const int, Zones *);
 
 
+/* tell both the shm and the control channel clients how far we are */
+static void
+reload_progress(const int debuglvl, int percent)
+{
+    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, percent);
+    control_server_progress(debuglvl, percent);
+}
+
+
 /*  apply changes
 
     This function checks all data in memory for changes and applies the changes to the
@@ -51,7 +60,7 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
         (void)vrprint.error(-1, "Error", "unloading backends failed.");
         return(-1);
     }
-    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 5);
+    reload_progress(debuglvl, 5);
 
 
     /* reload the config
@@ -74,7 +83,7 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
     /* tcp options */
     create_logtcpoptions_string(debuglvl, vctx->conf, log_tcp_options, sizeof(log_tcp_options));
 
-    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 10);
+    reload_progress(debuglvl, 10);
 
 
     /* reopen the backends */
@@ -84,7 +93,7 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
         (void)vrprint.error(-1, "Error", "re-opening backends failed.");
         return(-1);
     }
-    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 15);
+    reload_progress(debuglvl, 15);
 
 
     /* reload the services, interfaces, zones and rules. */
@@ -105,7 +114,7 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
         (void)vrprint.error(-1, "Error", "Reloading services failed.");
         return(-1);
     }
-    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 20);
+    reload_progress(debuglvl, 20);
 
     (void)vrprint.info("Info", "Reloading interfaces...");
     result = reload_interfaces(debuglvl, vctx->interfaces);
@@ -124,7 +133,7 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
         (void)vrprint.error(-1, "Error", "Reloading interfaces failed.");
         return(-1);
     }
-    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 25);
+    reload_progress(debuglvl, 25);
 
     (void)vrprint.info("Info", "Reloading zones...");
     result = reload_zonedata(debuglvl, vctx->zones, vctx->interfaces, reg);
@@ -143,7 +152,7 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
         (void)vrprint.error(-1, "Error", "Reloading zones failed.");
         return(-1);
     }
-    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 30);
+    reload_progress(debuglvl, 30);
 
     /* changed networks (for antispoofing) */
     result = check_for_changed_networks(debuglvl, vctx->zones);
@@ -196,7 +205,7 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
         (void)vrprint.error(-1, "Error", "reloading rules failed.");
         retval=-1;
     }
-    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 40);
+    reload_progress(debuglvl, 40);
 
 
     /* analyzing the rules */
@@ -205,7 +214,7 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
         (void)vrprint.error(-1, "Error", "analizing the rules failed.");
         retval=-1;
     }
-    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 80);
+    reload_progress(debuglvl, 80);
 
 
     /* create the new ruleset */
@@ -214,7 +223,7 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
         (void)vrprint.error(-1, "Error", "creating rules failed.");
         retval=-1;
     }
-    shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 90);
+    reload_progress(debuglvl, 90);
 
     if(retval == 0)
         (void)vrprint.info("Info", "Reloading Vuurmuur completed successfully.");
@@ -223,6 +232,70 @@ apply_changes_ruleset(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
 }
 
 
+/*  apply_changes_dynamic
+
+    Only the ipaddress or the state of one or more dynamic interfaces
+    changed: nothing in the backends did. So instead of a full reload we
+    update the interfaces in memory and recreate the ruleset from the
+    analyzed rules we already have. The rules pick up the ipaddresses of
+    the interfaces when they are created.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+apply_changes_dynamic(const int debuglvl, VuurmuurCtx *vctx)
+{
+    d_list_node             *d_node = NULL;
+    struct InterfaceData_   *iface_ptr = NULL;
+    char                    ipaddress[16] = "";
+    int                     result = 0;
+
+    (void)vrprint.info("Info", "Updating the dynamic interfaces...");
+
+    for(d_node = vctx->interfaces->list.top; d_node; d_node = d_node->next)
+    {
+        if(!(iface_ptr = d_node->data))
+        {
+            (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).", __FUNC__, __LINE__);
+            return(-1);
+        }
+
+        if(iface_ptr->dynamic != 1 || iface_ptr->device[0] == '\0')
+            continue;
+
+        result = get_dynamic_ip(debuglvl, iface_ptr->device, ipaddress, sizeof(ipaddress));
+        if(result < 0)
+        {
+            (void)vrprint.error(-1, "Error", "getting the ipaddress failed (in: %s:%d).", __FUNC__, __LINE__);
+            return(-1);
+        }
+        else if(result == 1)
+        {
+            iface_ptr->up = TRUE;
+            (void)strlcpy(iface_ptr->ipv4.ipaddress, ipaddress, sizeof(iface_ptr->ipv4.ipaddress));
+        }
+        else
+        {
+            iface_ptr->up = FALSE;
+            memset(iface_ptr->ipv4.ipaddress, 0, sizeof(iface_ptr->ipv4.ipaddress));
+        }
+    }
+    reload_progress(debuglvl, 40);
+
+    if(load_ruleset(debuglvl, vctx) < 0)
+    {
+        (void)vrprint.error(-1, "Error", "creating rules failed.");
+        return(-1);
+    }
+    reload_progress(debuglvl, 90);
+
+    (void)vrprint.info("Info", "Updating the dynamic interfaces completed successfully.");
+    return(0);
+}
+
+
 int
 apply_changes(const int debuglvl, VuurmuurCtx *vctx, struct rgx_ *reg)
 {
@@ -295,7 +368,7 @@ reload_services(const int debuglvl, Services *services, regex_t *servicename_reg
                 retval = 1;
     
                 /* new service */
-                result = insert_service(debuglvl, services, name);
+                result = insert_service(debuglvl, sf, serv_backend, services, name);
                 if(result != 0)
                 {
                     (void)vrprint.error(-1, "Internal Error", "inserting data for '%s' into the list failed (in: reload_services).", name);
@@ -404,7 +477,7 @@ reload_services_check(const int debuglvl, struct ServicesData_ *ser_ptr)
 
 
     /* read the service from the backend again */
-    result = read_service(debuglvl, ser_ptr->name, new_ser_ptr);
+    result = read_service(debuglvl, sf, serv_backend, ser_ptr->name, new_ser_ptr);
     if(result != 0)
     {
         /* error! memory is freed at the end of this function */
@@ -600,7 +673,7 @@ reload_zonedata(const int debuglvl, Zones *zones, Interfaces *interfaces, struct
         if(zone_ptr == NULL)
         {
             /* new zone */
-            result = insert_zonedata(debuglvl, zones, interfaces, name, zonetype, reg);
+            result = insert_zonedata(debuglvl, zf, zone_backend, zones, interfaces, name, zonetype, reg);
             if(result != 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "inserting data for '%s' into the list failed (reload_zonedata).", name);
@@ -756,7 +829,7 @@ reload_zonedata_check(const int debuglvl, Zones *zones, Interfaces *interfaces,
         case TYPE_ZONE:
 
             /* set the zone up */
-            result = read_zonedata(debuglvl, zones, interfaces, zone_ptr->name, TYPE_ZONE, new_zone_ptr, reg);
+            result = read_zonedata(debuglvl, zf, zone_backend, zones, interfaces, zone_ptr->name, TYPE_ZONE, new_zone_ptr, reg);
             if(result != 0)
             {
                 /* error! memory is freed at the end of this function */
@@ -790,7 +863,7 @@ reload_zonedata_check(const int debuglvl, Zones *zones, Interfaces *interfaces,
 
         case TYPE_NETWORK:
 
-            result = read_zonedata(debuglvl, zones, interfaces, zone_ptr->name, TYPE_NETWORK, new_zone_ptr, reg);
+            result = read_zonedata(debuglvl, zf, zone_backend, zones, interfaces, zone_ptr->name, TYPE_NETWORK, new_zone_ptr, reg);
             if(result != 0)
             {
                 /* error! memory is freed at the end of this function */
@@ -970,7 +1043,7 @@ reload_zonedata_check(const int debuglvl, Zones *zones, Interfaces *interfaces,
 
         case TYPE_HOST:
 
-            result = read_zonedata(debuglvl, zones, interfaces, zone_ptr->name, TYPE_HOST, new_zone_ptr, reg);
+            result = read_zonedata(debuglvl, zf, zone_backend, zones, interfaces, zone_ptr->name, TYPE_HOST, new_zone_ptr, reg);
             if(result != 0)
             {
                 /* error! memory is freed at the end of this function */
@@ -1064,7 +1137,7 @@ reload_zonedata_check(const int debuglvl, Zones *zones, Interfaces *interfaces,
 
         case TYPE_GROUP:
 
-            result = read_zonedata(debuglvl, zones, interfaces, zone_ptr->name, TYPE_GROUP, new_zone_ptr, reg);
+            result = read_zonedata(debuglvl, zf, zone_backend, zones, interfaces, zone_ptr->name, TYPE_GROUP, new_zone_ptr, reg);
             if(result != 0)
             {
                 /* error! memory is freed at the end of this function */
@@ -1280,7 +1353,7 @@ reload_interfaces(const int debuglvl, Interfaces *interfaces)
             (void)vrprint.info("Info", "Interface '%s' is added.", name);
 
             /* this is a new interface */
-            result = insert_interface(debuglvl, interfaces, name);
+            result = insert_interface(debuglvl, af, ifac_backend, interfaces, name);
             if(result != 0)
             {
                 (void)vrprint.error(-1, "Internal Error", "insert_interface() failed (in: %s:%d).",
@@ -1408,7 +1481,7 @@ reload_interfaces_check(const int debuglvl, struct InterfaceData_ *iface_ptr)
 
 
     /* get the info from the backend */
-    if(read_interface_info(debuglvl, new_iface_ptr) != 0)
+    if(read_interface_info(debuglvl, af, ifac_backend, new_iface_ptr) != 0)
     {
         (void)vrprint.error(-1, "Error", "getting interface information for '%s' failed (in: %s).", iface_ptr->name, __FUNC__);
         status = ST_REMOVED;
@@ -2000,6 +2073,84 @@ check_for_changed_networks(const int debuglvl, Zones *zones)
 }
 
 
+/*  check_for_changed_dynamic_ip
+
+    Compares the ipaddress and the state of one dynamic interface with
+    what the system says.
+
+    Returncodes:
+        -1: error
+        0: no changes
+        1: changes
+*/
+int
+check_for_changed_dynamic_ip(const int debuglvl, struct InterfaceData_ *iface_ptr)
+{
+    char    ipaddress[16] = "";
+    int     result = 0,
+            retval = 0;
+
+    /* safety */
+    if(iface_ptr == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(iface_ptr->dynamic != 1 || strcmp(iface_ptr->device, "") == 0)
+        return(0);
+
+    result = get_dynamic_ip(debuglvl, iface_ptr->device, ipaddress, sizeof(ipaddress));
+    if(result == -1)
+    {
+        (void)vrprint.error(-1, "Error", "getting the ipaddress failed (in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+    else if(result == 1)
+    {
+        /* we got a valid answer, this means the interface is 'up'.
+           So check if the last known state was 'down' */
+        if(!iface_ptr->up)
+        {
+            (void)vrprint.info("Info", "dynamic interface '%s' is now up.",
+                            iface_ptr->name);
+            retval = 1;
+        }
+
+        /* compare the result with the known ipaddress */
+        if(strcmp(ipaddress, iface_ptr->ipv4.ipaddress) != 0)
+        {
+            
+            (void)vrprint.info("Info", "dynamic interface '%s' had ipaddress '%s' now it has '%s'.",
+                            iface_ptr->name,
+                            iface_ptr->ipv4.ipaddress,
+                            ipaddress);
+            retval = 1;
+        }
+    }
+    else if(result == 0)
+    {
+        if(debuglvl >= HIGH)
+            (void)vrprint.debug(__FUNC__, "dynamic interface '%s' is down.", iface_ptr->name);
+
+        /* see if the last known state was 'up'. */
+        if(iface_ptr->up)
+        {
+            (void)vrprint.info("Info", "dynamic interface '%s' is now down.",
+                            iface_ptr->name);
+            retval = 1;
+        }
+    }
+    else
+    {
+        (void)vrprint.error(-1, "Internal Error", "unknown errorcode '%d' for get_dynamic_ip() (in: %s:%d).", result, __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(retval);
+}
+
+
 /*  check_for_changed_dynamic_ips
 
     Returncodes:
@@ -2012,7 +2163,6 @@ check_for_changed_dynamic_ips(const int debuglvl, Interfaces *interfaces)
 {
     d_list_node             *d_node = NULL;
     struct InterfaceData_   *iface_ptr = NULL;
-    char                    ipaddress[16] = "";
     int                     result = 0,
                             retval = 0;
 
@@ -2032,55 +2182,11 @@ check_for_changed_dynamic_ips(const int debuglvl, Interfaces *interfaces)
             return(-1);
         }
 
-        if(iface_ptr->dynamic == 1 && strcmp(iface_ptr->device, "") != 0)
-        {
-            result = get_dynamic_ip(debuglvl, iface_ptr->device, ipaddress, sizeof(ipaddress));
-            if(result == -1)
-            {
-                (void)vrprint.error(-1, "Error", "getting the ipaddress failed (in: %s:%d).", __FUNC__, __LINE__);
-                return(-1);
-            }
-            else if(result == 1)
-            {
-                /* we got a valid answer, this means the interface is 'up'.
-                   So check if the last known state was 'down' */
-                if(!iface_ptr->up)
-                {
-                    (void)vrprint.info("Info", "dynamic interface '%s' is now up.",
-                                    iface_ptr->name);
-                    retval = 1;
-                }
-
-                /* compare the result with the known ipaddress */
-                if(strcmp(ipaddress, iface_ptr->ipv4.ipaddress) != 0)
-                {
-                    
-                    (void)vrprint.info("Info", "dynamic interface '%s' had ipaddress '%s' now it has '%s'.",
-                                    iface_ptr->name,
-                                    iface_ptr->ipv4.ipaddress,
-                                    ipaddress);
-                    retval = 1;
-                }
-            }
-            else if(result == 0)
-            {
-                if(debuglvl >= HIGH)
-                    (void)vrprint.debug(__FUNC__, "dynamic interface '%s' is down.", iface_ptr->name);
-
-                /* see if the last known state was 'up'. */
-                if(iface_ptr->up)
-                {
-                    (void)vrprint.info("Info", "dynamic interface '%s' is now down.",
-                                    iface_ptr->name);
-                    retval = 1;
-                }
-            }
-            else
-            {
-                (void)vrprint.error(-1, "Internal Error", "unknown errorcode '%d' for get_dynamic_ip() (in: %s:%d).", result, __FUNC__, __LINE__);
-                return(-1);
-            }
-        }
+        result = check_for_changed_dynamic_ip(debuglvl, iface_ptr);
+        if(result < 0)
+            return(-1);
+        else if(result == 1)
+            retval = 1;
     }
 
     return(retval);
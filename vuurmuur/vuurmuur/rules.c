@@ -461,7 +461,7 @@ create_all_rules(const int debuglvl, VuurmuurCtx *vctx, int create_prerules)
 
     /* setup shaping roots */
     (void)vrprint.info("Info", "Clearing existing shaping settings...");
-    if(shaping_clear_interfaces(debuglvl, vctx->conf, vctx->interfaces, /*ruleset*/NULL) < 0)
+    if(shaping_clear_interfaces(debuglvl, vctx->conf, vctx->interfaces) < 0)
     {
         (void)vrprint.error(-1, "Error", "shaping clear interfaces failed.");
     }
@@ -480,6 +480,13 @@ create_all_rules(const int debuglvl, VuurmuurCtx *vctx, int create_prerules)
     /* create the prerules if were called with it */
     if(create_prerules)
     {
+        /* the host accounting rules need their ipsets */
+        if(hostacc_setup(debuglvl, vctx) < 0)
+        {
+            (void)vrprint.warning("Warning", "loading the host accounting sets failed, "
+                    "no host accounting.");
+        }
+
         result = pre_rules(debuglvl, NULL, vctx->interfaces, vctx->iptcaps);
         if(result < 0)
             return(-1);
@@ -1742,7 +1749,7 @@ rulecreate_dst_iface_loop (const int debuglvl, VuurmuurCtx *vctx, /*@null@*/Rule
                     rule->to_if_ptr, rule->from_if_ptr, rule->shape_class_out,
                     create->option.bw_in_min, create->option.bw_in_min_unit,
                     create->option.bw_in_max, create->option.bw_in_max_unit,
-                    create->option.prio);
+                    create->option.prio, create->option.shape_leaf);
                 if (retval < 0) {
                     return(retval);
                 }
@@ -1753,7 +1760,7 @@ rulecreate_dst_iface_loop (const int debuglvl, VuurmuurCtx *vctx, /*@null@*/Rule
                     rule->from_if_ptr, rule->to_if_ptr, rule->shape_class_in,
                     create->option.bw_out_min, create->option.bw_out_min_unit,
                     create->option.bw_out_max, create->option.bw_out_max_unit,
-                    create->option.prio);
+                    create->option.prio, create->option.shape_leaf);
                 if (retval < 0) {
                     return(retval);
                 }
@@ -1808,7 +1815,7 @@ rulecreate_dst_iface_loop (const int debuglvl, VuurmuurCtx *vctx, /*@null@*/Rule
                     rule->to_if_ptr, rule->from_if_ptr, rule->shape_class_out,
                     create->option.bw_in_min, create->option.bw_in_min_unit,
                     create->option.bw_in_max, create->option.bw_in_max_unit,
-                    create->option.prio);
+                    create->option.prio, create->option.shape_leaf);
                 if (retval < 0) {
                     return(retval);
                 }
@@ -1819,7 +1826,7 @@ rulecreate_dst_iface_loop (const int debuglvl, VuurmuurCtx *vctx, /*@null@*/Rule
                     rule->from_if_ptr, rule->to_if_ptr, rule->shape_class_in,
                     create->option.bw_out_min, create->option.bw_out_min_unit,
                     create->option.bw_out_max, create->option.bw_out_max_unit,
-                    create->option.prio);
+                    create->option.prio, create->option.shape_leaf);
                 if (retval < 0) {
                     return(retval);
                 }
@@ -1944,7 +1951,7 @@ rulecreate_dst_iface_loop (const int debuglvl, VuurmuurCtx *vctx, /*@null@*/Rule
                                 rule->to_if_ptr, rule->from_if_ptr, rule->shape_class_out,
                                 create->option.bw_in_min, create->option.bw_in_min_unit,
                                 create->option.bw_in_max, create->option.bw_in_max_unit,
-                                create->option.prio);
+                                create->option.prio, create->option.shape_leaf);
                         if (retval < 0) {
                             return(retval);
                         }
@@ -1955,7 +1962,7 @@ rulecreate_dst_iface_loop (const int debuglvl, VuurmuurCtx *vctx, /*@null@*/Rule
                                 rule->from_if_ptr, rule->to_if_ptr, rule->shape_class_in,
                                 create->option.bw_out_min, create->option.bw_out_min_unit,
                                 create->option.bw_out_max, create->option.bw_out_max_unit,
-                                create->option.prio);
+                                create->option.prio, create->option.shape_leaf);
                         if (retval < 0) {
                             return(retval);
                         }
@@ -43,7 +43,7 @@ struct ChainRef
          0: ok
         -1: error
 */
-static int
+int
 ruleset_setup(const int debuglvl, RuleSet *ruleset)
 {
     /* safety */
@@ -139,7 +139,7 @@ ruleset_setup(const int debuglvl, RuleSet *ruleset)
     Returns:
         nothing, void function
 */
-static void
+void
 ruleset_cleanup(const int debuglvl, RuleSet *ruleset)
 {
     /* safety */
@@ -384,35 +384,23 @@ ruleset_writeprint(const int fd, const char *line)
 }
 
 
-/* Create the shaping script file */
+/* Create the shaping batch file for 'tc -batch'. It only contains
+ * the changes compared to what is loaded now, so it may be empty. */
 static int
 ruleset_fill_shaping_file(const int debuglvl, RuleSet *ruleset, int fd) {
-    d_list_node *d_node = NULL;
-    char        *ptr = NULL;
-    char        cmd[MAX_PIPE_COMMAND] = "";
-
-    ruleset_writeprint(fd, "#!/bin/bash\n");
-
-    for (d_node = ruleset->tc_rules.top; d_node; d_node = d_node->next) {
-        ptr = d_node->data;
-
-        snprintf(cmd, sizeof(cmd), "%s\n", ptr);
-        ruleset_writeprint(fd, cmd);
-    }
-    
-    ruleset_writeprint(fd, "# EOF\n");
+    if (shaping_write_batch(debuglvl, ruleset, fd) < 0)
+        return(-1);
 
     return(0);
 }
 
-/** \internal
- *
+/**
  *  \brief Creates the ruleset file to be loaded by iptables-restore
  *
  *  \retval 0 ok
  *  \retval -1 error
  */
-static int
+int
 ruleset_fill_file(const int debuglvl, VuurmuurCtx *vctx, RuleSet *ruleset,
         int ruleset_fd, int ipver)
 {
@@ -1234,19 +1222,25 @@ ruleset_load_ruleset(const int debuglvl, char *path_to_ruleset, char *path_to_re
 
 /*  ruleset_load_shape_ruleset
 
-    Actually loads the shape ruleset
+    Actually loads the shape ruleset using 'tc -batch'. If we don't know
+    what is loaded (first load or the previous one failed) the interfaces
+    are cleared first.
     
     Returncodes:
         -1: error
          0: ok
 */
 static int
-ruleset_load_shape_ruleset(const int debuglvl, char *path_to_ruleset, char *path_to_resultfile, struct vuurmuur_config *cnf)
+ruleset_load_shape_ruleset(const int debuglvl, VuurmuurCtx *vctx, char *path_to_ruleset, char *path_to_resultfile)
 {
-    char    cmd[256] = "";
+    struct vuurmuur_config *cnf = vctx->conf;
+    struct stat st;
+    char    *args[] = { cnf->tc_location, "-force", "-batch", path_to_ruleset, NULL };
+    char    *output[] = { "/dev/null", path_to_resultfile };
+    int     result = 0;
 
     /* safety */
-    if(!path_to_ruleset || !cnf)
+    if(!path_to_ruleset || !path_to_resultfile)
     {
         (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
@@ -1263,22 +1257,23 @@ ruleset_load_shape_ruleset(const int debuglvl, char *path_to_ruleset, char *path
         return(-1);
     }
 
-    /*
-        create and execute the REAL command
-    */
+    /* if have no tc, no shaping is possible */
+    if(strcmp(cnf->tc_location, "") == 0)
+        return(0);
 
-    /* */
-    if(snprintf(cmd, sizeof(cmd), "/bin/bash %s 2>> %s", path_to_ruleset,
-        path_to_resultfile) >= (int)sizeof(cmd))
-    {
-        (void)vrprint.error(-1, "Error", "command string overflow (in: %s:%d).", __FUNC__, __LINE__);
-        return(-1);
-    }
+    if(shaping_tree_loaded() == FALSE)
+        (void)shaping_clear_interfaces(debuglvl, cnf, vctx->interfaces);
+
+    /* nothing changed */
+    if(stat(path_to_ruleset, &st) == 0 && st.st_size == 0)
+        return(0);
 
     /* all good so far, lets load the ruleset */
-    if(pipe_command(debuglvl, cnf, cmd, PIPE_VERBOSE) < 0)
+    result = libvuurmuur_exec_command(debuglvl, cnf, cnf->tc_location, args, output);
+    if(result != 0)
     {
-        (void)vrprint.error(-1, "Error", "loading the shape ruleset failed (in: %s:%d).", __FUNC__, __LINE__);
+        (void)vrprint.error(-1, "Error", "loading the shape ruleset failed: "
+            "%s returned %d (in: %s:%d).", cnf->tc_location, result, __FUNC__, __LINE__);
         return(-1);
     }
 
@@ -1294,18 +1289,13 @@ ruleset_load_shape_ruleset(const int debuglvl, char *path_to_ruleset, char *path
          0: ok
         -1: error
 */
-static int
+int
 ruleset_create_ruleset( const int debuglvl, VuurmuurCtx *vctx, RuleSet *ruleset)
 {
     int     result = 0;
     char    forward_rules = 0;
 
     /* create shaping setup */
-    if(shaping_clear_interfaces(debuglvl, vctx->conf, vctx->interfaces, ruleset) < 0)
-    {
-        (void)vrprint.error(-1, "Error", "setting up interface shaping clearing failed (in: %s:%d).", __FUNC__, __LINE__);
-        return(-1);
-    }
     if(shaping_setup_roots(debuglvl, vctx->conf, vctx->interfaces, ruleset) < 0)
     {
         (void)vrprint.error(-1, "Error", "setting up interface shaping roots failed (in: %s:%d).", __FUNC__, __LINE__);
@@ -1375,28 +1365,53 @@ ruleset_create_ruleset( const int debuglvl, VuurmuurCtx *vctx, RuleSet *ruleset)
 }
 
 
+/*  ruleset_save_interface_counters
+
+    Store the interface and accounting counters so they can be restored
+    with the new ruleset. All counters come from a single iptables-save
+    snapshot (ip6tables-save for IPv6) instead of one iptables call per
+    chain and interface. If the snapshot can't be taken the counters are
+    zeroed.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
 static int
-ruleset_save_interface_counters(const int debuglvl, Interfaces *interfaces)
+ruleset_save_interface_counters(const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, int ipv)
 {
     d_list_node             *d_node = NULL;
     struct InterfaceData_   *iface_ptr = NULL;
     unsigned long long      tmp_ull = 0;
     char                    acc_chain[32] = "";
+    IptCounters             counters;
+    int                     retval = 0;
 
     /* safety */
-    if(!interfaces)
+    if(!cnf || !interfaces)
     {
         (void)vrprint.error(-1, "Internal Error", "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
     }
 
+    /* get all counters at once. The counters are only bookkeeping, so
+     * if we can't get them we start from zero instead of not loading
+     * the ruleset. */
+    if(ipt_counters_load(debuglvl, cnf, &counters, ipv, "filter") < 0)
+    {
+        (void)vrprint.warning("Warning", "getting the iptables counters failed, "
+                "the interface counters start from zero.");
+        ipt_counters_cleanup(debuglvl, &counters);
+    }
+
     /* loop through the interfaces */
     for(d_node = interfaces->list.top; d_node; d_node = d_node->next)
     {
         if(!(iface_ptr = d_node->data))
         {
             (void)vrprint.error(-1, "Internal Error", "NULL pointer (in: %s:%d).", __FUNC__, __LINE__);
-            return(-1);
+            retval = -1;
+            break;
         }
 
         /* Check for empty device string and virtual device. */
@@ -1408,21 +1423,22 @@ ruleset_save_interface_counters(const int debuglvl, Interfaces *interfaces)
                 if(!(iface_ptr->cnt = malloc(sizeof(InterfaceCount))))
                 {
                     (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
-                    return(-1);
+                    retval = -1;
+                    break;
                 }
             }
             memset(iface_ptr->cnt, 0, sizeof(InterfaceCount));
 
-            /* get the real counters from iptables */
-            get_iface_stats_from_ipt(debuglvl, iface_ptr->device, "INPUT",
+            /* get the real counters from the snapshot */
+            (void)ipt_counters_get_iface(debuglvl, &counters, iface_ptr->device, "INPUT",
                                         &iface_ptr->cnt->input_packets,
                                         &iface_ptr->cnt->input_bytes,
                                         &tmp_ull, &tmp_ull);
-            get_iface_stats_from_ipt(debuglvl, iface_ptr->device, "OUTPUT",
+            (void)ipt_counters_get_iface(debuglvl, &counters, iface_ptr->device, "OUTPUT",
                                         &tmp_ull, &tmp_ull,
                                         &iface_ptr->cnt->output_packets,
                                         &iface_ptr->cnt->output_bytes);
-            get_iface_stats_from_ipt(debuglvl, iface_ptr->device, "FORWARD",
+            (void)ipt_counters_get_iface(debuglvl, &counters, iface_ptr->device, "FORWARD",
                                         &iface_ptr->cnt->forwardin_packets,
                                         &iface_ptr->cnt->forwardin_bytes,
                                         &iface_ptr->cnt->forwardout_packets,
@@ -1445,7 +1461,7 @@ ruleset_save_interface_counters(const int debuglvl, Interfaces *interfaces)
                 (void)vrprint.debug(__FUNC__, "acc_chain '%s'.", acc_chain);
 
             /* get the accounting chains numbers */
-            get_iface_stats_from_ipt(debuglvl, iface_ptr->device, acc_chain,
+            (void)ipt_counters_get_iface(debuglvl, &counters, iface_ptr->device, acc_chain,
                                         &iface_ptr->cnt->acc_in_packets,
                                         &iface_ptr->cnt->acc_in_bytes,
                                         &iface_ptr->cnt->acc_out_packets,
@@ -1460,7 +1476,8 @@ ruleset_save_interface_counters(const int debuglvl, Interfaces *interfaces)
         }
     }
 
-    return(0);
+    ipt_counters_cleanup(debuglvl, &counters);
+    return(retval);
 }
 
 
@@ -1497,7 +1514,7 @@ ruleset_clear_interface_counters(const int debuglvl, Interfaces *interfaces)
 }
 
 
-static int
+int
 ruleset_store_failed_set(const int debuglvl, const char *file)
 {
     char    failed_ruleset_path[32] = "";
@@ -1539,7 +1556,7 @@ ruleset_store_failed_set(const int debuglvl, const char *file)
 }
 
 
-static int
+int
 ruleset_log_resultfile(const int debuglvl, char *path)
 {
     char    line[256] = "";
@@ -1597,6 +1614,7 @@ load_ruleset_ipv4(const int debuglvl, VuurmuurCtx *vctx)
     int     ruleset_fd = 0,
             result_fd = 0,
             shape_fd = 0;
+    char    shape_failed = FALSE;
 
     /* setup the ruleset */
     if(ruleset_setup(debuglvl, &ruleset) != 0)
@@ -1608,10 +1626,17 @@ load_ruleset_ipv4(const int debuglvl, VuurmuurCtx *vctx)
     ruleset.ipv = VR_IPV4;
 
     /* store counters */
-    if(ruleset_save_interface_counters(debuglvl, vctx->interfaces) < 0)
+    if(ruleset_save_interface_counters(debuglvl, vctx->conf, vctx->interfaces, ruleset.ipv) < 0)
     {
-        (void)vrprint.error(-1, "Error", "saving interface counters failed (in: %s:%d).", __FUNC__, __LINE__);
-        return(-1);
+        (void)vrprint.warning("Warning", "saving interface counters failed, "
+                "loading the ruleset anyway.");
+    }
+
+    /* the host accounting rules need their ipsets */
+    if(hostacc_setup(debuglvl, vctx) < 0)
+    {
+        (void)vrprint.warning("Warning", "loading the host accounting sets failed, "
+                "no host accounting.");
     }
 
     /* create the ruleset */
@@ -1654,7 +1679,7 @@ load_ruleset_ipv4(const int debuglvl, VuurmuurCtx *vctx)
     shape_fd = create_tempfile(debuglvl, cur_shape_path);
     if(shape_fd == -1)
     {
-        (void)vrprint.error(-1, "Error", "creating shape script file failed (in: %s:%d).",
+        (void)vrprint.error(-1, "Error", "creating shape batch file failed (in: %s:%d).",
                                     __FUNC__, __LINE__);
 
         ruleset_cleanup(debuglvl, &ruleset);
@@ -1698,17 +1723,23 @@ load_ruleset_ipv4(const int debuglvl, VuurmuurCtx *vctx)
         sleep(15);
     }
 
-    /* load the shaping rules */
-    if(ruleset_load_shape_ruleset(debuglvl, cur_shape_path, cur_result_path, vctx->conf) != 0)
+    /* load the shaping rules. If that fails we don't know what the tree
+     * looks like anymore, so the next load starts from scratch. Without
+     * shaping the firewall still works, so go on with iptables. */
+    if(ruleset_load_shape_ruleset(debuglvl, vctx, cur_shape_path, cur_result_path) != 0)
     {
-        /* oops, something went wrong */
-        (void)vrprint.error(-1, "Error", "shape rulesetfile will be stored as '%s.failed' (in: %s:%d).",
-                                    cur_shape_path, __FUNC__, __LINE__);
+        (void)shaping_batch_loaded(debuglvl, &ruleset, FALSE);
+        (void)vrprint.warning("Warning", "shape rulesetfile will be stored as '%s.failed', "
+                "the shaping is cleared on the next load.", cur_shape_path);
         (void)ruleset_store_failed_set(debuglvl, cur_shape_path);
         (void)ruleset_log_resultfile(debuglvl, cur_result_path);
-        ruleset_cleanup(debuglvl, &ruleset);
-        return(-1);
+        shape_failed = TRUE;
     }
+    else
+    {
+        (void)shaping_batch_loaded(debuglvl, &ruleset, TRUE);
+    }
+
     /* now load the iptables ruleset */
     if(ruleset_load_ruleset(debuglvl, cur_ruleset_path, cur_result_path, vctx->conf, VR_IPV4) != 0)
     {
@@ -1745,8 +1776,8 @@ load_ruleset_ipv4(const int debuglvl, VuurmuurCtx *vctx)
             return(-1);
         }
 
-        /* remove the shape tempfile */
-        if(unlink(cur_shape_path) == -1)
+        /* remove the shape tempfile, unless it was stored as failed */
+        if(shape_failed == FALSE && unlink(cur_shape_path) == -1)
         {
             (void)vrprint.error(-1, "Error", "removing tempfile "
                     "failed: %s (in: %s:%d).",
@@ -1760,7 +1791,10 @@ load_ruleset_ipv4(const int debuglvl, VuurmuurCtx *vctx)
     /* finaly clean up the mess */
     ruleset_cleanup(debuglvl, &ruleset);
 
-    (void)vrprint.info("Info", "ruleset loading completed successfully.");
+    if(shape_failed == TRUE)
+        (void)vrprint.info("Info", "ruleset loading completed, but without shaping.");
+    else
+        (void)vrprint.info("Info", "ruleset loading completed successfully.");
     return(0);
 }
 
@@ -1794,10 +1828,10 @@ load_ruleset_ipv6(const int debuglvl, VuurmuurCtx *vctx)
     ruleset.ipv = VR_IPV6;
 
     /* store counters */
-    if(ruleset_save_interface_counters(debuglvl, vctx->interfaces) < 0)
+    if(ruleset_save_interface_counters(debuglvl, vctx->conf, vctx->interfaces, ruleset.ipv) < 0)
     {
-        (void)vrprint.error(-1, "Error", "saving interface counters failed (in: %s:%d).", __FUNC__, __LINE__);
-        return(-1);
+        (void)vrprint.warning("Warning", "saving interface counters failed, "
+                "loading the ruleset anyway.");
     }
 
     /* create the ruleset */
@@ -1907,10 +1941,79 @@ load_ruleset_ipv6(const int debuglvl, VuurmuurCtx *vctx)
 }
 #endif
 
+/* the backend that loaded the current ruleset */
+#define RULESET_BACKEND_UNKNOWN     0
+#define RULESET_BACKEND_IPTABLES    1
+#define RULESET_BACKEND_NFTABLES    2
+
+static int ruleset_backend = RULESET_BACKEND_UNKNOWN;
+
+
+/*  ruleset_iptables_loaded
+
+    Checks if there is a ruleset loaded by the iptables backend, by
+    looking for the ANTISPOOF chain it always creates.
+
+    Returncodes:
+        TRUE: loaded
+        FALSE: not loaded
+*/
+static int
+ruleset_iptables_loaded(const int debuglvl, struct vuurmuur_config *cnf)
+{
+    Rules   rules;
+    int     loaded = FALSE;
+
+    memset(&rules, 0, sizeof(rules));
+
+    if(rules_get_system_chains(debuglvl, &rules, cnf, VR_IPV4) == 0 &&
+       rules_chain_in_list(debuglvl, &rules.system_chain_filter, "ANTISPOOF"))
+    {
+        loaded = TRUE;
+    }
+
+    d_list_cleanup(debuglvl, &rules.system_chain_filter);
+    d_list_cleanup(debuglvl, &rules.system_chain_mangle);
+    d_list_cleanup(debuglvl, &rules.system_chain_nat);
+    return(loaded);
+}
+
+
+/*  load_ruleset
+
+    Loads the ruleset with the configured backend. When the backend was
+    changed, the ruleset of the other one is removed after the new one
+    is loaded, so the old rules don't stay active next to the new ones.
+    At startup we don't know which backend was used before, so we look.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
 int
 load_ruleset(const int debuglvl, VuurmuurCtx *vctx)
 {
-    int r = load_ruleset_ipv4(debuglvl, vctx);
+    int r = 0;
+
+    /* nftables handles ipv4 and ipv6 in one go */
+    if (vctx->conf->use_nftables == TRUE) {
+        if (nftables_load_ruleset(debuglvl, vctx) < 0)
+            return(-1);
+
+        if (ruleset_backend == RULESET_BACKEND_IPTABLES ||
+            (ruleset_backend == RULESET_BACKEND_UNKNOWN &&
+             ruleset_iptables_loaded(debuglvl, vctx->conf) == TRUE))
+        {
+            (void)vrprint.info("Info", "removing the rules of the iptables backend.");
+            if (clear_vuurmuur_iptables_rules(debuglvl, vctx->conf) < 0)
+                (void)vrprint.warning("Warning", "removing the iptables rules failed.");
+        }
+
+        ruleset_backend = RULESET_BACKEND_NFTABLES;
+        return(0);
+    }
+
+    r = load_ruleset_ipv4(debuglvl, vctx);
     if (r == -1) {
         return(-1);
     }
@@ -1923,6 +2026,16 @@ load_ruleset(const int debuglvl, VuurmuurCtx *vctx)
     }
 #endif
 
+    if (ruleset_backend == RULESET_BACKEND_NFTABLES ||
+        (ruleset_backend == RULESET_BACKEND_UNKNOWN &&
+         nftables_table_loaded(debuglvl, vctx->conf) == TRUE))
+    {
+        (void)vrprint.info("Info", "removing the rules of the nftables backend.");
+        if (nftables_clear_ruleset(debuglvl, vctx->conf) < 0)
+            (void)vrprint.warning("Warning", "removing the nftables rules failed.");
+    }
+
+    ruleset_backend = RULESET_BACKEND_IPTABLES;
     return(0);
 }
 
@@ -41,35 +41,57 @@ shaping_convert_rate(const int debuglvl, u_int32_t rate, char *unit) {
     return(kbit_rate);
 }
 
-/* structure for storing an iptables rule in the queue.
+/* a qdisc or class of the shaping tree. Qdiscs are known by their handle
+ * (major), classes by their classid (major:minor). A parent_major of 0
+ * means the root of the device.
  *
- * These are the 'same':
- * /sbin/tc class add dev eth2 parent 4:2 classid 4:12 htb rate 8192kbit ceil 9216kbit prio 1
- * /sbin/tc class add dev eth2 parent 4:3 classid 4:12 htb rate 8192kbit ceil 9216kbit prio 1
+ * These are the 'same' (see shaping_objcmp):
+ * class add dev eth2 parent 4:2 classid 4:12 htb rate 8192kbit ceil 9216kbit prio 1
+ * class add dev eth2 parent 4:3 classid 4:12 htb rate 8192kbit ceil 9216kbit prio 1
  */
 typedef struct
 {
-    u_int16_t   handle;
-    u_int16_t   class;
-    char        cmd[MAX_PIPE_COMMAND];
     char        device[16];
+    char        qdisc;          /* TRUE: qdisc, FALSE: class */
 
-} ShapeRule;
+    u_int16_t   major;
+    u_int16_t   minor;
 
-/*  compare two shaping rules and return 1 if they match, 0 otherwise */
+    u_int16_t   parent_major;
+    u_int16_t   parent_minor;
+
+    char        params[128];    /* e.g. 'htb rate 512kbit' */
+
+    unsigned int ifindex;       /* of the device when the tree was loaded */
+
+    char        dead;           /* used when comparing to the loaded tree */
+    char        gone;           /* the device is gone or was recreated */
+
+} ShapeObject;
+
+/*  the shaping tree as it was last loaded by the ruleset loader. A reload
+    only changes what differs from it. When it is not valid (at startup,
+    after a failed load or after the interfaces were cleared) the next
+    load starts from scratch. */
+static ShapeObject  *shape_loaded = NULL;
+static unsigned int shape_loaded_len = 0;
+static char         shape_loaded_valid = FALSE;
+
+/*  compare two shaping objects and return 1 if they match, 0 otherwise */
 static int
-shaping_rulecmp(const int debuglvl, ShapeRule *r1, ShapeRule *r2)
+shaping_objcmp(const int debuglvl, ShapeObject *o1, ShapeObject *o2)
 {
-    if(r1 == NULL || r2 == NULL)
+    if(o1 == NULL || o2 == NULL)
     {
         (void)vrprint.error(-1, "Internal Error", "parameter problem "
                 "(in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
     }
 
-    if( r1->handle == r2->handle &&
-        r1->class == r2->class &&
-        strcmp(r1->device, r2->device) == 0)
+    if( o1->qdisc == o2->qdisc &&
+        o1->major == o2->major &&
+        o1->minor == o2->minor &&
+        strcmp(o1->device, o2->device) == 0)
     {
         return(1);
     }
@@ -77,16 +99,119 @@ shaping_rulecmp(const int debuglvl, ShapeRule *r1, ShapeRule *r2)
     return(0);
 }
 
+/*  qsort/bsearch compare function for arrays of ShapeObject pointers */
+static int
+shaping_objsort(const void *p1, const void *p2)
+{
+    const ShapeObject   *o1 = *(ShapeObject * const *)p1,
+                        *o2 = *(ShapeObject * const *)p2;
+    int                 r = 0;
+
+    r = strcmp(o1->device, o2->device);
+    if(r != 0)
+        return(r);
+    if(o1->qdisc != o2->qdisc)
+        return(o1->qdisc - o2->qdisc);
+    if(o1->major != o2->major)
+        return(o1->major - o2->major);
+    return(o1->minor - o2->minor);
+}
+
+/*  lookup the object with the same device, handle or classid in a sorted
+    array. Returns NULL if it is not there. */
+static ShapeObject *
+shaping_objfind(ShapeObject **array, unsigned int len, const char *device,
+        char qdisc, u_int16_t major, u_int16_t minor)
+{
+    ShapeObject key, *keyp = &key, **found = NULL;
+
+    if(array == NULL || len == 0)
+        return(NULL);
+
+    (void)strlcpy(key.device, device, sizeof(key.device));
+    key.qdisc = qdisc;
+    key.major = major;
+    key.minor = minor;
+
+    found = bsearch(&keyp, array, len, sizeof(ShapeObject *), shaping_objsort);
+    if(found == NULL)
+        return(NULL);
+
+    return(*found);
+}
+
+/*  find the parent of 'obj' in a sorted array. The parent of a class
+    without a minor is the qdisc it hangs from, otherwise it is a class. */
+static ShapeObject *
+shaping_objfind_parent(ShapeObject **array, unsigned int len, ShapeObject *obj)
+{
+    if(obj->parent_major == 0)
+        return(NULL);
+
+    if(obj->parent_minor == 0)
+        return(shaping_objfind(array, len, obj->device, TRUE, obj->parent_major, 0));
+
+    return(shaping_objfind(array, len, obj->device, FALSE, obj->parent_major, obj->parent_minor));
+}
+
+/*  print the object as a tc command (without the tc binary itself), e.g.:
+ *  qdisc add dev eth0 root handle 2: htb default 5
+ *  class replace dev eth0 parent 2:1 classid 2:12 htb rate 512kbit ceil 1024kbit prio 3
+ *  qdisc del dev eth0 parent 2:12 handle 12:
+ */
+static void
+shaping_objprint(ShapeObject *obj, const char *verb, char *buf, size_t size)
+{
+    char    parent[24] = "root";
+    char    *params = obj->params,
+            *sep = " ";
+
+    if(obj->parent_major != 0)
+    {
+        if(obj->parent_minor == 0)
+            snprintf(parent, sizeof(parent), "parent %u:", obj->parent_major);
+        else
+            snprintf(parent, sizeof(parent), "parent %u:%u", obj->parent_major, obj->parent_minor);
+    }
+
+    /* deleting only needs to know which object */
+    if(strcmp(verb, "del") == 0 || params[0] == '\0')
+        sep = params = "";
+
+    if(obj->qdisc == TRUE)
+        snprintf(buf, size, "qdisc %s dev %s %s handle %u:%s%s", verb,
+            obj->device, parent, obj->major, sep, params);
+    else
+        snprintf(buf, size, "class %s dev %s %s classid %u:%u%s%s", verb,
+            obj->device, parent, obj->major, obj->minor, sep, params);
+}
+
+/*  fill in a shaping object */
+static void
+shaping_objset(ShapeObject *obj, const char *device, char qdisc,
+        u_int16_t major, u_int16_t minor, u_int16_t parent_major,
+        u_int16_t parent_minor, const char *params)
+{
+    memset(obj, 0, sizeof(ShapeObject));
+
+    (void)strlcpy(obj->device, device, sizeof(obj->device));
+    obj->qdisc = qdisc;
+    obj->major = major;
+    obj->minor = minor;
+    obj->parent_major = parent_major;
+    obj->parent_minor = parent_minor;
+    (void)strlcpy(obj->params, params, sizeof(obj->params));
+}
 
-/*  insert a new shape rule into the list, but first check if it is not
+/*  insert a new shape object into the list, but first check if it is not
     a duplicate. If it is a dup, just drop it. */
 static int
-shaping_ruleinsert(const int debuglvl, struct RuleCreateData_ *rule, ShapeRule *shape_rule)
+shaping_ruleinsert(const int debuglvl, struct RuleCreateData_ *rule, ShapeObject *obj)
 {
     d_list_node *d_node = NULL;
-    ShapeRule   *listrule = NULL;
+    ShapeObject *listobj = NULL;
 
-    if(shape_rule == NULL || rule == NULL)
+    if(obj == NULL || rule == NULL)
     {
         (void)vrprint.error(-1, "Internal Error", "parameter problem "
                 "(in: %s:%d).", __FUNC__, __LINE__);
@@ -95,16 +220,16 @@ shaping_ruleinsert(const int debuglvl, struct RuleCreateData_ *rule, ShapeRule *
 
     for(d_node = rule->shaperulelist.top; d_node; d_node = d_node->next)
     {
-        listrule = d_node->data;
+        listobj = d_node->data;
 
-        if(shaping_rulecmp(debuglvl, listrule, shape_rule) == 1)
+        if(shaping_objcmp(debuglvl, listobj, obj) == 1)
         {
-            free(shape_rule);
+            free(obj);
             return(0);
         }
     }
 
-    if(d_list_append(debuglvl, &rule->shaperulelist, shape_rule) == NULL)
+    if(d_list_append(debuglvl, &rule->shaperulelist, obj) == NULL)
     {
         (void)vrprint.error(-1, "Internal Error", "d_list_append() "
             "failed (in: %s:%d).", __FUNC__, __LINE__);
@@ -115,7 +240,7 @@ shaping_ruleinsert(const int debuglvl, struct RuleCreateData_ *rule, ShapeRule *
 }
 
 
-/*  queue the rule into the list, so we can inspect the rules for
+/*  queue the object into the list, so we can inspect the objects for
     duplicates. We do this to prevent creating lots of duplicates
     especially for setups with lots of virtual interfaces.
     
@@ -124,55 +249,65 @@ shaping_ruleinsert(const int debuglvl, struct RuleCreateData_ *rule, ShapeRule *
     */
 static int
 shaping_queue_rule(const int debuglvl, struct RuleCreateData_ *rule,
-        /*@null@*/RuleSet *ruleset, u_int16_t handle, u_int16_t class, char *device, char *cmd)
+        const char *device, char qdisc, u_int16_t major, u_int16_t minor,
+        u_int16_t parent_major, u_int16_t parent_minor, const char *params)
 {
-    ShapeRule *shape_rule = NULL;
+    ShapeObject *obj = NULL;
 
     /* safety */
-    if(cmd == NULL || rule == NULL)
+    if(params == NULL || rule == NULL)
     {
         (void)vrprint.error(-1, "Internal Error", "parameter problem "
                 "(in: %s:%d).", __FUNC__, __LINE__);
         return(-1);
     }
 
-    shape_rule = malloc(sizeof(ShapeRule));
-    if(shape_rule == NULL)
+    obj = malloc(sizeof(ShapeObject));
+    if(obj == NULL)
     {
         (void)vrprint.error(-1, "Error", "malloc failed: %s "
             "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
         return(-1);
     }
 
-    shape_rule->handle = handle;
-    shape_rule->class = class;
-    strlcpy(shape_rule->cmd, cmd, sizeof(shape_rule->cmd));
-    strlcpy(shape_rule->device, device, sizeof(shape_rule->device));
+    shaping_objset(obj, device, qdisc, major, minor, parent_major,
+            parent_minor, params);
 
-    if(shaping_ruleinsert(debuglvl, rule, shape_rule) < 0)
+    if(shaping_ruleinsert(debuglvl, rule, obj) < 0)
         return(-1);
 
     return(0);
 }
+
+/*  In ruleset mode the object is added to the ruleset's list and loaded
+    later on in one tc batch. Otherwise it is added right away. */
 static int
-shaping_process_rule (const int debuglvl, struct vuurmuur_config *cnf, /*@null@*/RuleSet *ruleset, char *cmd) {
-    char *buf = NULL;
+shaping_process_rule (const int debuglvl, struct vuurmuur_config *cnf, /*@null@*/RuleSet *ruleset, ShapeObject *obj) {
+    ShapeObject *copy = NULL;
+    char        tccmd[MAX_PIPE_COMMAND] = "";
+    char        cmd[MAX_PIPE_COMMAND] = "";
 
     if (ruleset != NULL) {
-        buf = strdup (cmd);
-        if (buf == NULL) {
-            (void)vrprint.error(-1, "Error", "strdup failed: %s (in: %s:%d).",
+        copy = malloc(sizeof(ShapeObject));
+        if (copy == NULL) {
+            (void)vrprint.error(-1, "Error", "malloc failed: %s (in: %s:%d).",
                 strerror(errno), __FUNC__, __LINE__);
             return(-1);
         }
+        memcpy(copy, obj, sizeof(ShapeObject));
 
-        if (d_list_append(debuglvl, &ruleset->tc_rules, buf) == NULL) {
+        if (d_list_append(debuglvl, &ruleset->tc_rules, copy) == NULL) {
             (void)vrprint.error(-1, "Internal Error", "appending rule to list failed (in: %s:%d).",
                 __FUNC__, __LINE__);
-            free(buf);
+            free(copy);
             return(-1);
         }
     } else {
+        shaping_objprint(obj, "add", tccmd, sizeof(tccmd));
+        snprintf(cmd, sizeof(cmd), "%s %s", cnf->tc_location, tccmd);
+
+        (void)vrprint.debug(__FUNC__, "cmd \"%s\"", cmd);
+
         if(pipe_command(debuglvl, cnf, cmd, PIPE_VERBOSE) < 0)
             return (-1);
     }
@@ -181,13 +316,13 @@ shaping_process_rule (const int debuglvl, struct vuurmuur_config *cnf, /*@null@*
 }
 
 /*  at the end of processing one vuurmuur rule, we should have a queue
-    filled with tc rules, none of which are duplicate. This function
+    filled with tc objects, none of which are duplicate. This function
     passes them to process_rule */
 int
 shaping_process_queued_rules(const int debuglvl, struct vuurmuur_config *cnf, /*@null@*/RuleSet *ruleset, struct RuleCreateData_ *rule)
 {
     d_list_node *d_node = NULL;
-    ShapeRule   *r = NULL;
+    ShapeObject *obj = NULL;
 
     if(rule == NULL)
     {
@@ -198,9 +333,9 @@ shaping_process_queued_rules(const int debuglvl, struct vuurmuur_config *cnf, /*
 
     for(d_node = rule->shaperulelist.top; d_node; d_node = d_node->next)
     {
-        r = d_node->data;
+        obj = d_node->data;
 
-        if(shaping_process_rule(debuglvl, cnf, ruleset, r->cmd) < 0)
+        if(shaping_process_rule(debuglvl, cnf, ruleset, obj) < 0)
         {
             return(-1);
         }
@@ -215,11 +350,17 @@ shaping_process_queued_rules(const int debuglvl, struct vuurmuur_config *cnf, /*
  * Returns 0: ok -1: error
  */
 int
-shaping_clear_interfaces (const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, /*@null@*/RuleSet *ruleset) {
+shaping_clear_interfaces (const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces) {
     d_list_node     *d_node = NULL;
     InterfaceData   *iface_ptr = NULL;
     char            cmd[MAX_PIPE_COMMAND] = "";
 
+    /* whatever was loaded before is gone now */
+    free(shape_loaded);
+    shape_loaded = NULL;
+    shape_loaded_len = 0;
+    shape_loaded_valid = FALSE;
+
     /* if have no tc, no shaping is possible */
     if (strcmp(cnf->tc_location, "") == 0)
         return (0);
@@ -237,28 +378,318 @@ shaping_clear_interfaces (const int debuglvl, struct vuurmuur_config *cnf, Inter
 
             (void)vrprint.debug(__FUNC__, "cmd \"%s\"", cmd);
 
-            if (shaping_process_rule(debuglvl, cnf, ruleset, cmd) < 0)
-                return(-1);
+            /* fails if there is no qdisc to remove, which is fine */
+            (void)pipe_command(debuglvl, cnf, cmd, PIPE_QUIET);
         }
     }
 
-    /* special case: in ruleset mode, if we have no shaping configs
-     * the config removal command will make the shape script return
-     * an error code. So we add the 'true' command so it won't fail.
-     */
-    if (ruleset) {
-        if (shaping_process_rule(debuglvl, cnf, ruleset, "true") < 0)
+    return (0);
+}
+
+/*  returns TRUE if the tree of the last ruleset load is known, so the next
+    load only needs to apply the differences */
+int
+shaping_tree_loaded(void)
+{
+    return(shape_loaded_valid);
+}
+
+/*  returns TRUE if the device of the loaded object is no longer the one
+    the tree was loaded on: it is gone, or it was recreated (e.g. a ppp
+    link that reconnected) and came back without qdiscs. Either way the
+    objects on it are gone, so they can't be deleted and have to be added
+    again. 'last' caches the lookup for the previous object, the loaded
+    tree is ordered by device. */
+static int
+shaping_device_gone(ShapeObject *obj, ShapeObject **last)
+{
+    if(*last == NULL || strcmp((*last)->device, obj->device) != 0 ||
+        (*last)->ifindex != obj->ifindex)
+    {
+        obj->gone = (char)(obj->ifindex == 0 ||
+                if_nametoindex(obj->device) != obj->ifindex);
+        *last = obj;
+        return(obj->gone);
+    }
+
+    obj->gone = (*last)->gone;
+    return(obj->gone);
+}
+
+/*  returns TRUE if the kind of the qdisc, the first word of its params,
+    is different */
+static int
+shaping_objkind_changed(ShapeObject *o1, ShapeObject *o2)
+{
+    size_t  len1 = strcspn(o1->params, " "),
+            len2 = strcspn(o2->params, " ");
+
+    if(len1 != len2 || strncmp(o1->params, o2->params, len1) != 0)
+        return(TRUE);
+
+    return(FALSE);
+}
+
+/*  write a line to the batch file */
+static int
+shaping_batch_write(const int fd, ShapeObject *obj, const char *verb)
+{
+    char    line[MAX_PIPE_COMMAND] = "";
+
+    shaping_objprint(obj, verb, line, sizeof(line));
+    (void)strlcat(line, "\n", sizeof(line));
+
+    if(write(fd, line, strlen(line)) != (ssize_t)strlen(line))
+    {
+        (void)vrprint.error(-1, "Error", "writing shape batch failed: %s "
+            "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    return(0);
+}
+
+/*  shaping_write_batch
+
+    Writes the tc batch ('tc -batch') that turns the loaded tree into the
+    tree of the ruleset:
+
+    1. roots that are gone or have changed are deleted, which takes their
+       whole tree with them.
+    2. leaf qdiscs and classes that are gone or moved to another parent,
+       and leaf qdiscs of another kind, are deleted, children first.
+    3. objects that are new or have changed are added using 'replace', so
+       a changed class keeps its queue.
+
+    Unchanged objects are left alone. If nothing changed, nothing is
+    written. The tree of a device that is gone or was recreated since the
+    last load is added again, without deleting anything from it.
+
+    Returncodes:
+        >= 0: number of lines written
+          -1: error
+*/
+int
+shaping_write_batch(const int debuglvl, RuleSet *ruleset, int fd)
+{
+    d_list_node     *d_node = NULL;
+    ShapeObject     **want = NULL,
+                    **loaded = NULL,
+                    *obj = NULL,
+                    *old = NULL,
+                    *parent = NULL,
+                    *last = NULL;
+    unsigned int    want_len = 0,
+                    i = 0;
+    int             lines = 0;
+
+    if(ruleset == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    /* sorted arrays for the lookups */
+    if(ruleset->tc_rules.len > 0)
+    {
+        want = calloc(ruleset->tc_rules.len, sizeof(ShapeObject *));
+        if(want == NULL)
+        {
+            (void)vrprint.error(-1, "Error", "calloc failed: %s "
+                "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
             return(-1);
+        }
+        for(d_node = ruleset->tc_rules.top; d_node; d_node = d_node->next)
+            want[want_len++] = d_node->data;
+
+        qsort(want, want_len, sizeof(ShapeObject *), shaping_objsort);
     }
+    if(shape_loaded_len > 0)
+    {
+        loaded = calloc(shape_loaded_len, sizeof(ShapeObject *));
+        if(loaded == NULL)
+        {
+            (void)vrprint.error(-1, "Error", "calloc failed: %s "
+                "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+            free(want);
+            return(-1);
+        }
+        for(i = 0; i < shape_loaded_len; i++)
+            loaded[i] = &shape_loaded[i];
 
-    return (0);
+        qsort(loaded, shape_loaded_len, sizeof(ShapeObject *), shaping_objsort);
+    }
+
+    /* find out what is dead. The loaded tree is in creation order, so
+     * parents are always handled before their children. */
+    for(i = 0; i < shape_loaded_len; i++)
+    {
+        old = &shape_loaded[i];
+        old->dead = FALSE;
+
+        if(shaping_device_gone(old, &last) == TRUE)
+        {
+            old->dead = TRUE;
+            continue;
+        }
+
+        obj = shaping_objfind(want, want_len, old->device, old->qdisc, old->major, old->minor);
+        parent = shaping_objfind_parent(loaded, shape_loaded_len, old);
+
+        if (obj == NULL ||
+            obj->parent_major != old->parent_major ||
+            obj->parent_minor != old->parent_minor ||
+            (parent != NULL && parent->dead == TRUE))
+        {
+            old->dead = TRUE;
+        }
+        /* htb doesn't support changing the root qdisc in place */
+        else if (old->parent_major == 0 &&
+                 strcmp(old->params, obj->params) != 0)
+        {
+            old->dead = TRUE;
+        }
+        /* the kernel can't change the kind of a qdisc (e.g. sfq to
+         * fq_codel) under the same handle */
+        else if (old->qdisc == TRUE &&
+                 shaping_objkind_changed(old, obj) == TRUE)
+        {
+            old->dead = TRUE;
+        }
+    }
+
+    /* 1. roots */
+    for(i = 0; i < shape_loaded_len; i++)
+    {
+        old = &shape_loaded[i];
+
+        if(old->dead == TRUE && old->parent_major == 0 && old->gone == FALSE)
+        {
+            if(shaping_batch_write(fd, old, "del") < 0)
+                goto error;
+            lines++;
+        }
+    }
+
+    /* 2. leafs and classes, in reverse creation order */
+    for(i = shape_loaded_len; i > 0; i--)
+    {
+        old = &shape_loaded[i - 1];
+
+        if(old->dead == FALSE || old->parent_major == 0)
+            continue;
+
+        /* a leaf qdisc goes with its class, a class with its root */
+        if(old->qdisc == TRUE)
+            parent = shaping_objfind_parent(loaded, shape_loaded_len, old);
+        else
+            parent = shaping_objfind(loaded, shape_loaded_len, old->device, TRUE, old->major, 0);
+
+        if(parent != NULL && parent->dead == TRUE)
+            continue;
+        if(old->gone == TRUE)
+            continue;
+
+        if(shaping_batch_write(fd, old, "del") < 0)
+            goto error;
+        lines++;
+    }
+
+    /* 3. new and changed objects, in creation order */
+    for(d_node = ruleset->tc_rules.top; d_node; d_node = d_node->next)
+    {
+        obj = d_node->data;
+
+        old = shaping_objfind(loaded, shape_loaded_len, obj->device, obj->qdisc, obj->major, obj->minor);
+        if(old != NULL && old->dead == FALSE && strcmp(old->params, obj->params) == 0)
+            continue;
+
+        if(shaping_batch_write(fd, obj, "replace") < 0)
+            goto error;
+        lines++;
+    }
+
+    (void)vrprint.debug(__FUNC__, "%d tc commands for %u objects", lines, want_len);
+
+    free(want);
+    free(loaded);
+    return(lines);
+
+error:
+    free(want);
+    free(loaded);
+    return(-1);
+}
+
+/*  shaping_batch_loaded
+
+    Called after the batch of shaping_write_batch was loaded. If that
+    succeeded, the tree of the ruleset is what is loaded now. Otherwise we
+    don't know what state the tree is in, so the next load starts from
+    scratch.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int
+shaping_batch_loaded(const int debuglvl, RuleSet *ruleset, char success)
+{
+    d_list_node     *d_node = NULL;
+    ShapeObject     *tree = NULL;
+    unsigned int    len = 0;
+
+    if(ruleset == NULL)
+    {
+        (void)vrprint.error(-1, "Internal Error", "parameter problem "
+                "(in: %s:%d).", __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    free(shape_loaded);
+    shape_loaded = NULL;
+    shape_loaded_len = 0;
+    shape_loaded_valid = FALSE;
+
+    if(success == FALSE)
+        return(0);
+
+    if(ruleset->tc_rules.len > 0)
+    {
+        tree = calloc(ruleset->tc_rules.len, sizeof(ShapeObject));
+        if(tree == NULL)
+        {
+            (void)vrprint.error(-1, "Error", "calloc failed: %s "
+                "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+
+        for(d_node = ruleset->tc_rules.top; d_node; d_node = d_node->next)
+        {
+            memcpy(&tree[len], d_node->data, sizeof(ShapeObject));
+
+            /* remember which device we loaded it on */
+            if(len > 0 && strcmp(tree[len - 1].device, tree[len].device) == 0)
+                tree[len].ifindex = tree[len - 1].ifindex;
+            else
+                tree[len].ifindex = if_nametoindex(tree[len].device);
+            len++;
+        }
+    }
+
+    shape_loaded = tree;
+    shape_loaded_len = len;
+    shape_loaded_valid = TRUE;
+    return(0);
 }
 
 static int
 shaping_setup_interface_classes (const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, InterfaceData *iface_ptr, /*@null@*/RuleSet *ruleset) {
     d_list_node     *d_node = NULL;
     InterfaceData   *inner_iface_ptr = NULL;
-    char            cmd[MAX_PIPE_COMMAND] = "";
+    ShapeObject     obj;
+    char            params[sizeof(obj.params)] = "";
     u_int32_t       rate = 0;
     u_int32_t       iface_rate = 0;
 
@@ -267,13 +698,11 @@ shaping_setup_interface_classes (const int debuglvl, struct vuurmuur_config *cnf
     iface_rate = shaping_convert_rate(debuglvl, iface_ptr->bw_out, iface_ptr->bw_out_unit);
 
     /* tc class add dev ppp0 parent 1: classid 1:1 htb rate 512kbit */
-    snprintf(cmd, sizeof(cmd), "%s class add dev %s parent %u: classid %u:1 htb rate %ukbit",
-        cnf->tc_location, iface_ptr->device, iface_ptr->shape_handle,
-        iface_ptr->shape_handle, iface_rate);
-
-    (void)vrprint.debug(__FUNC__, "cmd \"%s\"", cmd);
+    snprintf(params, sizeof(params), "htb rate %ukbit", iface_rate);
+    shaping_objset(&obj, iface_ptr->device, FALSE, iface_ptr->shape_handle, 1,
+        iface_ptr->shape_handle, 0, params);
 
-    if (shaping_process_rule(debuglvl, cnf, ruleset, cmd) < 0)
+    if (shaping_process_rule(debuglvl, cnf, ruleset, &obj) < 0)
         return(-1);
 
     /* create classes for the other interfaces */
@@ -287,14 +716,12 @@ shaping_setup_interface_classes (const int debuglvl, struct vuurmuur_config *cnf
             if (iface_rate < rate)
                 rate = iface_rate;
 
-            /* tc class add dev ppp0 parent 1: classid 1:1 htb rate 512kbit */
-            snprintf(cmd, sizeof(cmd), "%s class add dev %s parent %u: classid %u:%u htb rate %ukbit",
-                cnf->tc_location, iface_ptr->device, iface_ptr->shape_handle,
-                iface_ptr->shape_handle, inner_iface_ptr->shape_handle, rate);
+            /* tc class add dev ppp0 parent 1: classid 1:2 htb rate 512kbit */
+            snprintf(params, sizeof(params), "htb rate %ukbit", rate);
+            shaping_objset(&obj, iface_ptr->device, FALSE, iface_ptr->shape_handle,
+                inner_iface_ptr->shape_handle, iface_ptr->shape_handle, 0, params);
 
-            (void)vrprint.debug(__FUNC__, "cmd \"%s\"", cmd);
-
-            if (shaping_process_rule(debuglvl, cnf, ruleset, cmd) < 0)
+            if (shaping_process_rule(debuglvl, cnf, ruleset, &obj) < 0)
                 return(-1);
         }
     }
@@ -306,7 +733,8 @@ int
 shaping_setup_roots (const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, /*@null@*/RuleSet *ruleset) {
     d_list_node     *d_node = NULL;
     InterfaceData   *iface_ptr = NULL;
-    char            cmd[MAX_PIPE_COMMAND] = "";
+    ShapeObject     obj;
+    char            params[sizeof(obj.params)] = "";
     u_int16_t       handle = 2; /* start at 2 so the parents can be parent:current */
 
     /* if have no tc, no shaping is possible */
@@ -333,12 +761,16 @@ shaping_setup_roots (const int debuglvl, struct vuurmuur_config *cnf, Interfaces
 
         if (libvuurmuur_is_shape_interface(debuglvl, iface_ptr) == 1)
         {
-            snprintf(cmd, sizeof(cmd), "%s qdisc add dev %s root handle %u: htb default %u",
-                cnf->tc_location, iface_ptr->device, iface_ptr->shape_handle, handle);
-
-            (void)vrprint.debug(__FUNC__, "cmd \"%s\"", cmd);
-
-            if (shaping_process_rule(debuglvl, cnf, ruleset, cmd) < 0)
+            /* tc qdisc add dev ppp0 root handle 1: htb default 4
+             *
+             * With offload the nic runs the htb tree on its own queues,
+             * so it is not limited by the single qdisc lock of the root. */
+            snprintf(params, sizeof(params), "htb %sdefault %u",
+                iface_ptr->shape_offload ? "offload " : "", handle);
+            shaping_objset(&obj, iface_ptr->device, TRUE, iface_ptr->shape_handle, 0,
+                0, 0, params);
+
+            if (shaping_process_rule(debuglvl, cnf, ruleset, &obj) < 0)
                 return(-1);
 
             handle++;
@@ -351,6 +783,25 @@ shaping_setup_roots (const int debuglvl, struct vuurmuur_config *cnf, Interfaces
     return (0);
 }
 
+/* the leaf qdisc of a class: the one of the rule if it sets one, otherwise
+ * the one of the interface or the global default. */
+static void
+shaping_leaf_params(struct vuurmuur_config *cnf, InterfaceData *iface_ptr,
+        /*@null@*/const char *leaf, char *params, size_t size)
+{
+    if (leaf == NULL || leaf[0] == '\0')
+        leaf = iface_ptr->shape_leaf;
+    if (leaf[0] == '\0')
+        leaf = cnf->shape_leaf;
+    if (leaf[0] == '\0')
+        leaf = DEFAULT_SHAPE_LEAF;
+
+    if (strcmp(leaf, "sfq") == 0)
+        (void)strlcpy(params, "sfq perturb 10", size);
+    else
+        (void)strlcpy(params, leaf, size);
+}
+
 /* add a rate to the iface. If the rate is 0 use the default rate */
 int
 shaping_add_rate_to_iface(const int debuglvl, InterfaceData *iface_ptr, u_int32_t rate, char *unit) {
@@ -492,7 +943,8 @@ int
 shaping_create_default_rules(const int debuglvl, struct vuurmuur_config *cnf, Interfaces *interfaces, /*@null@*/RuleSet *ruleset) {
     d_list_node     *d_node = NULL;
     InterfaceData   *iface_ptr = NULL;
-    char            cmd[MAX_PIPE_COMMAND] = "";
+    ShapeObject     obj;
+    char            params[sizeof(obj.params)] = "";
     u_int16_t       handle = 0;
     u_int32_t       rate = 0;
 
@@ -506,23 +958,20 @@ shaping_create_default_rules(const int debuglvl, struct vuurmuur_config *cnf, In
             rate = shaping_convert_rate(debuglvl, iface_ptr->bw_out, iface_ptr->bw_out_unit);
 
             /* tc class add dev ppp0 parent 1:1 classid 1:100 htb rate 15kbit ceil 512kbit prio 3
-             * tc qdisc add dev ppp0 parent 1:100 handle 100: sfq perturb 10 */
-            snprintf(cmd, sizeof(cmd), "%s class add dev %s parent %u:1 classid %u:%u htb rate %ukbit ceil %ukbit prio 3", /* TODO prio should configurable */
-                cnf->tc_location, iface_ptr->device, iface_ptr->shape_handle,
-                iface_ptr->shape_handle, handle, iface_ptr->shape_default_rate,
-                rate);
-
-            (void)vrprint.debug(__FUNC__, "cmd \"%s\"", cmd);
+             * tc qdisc add dev ppp0 parent 1:100 handle 100: fq_codel */
+            snprintf(params, sizeof(params), "htb rate %ukbit ceil %ukbit prio 3", /* TODO prio should configurable */
+                iface_ptr->shape_default_rate, rate);
+            shaping_objset(&obj, iface_ptr->device, FALSE, iface_ptr->shape_handle, handle,
+                iface_ptr->shape_handle, 1, params);
 
-            if (shaping_process_rule(debuglvl, cnf, ruleset, cmd) < 0)
+            if (shaping_process_rule(debuglvl, cnf, ruleset, &obj) < 0)
                 return(-1);
         
-            snprintf(cmd, sizeof(cmd), "%s qdisc add dev %s parent %u:%u handle %u: sfq perturb 10",
-                cnf->tc_location, iface_ptr->device, iface_ptr->shape_handle, handle, handle);
-
-            (void)vrprint.debug(__FUNC__, "cmd \"%s\"", cmd);
+            shaping_leaf_params(cnf, iface_ptr, NULL, params, sizeof(params));
+            shaping_objset(&obj, iface_ptr->device, TRUE, handle, 0,
+                iface_ptr->shape_handle, handle, params);
 
-            if (shaping_process_rule(debuglvl, cnf, ruleset, cmd) < 0)
+            if (shaping_process_rule(debuglvl, cnf, ruleset, &obj) < 0)
                 return(-1);
 
             handle++;
@@ -539,9 +988,9 @@ shaping_shape_create_rule(const int debuglvl, struct vuurmuur_config *cnf,
     Interfaces *interfaces, struct RuleCreateData_ *rule, /*@null@*/RuleSet *ruleset,
     InterfaceData *shape_iface_ptr, InterfaceData *class_iface_ptr,
     u_int16_t class, u_int32_t rate, char *rate_unit, u_int32_t ceil,
-    char *ceil_unit, u_int8_t prio)
+    char *ceil_unit, u_int8_t prio, char *leaf)
 {
-    char        cmd[MAX_PIPE_COMMAND] = "";
+    char        params[128] = "";
     u_int16_t   class_handle = 1;
 
     if (strcmp(cnf->tc_location,"") == 0)
@@ -576,27 +1025,23 @@ shaping_shape_create_rule(const int debuglvl, struct vuurmuur_config *cnf,
         class_handle = 1;
 
     /* tc class add dev eth0 parent 3:3 classid 3:160 htb rate 5mbit ceil 10mbit prio 1
-     * tc qdisc add dev eth0 parent 3:160 handle 127: sfq perturb 10
+     * tc qdisc add dev eth0 parent 3:160 handle 127: fq_codel
      */
-    snprintf(cmd, sizeof(cmd), "%s class add dev %s parent %u:%u classid %u:%u htb rate %ukbit ceil %ukbit prio %u",
-        cnf->tc_location, shape_iface_ptr->device, shape_iface_ptr->shape_handle,
-        class_handle, shape_iface_ptr->shape_handle,
-        class, rate, ceil, prio);
+    snprintf(params, sizeof(params), "htb rate %ukbit ceil %ukbit prio %u",
+        rate, ceil, prio);
 
-    (void)vrprint.debug(__FUNC__, "cmd %s", cmd);
+    (void)vrprint.debug(__FUNC__, "class %u:%u params %s",
+        shape_iface_ptr->shape_handle, class, params);
 
-    if (shaping_queue_rule(debuglvl, rule, ruleset, shape_iface_ptr->shape_handle,
-            class, shape_iface_ptr->device, cmd) < 0)
+    if (shaping_queue_rule(debuglvl, rule, shape_iface_ptr->device, FALSE,
+            shape_iface_ptr->shape_handle, class, shape_iface_ptr->shape_handle,
+            class_handle, params) < 0)
         return(-1);
 
-    snprintf(cmd, sizeof(cmd), "%s qdisc add dev %s parent %u:%u handle %u: sfq perturb 10",
-        cnf->tc_location, shape_iface_ptr->device, shape_iface_ptr->shape_handle,
-        class, class);
-
-    (void)vrprint.debug(__FUNC__, "cmd %s", cmd);
+    shaping_leaf_params(cnf, shape_iface_ptr, leaf, params, sizeof(params));
 
-    if (shaping_queue_rule(debuglvl, rule, ruleset, class, 0,
-            shape_iface_ptr->device, cmd) < 0)
+    if (shaping_queue_rule(debuglvl, rule, shape_iface_ptr->device, TRUE,
+            class, 0, shape_iface_ptr->shape_handle, class, params) < 0)
         return(-1);
 
     return(0);
@@ -64,7 +64,8 @@ main(int argc, char *argv[])
     pid_t           pid;
 
     char            reload_shm = FALSE,
-                    reload_dyn = FALSE;
+                    reload_dyn = FALSE,
+                    reload_ctl = FALSE;
 
     /* clear vuurmur/all the iptables rules? */
     char            clear_vuurmuur_rules = FALSE;
@@ -76,6 +77,7 @@ main(int argc, char *argv[])
                     debuglvl = 0;
 
     unsigned int    dynamic_wait_time = 0;  /* for checking the dynamic ipaddresses */
+    time_t          accounting_time = 0;    /* last sample of the traffic volume */
     unsigned int    wait_time = 0;          /* time in seconds we have waited for an VR_RR_RESULT_ACK when using SHM-IPC */
     static char optstring[] = "hd:bVlvnc:L:CFDtkfK";
     struct option prog_opts[] =
@@ -340,7 +342,14 @@ main(int argc, char *argv[])
     cmdline_override_config(debuglvl);
 
     /* dont check in bash mode */
-    if(conf.bash_out == FALSE)
+    if(conf.bash_out == FALSE && conf.use_nftables == TRUE)
+    {
+        if(!check_nft_command(debuglvl, &conf, conf.nft_location, IPTCHK_VERBOSE))
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if(conf.bash_out == FALSE)
     {
         /* check the iptables command */
         if(!check_iptables_command(debuglvl, &conf, conf.iptables_location, IPTCHK_VERBOSE))
@@ -375,6 +384,17 @@ main(int argc, char *argv[])
     create_logtcpoptions_string(debuglvl, &conf, log_tcp_options, sizeof(log_tcp_options));
 
     /* after the config we can remove the rules if we need to */
+    if (clear_vuurmuur_rules == TRUE && conf.use_nftables == TRUE)
+    {
+        if (nftables_clear_ruleset(debuglvl, &conf) < 0)
+        {
+            fprintf(stdout, "Error: clearing vuumuur nftables rules failed.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        exit(EXIT_SUCCESS);
+    }
+
     if (clear_vuurmuur_rules == TRUE)
     {
         if (clear_vuurmuur_iptables_rules(debuglvl,&conf) < 0)
@@ -397,8 +417,8 @@ main(int argc, char *argv[])
         exit(EXIT_SUCCESS);
     }
 
-    /* check capabilities */
-    if(conf.check_iptcaps == TRUE)
+    /* check capabilities, nftables doesn't need them */
+    if(conf.check_iptcaps == TRUE && conf.use_nftables == FALSE)
     {
         if(check_iptcaps(debuglvl, &conf, &iptcap, conf.load_modules) < 0)
         {
@@ -502,7 +522,16 @@ main(int argc, char *argv[])
         rules_print_list(&rules);
 
     /* now create the rules */
-    if(conf.old_rulecreation_method == TRUE || conf.bash_out == TRUE)
+    if(conf.use_nftables == TRUE && conf.bash_out == TRUE)
+    {
+        /* print the nft ruleset, it can be loaded with 'nft -f' */
+        if(nftables_create_ruleset(debuglvl, &vctx, stdout) != 0)
+        {
+            (void)vrprint.error(-1, "Error", "creating rules failed.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if(conf.old_rulecreation_method == TRUE || conf.bash_out == TRUE)
     {
         /* call with create_prerules == 1 */
         if(create_all_rules(debuglvl, &vctx, 1) != 0)
@@ -634,6 +663,19 @@ main(int argc, char *argv[])
                 exit(EXIT_FAILURE);
             }
 
+            /* let the other tools use what we just loaded */
+            if(snapshot_write(debuglvl) < 0)
+                (void)vrprint.warning("Warning", "writing the backend snapshot failed.");
+
+            /* requests from the other tools, next to the shm */
+            if(control_server_setup(debuglvl) < 0)
+                (void)vrprint.warning("Warning", "no control channel, only the shared memory can be used.");
+
+            /* get told about changes of the dynamic interfaces */
+            if(conf.dynamic_changes_check == TRUE && ifwatch_setup(debuglvl) < 0)
+                (void)vrprint.warning("Warning", "can't watch the interfaces, checking them every %u seconds.",
+                        conf.dynamic_changes_interval);
+
             (void)vrprint.info("Info", "Entering the loop... (interval %d seconds)", LOOP_INT);
 
             while(retval == 0 &&
@@ -667,9 +709,11 @@ main(int argc, char *argv[])
                 }
 
                 /*  if we have one or more dynamic interfaces
-                    we check if there we're changes.
+                    we check if there we're changes. Only needed
+                    if we don't get the events from the kernel.
                 */
-                if(conf.dynamic_changes_check == TRUE && interfaces.dynamic_interfaces == TRUE)
+                if(conf.dynamic_changes_check == TRUE && interfaces.dynamic_interfaces == TRUE &&
+                    ifwatch_fd() < 0)
                 {
                     dynamic_wait_time++;
 
@@ -687,17 +731,38 @@ main(int argc, char *argv[])
                     }
                 }
 
+                /* add the counters to the traffic volume store */
+                if(time(NULL) - accounting_time >= ACCOUNTING_INTERVAL)
+                {
+                    accounting_time = time(NULL);
+
+                    if(accounting_sample(debuglvl, &interfaces) < 0)
+                        (void)vrprint.error(-1, "Error", "sampling the traffic volume failed.");
+                }
+
                 /*  well, we either recieved a SIGHUP or we want to reload trough an IPC command, or we
                     have an interface with a changed ip.
                 */
-                if(sighup_count > 0 || reload_shm == TRUE || reload_dyn == TRUE)
+                if(sighup_count > 0 || reload_shm == TRUE || reload_dyn == TRUE || reload_ctl == TRUE)
                 {
-                    /* apply changes */
-                    result = apply_changes(debuglvl, &vctx, &reg);
+                    /* apply changes. If only the dynamic interfaces changed the
+                       backends don't need to be reloaded. */
+                    if(reload_dyn == TRUE && sighup_count == 0 && reload_shm == FALSE && reload_ctl == FALSE)
+                        result = apply_changes_dynamic(debuglvl, &vctx);
+                    else
+                        result = apply_changes(debuglvl, &vctx, &reg);
                     if(result < 0)
                     {
                         (void)vrprint.error(-1, "Error", "applying changes failed.");
                     }
+                    else if(snapshot_write(debuglvl) < 0)
+                    {
+                        (void)vrprint.warning("Warning", "writing the backend snapshot failed.");
+                    }
+
+                    /* the control channel clients get the result right away */
+                    control_server_result(debuglvl, result < 0 ? VR_RR_ERROR :
+                            (result == 0 ? VR_RR_SUCCES : VR_RR_NOCHANGES));
 
                     /* if we are reloading because of an IPC command, we need to communicate with the caller */
                     if(reload_shm == TRUE)
@@ -776,11 +841,32 @@ main(int argc, char *argv[])
                     sighup_count = 0;
                     reload_shm = FALSE;
                     reload_dyn = FALSE;
+                    reload_ctl = FALSE;
                 }
 
-                sleep(LOOP_INT);
+                /* sleep, but wake up for requests on the control channel
+                   and for interface events */
+                result = control_server_wait(debuglvl, &vctx, LOOP_INT,
+                        conf.dynamic_changes_check == TRUE ? ifwatch_fd() : -1);
+                if(result == 1)
+                {
+                    reload_ctl = TRUE;
+                }
+                else if(result == 2)
+                {
+                    result = ifwatch_check(debuglvl, &interfaces);
+                    if(result == 1)
+                        reload_dyn = TRUE;
+                    else if(result < 0)
+                        /* back to polling */
+                        ifwatch_cleanup(debuglvl);
+                }
             }
 
+            ifwatch_cleanup(debuglvl);
+            control_server_cleanup(debuglvl);
+            accounting_cleanup(debuglvl);
+
             if (sigint_count || sigterm_count)
                 (void)vrprint.debug(__FUNC__, "killed by INT or TERM");
 
@@ -803,6 +889,9 @@ main(int argc, char *argv[])
                 retval = -1;
             }
 
+            /* without us the snapshot is not kept up to date */
+            (void)unlink(SNAPSHOT_LOCATION);
+
             /* remove the pidfile */
             if(remove_pidfile(PIDFILE) < 0)
             {
@@ -861,7 +950,7 @@ print_help(void)
     fprintf(stdout, "Usage: vuurmuur [OPTION]\n");
     fprintf(stdout, "\n");
     fprintf(stdout, "Options:\n");
-    fprintf(stdout, "-b, --bash\t\tgives a bashscript output\n");
+    fprintf(stdout, "-b, --bash\t\tgives a bashscript output (an nft script when NFTABLES is enabled)\n");
     fprintf(stdout, "-d, --debug\t\tenables debugging (1 low, 3 high)\n");
     fprintf(stdout, "-c, --configfile\tuse the given configfile\n");
     fprintf(stdout, "-h, --help\t\tgives this help\n");
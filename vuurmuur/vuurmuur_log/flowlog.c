@@ -0,0 +1,766 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_compat.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+
+#include "vuurmuur_log.h"
+#include "flowlog.h"
+
+/*
+    Flow history
+
+    With FLOW_HISTORY we listen to the kernel for connections that end
+    (the conntrack DESTROY events) and add a record for each of them to
+    the flow store (see flowstore.c in libvuurmuur): the addresses, the
+    names of the hosts and the service, and what the connection
+    transferred in both directions.
+
+    The counters are only there if conntrack accounting is enabled, the
+    start of the connection only with conntrack timestamps. We try to
+    switch both on.
+*/
+
+/* size of the receive buffer */
+#define FLOWLOG_BUFSIZE     65536
+/* ask the kernel to queue this much for us */
+#define FLOWLOG_RCVBUF      (4 * 1024 * 1024)
+/* max number of reads per call, so the log lines don't have to wait.
+ * If there is more, flowlog_wait() returns right away. */
+#define FLOWLOG_MAX_READS   64
+/* seconds between warnings about lost events */
+#define FLOWLOG_LOST_WARN   300
+/* seconds between removing old days */
+#define FLOWLOG_EXPIRE      3600
+
+#ifndef NF_NETLINK_CONNTRACK_DESTROY
+#define NF_NETLINK_CONNTRACK_DESTROY    0x00000004
+#endif
+
+/* a network, to name the addresses that are not a host */
+struct FlowLogNet_
+{
+    uint32_t        network;
+    uint32_t        netmask;
+    char            name[MAX_HOST_NET_ZONE];
+};
+
+static int                  flow_sock = -1;
+static char                 *flow_buf = NULL;
+static FlowStore            flow_store;
+static unsigned int         flow_days = 0;
+static time_t               flow_last_end = 0;
+static time_t               flow_next_expire = 0;
+
+static struct FlowLogNet_   *flow_nets = NULL;
+static unsigned int         flow_nets_n = 0;
+
+/* events the kernel had to drop because we were too slow */
+static unsigned long        flow_lost = 0;
+static time_t               flow_lost_warned = 0;
+
+/* a connection from an event */
+struct FlowLogConn_
+{
+    int                 family;
+    int                 protocol;
+    int                 src_port;
+    int                 dst_port;
+    int                 icmp_type;
+    int                 icmp_code;
+    char                src_ip[46];
+    char                dst_ip[46];
+    /* the source of the reply: the real destination when it was DNAT'd */
+    char                reply_ip[46];
+
+    unsigned long long  packets[2];
+    unsigned long long  bytes[2];
+    unsigned long long  start;          /* ns, 0: unknown */
+    unsigned long long  stop;
+};
+
+
+/* walk the attributes in 'buf' */
+#define FLOWLOG_ATTR_OK(nla, len) \
+    ((len) >= (int)sizeof(struct nlattr) && \
+     (nla)->nla_len >= sizeof(struct nlattr) && \
+     (int)(nla)->nla_len <= (len))
+#define FLOWLOG_ATTR_NEXT(nla, len) \
+    ((len) -= NLA_ALIGN((nla)->nla_len), \
+     (struct nlattr *)((char *)(nla) + NLA_ALIGN((nla)->nla_len)))
+#define FLOWLOG_ATTR_DATA(nla)  ((void *)((char *)(nla) + NLA_HDRLEN))
+#define FLOWLOG_ATTR_LEN(nla)   ((int)(nla)->nla_len - NLA_HDRLEN)
+#define FLOWLOG_ATTR_TYPE(nla)  ((nla)->nla_type & NLA_TYPE_MASK)
+
+
+static unsigned long long
+flowlog_be64(struct nlattr *nla)
+{
+    uint32_t    part[2];
+
+    if(FLOWLOG_ATTR_LEN(nla) == 4)
+    {
+        memcpy(part, FLOWLOG_ATTR_DATA(nla), 4);
+        return((unsigned long long)ntohl(part[0]));
+    }
+    if(FLOWLOG_ATTR_LEN(nla) < 8)
+        return(0);
+
+    memcpy(part, FLOWLOG_ATTR_DATA(nla), 8);
+    return(((unsigned long long)ntohl(part[0]) << 32) | ntohl(part[1]));
+}
+
+
+/*  flowlog_parse_tuple
+
+    Gets the addresses, the protocol and the ports from a CTA_TUPLE_ORIG
+    or CTA_TUPLE_REPLY attribute. For the reply only the source is used.
+*/
+static void
+flowlog_parse_tuple(struct nlattr *tuple, struct FlowLogConn_ *conn, char reply)
+{
+    struct nlattr   *nla = FLOWLOG_ATTR_DATA(tuple),
+                    *sub = NULL;
+    int             len = FLOWLOG_ATTR_LEN(tuple),
+                    sublen = 0;
+    uint16_t        port = 0;
+
+    for(; FLOWLOG_ATTR_OK(nla, len); nla = FLOWLOG_ATTR_NEXT(nla, len))
+    {
+        sub = FLOWLOG_ATTR_DATA(nla);
+        sublen = FLOWLOG_ATTR_LEN(nla);
+
+        if(FLOWLOG_ATTR_TYPE(nla) == CTA_TUPLE_IP)
+        {
+            for(; FLOWLOG_ATTR_OK(sub, sublen); sub = FLOWLOG_ATTR_NEXT(sub, sublen))
+            {
+                switch(FLOWLOG_ATTR_TYPE(sub))
+                {
+                    case CTA_IP_V4_SRC:
+                    case CTA_IP_V6_SRC:
+                        (void)inet_ntop(conn->family, FLOWLOG_ATTR_DATA(sub),
+                                reply ? conn->reply_ip : conn->src_ip,
+                                sizeof(conn->src_ip));
+                        break;
+                    case CTA_IP_V4_DST:
+                    case CTA_IP_V6_DST:
+                        if(!reply)
+                            (void)inet_ntop(conn->family, FLOWLOG_ATTR_DATA(sub),
+                                    conn->dst_ip, sizeof(conn->dst_ip));
+                        break;
+                }
+            }
+        }
+        else if(FLOWLOG_ATTR_TYPE(nla) == CTA_TUPLE_PROTO && !reply)
+        {
+            for(; FLOWLOG_ATTR_OK(sub, sublen); sub = FLOWLOG_ATTR_NEXT(sub, sublen))
+            {
+                switch(FLOWLOG_ATTR_TYPE(sub))
+                {
+                    case CTA_PROTO_NUM:
+                        conn->protocol = *(uint8_t *)FLOWLOG_ATTR_DATA(sub);
+                        break;
+                    case CTA_PROTO_SRC_PORT:
+                        memcpy(&port, FLOWLOG_ATTR_DATA(sub), sizeof(port));
+                        conn->src_port = ntohs(port);
+                        break;
+                    case CTA_PROTO_DST_PORT:
+                        memcpy(&port, FLOWLOG_ATTR_DATA(sub), sizeof(port));
+                        conn->dst_port = ntohs(port);
+                        break;
+                    case CTA_PROTO_ICMP_TYPE:
+                    case CTA_PROTO_ICMPV6_TYPE:
+                        conn->icmp_type = *(uint8_t *)FLOWLOG_ATTR_DATA(sub);
+                        break;
+                    case CTA_PROTO_ICMP_CODE:
+                    case CTA_PROTO_ICMPV6_CODE:
+                        conn->icmp_code = *(uint8_t *)FLOWLOG_ATTR_DATA(sub);
+                        break;
+                }
+            }
+        }
+    }
+}
+
+
+/* the packets and bytes of one direction */
+static void
+flowlog_parse_counters(struct nlattr *counters, struct FlowLogConn_ *conn, int dir)
+{
+    struct nlattr   *nla = FLOWLOG_ATTR_DATA(counters);
+    int             len = FLOWLOG_ATTR_LEN(counters);
+
+    for(; FLOWLOG_ATTR_OK(nla, len); nla = FLOWLOG_ATTR_NEXT(nla, len))
+    {
+        switch(FLOWLOG_ATTR_TYPE(nla))
+        {
+            case CTA_COUNTERS_PACKETS:
+            case CTA_COUNTERS32_PACKETS:
+                conn->packets[dir] = flowlog_be64(nla);
+                break;
+            case CTA_COUNTERS_BYTES:
+            case CTA_COUNTERS32_BYTES:
+                conn->bytes[dir] = flowlog_be64(nla);
+                break;
+        }
+    }
+}
+
+
+static void
+flowlog_parse_timestamp(struct nlattr *timestamp, struct FlowLogConn_ *conn)
+{
+    struct nlattr   *nla = FLOWLOG_ATTR_DATA(timestamp);
+    int             len = FLOWLOG_ATTR_LEN(timestamp);
+
+    for(; FLOWLOG_ATTR_OK(nla, len); nla = FLOWLOG_ATTR_NEXT(nla, len))
+    {
+        switch(FLOWLOG_ATTR_TYPE(nla))
+        {
+            case CTA_TIMESTAMP_START:
+                conn->start = flowlog_be64(nla);
+                break;
+            case CTA_TIMESTAMP_STOP:
+                conn->stop = flowlog_be64(nla);
+                break;
+        }
+    }
+}
+
+
+/*  flowlog_network
+
+    The name of the network 'ip' is in, with the longest netmask.
+    NULL if it's not in one of our networks.
+*/
+static const char *
+flowlog_network(const char *ip)
+{
+    struct in_addr  addr;
+    uint32_t        a = 0,
+                    best_mask = 0;
+    const char      *name = NULL;
+    unsigned int    i = 0;
+
+    if(flow_nets_n == 0 || inet_pton(AF_INET, ip, &addr) != 1)
+        return(NULL);
+    a = ntohl(addr.s_addr);
+
+    for(i = 0; i < flow_nets_n; i++)
+    {
+        if((a & flow_nets[i].netmask) == flow_nets[i].network &&
+           (name == NULL || flow_nets[i].netmask > best_mask))
+        {
+            name = flow_nets[i].name;
+            best_mask = flow_nets[i].netmask;
+        }
+    }
+
+    return(name);
+}
+
+
+/*  flowlog_name
+
+    The name for 'ip' as get_vuurmuur_names found it in 'name', or the
+    network it's in. Returns "" if we don't know the address.
+*/
+static const char *
+flowlog_name(const char *name, const char *ip)
+{
+    const char  *net = NULL;
+
+    if(strcmp(name, ip) != 0)
+        return(name);
+
+    if((net = flowlog_network(ip)) != NULL)
+        return(net);
+
+    return("");
+}
+
+
+/*  flowlog_service
+
+    get_vuurmuur_names names an unknown service after both ports. For
+    connections the source port is different every time, so we only
+    use the destination port.
+*/
+static void
+flowlog_service(struct log_rule *logrule_ptr)
+{
+    if(strstr(logrule_ptr->ser_name, "->") == NULL &&
+       strchr(logrule_ptr->ser_name, '*') == NULL)
+        return;
+
+    if(logrule_ptr->protocol == 6)
+        snprintf(logrule_ptr->ser_name, sizeof(logrule_ptr->ser_name), "%d(tcp)", logrule_ptr->dst_port);
+    else if(logrule_ptr->protocol == 17)
+        snprintf(logrule_ptr->ser_name, sizeof(logrule_ptr->ser_name), "%d(udp)", logrule_ptr->dst_port);
+    else
+        snprintf(logrule_ptr->ser_name, sizeof(logrule_ptr->ser_name), "%d(%d)", logrule_ptr->dst_port, logrule_ptr->protocol);
+}
+
+
+/*  flowlog_add
+
+    Names the connection and adds it to the store.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+flowlog_add(const int debuglvl, struct FlowLogConn_ *conn, time_t now,
+        Hash *zone_htbl, Hash *service_htbl)
+{
+    struct log_rule logrule;
+    FlowRecord      flow;
+
+    memset(&logrule, 0, sizeof(logrule));
+    memset(&flow, 0, sizeof(flow));
+
+    (void)strlcpy(logrule.src_ip, conn->src_ip, sizeof(logrule.src_ip));
+    (void)strlcpy(logrule.dst_ip, conn->reply_ip[0] ? conn->reply_ip : conn->dst_ip,
+            sizeof(logrule.dst_ip));
+#ifdef IPV6_ENABLED
+    logrule.ipv6 = (conn->family == AF_INET6);
+#endif /* IPV6_ENABLED */
+    logrule.protocol = conn->protocol;
+    logrule.src_port = conn->src_port;
+    logrule.dst_port = conn->dst_port;
+    logrule.icmp_type = conn->icmp_type;
+    logrule.icmp_code = conn->icmp_code;
+
+    if(get_vuurmuur_names(debuglvl, &logrule, zone_htbl, service_htbl) < 0)
+        return(-1);
+    flowlog_service(&logrule);
+
+    /* the records are in the order they ended: a clock that went back
+       doesn't change that */
+    flow.end = (now < flow_last_end) ? flow_last_end : now;
+    flow_last_end = flow.end;
+
+    if(conn->start > 0)
+    {
+        if(conn->stop > conn->start)
+            flow.duration = (unsigned int)((conn->stop - conn->start) / 1000000000ULL);
+        else if((unsigned long long)now > conn->start / 1000000000ULL)
+            flow.duration = (unsigned int)(now - (time_t)(conn->start / 1000000000ULL));
+    }
+
+    flow.ipv = (conn->family == AF_INET6) ? VR_IPV6 : VR_IPV4;
+    flow.protocol = conn->protocol;
+    flow.src_port = conn->src_port;
+    flow.dst_port = conn->dst_port;
+    (void)strlcpy(flow.src_ip, logrule.src_ip, sizeof(flow.src_ip));
+    (void)strlcpy(flow.dst_ip, logrule.dst_ip, sizeof(flow.dst_ip));
+
+    flow.from_name = flowlog_name(logrule.from_name, logrule.src_ip);
+    flow.to_name = flowlog_name(logrule.to_name, logrule.dst_ip);
+    flow.ser_name = logrule.ser_name;
+    if(flow.from_name[0] != '\0')
+        flow.flags |= FLOW_SRC_KNOWN;
+    if(flow.to_name[0] != '\0')
+        flow.flags |= FLOW_DST_KNOWN;
+
+    flow.out_packets = conn->packets[0];
+    flow.out_bytes = conn->bytes[0];
+    flow.in_packets = conn->packets[1];
+    flow.in_bytes = conn->bytes[1];
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "%s -> %s %s: %llu/%llu bytes, %us.",
+                logrule.from_name, logrule.to_name, logrule.ser_name,
+                flow.out_bytes, flow.in_bytes, flow.duration);
+
+    return(flowstore_append(debuglvl, &flow_store, &flow));
+}
+
+
+/*  flowlog_parse
+
+    Gets the connection from a DESTROY event.
+
+    Returncodes:
+         1: ok
+         0: not a connection we keep
+*/
+static int
+flowlog_parse(struct nlmsghdr *nlh, struct FlowLogConn_ *conn)
+{
+    struct nfgenmsg *nfg = NLMSG_DATA(nlh);
+    struct nlattr   *nla = NULL;
+    int             len = 0;
+
+    if(NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_CTNETLINK ||
+       NFNL_MSG_TYPE(nlh->nlmsg_type) != IPCTNL_MSG_CT_DELETE)
+        return(0);
+
+    memset(conn, 0, sizeof(*conn));
+    conn->family = nfg->nfgen_family;
+#ifdef IPV6_ENABLED
+    if(conn->family != AF_INET && conn->family != AF_INET6)
+        return(0);
+#else
+    if(conn->family != AF_INET)
+        return(0);
+#endif /* IPV6_ENABLED */
+
+    nla = (struct nlattr *)((char *)nfg + NLMSG_ALIGN(sizeof(struct nfgenmsg)));
+    len = (int)nlh->nlmsg_len - NLMSG_SPACE(sizeof(struct nfgenmsg));
+
+    for(; FLOWLOG_ATTR_OK(nla, len); nla = FLOWLOG_ATTR_NEXT(nla, len))
+    {
+        switch(FLOWLOG_ATTR_TYPE(nla))
+        {
+            case CTA_TUPLE_ORIG:
+                flowlog_parse_tuple(nla, conn, FALSE);
+                break;
+            case CTA_TUPLE_REPLY:
+                flowlog_parse_tuple(nla, conn, TRUE);
+                break;
+            case CTA_COUNTERS_ORIG:
+                flowlog_parse_counters(nla, conn, 0);
+                break;
+            case CTA_COUNTERS_REPLY:
+                flowlog_parse_counters(nla, conn, 1);
+                break;
+            case CTA_TIMESTAMP:
+                flowlog_parse_timestamp(nla, conn);
+                break;
+        }
+    }
+
+    if(conn->src_ip[0] == '\0' || conn->dst_ip[0] == '\0')
+        return(0);
+
+    return(1);
+}
+
+
+/* switch on a conntrack sysctl, if it's off */
+static void
+flowlog_sysctl(const int debuglvl, const char *path)
+{
+    FILE    *fp = NULL;
+    int     c = 0;
+
+    if(!(fp = fopen(path, "r+")))
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "can't open '%s': %s", path, strerror(errno));
+        return;
+    }
+
+    if((c = fgetc(fp)) == '0')
+    {
+        rewind(fp);
+        if(fputs("1\n", fp) == EOF || fflush(fp) != 0)
+            (void)vrprint.warning(VR_WARN, "enabling '%s' failed: %s.", path, strerror(errno));
+        else
+            (void)vrprint.info(VR_INFO, "enabled '%s' for the flow history.", path);
+    }
+
+    (void)fclose(fp);
+}
+
+
+/* the networks of the zones, for the addresses that are not a host */
+static int
+flowlog_setup_networks(const int debuglvl, Zones *zones)
+{
+    struct ZoneData_    *zone_ptr = NULL;
+    d_list_node         *d_node = NULL;
+    struct in_addr      network,
+                        netmask;
+
+    free(flow_nets);
+    flow_nets = NULL;
+    flow_nets_n = 0;
+
+    if(zones == NULL || zones->list.len == 0)
+        return(0);
+
+    if(!(flow_nets = calloc(zones->list.len, sizeof(struct FlowLogNet_))))
+    {
+        (void)vrprint.error(-1, VR_ERR, "calloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    for(d_node = zones->list.top; d_node; d_node = d_node->next)
+    {
+        zone_ptr = d_node->data;
+
+        if(zone_ptr->type != TYPE_NETWORK || zone_ptr->active == FALSE ||
+           inet_pton(AF_INET, zone_ptr->ipv4.network, &network) != 1 ||
+           inet_pton(AF_INET, zone_ptr->ipv4.netmask, &netmask) != 1)
+            continue;
+
+        flow_nets[flow_nets_n].netmask = ntohl(netmask.s_addr);
+        flow_nets[flow_nets_n].network = ntohl(network.s_addr) & flow_nets[flow_nets_n].netmask;
+        (void)strlcpy(flow_nets[flow_nets_n].name, zone_ptr->name,
+                sizeof(flow_nets[flow_nets_n].name));
+        flow_nets_n++;
+    }
+
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "%u networks.", flow_nets_n);
+
+    return(0);
+}
+
+
+/*  flowlog_open
+
+    Subscribes to the DESTROY events of conntrack and opens the store.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int
+flowlog_open(const int debuglvl)
+{
+    struct sockaddr_nl  addr;
+    int                 size = FLOWLOG_RCVBUF;
+
+    flowlog_sysctl(debuglvl, "/proc/sys/net/netfilter/nf_conntrack_acct");
+    flowlog_sysctl(debuglvl, "/proc/sys/net/netfilter/nf_conntrack_timestamp");
+
+    if((flow_sock = socket(AF_NETLINK, SOCK_RAW, NETLINK_NETFILTER)) == -1)
+    {
+        (void)vrprint.error(-1, VR_ERR, "opening the ctnetlink socket failed: %s "
+                "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    /* SO_RCVBUFFORCE can go over the limit of the system, but only for root */
+    if(setsockopt(flow_sock, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) == -1)
+        (void)setsockopt(flow_sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = NF_NETLINK_CONNTRACK_DESTROY;
+
+    if(bind(flow_sock, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+       fcntl(flow_sock, F_SETFL, O_NONBLOCK) == -1)
+    {
+        (void)vrprint.error(-1, VR_ERR, "subscribing to the conntrack events failed: "
+                "%s (in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+        flowlog_close(debuglvl);
+        return(-1);
+    }
+
+    if(!(flow_buf = malloc(FLOWLOG_BUFSIZE)))
+    {
+        (void)vrprint.error(-1, VR_ERR, "malloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        flowlog_close(debuglvl);
+        return(-1);
+    }
+
+    if(flowstore_open(debuglvl, &flow_store, FLOWSTORE_LOCATION) < 0)
+    {
+        flowlog_close(debuglvl);
+        return(-1);
+    }
+
+    flow_next_expire = 0;
+    flow_lost = 0;
+    flow_lost_warned = 0;
+
+    (void)vrprint.info(VR_INFO, "keeping the flow history in '%s'.", FLOWSTORE_LOCATION);
+    return(0);
+}
+
+
+/*  flowlog_setup
+
+    Starts or stops the flow history as the config says. To be called
+    at start up and after every reload, as the networks may have
+    changed.
+
+    Returncodes:
+         0: ok
+        -1: error, no flow history
+*/
+int
+flowlog_setup(const int debuglvl, const struct vuurmuur_config *cnf, Zones *zones)
+{
+    /* safety */
+    if(cnf == NULL)
+    {
+        (void)vrprint.error(-1, VR_INTERR, "parameter problem (in: %s:%d).",
+                __FUNC__, __LINE__);
+        return(-1);
+    }
+
+    if(cnf->flow_history == FALSE)
+    {
+        flowlog_close(debuglvl);
+        return(0);
+    }
+
+    flow_days = cnf->flow_history_days;
+    flow_next_expire = 0;
+
+    if(flowlog_setup_networks(debuglvl, zones) < 0)
+        return(-1);
+
+    if(flow_sock == -1 && flowlog_open(debuglvl) < 0)
+        return(-1);
+
+    return(0);
+}
+
+
+/*  flowlog_read
+
+    Adds the connections that ended since the last call to the store.
+    Doesn't wait for them.
+
+    Returncodes:
+        >0: connections added
+         0: nothing to do
+        -1: error
+*/
+int
+flowlog_read(const int debuglvl, Hash *zone_htbl, Hash *service_htbl)
+{
+    struct FlowLogConn_ conn;
+    struct nlmsghdr     *nlh = NULL;
+    ssize_t             result = 0;
+    time_t              now = 0;
+    int                 reads = 0,
+                        added = 0;
+
+    if(flow_sock == -1)
+        return(0);
+
+    now = time(NULL);
+
+    for(reads = 0; reads < FLOWLOG_MAX_READS; reads++)
+    {
+        if((result = recv(flow_sock, flow_buf, FLOWLOG_BUFSIZE, 0)) < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if(errno == ENOBUFS)
+            {
+                /* the kernel dropped events, but the socket is fine */
+                flow_lost++;
+                continue;
+            }
+
+            (void)vrprint.error(-1, VR_ERR, "reading the conntrack events failed: %s "
+                    "(in: %s:%d).", strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+
+        for(nlh = (struct nlmsghdr *)flow_buf; NLMSG_OK(nlh, (unsigned int)result);
+                nlh = NLMSG_NEXT(nlh, result))
+        {
+            if(flowlog_parse(nlh, &conn) == 0)
+                continue;
+
+            if(flowlog_add(debuglvl, &conn, now, zone_htbl, service_htbl) < 0)
+                return(-1);
+            added++;
+        }
+    }
+
+    if(added > 0 && flowstore_flush(debuglvl, &flow_store) < 0)
+        return(-1);
+
+    if(flow_lost > 0 && now - flow_lost_warned >= FLOWLOG_LOST_WARN)
+    {
+        (void)vrprint.warning(VR_WARN, "the kernel dropped conntrack events %lu times: "
+                "connections are missing from the flow history.", flow_lost);
+        flow_lost_warned = now;
+    }
+
+    if(now >= flow_next_expire)
+    {
+        (void)flowstore_expire(debuglvl, FLOWSTORE_LOCATION, flow_days, now);
+        flow_next_expire = now + FLOWLOG_EXPIRE;
+    }
+
+    return(added);
+}
+
+
+/*  flowlog_wait
+
+    Replaces the sleep of the main loop when there are no log lines:
+    waits at most 'msec' milliseconds, but returns as soon as there are
+    conntrack events to read. Otherwise a busy firewall produces more
+    events than we read and the kernel drops them.
+*/
+void
+flowlog_wait(const int debuglvl, int msec)
+{
+    struct pollfd   pfd;
+
+    if(flow_sock == -1)
+    {
+        (void)usleep((useconds_t)msec * 1000);
+        return;
+    }
+
+    pfd.fd = flow_sock;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if(poll(&pfd, 1, msec) < 0 && errno != EINTR && debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "poll failed: %s.", strerror(errno));
+}
+
+
+/*  flowlog_close
+
+    Stops the flow history.
+*/
+void
+flowlog_close(const int debuglvl)
+{
+    if(flow_sock != -1)
+        (void)close(flow_sock);
+    flow_sock = -1;
+
+    free(flow_buf);
+    flow_buf = NULL;
+
+    free(flow_nets);
+    flow_nets = NULL;
+    flow_nets_n = 0;
+
+    flowstore_close(debuglvl, &flow_store);
+}
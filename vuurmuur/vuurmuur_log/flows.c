@@ -0,0 +1,536 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+/*
+    vuurmuur_flows: queries the flow history that vuurmuur_log keeps
+    with FLOW_HISTORY. It adds up the connections that ended in a time
+    range per zone, network, host or service, optionally per hour or
+    per day.
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vuurmuur.h>
+#include <getopt.h>
+
+/* what we add up by */
+enum
+{
+    FLOWS_BY_ZONE = 0,
+    FLOWS_BY_NETWORK,
+    FLOWS_BY_HOST,
+    FLOWS_BY_SERVICE,
+};
+
+/* rows in the hash of the totals */
+#define FLOWS_HASH_ROWS     4096
+
+#define FLOWS_UNKNOWN       "(unknown)"
+
+/* the totals of one name in one period */
+struct FlowsRow_
+{
+    /* this should always be on top: we hash on it. "<period> <name>" */
+    char                key[MAX_HOST_NET_ZONE + 24];
+
+    time_t              period;
+    const char          *name;          /* points into key */
+
+    unsigned long long  flows;
+    unsigned long long  packets;
+    /* for hosts, networks and zones 'out' is what they sent. For
+       services it's from the client to the server */
+    unsigned long long  in_bytes;
+    unsigned long long  out_bytes;
+};
+
+struct FlowsQuery_
+{
+    int                 by;
+    int                 step;           /* 0, 3600 or 86400 */
+
+    /* the period of the last record, records come in order */
+    time_t              period;
+    time_t              period_end;
+
+    d_list              rows;
+    Hash                row_hash;
+
+    unsigned long long  records;
+    int                 debuglvl;
+};
+
+
+static void
+print_help(void)
+{
+    fprintf(stdout, "Usage: vuurmuur_flows [OPTIONS]\n");
+    fprintf(stdout, "\n");
+    fprintf(stdout, "Adds up the connections of the flow history (FLOW_HISTORY).\n");
+    fprintf(stdout, "\n");
+    fprintf(stdout, "Options:\n");
+    fprintf(stdout, "-f, --from TIME\t\tfrom TIME (default: today 00:00)\n");
+    fprintf(stdout, "-t, --to TIME\t\tup to TIME (default: now)\n");
+    fprintf(stdout, "\t\t\tTIME is 'YYYY-MM-DD', 'YYYY-MM-DD HH:MM' or 'now'\n");
+    fprintf(stdout, "-b, --by WHAT\t\tzone, network, host or service (default: zone)\n");
+    fprintf(stdout, "-s, --step STEP\t\tnone, hour or day (default: none)\n");
+    fprintf(stdout, "-n, --top N\t\tonly the N biggest per step (default: all)\n");
+    fprintf(stdout, "-D, --dir DIR\t\tthe flow history is in DIR (default: %s)\n", FLOWSTORE_LOCATION);
+    fprintf(stdout, "-d, --debug N\t\tenables debugging (1 low, 3 high)\n");
+    fprintf(stdout, "-h, --help\t\tgives this help\n");
+    fprintf(stdout, "\n");
+
+    exit(EXIT_SUCCESS);
+}
+
+
+/*  flows_time_arg
+
+    'YYYY-MM-DD', 'YYYY-MM-DD HH:MM' or 'now' in local time, -1 if
+    invalid. With 'end' a day means up to the end of that day.
+*/
+static time_t
+flows_time_arg(const char *arg, char end)
+{
+    struct tm   tm;
+    int         n = 0;
+
+    if(strcmp(arg, "now") == 0)
+        return(time(NULL));
+
+    memset(&tm, 0, sizeof(tm));
+    n = sscanf(arg, "%d-%d-%d %d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+            &tm.tm_hour, &tm.tm_min);
+    if(n != 3 && n != 5)
+        return((time_t)-1);
+
+    if(tm.tm_mon < 1 || tm.tm_mon > 12 || tm.tm_mday < 1 || tm.tm_mday > 31 ||
+       tm.tm_hour < 0 || tm.tm_hour > 23 || tm.tm_min < 0 || tm.tm_min > 59)
+        return((time_t)-1);
+
+    if(n == 3 && end)
+    {
+        tm.tm_hour = 23;
+        tm.tm_min = 59;
+        tm.tm_sec = 59;
+    }
+
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+
+    return(mktime(&tm));
+}
+
+
+/* the start of the hour or day 't' is in */
+static time_t
+flows_period_start(time_t t, int step)
+{
+    struct tm   tm;
+
+    if(localtime_r(&t, &tm) == NULL)
+        return(t);
+
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    if(step == 86400)
+        tm.tm_hour = 0;
+    tm.tm_isdst = -1;
+
+    return(mktime(&tm));
+}
+
+
+static int
+flows_compare_row(const void *table_data, const void *search_data)
+{
+    const struct FlowsRow_  *row_ptr = (const struct FlowsRow_ *)table_data;
+
+    if(table_data == NULL || search_data == NULL)
+        return(0);
+
+    if(strcmp(row_ptr->key, (const char *)search_data) == 0)
+        return(1);
+
+    return(0);
+}
+
+
+/*  flows_name
+
+    The name to add 'ip' up by. 'name' is what vuurmuur_log knew it as:
+    'host.network.zone', 'network.zone' for an address in one of our
+    networks without a host, something else like 'firewall', or "" if
+    it's not ours.
+*/
+static const char *
+flows_name(int by, const char *name, const char *ip)
+{
+    const char  *dot = NULL,
+                *last = NULL;
+    int         dots = 0;
+
+    if(name[0] == '\0')
+        return(by == FLOWS_BY_HOST ? ip : FLOWS_UNKNOWN);
+
+    for(dot = strchr(name, '.'); dot != NULL; dot = strchr(dot + 1, '.'))
+    {
+        dots++;
+        last = dot;
+    }
+
+    switch(by)
+    {
+        case FLOWS_BY_HOST:
+            return(dots == 1 ? ip : name);
+        case FLOWS_BY_NETWORK:
+            return(dots == 2 ? strchr(name, '.') + 1 : name);
+        case FLOWS_BY_ZONE:
+            return(last != NULL ? last + 1 : name);
+    }
+
+    return(name);
+}
+
+
+static int
+flows_add(struct FlowsQuery_ *query, const char *name, unsigned long long packets,
+        unsigned long long in_bytes, unsigned long long out_bytes)
+{
+    struct FlowsRow_    *row_ptr = NULL;
+    char                key[sizeof(row_ptr->key)] = "";
+    int                 len = 0;
+
+    len = snprintf(key, sizeof(key), "%ld %s", (long)query->period, name);
+
+    if(!(row_ptr = hash_search(query->debuglvl, &query->row_hash, key)))
+    {
+        if(!(row_ptr = calloc(1, sizeof(struct FlowsRow_))))
+        {
+            (void)vrprint.error(-1, "Error", "calloc failed: %s (in: %s:%d).",
+                    strerror(errno), __FUNC__, __LINE__);
+            return(-1);
+        }
+        (void)strlcpy(row_ptr->key, key, sizeof(row_ptr->key));
+        row_ptr->period = query->period;
+        row_ptr->name = row_ptr->key + (len - (int)strlen(name));
+
+        if(d_list_append(query->debuglvl, &query->rows, row_ptr) == NULL)
+        {
+            (void)vrprint.error(-1, "Internal Error", "d_list_append() "
+                    "failed (in: %s:%d).", __FUNC__, __LINE__);
+            free(row_ptr);
+            return(-1);
+        }
+        if(hash_insert(query->debuglvl, &query->row_hash, row_ptr) < 0)
+        {
+            (void)vrprint.error(-1, "Internal Error", "hash_insert() "
+                    "failed (in: %s:%d).", __FUNC__, __LINE__);
+            return(-1);
+        }
+    }
+
+    row_ptr->flows++;
+    row_ptr->packets += packets;
+    row_ptr->in_bytes += in_bytes;
+    row_ptr->out_bytes += out_bytes;
+
+    return(0);
+}
+
+
+/* flowstore_query callback: adds a connection to the totals */
+static int
+flows_record(void *ctx, FlowRecord *flow)
+{
+    struct FlowsQuery_  *query = (struct FlowsQuery_ *)ctx;
+    unsigned long long  packets = flow->out_packets + flow->in_packets;
+
+    query->records++;
+
+    if(query->step > 0 && (flow->end < query->period || flow->end >= query->period_end))
+    {
+        query->period = flows_period_start(flow->end, query->step);
+        if(query->step == 3600)
+            query->period_end = query->period + 3600;
+        else
+            query->period_end = flows_period_start(query->period + 90000, query->step);
+    }
+
+    if(query->by == FLOWS_BY_SERVICE)
+        return(flows_add(query, flow->ser_name[0] ? flow->ser_name : FLOWS_UNKNOWN,
+                packets, flow->in_bytes, flow->out_bytes));
+
+    /* the source sent 'out', the destination sent the replies */
+    if(flows_add(query, flows_name(query->by, flow->from_name, flow->src_ip),
+            packets, flow->in_bytes, flow->out_bytes) < 0)
+        return(-1);
+
+    return(flows_add(query, flows_name(query->by, flow->to_name, flow->dst_ip),
+            packets, flow->out_bytes, flow->in_bytes));
+}
+
+
+/* per period, the most bytes first */
+static int
+flows_row_cmp(const void *a, const void *b)
+{
+    const struct FlowsRow_  *ra = *(const struct FlowsRow_ * const *)a,
+                            *rb = *(const struct FlowsRow_ * const *)b;
+    unsigned long long      ta = ra->in_bytes + ra->out_bytes,
+                            tb = rb->in_bytes + rb->out_bytes;
+
+    if(ra->period != rb->period)
+        return(ra->period < rb->period ? -1 : 1);
+    if(ta != tb)
+        return(ta > tb ? -1 : 1);
+
+    return(strcmp(ra->name, rb->name));
+}
+
+
+/* bytes in B, KB, MB, GB or TB */
+static char *
+flows_bytes(unsigned long long bytes, char *str, size_t size)
+{
+    const char  *units[] = { "B", "KB", "MB", "GB", "TB" };
+    double      value = (double)bytes;
+    int         unit = 0;
+
+    while(value >= 1024 && unit < 4)
+    {
+        value /= 1024;
+        unit++;
+    }
+
+    if(unit == 0)
+        snprintf(str, size, "%llu B", bytes);
+    else
+        snprintf(str, size, "%.1f %s", value, units[unit]);
+
+    return(str);
+}
+
+
+static void
+flows_print(struct FlowsQuery_ *query, unsigned int top)
+{
+    struct FlowsRow_    **rows = NULL;
+    d_list_node         *d_node = NULL;
+    struct tm           tm;
+    char                period[32] = "",
+                        in[16] = "",
+                        out[16] = "",
+                        total[16] = "";
+    const char          *by[] = { "zone", "network", "host", "service" };
+    unsigned int        i = 0,
+                        n = 0;
+
+    if(query->rows.len == 0)
+    {
+        fprintf(stdout, "No connections.\n");
+        return;
+    }
+
+    if(!(rows = calloc(query->rows.len, sizeof(struct FlowsRow_ *))))
+    {
+        (void)vrprint.error(-1, "Error", "calloc failed: %s (in: %s:%d).",
+                strerror(errno), __FUNC__, __LINE__);
+        return;
+    }
+    for(d_node = query->rows.top; d_node; d_node = d_node->next)
+        rows[i++] = d_node->data;
+
+    qsort(rows, query->rows.len, sizeof(struct FlowsRow_ *), flows_row_cmp);
+
+    for(i = 0; i < query->rows.len; i++)
+    {
+        if(i == 0 || rows[i]->period != rows[i - 1]->period)
+        {
+            if(query->step > 0 && localtime_r(&rows[i]->period, &tm) != NULL)
+            {
+                strftime(period, sizeof(period),
+                        query->step == 86400 ? "%Y-%m-%d" : "%Y-%m-%d %H:00", &tm);
+                fprintf(stdout, "%s%s\n", i > 0 ? "\n" : "", period);
+            }
+            fprintf(stdout, "%-40s %10s %12s %10s %10s %10s\n", by[query->by],
+                    "flows", "packets", query->by == FLOWS_BY_SERVICE ? "reply" : "in",
+                    query->by == FLOWS_BY_SERVICE ? "request" : "out", "total");
+            n = 0;
+        }
+
+        if(top > 0 && n >= top)
+            continue;
+        n++;
+
+        fprintf(stdout, "%-40s %10llu %12llu %10s %10s %10s\n", rows[i]->name,
+                rows[i]->flows, rows[i]->packets,
+                flows_bytes(rows[i]->in_bytes, in, sizeof(in)),
+                flows_bytes(rows[i]->out_bytes, out, sizeof(out)),
+                flows_bytes(rows[i]->in_bytes + rows[i]->out_bytes, total, sizeof(total)));
+    }
+
+    free(rows);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    struct FlowsQuery_  query;
+    VR_user_t           user;
+    struct tm           tm;
+    time_t              from = 0,
+                        to = 0;
+    const char          *dir = FLOWSTORE_LOCATION;
+    unsigned int        top = 0;
+    int                 debuglvl = 0,
+                        optch,
+                        option_index = 0,
+                        retval = EXIT_SUCCESS;
+    static char optstring[] = "hd:f:t:b:s:n:D:";
+    struct option prog_opts[] =
+    {
+        { "help", no_argument, NULL, 'h' },
+        { "debug", required_argument, NULL, 'd' },
+        { "from", required_argument, NULL, 'f' },
+        { "to", required_argument, NULL, 't' },
+        { "by", required_argument, NULL, 'b' },
+        { "step", required_argument, NULL, 's' },
+        { "top", required_argument, NULL, 'n' },
+        { "dir", required_argument, NULL, 'D' },
+        { 0, 0, 0, 0 },
+    };
+
+    memset(&query, 0, sizeof(query));
+
+    get_user_info(debuglvl, &user);
+
+    vrprint.logger = "vuurmuur_flows";
+    vrprint.error = libvuurmuur_stdoutprint_error;
+    vrprint.warning = libvuurmuur_stdoutprint_warning;
+    vrprint.info = libvuurmuur_stdoutprint_info;
+    vrprint.debug = libvuurmuur_stdoutprint_debug;
+    vrprint.username = user.realusername;
+    vrprint.audit = libvuurmuur_stdoutprint_audit;
+
+    /* today */
+    to = time(NULL);
+    (void)localtime_r(&to, &tm);
+    tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    from = mktime(&tm);
+
+    while((optch = getopt_long(argc, argv, optstring, prog_opts, &option_index)) != -1)
+    {
+        switch(optch)
+        {
+            case 'd' :
+                debuglvl = atoi(optarg);
+                if(debuglvl < 0 || debuglvl > HIGH)
+                {
+                    fprintf(stderr, "Error: illegal debug level: %d (max: %d).\n", debuglvl, HIGH);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'f' :
+            case 't' :
+                if(optch == 'f')
+                    from = flows_time_arg(optarg, FALSE);
+                else
+                    to = flows_time_arg(optarg, TRUE);
+                if((optch == 'f' ? from : to) == (time_t)-1)
+                {
+                    fprintf(stderr, "Error: invalid time '%s'.\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'b' :
+                if(strcmp(optarg, "zone") == 0)
+                    query.by = FLOWS_BY_ZONE;
+                else if(strcmp(optarg, "network") == 0)
+                    query.by = FLOWS_BY_NETWORK;
+                else if(strcmp(optarg, "host") == 0)
+                    query.by = FLOWS_BY_HOST;
+                else if(strcmp(optarg, "service") == 0)
+                    query.by = FLOWS_BY_SERVICE;
+                else
+                {
+                    fprintf(stderr, "Error: can't add up by '%s'.\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 's' :
+                if(strcmp(optarg, "none") == 0)
+                    query.step = 0;
+                else if(strcmp(optarg, "hour") == 0)
+                    query.step = 3600;
+                else if(strcmp(optarg, "day") == 0)
+                    query.step = 86400;
+                else
+                {
+                    fprintf(stderr, "Error: invalid step '%s'.\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'n' :
+                top = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'D' :
+                dir = optarg;
+                break;
+            case 'h' :
+            default:
+                print_help();
+                break;
+        }
+    }
+
+    query.debuglvl = debuglvl;
+    if(d_list_setup(debuglvl, &query.rows, free) < 0 ||
+       hash_setup(debuglvl, &query.row_hash, FLOWS_HASH_ROWS, hash_name, flows_compare_row) < 0)
+        exit(EXIT_FAILURE);
+
+    if(flowstore_query(debuglvl, dir, from, to, flows_record, &query) < 0)
+        retval = EXIT_FAILURE;
+    else
+    {
+        if(debuglvl >= LOW)
+            (void)vrprint.debug(__FUNC__, "%llu connections.", query.records);
+        flows_print(&query, top);
+    }
+
+    (void)hash_cleanup(debuglvl, &query.row_hash);
+    (void)d_list_cleanup(debuglvl, &query.rows);
+
+    exit(retval);
+}
@@ -23,6 +23,7 @@
 #include "stats.h"
 #include "logfile.h"
 #include "vuurmuur_ipc.h"
+#include "flowlog.h"
 
 #ifdef HAVE_NFNETLINK
 #include <libnfnetlink/libnfnetlink.h>
@@ -151,7 +152,7 @@ CreateTCPFlagString(struct log_rule *logrule_ptr, char *flagBuffer)
 
     NOTE: if the function returns -1 the memory is not cleaned up: the program is supposed to exit
 */
-static int
+int
 get_vuurmuur_names(const int debuglvl, struct log_rule *logrule_ptr, Hash *ZoneHash, Hash *ServiceHash)
 {
     struct ZoneData_        *search_ptr = NULL;
@@ -659,6 +660,8 @@ main(int argc, char *argv[])
         (void)vrprint.error(-1, "Error", "loading plugins failed, bailing out.");
         exit(EXIT_FAILURE);
     }
+    /* use the snapshot of the daemon if it is fresh */
+    (void)snapshot_attach(debuglvl);
 
     /* open the logs */
     if(syslog && open_syslog(debuglvl, &conf, &system_log) < 0)
@@ -714,6 +717,10 @@ main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
+    /* the flow history is not worth bailing out for */
+    if(flowlog_setup(debuglvl, &conf, &zones) < 0)
+        (void)vrprint.warning("Warning", "setting up the flow history failed, no flow history.");
+
     if (nodaemon == 0) {
         if (daemon(1,1) != 0) {
             (void)vrprint.error(-1, "Error", "daemon() failed: %s",
@@ -809,8 +816,9 @@ main(int argc, char *argv[])
                         /* reset waiting */
                         waiting = 0;
                     } else {
-                        /* sleep so we don't use all system resources */
-                        usleep(100000);  /* this should be 1/10th of a second */
+                        /* sleep so we don't use all system resources,
+                         * unless there are conntrack events to read */
+                        flowlog_wait(debuglvl, 100);  /* this should be 1/10th of a second */
                     }
                 }
 #ifdef HAVE_LIBNETFILTER_LOG
@@ -822,11 +830,17 @@ main(int argc, char *argv[])
                         exit (EXIT_FAILURE);
                         break;
                     case 0:
-                        usleep (100000);
+                        flowlog_wait(debuglvl, 100);
                         break;
                 }
 #endif /* HAVE_LIBNETFILTER_LOG */
             } /* if syslog */
+
+            if(flowlog_read(debuglvl, &zone_htbl, &service_htbl) < 0)
+            {
+                (void)vrprint.error(-1, "Error", "reading the ended connections failed, no flow history.");
+                flowlog_close(debuglvl);
+            }
         } /* if reload == 0 */
 
         /*
@@ -879,6 +893,7 @@ main(int argc, char *argv[])
                 (void)vrprint.error(-1, "Error", "re-opening backends failed.");
                 exit(EXIT_FAILURE);
             }
+            (void)snapshot_attach(debuglvl);
 
             shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 30);
 
@@ -941,6 +956,9 @@ main(int argc, char *argv[])
             }
             shm_update_progress(debuglvl, sem_id, &shm_table->reload_progress, 90);
 
+            if(flowlog_setup(debuglvl, &conf, &zones) < 0)
+                (void)vrprint.warning("Warning", "setting up the flow history failed, no flow history.");
+
             /* re-open the logs */
             if(syslog && reopen_syslog(debuglvl, &conf, &system_log) < 0)
             {
@@ -988,6 +1006,9 @@ main(int argc, char *argv[])
     if (system_log != NULL)
         fclose(system_log);
 
+    /* stop the flow history */
+    flowlog_close(debuglvl);
+
     /* destroy hashtables */
     hash_cleanup(debuglvl, &zone_htbl);
     hash_cleanup(debuglvl, &service_htbl);
@@ -127,6 +127,7 @@ int reopen_logfiles(const int, FILE **, FILE **);
 int open_logfiles(const int, const struct vuurmuur_config *cnf, FILE **, FILE **);
 
 int process_logrecord(struct log_rule *logrule_ptr);
+int get_vuurmuur_names(const int, struct log_rule *, Hash *, Hash *);
 
 /* semaphore id */
 int         sem_id;
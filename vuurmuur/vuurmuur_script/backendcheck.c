@@ -512,6 +512,58 @@ backend_check_interface_tcpmss(const int debuglvl, char *value, struct rgx_ *reg
     return(VRS_ERR_COMMANDLINE);
 }
 
+/*  SHAPE_LEAF
+
+*/
+int
+backend_check_interface_shape_leaf(const int debuglvl, char *value, struct rgx_ *reg)
+{
+    /* safety */
+    if(value == NULL || reg == NULL)
+    {
+        (void)vrprint.error(VRS_ERR_INTERNAL, VR_INTERR, "parameter problem (in: %s:%d).",
+                                        __FUNC__, __LINE__);
+        return(VRS_ERR_INTERNAL);
+    }
+
+    /* empty is also possible for clearing */
+    if (value[0] == '\0')
+        return(0);
+
+    /* check */
+    if(libvuurmuur_is_shape_leaf(debuglvl, value) == 1)
+        return(0);
+
+    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "'%s' is not a valid value for variable 'SHAPE_LEAF' (in: %s:%d).", value, __FUNC__, __LINE__);
+    return(VRS_ERR_COMMANDLINE);
+}
+
+/*  SHAPE_OFFLOAD
+
+*/
+int
+backend_check_interface_shape_offload(const int debuglvl, char *value, struct rgx_ *reg)
+{
+    /* safety */
+    if(value == NULL || reg == NULL)
+    {
+        (void)vrprint.error(VRS_ERR_INTERNAL, VR_INTERR, "parameter problem (in: %s:%d).",
+                                        __FUNC__, __LINE__);
+        return(VRS_ERR_INTERNAL);
+    }
+
+    /* empty is also possible for clearing */
+    if (value[0] == '\0')
+        return(0);
+
+    /* check */
+    if(strcasecmp(value,"yes") == 0 || strcasecmp(value,"no") == 0)
+        return(0);
+
+    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "'%s' is not a valid value for variable 'SHAPE_OFFLOAD' (in: %s:%d).", value, __FUNC__, __LINE__);
+    return(VRS_ERR_COMMANDLINE);
+}
+
 
 /*  BROADCAST
 
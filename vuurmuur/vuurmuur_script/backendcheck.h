@@ -42,6 +42,8 @@ int backend_check_interface_bw(const int, char *, struct rgx_ *);
 int backend_check_interface_bw_unit(const int, char *, struct rgx_ *);
 int backend_check_interface_rule(const int, char *, struct rgx_ *);
 int backend_check_interface_tcpmss(const int, char *, struct rgx_ *);
+int backend_check_interface_shape_leaf(const int, char *, struct rgx_ *);
+int backend_check_interface_shape_offload(const int, char *, struct rgx_ *);
 
 int backend_check_service_broadcast(const int, char *, struct rgx_ *);
 int backend_check_service_helper(const int, char *, struct rgx_ *);
@@ -101,6 +103,8 @@ backend_vars[] =
     {TYPE_INTERFACE,"BW_OUT",       0, backend_check_interface_bw},
     {TYPE_INTERFACE,"BW_IN_UNIT",   0, backend_check_interface_bw_unit},
     {TYPE_INTERFACE,"BW_OUT_UNIT",  0, backend_check_interface_bw_unit},
+    {TYPE_INTERFACE,"SHAPE_LEAF",   0, backend_check_interface_shape_leaf},
+    {TYPE_INTERFACE,"SHAPE_OFFLOAD",0, backend_check_interface_shape_offload},
 
     /* service specific */
     {TYPE_SERVICE,  "ACTIVE",       0, backend_check_active},
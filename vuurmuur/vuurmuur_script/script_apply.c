@@ -20,6 +20,80 @@
 
 #include "vuurmuur_script.h"
 
+
+/*  script_apply_block
+
+    Lets the daemon handle --block and --unblock: it changes the blocklist
+    and reloads in one request over the control channel.
+
+    Returncodes:
+        1: done, the result is in 'retval'
+        0: daemon not reachable, do it the old way
+*/
+int
+script_apply_block(const int debuglvl, VuurmuurScript *vr_script, int *retval)
+{
+    int     result = 0,
+            rr = 0;
+    char    *item = vr_script->set;
+
+    /* --block stored "block 1.2.3.4" */
+    if(vr_script->cmd == CMD_BLK)
+        item += strlen("block ");
+
+    result = control_request(debuglvl, CONTROL_SOCKET,
+            vr_script->cmd == CMD_BLK ? CONTROL_BLOCK : CONTROL_UNBLOCK,
+            item, NULL, NULL, &rr);
+    if(result == 0)
+        return(0);
+
+    vr_script->reloaded = TRUE;
+
+    if(result < 0 || rr == VR_RR_ERROR)
+    {
+        (void)vrprint.error(VRS_ERR_COMMAND_FAILED, VR_ERR, "%s '%s' failed.",
+                vr_script->cmd == CMD_BLK ? "blocking" : "unblocking", item);
+        *retval = VRS_ERR_COMMAND_FAILED;
+    }
+    else if(rr == VR_RR_NOCHANGES && vr_script->cmd == CMD_UBL)
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
+            "item '%s' not found in the blocklist (in: %s:%d).",
+            item, __FUNC__, __LINE__);
+        *retval = VRS_ERR_COMMANDLINE;
+    }
+    else
+    {
+        *retval = VRS_SUCCESS;
+    }
+
+    return(1);
+}
+
+
+/* reload vuurmuur over the control channel, with progress and result at once */
+static int
+script_apply_control(const int debuglvl, VuurmuurScript *vr_script, char *failed)
+{
+    int     result = 0,
+            rr = 0;
+
+    if(vr_script->reloaded == TRUE)
+        return(1);
+
+    result = control_request(debuglvl, CONTROL_SOCKET, CONTROL_RELOAD, NULL, NULL, NULL, &rr);
+    if(result == 0)
+        return(0);
+
+    vr_script->reloaded = TRUE;
+
+    if(result < 0 || (rr != VR_RR_SUCCES && rr != VR_RR_NOCHANGES))
+        *failed = TRUE;
+
+    return(1);
+}
+
+
 int
 script_apply(const int debuglvl, VuurmuurScript *vr_script)
 {
@@ -45,11 +119,21 @@ script_apply(const int debuglvl, VuurmuurScript *vr_script)
 
     char                failed = FALSE;
     int                 retval = 0;
+    char                vuurmuur_ctl = FALSE;
+
+    /* vuurmuur listens on the control channel, otherwise fall back to shm */
+    vuurmuur_ctl = (char)script_apply_control(debuglvl, vr_script, &failed);
 
     /* try to connect to vuurmuur trough shm */
     vuurmuur_shmtable = NULL;
-    get_vuurmuur_pid("/var/run/vuurmuur.pid", &vuurmuur_shmid);
-    if(vuurmuur_shmid > 0)
+    if(vuurmuur_ctl == FALSE)
+        get_vuurmuur_pid("/var/run/vuurmuur.pid", &vuurmuur_shmid);
+    if(vuurmuur_ctl == TRUE)
+    {
+        /* already done */
+        vuurmuur_progress = 100;
+    }
+    else if(vuurmuur_shmid > 0)
     {
         /* attach to shared memory */
         vuurmuur_shmp = shmat(vuurmuur_shmid, 0, 0);
@@ -193,7 +277,7 @@ script_apply(const int debuglvl, VuurmuurScript *vr_script)
                     }
                 }
             }
-        } else {
+        } else if(vuurmuur_ctl == FALSE) {
             vuurmuur_result = VR_RR_READY;
             failed = 1;
         }
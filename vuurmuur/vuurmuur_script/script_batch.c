@@ -0,0 +1,507 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2012 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "vuurmuur_script.h"
+
+/*
+    Batch mode: run many commands against one set of loaded backends.
+
+    Every line of the batch file holds one command, written with the same
+    options as on the commandline, e.g.:
+
+        --create --host pc1.localnet.lan
+        -M -o pc1.localnet.lan -V IPADDRESS -S 192.168.1.15
+        -M -r rules -V RULE -S "accept service ftp from pc1.localnet.lan to firewall" -A
+
+    Empty lines and lines starting with a '#' are skipped. Arguments can be
+    quoted with single or double quotes. After every command a status line
+    is printed:
+
+        line <nr>: <returncode> (<description>)
+
+    Vuurmuur and Vuurmuur_log are asked to reload at most once, after the
+    last command.
+*/
+
+#define BATCH_MAX_LINE  2048
+#define BATCH_MAX_ARGS  64
+
+
+static char *
+batch_status_str(int status)
+{
+    switch(status)
+    {
+        case VRS_SUCCESS:
+            return("ok");
+        case VRS_ERR_COMMANDLINE:
+            return("commandline error");
+        case VRS_ERR_COMMAND_FAILED:
+            return("command failed");
+        case VRS_ERR_NOT_FOUND:
+            return("not found");
+        case VRS_ERR_ALREADY_EXISTS:
+            return("already exists");
+        case VRS_ERR_MALLOC:
+            return("out of memory");
+        case VRS_ERR_DATA_INCONSISTENCY:
+            return("data inconsistency");
+    }
+
+    return("internal error");
+}
+
+
+/*  batch_split
+
+    Splits line into arguments in place. argv[0] is set to 'prog' so the
+    result can be fed to getopt.
+
+    Returncodes:
+        >= 1: number of arguments, including argv[0]
+        -1: error (unterminated quote or too many arguments)
+*/
+static int
+batch_split(char *line, char *prog, char **argv, int max_args)
+{
+    char    *src = line,
+            *dst = line;
+    char    quote = '\0';
+    int     argc = 0;
+
+    argv[argc++] = prog;
+
+    while(*src != '\0')
+    {
+        /* skip the whitespace between the arguments */
+        while(*src == ' ' || *src == '\t' || *src == '\n' || *src == '\r')
+            src++;
+        if(*src == '\0')
+            break;
+
+        if(argc >= max_args)
+        {
+            (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "too many arguments (max: %d).", max_args - 1);
+            return(-1);
+        }
+        argv[argc++] = dst;
+
+        /* copy the argument, removing the quotes and escapes */
+        for( ; *src != '\0'; src++)
+        {
+            if(quote == '\0' && (*src == ' ' || *src == '\t' || *src == '\n' || *src == '\r'))
+                break;
+
+            if(quote == '\0' && (*src == '"' || *src == '\''))
+                quote = *src;
+            else if(quote != '\0' && *src == quote)
+                quote = '\0';
+            else if(quote != '\'' && *src == '\\' && *(src+1) != '\0')
+                *dst++ = *++src;
+            else
+                *dst++ = *src;
+        }
+
+        if(*src != '\0')
+            src++;
+        *dst++ = '\0';
+    }
+
+    if(quote != '\0')
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "unterminated quote.");
+        return(-1);
+    }
+
+    argv[argc] = NULL;
+    return(argc);
+}
+
+
+static int
+batch_set_name(VuurmuurScript *vr_script, int type, char *name, char *option)
+{
+    vr_script->type = type;
+
+    if(strlcpy(vr_script->name, name, sizeof(vr_script->name)) >= sizeof(vr_script->name))
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "%s: argument too long (max: %d).", option, (int)sizeof(vr_script->name)-1);
+        return(VRS_ERR_COMMANDLINE);
+    }
+    return(VRS_SUCCESS);
+}
+
+
+/*  batch_parse
+
+    Parses the options of one batch command into vr_script. Only the
+    commands and object options are supported, the global options like
+    -c and -d are not.
+
+    Returncodes:
+        VRS_SUCCESS: ok
+        VRS_ERR_COMMANDLINE: invalid command
+*/
+static int
+batch_parse(VuurmuurScript *vr_script, int argc, char **argv)
+{
+    static char     optstring[] = "CRDMPLAOo:g:n:z:s:i:r:V:S:";
+    int             apply_flag = 0,
+                    no_apply_flag = 0,
+                    reload_flag = 0,
+                    print_linenum_flag = 0;
+    struct option   long_options[] =
+    {
+        /* commands */
+        {"create",      0, NULL, 'C'},
+        {"delete",      0, NULL, 'D'},
+        {"rename",      0, NULL, 'R'},
+        {"modify",      0, NULL, 'M'},
+        {"print",       0, NULL, 'P'},
+        {"list",        0, NULL, 'L'},
+
+        {"block",       1, NULL, 0},
+        {"unblock",     1, NULL, 0},
+        {"list-blocked",0, NULL, 0},
+
+        /* object name */
+        {"variable",    1, NULL, 'V'},
+        {"set",         1, NULL, 'S'},
+
+        {"append",      0, NULL, 'A'},
+        {"overwrite",   0, NULL, 'O'},
+
+        /* object types */
+        {"host",        1, NULL, 'o'},
+        {"group",       1, NULL, 'g'},
+        {"network",     1, NULL, 'n'},
+        {"zone",        1, NULL, 'z'},
+        {"service",     1, NULL, 's'},
+        {"interface",   1, NULL, 'i'},
+        {"rule",        1, NULL, 'r'},
+
+        /* options */
+        {"apply",       0, &apply_flag, 1},
+        {"no-apply",    0, &no_apply_flag, 1},
+        {"reload",      0, &reload_flag, 1},
+        {"rule-numbers",0, &print_linenum_flag, 1},
+        {NULL,          0, NULL, 0}
+    };
+    int             opt = 0,
+                    longopt_index = 0,
+                    retval = VRS_SUCCESS;
+
+    optind = 0; /* reset getopt for every command */
+    while(retval == VRS_SUCCESS &&
+        (opt = getopt_long(argc, argv, optstring, long_options, &longopt_index)) >= 0)
+    {
+        switch(opt)
+        {
+            case 0:
+                if(long_options[longopt_index].flag != NULL)
+                    break;
+
+                if(strcmp(long_options[longopt_index].name, "block") == 0)
+                {
+                    vr_script->cmd = CMD_BLK;
+                    retval = script_set_block(vr_script, optarg);
+                }
+                else if(strcmp(long_options[longopt_index].name, "unblock") == 0)
+                {
+                    vr_script->cmd = CMD_UBL;
+                    vr_script->type = TYPE_RULE;
+                    vr_script->apply = TRUE;
+
+                    if(strlcpy(vr_script->set, optarg, sizeof(vr_script->set)) >= sizeof(vr_script->set))
+                    {
+                        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
+                            "could not set object to unblock: argument too long (max: %d).",
+                            (int)sizeof(vr_script->set)-1);
+                        retval = VRS_ERR_COMMANDLINE;
+                    }
+                }
+                else if(strcmp(long_options[longopt_index].name, "list-blocked") == 0)
+                {
+                    vr_script->type = TYPE_RULE;
+                    vr_script->cmd = CMD_LBL;
+                }
+                break;
+
+            case 'C' :
+                vr_script->cmd = CMD_ADD;
+                break;
+            case 'D' :
+                vr_script->cmd = CMD_DEL;
+                break;
+            case 'R' :
+                vr_script->cmd = CMD_REN;
+                break;
+            case 'M' :
+                vr_script->cmd = CMD_MOD;
+                break;
+            case 'P' :
+                vr_script->cmd = CMD_PRT;
+                break;
+            case 'L' :
+                vr_script->cmd = CMD_LST;
+                break;
+
+            case 'o' :
+                retval = batch_set_name(vr_script, TYPE_HOST, optarg, "host (-o/--host)");
+                break;
+            case 'g' :
+                retval = batch_set_name(vr_script, TYPE_GROUP, optarg, "group (-g/--group)");
+                break;
+            case 'n' :
+                retval = batch_set_name(vr_script, TYPE_NETWORK, optarg, "network (-n/--network)");
+                break;
+            case 'z' :
+                retval = batch_set_name(vr_script, TYPE_ZONE, optarg, "zone (-z/--zone)");
+                break;
+            case 's' :
+                retval = batch_set_name(vr_script, TYPE_SERVICE, optarg, "service (-s/--service)");
+                break;
+            case 'i' :
+                retval = batch_set_name(vr_script, TYPE_INTERFACE, optarg, "interface (-i/--interface)");
+                break;
+            case 'r' :
+                retval = batch_set_name(vr_script, TYPE_RULE, optarg, "rule (-r/--rule)");
+                break;
+
+            case 'S' :
+                if(strlcpy(vr_script->set, optarg, sizeof(vr_script->set)) >= sizeof(vr_script->set))
+                {
+                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "set (-S/--set): argument too long (max: %d).", (int)sizeof(vr_script->set)-1);
+                    retval = VRS_ERR_COMMANDLINE;
+                }
+                break;
+
+            case 'V' :
+                if(strlcpy(vr_script->var, optarg, sizeof(vr_script->var)) >= sizeof(vr_script->var))
+                {
+                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "var (-V/--var): argument too long (max: %d).", (int)sizeof(vr_script->var)-1);
+                    retval = VRS_ERR_COMMANDLINE;
+                }
+                break;
+
+            case 'O' :
+                vr_script->overwrite = TRUE;
+                break;
+
+            case 'A' :
+                vr_script->overwrite = FALSE;
+                break;
+
+            default:
+                (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "unknown or unsupported option in batch mode.");
+                retval = VRS_ERR_COMMANDLINE;
+                break;
+        }
+    }
+    if(retval != VRS_SUCCESS)
+        return(retval);
+
+    if(optind < argc)
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "unexpected argument '%s'.", argv[optind]);
+        return(VRS_ERR_COMMANDLINE);
+    }
+
+    if(apply_flag == 1)
+        vr_script->apply = TRUE;
+    if(no_apply_flag == 1)
+        vr_script->apply = FALSE;
+    if(print_linenum_flag == 1)
+        vr_script->print_rule_numbers = TRUE;
+
+    if(reload_flag == 1)
+    {
+        vr_script->cmd = CMD_RLD;
+        vr_script->apply = TRUE;
+    }
+
+    if(vr_script->cmd == CMD_UNSET)
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "missing command option.");
+        return(VRS_ERR_COMMANDLINE);
+    }
+
+    return(VRS_SUCCESS);
+}
+
+
+/*  batch_reset
+
+    Clears the command data from vr_script, but keeps the regexes and the
+    batch settings.
+*/
+static void
+batch_reset(VuurmuurScript *vr_script)
+{
+    vr_script->cmd = CMD_UNSET;
+    vr_script->type = TYPE_UNSET;
+    vr_script->zonetype = 0;
+
+    memset(vr_script->name, 0, sizeof(vr_script->name));
+    memset(vr_script->name_zone, 0, sizeof(vr_script->name_zone));
+    memset(vr_script->name_net, 0, sizeof(vr_script->name_net));
+    memset(vr_script->name_host, 0, sizeof(vr_script->name_host));
+    memset(vr_script->var, 0, sizeof(vr_script->var));
+    memset(vr_script->set, 0, sizeof(vr_script->set));
+    memset(vr_script->bdat, 0, sizeof(vr_script->bdat));
+
+    vr_script->overwrite = TRUE;
+    vr_script->apply = FALSE;
+    vr_script->print_rule_numbers = FALSE;
+}
+
+
+/*  script_batch
+
+    Runs all commands from the batch file. The backends are loaded only
+    once by the caller, and the changes are applied once at the end if one
+    of the succeeded commands asked for it, or --apply/--reload was given
+    on the commandline. --no-apply on the commandline prevents applying.
+
+    Returncodes:
+        VRS_SUCCESS: all commands succeeded
+        otherwise the code of the first command that failed
+*/
+int
+script_batch(const int debuglvl, VuurmuurScript *vr_script)
+{
+    FILE            *fp = NULL;
+    char            line[BATCH_MAX_LINE] = "";
+    char            *argv[BATCH_MAX_ARGS + 1];
+    int             argc = 0;
+    unsigned int    lineno = 0,
+                    cmds = 0,
+                    failed = 0;
+    size_t          len = 0;
+    char            apply = FALSE,
+                    toolong = FALSE;
+    int             status = VRS_SUCCESS,
+                    retval = VRS_SUCCESS;
+
+    if(vr_script->batch == NULL)
+    {
+        (void)vrprint.error(VRS_ERR_INTERNAL, VR_INTERR, "parameter problem (in: %s:%d).", __FUNC__, __LINE__);
+        return(VRS_ERR_INTERNAL);
+    }
+
+    /* commandline --apply or --reload */
+    if(vr_script->apply == TRUE)
+        apply = TRUE;
+
+    if(strcmp(vr_script->batch, "-") == 0)
+    {
+        fp = stdin;
+    }
+    else if(!(fp = vuurmuur_fopen(debuglvl, &conf, vr_script->batch, "r")))
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "opening batch file '%s' failed.", vr_script->batch);
+        return(VRS_ERR_COMMANDLINE);
+    }
+
+    while(fgets(line, (int)sizeof(line), fp) != NULL)
+    {
+        len = strlen(line);
+
+        /* the rest of a line that was too long */
+        if(toolong == TRUE)
+        {
+            if(len > 0 && line[len - 1] == '\n')
+                toolong = FALSE;
+            continue;
+        }
+
+        lineno++;
+
+        if(len > 0 && line[len - 1] != '\n' && !feof(fp))
+        {
+            (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "line %u: too long (max: %d).", lineno, (int)sizeof(line) - 2);
+            toolong = TRUE;
+            status = VRS_ERR_COMMANDLINE;
+        }
+        else
+        {
+            argc = batch_split(line, "batch", argv, BATCH_MAX_ARGS);
+
+            /* skip empty lines and comments */
+            if(argc == 1 || (argc > 1 && argv[1][0] == '#'))
+                continue;
+
+            if(argc < 0)
+            {
+                status = VRS_ERR_COMMANDLINE;
+            }
+            else
+            {
+                batch_reset(vr_script);
+
+                if(debuglvl >= MEDIUM)
+                    (void)vrprint.debug(__FUNC__, "line %u: %d arguments.", lineno, argc - 1);
+
+                status = batch_parse(vr_script, argc, argv);
+                if(status == VRS_SUCCESS)
+                    status = script_check(debuglvl, vr_script);
+                if(status == VRS_SUCCESS)
+                    status = script_exec(debuglvl, vr_script);
+
+                if(status == VRS_SUCCESS && vr_script->apply == TRUE)
+                    apply = TRUE;
+            }
+        }
+
+        cmds++;
+        if(status != VRS_SUCCESS)
+        {
+            failed++;
+            if(retval == VRS_SUCCESS)
+                retval = status;
+        }
+
+        fprintf(stdout, "line %u: %d (%s)\n", lineno, status, batch_status_str(status));
+        (void)fflush(stdout);
+    }
+
+    if(ferror(fp))
+    {
+        (void)vrprint.error(VRS_ERR_COMMAND_FAILED, VR_ERR, "reading batch file '%s' failed.", vr_script->batch);
+        if(retval == VRS_SUCCESS)
+            retval = VRS_ERR_COMMAND_FAILED;
+    }
+
+    if(fp != stdin)
+        (void)fclose(fp);
+
+    if(conf.verbose_out == TRUE)
+        (void)vrprint.info(VR_INFO, "batch: %u commands, %u failed.", cmds, failed);
+
+    /* apply once for all commands */
+    if(apply == TRUE && vr_script->no_apply == FALSE)
+    {
+        status = script_apply(debuglvl, vr_script);
+        if(status != VRS_SUCCESS && retval == VRS_SUCCESS)
+            retval = status;
+    }
+
+    return(retval);
+}
@@ -470,6 +470,22 @@ script_print(const int debuglvl, VuurmuurScript *vr_script)
             else
                 printf("BW_OUT_UNIT=\"\"\n");
         }
+        /* SHAPE_LEAF */
+        if(strcasecmp(vr_script->var,"any") == 0 || strcmp(vr_script->var,"SHAPE_LEAF") == 0)
+        {
+            if(af->ask(debuglvl, ifac_backend, vr_script->name, "SHAPE_LEAF", vr_script->bdat, sizeof(vr_script->bdat), TYPE_INTERFACE, 0) == 1)
+                printf("SHAPE_LEAF=\"%s\"\n", vr_script->bdat);
+            else
+                printf("SHAPE_LEAF=\"\"\n");
+        }
+        /* SHAPE_OFFLOAD */
+        if(strcasecmp(vr_script->var,"any") == 0 || strcmp(vr_script->var,"SHAPE_OFFLOAD") == 0)
+        {
+            if(af->ask(debuglvl, ifac_backend, vr_script->name, "SHAPE_OFFLOAD", vr_script->bdat, sizeof(vr_script->bdat), TYPE_INTERFACE, 0) == 1)
+                printf("SHAPE_OFFLOAD=\"%s\"\n", vr_script->bdat);
+            else
+                printf("SHAPE_OFFLOAD=\"\"\n");
+        }
         /* TCPMSS */
         if(strcasecmp(vr_script->var,"any") == 0 || strcmp(vr_script->var,"TCPMSS") == 0)
         {
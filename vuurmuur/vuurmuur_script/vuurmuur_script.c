@@ -42,8 +42,6 @@ main(int argc, char *argv[])
     static int      no_apply_flag = 0;
     static int      reload_flag = 0;
     static int      print_linenum_flag = 0;
-    char            tmp_set[sizeof(vr_script.set)] = "";
-    char            *str = NULL;
 
     static struct option long_options[] =
     {
@@ -59,6 +57,7 @@ main(int argc, char *argv[])
         {"unblock",     1, NULL, 0},
         {"list-blocked",0, NULL, 0},
         {"list-paths",  0, NULL, 0},
+        {"batch",       1, NULL, 0},
 
         /* object name */
         {"variable",    1, NULL, 'V'},
@@ -169,44 +168,8 @@ main(int argc, char *argv[])
                      */
                     vr_script.cmd = CMD_BLK;    /* we will change this to -M later */
 
-                    /* -V RULE */
-                    if(strlcpy(vr_script.var, "RULE", sizeof(vr_script.var)) >= sizeof(vr_script.var))
-                    {
-                        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
-                                "could not set variable: internal argument 'RULE' too long (max: %d).",
-                                (int)sizeof(vr_script.var)-1);
-                        exit(VRS_ERR_COMMANDLINE);
-                    }
-
-                    /* --set "block 1.2.3.4" */
-                    if(snprintf(tmp_set, sizeof(tmp_set), "block %s", optarg) >= (int)sizeof(tmp_set))
-                    {
-                        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
-                                "could not set ip address: argument too long (max: %d).",
-                                (int)sizeof(tmp_set)-1);
-                        exit(VRS_ERR_COMMANDLINE);
-                    }
-                    if(strlcpy(vr_script.set, tmp_set, sizeof(vr_script.set)) >= sizeof(vr_script.set))
-                    {
-                        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
-                                "could not set ip address: argument too long (max: %d).",
-                                (int)sizeof(vr_script.set)-1);
-                        exit(VRS_ERR_COMMANDLINE);
-                    }
-
-                    /* -r blocklist */
-                    vr_script.type = TYPE_RULE;
-
-                    if(strlcpy(vr_script.name, "blocklist", sizeof(vr_script.name)) >= sizeof(vr_script.name))
-                    {
-                        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
-                                "rule (-r/--rule): internal argument too long (max: %d).",
-                                (int)sizeof(vr_script.name)-1);
+                    if(script_set_block(&vr_script, optarg) != VRS_SUCCESS)
                         exit(VRS_ERR_COMMANDLINE);
-                    }
-
-                    /* --apply */
-                    vr_script.apply = TRUE;
                 }
                 else if(strcmp(long_options[longopt_index].name, "unblock") == 0)
                 {
@@ -235,6 +198,12 @@ main(int argc, char *argv[])
                     vr_script.cmd = CMD_LBL;
                     break;
                 }
+                else if(strcmp(long_options[longopt_index].name, "batch") == 0)
+                {
+                    vr_script.cmd = CMD_BAT;
+                    vr_script.batch = optarg;
+                    break;
+                }
                 else if(strcmp(long_options[longopt_index].name, "list-paths") == 0)
                 {
                     printf("SYSCONFDIR %s\n", conf.etcdir);
@@ -300,6 +269,8 @@ main(int argc, char *argv[])
                 fprintf(stdout, "     --unblock <name>\t\tunblock host/group or ipaddress.\n");
                 fprintf(stdout, "     --list-blocked\t\tlist the hosts/group and ipaddresses that are blocked.\n");
                 fprintf(stdout, "     --reload\t\t\tmake Vuurmuur reload it's config\n");
+                fprintf(stdout, "     --batch <file>\t\trun the commands from file, one per line,\n");
+                fprintf(stdout, "                   \t\tor from stdin if file is '-'.\n");
                 fprintf(stdout, "\n");
                 fprintf(stdout, " -C, --create\t\t\tcreate object.\n");
                 fprintf(stdout, " -D, --delete\t\t\tdelete object.\n");
@@ -498,12 +469,17 @@ main(int argc, char *argv[])
     if(apply_flag == 1)
         vr_script.apply = TRUE;
     if(no_apply_flag == 1)
+    {
         vr_script.apply = FALSE;
+        vr_script.no_apply = TRUE;
+    }
 
-    /* reload the config */
+    /* reload the config. In batch mode this just makes sure we apply
+       at the end. */
     if (reload_flag == 1)
     {
-        vr_script.cmd = CMD_RLD;
+        if(vr_script.cmd != CMD_BAT)
+            vr_script.cmd = CMD_RLD;
         vr_script.apply = TRUE;
     }
 
@@ -566,6 +542,11 @@ main(int argc, char *argv[])
         if(conf.verbose_out == TRUE)
             (void)vrprint.info(VR_INFO, "command 'reload-config' selected.");
     }
+    else if(vr_script.cmd == CMD_BAT)
+    {
+        if(conf.verbose_out == TRUE)
+            (void)vrprint.info(VR_INFO, "command 'batch' selected.");
+    }
     else
     {
         (void)vrprint.error(VRS_ERR_INTERNAL, VR_INTERR, "unknown command option %d.", vr_script.cmd);
@@ -573,310 +554,450 @@ main(int argc, char *argv[])
     }
 
 
+    /* check the type and the name of the object. In batch mode this is
+       done for every command. */
+    if(vr_script.cmd != CMD_BAT)
+    {
+        if((retval = script_check(debuglvl, &vr_script)) != VRS_SUCCESS)
+            exit(retval);
+    }
+
+    /* see if we need to print rule numbers */
+    if(print_linenum_flag == 1)
+        vr_script.print_rule_numbers = TRUE;
+
+    /* initialize the config from the config file */
+    if(debuglvl >= MEDIUM)
+        (void)vrprint.debug(__FUNC__, "initializing config... calling init_config()");
+
+    result = init_config(debuglvl, &conf);
+    if(result >= VR_CNF_OK)
+    {
+        if(debuglvl >= MEDIUM)
+            (void)vrprint.debug(__FUNC__, "initializing config complete and succesful.");
+    }
+    else
+    {
+        fprintf(stdout, "Initializing config failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+
+    /* now we know the logfile locations, so init the log functions */
+    if(conf.verbose_out == TRUE)
+    {
+        /* if we use verbose output, we still print the logfiles as well */
+        vrprint.error = libvuurmuur_logstdoutprint_error;
+        vrprint.warning = libvuurmuur_logstdoutprint_warning;
+        vrprint.info = libvuurmuur_logstdoutprint_info;
+        vrprint.debug = libvuurmuur_logstdoutprint_debug;
+    }
+    else
+    {
+        vrprint.error = libvuurmuur_logprint_error;
+        vrprint.warning = libvuurmuur_logprint_warning;
+        vrprint.info = libvuurmuur_logprint_info;
+        vrprint.debug = libvuurmuur_logprint_debug;
+    }
+    /* audit only to the log, no matter if we are in verbose mode or not
+       because it prints: username: message... example:
+       
+       victor : interface 'abcd' added.
+    */
+    vrprint.audit = libvuurmuur_logprint_audit;
+
+
+    /* load the backends */
+    result = load_backends(debuglvl, &PluginList);
+    if(result < 0)
+    {
+        fprintf(stdout, "Error: loading backends failed\n");
+        exit(EXIT_FAILURE);
+    }
+    /* use the snapshot of the daemon if it is fresh */
+    (void)snapshot_attach(debuglvl);
+
+    /* main part: handle the different commands */
+    if(vr_script.cmd == CMD_BAT)
+        retval = script_batch(debuglvl, &vr_script);
+    /* a running vuurmuur does (un)block and reload in one go */
+    else if((vr_script.cmd == CMD_BLK || vr_script.cmd == CMD_UBL) && vr_script.apply == TRUE &&
+            script_apply_block(debuglvl, &vr_script, &retval) == 1)
+    {
+        /* retval was set by script_apply_block */
+    }
+    else
+        retval = script_exec(debuglvl, &vr_script);
+
+    /* if all went well (retval == 0) we can apply now. The batch mode
+       applies itself, once for all commands. */
+    if(vr_script.cmd != CMD_BAT && vr_script.apply == TRUE && retval == VRS_SUCCESS)
+    {
+        retval = script_apply(debuglvl, &vr_script);
+    }
+
+    /* unload the backends */
+    result = unload_backends(debuglvl, &PluginList);
+    if(result < 0)
+    {
+        fprintf(stdout, "Error: unloading backends failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /*
+        Destroy the data structures
+    */
+
+    /* cleanup regexes */
+    (void)setup_rgx(0, &vr_script.reg);
+
+    if(debuglvl >= HIGH)
+        (void)vrprint.debug(__FUNC__, "** end **, return = %d", retval);
+
+    return(retval);
+}
+
+
+/*  script_set_block
+
+    Sets up vr_script for blocking 'ip', which is handled as:
+    vuurmuur_script -M -r blocklist -V RULE --set "block 1.2.3.4" --append --apply
+
+    Returncodes:
+        VRS_SUCCESS: ok
+        VRS_ERR_COMMANDLINE: argument too long
+*/
+int
+script_set_block(VuurmuurScript *vr_script, char *ip)
+{
+    char    tmp_set[sizeof(vr_script->set)] = "";
+
+    /* -V RULE */
+    if(strlcpy(vr_script->var, "RULE", sizeof(vr_script->var)) >= sizeof(vr_script->var))
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
+                "could not set variable: internal argument 'RULE' too long (max: %d).",
+                (int)sizeof(vr_script->var)-1);
+        return(VRS_ERR_COMMANDLINE);
+    }
+
+    /* --set "block 1.2.3.4" */
+    if(snprintf(tmp_set, sizeof(tmp_set), "block %s", ip) >= (int)sizeof(tmp_set))
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
+                "could not set ip address: argument too long (max: %d).",
+                (int)sizeof(tmp_set)-1);
+        return(VRS_ERR_COMMANDLINE);
+    }
+    if(strlcpy(vr_script->set, tmp_set, sizeof(vr_script->set)) >= sizeof(vr_script->set))
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
+                "could not set ip address: argument too long (max: %d).",
+                (int)sizeof(vr_script->set)-1);
+        return(VRS_ERR_COMMANDLINE);
+    }
+
+    /* -r blocklist */
+    vr_script->type = TYPE_RULE;
+
+    if(strlcpy(vr_script->name, "blocklist", sizeof(vr_script->name)) >= sizeof(vr_script->name))
+    {
+        (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR,
+                "rule (-r/--rule): internal argument too long (max: %d).",
+                (int)sizeof(vr_script->name)-1);
+        return(VRS_ERR_COMMANDLINE);
+    }
+
+    /* --apply */
+    vr_script->apply = TRUE;
+
+    return(VRS_SUCCESS);
+}
+
+
+/*  script_check
+
+    Checks the type and the name of the object the command works on, splits
+    zone names and sets the variable to 'any' if it was not set.
+
+    Returncodes:
+        VRS_SUCCESS: ok
+        otherwise the VRS_ERR_* code to exit with
+*/
+int
+script_check(const int debuglvl, VuurmuurScript *vr_script)
+{
     /*
         handling the type
     */
-    if(vr_script.type == TYPE_UNSET && vr_script.cmd != CMD_RLD)
+    if(vr_script->type == TYPE_UNSET && vr_script->cmd != CMD_RLD)
     {
         (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "type option not set. Please see --help for options.");
-        exit(VRS_ERR_COMMANDLINE);
+        return(VRS_ERR_COMMANDLINE);
     }
 
-    if(vr_script.type == TYPE_HOST)
+    if(vr_script->type == TYPE_HOST)
     {
         if(conf.verbose_out == TRUE)
             (void)vrprint.info(VR_INFO, "type 'host' selected.");
     }
-    else if(vr_script.type == TYPE_GROUP)
+    else if(vr_script->type == TYPE_GROUP)
     {
         if(conf.verbose_out == TRUE)
             (void)vrprint.info(VR_INFO, "type 'group' selected.");
     }
-    else if(vr_script.type == TYPE_NETWORK)
+    else if(vr_script->type == TYPE_NETWORK)
     {
         if(conf.verbose_out == TRUE)
             (void)vrprint.info(VR_INFO, "type 'network' selected.");
     }
-    else if(vr_script.type == TYPE_ZONE)
+    else if(vr_script->type == TYPE_ZONE)
     {
         if(conf.verbose_out == TRUE)
             (void)vrprint.info(VR_INFO, "type 'zone' selected.");
     }
-    else if(vr_script.type == TYPE_SERVICE)
+    else if(vr_script->type == TYPE_SERVICE)
     {
         if(conf.verbose_out == TRUE)
             (void)vrprint.info(VR_INFO, "type 'service' selected.");
     }
-    else if(vr_script.type == TYPE_INTERFACE)
+    else if(vr_script->type == TYPE_INTERFACE)
     {
         if(conf.verbose_out == TRUE)
             (void)vrprint.info(VR_INFO, "type 'interface' selected.");
     }
-    else if(vr_script.type == TYPE_RULE)
+    else if(vr_script->type == TYPE_RULE)
     {
         if(conf.verbose_out == TRUE)
             (void)vrprint.info(VR_INFO, "type 'rule' selected.");
     }
-    else if(vr_script.cmd == CMD_RLD)
+    else if(vr_script->cmd == CMD_RLD)
     {
         if(conf.verbose_out == TRUE)
             (void)vrprint.info(VR_INFO, "reload has no option.");
     }
     else
     {
-        (void)vrprint.error(VRS_ERR_INTERNAL, VR_INTERR, "unknown type option %d.", vr_script.type);
-        exit(VRS_ERR_INTERNAL);
+        (void)vrprint.error(VRS_ERR_INTERNAL, VR_INTERR, "unknown type option %d.", vr_script->type);
+        return(VRS_ERR_INTERNAL);
     }
 
     /*
         handling the name
     */
-    if(vr_script.name[0] == '\0')
+    if(vr_script->name[0] == '\0')
     {
-        (void)strlcpy(vr_script.name, "any", sizeof(vr_script.name));
+        (void)strlcpy(vr_script->name, "any", sizeof(vr_script->name));
     }
-    else if(strcasecmp(vr_script.name, "any") == 0)
+    else if(strcasecmp(vr_script->name, "any") == 0)
     {
         /* ignore any */
     }
     else
     {
-        if( vr_script.type == TYPE_ZONE || vr_script.type == TYPE_NETWORK ||
-            vr_script.type == TYPE_HOST || vr_script.type == TYPE_GROUP)
+        if( vr_script->type == TYPE_ZONE || vr_script->type == TYPE_NETWORK ||
+            vr_script->type == TYPE_HOST || vr_script->type == TYPE_GROUP)
         {
             /* validate and split the new name */
-            if(validate_zonename(debuglvl, vr_script.name, 0, vr_script.name_zone, vr_script.name_net, vr_script.name_host, vr_script.reg.zonename, VALNAME_VERBOSE) != 0)
+            if(validate_zonename(debuglvl, vr_script->name, 0, vr_script->name_zone, vr_script->name_net, vr_script->name_host, vr_script->reg.zonename, VALNAME_VERBOSE) != 0)
             {
-                if(vr_script.type == TYPE_ZONE)
-                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid zone name '%s' (in: %s:%d).", vr_script.name, __FUNC__, __LINE__);
-                else if(vr_script.type == TYPE_NETWORK)
-                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid network name '%s' (in: %s:%d).", vr_script.name, __FUNC__, __LINE__);
-                else if(vr_script.type == TYPE_HOST)
-                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid host name '%s' (in: %s:%d).", vr_script.name, __FUNC__, __LINE__);
-                else if(vr_script.type == TYPE_GROUP)
-                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid group name '%s' (in: %s:%d).", vr_script.name, __FUNC__, __LINE__);
+                if(vr_script->type == TYPE_ZONE)
+                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid zone name '%s' (in: %s:%d).", vr_script->name, __FUNC__, __LINE__);
+                else if(vr_script->type == TYPE_NETWORK)
+                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid network name '%s' (in: %s:%d).", vr_script->name, __FUNC__, __LINE__);
+                else if(vr_script->type == TYPE_HOST)
+                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid host name '%s' (in: %s:%d).", vr_script->name, __FUNC__, __LINE__);
+                else if(vr_script->type == TYPE_GROUP)
+                    (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid group name '%s' (in: %s:%d).", vr_script->name, __FUNC__, __LINE__);
                 
-                exit(VRS_ERR_COMMANDLINE);
+                return(VRS_ERR_COMMANDLINE);
             }
             if(debuglvl >= HIGH)
                 (void)vrprint.debug(__FUNC__, "name: '%s': host/group '%s', net '%s', zone '%s'.",
-                                        vr_script.name, vr_script.name_host,
-                                        vr_script.name_net, vr_script.name_zone);
+                                        vr_script->name, vr_script->name_host,
+                                        vr_script->name_net, vr_script->name_zone);
         }
-        else if(vr_script.type == TYPE_SERVICE)
+        else if(vr_script->type == TYPE_SERVICE)
         {
-            if(validate_servicename(debuglvl, vr_script.name, vr_script.reg.servicename, VALNAME_QUIET) != 0)
+            if(validate_servicename(debuglvl, vr_script->name, vr_script->reg.servicename, VALNAME_QUIET) != 0)
             {
-                (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid service name '%s' (in: %s:%d).", vr_script.name, __FUNC__, __LINE__);
-                exit(VRS_ERR_COMMANDLINE);
+                (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid service name '%s' (in: %s:%d).", vr_script->name, __FUNC__, __LINE__);
+                return(VRS_ERR_COMMANDLINE);
             }
         }
-        else if(vr_script.type == TYPE_INTERFACE)
+        else if(vr_script->type == TYPE_INTERFACE)
         {
-            if(validate_interfacename(debuglvl, vr_script.name, vr_script.reg.interfacename) != 0)
+            if(validate_interfacename(debuglvl, vr_script->name, vr_script->reg.interfacename) != 0)
             {
-                (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid interface name '%s' (in: %s:%d).", vr_script.name, __FUNC__, __LINE__);
-                exit(VRS_ERR_COMMANDLINE);
+                (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid interface name '%s' (in: %s:%d).", vr_script->name, __FUNC__, __LINE__);
+                return(VRS_ERR_COMMANDLINE);
             }
         }
-        else if(vr_script.type == TYPE_RULE)
+        else if(vr_script->type == TYPE_RULE)
         {
-            if( strcmp(vr_script.name, "blocklist") == 0 ||
-                strcmp(vr_script.name, "rules") == 0)
+            if( strcmp(vr_script->name, "blocklist") == 0 ||
+                strcmp(vr_script->name, "rules") == 0)
             {
                 /* ok */
             }
             else
             {
                 /* error */
-                (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid ruleset name '%s' (in: %s:%d).", vr_script.name, __FUNC__, __LINE__);
-                exit(VRS_ERR_COMMANDLINE);
+                (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "invalid ruleset name '%s' (in: %s:%d).", vr_script->name, __FUNC__, __LINE__);
+                return(VRS_ERR_COMMANDLINE);
             }
         }
         else
         {
             /* error */
-            (void)vrprint.error(VRS_ERR_INTERNAL, VR_INTERR, "unknown type option %d.", vr_script.type);
-            exit(VRS_ERR_INTERNAL);
+            (void)vrprint.error(VRS_ERR_INTERNAL, VR_INTERR, "unknown type option %d.", vr_script->type);
+            return(VRS_ERR_INTERNAL);
         }
     }
 
     /* set var to any if var is empty */
-    if(vr_script.var[0] == '\0')
-        (void)strlcpy(vr_script.var, "any", sizeof(vr_script.var));
+    if(vr_script->var[0] == '\0')
+        (void)strlcpy(vr_script->var, "any", sizeof(vr_script->var));
 
-    /* see if we need to print rule numbers */
-    if(print_linenum_flag == 1)
-        vr_script.print_rule_numbers = TRUE;
+    return(VRS_SUCCESS);
+}
 
-    /* initialize the config from the config file */
-    if(debuglvl >= MEDIUM)
-        (void)vrprint.debug(__FUNC__, "initializing config... calling init_config()");
 
-    result = init_config(debuglvl, &conf);
-    if(result >= VR_CNF_OK)
-    {
-        if(debuglvl >= MEDIUM)
-            (void)vrprint.debug(__FUNC__, "initializing config complete and succesful.");
-    }
-    else
-    {
-        fprintf(stdout, "Initializing config failed.\n");
-        exit(EXIT_FAILURE);
-    }
+/*  script_exec
 
+    Executes the command that was set up in vr_script. Applying the changes
+    is left to the caller.
 
-    /* now we know the logfile locations, so init the log functions */
-    if(conf.verbose_out == TRUE)
-    {
-        /* if we use verbose output, we still print the logfiles as well */
-        vrprint.error = libvuurmuur_logstdoutprint_error;
-        vrprint.warning = libvuurmuur_logstdoutprint_warning;
-        vrprint.info = libvuurmuur_logstdoutprint_info;
-        vrprint.debug = libvuurmuur_logstdoutprint_debug;
-    }
-    else
-    {
-        vrprint.error = libvuurmuur_logprint_error;
-        vrprint.warning = libvuurmuur_logprint_warning;
-        vrprint.info = libvuurmuur_logprint_info;
-        vrprint.debug = libvuurmuur_logprint_debug;
-    }
-    /* audit only to the log, no matter if we are in verbose mode or not
-       because it prints: username: message... example:
-       
-       victor : interface 'abcd' added.
-    */
-    vrprint.audit = libvuurmuur_logprint_audit;
-
-
-    /* load the backends */
-    result = load_backends(debuglvl, &PluginList);
-    if(result < 0)
-    {
-        fprintf(stdout, "Error: loading backends failed\n");
-        exit(EXIT_FAILURE);
-    }
+    Returncodes:
+        VRS_SUCCESS: ok
+        otherwise the VRS_ERR_* code of the failure
+*/
+int
+script_exec(const int debuglvl, VuurmuurScript *vr_script)
+{
+    int     retval = VRS_SUCCESS,
+            result = 0;
+    char    *str = NULL;
 
-    /* main part: handle the different commands */
-    if(vr_script.cmd == CMD_LST)
+    if(vr_script->cmd == CMD_LST)
     {
-        retval = script_list(debuglvl, &vr_script);
+        retval = script_list(debuglvl, vr_script);
     }
-    else if(vr_script.cmd == CMD_PRT)
+    else if(vr_script->cmd == CMD_PRT)
     {
-        if(strcasecmp(vr_script.name,"any") == 0)
+        if(strcasecmp(vr_script->name,"any") == 0)
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "cannot use command 'print' on object 'any'.");
             retval = VRS_ERR_COMMANDLINE;
         }
         else
         {
-            retval = script_print(debuglvl, &vr_script);
+            retval = script_print(debuglvl, vr_script);
         }
     }
-    else if(vr_script.cmd == CMD_ADD)
+    else if(vr_script->cmd == CMD_ADD)
     {
-        if(strcasecmp(vr_script.name,"any") == 0)
+        if(strcasecmp(vr_script->name,"any") == 0)
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "cannot use command 'add' on object 'any'.");
             retval = VRS_ERR_COMMANDLINE;
         }
         else
         {
-            retval = script_add(debuglvl, &vr_script);
+            retval = script_add(debuglvl, vr_script);
         }
     }
-    else if(vr_script.cmd == CMD_DEL)
+    else if(vr_script->cmd == CMD_DEL)
     {
-        if(strcasecmp(vr_script.name,"any") == 0)
+        if(strcasecmp(vr_script->name,"any") == 0)
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "cannot use command 'del' on object 'any'.");
             retval = VRS_ERR_COMMANDLINE;
         }
         else
         {
-            retval = script_delete(debuglvl, &vr_script);
+            retval = script_delete(debuglvl, vr_script);
         }
     }
-    else if(vr_script.cmd == CMD_MOD || vr_script.cmd == CMD_BLK)
+    else if(vr_script->cmd == CMD_MOD || vr_script->cmd == CMD_BLK)
     {
         /* workaround for the problem that we don't want to append into
          * append into an empty list then using --block */
-        if (vr_script.cmd == CMD_BLK) {
-            /* append or overwrite mode (fix ticket #49) */
+        if (vr_script->cmd == CMD_BLK) {
+            /* append or overwrite mode (fix ticket #49). Not a multi
+             * question, so no cursor is left behind in batch mode. */
             if ((rf->ask(debuglvl, rule_backend, "blocklist", "RULE",
-                            vr_script.bdat, sizeof(vr_script.bdat), TYPE_RULE, 1) == 1))
+                            vr_script->bdat, sizeof(vr_script->bdat), TYPE_RULE, 0) == 1))
             {
                 /* we got a rule from the backend so we have to append */
-                vr_script.overwrite = FALSE;
+                vr_script->overwrite = FALSE;
             } else {
                 /* there are no rules in the backend so we overwrite */
-                vr_script.overwrite = TRUE;
+                vr_script->overwrite = TRUE;
             }
 
             /* switch to mod here */
-            vr_script.cmd = CMD_MOD;
+            vr_script->cmd = CMD_MOD;
         }
 
-        if(strcasecmp(vr_script.name,"any") == 0)
+        if(strcasecmp(vr_script->name,"any") == 0)
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "cannot use command 'modify' on object 'any'.");
             retval = VRS_ERR_COMMANDLINE;
         }
-        else if(vr_script.var[0] == '\0' || strcasecmp(vr_script.var, "any") == 0)
+        else if(vr_script->var[0] == '\0' || strcasecmp(vr_script->var, "any") == 0)
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "please set the variable to modify with --variable.");
             retval = VRS_ERR_COMMANDLINE;
         }
         /* allow empty 'set' if we overwrite, since that way we can clear variables */
-        else if(vr_script.set[0] == '\0' && vr_script.overwrite == FALSE)
+        else if(vr_script->set[0] == '\0' && vr_script->overwrite == FALSE)
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "please set the new value with --set.");
             retval = VRS_ERR_COMMANDLINE;
         }
         else
         {
-            retval = script_modify(debuglvl, &vr_script);
+            retval = script_modify(debuglvl, vr_script);
         }
     }
-    else if(vr_script.cmd == CMD_REN)
+    else if(vr_script->cmd == CMD_REN)
     {
-        if(strcasecmp(vr_script.name,"any") == 0)
+        if(strcasecmp(vr_script->name,"any") == 0)
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "cannot use command 'rename' on object 'any'.");
             retval = VRS_ERR_COMMANDLINE;
         }
-        else if(strcasecmp(vr_script.set,"any") == 0)
+        else if(strcasecmp(vr_script->set,"any") == 0)
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "cannot rename a object to 'any'.");
             retval = VRS_ERR_COMMANDLINE;
         }
-        else if(strncasecmp(vr_script.set,"firewall", 8) == 0)
+        else if(strncasecmp(vr_script->set,"firewall", 8) == 0)
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "cannot rename a object to a name that starts with 'firewall'.");
             retval = VRS_ERR_COMMANDLINE;
         }
-        else if(vr_script.set[0] == '\0')
+        else if(vr_script->set[0] == '\0')
         {
             (void)vrprint.error(VRS_ERR_COMMANDLINE, VR_ERR, "please set the new name with --set.");
             retval = VRS_ERR_COMMANDLINE;
         }
         else
         {
-            retval = script_rename(debuglvl, &vr_script);
+            retval = script_rename(debuglvl, vr_script);
         }
     }
-    else if(vr_script.cmd == CMD_UBL)
+    else if(vr_script->cmd == CMD_UBL)
     {
-        retval = script_unblock(debuglvl, &vr_script);
+        retval = script_unblock(debuglvl, vr_script);
     }
-    else if(vr_script.cmd == CMD_LBL)
+    else if(vr_script->cmd == CMD_LBL)
     {
-        while((result = rf->ask(debuglvl, rule_backend, "blocklist", "RULE", vr_script.bdat, sizeof(vr_script.bdat), TYPE_RULE, 1) == 1))
+        while((result = rf->ask(debuglvl, rule_backend, "blocklist", "RULE", vr_script->bdat, sizeof(vr_script->bdat), TYPE_RULE, 1) == 1))
         {
-            rules_encode_rule(debuglvl, vr_script.bdat, sizeof(vr_script.bdat));
-            str = remove_leading_part(vr_script.bdat);
+            rules_encode_rule(debuglvl, vr_script->bdat, sizeof(vr_script->bdat));
+            str = remove_leading_part(vr_script->bdat);
             printf("%s\n", str);
             free(str);
         }
@@ -886,7 +1007,7 @@ main(int argc, char *argv[])
         else
             retval = VRS_ERR_COMMAND_FAILED;
     }
-    else if(vr_script.cmd == CMD_RLD)
+    else if(vr_script->cmd == CMD_RLD)
     {
         retval = VRS_SUCCESS;
     }
@@ -896,30 +1017,6 @@ main(int argc, char *argv[])
         retval = VRS_ERR_COMMANDLINE;
     }
 
-    /* if all went well (retval == 0) we can apply now */
-    if(vr_script.apply == TRUE && retval == VRS_SUCCESS)
-    {
-        retval = script_apply(debuglvl, &vr_script);
-    }
-
-    /* unload the backends */
-    result = unload_backends(debuglvl, &PluginList);
-    if(result < 0)
-    {
-        fprintf(stdout, "Error: unloading backends failed.\n");
-        exit(EXIT_FAILURE);
-    }
-
-    /*
-        Destroy the data structures
-    */
-
-    /* cleanup regexes */
-    (void)setup_rgx(0, &vr_script.reg);
-
-    if(debuglvl >= HIGH)
-        (void)vrprint.debug(__FUNC__, "** end **, return = %d", retval);
-
     return(retval);
 }
 
@@ -103,6 +103,7 @@ enum
     CMD_UBL, /* unblock an ip, host or group */
     CMD_LBL, /* list blocked objects */
     CMD_RLD, /* apply changes without any other action */
+    CMD_BAT, /* run the commands from a batch file */
 
     CMD_ERROR,
 };
@@ -148,6 +149,14 @@ typedef struct VuurmuurScript_
     /* print rule numbers? */
     char        print_rule_numbers;
 
+    /* batch mode: file to read the commands from ("-" for stdin) and
+       if --no-apply was given on the commandline */
+    char        *batch;
+    char        no_apply;
+
+    /* vuurmuur already reloaded over the control channel */
+    char        reloaded;
+
 } VuurmuurScript;
 
 
@@ -166,6 +175,11 @@ int script_rename(const int, VuurmuurScript *);
 int script_apply(const int debuglvl, VuurmuurScript *vr_script);
 int script_unblock(const int debuglvl, VuurmuurScript *vr_script);
 int script_list_devices(const int);
+int script_check(const int debuglvl, VuurmuurScript *vr_script);
+int script_exec(const int debuglvl, VuurmuurScript *vr_script);
+int script_set_block(VuurmuurScript *vr_script, char *ip);
+int script_batch(const int debuglvl, VuurmuurScript *vr_script);
+int script_apply_block(const int debuglvl, VuurmuurScript *vr_script, int *retval);
 
 int backend_check(const int, int, char *, char *, char, struct rgx_ *);
 